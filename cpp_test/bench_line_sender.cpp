@@ -0,0 +1,118 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include "mock_server.hpp"
+
+#include <questdb/ingress/line_sender.hpp>
+
+#include <cstdint>
+#include <string>
+
+using namespace questdb::ingress::literals;
+
+static constexpr int64_t rows_per_iter = 1000;
+
+static void fill_narrow(questdb::ingress::line_sender_buffer& buffer)
+{
+    for (int64_t row = 0; row < rows_per_iter; ++row)
+    {
+        buffer
+            .table("cpu"_tn)
+            .symbol("host"_cn, "host-01"_utf8)
+            .column("usage_user"_cn, static_cast<double>(row) * 0.25)
+            .column("usage_system"_cn, static_cast<double>(row) * 0.5)
+            .column("cores"_cn, row)
+            .at(questdb::ingress::timestamp_nanos{1700000000000000000 + row});
+    }
+}
+
+static void bm_buffer_narrow_numeric(benchmark::State& state)
+{
+    questdb::ingress::line_sender_buffer buffer;
+    for (auto _ : state)
+    {
+        buffer.clear();
+        fill_narrow(buffer);
+        benchmark::DoNotOptimize(buffer.size());
+    }
+    state.SetItemsProcessed(state.iterations() * rows_per_iter);
+}
+BENCHMARK(bm_buffer_narrow_numeric);
+
+static void bm_buffer_string_heavy(benchmark::State& state)
+{
+    std::string message;
+    for (int count = 0; count < 4; ++count)
+        message += "GET /api/v1/orders?id=42 completed in 12ms, \"status\": 200\n";
+    const questdb::ingress::utf8_view message_view{message};
+    questdb::ingress::line_sender_buffer buffer;
+    for (auto _ : state)
+    {
+        buffer.clear();
+        for (int64_t row = 0; row < rows_per_iter; ++row)
+        {
+            buffer
+                .table("logs"_tn)
+                .symbol("level"_cn, "INFO"_utf8)
+                .column("message"_cn, message_view)
+                .column("thread"_cn, "worker-7"_utf8)
+                .at(questdb::ingress::timestamp_nanos{row});
+        }
+        benchmark::DoNotOptimize(buffer.size());
+    }
+    state.SetItemsProcessed(state.iterations() * rows_per_iter);
+    state.SetBytesProcessed(
+        state.iterations() * rows_per_iter *
+        static_cast<int64_t>(message.size()));
+}
+BENCHMARK(bm_buffer_string_heavy);
+
+static void bm_flush_tcp(benchmark::State& state)
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::line_sender sender{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        server.port()};
+    server.accept();
+
+    questdb::ingress::line_sender_buffer buffer;
+    fill_narrow(buffer);
+    for (auto _ : state)
+    {
+        sender.flush_and_keep(buffer);
+        size_t received = 0;
+        while (received < static_cast<size_t>(rows_per_iter))
+            received += server.recv(5.0);
+        server.clear_msgs();
+    }
+    state.SetItemsProcessed(state.iterations() * rows_per_iter);
+    state.SetBytesProcessed(
+        state.iterations() * static_cast<int64_t>(buffer.size()));
+}
+BENCHMARK(bm_flush_tcp);
+
+BENCHMARK_MAIN();
@@ -62,6 +62,11 @@ public:
         return _msgs;
     }
 
+    void clear_msgs()
+    {
+        _msgs.clear();
+    }
+
     void close();
 
     ~mock_server();
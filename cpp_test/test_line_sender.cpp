@@ -32,6 +32,8 @@
 
 #include <vector>
 #include <sstream>
+#include <fstream>
+#include <cstdio>
 #include <chrono>
 #include <thread>
 
@@ -162,6 +164,644 @@ TEST_CASE("line_sender c++ api basics")
     CHECK(server.msgs().front() == "test,t1=v1,t2= f1=0.5 10000000\n");
 }
 
+TEST_CASE("line_sender flush_if_due")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::opts opts{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        server.port()};
+    opts.auto_flush_rows(2).auto_flush_interval(0);
+    questdb::ingress::line_sender sender{opts};
+    server.accept();
+
+    questdb::ingress::line_sender_buffer buffer;
+    CHECK_FALSE(sender.should_flush(buffer));
+    buffer.table("test").symbol("t1", "v1").at_now();
+    CHECK_FALSE(sender.flush_if_due(buffer));
+    buffer.table("test").symbol("t1", "v2");
+    CHECK_FALSE(sender.should_flush(buffer));
+    buffer.at_now();
+    CHECK(sender.flush_if_due(buffer));
+    CHECK(buffer.size() == 0);
+    CHECK(server.recv() == 2);
+
+    CHECK_THROWS_AS(
+        questdb::ingress::opts::from_conf(
+            "tcp::addr=localhost:9009;auto_flush=off;auto_flush_rows=100;"),
+        questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("background line_sender flush")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::line_sender sender{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        server.port()};
+    server.accept();
+
+    questdb::ingress::background_line_sender bg_sender{std::move(sender), 2};
+
+    // The original sender is left closed.
+    questdb::ingress::line_sender_buffer buffer;
+    CHECK_THROWS_AS(sender.flush(buffer), questdb::ingress::line_sender_error);
+
+    buffer
+        .table("test")
+        .symbol("t1", "v1")
+        .at(questdb::ingress::timestamp_nanos{10000000});
+    auto handle1 = bg_sender.flush(buffer);
+    CHECK(buffer.size() == 0);
+
+    buffer
+        .table("test")
+        .symbol("t1", "v2")
+        .at(questdb::ingress::timestamp_nanos{20000000});
+    auto handle2 = bg_sender.flush(buffer);
+    CHECK(buffer.size() == 0);
+
+    handle1.wait();
+    handle2.wait();
+    CHECK(handle2.is_done());
+    CHECK_THROWS_AS(handle2.wait(), questdb::ingress::line_sender_error);
+    bg_sender.close();
+
+    CHECK(server.recv() == 2);
+    CHECK(server.msgs()[0] == "test,t1=v1 10000000\n");
+    CHECK(server.msgs()[1] == "test,t1=v2 20000000\n");
+}
+
+TEST_CASE("concurrent_line_sender commit")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::line_sender sender{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        server.port()};
+    server.accept();
+
+    questdb::ingress::concurrent_line_sender conc_sender{std::move(sender)};
+
+    questdb::ingress::line_sender_buffer lane1;
+    questdb::ingress::line_sender_buffer lane2;
+    lane1
+        .table("test")
+        .symbol("t1", "v1")
+        .at(questdb::ingress::timestamp_nanos{10000000});
+    lane2
+        .table("test")
+        .symbol("t1", "v2")
+        .at(questdb::ingress::timestamp_nanos{20000000});
+    auto handle1 = conc_sender.commit(lane1);
+    auto handle2 = conc_sender.commit(lane2);
+    CHECK(lane1.size() == 0);
+    CHECK(lane2.size() == 0);
+    handle1.wait();
+    handle2.wait();
+    conc_sender.close();
+    CHECK_THROWS_AS(
+        conc_sender.commit(lane1), questdb::ingress::line_sender_error);
+
+    CHECK(server.recv() == 2);
+    CHECK(server.msgs()[0] == "test,t1=v1 10000000\n");
+    CHECK(server.msgs()[1] == "test,t1=v2 20000000\n");
+}
+
+TEST_CASE("flush_many")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::line_sender sender{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        server.port()};
+    server.accept();
+
+    questdb::ingress::line_sender_buffer buffer1;
+    buffer1
+        .table("test")
+        .symbol("t1", "v1")
+        .at(questdb::ingress::timestamp_nanos{10000000});
+    questdb::ingress::line_sender_buffer buffer2;
+    buffer2
+        .table("test")
+        .symbol("t1", "v2")
+        .at(questdb::ingress::timestamp_nanos{20000000});
+    sender.flush_many({buffer1, buffer2});
+    CHECK(buffer1.size() == 0);
+    CHECK(buffer2.size() == 0);
+
+    std::vector<questdb::ingress::line_sender_buffer> buffers(3);
+    buffers[2]
+        .table("test")
+        .symbol("t1", "v3")
+        .at(questdb::ingress::timestamp_nanos{30000000});
+    sender.flush_many(buffers);
+    CHECK(buffers[2].size() == 0);
+
+    CHECK(server.recv() == 3);
+    CHECK(server.msgs()[0] == "test,t1=v1 10000000\n");
+    CHECK(server.msgs()[1] == "test,t1=v2 20000000\n");
+    CHECK(server.msgs()[2] == "test,t1=v3 30000000\n");
+}
+
+TEST_CASE("try_flush")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::line_sender sender{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        server.port()};
+    server.accept();
+    sender.set_nonblocking(true);
+    CHECK(sender.raw_socket().has_value());
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer
+        .table("test")
+        .symbol("t1", "v1")
+        .at(questdb::ingress::timestamp_nanos{10000000});
+    CHECK_THROWS_AS(sender.flush(buffer), questdb::ingress::line_sender_error);
+    while (!sender.try_flush(buffer))
+    {
+    }
+    CHECK(buffer.size() == 0);
+    CHECK(buffer.send_offset() == 0);
+
+    // Without rate limits, there's never a reason to wait.
+    CHECK(sender.try_flush_delay().count() == 0);
+
+    CHECK(server.recv() == 1);
+    CHECK(server.msgs()[0] == "test,t1=v1 10000000\n");
+}
+
+TEST_CASE("at_delta")
+{
+    questdb::ingress::line_sender_buffer expected;
+    questdb::ingress::line_sender_buffer buffer;
+    for (int64_t ts = 1659548315599999990; ts < 1659548315600000010; ts += 3)
+    {
+        expected.table("test").symbol("t1", "v1").at(
+            questdb::ingress::timestamp_nanos{ts});
+        buffer.table("test").symbol("t1", "v1").at_delta(
+            questdb::ingress::timestamp_nanos{ts});
+    }
+    CHECK(buffer.peek() == expected.peek());
+    buffer.table("test").symbol("t1", "v1");
+    CHECK_THROWS_AS(
+        buffer.at_delta(questdb::ingress::timestamp_nanos{-1}),
+        questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("failover_addr")
+{
+    uint16_t closed_port = 0;
+    {
+        questdb::ingress::test::mock_server closed;
+        closed_port = closed.port();
+    }
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::opts opts{
+        questdb::ingress::protocol::tcp, "127.0.0.1", closed_port};
+    opts.failover_addr("localhost", server.port());
+    questdb::ingress::line_sender sender{opts};
+    server.accept();
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer.table("test").symbol("t1", "v1").at_now();
+    sender.flush(buffer);
+    REQUIRE(server.recv() == 1);
+    CHECK(server.msgs()[0] == "test,t1=v1\n");
+}
+
+TEST_CASE("drop_rows and split_at_row")
+{
+    questdb::ingress::line_sender_buffer buffer;
+    CHECK(buffer.row_offset(0) == 0);
+    CHECK(!buffer.row_offset(1));
+    buffer.table("a").symbol("s", "1").at_now();
+    buffer.table("b").symbol("s", "2").at_now();
+    buffer.table("a").symbol("s", "3").at_now();
+    CHECK(buffer.row_offset(1) == 6);
+    CHECK(!buffer.transactional());
+
+    buffer.drop_rows(1, 2);
+    CHECK(buffer.peek() == "a,s=1\na,s=3\n");
+    CHECK(buffer.transactional());
+    try
+    {
+        buffer.drop_rows(1, 3);
+        FAIL("Expected an exception");
+    }
+    catch (const questdb::ingress::line_sender_error& se)
+    {
+        CHECK(
+            se.code() ==
+            questdb::ingress::line_sender_error_code::invalid_api_call);
+        CHECK(!se.failed_row());
+    }
+
+    questdb::ingress::line_sender_buffer tail = buffer.split_at_row(1);
+    CHECK(buffer.peek() == "a,s=1\n");
+    CHECK(tail.peek() == "a,s=3\n");
+    CHECK(tail.row_count() == 1);
+}
+
+TEST_CASE("append_buffer")
+{
+    questdb::ingress::line_sender_buffer buffer;
+    questdb::ingress::line_sender_buffer other;
+    buffer.append_buffer(other);
+    CHECK(buffer.size() == 0);
+
+    other.table("a").symbol("s", "1").at_now();
+    buffer.append_buffer(other).append_buffer(other);
+    CHECK(buffer.peek() == "a,s=1\na,s=1\n");
+    CHECK(buffer.row_count() == 2);
+    CHECK(buffer.transactional());
+    CHECK(other.row_count() == 1);
+
+    other.clear();
+    other.table("b").symbol("s", "2").at_now();
+    buffer.append_buffer(other);
+    CHECK(buffer.row_count() == 3);
+    CHECK(!buffer.transactional());
+
+    other.table("b");
+    CHECK_THROWS_AS(
+        buffer.append_buffer(other), questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("append_raw_ilp")
+{
+    questdb::ingress::line_sender_buffer buffer;
+    buffer.table("a").symbol("s", "1").at_now();
+    buffer.append_raw_ilp("a,s=2\na,s=3 x=\"y\\\nz\"\n");
+    CHECK(buffer.row_count() == 3);
+    CHECK(buffer.transactional());
+    CHECK(buffer.peek() == "a,s=1\na,s=2\na,s=3 x=\"y\\\nz\"\n");
+
+    CHECK_THROWS_AS(
+        buffer.append_raw_ilp("a,s=4"), questdb::ingress::line_sender_error);
+    CHECK_THROWS_AS(
+        buffer.append_raw_ilp("a x=\"\xff\"\n"),
+        questdb::ingress::line_sender_error);
+    buffer.append_raw_ilp("a x=\"\xff\"\n", false);
+    CHECK(buffer.row_count() == 4);
+}
+
+TEST_CASE("flush_chunked")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::opts opts{
+        questdb::ingress::protocol::tcp, "localhost", server.port()};
+    opts.max_buf_size(1024);
+    questdb::ingress::line_sender sender{opts};
+    server.accept();
+
+    questdb::ingress::line_sender_buffer buffer;
+    for (int64_t i = 0; i < 100; ++i)
+        buffer.table("test").column("i", i).at_now();
+    CHECK(buffer.size() > 1024);
+    CHECK_THROWS_AS(sender.flush(buffer), questdb::ingress::line_sender_error);
+    sender.flush_chunked(buffer);
+    CHECK(buffer.size() == 0);
+    while (server.msgs().size() < 100)
+        server.recv(0.1);
+    CHECK(server.msgs()[99] == "test i=99i\n");
+}
+
+TEST_CASE("send_file")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::opts opts{
+        questdb::ingress::protocol::tcp, "localhost", server.port()};
+    questdb::ingress::line_sender sender{opts};
+    server.accept();
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer.table("test").symbol("t1", "v1").at_now();
+    buffer.table("test").symbol("t1", "v2").at_now();
+    const std::string path = "test_line_sender_send_file.ilp";
+    {
+        std::ofstream file{path, std::ios::binary};
+        file << buffer.peek();
+    }
+    sender.send_file(questdb::ingress::utf8_view{path});
+    std::remove(path.c_str());
+    while (server.msgs().size() < 2)
+        server.recv(0.1);
+    CHECK(server.msgs()[0] == "test,t1=v1\n");
+    CHECK(server.msgs()[1] == "test,t1=v2\n");
+
+    CHECK_THROWS_AS(
+        sender.send_file(questdb::ingress::utf8_view{path}),
+        questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("prewarm")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::opts opts{
+        questdb::ingress::protocol::tcp, "localhost", server.port()};
+    CHECK_THROWS_AS(opts.prewarm(true), questdb::ingress::line_sender_error);
+    CHECK_THROWS_AS(
+        opts.ping_interval(1000), questdb::ingress::line_sender_error);
+
+    // Warming up an ILP/TCP sender is a no-op.
+    questdb::ingress::line_sender sender{opts};
+    server.accept();
+    sender.warm_up();
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer.table("test").symbol("t1", "v1").at_now();
+    sender.flush(buffer);
+    REQUIRE(server.recv() == 1);
+    CHECK(server.msgs()[0] == "test,t1=v1\n");
+}
+
+TEST_CASE("protocol version 2")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::opts opts{
+        questdb::ingress::protocol::tcp, "localhost", server.port()};
+    opts.protocol_version(questdb::ingress::protocol_version::v2);
+    questdb::ingress::line_sender sender{opts};
+    server.accept();
+    CHECK(sender.protocol_version() == questdb::ingress::protocol_version::v2);
+
+    auto buffer = sender.new_buffer();
+    CHECK(buffer.protocol_version() == questdb::ingress::protocol_version::v2);
+    buffer.table("test").column("f1", 0.5).at(
+        questdb::ingress::timestamp_nanos{10});
+    std::string expected{"test f1==\x10"};
+    expected.append("\0\0\0\0\0\0\xe0\x3f 10\n", 12);
+    CHECK(buffer.peek() == expected);
+    CHECK_THROWS_AS(
+        buffer.set_protocol_version(questdb::ingress::protocol_version::v1),
+        questdb::ingress::line_sender_error);
+
+    questdb::ingress::line_sender_buffer v1_sender_buffer;
+    v1_sender_buffer.set_protocol_version(
+        questdb::ingress::protocol_version::v2);
+    v1_sender_buffer.table("test").column("f1", 0.5).at(
+        questdb::ingress::timestamp_nanos{10});
+    questdb::ingress::line_sender v1_sender{
+        questdb::ingress::protocol::tcp, "localhost", server.port()};
+    CHECK_THROWS_AS(
+        v1_sender.flush(v1_sender_buffer),
+        questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("fixed capacity buffer")
+{
+    auto buffer =
+        questdb::ingress::line_sender_buffer::with_fixed_capacity(64);
+    buffer
+        .table("test")
+        .symbol("t1", "v1")
+        .at(questdb::ingress::timestamp_nanos{10000000});
+    const auto size = buffer.size();
+    CHECK(size > 0);
+
+    try
+    {
+        buffer.table("a_table_name_that_is_far_too_long_to_fit_in_the_buffer");
+        CHECK_MESSAGE(false, "Expected exception");
+    }
+    catch (const questdb::ingress::line_sender_error& se)
+    {
+        CHECK(se.code() ==
+              questdb::ingress::line_sender_error_code::buffer_full);
+    }
+    CHECK(buffer.size() == size);
+
+    buffer.clear();
+    CHECK(buffer.size() == 0);
+    buffer.table("test").column("x", int64_t{1}).at_now();
+
+    auto copy = buffer;
+    CHECK(copy.peek() == buffer.peek());
+    CHECK_THROWS_AS(
+        copy.table("a_table_name_that_is_far_too_long_to_fit_in_the_buffer"),
+        questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("stats")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::line_sender sender{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        server.port()};
+    server.accept();
+    CHECK(sender.stats().flushes == 0);
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer
+        .table("test")
+        .symbol("t1", "v1")
+        .at(questdb::ingress::timestamp_nanos{10000000});
+    const auto size = buffer.size();
+    sender.flush(buffer);
+
+    const questdb::ingress::sender_stats stats = sender.stats();
+    CHECK(stats.flushes == 1);
+    CHECK(stats.failed_flushes == 0);
+    CHECK(stats.rows_sent == 1);
+    CHECK(stats.bytes_sent == size);
+    CHECK(stats.flush_latency_count == 1);
+    CHECK(stats.flush_latency_p50_micros <= stats.flush_latency_max_micros);
+    CHECK(server.recv() == 1);
+
+    sender.close();
+    CHECK_THROWS_AS(sender.stats(), questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("trace callback")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::line_sender sender{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        server.port()};
+    server.accept();
+
+    std::vector<::line_sender_span_kind> kinds;
+    sender.set_trace_callback(
+        [](void* ctx, const ::line_sender_span* span) {
+            static_cast<std::vector<::line_sender_span_kind>*>(ctx)->push_back(
+                span->kind);
+        },
+        &kinds);
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer
+        .table("test")
+        .symbol("t1", "v1")
+        .at(questdb::ingress::timestamp_nanos{10000000});
+    sender.flush(buffer);
+    REQUIRE(kinds.size() == 2);
+    CHECK(kinds[0] == ::line_sender_span_kind_tcp_write);
+    CHECK(kinds[1] == ::line_sender_span_kind_flush);
+
+    sender.set_trace_callback(nullptr);
+    buffer
+        .table("test")
+        .symbol("t1", "v2")
+        .at(questdb::ingress::timestamp_nanos{10000000});
+    sender.flush(buffer);
+    CHECK(kinds.size() == 2);
+    CHECK(server.recv() == 2);
+}
+
+TEST_CASE("buffer_pool")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::line_sender sender{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        server.port()};
+    server.accept();
+
+    questdb::ingress::buffer_pool buffers{1024, 4};
+    CHECK(buffers.idle() == 0);
+    {
+        questdb::ingress::background_line_sender bg_sender{
+            std::move(sender), 2, buffers};
+        auto buffer = buffers.acquire();
+        buffer
+            .table("test")
+            .symbol("t1", "v1")
+            .at(questdb::ingress::timestamp_nanos{10000000});
+        bg_sender.flush(buffer).wait();
+        CHECK(buffer.size() == 0);
+        buffers.release(std::move(buffer));
+        CHECK(buffers.idle() == 1);
+    }
+
+    // The ring is returned to the pool on close.
+    CHECK(buffers.idle() == 3);
+    auto buffer = buffers.acquire();
+    CHECK(buffer.size() == 0);
+    CHECK(buffers.idle() == 2);
+    CHECK(server.recv() == 1);
+}
+
+TEST_CASE("line_sender_pool flush")
+{
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::opts opts{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        server.port()};
+    opts.pool_size(1);
+    questdb::ingress::line_sender_pool pool{opts};
+    server.accept();
+    CHECK(pool.pool_size() == 1);
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer
+        .table("test")
+        .symbol("t1", "v1")
+        .at(questdb::ingress::timestamp_nanos{10000000});
+    pool.flush_and_keep(buffer);
+    CHECK(buffer.size() > 0);
+    buffer.clear();
+
+    buffer
+        .table("test")
+        .symbol("t1", "v2")
+        .at(questdb::ingress::timestamp_nanos{20000000});
+    pool.flush(buffer);
+    CHECK(buffer.size() == 0);
+    pool.close();
+    CHECK(pool.pool_size() == 0);
+    CHECK_THROWS_AS(pool.flush(buffer), questdb::ingress::line_sender_error);
+
+    CHECK(server.recv() == 2);
+    CHECK(server.msgs()[0] == "test,t1=v1 10000000\n");
+    CHECK(server.msgs()[1] == "test,t1=v2 20000000\n");
+
+    CHECK_THROWS_AS(
+        questdb::ingress::opts{opts}.pool_size(0),
+        questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("sharded_line_sender")
+{
+    questdb::ingress::test::mock_server server0;
+    questdb::ingress::test::mock_server server1;
+    const std::string conf =
+        "tcp::shards=localhost:" + std::to_string(server0.port()) +
+        ",localhost:" + std::to_string(server1.port()) +
+        ";shard_by=symbol;shard_key=device;";
+    auto sender = questdb::ingress::sharded_line_sender::from_conf(conf);
+    server0.accept();
+    server1.accept();
+    CHECK(sender.shard_count() == 2);
+    CHECK_THROWS_AS(sender.table("test"), questdb::ingress::line_sender_error);
+
+    for (int n = 0; n < 4; ++n)
+    {
+        sender.table_with_key("test", "d" + std::to_string(n))
+            .column("v", int64_t{1})
+            .at(questdb::ingress::timestamp_nanos{10000000});
+    }
+    CHECK(sender.row_count() == 4);
+    sender.flush();
+    CHECK(sender.row_count() == 0);
+
+    const auto stats0 = sender.shard_stats(0);
+    const auto stats1 = sender.shard_stats(1);
+    CHECK(stats0.rows_sent + stats1.rows_sent == 4);
+    CHECK(server0.recv() + server1.recv() == 4);
+
+    sender.close();
+    CHECK(sender.shard_count() == 0);
+    CHECK_THROWS_AS(sender.flush(), questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("opts compression")
+{
+    questdb::ingress::opts http_opts{
+        questdb::ingress::protocol::http,
+        "localhost",
+        9000};
+    http_opts.compression(questdb::ingress::compression::gzip);
+
+    questdb::ingress::opts tcp_opts{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        9009};
+    CHECK_THROWS_WITH_AS(
+        tcp_opts.compression(questdb::ingress::compression::zstd),
+        "\"compression\" is supported only in ILP over HTTP.",
+        questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("opts retry policy")
+{
+    questdb::ingress::opts http_opts{
+        questdb::ingress::protocol::http,
+        "localhost",
+        9000};
+    http_opts.retry_backoff(questdb::ingress::retry_backoff::full_jitter)
+        .retry_after(false)
+        .retry_budget(50)
+        .circuit_breaker_threshold(3)
+        .circuit_breaker_cooldown(250);
+
+    questdb::ingress::opts tcp_opts{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        9009};
+    CHECK_THROWS_WITH_AS(
+        tcp_opts.circuit_breaker_threshold(3),
+        "\"circuit_breaker_threshold\" is supported only in ILP over HTTP.",
+        questdb::ingress::line_sender_error);
+}
+
 TEST_CASE("test multiple lines")
 {
     questdb::ingress::test::mock_server server;
@@ -205,6 +845,281 @@ TEST_CASE("test multiple lines")
         "metric1,tag3=value\\ 3,tag\\ 4=value:4 field5=f\n");
 }
 
+TEST_CASE("append_columns")
+{
+    const std::vector<std::string> symbols{"ETH-USD", "BTC USD"};
+    const bool sides[] = {true, false};
+    const std::vector<int64_t> qty{5, 7};
+    const std::vector<double> prices{2615.54, 39269.98};
+    const std::vector<const char*> notes{"a\"b", "c"};
+    const int64_t micros[] = {1, 2};
+    const std::vector<int64_t> timestamps{10000000, 20000000};
+
+    questdb::ingress::line_sender_buffer expected;
+    for (size_t index = 0; index < 2; ++index)
+    {
+        expected
+            .table("trades"_tn)
+            .symbol("symbol"_cn, questdb::ingress::utf8_view{symbols[index]})
+            .column("side"_cn, sides[index])
+            .column("qty"_cn, qty[index])
+            .column("price"_cn, prices[index])
+            .column("note"_cn, questdb::ingress::utf8_view{std::string_view{notes[index]}})
+            .column(
+                "ts"_cn,
+                questdb::ingress::timestamp_micros{micros[index]})
+            .at(questdb::ingress::timestamp_nanos{timestamps[index]});
+    }
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer.append_columns(
+        "trades"_tn,
+        {questdb::ingress::column_slice{"side"_cn, sides, 2},
+         questdb::ingress::column_slice::symbols("symbol"_cn, symbols),
+         questdb::ingress::column_slice{"qty"_cn, qty},
+         questdb::ingress::column_slice{"price"_cn, prices},
+         questdb::ingress::column_slice::strings("note"_cn, notes),
+         questdb::ingress::column_slice::timestamps_micros(
+             "ts"_cn, micros, 2)},
+        timestamps);
+    CHECK(buffer.row_count() == 2);
+    CHECK(buffer.peek() == expected.peek());
+
+    CHECK_THROWS_AS(
+        buffer.append_columns(
+            "trades"_tn,
+            {questdb::ingress::column_slice{"qty"_cn, qty},
+             questdb::ingress::column_slice{"price"_cn, prices.data(), 1}}),
+        questdb::ingress::line_sender_error);
+    CHECK_THROWS_AS(
+        buffer.append_columns(
+            "trades"_tn,
+            {questdb::ingress::column_slice{"qty"_cn, qty}},
+            std::vector<int64_t>{1}),
+        questdb::ingress::line_sender_error);
+    CHECK(buffer.row_count() == 2);
+}
+
+TEST_CASE("append_arrow")
+{
+    const int64_t qty[] = {5, 7};
+    const uint8_t qty_validity[] = {0b01};
+    const int32_t symbol_offsets[] = {0, 7, 14};
+    const char symbol_data[] = "ETH-USDBTC-USD";
+    const int64_t timestamps[] = {10, 20};
+
+    const void* qty_buffers[] = {qty_validity, qty};
+    const void* symbol_buffers[] = {nullptr, symbol_offsets, symbol_data};
+    const void* ts_buffers[] = {nullptr, timestamps};
+    const void* struct_buffers[] = {nullptr};
+    const auto release_schema = [](ArrowSchema*) {};
+    const auto release_array = [](ArrowArray*) {};
+
+    ArrowSchema fields[] = {
+        {"u", "symbol", nullptr, 0, 0, nullptr, nullptr, release_schema, nullptr},
+        {"l", "qty", nullptr, 0, 0, nullptr, nullptr, release_schema, nullptr},
+        {"tsn:", "ts", nullptr, 0, 0, nullptr, nullptr, release_schema, nullptr}};
+    ArrowSchema* field_ptrs[] = {&fields[0], &fields[1], &fields[2]};
+    const ArrowSchema schema{
+        "+s", "", nullptr, 0, 3, field_ptrs, nullptr, release_schema, nullptr};
+
+    ArrowArray columns[] = {
+        {2, 0, 0, 3, 0, symbol_buffers, nullptr, nullptr, release_array, nullptr},
+        {2, 1, 0, 2, 0, qty_buffers, nullptr, nullptr, release_array, nullptr},
+        {2, 0, 0, 2, 0, ts_buffers, nullptr, nullptr, release_array, nullptr}};
+    ArrowArray* column_ptrs[] = {&columns[0], &columns[1], &columns[2]};
+    const ArrowArray array{
+        2, 0, 0, 1, 3, struct_buffers, column_ptrs, nullptr, release_array, nullptr};
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer.append_arrow("trades"_tn, schema, array, "ts"_cn, {"symbol"_cn});
+    CHECK(buffer.row_count() == 2);
+    CHECK(
+        buffer.peek() ==
+        "trades,symbol=ETH-USD qty=5i 10\n"
+        "trades,symbol=BTC-USD 20\n");
+
+    CHECK_THROWS_AS(
+        buffer.append_arrow("trades"_tn, schema, array, "qty"_cn),
+        questdb::ingress::line_sender_error);
+    CHECK(buffer.row_count() == 2);
+}
+
+TEST_CASE("prepared_column_name")
+{
+    const questdb::ingress::prepared_column_name sym{"a sym"_cn};
+    questdb::ingress::prepared_column_name price{"price"_cn};
+    const questdb::ingress::prepared_column_name note{"note"_cn};
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer
+        .table("test"_tn)
+        .symbol(sym, "v"_utf8)
+        .column(price, 2.5)
+        .column(note, "x"_utf8)
+        .at_now();
+    buffer
+        .table("test"_tn)
+        .column(price, static_cast<int64_t>(3))
+        .column(note, questdb::ingress::timestamp_micros{10})
+        .at_now();
+    CHECK(buffer.peek() ==
+        "test,a\\ sym=v price=2.5,note=\"x\"\n"
+        "test price=3i,note=10t\n");
+
+    questdb::ingress::prepared_column_name moved{std::move(price)};
+    buffer.table("test"_tn);
+    CHECK_THROWS_AS(
+        buffer.column(price, true),
+        questdb::ingress::line_sender_error);
+    buffer.column(moved, true).at_now();
+    CHECK(buffer.row_count() == 3);
+}
+
+TEST_CASE("trusted_buffer")
+{
+    using questdb::ingress::column_name_view;
+    using questdb::ingress::table_name_view;
+    using questdb::ingress::utf8_view;
+    auto trusted = questdb::ingress::line_sender_buffer::trusted();
+    CHECK(trusted.is_trusted());
+    trusted
+        .table(table_name_view::unchecked("trades"))
+        .symbol(column_name_view::unchecked("sym"), utf8_view::unchecked("ETH-USD"))
+        .column(column_name_view::unchecked("price"), 2615.54)
+        .at(questdb::ingress::timestamp_nanos{10});
+
+    questdb::ingress::line_sender_buffer checked;
+    CHECK_FALSE(checked.is_trusted());
+    checked
+        .table("trades"_tn)
+        .symbol("sym"_cn, "ETH-USD"_utf8)
+        .column("price"_cn, 2615.54)
+        .at(questdb::ingress::timestamp_nanos{10});
+    CHECK(trusted.peek() == checked.peek());
+
+    questdb::ingress::line_sender_buffer copy{trusted};
+    CHECK(copy.is_trusted());
+}
+
+TEST_CASE("column_fixed")
+{
+    questdb::ingress::prepared_column_name price{"price"_cn};
+    price.with_decimals(2);
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer
+        .table("test"_tn)
+        .column_fixed("qty"_cn, 101.25000000000001, 8)
+        .column(price, 2615.5449)
+        .at_now();
+    CHECK(buffer.peek() == "test qty=101.25,price=2615.54\n");
+
+    buffer.table("test"_tn);
+    CHECK_THROWS_AS(
+        buffer.column_fixed("qty"_cn, 1.0, 16),
+        questdb::ingress::line_sender_error);
+    CHECK_THROWS_AS(
+        price.with_decimals(16),
+        questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("timestamp_precision")
+{
+    questdb::ingress::line_sender_buffer buffer;
+    CHECK(
+        buffer.timestamp_precision() ==
+        questdb::ingress::timestamp_precision::nanos);
+    buffer.set_timestamp_precision(
+        questdb::ingress::timestamp_precision::seconds);
+    CHECK(
+        buffer.timestamp_precision() ==
+        questdb::ingress::timestamp_precision::seconds);
+    buffer.table("test"_tn)
+        .symbol("t1"_cn, "v1"_utf8)
+        .at(questdb::ingress::timestamp_micros{1700000000999999});
+    CHECK(buffer.peek() == "test,t1=v1 1700000000\n");
+
+    CHECK_THROWS_AS(
+        buffer.set_timestamp_precision(
+            questdb::ingress::timestamp_precision::micros),
+        questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("row_writer")
+{
+    namespace cols = questdb::ingress::cols;
+    questdb::ingress::line_sender_buffer buffer;
+    questdb::ingress::line_sender_buffer::row_writer<
+        cols::symbol,
+        cols::boolean,
+        cols::i64,
+        cols::f64,
+        cols::str,
+        cols::ts_micros> trades{
+            buffer,
+            "trades"_tn,
+            {"sym"_cn, "b"_cn, "qty"_cn, "price"_cn, "note"_cn, "ts"_cn}};
+    trades.append(
+        questdb::ingress::timestamp_nanos{10000000},
+        "ETH USD"_utf8,
+        true,
+        5,
+        2615.54,
+        "a\"b"_utf8,
+        questdb::ingress::timestamp_micros{7});
+    trades.append_now(
+        "BTC"_utf8,
+        false,
+        -1,
+        0.5,
+        ""_utf8,
+        questdb::ingress::timestamp_micros{8});
+
+    questdb::ingress::line_sender_buffer expected;
+    expected
+        .table("trades"_tn)
+        .symbol("sym"_cn, "ETH USD"_utf8)
+        .column("b"_cn, true)
+        .column("qty"_cn, static_cast<int64_t>(5))
+        .column("price"_cn, 2615.54)
+        .column("note"_cn, "a\"b"_utf8)
+        .column("ts"_cn, questdb::ingress::timestamp_micros{7})
+        .at(questdb::ingress::timestamp_nanos{10000000});
+    expected
+        .table("trades"_tn)
+        .symbol("sym"_cn, "BTC"_utf8)
+        .column("b"_cn, false)
+        .column("qty"_cn, static_cast<int64_t>(-1))
+        .column("price"_cn, 0.5)
+        .column("note"_cn, ""_utf8)
+        .column("ts"_cn, questdb::ingress::timestamp_micros{8})
+        .at_now();
+    CHECK(buffer.peek() == expected.peek());
+    CHECK(buffer.row_count() == 2);
+
+    buffer.table("trades"_tn);
+    CHECK_THROWS_AS(
+        trades.append_now("X"_utf8, true, 1, 1.0, ""_utf8,
+            questdb::ingress::timestamp_micros{1}),
+        questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("column_long256")
+{
+    std::array<uint8_t, 32> value{};
+    value[0] = 0x12;
+    value[31] = 0xaf;
+    questdb::ingress::line_sender_buffer buffer;
+    buffer
+        .table("test"_tn)
+        .column_long256("hash"_cn, value)
+        .at_now();
+    CHECK(buffer.peek() ==
+        "test hash=0x12000000000000000000000000000000"
+        "000000000000000000000000000000afi\n");
+}
+
 TEST_CASE("State machine testing -- flush without data.")
 {
     questdb::ingress::test::mock_server server;
@@ -858,4 +1773,102 @@ TEST_CASE("HTTP basics") {
     CHECK_THROWS_AS(
         questdb::ingress::opts::from_conf("http::addr=localhost:1;bind_interface=0.0.0.0;"),
         questdb::ingress::line_sender_error);    
-}
\ No newline at end of file
+}
+TEST_CASE("fast_clock")
+{
+    const int64_t before = questdb::ingress::timestamp_nanos::now().as_nanos();
+    questdb::ingress::fast_clock clock{questdb::ingress::clock_source::batch};
+    clock.set_strictly_increasing(true);
+    const int64_t first = clock.now().as_nanos();
+    CHECK(first >= before);
+    CHECK(clock.now().as_nanos() == first + 1);
+
+    questdb::ingress::line_sender_buffer buffer;
+    buffer.table("test").column("v", int64_t{1}).at_clock(clock);
+    CHECK(buffer.peek() == "test v=1i " + std::to_string(first + 2) + "\n");
+
+    questdb::ingress::fast_clock moved{std::move(clock)};
+    CHECK_THROWS_AS(clock.now(), questdb::ingress::line_sender_error);
+    moved.tick();
+    CHECK(moved.now().as_nanos() > first + 2);
+
+    questdb::ingress::fast_clock coarse{questdb::ingress::clock_source::coarse};
+    CHECK(coarse.now().as_nanos() > 0);
+}
+
+TEST_CASE("flush_stream")
+{
+    questdb::ingress::opts opts{
+        questdb::ingress::protocol::http, "localhost", 1};
+    opts.retry_timeout(0).stream_replay_window(1024);
+    questdb::ingress::line_sender sender{opts};
+
+    // The rows are serialized before the unreachable server is contacted.
+    size_t calls = 0;
+    CHECK_THROWS_AS(
+        sender.flush_stream(
+            true,
+            [&](questdb::ingress::line_sender_buffer& buffer) {
+                buffer.table("test").column("x", int64_t{1}).at_now();
+                return ++calls < 3;
+            }),
+        questdb::ingress::line_sender_error);
+    CHECK(calls >= 1);
+
+    // Exceptions thrown by the callback abort the request and propagate.
+    CHECK_THROWS_WITH_AS(
+        sender.flush_stream(
+            false,
+            [](questdb::ingress::line_sender_buffer&) -> bool {
+                throw std::runtime_error{"no more rows"};
+            }),
+        "no more rows",
+        std::runtime_error);
+
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::line_sender tcp_sender{
+        questdb::ingress::protocol::tcp,
+        std::string_view{"localhost"},
+        std::to_string(server.port())};
+    CHECK_THROWS_WITH_AS(
+        tcp_sender.flush_stream(
+            false,
+            [](questdb::ingress::line_sender_buffer&) { return false; }),
+        "Streaming flushes are only supported for ILP over HTTP.",
+        questdb::ingress::line_sender_error);
+}
+
+TEST_CASE("buffer_pool encoding")
+{
+    questdb::ingress::buffer_pool defaults{1024, 1};
+    CHECK(
+        defaults.acquire().timestamp_precision() ==
+        questdb::ingress::timestamp_precision::nanos);
+
+    questdb::ingress::test::mock_server server;
+    questdb::ingress::opts opts{
+        questdb::ingress::protocol::tcp,
+        "localhost",
+        server.port()};
+    opts.timestamp_precision(questdb::ingress::timestamp_precision::micros);
+    questdb::ingress::line_sender sender{opts};
+    server.accept();
+
+    questdb::ingress::buffer_pool buffers{sender, 1024, 1};
+    questdb::ingress::line_sender_buffer foreign;
+    buffers.release(std::move(foreign));
+    for (size_t index = 0; index < 2; ++index)
+    {
+        auto buffer = buffers.acquire();
+        CHECK(
+            buffer.timestamp_precision() ==
+            questdb::ingress::timestamp_precision::micros);
+        buffer.table("test"_tn)
+            .symbol("t1"_cn, "v1"_utf8)
+            .at(questdb::ingress::timestamp_micros{1700000000000001});
+        sender.flush(buffer);
+        buffers.release(std::move(buffer));
+    }
+    CHECK(server.recv() == 2);
+    CHECK(server.msgs().front() == "test,t1=v1 1700000000000001\n");
+}
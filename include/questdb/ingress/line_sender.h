@@ -78,6 +78,9 @@ typedef enum line_sender_error_code
 
     /** Bad configuration. */
     line_sender_error_config_error,
+
+    /** The buffer has no room left within its fixed capacity. */
+    line_sender_error_buffer_full,
 } line_sender_error_code;
 
 /** The protocol used to connect with. */
@@ -111,6 +114,83 @@ typedef enum line_sender_ca {
     line_sender_ca_pem_file,
 } line_sender_ca;
 
+/** Compression of the body of ILP-over-HTTP requests. */
+typedef enum line_sender_compression {
+    /** Send the ILP text uncompressed. */
+    line_sender_compression_none,
+
+    /** Compress with gzip, sent as `Content-Encoding: gzip`. */
+    line_sender_compression_gzip,
+
+    /** Compress with Zstandard, sent as `Content-Encoding: zstd`. */
+    line_sender_compression_zstd,
+} line_sender_compression;
+
+/** How an ILP/TCP sender writes to its socket. */
+typedef enum line_sender_io_backend {
+    /** Plain blocking `send` calls. */
+    line_sender_io_backend_std,
+
+    /** Submit the writes through an io_uring. Linux only. */
+    line_sender_io_backend_uring,
+} line_sender_io_backend;
+
+/** Where a `line_sender_clock` reads the time from. */
+typedef enum line_sender_clock_source {
+    /** The system's wall clock, as per `line_sender_now_nanos()`. */
+    line_sender_clock_source_system,
+
+    /**
+     * `CLOCK_REALTIME_COARSE` on Linux, with a resolution of one scheduler
+     * tick. Elsewhere, the same as `line_sender_clock_source_system`.
+     */
+    line_sender_clock_source_coarse,
+
+    /** The monotonic clock, periodically resynced with the wall clock. */
+    line_sender_clock_source_calibrated,
+
+    /**
+     * A timestamp captured on creation and on each `line_sender_clock_tick()`.
+     */
+    line_sender_clock_source_batch,
+} line_sender_clock_source;
+
+/** How the interval between the retries of a failed request grows. */
+typedef enum line_sender_retry_backoff {
+    /** Double the interval after each attempt, with a small jitter. */
+    line_sender_retry_backoff_exponential,
+
+    /** Wait a random interval, up to the doubling interval. */
+    line_sender_retry_backoff_full_jitter,
+
+    /** Wait a random interval, up to three times the previous one. */
+    line_sender_retry_backoff_decorrelated,
+} line_sender_retry_backoff;
+
+/** Version of the line protocol a buffer is encoded with. */
+typedef enum line_sender_protocol_version {
+    /** All values are written as text. Accepted by every QuestDB server. */
+    line_sender_protocol_version_1 = 1,
+
+    /** `f64` column values are written in binary. */
+    line_sender_protocol_version_2 = 2,
+} line_sender_protocol_version;
+
+/** The unit the designated timestamp of each row is written in. */
+typedef enum line_sender_timestamp_precision {
+    /** Nanoseconds. */
+    line_sender_timestamp_precision_nanos,
+
+    /** Microseconds. */
+    line_sender_timestamp_precision_micros,
+
+    /** Milliseconds. */
+    line_sender_timestamp_precision_millis,
+
+    /** Seconds. */
+    line_sender_timestamp_precision_seconds,
+} line_sender_timestamp_precision;
+
 /** Error code categorizing the error. */
 LINESENDER_API
 line_sender_error_code line_sender_error_get_code(const line_sender_error*);
@@ -123,6 +203,14 @@ line_sender_error_code line_sender_error_get_code(const line_sender_error*);
 LINESENDER_API
 const char* line_sender_error_msg(const line_sender_error*, size_t* len_out);
 
+/**
+ * The index of the row the server rejected, counting from 0 at the start of
+ * the flushed buffer, if the server reported it. Returns false otherwise.
+ * Drop it with `line_sender_buffer_drop_rows` and flush the rest again.
+ */
+LINESENDER_API
+bool line_sender_error_failed_row(const line_sender_error*, size_t* row_out);
+
 /** Clean up the error. */
 LINESENDER_API
 void line_sender_error_free(line_sender_error*);
@@ -261,6 +349,45 @@ line_sender_column_name line_sender_column_name_assert(
 #define QDB_COLUMN_NAME_LITERAL(literal)                                       \
     line_sender_column_name_assert(sizeof(literal) - 1, (literal))
 
+/**
+ * A column name, validated and escaped once ahead of time.
+ * Use it with the `line_sender_buffer_*_prepared()` functions to avoid
+ * re-escaping the same name on every row.
+ */
+typedef struct line_sender_prepared_column_name line_sender_prepared_column_name;
+
+/**
+ * Prepare a column name for repeated use.
+ * The returned object must be released with
+ * `line_sender_prepared_column_name_free()`.
+ *
+ * @param[in] name Validated column name. The object does not borrow it.
+ */
+LINESENDER_API
+line_sender_prepared_column_name* line_sender_prepared_column_name_new(
+    line_sender_column_name name);
+
+/** Release the prepared column name object. */
+LINESENDER_API
+void line_sender_prepared_column_name_free(
+    line_sender_prepared_column_name* name);
+
+/**
+ * Format the floating-point values recorded for this name rounded to a fixed
+ * number of decimals, at most 15, as `line_sender_buffer_column_f64_fixed()`
+ * does.
+ *
+ * @param[in] name Prepared column name.
+ * @param[in] decimals Number of decimals.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_prepared_column_name_set_decimals(
+    line_sender_prepared_column_name* name,
+    uint8_t decimals,
+    line_sender_error** err_out);
+
 
 /////////// Constructing ILP messages.
 
@@ -287,6 +414,55 @@ line_sender_buffer* line_sender_buffer_new();
 LINESENDER_API
 line_sender_buffer* line_sender_buffer_with_max_name_len(size_t max_name_len);
 
+/**
+ * Construct a `line_sender_buffer` that allocates `capacity` bytes up front
+ * and then never reallocates.
+ *
+ * Any call that could take the buffer past `capacity` bytes fails with
+ * `line_sender_error_buffer_full` instead, leaving the buffer unchanged.
+ * The check is against an upper bound of the encoded size that assumes every
+ * character of a name or string needs escaping.
+ *
+ * Since `line_sender_buffer_clear()` retains the capacity, a buffer reused
+ * across flushes never touches the allocator after construction. The
+ * exception is `line_sender_buffer_append_columns()`, which allocates scratch
+ * space per call.
+ *
+ * @param[in] max_name_len As per `line_sender_buffer_with_max_name_len()`.
+ * @param[in] capacity The capacity of the buffer, in bytes.
+ */
+LINESENDER_API
+line_sender_buffer* line_sender_buffer_with_fixed_capacity(
+    size_t max_name_len,
+    size_t capacity);
+
+/**
+ * Construct a trusted `line_sender_buffer` with a `max_name_len` of `127`.
+ * See `line_sender_buffer_set_trusted()`.
+ */
+LINESENDER_API
+line_sender_buffer* line_sender_buffer_new_trusted();
+
+/**
+ * Trust the caller to follow the API's contract, for code-generated producers
+ * with fixed schemas.
+ *
+ * In release builds, a trusted buffer no longer checks that calls come in
+ * order (table, symbols, columns, then `at`) or that names are within
+ * `max_name_len`. Breaking either rule results in rows the server rejects,
+ * but never in undefined behaviour. Debug builds of the library still assert
+ * both rules and abort if broken.
+ *
+ * Names and strings are validated as usual by `line_sender_utf8_init()` and
+ * friends: To skip that too, initialize their structs directly.
+ */
+LINESENDER_API
+void line_sender_buffer_set_trusted(line_sender_buffer* buffer, bool trusted);
+
+/** Whether the buffer is trusted, as per `line_sender_buffer_set_trusted()`. */
+LINESENDER_API
+bool line_sender_buffer_is_trusted(const line_sender_buffer* buffer);
+
 /** Release the `line_sender_buffer` object. */
 LINESENDER_API
 void line_sender_buffer_free(line_sender_buffer* buffer);
@@ -336,6 +512,77 @@ LINESENDER_API
 void line_sender_buffer_clear_marker(
     line_sender_buffer* buffer);
 
+/**
+ * The offset at which row number `row` starts, counting from 0. For `row`
+ * equal to the row count, the offset just past the last complete row.
+ * Returns false past that.
+ */
+LINESENDER_API
+bool line_sender_buffer_row_offset(
+    const line_sender_buffer* buffer,
+    size_t row,
+    size_t* offset_out);
+
+/**
+ * Remove the complete rows from `start` (inclusive) to `end` (exclusive),
+ * moving the rows after them down, e.g. to drop the row a flush failed on
+ * and flush the rest again. The marker, if any, is cleared.
+ */
+LINESENDER_API
+bool line_sender_buffer_drop_rows(
+    line_sender_buffer* buffer,
+    size_t start,
+    size_t end,
+    line_sender_error** err_out);
+
+/**
+ * Split the buffer at row number `row`, keeping the rows before it and
+ * returning a new buffer, with the same settings, holding it and the rows
+ * after it. Returns NULL on error.
+ */
+LINESENDER_API
+line_sender_buffer* line_sender_buffer_split_at_row(
+    line_sender_buffer* buffer,
+    size_t row,
+    line_sender_error** err_out);
+
+/**
+ * Append the complete rows of `other` to the end of `buffer`, leaving `other`
+ * untouched. The merged buffer is only transactional if both were and they
+ * target the same table.
+ *
+ * Both buffers must be at a row boundary and use the same protocol version,
+ * and `other` must not be partially sent.
+ */
+LINESENDER_API
+bool line_sender_buffer_append_buffer(
+    line_sender_buffer* buffer,
+    const line_sender_buffer* other,
+    line_sender_error** err_out);
+
+/**
+ * Append rows already serialized as ILP, without parsing them back into
+ * tables and columns. `buf` must hold whole rows, each terminated by a
+ * newline, in the buffer's protocol version.
+ *
+ * The row count and the transactional flag are kept accurate. With
+ * `validate`, each row must also start with a table name and be valid UTF-8.
+ * The buffer must be at a row boundary. On error, nothing is appended.
+ * @param[in] buffer Line buffer object.
+ * @param[in] buf Pointer to the ILP bytes.
+ * @param[in] len Number of bytes.
+ * @param[in] validate Check each row's table name and UTF-8.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_append_raw_ilp(
+    line_sender_buffer* buffer,
+    const uint8_t* buf,
+    size_t len,
+    bool validate,
+    line_sender_error** err_out);
+
 /**
  * Remove all accumulated data and prepare the buffer for new lines.
  * This does not affect the buffer's capacity.
@@ -351,6 +598,14 @@ size_t line_sender_buffer_size(const line_sender_buffer* buffer);
 LINESENDER_API
 size_t line_sender_buffer_row_count(const line_sender_buffer* buffer);
 
+/**
+ * The number of leading bytes already sent by a `line_sender_try_flush` or
+ * `line_sender_flush_chunked` call that hasn't completed yet. Zero if no
+ * flush is in progress.
+ */
+LINESENDER_API
+size_t line_sender_buffer_send_offset(const line_sender_buffer* buffer);
+
 /**
  * Tell whether the buffer is transactional. It is transactional iff it contains
  * data for at most one table. Additionally, you must send the buffer over HTTP to
@@ -359,14 +614,50 @@ size_t line_sender_buffer_row_count(const line_sender_buffer* buffer);
 LINESENDER_API
 bool line_sender_buffer_transactional(const line_sender_buffer* buffer);
 
+/** The line protocol version the buffer is encoded with. */
+LINESENDER_API
+line_sender_protocol_version line_sender_buffer_protocol_version(
+    const line_sender_buffer* buffer);
+
+/**
+ * Set the line protocol version to encode the buffer with.
+ * The default is `line_sender_protocol_version_1`.
+ * `line_sender_new_buffer()` creates a buffer with the sender's version
+ * already set. The buffer must be empty.
+ */
+LINESENDER_API
+bool line_sender_buffer_set_protocol_version(
+    line_sender_buffer* buffer,
+    line_sender_protocol_version version,
+    line_sender_error** err_out);
+
+/** The unit the buffer writes designated timestamps in. */
+LINESENDER_API
+line_sender_timestamp_precision line_sender_buffer_timestamp_precision(
+    const line_sender_buffer* buffer);
+
+/**
+ * Set the unit to write designated timestamps in.
+ * The default is `line_sender_timestamp_precision_nanos`.
+ * `line_sender_new_buffer()` creates a buffer with the sender's precision
+ * already set. A timestamp in the same unit is written as is, finer ones are
+ * rounded down. The buffer must be empty.
+ */
+LINESENDER_API
+bool line_sender_buffer_set_timestamp_precision(
+    line_sender_buffer* buffer,
+    line_sender_timestamp_precision precision,
+    line_sender_error** err_out);
+
 /**
  * Get a string representation of the contents of the buffer.
  *
  * @param[in] buffer Line sender buffer object.
  * @param[out] len_out The length in bytes of the returned string buffer.
  * @return UTF-8 encoded buffer with the string representation of the line
- *         sender buffer's contents. The buffer is not nul-terminated, and the
- *         length is in the `len_out` parameter.
+ *         sender buffer's contents, unless it holds binary values written with
+ *         `line_sender_protocol_version_2`. The buffer is not nul-terminated,
+ *         and the length is in the `len_out` parameter.
  */
 LINESENDER_API
 const char* line_sender_buffer_peek(
@@ -445,6 +736,30 @@ bool line_sender_buffer_column_f64(
     double value,
     line_sender_error** err_out);
 
+/**
+ * Record a floating-point value for the given column, rounded to a fixed
+ * number of decimals, at most 15.
+ *
+ * Faster than `line_sender_buffer_column_f64()` for values of a known
+ * precision, such as prices, and drops the noise digits. Falls back to
+ * `line_sender_buffer_column_f64()` for values too large to round exactly
+ * and with protocol version 2, whose binary format is exact.
+ *
+ * @param[in] buffer Line buffer object.
+ * @param[in] name Column name.
+ * @param[in] value Column value.
+ * @param[in] decimals Number of decimals.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_column_f64_fixed(
+    line_sender_buffer* buffer,
+    line_sender_column_name name,
+    double value,
+    uint8_t decimals,
+    line_sender_error** err_out);
+
 /**
  * Record a string value for the given column.
  * @param[in] buffer Line buffer object.
@@ -490,6 +805,128 @@ bool line_sender_buffer_column_ts_micros(
     int64_t micros,
     line_sender_error** err_out);
 
+/**
+ * Record a long256 value for the given column.
+ * @param[in] buffer Line buffer object.
+ * @param[in] name Column name.
+ * @param[in] value Pointer to the 32 bytes of the value, most significant
+ *            byte first.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_column_long256(
+    line_sender_buffer* buffer,
+    line_sender_column_name name,
+    const uint8_t* value,
+    line_sender_error** err_out);
+
+/**
+ * Record a symbol for the given prepared column name.
+ * See `line_sender_buffer_symbol()`.
+ * @param[in] buffer Line buffer object.
+ * @param[in] name Prepared column name.
+ * @param[in] value Column value.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_symbol_prepared(
+    line_sender_buffer* buffer,
+    const line_sender_prepared_column_name* name,
+    line_sender_utf8 value,
+    line_sender_error** err_out);
+
+/**
+ * Record a boolean value for the given prepared column name.
+ * @param[in] buffer Line buffer object.
+ * @param[in] name Prepared column name.
+ * @param[in] value Column value.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_column_bool_prepared(
+    line_sender_buffer* buffer,
+    const line_sender_prepared_column_name* name,
+    bool value,
+    line_sender_error** err_out);
+
+/**
+ * Record an integer value for the given prepared column name.
+ * @param[in] buffer Line buffer object.
+ * @param[in] name Prepared column name.
+ * @param[in] value Column value.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_column_i64_prepared(
+    line_sender_buffer* buffer,
+    const line_sender_prepared_column_name* name,
+    int64_t value,
+    line_sender_error** err_out);
+
+/**
+ * Record a floating-point value for the given prepared column name.
+ * @param[in] buffer Line buffer object.
+ * @param[in] name Prepared column name.
+ * @param[in] value Column value.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_column_f64_prepared(
+    line_sender_buffer* buffer,
+    const line_sender_prepared_column_name* name,
+    double value,
+    line_sender_error** err_out);
+
+/**
+ * Record a string value for the given prepared column name.
+ * @param[in] buffer Line buffer object.
+ * @param[in] name Prepared column name.
+ * @param[in] value Column value.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_column_str_prepared(
+    line_sender_buffer* buffer,
+    const line_sender_prepared_column_name* name,
+    line_sender_utf8 value,
+    line_sender_error** err_out);
+
+/**
+ * Record a nanosecond timestamp value for the given prepared column name.
+ * @param[in] buffer Line buffer object.
+ * @param[in] name Prepared column name.
+ * @param[in] nanos The timestamp in nanoseconds since the Unix epoch.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_column_ts_nanos_prepared(
+    line_sender_buffer* buffer,
+    const line_sender_prepared_column_name* name,
+    int64_t nanos,
+    line_sender_error** err_out);
+
+/**
+ * Record a microsecond timestamp value for the given prepared column name.
+ * @param[in] buffer Line buffer object.
+ * @param[in] name Prepared column name.
+ * @param[in] micros The timestamp in microseconds since the Unix epoch.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_column_ts_micros_prepared(
+    line_sender_buffer* buffer,
+    const line_sender_prepared_column_name* name,
+    int64_t micros,
+    line_sender_error** err_out);
+
 /**
  * Complete the current row with the designated timestamp in nanoseconds.
  *
@@ -532,6 +969,28 @@ bool line_sender_buffer_at_micros(
     int64_t epoch_micros,
     line_sender_error** err_out);
 
+/**
+ * Complete the current row with the designated timestamp, like
+ * `line_sender_buffer_at_nanos()`, but format it faster when consecutive rows
+ * have close timestamps.
+ *
+ * The buffer remembers the leading digits of the last timestamp passed to this
+ * function. When the next timestamp only differs in its last 8 digits, as is
+ * the case for most timestamps less than 100ms apart, only those are
+ * formatted. The rows are identical to the ones `line_sender_buffer_at_nanos()`
+ * writes.
+ *
+ * @param[in] buffer Line buffer object.
+ * @param[in] epoch_nanos Number of nanoseconds since the Unix epoch.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_at_delta_nanos(
+    line_sender_buffer *buffer,
+    int64_t epoch_nanos,
+    line_sender_error** err_out);
+
 /**
  * Complete the current row without providing a timestamp. The QuestDB instance
  * will insert its own timestamp.
@@ -561,24 +1020,303 @@ bool line_sender_buffer_at_now(
     line_sender_buffer* buffer,
     line_sender_error** err_out);
 
-/////////// Connecting, sending and disconnecting.
+/** A cheap source of timestamps. See `line_sender_clock_new`. */
+typedef struct line_sender_clock line_sender_clock;
 
 /**
- * Inserts data into QuestDB via the InfluxDB Line Protocol.
+ * Complete the current row with the current time of `clock` as the
+ * designated timestamp. Cheaper than passing `line_sender_now_nanos()` to
+ * `line_sender_buffer_at_nanos()`.
  *
- * Batch up rows in a `line_sender_buffer`, then call `line_sender_flush()` or
- * one of its variants with this object to send them.
+ * @param[in] buffer Line buffer object.
+ * @param[in] clock Clock object.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
  */
-typedef struct line_sender line_sender;
+LINESENDER_API
+bool line_sender_buffer_at_clock(
+    line_sender_buffer* buffer,
+    const line_sender_clock* clock,
+    line_sender_error** err_out);
+
+/** Type of the values of a `line_sender_column_slice`. */
+typedef enum line_sender_column_type
+{
+    /** `line_sender_utf8` values, serialized as symbols. */
+    line_sender_column_type_symbol,
+
+    /** `bool` values. */
+    line_sender_column_type_bool,
+
+    /** `int64_t` values. */
+    line_sender_column_type_i64,
+
+    /** `double` values. */
+    line_sender_column_type_f64,
+
+    /** `line_sender_utf8` values, serialized as strings. */
+    line_sender_column_type_str,
+
+    /** `int64_t` timestamps in microseconds since the Unix epoch. */
+    line_sender_column_type_ts_micros,
+} line_sender_column_type;
 
 /**
- * Accumulates parameters for a new `line_sender` object.
+ * The values of one column across a batch of rows.
+ * See `line_sender_buffer_append_columns`.
  */
-typedef struct line_sender_opts line_sender_opts;
+typedef struct line_sender_column_slice
+{
+    /** Column name. */
+    line_sender_column_name name;
+
+    /** Type of the elements pointed to by `data`. */
+    line_sender_column_type column_type;
+
+    /** Pointer to the first of `row_count` contiguous values. */
+    const void* data;
+} line_sender_column_slice;
 
 /**
- * Create a new `line_sender_opts` instance from the given configuration string.
- * The format of the string is: "tcp::addr=host:port;key=value;...;"
+ * Append a batch of rows for the given table, supplied column by column.
+ *
+ * Each of the `column_count` columns points to `row_count` contiguous values.
+ * Symbol columns are written before the other columns, regardless of their
+ * position in `columns`. The `line_sender_utf8` values of symbol and string
+ * columns are validated here, so they need not be initialized via
+ * `line_sender_utf8_init`.
+ *
+ * The names, values and timestamps are validated for the whole batch before
+ * any row is written: If validation fails, the buffer is left unchanged.
+ *
+ * @param[in] buffer Line buffer object.
+ * @param[in] name Table name.
+ * @param[in] row_count Number of rows in the batch.
+ * @param[in] columns Array of `column_count` columns.
+ * @param[in] column_count Number of columns. Must be at least one.
+ * @param[in] timestamps_nanos Array of `row_count` designated timestamps in
+ *            nanoseconds since the Unix epoch, or NULL to let the server assign
+ *            them.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_append_columns(
+    line_sender_buffer* buffer,
+    line_sender_table_name name,
+    size_t row_count,
+    const line_sender_column_slice* columns,
+    size_t column_count,
+    const int64_t* timestamps_nanos,
+    line_sender_error** err_out);
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+/*
+ * The Arrow C data interface, as specified at
+ * https://arrow.apache.org/docs/format/CDataInterface.html
+ * Skipped if already defined by the Arrow headers.
+ */
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema
+{
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray
+{
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+#endif /* ARROW_C_DATA_INTERFACE */
+
+/**
+ * Append the rows of an Arrow record batch for the given table, reading the
+ * column buffers in place.
+ *
+ * `schema` and `array` describe a struct array in the Arrow C data interface,
+ * as exported for a record batch by the Arrow libraries. Each field is written
+ * as a column of the same name:
+ *
+ * - `bool` as a boolean column.
+ * - Signed integers and unsigned integers up to 32 bits as `i64` columns.
+ * - `float` and `double` as `f64` columns.
+ * - `utf8` and `large_utf8` as string columns, or as symbols if named in
+ *   `symbol_columns`.
+ * - Dictionary-encoded strings as symbols.
+ * - Timestamps of any unit as timestamp columns.
+ *
+ * Null cells are left out of their row, which QuestDB stores as NULL.
+ *
+ * The structs are only read: Releasing them remains up to the caller.
+ * If any field or row fails validation, the buffer is left unchanged.
+ *
+ * @param[in] buffer Line buffer object.
+ * @param[in] name Table name.
+ * @param[in] schema Schema of the record batch.
+ * @param[in] array Record batch.
+ * @param[in] timestamp_column Timestamp field holding the designated
+ *            timestamps, or NULL to let the server assign them.
+ * @param[in] symbol_columns Array of `symbol_column_count` string fields to
+ *            write as symbols.
+ * @param[in] symbol_column_count Number of symbol columns.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_append_arrow(
+    line_sender_buffer* buffer,
+    line_sender_table_name name,
+    const struct ArrowSchema* schema,
+    const struct ArrowArray* array,
+    const line_sender_column_name* timestamp_column,
+    const line_sender_column_name* symbol_columns,
+    size_t symbol_column_count,
+    line_sender_error** err_out);
+
+/**
+ * A fixed table name and column layout, validated and escaped once.
+ * See `line_sender_buffer_append_row_at_nanos()`.
+ */
+typedef struct line_sender_row_template line_sender_row_template;
+
+/**
+ * Create a row template.
+ *
+ * Symbol columns must precede all other column types.
+ *
+ * @param[in] table Table name.
+ * @param[in] column_count Number of columns. Must be at least one.
+ * @param[in] names Array of `column_count` column names.
+ * @param[in] types Array of `column_count` column types.
+ * @param[out] err_out Set on error.
+ * @return The new template, or NULL on error.
+ *         Release it with `line_sender_row_template_free()`.
+ */
+LINESENDER_API
+line_sender_row_template* line_sender_row_template_new(
+    line_sender_table_name table,
+    size_t column_count,
+    const line_sender_column_name* names,
+    const line_sender_column_type* types,
+    line_sender_error** err_out);
+
+/** Release the row template object. */
+LINESENDER_API
+void line_sender_row_template_free(line_sender_row_template* template_);
+
+/**
+ * A single field value of a row appended via a `line_sender_row_template`.
+ * The member to set is determined by the template's column type.
+ */
+typedef union line_sender_row_value
+{
+    /**
+     * For `line_sender_column_type_symbol` and `line_sender_column_type_str`.
+     * Must be initialized via `line_sender_utf8_init()`.
+     */
+    line_sender_utf8 utf8;
+
+    /** For `line_sender_column_type_bool`. */
+    bool boolean;
+
+    /**
+     * For `line_sender_column_type_i64` and
+     * `line_sender_column_type_ts_micros`.
+     */
+    int64_t i64;
+
+    /** For `line_sender_column_type_f64`. */
+    double f64;
+} line_sender_row_value;
+
+/**
+ * Append a complete row laid out as per the `template_`, with the designated
+ * timestamp in nanoseconds.
+ *
+ * Unlike the `line_sender_buffer_symbol()` and `line_sender_buffer_column_*()`
+ * functions, this skips the per-field validation of names and call order.
+ * If it fails, the buffer is left unchanged.
+ *
+ * @param[in] buffer Line buffer object.
+ * @param[in] template_ Row template.
+ * @param[in] values Array of `value_count` field values, one per template
+ *            column.
+ * @param[in] value_count Number of values.
+ * @param[in] epoch_nanos Number of nanoseconds since 1st Jan 1970 UTC.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_append_row_at_nanos(
+    line_sender_buffer* buffer,
+    const line_sender_row_template* template_,
+    const line_sender_row_value* values,
+    size_t value_count,
+    int64_t epoch_nanos,
+    line_sender_error** err_out);
+
+/**
+ * Append a complete row laid out as per the `template_`, letting the server
+ * assign the timestamp.
+ * See `line_sender_buffer_append_row_at_nanos()`.
+ *
+ * @param[in] buffer Line buffer object.
+ * @param[in] template_ Row template.
+ * @param[in] values Array of `value_count` field values, one per template
+ *            column.
+ * @param[in] value_count Number of values.
+ * @param[out] err_out Set on error.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_buffer_append_row_at_now(
+    line_sender_buffer* buffer,
+    const line_sender_row_template* template_,
+    const line_sender_row_value* values,
+    size_t value_count,
+    line_sender_error** err_out);
+
+/////////// Connecting, sending and disconnecting.
+
+/**
+ * Inserts data into QuestDB via the InfluxDB Line Protocol.
+ *
+ * Batch up rows in a `line_sender_buffer`, then call `line_sender_flush()` or
+ * one of its variants with this object to send them.
+ */
+typedef struct line_sender line_sender;
+
+/**
+ * Accumulates parameters for a new `line_sender` object.
+ */
+typedef struct line_sender_opts line_sender_opts;
+
+/**
+ * Create a new `line_sender_opts` instance from the given configuration string.
+ * The format of the string is: "tcp::addr=host:port;key=value;...;"
  * Instead of "tcp" you can also specify "tcps", "http", and "https".
  *
  * The accepted keys match one-for-one with the functions on `line_sender_opts`.
@@ -628,6 +1366,20 @@ line_sender_opts* line_sender_opts_new_service(
     line_sender_utf8 host,
     line_sender_utf8 port);
 
+/**
+ * Add a host to fail over to when the ones before it can't be reached.
+ * Hosts are tried in the order they were added, after the one passed to
+ * `line_sender_opts_new()`.
+ * @param[in] host The QuestDB database host.
+ * @param[in] port The QuestDB port.
+ */
+LINESENDER_API
+bool line_sender_opts_failover_addr(
+    line_sender_opts* opts,
+    line_sender_utf8 host,
+    uint16_t port,
+    line_sender_error** err_out);
+
 /**
  * Select local outbound network "bind" interface.
  *
@@ -705,6 +1457,76 @@ bool line_sender_opts_auth_timeout(
     uint64_t millis,
     line_sender_error** err_out);
 
+/**
+ * Reconnect automatically in the background after an ILP/TCP write error.
+ *
+ * A flush waits for the new connection for at most this many milliseconds,
+ * then replays the last `line_sender_opts_replay_buffers()` buffers and
+ * resends its own. If the wait times out, the flush fails but the sender stays
+ * usable: `line_sender_must_close()` keeps returning `false`.
+ *
+ * A value of 0 disables reconnecting, which is the default. TCP only.
+ */
+LINESENDER_API
+bool line_sender_opts_reconnect_timeout(
+    line_sender_opts* opts,
+    uint64_t millis,
+    line_sender_error** err_out);
+
+/**
+ * The number of most recently flushed buffers to keep a copy of and replay
+ * after reconnecting, for at-least-once delivery: Rows may be duplicated, but
+ * not lost once they fit in this many buffers. The default is 0. TCP only.
+ */
+LINESENDER_API
+bool line_sender_opts_replay_buffers(
+    line_sender_opts* opts,
+    size_t count,
+    line_sender_error** err_out);
+
+/**
+ * How the sender writes to its socket. The default is
+ * `line_sender_io_backend_std`.
+ *
+ * `line_sender_io_backend_uring` submits each write through an io_uring.
+ * It requires Linux, and a library built with the `io-uring` feature.
+ * Non-blocking mode isn't supported with it. TCP only.
+ */
+LINESENDER_API
+bool line_sender_opts_io_backend(
+    line_sender_opts* opts,
+    line_sender_io_backend backend,
+    line_sender_error** err_out);
+
+/**
+ * Have a kernel thread poll the io_uring for submissions, so that writes don't
+ * need a syscall, and busy-poll for their completions. This trades a CPU core
+ * for latency. The default is `false`.
+ */
+LINESENDER_API
+bool line_sender_opts_uring_sqpoll(
+    line_sender_opts* opts,
+    bool sqpoll,
+    line_sender_error** err_out);
+
+/** Pin the io_uring's SQPOLL kernel thread to a CPU. */
+LINESENDER_API
+bool line_sender_opts_uring_sqpoll_cpu(
+    line_sender_opts* opts,
+    uint32_t cpu,
+    line_sender_error** err_out);
+
+/**
+ * Send writes of at least this many bytes through the io_uring without
+ * copying them into the kernel. A value of 0 always copies.
+ * The default is 64 KiB.
+ */
+LINESENDER_API
+bool line_sender_opts_uring_zc_threshold(
+    line_sender_opts* opts,
+    size_t threshold,
+    line_sender_error** err_out);
+
 /**
  * Set to `false` to disable TLS certificate verification.
  * This should only be used for debugging purposes as it reduces security.
@@ -751,6 +1573,124 @@ bool line_sender_opts_max_buf_size(
     size_t max_buf_size,
     line_sender_error** err_out);
 
+/**
+ * Enable or disable the auto-flush thresholds checked by
+ * `line_sender_should_flush()`. The default is enabled.
+ */
+LINESENDER_API
+bool line_sender_opts_auto_flush(
+    line_sender_opts* opts,
+    bool enabled,
+    line_sender_error** err_out);
+
+/**
+ * Set the number of rows after which a buffer is due to be flushed.
+ * A value of 0 disables the row threshold.
+ * The default is 75000 rows for HTTP and 600 rows for TCP.
+ */
+LINESENDER_API
+bool line_sender_opts_auto_flush_rows(
+    line_sender_opts* opts,
+    size_t rows,
+    line_sender_error** err_out);
+
+/**
+ * Set the number of bytes after which a buffer is due to be flushed.
+ * A value of 0 disables the byte threshold, which is the default.
+ */
+LINESENDER_API
+bool line_sender_opts_auto_flush_bytes(
+    line_sender_opts* opts,
+    size_t bytes,
+    line_sender_error** err_out);
+
+/**
+ * Set the time since the previous flush after which a buffer is due to be
+ * flushed. The value is in milliseconds, and the default is 1 second.
+ * A value of 0 disables the time threshold.
+ */
+LINESENDER_API
+bool line_sender_opts_auto_flush_interval(
+    line_sender_opts* opts,
+    uint64_t millis,
+    line_sender_error** err_out);
+
+/**
+ * Compress the body of each HTTP request.
+ * The default is `line_sender_compression_none`.
+ * The compression context is reused across flushes, and the
+ * `request_min_throughput` timeout is calculated from the compressed size.
+ */
+LINESENDER_API
+bool line_sender_opts_compression(
+    line_sender_opts* opts,
+    line_sender_compression compression,
+    line_sender_error** err_out);
+
+/**
+ * Cap the rate data is sent at, in bytes per second.
+ * A value of 0 disables the limit, which is the default.
+ * The senders of a `line_sender_pool` share the limit.
+ */
+LINESENDER_API
+bool line_sender_opts_max_send_rate(
+    line_sender_opts* opts,
+    uint64_t bytes_per_sec,
+    line_sender_error** err_out);
+
+/**
+ * Cap the rate rows are sent at, in rows per second.
+ * A value of 0 disables the limit, which is the default.
+ * The senders of a `line_sender_pool` share the limit.
+ */
+LINESENDER_API
+bool line_sender_opts_max_rows_rate(
+    line_sender_opts* opts,
+    uint64_t rows_per_sec,
+    line_sender_error** err_out);
+
+/**
+ * Set the number of connections opened by `line_sender_pool_build()`.
+ * The default is 1.
+ */
+LINESENDER_API
+bool line_sender_opts_pool_size(
+    line_sender_opts* opts,
+    size_t pool_size,
+    line_sender_error** err_out);
+
+/**
+ * Set the version of the line protocol to send.
+ * The default is `line_sender_protocol_version_1`.
+ */
+LINESENDER_API
+bool line_sender_opts_protocol_version(
+    line_sender_opts* opts,
+    line_sender_protocol_version version,
+    line_sender_error** err_out);
+
+/**
+ * Ask the server which version of the line protocol to send when the
+ * sender is built, falling back to `line_sender_protocol_version_1`.
+ * Only ILP/HTTP servers are asked: ILP/TCP senders use version 1.
+ */
+LINESENDER_API
+bool line_sender_opts_protocol_version_auto(
+    line_sender_opts* opts, line_sender_error** err_out);
+
+/**
+ * Set the unit to write designated timestamps in. The sender only flushes
+ * buffers of this precision: Create them with `line_sender_new_buffer()`.
+ * Over HTTP, it's sent as the `precision` of each request. Over TCP, it must
+ * match the server's `line.tcp.timestamp` setting.
+ * The default is `line_sender_timestamp_precision_nanos`.
+ */
+LINESENDER_API
+bool line_sender_opts_timestamp_precision(
+    line_sender_opts* opts,
+    line_sender_timestamp_precision precision,
+    line_sender_error** err_out);
+
 /**
  * Set the cumulative duration spent in retries.
  * The value is in milliseconds, and the default is 10 seconds.
@@ -790,59 +1730,164 @@ bool line_sender_opts_request_timeout(
     uint64_t millis,
     line_sender_error** err_out);
 
-// Do not call: Private API for the C++ and Python bindings.
-bool line_sender_opts_user_agent(
+/**
+ * Set how the interval between retries grows.
+ * The default is `line_sender_retry_backoff_exponential`.
+ */
+LINESENDER_API
+bool line_sender_opts_retry_backoff(
     line_sender_opts* opts,
-    line_sender_utf8 user_agent,
+    line_sender_retry_backoff backoff,
     line_sender_error** err_out);
 
 /**
- * Duplicate the `line_sender_opts` object.
- * Both old and new objects will have to be freed.
+ * Wait at least as long as the `Retry-After` header of a 503 or 529 response
+ * asks for before retrying. The default is `true`.
  */
 LINESENDER_API
-line_sender_opts* line_sender_opts_clone(
-    line_sender_opts* opts);
+bool line_sender_opts_retry_after(
+    line_sender_opts* opts,
+    bool enabled,
+    line_sender_error** err_out);
 
-/** Release the `line_sender_opts` object. */
+/**
+ * Limit the retries of all the senders in the process configured with the
+ * same value to this many per second. The default is 0, meaning no limit.
+ */
 LINESENDER_API
-void line_sender_opts_free(line_sender_opts* opts);
+bool line_sender_opts_retry_budget(
+    line_sender_opts* opts,
+    uint32_t retries_per_sec,
+    line_sender_error** err_out);
 
 /**
- * Create a new line sender instance from the given options object.
- *
- * In the case of TCP, this synchronously establishes the TCP connection, and
- * returns once the connection is fully established. If the connection
- * requires authentication or TLS, these will also be completed before
- * returning.
- *
- * The sender should be accessed by only a single thread a time.
- * @param[in] opts Options for the connection.
- * @note The opts object is freed.
+ * Fail flushes fast, without contacting the server, after this many
+ * consecutive requests failed with a 5xx error or a network error.
+ * The default is 0, which disables the circuit breaker.
  */
 LINESENDER_API
-line_sender* line_sender_build(
-    const line_sender_opts* opts,
+bool line_sender_opts_circuit_breaker_threshold(
+    line_sender_opts* opts,
+    uint32_t failures,
     line_sender_error** err_out);
 
 /**
- * Create a new line sender instance from the given configuration string.
- * The format of the string is: "tcp::addr=host:port;key=value;...;"
- * Instead of "tcp" you can also specify "tcps", "http", and "https".
- *
- * The accepted keys match one-for-one with the functions on `line_sender_opts`.
- * For example, this is a valid configuration string:
- *
- * "https::addr=host:port;username=alice;password=secret;"
- *
- * and there are matching functions `line_sender_opts_username()` and
- * `line_sender_opts_password()`. The value for `addr=` is supplied directly to
- * `line_sender_opts_new`, so there's no function with a matching name.
- *
- * For the full list of keys, search this header for `bool line_sender_opts_`.
- *
- * In the case of TCP, this synchronously establishes the TCP connection, and
- * returns once the connection is fully established. If the connection
+ * How long an open circuit breaker fails flushes fast before letting a
+ * request through again. The value is in milliseconds, and the default is
+ * 5 seconds.
+ */
+LINESENDER_API
+bool line_sender_opts_circuit_breaker_cooldown(
+    line_sender_opts* opts,
+    uint64_t millis,
+    line_sender_error** err_out);
+
+/**
+ * Open the connection when the sender is built, rather than on the first
+ * flush, and keep it open whilst the sender is idle by pinging the server
+ * every `ping_interval`. Building the sender fails if no host answers.
+ * The default is off.
+ */
+LINESENDER_API
+bool line_sender_opts_prewarm(
+    line_sender_opts* opts, bool enabled, line_sender_error** err_out);
+
+/**
+ * How long the connection may sit idle before a pre-warmed sender pings the
+ * server. The value is in milliseconds, and the default is 10 seconds.
+ * Pass 0 to only warm up the connection when the sender is built.
+ */
+LINESENDER_API
+bool line_sender_opts_ping_interval(
+    line_sender_opts* opts, uint64_t millis, line_sender_error** err_out);
+
+/**
+ * The most bytes of a `line_sender_flush_stream()` request kept in memory to
+ * resend it if an attempt fails. A longer stream isn't retried.
+ * The default is 16 MiB.
+ */
+LINESENDER_API
+bool line_sender_opts_stream_replay_window(
+    line_sender_opts* opts, size_t bytes, line_sender_error** err_out);
+
+/**
+ * Spool the flushes that still fail with a network error, or a retriable
+ * server error, once the `retry_timeout` is exhausted to segment files in the
+ * given directory, instead of returning the error. A background thread replays
+ * them in order once the server accepts them again. Until the spool is
+ * drained, new flushes are appended to it.
+ * The directory must not be shared with another sender.
+ */
+LINESENDER_API
+bool line_sender_opts_spool_dir(
+    line_sender_opts* opts,
+    line_sender_utf8 path,
+    line_sender_error** err_out);
+
+/**
+ * Set the maximum size of the files in the spool directory.
+ * Once the spool is full, flushes that can't be sent return an error again.
+ * The default is 1 GiB.
+ */
+LINESENDER_API
+bool line_sender_opts_spool_max_bytes(
+    line_sender_opts* opts,
+    uint64_t max_bytes,
+    line_sender_error** err_out);
+
+// Do not call: Private API for the C++ and Python bindings.
+bool line_sender_opts_user_agent(
+    line_sender_opts* opts,
+    line_sender_utf8 user_agent,
+    line_sender_error** err_out);
+
+/**
+ * Duplicate the `line_sender_opts` object.
+ * Both old and new objects will have to be freed.
+ */
+LINESENDER_API
+line_sender_opts* line_sender_opts_clone(
+    line_sender_opts* opts);
+
+/** Release the `line_sender_opts` object. */
+LINESENDER_API
+void line_sender_opts_free(line_sender_opts* opts);
+
+/**
+ * Create a new line sender instance from the given options object.
+ *
+ * In the case of TCP, this synchronously establishes the TCP connection, and
+ * returns once the connection is fully established. If the connection
+ * requires authentication or TLS, these will also be completed before
+ * returning.
+ *
+ * The sender should be accessed by only a single thread a time.
+ * @param[in] opts Options for the connection.
+ * @note The opts object is freed.
+ */
+LINESENDER_API
+line_sender* line_sender_build(
+    const line_sender_opts* opts,
+    line_sender_error** err_out);
+
+/**
+ * Create a new line sender instance from the given configuration string.
+ * The format of the string is: "tcp::addr=host:port;key=value;...;"
+ * Instead of "tcp" you can also specify "tcps", "http", and "https".
+ *
+ * The accepted keys match one-for-one with the functions on `line_sender_opts`.
+ * For example, this is a valid configuration string:
+ *
+ * "https::addr=host:port;username=alice;password=secret;"
+ *
+ * and there are matching functions `line_sender_opts_username()` and
+ * `line_sender_opts_password()`. The value for `addr=` is supplied directly to
+ * `line_sender_opts_new`, so there's no function with a matching name.
+ *
+ * For the full list of keys, search this header for `bool line_sender_opts_`.
+ *
+ * In the case of TCP, this synchronously establishes the TCP connection, and
+ * returns once the connection is fully established. If the connection
  * requires authentication or TLS, these will also be completed before
  * returning.
  *
@@ -870,7 +1915,8 @@ line_sender* line_sender_from_env(
 
 /**
  * Tell whether the sender is no longer usable and must be closed.
- * This happens when there was an earlier failure.
+ * This happens when there was an earlier failure, unless a reconnect timeout
+ * is set with `line_sender_opts_reconnect_timeout()`.
  * This fuction is specific to TCP and is not relevant for HTTP.
  * @param[in] sender Line sender object.
  * @return true if an error occurred with a sender and it must be closed.
@@ -878,6 +1924,37 @@ line_sender* line_sender_from_env(
 LINESENDER_API
 bool line_sender_must_close(const line_sender* sender);
 
+/**
+ * The version of the line protocol the sender was built with, or
+ * negotiated with the server.
+ */
+LINESENDER_API
+line_sender_protocol_version line_sender_get_protocol_version(
+    const line_sender* sender);
+
+/** The unit the sender expects designated timestamps in. */
+LINESENDER_API
+line_sender_timestamp_precision line_sender_get_timestamp_precision(
+    const line_sender* sender);
+
+/**
+ * Construct a `line_sender_buffer` encoded with the sender's protocol
+ * version and timestamp precision, and a `max_name_len` of `127`.
+ */
+LINESENDER_API
+line_sender_buffer* line_sender_new_buffer(const line_sender* sender);
+
+/**
+ * Open a connection to the server ahead of the next flush by sending a
+ * `GET /ping` request, replacing the pooled connection if it was dropped
+ * whilst idle. Fails over between the hosts listed in `addr`.
+ * This is a no-op for ILP/TCP.
+ * @param[in] sender Line sender object.
+ * @return true on success, false if no host could be reached.
+ */
+LINESENDER_API
+bool line_sender_warm_up(line_sender* sender, line_sender_error** err_out);
+
 /**
  * Close the connection. Does not flush. Non-idempotent.
  * @param[in] sender Line sender object.
@@ -885,6 +1962,23 @@ bool line_sender_must_close(const line_sender* sender);
 LINESENDER_API
 void line_sender_close(line_sender* sender);
 
+/**
+ * Tell whether the buffer has reached any of the sender's auto-flush
+ * thresholds (`auto_flush_rows`, `auto_flush_bytes` and `auto_flush_interval`)
+ * and should now be flushed.
+ *
+ * A buffer is only ever due after a call to `line_sender_buffer_at_nanos()`,
+ * `line_sender_buffer_at_micros()` or `line_sender_buffer_at_now()`, and is
+ * always due once it reaches `max_buf_size`.
+ * Always returns false if the sender was configured with `auto_flush=off`.
+ * @param[in] sender Line sender object.
+ * @param[in] buffer Line buffer object.
+ */
+LINESENDER_API
+bool line_sender_should_flush(
+    const line_sender* sender,
+    const line_sender_buffer* buffer);
+
 /**
  * Send the given buffer of rows to the QuestDB server, clearing the buffer.
  *
@@ -919,6 +2013,44 @@ bool line_sender_flush(
     line_sender_buffer* buffer,
     line_sender_error** err_out);
 
+/**
+ * Send the given buffer of rows to the QuestDB server, clearing the buffer,
+ * like `line_sender_flush`, but split it into as many back-to-back requests
+ * of at most `max_buf_size` bytes as needed, cut at row boundaries.
+ *
+ * The flush is never transactional. If a request fails, the rows already
+ * sent stay in the buffer, their size reported by
+ * `line_sender_buffer_send_offset`. Call this function again with the same
+ * buffer to resume from the first unsent row, or clear the buffer.
+ * @param[in] sender Line sender object.
+ * @param[in] buffer Line buffer object.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_flush_chunked(
+    line_sender* sender,
+    line_sender_buffer* buffer,
+    line_sender_error** err_out);
+
+/**
+ * Send a file of pre-serialized ILP rows, such as one written out from
+ * `line_sender_buffer_peek` while the server was unreachable.
+ *
+ * The file is memory-mapped and checked for complete rows, none longer than
+ * `max_buf_size`, before anything is sent. The rows are then sent in runs of
+ * up to `max_buf_size` bytes, each as a write or request of its own. Plain
+ * TCP connections on Linux use `sendfile(2)`. If a run fails, the runs
+ * before it have already been sent.
+ * @param[in] sender Line sender object.
+ * @param[in] path Path to the file.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_send_file(
+    line_sender* sender,
+    line_sender_utf8 path,
+    line_sender_error** err_out);
+
 /**
  * Send the given buffer of rows to the QuestDB server.
  *
@@ -936,6 +2068,269 @@ bool line_sender_flush_and_keep(
     const line_sender_buffer* buffer,
     line_sender_error** err_out);
 
+/////////// Non-blocking flushing over TCP.
+
+/** A raw socket: A file descriptor on POSIX systems, a `SOCKET` on Windows. */
+#if defined(_WIN32)
+typedef uintptr_t line_sender_socket;
+#else
+typedef int line_sender_socket;
+#endif
+
+/**
+ * Switch an ILP-over-TCP sender in or out of non-blocking mode.
+ *
+ * In non-blocking mode, send buffers with `line_sender_try_flush`, and
+ * register the socket from `line_sender_raw_socket` with your event loop.
+ * The blocking flush functions return an error in this mode.
+ *
+ * The connection is always established, authenticated and, if applicable,
+ * TLS-handshaked in blocking mode when the sender is created.
+ *
+ * @param[in] sender Line sender object.
+ * @param[in] nonblocking Whether to enable non-blocking mode.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_set_nonblocking(
+    line_sender* sender,
+    bool nonblocking,
+    line_sender_error** err_out);
+
+/**
+ * Send as much of the buffer as the socket accepts without blocking.
+ *
+ * Sets `*done_out` to true once the whole buffer is sent, at which point the
+ * buffer is cleared. Otherwise, sets it to false and records the progress in
+ * the buffer (see `line_sender_buffer_send_offset`): Call this function with
+ * the same buffer again once the socket is writable.
+ *
+ * Rows may be appended to the buffer between calls. Don't clear the buffer or
+ * rewind it past the rows already sent.
+ *
+ * With `max_send_rate` or `max_rows_rate` set, a call may send less than the
+ * socket would accept, or nothing. Wait for `line_sender_try_flush_delay_micros`
+ * before calling again, rather than polling.
+ *
+ * This function is specific to ILP-over-TCP.
+ *
+ * @param[in] sender Line sender object.
+ * @param[in] buffer Line buffer object.
+ * @param[out] done_out Whether the buffer was sent in full.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_try_flush(
+    line_sender* sender,
+    line_sender_buffer* buffer,
+    bool* done_out,
+    line_sender_error** err_out);
+
+/**
+ * How long, in microseconds rounded up, until `line_sender_try_flush` may
+ * send again under the `max_send_rate` and `max_rows_rate` limits.
+ * Zero without limits, or if it can send right away.
+ *
+ * @param[in] sender Line sender object.
+ */
+LINESENDER_API
+uint64_t line_sender_try_flush_delay_micros(const line_sender* sender);
+
+/**
+ * Get the raw socket of an ILP-over-TCP sender, for registering with
+ * `epoll`, `kqueue`, IOCP and the like.
+ *
+ * The sender retains ownership of the socket: Don't close it.
+ *
+ * @param[in] sender Line sender object.
+ * @param[out] socket_out The socket.
+ * @return true on success, false for ILP-over-HTTP senders, which have no
+ *         single socket.
+ */
+LINESENDER_API
+bool line_sender_raw_socket(
+    const line_sender* sender,
+    line_sender_socket* socket_out);
+
+/////////// Flush metrics.
+
+/**
+ * A snapshot of a sender's flush counters. See `line_sender_get_stats`.
+ *
+ * All counters are cumulative since the sender was created: Diff two
+ * snapshots to get rates. Latencies cover successful blocking flushes,
+ * retries included, and are accurate to within 12.5%.
+ */
+typedef struct line_sender_stats
+{
+    /** Number of successful flushes. */
+    uint64_t flushes;
+
+    /** Number of flushes that returned an error. */
+    uint64_t failed_flushes;
+
+    /** Uncompressed ILP bytes flushed successfully. */
+    uint64_t bytes_sent;
+
+    /** Rows flushed successfully. */
+    uint64_t rows_sent;
+
+    /** ILP/HTTP requests retried after a network error. */
+    uint64_t network_retries;
+
+    /** ILP/HTTP requests retried after a retriable status code. */
+    uint64_t server_retries;
+
+    /** Total time spent sleeping between ILP/HTTP retries. */
+    uint64_t retry_sleep_micros;
+
+    /** Time taken to connect, including TLS and authentication. TCP only. */
+    uint64_t connect_micros;
+
+    /** Number of timed flushes. */
+    uint64_t flush_latency_count;
+
+    /** Mean flush latency. */
+    uint64_t flush_latency_mean_micros;
+
+    /** Median flush latency. */
+    uint64_t flush_latency_p50_micros;
+
+    /** 90th percentile flush latency. */
+    uint64_t flush_latency_p90_micros;
+
+    /** 99th percentile flush latency. */
+    uint64_t flush_latency_p99_micros;
+
+    /** 99.9th percentile flush latency. */
+    uint64_t flush_latency_p999_micros;
+
+    /** Slowest flush. */
+    uint64_t flush_latency_max_micros;
+
+    /** ILP/TCP connections re-established after a write error. */
+    uint64_t reconnects;
+
+    /**
+     * Spooled ILP/HTTP buffers the server rejected on replay, and that were
+     * dropped. See `line_sender_opts_spool_dir`.
+     */
+    uint64_t spool_rejected;
+} line_sender_stats;
+
+/**
+ * Take a snapshot of the sender's flush counters.
+ *
+ * The counters are updated without locking, so this is cheap enough to call
+ * from a periodic metrics exporter.
+ *
+ * @param[in] sender Line sender object.
+ * @param[out] stats_out The snapshot.
+ */
+LINESENDER_API
+void line_sender_get_stats(
+    const line_sender* sender,
+    line_sender_stats* stats_out);
+
+/////////// Flush tracing.
+
+/** The stage of a flush timed by a `line_sender_span`. */
+typedef enum line_sender_span_kind
+{
+    /** The whole flush call, emitted last. `bytes` is the size of the buffer. */
+    line_sender_span_kind_flush,
+
+    /** Writing the buffer to the ILP/TCP socket. */
+    line_sender_span_kind_tcp_write,
+
+    /** Encoding, and if configured compressing, the ILP/HTTP request body. */
+    line_sender_span_kind_encode,
+
+    /** A single ILP/HTTP request attempt. */
+    line_sender_span_kind_http_attempt,
+
+    /** The ILP/HTTP request, from the first attempt to the last. */
+    line_sender_span_kind_http_request,
+
+    /** Reading and parsing an ILP/HTTP error response. */
+    line_sender_span_kind_parse_response,
+} line_sender_span_kind;
+
+/** A timed stage of a flush. See `line_sender_set_trace_callback`. */
+typedef struct line_sender_span
+{
+    /** Which stage of the flush this span times. */
+    line_sender_span_kind kind;
+
+    /** How long the stage took. */
+    uint64_t duration_nanos;
+
+    /** Number of bytes the stage handled. */
+    size_t bytes;
+
+    /** The ILP/HTTP request attempt, counting from 1, or 0 outside a request. */
+    uint32_t attempt;
+
+    /** The ILP/HTTP status code, or 0 if no response was received. */
+    uint16_t status_code;
+
+    /** The `errorId` of an ILP/HTTP error response. Empty if there's none. */
+    line_sender_utf8 error_id;
+} line_sender_span;
+
+/**
+ * Called on the flushing thread as each stage of a flush completes.
+ * @param[in] ctx The opaque pointer supplied with the callback.
+ * @param[in] span The span, which is only valid for the duration of the call.
+ */
+typedef void (*line_sender_trace_callback)(
+    void* ctx,
+    const line_sender_span* span);
+
+/**
+ * Register a callback that receives a timed span for each stage of every
+ * flush: The TCP write, or the ILP/HTTP body encoding, each request attempt,
+ * the whole request and the parsing of any error response, followed by the
+ * flush as a whole. Replaces any previous callback.
+ *
+ * The callback runs synchronously on the flushing thread: Keep it short.
+ *
+ * @param[in] sender Line sender object.
+ * @param[in] callback Trace callback, or NULL to stop tracing.
+ * @param[in] ctx Opaque pointer passed back to the callback.
+ */
+LINESENDER_API
+void line_sender_set_trace_callback(
+    line_sender* sender,
+    line_sender_trace_callback callback,
+    void* ctx);
+
+/**
+ * Send several buffers of rows to the QuestDB server, clearing them.
+ *
+ * With ILP-over-TCP, all the buffers are written to the socket in a single
+ * scatter-gather call (`writev` or `WSASend`) where possible, without first
+ * being concatenated. Over TLS, they are encrypted straight into TLS records.
+ * If the write fails, none of the buffers are cleared.
+ *
+ * With ILP-over-HTTP, each buffer is sent as a separate request, in order.
+ * If a request fails, the buffers sent before it are cleared.
+ *
+ * Empty buffers are skipped. All the others are validated before anything
+ * is sent.
+ *
+ * @param[in] sender Line sender object.
+ * @param[in] buffers Array of `count` line buffer objects.
+ * @param[in] count Number of buffers.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_flush_many(
+    line_sender* sender,
+    line_sender_buffer* const* buffers,
+    size_t count,
+    line_sender_error** err_out);
+
 /**
  * Send the batch of rows in the buffer to the QuestDB server, and, if the parameter
  * `transactional` is true, ensure the flush will be transactional.
@@ -961,16 +2356,678 @@ bool line_sender_flush_and_keep_with_flags(
     bool transactional,
     line_sender_error** err_out);
 
-/////////// Getting the current timestamp.
+/**
+ * Called by `line_sender_flush_stream()` to write the next chunk of rows into
+ * the empty buffer.
+ * @param[in] ctx The opaque pointer supplied with the callback.
+ * @param[in] buffer The buffer to write the next chunk of rows into.
+ * @param[out] more Set to whether further chunks follow.
+ * @param[out] err_out Set on error, e.g. by the buffer functions.
+ * @return true to carry on, false to abort the request.
+ */
+typedef bool (*line_sender_stream_callback)(
+    void* ctx,
+    line_sender_buffer* buffer,
+    bool* more,
+    line_sender_error** err_out);
 
-/** Get the current time in nanoseconds since the Unix epoch (UTC). */
+/**
+ * Send a batch of rows too large to buffer whole as a single ILP/HTTP request,
+ * serializing them chunk by chunk as the request body is sent.
+ *
+ * The callback is called with an empty buffer until it reports the last
+ * chunk. Each chunk goes out as soon as it's written, so memory use is
+ * bounded by the chunk size rather than by the size of the batch.
+ *
+ * With `transactional`, all the rows must belong to the same table. A failed
+ * attempt is retried by resending the rows from a replay window of up to
+ * `stream_replay_window` bytes: A longer stream fails instead. The request is
+ * neither compressed nor spooled. Only supported for ILP over HTTP.
+ *
+ * @param[in] sender Line sender object.
+ * @param[in] transactional Whether the rows must be sent as one transaction.
+ * @param[in] callback Writes the next chunk of rows.
+ * @param[in] ctx Opaque pointer passed back to the callback.
+ * @return true on success, false on error.
+ */
 LINESENDER_API
-int64_t line_sender_now_nanos();
+bool line_sender_flush_stream(
+    line_sender* sender,
+    bool transactional,
+    line_sender_stream_callback callback,
+    void* ctx,
+    line_sender_error** err_out);
 
-/** Get the current time in microseconds since the Unix epoch (UTC). */
-LINESENDER_API
+/////////// Flushing from a background thread.
+
+/**
+ * Flushes buffers from a dedicated I/O thread.
+ *
+ * The I/O thread owns the connection. Flushing hands the filled buffer over to
+ * the I/O thread and swaps in an empty buffer from a small ring, so the caller
+ * can keep appending rows whilst the previous batch is in flight.
+ *
+ * Flushes are sent in the order they were submitted. If a flush fails, its
+ * rows are discarded and the error is reported via its flush handle or
+ * callback.
+ */
+typedef struct line_sender_background line_sender_background;
+
+/** Tracks the completion of a flush submitted to a background sender. */
+typedef struct line_sender_flush_handle line_sender_flush_handle;
+
+/**
+ * Called on the I/O thread once a background flush has completed.
+ * @param[in] ctx The opaque pointer supplied when submitting the flush.
+ * @param[in] err NULL on success. Otherwise, the error, which is only valid
+ *                for the duration of the call and must not be freed.
+ */
+typedef void (*line_sender_flush_callback)(
+    void* ctx,
+    const line_sender_error* err);
+
+/**
+ * Move the sender to a dedicated I/O thread, so that flushing no longer blocks
+ * the calling thread.
+ *
+ * This function takes ownership of the sender in all cases: Don't use or close
+ * the `sender` after this call, even on error.
+ *
+ * @param[in] sender Line sender object.
+ * @param[in] ring_size Number of buffers that may be in flight at any one time.
+ *                      Two is sufficient to keep filling one buffer whilst the
+ *                      other is being sent.
+ * @return The background sender, or NULL on error.
+ */
+LINESENDER_API
+line_sender_background* line_sender_into_background(
+    line_sender* sender,
+    size_t ring_size,
+    line_sender_error** err_out);
+
+/**
+ * Hand the buffer over to the I/O thread to be sent, and replace its contents
+ * with an empty buffer from the ring.
+ *
+ * Returns as soon as the buffer is queued. If all the buffers of the ring are
+ * in flight, this blocks until the I/O thread returns one.
+ *
+ * A buffer with an incomplete row is rejected straight away and left untouched.
+ *
+ * @param[in] background Background sender object.
+ * @param[in] buffer Line buffer object. Empty on return.
+ * @return A flush handle to be released with `line_sender_flush_handle_wait` or
+ *         `line_sender_flush_handle_free`, or NULL on error.
+ */
+LINESENDER_API
+line_sender_flush_handle* line_sender_background_flush(
+    line_sender_background* background,
+    line_sender_buffer* buffer,
+    line_sender_error** err_out);
+
+/**
+ * Like `line_sender_background_flush`, but reports the outcome by invoking
+ * `callback` on the I/O thread instead of returning a handle.
+ *
+ * Keep the callback short: No further flushes are sent until it returns.
+ *
+ * @param[in] background Background sender object.
+ * @param[in] buffer Line buffer object. Empty on return.
+ * @param[in] callback Completion callback.
+ * @param[in] ctx Opaque pointer passed back to the callback.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_background_flush_with_callback(
+    line_sender_background* background,
+    line_sender_buffer* buffer,
+    line_sender_flush_callback callback,
+    void* ctx,
+    line_sender_error** err_out);
+
+/**
+ * Wait for all queued flushes to complete, then stop the I/O thread and close
+ * the connection.
+ * @param[in] background Background sender object.
+ */
+LINESENDER_API
+void line_sender_background_close(line_sender_background* background);
+
+/**
+ * Tell whether the flush has completed, without blocking.
+ * Once this returns true, `line_sender_flush_handle_wait` returns immediately.
+ * @param[in] handle Flush handle.
+ */
+LINESENDER_API
+bool line_sender_flush_handle_is_done(line_sender_flush_handle* handle);
+
+/**
+ * Block until the flush has completed and report its outcome.
+ * This releases the handle: Don't use it after this call.
+ * @param[in] handle Flush handle.
+ * @return true if the flush succeeded, false on error.
+ */
+LINESENDER_API
+bool line_sender_flush_handle_wait(
+    line_sender_flush_handle* handle,
+    line_sender_error** err_out);
+
+/**
+ * Release the flush handle without waiting. This does not cancel the flush.
+ * @param[in] handle Flush handle.
+ */
+LINESENDER_API
+void line_sender_flush_handle_free(line_sender_flush_handle* handle);
+
+/////////// Sharing connections between threads.
+
+/**
+ * A fixed-size set of connections that can be shared between threads.
+ *
+ * Unlike `line_sender`, all the functions below except `line_sender_pool_close`
+ * may be called from multiple threads at once.
+ *
+ * Each flush goes to the connection that has been idle the longest, which
+ * spreads the load evenly across the connections. When all the connections
+ * are busy, the flush blocks until one becomes idle. A TCP connection that
+ * failed is replaced with a new one the next time it's picked.
+ */
+typedef struct line_sender_pool line_sender_pool;
+
+/**
+ * Create a new sender pool from the given options object, opening
+ * `pool_size` connections.
+ *
+ * In the case of TCP, all the connections are established before this
+ * function returns.
+ *
+ * @param[in] opts Options for the connections.
+ * @return The sender pool, or NULL on error.
+ */
+LINESENDER_API
+line_sender_pool* line_sender_pool_build(
+    const line_sender_opts* opts,
+    line_sender_error** err_out);
+
+/**
+ * Create a new sender pool from the given configuration string.
+ * The format is the same as for `line_sender_from_conf`, plus the `pool_size`
+ * key for the number of connections.
+ *
+ * @return The sender pool, or NULL on error.
+ */
+LINESENDER_API
+line_sender_pool* line_sender_pool_from_conf(
+    line_sender_utf8 config,
+    line_sender_error** err_out);
+
+/**
+ * Create a new sender pool from the configuration stored in the
+ * `QDB_CLIENT_CONF` environment variable.
+ *
+ * @return The sender pool, or NULL on error.
+ */
+LINESENDER_API
+line_sender_pool* line_sender_pool_from_env(line_sender_error** err_out);
+
+/**
+ * The number of connections in the pool.
+ * @param[in] pool Sender pool object.
+ */
+LINESENDER_API
+size_t line_sender_pool_size(const line_sender_pool* pool);
+
+/**
+ * Send the buffer over the pool's least-loaded connection, clearing the
+ * buffer.
+ *
+ * See `line_sender_flush` for the details on flushing.
+ *
+ * @param[in] pool Sender pool object.
+ * @param[in] buffer Line buffer object.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_pool_flush(
+    const line_sender_pool* pool,
+    line_sender_buffer* buffer,
+    line_sender_error** err_out);
+
+/**
+ * Send the buffer over the pool's least-loaded connection.
+ *
+ * All the data stays in the buffer. Clear the buffer before starting a new
+ * batch.
+ *
+ * @param[in] pool Sender pool object.
+ * @param[in] buffer Line buffer object.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_pool_flush_and_keep(
+    const line_sender_pool* pool,
+    const line_sender_buffer* buffer,
+    line_sender_error** err_out);
+
+/**
+ * Transactional variant of `line_sender_pool_flush_and_keep`.
+ * See `line_sender_flush_and_keep_with_flags`.
+ *
+ * @param[in] pool Sender pool object.
+ * @param[in] buffer Line buffer object.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_pool_flush_and_keep_with_flags(
+    const line_sender_pool* pool,
+    const line_sender_buffer* buffer,
+    bool transactional,
+    line_sender_error** err_out);
+
+/**
+ * Close all the connections of the pool. Does not flush.
+ * No other thread may be using the pool during this call.
+ * @param[in] pool Sender pool object.
+ */
+LINESENDER_API
+void line_sender_pool_close(line_sender_pool* pool);
+
+/////////// Sharding rows across servers.
+
+/**
+ * Routes rows across several servers, each holding a shard of the data.
+ *
+ * Each shard has a sender and a buffer of its own. Starting a row picks its
+ * shard, by a stable hash of the table name or of a symbol value, and returns
+ * that shard's buffer to continue the row with. `line_sender_sharded_flush`
+ * then flushes all the shards in parallel.
+ */
+typedef struct line_sender_sharded line_sender_sharded;
+
+/**
+ * Create a new sharded sender from the given configuration string.
+ *
+ * The format is the same as for `line_sender_from_conf`, except that `addr`
+ * is replaced by `shards`, a comma-separated list of the shards' addresses,
+ * each with optional `|`-separated failover addresses. `shard_by=table` (the
+ * default) routes rows by table name, and `shard_by=symbol` together with
+ * `shard_key=<column>` by the value of a symbol column. E.g.:
+ *
+ * `http::shards=db1:9000|db1b:9000,db2:9000;shard_by=symbol;shard_key=device;`
+ *
+ * In the case of TCP, all the connections are established before this
+ * function returns.
+ *
+ * @return The sharded sender, or NULL on error.
+ */
+LINESENDER_API
+line_sender_sharded* line_sender_sharded_from_conf(
+    line_sender_utf8 config,
+    line_sender_error** err_out);
+
+/**
+ * The number of shards.
+ * @param[in] sharded Sharded sender object.
+ */
+LINESENDER_API
+size_t line_sender_sharded_shard_count(const line_sender_sharded* sharded);
+
+/**
+ * Start recording a new row for the given table, in the table's shard.
+ * Only valid with `shard_by=table`.
+ *
+ * Returns the shard's buffer, to continue the row with the
+ * `line_sender_buffer_*` functions. The buffer is owned by the sharded
+ * sender: Don't free it, and don't flush it other than with
+ * `line_sender_sharded_flush`.
+ *
+ * @param[in] sharded Sharded sender object.
+ * @param[in] name Table name.
+ * @return The shard's buffer, or NULL on error.
+ */
+LINESENDER_API
+line_sender_buffer* line_sender_sharded_table(
+    line_sender_sharded* sharded,
+    line_sender_table_name name,
+    line_sender_error** err_out);
+
+/**
+ * Start recording a new row for the given table in the shard of `key`, and
+ * record `key` as the row's `shard_key` symbol. Record any other symbols
+ * next. Only valid with `shard_by=symbol`.
+ *
+ * Returns the shard's buffer, as per `line_sender_sharded_table`.
+ *
+ * @param[in] sharded Sharded sender object.
+ * @param[in] name Table name.
+ * @param[in] key Shard key value.
+ * @return The shard's buffer, or NULL on error.
+ */
+LINESENDER_API
+line_sender_buffer* line_sender_sharded_table_with_key(
+    line_sender_sharded* sharded,
+    line_sender_table_name name,
+    line_sender_utf8 key,
+    line_sender_error** err_out);
+
+/**
+ * Discard the row under construction, if it's incomplete.
+ * @param[in] sharded Sharded sender object.
+ */
+LINESENDER_API
+void line_sender_sharded_rewind_row(line_sender_sharded* sharded);
+
+/**
+ * The number of rows pending across all the shards.
+ * @param[in] sharded Sharded sender object.
+ */
+LINESENDER_API
+size_t line_sender_sharded_row_count(const line_sender_sharded* sharded);
+
+/**
+ * Take a snapshot of the given shard's flush counters.
+ * See `line_sender_get_stats`. `shard` must be less than the shard count.
+ * @param[in] sharded Sharded sender object.
+ * @param[in] shard Index of the shard.
+ * @param[out] stats_out The snapshot.
+ */
+LINESENDER_API
+void line_sender_sharded_shard_stats(
+    const line_sender_sharded* sharded,
+    size_t shard,
+    line_sender_stats* stats_out);
+
+/**
+ * Send the pending rows of every shard, flushing the shards in parallel.
+ *
+ * Shards that flushed are cleared, whilst shards that failed keep their rows
+ * to retry with the next call. On error, reports the error of the
+ * lowest-numbered shard that failed.
+ *
+ * @param[in] sharded Sharded sender object.
+ * @return true on success, false on error.
+ */
+LINESENDER_API
+bool line_sender_sharded_flush(
+    line_sender_sharded* sharded,
+    line_sender_error** err_out);
+
+/**
+ * Close the connections of all the shards. Does not flush.
+ * @param[in] sharded Sharded sender object.
+ */
+LINESENDER_API
+void line_sender_sharded_close(line_sender_sharded* sharded);
+
+/////////// Recycling buffers.
+
+/**
+ * A shared free list of buffers, so that batches can be prepared without
+ * allocating a fresh buffer for each of them.
+ *
+ * Memory use is bounded by two limits. A returned buffer that grew past
+ * `max_capacity` bytes, say to hold one outlier batch, is shrunk back down to
+ * it. Buffers returned whilst `max_idle` are already idle are freed.
+ *
+ * All the functions below except `line_sender_buffer_pool_free` may be called
+ * from multiple threads at once.
+ */
+typedef struct line_sender_buffer_pool line_sender_buffer_pool;
+
+/**
+ * Create an empty pool that keeps up to `max_idle` buffers of at most
+ * `max_capacity` bytes each.
+ *
+ * Its buffers are encoded with `line_sender_protocol_version_1` and write
+ * designated timestamps in nanoseconds, as per `line_sender_buffer_new`.
+ */
+LINESENDER_API
+line_sender_buffer_pool* line_sender_buffer_pool_new(
+    size_t max_capacity,
+    size_t max_idle);
+
+/**
+ * Create an empty pool as per `line_sender_buffer_pool_new`, whose buffers
+ * are encoded with the given protocol version and timestamp precision.
+ *
+ * To match a sender, pass `line_sender_get_protocol_version` and
+ * `line_sender_get_timestamp_precision`. Buffers released into the pool are
+ * reset to these settings.
+ */
+LINESENDER_API
+line_sender_buffer_pool* line_sender_buffer_pool_new_with_encoding(
+    size_t max_capacity,
+    size_t max_idle,
+    line_sender_protocol_version protocol_version,
+    line_sender_timestamp_precision precision);
+
+/**
+ * Take an empty buffer from the pool, or create one if the pool is empty.
+ *
+ * Return the buffer with `line_sender_buffer_pool_release`, or free it with
+ * `line_sender_buffer_free` as usual.
+ *
+ * @param[in] pool Buffer pool object.
+ */
+LINESENDER_API
+line_sender_buffer* line_sender_buffer_pool_acquire(
+    const line_sender_buffer_pool* pool);
+
+/**
+ * Return a buffer to the pool, discarding its contents.
+ *
+ * This takes ownership of the buffer: Don't use or free it after this call.
+ * The buffer needn't have come from this pool: Its settings, such as being
+ * trusted, are reset to those of a buffer the pool creates.
+ * Passing NULL is a no-op.
+ *
+ * @param[in] pool Buffer pool object.
+ * @param[in] buffer Line buffer object.
+ */
+LINESENDER_API
+void line_sender_buffer_pool_release(
+    const line_sender_buffer_pool* pool,
+    line_sender_buffer* buffer);
+
+/**
+ * The number of buffers currently waiting in the pool.
+ * @param[in] pool Buffer pool object.
+ */
+LINESENDER_API
+size_t line_sender_buffer_pool_idle(const line_sender_buffer_pool* pool);
+
+/**
+ * Release the caller's reference to the pool. Senders that share the pool keep
+ * it alive until they are closed.
+ * @param[in] pool Buffer pool object.
+ */
+LINESENDER_API
+void line_sender_buffer_pool_free(line_sender_buffer_pool* pool);
+
+/**
+ * Like `line_sender_into_background`, but the ring's buffers are drawn from
+ * `pool`, shrunk back to its `max_capacity` after each flush, and returned to
+ * it once the background sender is closed.
+ *
+ * @param[in] sender Line sender object.
+ * @param[in] ring_size Number of buffers that may be in flight at any one time.
+ * @param[in] pool Buffer pool object.
+ * @return The background sender, or NULL on error.
+ */
+LINESENDER_API
+line_sender_background* line_sender_into_background_with_pool(
+    line_sender* sender,
+    size_t ring_size,
+    const line_sender_buffer_pool* pool,
+    line_sender_error** err_out);
+
+/**
+ * Share a buffer pool with the threads using a sender pool.
+ *
+ * Once set, `line_sender_pool_flush` shrinks each buffer it sends back to the
+ * buffer pool's `max_capacity`. Call this before sharing the sender pool
+ * between threads.
+ *
+ * @param[in] pool Sender pool object.
+ * @param[in] buffers Buffer pool object.
+ */
+LINESENDER_API
+void line_sender_pool_set_buffer_pool(
+    line_sender_pool* pool,
+    const line_sender_buffer_pool* buffers);
+
+/////////// Committing rows from many threads to one connection.
+
+/**
+ * Gathers the rows committed by many threads into large requests over a
+ * single connection.
+ *
+ * Each thread fills a buffer of its own, without any locking, and commits it
+ * with `line_sender_concurrent_commit`. The flusher thread, which owns the
+ * connection, gathers all the buffers committed whilst the previous request
+ * was in flight into the next one, up to `max_buf_size`. All the buffers
+ * gathered into a request share its outcome.
+ *
+ * Buffers are sent in the order they were committed. Requests are never
+ * transactional.
+ */
+typedef struct line_sender_concurrent line_sender_concurrent;
+
+/**
+ * Move the sender to a flusher thread that many threads can commit buffers
+ * to at once.
+ *
+ * This function takes ownership of the sender in all cases: Don't use or close
+ * the `sender` after this call, even on error.
+ *
+ * @param[in] sender Line sender object.
+ * @param[in] queue_depth Number of committed buffers that may wait for the
+ *                        flusher before `line_sender_concurrent_commit`
+ *                        blocks.
+ * @return The concurrent sender, or NULL on error.
+ */
+LINESENDER_API
+line_sender_concurrent* line_sender_into_concurrent(
+    line_sender* sender,
+    size_t queue_depth,
+    line_sender_error** err_out);
+
+/**
+ * Like `line_sender_into_concurrent`, but the replacement buffers are drawn
+ * from `pool`, and committed buffers are returned to it once sent.
+ *
+ * @param[in] sender Line sender object.
+ * @param[in] queue_depth Number of committed buffers that may wait for the
+ *                        flusher.
+ * @param[in] pool Buffer pool object.
+ * @return The concurrent sender, or NULL on error.
+ */
+LINESENDER_API
+line_sender_concurrent* line_sender_into_concurrent_with_pool(
+    line_sender* sender,
+    size_t queue_depth,
+    const line_sender_buffer_pool* pool,
+    line_sender_error** err_out);
+
+/**
+ * Hand the buffer's rows over to the flusher thread, to be sent with the rows
+ * committed by other threads, and replace them with an empty buffer.
+ *
+ * May be called from many threads at once, each with a buffer of its own.
+ * Returns as soon as the rows are queued. A buffer with an incomplete row is
+ * rejected straight away and left untouched.
+ *
+ * @param[in] concurrent Concurrent sender object.
+ * @param[in] buffer Line buffer object. Empty on return.
+ * @return A flush handle to be released with `line_sender_flush_handle_wait` or
+ *         `line_sender_flush_handle_free`, or NULL on error.
+ */
+LINESENDER_API
+line_sender_flush_handle* line_sender_concurrent_commit(
+    const line_sender_concurrent* concurrent,
+    line_sender_buffer* buffer,
+    line_sender_error** err_out);
+
+/**
+ * Send all the buffers committed so far, then stop the flusher thread and
+ * close the connection. No other thread may commit concurrently.
+ * @param[in] concurrent Concurrent sender object.
+ */
+LINESENDER_API
+void line_sender_concurrent_close(line_sender_concurrent* concurrent);
+
+/////////// Getting the current timestamp.
+
+/** Get the current time in nanoseconds since the Unix epoch (UTC). */
+LINESENDER_API
+int64_t line_sender_now_nanos();
+
+/** Get the current time in microseconds since the Unix epoch (UTC). */
+LINESENDER_API
 int64_t line_sender_now_micros();
 
+/**
+ * Create a clock reading from the given source, to stamp rows more cheaply
+ * than with `line_sender_now_nanos()`.
+ *
+ * The most precise source, `line_sender_clock_source_calibrated`, reads the
+ * monotonic clock offset to the wall clock, resyncing every second. The
+ * cheapest, `line_sender_clock_source_batch`, only reads the wall clock when
+ * created and on each `line_sender_clock_tick()`, say once per batch.
+ *
+ * The clock isn't strictly increasing by default. Once configured, it may be
+ * shared between threads.
+ */
+LINESENDER_API
+line_sender_clock* line_sender_clock_new(line_sender_clock_source source);
+
+/**
+ * Make each timestamp at least one nanosecond later than the previous one,
+ * so that rows stamped from a coarse or batch clock still sort in the order
+ * they were stamped. Not thread-safe: Call before sharing the clock.
+ * @param[in] clock Clock object.
+ * @param[in] enabled Whether the timestamps are strictly increasing.
+ */
+LINESENDER_API
+void line_sender_clock_set_strictly_increasing(
+    line_sender_clock* clock,
+    bool enabled);
+
+/**
+ * How often a `line_sender_clock_source_calibrated` clock resyncs with the
+ * wall clock. The default is 1000 milliseconds. Not thread-safe: Call before
+ * sharing the clock.
+ * @param[in] clock Clock object.
+ * @param[in] interval_millis The interval, in milliseconds.
+ */
+LINESENDER_API
+void line_sender_clock_set_resync_interval(
+    line_sender_clock* clock,
+    uint64_t interval_millis);
+
+/**
+ * Capture a new timestamp for a `line_sender_clock_source_batch` clock, or
+ * resync a `line_sender_clock_source_calibrated` one right away. Does nothing
+ * for the other sources.
+ * @param[in] clock Clock object.
+ */
+LINESENDER_API
+void line_sender_clock_tick(const line_sender_clock* clock);
+
+/**
+ * Get the clock's current time in nanoseconds since the Unix epoch (UTC).
+ * @param[in] clock Clock object.
+ */
+LINESENDER_API
+int64_t line_sender_clock_now_nanos(const line_sender_clock* clock);
+
+/**
+ * Release the clock object.
+ * @param[in] clock Clock object.
+ */
+LINESENDER_API
+void line_sender_clock_free(line_sender_clock* clock);
+
 
 #ifdef __cplusplus
 }
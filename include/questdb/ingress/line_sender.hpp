@@ -33,6 +33,12 @@
 #include <optional>
 #include <chrono>
 #include <type_traits>
+#include <vector>
+#include <array>
+#include <iterator>
+#include <initializer_list>
+#include <functional>
+#include <exception>
 
 namespace questdb::ingress
 {
@@ -41,6 +47,14 @@ namespace questdb::ingress
     class line_sender;
     class line_sender_buffer;
     class opts;
+    class flush_handle;
+    class background_line_sender;
+    class concurrent_line_sender;
+    class line_sender_pool;
+    class sharded_line_sender;
+    class buffer_pool;
+    class column_slice;
+    class prepared_column_name;
 
     /** Category of error. */
     enum class line_sender_error_code
@@ -77,6 +91,9 @@ namespace questdb::ingress
 
         /** Bad configuration. */
         config_error,
+
+        /** The buffer has no room left within its fixed capacity. */
+        buffer_full,
     };
 
     /** The protocol used to connect with. */
@@ -110,6 +127,87 @@ namespace questdb::ingress
         pem_file,
     };
 
+    /** Compression of the body of ILP-over-HTTP requests. */
+    enum class compression {
+        /** Send the ILP text uncompressed. */
+        none,
+
+        /** Compress with gzip, sent as `Content-Encoding: gzip`. */
+        gzip,
+
+        /** Compress with Zstandard, sent as `Content-Encoding: zstd`. */
+        zstd,
+    };
+
+    /** How an ILP/TCP sender writes to its socket. */
+    enum class io_backend {
+        /** Plain blocking `send` calls. */
+        std,
+
+        /** Submit the writes through an io_uring. Linux only. */
+        uring,
+    };
+
+    /** Where a `fast_clock` reads the time from. */
+    enum class clock_source {
+        /** The system's wall clock, as per `timestamp_nanos::now()`. */
+        system,
+
+        /**
+         * `CLOCK_REALTIME_COARSE` on Linux, with a resolution of one scheduler
+         * tick. Elsewhere, the same as `system`.
+         */
+        coarse,
+
+        /** The monotonic clock, periodically resynced with the wall clock. */
+        calibrated,
+
+        /** A timestamp captured on creation and on each `fast_clock::tick()`. */
+        batch,
+    };
+
+    /** How the interval between the retries of a failed request grows. */
+    enum class retry_backoff {
+        /** Double the interval after each attempt, with a small jitter. */
+        exponential,
+
+        /** Wait a random interval, up to the doubling interval. */
+        full_jitter,
+
+        /** Wait a random interval, up to three times the previous one. */
+        decorrelated,
+    };
+
+    /** Version of the line protocol a buffer is encoded with. */
+    enum class protocol_version {
+        /** All values are written as text. Accepted by every QuestDB server. */
+        v1 = 1,
+
+        /** `f64` column values are written in binary. */
+        v2 = 2,
+    };
+
+    /** The unit the designated timestamp of each row is written in. */
+    enum class timestamp_precision {
+        /** Nanoseconds. */
+        nanos,
+
+        /** Microseconds. */
+        micros,
+
+        /** Milliseconds. */
+        millis,
+
+        /** Seconds. */
+        seconds,
+    };
+
+    /**
+     * A snapshot of a sender's flush counters, as returned by
+     * `line_sender::stats()`. Durations are in microseconds.
+     */
+    using sender_stats = ::line_sender_stats;
+
     /**
      * An error that occurred when using the line sender.
      *
@@ -126,6 +224,17 @@ namespace questdb::ingress
         /** Error code categorizing the error. */
         line_sender_error_code code() const noexcept { return _code; }
 
+        /**
+         * The index of the row the server rejected, counting from 0 at the
+         * start of the flushed buffer, if the server reported it.
+         * Drop it with `line_sender_buffer::drop_rows()` and flush the rest
+         * again.
+         */
+        std::optional<size_t> failed_row() const noexcept
+        {
+            return _failed_row;
+        }
+
     private:
         inline static line_sender_error from_c(::line_sender_error* c_err)
         {
@@ -137,6 +246,9 @@ namespace questdb::ingress
             const char* c_msg{::line_sender_error_msg(c_err, &c_len)};
             std::string msg{c_msg, c_len};
             line_sender_error err{code, msg};
+            size_t failed_row{0};
+            if (::line_sender_error_failed_row(c_err, &failed_row))
+                err._failed_row = failed_row;
             ::line_sender_error_free(c_err);
             return err;
         }
@@ -155,6 +267,12 @@ namespace questdb::ingress
         friend class line_sender;
         friend class line_sender_buffer;
         friend class opts;
+        friend class flush_handle;
+        friend class background_line_sender;
+        friend class concurrent_line_sender;
+        friend class line_sender_pool;
+        friend class sharded_line_sender;
+        friend class prepared_column_name;
 
         template <
             typename T,
@@ -162,6 +280,7 @@ namespace questdb::ingress
         friend class basic_view;
 
         line_sender_error_code _code;
+        std::optional<size_t> _failed_row;
     };
 
     /**
@@ -199,6 +318,18 @@ namespace questdb::ingress
             : basic_view{s.data(), s.size()}
         {}
 
+        /**
+         * Wrap a string without validating it, for trusted producers whose
+         * names and strings are known to be valid ahead of time.
+         *
+         * The caller must guarantee the string would pass validation: Names
+         * and strings that are not valid UTF-8 are undefined behaviour.
+         */
+        static basic_view unchecked(std::string_view s_view) noexcept
+        {
+            return basic_view{T{s_view.size(), s_view.data()}};
+        }
+
         size_t size() const noexcept { return _impl.len; }
 
         const char* data() const noexcept { return _impl.buf; }
@@ -209,11 +340,18 @@ namespace questdb::ingress
         }
 
     private:
+        explicit basic_view(T impl) noexcept
+            : _impl{impl}
+        {}
+
         T _impl;
 
         friend class line_sender;
         friend class line_sender_buffer;
         friend class opts;
+        friend class column_slice;
+        friend class prepared_column_name;
+        friend class sharded_line_sender;
     };
 
     using utf8_view = basic_view<
@@ -264,6 +402,81 @@ namespace questdb::ingress
         }
     }
 
+    /**
+     * A column name, validated and escaped once ahead of time.
+     *
+     * Pass it instead of a `column_name_view` to `line_sender_buffer::symbol()`
+     * and `line_sender_buffer::column()` to avoid re-escaping the same name on
+     * every row.
+     *
+     * @code {.cpp}
+     * const questdb::ingress::prepared_column_name price{"price"_cn};
+     * buffer.table("trades"_tn).column(price, 2615.54).at_now();
+     * @endcode
+     */
+    class prepared_column_name
+    {
+    public:
+        explicit prepared_column_name(column_name_view name)
+            : _impl{::line_sender_prepared_column_name_new(name._impl)}
+        {}
+
+        prepared_column_name(const prepared_column_name&) = delete;
+
+        prepared_column_name(prepared_column_name&& other) noexcept
+            : _impl{other._impl}
+        {
+            other._impl = nullptr;
+        }
+
+        prepared_column_name& operator=(const prepared_column_name&) = delete;
+
+        prepared_column_name& operator=(prepared_column_name&& other) noexcept
+        {
+            if (this != &other)
+            {
+                ::line_sender_prepared_column_name_free(_impl);
+                _impl = other._impl;
+                other._impl = nullptr;
+            }
+            return *this;
+        }
+
+        ~prepared_column_name() noexcept
+        {
+            ::line_sender_prepared_column_name_free(_impl);
+        }
+
+        /**
+         * Format the floating-point values recorded for this name rounded to
+         * `decimals` places, at most 15, as `line_sender_buffer::column_fixed()`
+         * does.
+         */
+        prepared_column_name& with_decimals(uint8_t decimals)
+        {
+            impl();
+            line_sender_error::wrapped_call(
+                ::line_sender_prepared_column_name_set_decimals,
+                _impl,
+                decimals);
+            return *this;
+        }
+
+    private:
+        const ::line_sender_prepared_column_name* impl() const
+        {
+            if (!_impl)
+                throw line_sender_error{
+                    line_sender_error_code::invalid_api_call,
+                    "Prepared column name has been moved from."};
+            return _impl;
+        }
+
+        ::line_sender_prepared_column_name* _impl;
+
+        friend class line_sender_buffer;
+    };
+
     class timestamp_micros
     {
     public:
@@ -312,6 +525,305 @@ namespace questdb::ingress
         int64_t _ts;
     };
 
+    /**
+     * A source of designated timestamps cheaper to read than
+     * `timestamp_nanos::now()`. Pass it to `line_sender_buffer::at_clock()`.
+     *
+     * The `batch` source is the cheapest: It only reads the wall clock when
+     * created and on each `tick()`, say once per batch. Combine it with
+     * `set_strictly_increasing(true)` to tell the rows of a batch apart.
+     *
+     * Once configured, the clock may be shared between threads.
+     */
+    class fast_clock
+    {
+    public:
+        explicit fast_clock(clock_source source = clock_source::calibrated)
+            : _impl{::line_sender_clock_new(
+                static_cast<::line_sender_clock_source>(
+                    static_cast<int>(source)))}
+        {}
+
+        fast_clock(const fast_clock&) = delete;
+
+        fast_clock(fast_clock&& other) noexcept
+            : _impl{other._impl}
+        {
+            other._impl = nullptr;
+        }
+
+        fast_clock& operator=(const fast_clock&) = delete;
+
+        fast_clock& operator=(fast_clock&& other) noexcept
+        {
+            if (this != &other)
+            {
+                ::line_sender_clock_free(_impl);
+                _impl = other._impl;
+                other._impl = nullptr;
+            }
+            return *this;
+        }
+
+        /**
+         * Make each timestamp at least one nanosecond later than the previous
+         * one. Call before sharing the clock between threads.
+         */
+        void set_strictly_increasing(bool enabled)
+        {
+            ::line_sender_clock_set_strictly_increasing(ensure_impl(), enabled);
+        }
+
+        /**
+         * How often a `calibrated` clock resyncs with the wall clock.
+         * The default is one second. Call before sharing the clock between
+         * threads.
+         */
+        void set_resync_interval(std::chrono::milliseconds interval)
+        {
+            ::line_sender_clock_set_resync_interval(
+                ensure_impl(), static_cast<uint64_t>(interval.count()));
+        }
+
+        /**
+         * Capture a new timestamp for a `batch` clock, or resync a
+         * `calibrated` one right away.
+         */
+        void tick() const
+        {
+            ::line_sender_clock_tick(ensure_impl());
+        }
+
+        /** The clock's current time. */
+        timestamp_nanos now() const
+        {
+            return timestamp_nanos{::line_sender_clock_now_nanos(ensure_impl())};
+        }
+
+        ~fast_clock() noexcept
+        {
+            ::line_sender_clock_free(_impl);
+        }
+
+    private:
+        ::line_sender_clock* ensure_impl() const
+        {
+            if (!_impl)
+                throw line_sender_error{
+                    line_sender_error_code::invalid_api_call,
+                    "Clock has been moved from."};
+            return _impl;
+        }
+
+        ::line_sender_clock* _impl;
+
+        friend class line_sender_buffer;
+    };
+
+    /**
+     * The values of one column across a batch of rows, for
+     * `line_sender_buffer::append_columns()`.
+     *
+     * Boolean, integer, floating point and timestamp values are not copied:
+     * They must outlive the `append_columns()` call.
+     */
+    class column_slice
+    {
+    public:
+        column_slice(column_name_view name, const bool* data, size_t size) noexcept
+            : column_slice{name, ::line_sender_column_type_bool, data, size}
+        {}
+
+        column_slice(column_name_view name, const int64_t* data, size_t size) noexcept
+            : column_slice{name, ::line_sender_column_type_i64, data, size}
+        {}
+
+        column_slice(column_name_view name, const double* data, size_t size) noexcept
+            : column_slice{name, ::line_sender_column_type_f64, data, size}
+        {}
+
+        /**
+         * Wrap any contiguous container of `bool`, `int64_t` or `double`
+         * values, such as `std::vector` or `std::array`.
+         */
+        template <
+            typename Container,
+            typename = decltype(std::data(std::declval<const Container&>()))>
+        column_slice(column_name_view name, const Container& values) noexcept
+            : column_slice{name, std::data(values), std::size(values)}
+        {}
+
+        /** Timestamps in microseconds since the Unix epoch. */
+        static column_slice timestamps_micros(
+            column_name_view name, const int64_t* data, size_t size) noexcept
+        {
+            return {name, ::line_sender_column_type_ts_micros, data, size};
+        }
+
+        /**
+         * Symbol values from any container of elements convertible to
+         * `std::string_view`. The string views are copied, not the strings.
+         */
+        template <typename Container>
+        static column_slice symbols(column_name_view name, const Container& values)
+        {
+            return from_strings(name, ::line_sender_column_type_symbol, values);
+        }
+
+        /**
+         * String values from any container of elements convertible to
+         * `std::string_view`. The string views are copied, not the strings.
+         */
+        template <typename Container>
+        static column_slice strings(column_name_view name, const Container& values)
+        {
+            return from_strings(name, ::line_sender_column_type_str, values);
+        }
+
+        /** Number of values in the column. */
+        size_t size() const noexcept { return _size; }
+
+    private:
+        column_slice(
+            column_name_view name,
+            ::line_sender_column_type column_type,
+            const void* data,
+            size_t size) noexcept
+            : _name{name._impl}
+            , _column_type{column_type}
+            , _data{data}
+            , _size{size}
+        {}
+
+        template <typename Container>
+        static column_slice from_strings(
+            column_name_view name,
+            ::line_sender_column_type column_type,
+            const Container& values)
+        {
+            column_slice slice{name, column_type, nullptr, 0};
+            for (const auto& value : values)
+            {
+                const std::string_view view{value};
+                slice._strs.push_back(::line_sender_utf8{view.size(), view.data()});
+            }
+            slice._size = slice._strs.size();
+            return slice;
+        }
+
+        ::line_sender_column_slice to_c() const noexcept
+        {
+            return {
+                _name,
+                _column_type,
+                _strs.empty() ? _data : _strs.data()};
+        }
+
+        ::line_sender_column_name _name;
+        ::line_sender_column_type _column_type;
+        const void* _data;
+        size_t _size;
+        std::vector<::line_sender_utf8> _strs;
+
+        friend class line_sender_buffer;
+    };
+
+    /**
+     * Column type tags for `line_sender_buffer::row_writer`.
+     *
+     * Each tag fixes the C++ type of the value accepted for the column.
+     */
+    namespace cols
+    {
+        /** A symbol column, written from a `utf8_view`. */
+        struct symbol
+        {
+            using value_type = utf8_view;
+            static constexpr ::line_sender_column_type column_type =
+                ::line_sender_column_type_symbol;
+
+            static ::line_sender_row_value to_row_value(value_type value) noexcept
+            {
+                ::line_sender_row_value row_value;
+                row_value.utf8 = ::line_sender_utf8{value.size(), value.data()};
+                return row_value;
+            }
+        };
+
+        /** A boolean column. */
+        struct boolean
+        {
+            using value_type = bool;
+            static constexpr ::line_sender_column_type column_type =
+                ::line_sender_column_type_bool;
+
+            static ::line_sender_row_value to_row_value(value_type value) noexcept
+            {
+                ::line_sender_row_value row_value;
+                row_value.boolean = value;
+                return row_value;
+            }
+        };
+
+        /** An integer column. */
+        struct i64
+        {
+            using value_type = int64_t;
+            static constexpr ::line_sender_column_type column_type =
+                ::line_sender_column_type_i64;
+
+            static ::line_sender_row_value to_row_value(value_type value) noexcept
+            {
+                ::line_sender_row_value row_value;
+                row_value.i64 = value;
+                return row_value;
+            }
+        };
+
+        /** A floating-point column. */
+        struct f64
+        {
+            using value_type = double;
+            static constexpr ::line_sender_column_type column_type =
+                ::line_sender_column_type_f64;
+
+            static ::line_sender_row_value to_row_value(value_type value) noexcept
+            {
+                ::line_sender_row_value row_value;
+                row_value.f64 = value;
+                return row_value;
+            }
+        };
+
+        /** A string column, written from a `utf8_view`. */
+        struct str
+        {
+            using value_type = utf8_view;
+            static constexpr ::line_sender_column_type column_type =
+                ::line_sender_column_type_str;
+
+            static ::line_sender_row_value to_row_value(value_type value) noexcept
+            {
+                return symbol::to_row_value(value);
+            }
+        };
+
+        /** A timestamp column, in microseconds since the Unix epoch. */
+        struct ts_micros
+        {
+            using value_type = timestamp_micros;
+            static constexpr ::line_sender_column_type column_type =
+                ::line_sender_column_type_ts_micros;
+
+            static ::line_sender_row_value to_row_value(value_type value) noexcept
+            {
+                ::line_sender_row_value row_value;
+                row_value.i64 = value.as_micros();
+                return row_value;
+            }
+        };
+    }
+
     class line_sender_buffer
     {
     public:
@@ -325,19 +837,76 @@ namespace questdb::ingress
             : _impl{nullptr}
             , _init_buf_size{init_buf_size}
             , _max_name_len{max_name_len}
+            , _fixed_capacity{false}
+            , _trusted{false}
+        {
+        }
+
+        /**
+         * Construct a buffer that allocates `capacity` bytes up front and
+         * then never reallocates: Appends that could exceed the capacity
+         * throw a `line_sender_error` with the `buffer_full` code instead, and
+         * leave the buffer unchanged.
+         *
+         * Since `clear()` retains the capacity, a buffer reused across flushes
+         * never touches the allocator after construction. The exception is
+         * `append_columns()`, which allocates scratch space per call.
+         */
+        static line_sender_buffer with_fixed_capacity(
+            size_t capacity,
+            size_t max_name_len = 127)
+        {
+            line_sender_buffer buffer{capacity, max_name_len};
+            buffer._fixed_capacity = true;
+            buffer.may_init();
+            return buffer;
+        }
+
+        /**
+         * Construct a buffer that trusts its caller to follow the API's
+         * contract, for code-generated producers with fixed schemas.
+         *
+         * In release builds, it no longer checks that calls come in order
+         * (table, symbols, columns, then `at`) or that names are within
+         * `max_name_len`. Breaking either rule results in rows the server
+         * rejects, but never in undefined behaviour. Debug builds of the
+         * library still assert both rules and abort if broken.
+         *
+         * Pair it with `column_name_view::unchecked()` and friends to also
+         * skip validating names and strings.
+         */
+        static line_sender_buffer trusted(
+            size_t init_buf_size = 64 * 1024,
+            size_t max_name_len = 127)
+        {
+            line_sender_buffer buffer{init_buf_size, max_name_len};
+            buffer._trusted = true;
+            return buffer;
+        }
+
+        /** Whether the buffer trusts its caller, as per `trusted()`. */
+        bool is_trusted() const noexcept
         {
+            if (_impl)
+                return ::line_sender_buffer_is_trusted(_impl);
+            else
+                return _trusted;
         }
 
         line_sender_buffer(const line_sender_buffer& other) noexcept
             : _impl{::line_sender_buffer_clone(other._impl)}
             , _init_buf_size{other._init_buf_size}
             , _max_name_len{other._max_name_len}
+            , _fixed_capacity{other._fixed_capacity}
+            , _trusted{other._trusted}
         {}
 
         line_sender_buffer(line_sender_buffer&& other) noexcept
             : _impl{other._impl}
             , _init_buf_size{other._init_buf_size}
             , _max_name_len{other._max_name_len}
+            , _fixed_capacity{other._fixed_capacity}
+            , _trusted{other._trusted}
         {
             other._impl = nullptr;
         }
@@ -353,6 +922,8 @@ namespace questdb::ingress
                     _impl = nullptr;
                 _init_buf_size = other._init_buf_size;
                 _max_name_len = other._max_name_len;
+                _fixed_capacity = other._fixed_capacity;
+                _trusted = other._trusted;
             }
             return *this;
         }
@@ -365,6 +936,8 @@ namespace questdb::ingress
                 _impl = other._impl;
                 _init_buf_size = other._init_buf_size;
                 _max_name_len = other._max_name_len;
+                _fixed_capacity = other._fixed_capacity;
+                _trusted = other._trusted;
                 other._impl = nullptr;
             }
             return *this;
@@ -410,6 +983,19 @@ namespace questdb::ingress
                 return 0;
         }
 
+        /**
+         * The number of leading bytes already sent by a
+         * `line_sender::try_flush()` or `line_sender::flush_chunked()` that
+         * hasn't completed yet. Zero if no flush is in progress.
+         */
+        size_t send_offset() const noexcept
+        {
+            if (_impl)
+                return ::line_sender_buffer_send_offset(_impl);
+            else
+                return 0;
+        }
+
         /**
          * Tell whether the buffer is transactional. It is transactional iff it contains
          * data for at most one table. Additionally, you must send the buffer over HTTP to
@@ -423,8 +1009,61 @@ namespace questdb::ingress
                 return 0;
         }
 
-        /**
-         * Get a string representation of the contents of the buffer.
+        /** The line protocol version the buffer is encoded with. */
+        ::questdb::ingress::protocol_version protocol_version() const noexcept
+        {
+            if (_impl)
+                return static_cast<::questdb::ingress::protocol_version>(
+                    ::line_sender_buffer_protocol_version(_impl));
+            else
+                return ::questdb::ingress::protocol_version::v1;
+        }
+
+        /**
+         * Set the line protocol version to encode the buffer with.
+         * The default is `protocol_version::v1`. `line_sender::new_buffer()`
+         * creates a buffer with the sender's version already set.
+         * The buffer must be empty.
+         */
+        void set_protocol_version(::questdb::ingress::protocol_version version)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_set_protocol_version,
+                _impl,
+                static_cast<::line_sender_protocol_version>(version));
+        }
+
+        /** The unit the buffer writes designated timestamps in. */
+        ::questdb::ingress::timestamp_precision timestamp_precision()
+            const noexcept
+        {
+            if (_impl)
+                return static_cast<::questdb::ingress::timestamp_precision>(
+                    ::line_sender_buffer_timestamp_precision(_impl));
+            else
+                return ::questdb::ingress::timestamp_precision::nanos;
+        }
+
+        /**
+         * Set the unit to write designated timestamps in.
+         * The default is `timestamp_precision::nanos`.
+         * `line_sender::new_buffer()` creates a buffer with the sender's
+         * precision already set. A timestamp in the same unit is written as
+         * is, finer ones are rounded down. The buffer must be empty.
+         */
+        void set_timestamp_precision(
+            ::questdb::ingress::timestamp_precision precision)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_set_timestamp_precision,
+                _impl,
+                static_cast<::line_sender_timestamp_precision>(precision));
+        }
+
+        /**
+         * Get a string representation of the contents of the buffer.
          */
         std::string_view peek() const noexcept
         {
@@ -472,6 +1111,85 @@ namespace questdb::ingress
                 ::line_sender_buffer_clear_marker(_impl);
         }
 
+        /**
+         * The offset at which row number `row` starts, counting from 0.
+         * For `row` equal to `row_count()`, the offset just past the last
+         * complete row. Empty past that.
+         */
+        std::optional<size_t> row_offset(size_t row) const noexcept
+        {
+            if (!_impl)
+                return row == 0 ? std::optional<size_t>{0} : std::nullopt;
+            size_t offset{0};
+            if (::line_sender_buffer_row_offset(_impl, row, &offset))
+                return offset;
+            return std::nullopt;
+        }
+
+        /**
+         * Remove the complete rows from `start` (inclusive) to `end`
+         * (exclusive), moving the rows after them down, e.g. to drop the row
+         * a flush failed on and flush the rest again.
+         * The marker, if any, is cleared.
+         */
+        void drop_rows(size_t start, size_t end)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_drop_rows, _impl, start, end);
+        }
+
+        /**
+         * Split the buffer at row number `row`, keeping the rows before it
+         * and returning a new buffer, with the same settings, holding it and
+         * the rows after it.
+         */
+        line_sender_buffer split_at_row(size_t row)
+        {
+            may_init();
+            line_sender_buffer tail{_init_buf_size, _max_name_len};
+            tail._fixed_capacity = _fixed_capacity;
+            tail._trusted = _trusted;
+            tail._impl = line_sender_error::wrapped_call(
+                ::line_sender_buffer_split_at_row, _impl, row);
+            return tail;
+        }
+
+        /**
+         * Append the complete rows of `other` to the end of this buffer,
+         * leaving `other` untouched. The merged buffer is only transactional
+         * if both were and they target the same table.
+         */
+        line_sender_buffer& append_buffer(const line_sender_buffer& other)
+        {
+            may_init();
+            if (other._impl)
+                line_sender_error::wrapped_call(
+                    ::line_sender_buffer_append_buffer, _impl, other._impl);
+            return *this;
+        }
+
+        /**
+         * Append rows already serialized as ILP, without parsing them back
+         * into tables and columns. `ilp` must hold whole rows, each
+         * terminated by a newline, in the buffer's protocol version.
+         *
+         * With `validate`, each row must also start with a table name and be
+         * valid UTF-8. On error, nothing is appended.
+         */
+        line_sender_buffer& append_raw_ilp(
+            std::string_view ilp, bool validate = true)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_append_raw_ilp,
+                _impl,
+                reinterpret_cast<const uint8_t*>(ilp.data()),
+                ilp.size(),
+                validate);
+            return *this;
+        }
+
         /**
          * Remove all accumulated data and prepare the buffer for new lines.
          * This does not affect the buffer's capacity.
@@ -566,6 +1284,32 @@ namespace questdb::ingress
             return *this;
         }
 
+        /**
+         * Record a floating-point value for the given column, rounded to
+         * `decimals` places, at most 15.
+         *
+         * Faster than `column()` for values of a known precision, such as
+         * prices, and drops the noise digits. Falls back to `column()` for
+         * values too large to round exactly and with protocol version 2,
+         * whose binary format is exact.
+         *
+         * @param name Column name.
+         * @param value Column value.
+         * @param decimals Number of decimals.
+         */
+        line_sender_buffer& column_fixed(
+            column_name_view name, double value, uint8_t decimals)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_column_f64_fixed,
+                _impl,
+                name._impl,
+                value,
+                decimals);
+            return *this;
+        }
+
         /**
          * Record a string value for the given column.
          * @param name Column name.
@@ -651,6 +1395,145 @@ namespace questdb::ingress
             return *this;
         }
 
+        /**
+         * Record a long256 value for the given column.
+         * @param name Column name.
+         * @param value The 32 bytes of the value, most significant byte first.
+         */
+        line_sender_buffer& column_long256(
+            column_name_view name,
+            const std::array<uint8_t, 32>& value)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_column_long256,
+                _impl,
+                name._impl,
+                value.data());
+            return *this;
+        }
+
+        /** Record a symbol value for the given prepared column name. */
+        line_sender_buffer& symbol(
+            const prepared_column_name& name,
+            utf8_view value)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_symbol_prepared,
+                _impl,
+                name.impl(),
+                value._impl);
+            return *this;
+        }
+
+        template <typename T>
+        line_sender_buffer& column(
+            const prepared_column_name& name,
+            T value) = delete;
+
+        /** Record a boolean value for the given prepared column name. */
+        line_sender_buffer& column(const prepared_column_name& name, bool value)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_column_bool_prepared,
+                _impl,
+                name.impl(),
+                value);
+            return *this;
+        }
+
+        /** Record an integer value for the given prepared column name. */
+        line_sender_buffer& column(
+            const prepared_column_name& name,
+            int64_t value)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_column_i64_prepared,
+                _impl,
+                name.impl(),
+                value);
+            return *this;
+        }
+
+        /** Record a floating-point value for the given prepared column name. */
+        line_sender_buffer& column(
+            const prepared_column_name& name,
+            double value)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_column_f64_prepared,
+                _impl,
+                name.impl(),
+                value);
+            return *this;
+        }
+
+        /** Record a string value for the given prepared column name. */
+        line_sender_buffer& column(
+            const prepared_column_name& name,
+            utf8_view value)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_column_str_prepared,
+                _impl,
+                name.impl(),
+                value._impl);
+            return *this;
+        }
+
+        template <size_t N>
+        line_sender_buffer& column(
+            const prepared_column_name& name,
+            const char (&value)[N])
+        {
+            return column(name, utf8_view{value});
+        }
+
+        line_sender_buffer& column(
+            const prepared_column_name& name,
+            std::string_view value)
+        {
+            return column(name, utf8_view{value});
+        }
+
+        line_sender_buffer& column(
+            const prepared_column_name& name,
+            const std::string& value)
+        {
+            return column(name, utf8_view{value});
+        }
+
+        line_sender_buffer& column(
+            const prepared_column_name& name,
+            timestamp_nanos value)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_column_ts_nanos_prepared,
+                _impl,
+                name.impl(),
+                value.as_nanos());
+            return *this;
+        }
+
+        line_sender_buffer& column(
+            const prepared_column_name& name,
+            timestamp_micros value)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_column_ts_micros_prepared,
+                _impl,
+                name.impl(),
+                value.as_micros());
+            return *this;
+        }
+
         /**
          * Complete the current row with the designated timestamp in nanoseconds.
          *
@@ -689,6 +1572,27 @@ namespace questdb::ingress
                 timestamp.as_micros());
         }
 
+        /**
+         * Complete the current row with the designated timestamp in
+         * nanoseconds, like `at()`, but format it faster when consecutive rows
+         * have close timestamps.
+         *
+         * The buffer remembers the leading digits of the last timestamp passed
+         * to `at_delta()`. When the next timestamp only differs in its last 8
+         * digits, only those are formatted. The rows are identical to the ones
+         * `at()` writes.
+         *
+         * @param timestamp Number of nanoseconds since the Unix epoch.
+         */
+        void at_delta(timestamp_nanos timestamp)
+        {
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_at_delta_nanos,
+                _impl,
+                timestamp.as_nanos());
+        }
+
         /**
          * Complete the current row without providing a timestamp. The QuestDB instance
          * will insert its own timestamp.
@@ -717,50 +1621,387 @@ namespace questdb::ingress
                 _impl);
         }
 
-        ~line_sender_buffer() noexcept
+        /**
+         * Complete the current row with the current time of `clock` as the
+         * designated timestamp. Cheaper than `at(timestamp_nanos::now())`.
+         */
+        void at_clock(const fast_clock& clock)
         {
-            if (_impl)
-                ::line_sender_buffer_free(_impl);
+            may_init();
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_at_clock,
+                _impl,
+                clock.ensure_impl());
         }
-    private:
-        inline void may_init()
+
+        /**
+         * Append a batch of rows for the given table, supplied column by
+         * column, in a single call. The server assigns the timestamps, as with
+         * `at_now()`.
+         *
+         * All columns must have the same number of values. Symbol columns are
+         * written before the other columns, regardless of their position.
+         * If validation fails, the buffer is left unchanged.
+         *
+         * @code {.cpp}
+         * std::vector<double> prices{2615.54, 39269.98};
+         * std::vector<std::string> symbols{"ETH-USD", "BTC-USD"};
+         * std::vector<int64_t> timestamps{...};
+         * buffer.append_columns(
+         *     "trades",
+         *     {column_slice::symbols("symbol", symbols),
+         *      column_slice{"price", prices}},
+         *     timestamps);
+         * @endcode
+         */
+        line_sender_buffer& append_columns(
+            table_name_view table,
+            std::initializer_list<column_slice> columns)
         {
-            if (!_impl)
-            {
-                _impl = ::line_sender_buffer_with_max_name_len(_max_name_len);
-                ::line_sender_buffer_reserve(_impl, _init_buf_size);
-            }
+            return append_columns_impl(
+                table, columns.begin(), columns.size(), nullptr, 0, false);
         }
 
-        ::line_sender_buffer* _impl;
-        size_t _init_buf_size;
-        size_t _max_name_len;
+        /**
+         * Append a batch of rows with their designated timestamps, in
+         * nanoseconds since the Unix epoch.
+         * See the other overloads for details.
+         */
+        template <typename Timestamps>
+        line_sender_buffer& append_columns(
+            table_name_view table,
+            std::initializer_list<column_slice> columns,
+            const Timestamps& timestamps_nanos)
+        {
+            return append_columns_impl(
+                table,
+                columns.begin(),
+                columns.size(),
+                std::data(timestamps_nanos),
+                std::size(timestamps_nanos),
+                true);
+        }
 
-        friend class line_sender;
-    };
+        /**
+         * Append a batch of rows from any contiguous container of
+         * `column_slice` objects. The server assigns the timestamps.
+         */
+        template <typename Columns>
+        line_sender_buffer& append_columns(
+            table_name_view table,
+            const Columns& columns)
+        {
+            return append_columns_impl(
+                table, std::data(columns), std::size(columns), nullptr, 0, false);
+        }
 
-    class _user_agent
-    {
-    private:
-        static inline ::line_sender_utf8 name()
+        /**
+         * Append a batch of rows from any contiguous container of
+         * `column_slice` objects, with designated timestamps in nanoseconds
+         * since the Unix epoch.
+         */
+        template <typename Columns, typename Timestamps>
+        line_sender_buffer& append_columns(
+            table_name_view table,
+            const Columns& columns,
+            const Timestamps& timestamps_nanos)
         {
-            // Maintained by .bumpversion.cfg
-            static const char user_agent[] = "questdb/c++/4.0.3";
-            ::line_sender_utf8 utf8 = ::line_sender_utf8_assert(
-                sizeof(user_agent) - 1,
-                user_agent);
-            return utf8;
+            return append_columns_impl(
+                table,
+                std::data(columns),
+                std::size(columns),
+                std::data(timestamps_nanos),
+                std::size(timestamps_nanos),
+                true);
         }
 
-        friend class opts;
-    };
+        /**
+         * Append the rows of an Arrow record batch, exported through the Arrow
+         * C data interface, reading the column buffers in place.
+         *
+         * `timestamp_column` names the timestamp field holding the designated
+         * timestamps. Without it, the server assigns them. The string fields
+         * named in `symbol_columns` are written as symbols, as are
+         * dictionary-encoded fields. Null cells are left out of their row.
+         *
+         * The structs are only read: Releasing them remains up to the caller.
+         * If validation fails, the buffer is left unchanged.
+         *
+         * @code {.cpp}
+         * ArrowSchema schema;
+         * ArrowArray array;
+         * arrow::ExportRecordBatch(*batch, &array, &schema);
+         * buffer.append_arrow("trades", schema, array, "timestamp"_cn, {"symbol"_cn});
+         * array.release(&array);
+         * schema.release(&schema);
+         * @endcode
+         */
+        line_sender_buffer& append_arrow(
+            table_name_view table,
+            const ::ArrowSchema& schema,
+            const ::ArrowArray& array,
+            std::optional<column_name_view> timestamp_column = std::nullopt,
+            const std::vector<column_name_view>& symbol_columns = {})
+        {
+            may_init();
+            std::vector<::line_sender_column_name> c_symbols;
+            c_symbols.reserve(symbol_columns.size());
+            for (const auto& column : symbol_columns)
+                c_symbols.push_back(column._impl);
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_append_arrow,
+                _impl,
+                table._impl,
+                &schema,
+                &array,
+                timestamp_column ? &timestamp_column->_impl : nullptr,
+                c_symbols.data(),
+                c_symbols.size());
+            return *this;
+        }
 
-    class opts
-    {
-        public:
-            /**
-              * Create a new `opts` instance from the given configuration string.
-              * The format of the string is: "tcp::addr=host:port;key=value;...;"
+        /**
+         * Appends rows of a fixed table name and column layout to a buffer.
+         *
+         * The column types are fixed at compile time by the `cols` tags, and
+         * the table and column names are validated and escaped once, when the
+         * writer is created. Each `append()` then writes a complete row in a
+         * single call.
+         *
+         * Symbol columns must precede all other column types.
+         *
+         * @code {.cpp}
+         * line_sender_buffer::row_writer<cols::symbol, cols::f64, cols::i64>
+         *     trades{buffer, "trades"_tn, {"symbol"_cn, "price"_cn, "qty"_cn}};
+         * trades.append(timestamp_nanos::now(), "ETH-USD"_utf8, 2615.54, 100);
+         * @endcode
+         *
+         * The writer keeps a reference to the buffer: The buffer must outlive
+         * it and must not be moved.
+         */
+        template <typename... Cols>
+        class row_writer
+        {
+            static_assert(
+                sizeof...(Cols) > 0,
+                "A row_writer needs at least one column.");
+
+            static constexpr bool symbols_first() noexcept
+            {
+                const bool is_symbol[] = {
+                    (Cols::column_type == ::line_sender_column_type_symbol)...};
+                bool seen_field = false;
+                for (bool symbol : is_symbol)
+                {
+                    if (symbol && seen_field)
+                        return false;
+                    seen_field = seen_field || !symbol;
+                }
+                return true;
+            }
+
+            static_assert(
+                symbols_first(),
+                "Symbol columns must precede all other column types.");
+
+        public:
+            using names_type = std::array<column_name_view, sizeof...(Cols)>;
+
+            row_writer(
+                line_sender_buffer& buffer,
+                table_name_view table,
+                const names_type& names)
+                : _buffer{&buffer}
+                , _impl{nullptr}
+            {
+                std::array<::line_sender_column_name, sizeof...(Cols)> c_names;
+                for (size_t index = 0; index < names.size(); ++index)
+                    c_names[index] = names[index]._impl;
+                const ::line_sender_column_type types[] = {Cols::column_type...};
+                _impl = line_sender_error::wrapped_call(
+                    ::line_sender_row_template_new,
+                    table._impl,
+                    sizeof...(Cols),
+                    c_names.data(),
+                    types);
+            }
+
+            row_writer(const row_writer&) = delete;
+
+            row_writer(row_writer&& other) noexcept
+                : _buffer{other._buffer}
+                , _impl{other._impl}
+            {
+                other._impl = nullptr;
+            }
+
+            row_writer& operator=(const row_writer&) = delete;
+
+            row_writer& operator=(row_writer&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    ::line_sender_row_template_free(_impl);
+                    _buffer = other._buffer;
+                    _impl = other._impl;
+                    other._impl = nullptr;
+                }
+                return *this;
+            }
+
+            ~row_writer() noexcept
+            {
+                ::line_sender_row_template_free(_impl);
+            }
+
+            /**
+             * Append a complete row with the designated timestamp.
+             * If this throws, the buffer is left unchanged.
+             */
+            void append(
+                timestamp_nanos timestamp,
+                typename Cols::value_type... values)
+            {
+                const ::line_sender_row_value row[] = {
+                    Cols::to_row_value(values)...};
+                _buffer->may_init();
+                line_sender_error::wrapped_call(
+                    ::line_sender_buffer_append_row_at_nanos,
+                    _buffer->_impl,
+                    impl(),
+                    row,
+                    sizeof...(Cols),
+                    timestamp.as_nanos());
+            }
+
+            /**
+             * Append a complete row, letting the server assign the timestamp.
+             * If this throws, the buffer is left unchanged.
+             */
+            void append_now(typename Cols::value_type... values)
+            {
+                const ::line_sender_row_value row[] = {
+                    Cols::to_row_value(values)...};
+                _buffer->may_init();
+                line_sender_error::wrapped_call(
+                    ::line_sender_buffer_append_row_at_now,
+                    _buffer->_impl,
+                    impl(),
+                    row,
+                    sizeof...(Cols));
+            }
+
+        private:
+            const ::line_sender_row_template* impl() const
+            {
+                if (!_impl)
+                    throw line_sender_error{
+                        line_sender_error_code::invalid_api_call,
+                        "Row writer has been moved from."};
+                return _impl;
+            }
+
+            line_sender_buffer* _buffer;
+            ::line_sender_row_template* _impl;
+        };
+
+        ~line_sender_buffer() noexcept
+        {
+            if (_impl)
+                ::line_sender_buffer_free(_impl);
+        }
+    private:
+        inline void may_init()
+        {
+            if (_impl)
+                return;
+            if (_fixed_capacity)
+            {
+                _impl = ::line_sender_buffer_with_fixed_capacity(
+                    _max_name_len, _init_buf_size);
+            }
+            else
+            {
+                _impl = ::line_sender_buffer_with_max_name_len(_max_name_len);
+                ::line_sender_buffer_reserve(_impl, _init_buf_size);
+            }
+            if (_trusted)
+                ::line_sender_buffer_set_trusted(_impl, true);
+        }
+
+        line_sender_buffer& append_columns_impl(
+            table_name_view table,
+            const column_slice* columns,
+            size_t column_count,
+            const int64_t* timestamps_nanos,
+            size_t timestamp_count,
+            bool has_timestamps)
+        {
+            may_init();
+            const size_t row_count = column_count ? columns[0].size() : 0;
+            std::vector<::line_sender_column_slice> c_columns;
+            c_columns.reserve(column_count);
+            for (size_t index = 0; index < column_count; ++index)
+            {
+                if (columns[index].size() != row_count)
+                    throw line_sender_error{
+                        line_sender_error_code::invalid_api_call,
+                        "Bad call to `append_columns`: "
+                        "All columns must have the same number of values."};
+                c_columns.push_back(columns[index].to_c());
+            }
+            if (has_timestamps && (timestamp_count != row_count))
+                throw line_sender_error{
+                    line_sender_error_code::invalid_api_call,
+                    "Bad call to `append_columns`: "
+                    "Expected one timestamp per row."};
+            line_sender_error::wrapped_call(
+                ::line_sender_buffer_append_columns,
+                _impl,
+                table._impl,
+                row_count,
+                c_columns.data(),
+                c_columns.size(),
+                has_timestamps ? timestamps_nanos : nullptr);
+            return *this;
+        }
+
+        ::line_sender_buffer* _impl;
+        size_t _init_buf_size;
+        size_t _max_name_len;
+        bool _fixed_capacity;
+        bool _trusted;
+
+        friend class line_sender;
+        friend class background_line_sender;
+        friend class concurrent_line_sender;
+        friend class line_sender_pool;
+        friend class sharded_line_sender;
+        friend class buffer_pool;
+    };
+
+    class _user_agent
+    {
+    private:
+        static inline ::line_sender_utf8 name()
+        {
+            // Maintained by .bumpversion.cfg
+            static const char user_agent[] = "questdb/c++/4.0.3";
+            ::line_sender_utf8 utf8 = ::line_sender_utf8_assert(
+                sizeof(user_agent) - 1,
+                user_agent);
+            return utf8;
+        }
+
+        friend class opts;
+    };
+
+    class opts
+    {
+        public:
+            /**
+              * Create a new `opts` instance from the given configuration string.
+              * The format of the string is: "tcp::addr=host:port;key=value;...;"
               * Instead of "tcp" you can also specify "tcps", "http", and "https".
               *
               * The accepted keys match one-for-one with the methods on `opts`.
@@ -870,6 +2111,21 @@ namespace questdb::ingress
                 return *this;
             }
 
+            /**
+             * Add a host to fail over to when the ones before it can't be
+             * reached. Hosts are tried in the order they were added, after
+             * the one passed to the constructor.
+             */
+            opts& failover_addr(utf8_view host, uint16_t port)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_failover_addr,
+                    _impl,
+                    host._impl,
+                    port);
+                return *this;
+            }
+
             /**
              * Select local outbound network "bind" interface.
              *
@@ -968,6 +2224,92 @@ namespace questdb::ingress
                 return *this;
             }
 
+            /**
+             * Reconnect automatically in the background after an ILP/TCP
+             * write error. A flush waits for the new connection for at most
+             * this many milliseconds, then replays the last `replay_buffers()`
+             * buffers and resends its own.
+             * A value of 0 disables reconnecting, which is the default.
+             * TCP only.
+             */
+            opts& reconnect_timeout(uint64_t millis)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_reconnect_timeout,
+                    _impl,
+                    millis);
+                return *this;
+            }
+
+            /**
+             * The number of most recently flushed buffers to keep a copy of
+             * and replay after reconnecting, for at-least-once delivery.
+             * The default is 0. TCP only.
+             */
+            opts& replay_buffers(size_t count)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_replay_buffers,
+                    _impl,
+                    count);
+                return *this;
+            }
+
+            /**
+             * How the sender writes to its socket.
+             * The default is `io_backend::std`.
+             * `io_backend::uring` requires Linux and doesn't support
+             * non-blocking mode. TCP only.
+             */
+            opts& io_backend(::questdb::ingress::io_backend backend)
+            {
+                ::line_sender_io_backend backend_impl =
+                    static_cast<::line_sender_io_backend>(backend);
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_io_backend,
+                    _impl,
+                    backend_impl);
+                return *this;
+            }
+
+            /**
+             * Have a kernel thread poll the io_uring for submissions and
+             * busy-poll for completions, trading a CPU core for latency.
+             * The default is `false`.
+             */
+            opts& uring_sqpoll(bool sqpoll)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_uring_sqpoll,
+                    _impl,
+                    sqpoll);
+                return *this;
+            }
+
+            /** Pin the io_uring's SQPOLL kernel thread to a CPU. */
+            opts& uring_sqpoll_cpu(uint32_t cpu)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_uring_sqpoll_cpu,
+                    _impl,
+                    cpu);
+                return *this;
+            }
+
+            /**
+             * Send writes of at least this many bytes without copying them
+             * into the kernel. A value of 0 always copies.
+             * The default is 64 KiB.
+             */
+            opts& uring_zc_threshold(size_t threshold)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_uring_zc_threshold,
+                    _impl,
+                    threshold);
+                return *this;
+            }
+
             /**
              * Set to `false` to disable TLS certificate verification.
              * This should only be used for debugging purposes as it reduces security.
@@ -1028,93 +2370,398 @@ namespace questdb::ingress
             }
 
             /**
-             * Set the cumulative duration spent in retries.
-             * The value is in milliseconds, and the default is 10 seconds.
+             * Enable or disable the auto-flush thresholds checked by
+             * `line_sender::should_flush()`. The default is enabled.
              */
-            opts& retry_timeout(uint64_t millis)
+            opts& auto_flush(bool enabled)
             {
                 line_sender_error::wrapped_call(
-                    ::line_sender_opts_retry_timeout,
+                    ::line_sender_opts_auto_flush,
                     _impl,
-                    millis);
+                    enabled);
                 return *this;
             }
 
             /**
-             * Set the minimum acceptable throughput while sending a buffer to the server.
-             * The sender will divide the payload size by this number to determine for how
-             * long to keep sending the payload before timing out.
-             * The value is in bytes per second, and the default is 100 KiB/s.
-             * The timeout calculated from minimum throughput is adedd to the value of
-             * `request_timeout`.
-             *
-             * See also: `request_timeout()`
+             * Set the number of rows after which a buffer is due to be flushed.
+             * A value of 0 disables the row threshold.
+             * The default is 75000 rows for HTTP and 600 rows for TCP.
              */
-            opts& request_min_throughput(uint64_t bytes_per_sec)
+            opts& auto_flush_rows(size_t rows)
             {
                 line_sender_error::wrapped_call(
-                    ::line_sender_opts_request_min_throughput,
+                    ::line_sender_opts_auto_flush_rows,
                     _impl,
-                    bytes_per_sec);
+                    rows);
                 return *this;
             }
 
             /**
-             * Additional time to wait on top of that calculated from the minimum throughput.
-             * This accounts for the fixed latency of the HTTP request-response roundtrip.
-             * The value is in milliseconds, and the default is 10 seconds.
-             *
-             * See also: `request_min_throughput()`
+             * Set the number of bytes after which a buffer is due to be flushed.
+             * A value of 0 disables the byte threshold, which is the default.
              */
-            opts& request_timeout(uint64_t millis)
+            opts& auto_flush_bytes(size_t bytes)
             {
                 line_sender_error::wrapped_call(
-                    ::line_sender_opts_request_timeout,
+                    ::line_sender_opts_auto_flush_bytes,
+                    _impl,
+                    bytes);
+                return *this;
+            }
+
+            /**
+             * Set the time since the previous flush after which a buffer is due
+             * to be flushed. The value is in milliseconds, and the default is
+             * 1 second. A value of 0 disables the time threshold.
+             */
+            opts& auto_flush_interval(uint64_t millis)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_auto_flush_interval,
                     _impl,
                     millis);
                 return *this;
             }
 
-            ~opts() noexcept
+            /**
+             * Compress the body of each HTTP request.
+             * The default is `compression::none`.
+             * The compression context is reused across flushes, and the
+             * `request_min_throughput` timeout is calculated from the
+             * compressed size.
+             */
+            opts& compression(::questdb::ingress::compression compression)
             {
-                reset();
+                ::line_sender_compression compression_impl =
+                    static_cast<::line_sender_compression>(compression);
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_compression,
+                    _impl,
+                    compression_impl);
+                return *this;
             }
-        private:
-            opts(::line_sender_opts* impl) : _impl{impl}
-            {}
 
-            void reset() noexcept
+            /**
+             * Cap the rate data is sent at, in bytes per second.
+             * A value of 0 disables the limit, which is the default.
+             * The senders of a `line_sender_pool` share the limit.
+             */
+            opts& max_send_rate(uint64_t bytes_per_sec)
             {
-                if (_impl)
-                {
-                    ::line_sender_opts_free(_impl);
-                    _impl = nullptr;
-                }
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_max_send_rate,
+                    _impl,
+                    bytes_per_sec);
+                return *this;
             }
 
-            friend class line_sender;
+            /**
+             * Cap the rate rows are sent at, in rows per second.
+             * A value of 0 disables the limit, which is the default.
+             * The senders of a `line_sender_pool` share the limit.
+             */
+            opts& max_rows_rate(uint64_t rows_per_sec)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_max_rows_rate,
+                    _impl,
+                    rows_per_sec);
+                return *this;
+            }
 
-            ::line_sender_opts* _impl;
-    };
+            /**
+             * Set the number of connections opened by a `line_sender_pool`.
+             * The default is 1.
+             */
+            opts& pool_size(size_t pool_size)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_pool_size,
+                    _impl,
+                    pool_size);
+                return *this;
+            }
 
-    /**
-     * Inserts data into QuestDB via the InfluxDB Line Protocol.
-     *
-     * Batch up rows in a `line_sender_buffer` object, then call
-     * `.flush()` or one of its variants to send.
-     *
-     * When you use ILP-over-TCP, the `line_sender` object connects on construction.
-     * If you want to connect later, wrap it in an std::optional.
-     */
-    class line_sender
-    {
-    public:
-        /**
-         * Create a new line sender instance from the given configuration string.
-         * The format of the string is: "tcp::addr=host:port;key=value;...;"
-         * Instead of "tcp" you can also specify "tcps", "http", and "https".
-         *
-         * The accepted keys match one-for-one with the methods on `opts`.
+            /**
+             * Set the version of the line protocol to send.
+             * The default is `protocol_version::v1`.
+             */
+            opts& protocol_version(::questdb::ingress::protocol_version version)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_protocol_version,
+                    _impl,
+                    static_cast<::line_sender_protocol_version>(version));
+                return *this;
+            }
+
+            /**
+             * Ask the server which version of the line protocol to send when
+             * the sender is built, falling back to `protocol_version::v1`.
+             * Only ILP/HTTP servers are asked: ILP/TCP senders use version 1.
+             */
+            opts& protocol_version_auto()
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_protocol_version_auto,
+                    _impl);
+                return *this;
+            }
+
+            /**
+             * Set the unit to write designated timestamps in. The sender only
+             * flushes buffers of this precision: Create them with
+             * `line_sender::new_buffer()`. Over HTTP, it's sent as the
+             * `precision` of each request. Over TCP, it must match the
+             * server's `line.tcp.timestamp` setting.
+             * The default is `timestamp_precision::nanos`.
+             */
+            opts& timestamp_precision(
+                ::questdb::ingress::timestamp_precision precision)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_timestamp_precision,
+                    _impl,
+                    static_cast<::line_sender_timestamp_precision>(precision));
+                return *this;
+            }
+
+            /**
+             * Set the cumulative duration spent in retries.
+             * The value is in milliseconds, and the default is 10 seconds.
+             */
+            opts& retry_timeout(uint64_t millis)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_retry_timeout,
+                    _impl,
+                    millis);
+                return *this;
+            }
+
+            /**
+             * Set the minimum acceptable throughput while sending a buffer to the server.
+             * The sender will divide the payload size by this number to determine for how
+             * long to keep sending the payload before timing out.
+             * The value is in bytes per second, and the default is 100 KiB/s.
+             * The timeout calculated from minimum throughput is adedd to the value of
+             * `request_timeout`.
+             *
+             * See also: `request_timeout()`
+             */
+            opts& request_min_throughput(uint64_t bytes_per_sec)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_request_min_throughput,
+                    _impl,
+                    bytes_per_sec);
+                return *this;
+            }
+
+            /**
+             * Additional time to wait on top of that calculated from the minimum throughput.
+             * This accounts for the fixed latency of the HTTP request-response roundtrip.
+             * The value is in milliseconds, and the default is 10 seconds.
+             *
+             * See also: `request_min_throughput()`
+             */
+            opts& request_timeout(uint64_t millis)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_request_timeout,
+                    _impl,
+                    millis);
+                return *this;
+            }
+
+            /**
+             * Set how the interval between retries grows.
+             * The default is `retry_backoff::exponential`.
+             */
+            opts& retry_backoff(::questdb::ingress::retry_backoff backoff)
+            {
+                ::line_sender_retry_backoff backoff_impl =
+                    static_cast<::line_sender_retry_backoff>(backoff);
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_retry_backoff,
+                    _impl,
+                    backoff_impl);
+                return *this;
+            }
+
+            /**
+             * Wait at least as long as the `Retry-After` header of a 503 or
+             * 529 response asks for before retrying. The default is `true`.
+             */
+            opts& retry_after(bool enabled)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_retry_after,
+                    _impl,
+                    enabled);
+                return *this;
+            }
+
+            /**
+             * Limit the retries of all the senders in the process configured
+             * with the same value to this many per second.
+             * The default is 0, meaning no limit.
+             */
+            opts& retry_budget(uint32_t retries_per_sec)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_retry_budget,
+                    _impl,
+                    retries_per_sec);
+                return *this;
+            }
+
+            /**
+             * Fail flushes fast, without contacting the server, after this
+             * many consecutive requests failed with a 5xx error or a network
+             * error. The default is 0, which disables the circuit breaker.
+             */
+            opts& circuit_breaker_threshold(uint32_t failures)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_circuit_breaker_threshold,
+                    _impl,
+                    failures);
+                return *this;
+            }
+
+            /**
+             * How long an open circuit breaker fails flushes fast before
+             * letting a request through again.
+             * The value is in milliseconds, and the default is 5 seconds.
+             */
+            opts& circuit_breaker_cooldown(uint64_t millis)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_circuit_breaker_cooldown,
+                    _impl,
+                    millis);
+                return *this;
+            }
+
+            /**
+             * Open the connection when the sender is built, rather than on
+             * the first flush, and keep it open whilst the sender is idle by
+             * pinging the server every `ping_interval`.
+             * Building the sender throws if no host answers.
+             * The default is off.
+             */
+            opts& prewarm(bool enabled)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_prewarm,
+                    _impl,
+                    enabled);
+                return *this;
+            }
+
+            /**
+             * How long the connection may sit idle before a pre-warmed sender
+             * pings the server. The value is in milliseconds, and the default
+             * is 10 seconds. Pass 0 to only warm up the connection when the
+             * sender is built.
+             */
+            opts& ping_interval(uint64_t millis)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_ping_interval,
+                    _impl,
+                    millis);
+                return *this;
+            }
+
+            /**
+             * The most bytes of a `line_sender::flush_stream` request kept in
+             * memory to resend it if an attempt fails. A longer stream isn't
+             * retried. The default is 16 MiB.
+             */
+            opts& stream_replay_window(size_t bytes)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_stream_replay_window,
+                    _impl,
+                    bytes);
+                return *this;
+            }
+
+            /**
+             * Spool the flushes that still fail with a network error, or a
+             * retriable server error, once the `retry_timeout` is exhausted
+             * to segment files in the given directory, instead of throwing.
+             * A background thread replays them in order once the server
+             * accepts them again. Until the spool is drained, new flushes are
+             * appended to it.
+             * The directory must not be shared with another sender.
+             */
+            opts& spool_dir(utf8_view path)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_spool_dir,
+                    _impl,
+                    path._impl);
+                return *this;
+            }
+
+            /**
+             * The maximum size of the files in the spool directory.
+             * Once the spool is full, flushes that can't be sent throw again.
+             * The default is 1 GiB.
+             */
+            opts& spool_max_bytes(uint64_t max_bytes)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_opts_spool_max_bytes,
+                    _impl,
+                    max_bytes);
+                return *this;
+            }
+
+            ~opts() noexcept
+            {
+                reset();
+            }
+        private:
+            opts(::line_sender_opts* impl) : _impl{impl}
+            {}
+
+            void reset() noexcept
+            {
+                if (_impl)
+                {
+                    ::line_sender_opts_free(_impl);
+                    _impl = nullptr;
+                }
+            }
+
+            friend class line_sender;
+            friend class line_sender_pool;
+
+            ::line_sender_opts* _impl;
+    };
+
+    /**
+     * Inserts data into QuestDB via the InfluxDB Line Protocol.
+     *
+     * Batch up rows in a `line_sender_buffer` object, then call
+     * `.flush()` or one of its variants to send.
+     *
+     * When you use ILP-over-TCP, the `line_sender` object connects on construction.
+     * If you want to connect later, wrap it in an std::optional.
+     */
+    class line_sender
+    {
+    public:
+        /**
+         * Create a new line sender instance from the given configuration string.
+         * The format of the string is: "tcp::addr=host:port;key=value;...;"
+         * Instead of "tcp" you can also specify "tcps", "http", and "https".
+         *
+         * The accepted keys match one-for-one with the methods on `opts`.
          * For example, this is a valid configuration string:
          *
          * "https::addr=host:port;username=alice;password=secret;"
@@ -1218,6 +2865,103 @@ namespace questdb::ingress
                 buffer._impl);
         }
 
+        /**
+         * Send the given buffer of rows to the QuestDB server, clearing the
+         * buffer, like `flush()`, but split it into as many back-to-back
+         * requests of at most `max_buf_size` bytes as needed, cut at row
+         * boundaries.
+         *
+         * The flush is never transactional. If a request fails, the rows
+         * already sent stay in the buffer, their size reported by
+         * `buffer.send_offset()`. Call this method again with the same
+         * buffer to resume from the first unsent row, or clear the buffer.
+         */
+        void flush_chunked(line_sender_buffer& buffer)
+        {
+            buffer.may_init();
+            ensure_impl();
+            line_sender_error::wrapped_call(
+                ::line_sender_flush_chunked,
+                _impl,
+                buffer._impl);
+        }
+
+        /**
+         * Send a batch of rows too large to buffer whole as a single ILP/HTTP
+         * request, serializing them chunk by chunk as the request body is
+         * sent.
+         *
+         * `fill` is called with an empty buffer to write the next rows into,
+         * and returns whether more rows follow. With `transactional`, all the
+         * rows must belong to the same table. A failed attempt is retried by
+         * resending the rows from a replay window of up to
+         * `stream_replay_window` bytes. An exception thrown by `fill` aborts
+         * the request and is rethrown. Only supported for ILP over HTTP.
+         */
+        void flush_stream(
+            bool transactional,
+            const std::function<bool(line_sender_buffer&)>& fill)
+        {
+            ensure_impl();
+            struct context
+            {
+                const std::function<bool(line_sender_buffer&)>& fill;
+                std::exception_ptr error;
+            } ctx{fill, nullptr};
+            auto callback = [](
+                                void* ctx_ptr,
+                                ::line_sender_buffer* impl,
+                                bool* more,
+                                ::line_sender_error**) -> bool
+            {
+                auto& ctx = *static_cast<context*>(ctx_ptr);
+                // The chunk buffer belongs to the sender.
+                line_sender_buffer buffer{size_t{0}};
+                buffer._impl = impl;
+                try
+                {
+                    *more = ctx.fill(buffer);
+                }
+                catch (...)
+                {
+                    ctx.error = std::current_exception();
+                }
+                buffer._impl = nullptr;
+                return !ctx.error;
+            };
+            ::line_sender_error* c_err{nullptr};
+            const bool ok = ::line_sender_flush_stream(
+                _impl, transactional, callback, &ctx, &c_err);
+            if (ctx.error)
+            {
+                if (c_err)
+                    ::line_sender_error_free(c_err);
+                std::rethrow_exception(ctx.error);
+            }
+            if (!ok)
+                throw line_sender_error::from_c(c_err);
+        }
+
+        /**
+         * Send a file of pre-serialized ILP rows, such as one written out
+         * from `line_sender_buffer::peek()` while the server was unreachable.
+         *
+         * The file is memory-mapped and checked for complete rows, none
+         * longer than `max_buf_size`, before anything is sent. The rows are
+         * then sent in runs of up to `max_buf_size` bytes, each as a write or
+         * request of its own. Plain TCP connections on Linux use
+         * `sendfile(2)`. If a run fails, the runs before it have already been
+         * sent.
+         */
+        void send_file(utf8_view path)
+        {
+            ensure_impl();
+            line_sender_error::wrapped_call(
+                ::line_sender_send_file,
+                _impl,
+                path._impl);
+        }
+
         /**
          * Send the given buffer of rows to the QuestDB server.
          *
@@ -1248,37 +2992,245 @@ namespace questdb::ingress
         }
 
         /**
-         * Check if an error occurred previously and the sender must be closed.
-         * This happens when there was an earlier failure.
-         * This method is specific to ILP-over-TCP and is not relevant for ILP-over-HTTP.
-         * @return true if an error occurred with a sender and it must be closed.
+         * Send several buffers of rows to the QuestDB server, clearing them.
+         *
+         * With ILP-over-TCP, all the buffers are written to the socket in a
+         * single scatter-gather call where possible, without first being
+         * concatenated. If the write fails, none of the buffers are cleared.
+         *
+         * With ILP-over-HTTP, each buffer is sent as a separate request, in
+         * order. If a request fails, the buffers sent before it are cleared.
+         *
+         * @code {.cpp}
+         * sender.flush_many({buffer1, buffer2});
+         * @endcode
          */
-        bool must_close() const noexcept
+        void flush_many(
+            std::initializer_list<std::reference_wrapper<line_sender_buffer>>
+                buffers)
         {
-            return _impl
-                ? ::line_sender_must_close(_impl)
-                : false;
+            flush_many_impl(buffers.begin(), buffers.end());
         }
 
         /**
-         * Close the connection. Does not flush. Idempotent.
+         * Send all the buffers of a container, such as a
+         * `std::vector<line_sender_buffer>`, clearing them.
+         * See the other overload for details.
          */
-        void close() noexcept
+        template <typename Buffers>
+        void flush_many(Buffers& buffers)
         {
-            if (_impl)
-            {
-                ::line_sender_close(_impl);
-                _impl = nullptr;
-            }
+            flush_many_impl(std::begin(buffers), std::end(buffers));
         }
 
-        ~line_sender() noexcept
+        /**
+         * Switch an ILP-over-TCP sender in or out of non-blocking mode.
+         *
+         * In non-blocking mode, send buffers with `try_flush()`, and register
+         * `raw_socket()` with your event loop. The blocking flush methods
+         * throw in this mode.
+         */
+        void set_nonblocking(bool nonblocking)
         {
-            close();
-        }
+            ensure_impl();
+            line_sender_error::wrapped_call(
+                ::line_sender_set_nonblocking,
+                _impl,
+                nonblocking);
+        }
+
+        /**
+         * Send as much of the buffer as the socket accepts without blocking.
+         *
+         * Returns true once the whole buffer is sent, at which point the
+         * buffer is cleared. Otherwise, returns false and records the progress
+         * in the buffer: Call `try_flush()` with the same buffer again once
+         * the socket is writable. Don't clear the buffer in the meantime.
+         *
+         * With `max_send_rate` or `max_rows_rate` set, a call may send less
+         * than the socket would accept, or nothing. Wait for
+         * `try_flush_delay()` before calling again, rather than polling.
+         *
+         * This method is specific to ILP-over-TCP.
+         */
+        bool try_flush(line_sender_buffer& buffer)
+        {
+            buffer.may_init();
+            ensure_impl();
+            bool done{false};
+            line_sender_error::wrapped_call(
+                ::line_sender_try_flush,
+                _impl,
+                buffer._impl,
+                &done);
+            return done;
+        }
+
+        /**
+         * How long until `try_flush()` may send again under the
+         * `max_send_rate` and `max_rows_rate` limits. Zero without limits, or
+         * if it can send right away.
+         */
+        std::chrono::microseconds try_flush_delay() const
+        {
+            ensure_impl();
+            return std::chrono::microseconds{
+                ::line_sender_try_flush_delay_micros(_impl)};
+        }
+
+        /**
+         * The raw socket of an ILP-over-TCP sender: A file descriptor on
+         * POSIX systems, a `SOCKET` on Windows. Register it with `epoll`,
+         * `kqueue`, IOCP and the like.
+         *
+         * Returns `std::nullopt` for ILP-over-HTTP, or if the sender is
+         * closed. The sender retains ownership of the socket: Don't close it.
+         */
+        std::optional<::line_sender_socket> raw_socket() const noexcept
+        {
+            ::line_sender_socket socket{};
+            if (_impl && ::line_sender_raw_socket(_impl, &socket))
+                return socket;
+            return std::nullopt;
+        }
+
+        /**
+         * The version of the line protocol the sender was built with, or
+         * negotiated with the server.
+         */
+        ::questdb::ingress::protocol_version protocol_version() const
+        {
+            ensure_impl();
+            return static_cast<::questdb::ingress::protocol_version>(
+                ::line_sender_get_protocol_version(_impl));
+        }
+
+        /** The unit the sender expects designated timestamps in. */
+        ::questdb::ingress::timestamp_precision timestamp_precision() const
+        {
+            ensure_impl();
+            return static_cast<::questdb::ingress::timestamp_precision>(
+                ::line_sender_get_timestamp_precision(_impl));
+        }
+
+        /**
+         * A new, empty buffer encoded with the sender's `protocol_version()`
+         * and `timestamp_precision()`.
+         */
+        line_sender_buffer new_buffer() const
+        {
+            ensure_impl();
+            line_sender_buffer buffer;
+            buffer._impl = ::line_sender_new_buffer(_impl);
+            return buffer;
+        }
+
+        /**
+         * Open a connection to the server ahead of the next flush by sending
+         * a `GET /ping` request, replacing the pooled connection if it was
+         * dropped whilst idle. Fails over between the hosts listed in `addr`.
+         * This is a no-op for ILP/TCP.
+         */
+        void warm_up()
+        {
+            ensure_impl();
+            line_sender_error::wrapped_call(::line_sender_warm_up, _impl);
+        }
+
+        /**
+         * A snapshot of the sender's flush counters and latency percentiles.
+         *
+         * The counters are updated without locking, so this is cheap enough
+         * to call from a periodic metrics exporter.
+         */
+        sender_stats stats() const
+        {
+            ensure_impl();
+            sender_stats stats{};
+            ::line_sender_get_stats(_impl, &stats);
+            return stats;
+        }
+
+        /**
+         * Register a callback that receives a timed `::line_sender_span` for
+         * each stage of every flush, ending with the flush as a whole.
+         * Replaces any previous callback. Pass `nullptr` to stop tracing.
+         *
+         * The callback runs synchronously on the flushing thread: Keep it
+         * short. A plain function pointer keeps the tracing overhead down.
+         */
+        void set_trace_callback(
+            ::line_sender_trace_callback callback, void* ctx = nullptr)
+        {
+            ensure_impl();
+            ::line_sender_set_trace_callback(_impl, callback, ctx);
+        }
+
+        /**
+         * Tell whether the buffer has reached any of the auto-flush thresholds
+         * (`auto_flush_rows`, `auto_flush_bytes` and `auto_flush_interval`)
+         * and should now be flushed.
+         *
+         * A buffer is only ever due after a call to `at()` or `at_now()`.
+         * Always returns false if the sender was configured with
+         * `auto_flush=off`.
+         */
+        bool should_flush(const line_sender_buffer& buffer) const noexcept
+        {
+            return _impl && buffer._impl
+                ? ::line_sender_should_flush(_impl, buffer._impl)
+                : false;
+        }
+
+        /**
+         * Flush and clear the buffer if `should_flush()` reports it as due.
+         * Call this after completing each row.
+         *
+         * The buffer is sent with `flush_chunked()`, so a buffer that the
+         * last row took past `max_buf_size` is split into requests of at
+         * most `max_buf_size` bytes rather than rejected.
+         * @return true if the buffer was flushed.
+         */
+        bool flush_if_due(line_sender_buffer& buffer)
+        {
+            if (!should_flush(buffer))
+                return false;
+            flush_chunked(buffer);
+            return true;
+        }
+
+        /**
+         * Check if an error occurred previously and the sender must be closed.
+         * This happens when there was an earlier failure.
+         * This method is specific to ILP-over-TCP and is not relevant for ILP-over-HTTP.
+         * @return true if an error occurred with a sender and it must be closed.
+         */
+        bool must_close() const noexcept
+        {
+            return _impl
+                ? ::line_sender_must_close(_impl)
+                : false;
+        }
+
+        /**
+         * Close the connection. Does not flush. Idempotent.
+         */
+        void close() noexcept
+        {
+            if (_impl)
+            {
+                ::line_sender_close(_impl);
+                _impl = nullptr;
+            }
+        }
+
+        ~line_sender() noexcept
+        {
+            close();
+        }
 
     private:
-        void ensure_impl()
+        void ensure_impl() const
         {
             if (!_impl)
                 throw line_sender_error{
@@ -1286,7 +3238,820 @@ namespace questdb::ingress
                     "Sender closed."};
         }
 
+        template <typename It>
+        void flush_many_impl(It first, It last)
+        {
+            ensure_impl();
+            std::vector<::line_sender_buffer*> impls;
+            for (; first != last; ++first)
+            {
+                line_sender_buffer& buffer = *first;
+                buffer.may_init();
+                impls.push_back(buffer._impl);
+            }
+            line_sender_error::wrapped_call(
+                ::line_sender_flush_many,
+                _impl,
+                impls.data(),
+                impls.size());
+        }
+
         ::line_sender* _impl;
+
+        friend class background_line_sender;
+        friend class concurrent_line_sender;
+    };
+
+    /**
+     * Tracks the completion of a flush submitted to a `background_line_sender`.
+     *
+     * Destroying the handle without waiting does not cancel the flush.
+     */
+    class flush_handle
+    {
+    public:
+        flush_handle(const flush_handle&) = delete;
+
+        flush_handle(flush_handle&& other) noexcept
+            : _impl{other._impl}
+        {
+            other._impl = nullptr;
+        }
+
+        flush_handle& operator=(const flush_handle&) = delete;
+
+        flush_handle& operator=(flush_handle&& other) noexcept
+        {
+            if (this != &other)
+            {
+                ::line_sender_flush_handle_free(_impl);
+                _impl = other._impl;
+                other._impl = nullptr;
+            }
+            return *this;
+        }
+
+        /**
+         * Tell whether the flush has completed, without blocking.
+         * Once this returns true, `wait()` returns immediately.
+         */
+        bool is_done() noexcept
+        {
+            return _impl
+                ? ::line_sender_flush_handle_is_done(_impl)
+                : true;
+        }
+
+        /**
+         * Block until the flush has completed.
+         * Throws a `line_sender_error` if the flush failed.
+         * May only be called once.
+         */
+        void wait()
+        {
+            if (!_impl)
+                throw line_sender_error{
+                    line_sender_error_code::invalid_api_call,
+                    "Flush handle already waited on."};
+            ::line_sender_flush_handle* impl = _impl;
+            _impl = nullptr;
+            line_sender_error::wrapped_call(
+                ::line_sender_flush_handle_wait,
+                impl);
+        }
+
+        ~flush_handle() noexcept
+        {
+            ::line_sender_flush_handle_free(_impl);
+        }
+
+    private:
+        explicit flush_handle(::line_sender_flush_handle* impl) noexcept
+            : _impl{impl}
+        {}
+
+        ::line_sender_flush_handle* _impl;
+
+        friend class background_line_sender;
+        friend class concurrent_line_sender;
+    };
+
+    /**
+     * A shared free list of buffers, so that batches can be prepared without
+     * allocating a fresh buffer for each of them.
+     *
+     * Memory use is bounded by two limits. A returned buffer that grew past
+     * `max_capacity` bytes, say to hold one outlier batch, is shrunk back down
+     * to it. Buffers returned whilst `max_idle` are already idle are freed.
+     *
+     * `acquire()` and `release()` may be called from multiple threads at once.
+     * The pool can also be shared with a `background_line_sender` or a
+     * `line_sender_pool`, which then recycle buffers to the same limits.
+     *
+     * Buffers are encoded with `protocol_version::v1` and nanosecond
+     * timestamps unless constructed with other settings or for a sender.
+     */
+    class buffer_pool
+    {
+    public:
+        buffer_pool(size_t max_capacity, size_t max_idle)
+            : _impl{::line_sender_buffer_pool_new(max_capacity, max_idle)}
+        {
+        }
+
+        buffer_pool(
+            size_t max_capacity,
+            size_t max_idle,
+            protocol_version version,
+            timestamp_precision precision)
+            : _impl{::line_sender_buffer_pool_new_with_encoding(
+                  max_capacity,
+                  max_idle,
+                  static_cast<::line_sender_protocol_version>(version),
+                  static_cast<::line_sender_timestamp_precision>(precision))}
+        {
+        }
+
+        /**
+         * A pool whose buffers match the sender's protocol version and
+         * timestamp precision, like those of `line_sender::new_buffer()`.
+         */
+        buffer_pool(
+            const line_sender& sender, size_t max_capacity, size_t max_idle)
+            : buffer_pool{
+                  max_capacity,
+                  max_idle,
+                  sender.protocol_version(),
+                  sender.timestamp_precision()}
+        {
+        }
+
+        buffer_pool(const buffer_pool&) = delete;
+
+        buffer_pool(buffer_pool&& other) noexcept
+            : _impl{other._impl}
+        {
+            other._impl = nullptr;
+        }
+
+        buffer_pool& operator=(const buffer_pool&) = delete;
+
+        buffer_pool& operator=(buffer_pool&& other) noexcept
+        {
+            if (this != &other)
+            {
+                ::line_sender_buffer_pool_free(_impl);
+                _impl = other._impl;
+                other._impl = nullptr;
+            }
+            return *this;
+        }
+
+        /** Take an empty buffer from the pool, or create a new one. */
+        line_sender_buffer acquire() const
+        {
+            ensure_impl();
+            line_sender_buffer buffer;
+            buffer._impl = ::line_sender_buffer_pool_acquire(_impl);
+            return buffer;
+        }
+
+        /**
+         * Return a buffer to the pool, discarding its contents.
+         * The buffer needn't have come from this pool: Its settings, such as
+         * being trusted, are reset to those of a buffer the pool creates.
+         */
+        void release(line_sender_buffer&& buffer) const
+        {
+            ensure_impl();
+            ::line_sender_buffer_pool_release(_impl, buffer._impl);
+            buffer._impl = nullptr;
+        }
+
+        /** The number of buffers currently waiting in the pool. */
+        size_t idle() const noexcept
+        {
+            return _impl ? ::line_sender_buffer_pool_idle(_impl) : 0;
+        }
+
+        ~buffer_pool() noexcept
+        {
+            ::line_sender_buffer_pool_free(_impl);
+        }
+
+    private:
+        void ensure_impl() const
+        {
+            if (!_impl)
+                throw line_sender_error{
+                    line_sender_error_code::invalid_api_call,
+                    "Buffer pool moved."};
+        }
+
+        ::line_sender_buffer_pool* _impl;
+
+        friend class background_line_sender;
+        friend class concurrent_line_sender;
+        friend class line_sender_pool;
+    };
+
+    /**
+     * Flushes buffers from a dedicated I/O thread.
+     *
+     * The I/O thread owns the connection. Flushing hands the filled buffer over
+     * to the I/O thread and swaps in an empty buffer from a small ring, so the
+     * caller can keep appending rows whilst the previous batch is in flight.
+     *
+     * Flushes are sent in the order they were submitted. If a flush fails, its
+     * rows are discarded and the error is reported via its `flush_handle`.
+     */
+    class background_line_sender
+    {
+    public:
+        /**
+         * Move the sender to a dedicated I/O thread.
+         *
+         * The `sender` is left closed, even if this constructor throws.
+         *
+         * @param sender The connected sender.
+         * @param ring_size Number of buffers that may be in flight at any one
+         *                  time.
+         */
+        explicit background_line_sender(
+            line_sender&& sender,
+            size_t ring_size = 2)
+            : _impl{nullptr}
+        {
+            sender.ensure_impl();
+            ::line_sender* impl = sender._impl;
+            sender._impl = nullptr;
+            _impl = line_sender_error::wrapped_call(
+                ::line_sender_into_background,
+                impl,
+                ring_size);
+        }
+
+        /**
+         * Move the sender to a dedicated I/O thread, drawing the ring's
+         * buffers from `buffers`.
+         *
+         * Each buffer is shrunk back to the pool's `max_capacity` after it's
+         * sent, and the ring is returned to the pool on `close()`. The pool
+         * is kept alive for as long as the background sender needs it.
+         */
+        background_line_sender(
+            line_sender&& sender,
+            size_t ring_size,
+            const buffer_pool& buffers)
+            : _impl{nullptr}
+        {
+            sender.ensure_impl();
+            buffers.ensure_impl();
+            ::line_sender* impl = sender._impl;
+            sender._impl = nullptr;
+            _impl = line_sender_error::wrapped_call(
+                ::line_sender_into_background_with_pool,
+                impl,
+                ring_size,
+                buffers._impl);
+        }
+
+        background_line_sender(const background_line_sender&) = delete;
+
+        background_line_sender(background_line_sender&& other) noexcept
+            : _impl{other._impl}
+        {
+            other._impl = nullptr;
+        }
+
+        background_line_sender& operator=(const background_line_sender&) = delete;
+
+        background_line_sender& operator=(background_line_sender&& other) noexcept
+        {
+            if (this != &other)
+            {
+                close();
+                _impl = other._impl;
+                other._impl = nullptr;
+            }
+            return *this;
+        }
+
+        /**
+         * Hand the buffer over to the I/O thread to be sent, leaving `buffer`
+         * empty and ready for the next batch.
+         *
+         * Returns as soon as the buffer is queued. If all the buffers of the
+         * ring are in flight, this blocks until the I/O thread returns one.
+         */
+        flush_handle flush(line_sender_buffer& buffer)
+        {
+            buffer.may_init();
+            ensure_impl();
+            return flush_handle{line_sender_error::wrapped_call(
+                ::line_sender_background_flush,
+                _impl,
+                buffer._impl)};
+        }
+
+        /**
+         * Wait for all queued flushes to complete, then stop the I/O thread
+         * and close the connection. Idempotent.
+         */
+        void close() noexcept
+        {
+            if (_impl)
+            {
+                ::line_sender_background_close(_impl);
+                _impl = nullptr;
+            }
+        }
+
+        ~background_line_sender() noexcept
+        {
+            close();
+        }
+
+    private:
+        void ensure_impl()
+        {
+            if (!_impl)
+                throw line_sender_error{
+                    line_sender_error_code::invalid_api_call,
+                    "Sender closed."};
+        }
+
+        ::line_sender_background* _impl;
+    };
+
+    /**
+     * Gathers the rows committed by many threads into large requests over a
+     * single connection.
+     *
+     * Each thread fills a `line_sender_buffer` of its own, without any
+     * locking, and hands it over with `commit()`, which may be called from
+     * many threads at once. The flusher thread, which owns the connection,
+     * gathers all the buffers committed whilst the previous request was in
+     * flight into the next one. All the buffers gathered into a request share
+     * its outcome.
+     */
+    class concurrent_line_sender
+    {
+    public:
+        /**
+         * Move the sender to a flusher thread.
+         *
+         * The `sender` is left closed, even if this constructor throws.
+         *
+         * @param sender The connected sender.
+         * @param queue_depth Number of committed buffers that may wait for
+         *                    the flusher before `commit()` blocks.
+         */
+        explicit concurrent_line_sender(
+            line_sender&& sender,
+            size_t queue_depth = 16)
+            : _impl{nullptr}
+        {
+            sender.ensure_impl();
+            ::line_sender* impl = sender._impl;
+            sender._impl = nullptr;
+            _impl = line_sender_error::wrapped_call(
+                ::line_sender_into_concurrent,
+                impl,
+                queue_depth);
+        }
+
+        /**
+         * Move the sender to a flusher thread, drawing the replacement
+         * buffers from `buffers` and returning committed buffers to it once
+         * sent.
+         */
+        concurrent_line_sender(
+            line_sender&& sender,
+            size_t queue_depth,
+            const buffer_pool& buffers)
+            : _impl{nullptr}
+        {
+            sender.ensure_impl();
+            buffers.ensure_impl();
+            ::line_sender* impl = sender._impl;
+            sender._impl = nullptr;
+            _impl = line_sender_error::wrapped_call(
+                ::line_sender_into_concurrent_with_pool,
+                impl,
+                queue_depth,
+                buffers._impl);
+        }
+
+        concurrent_line_sender(const concurrent_line_sender&) = delete;
+
+        concurrent_line_sender(concurrent_line_sender&& other) noexcept
+            : _impl{other._impl}
+        {
+            other._impl = nullptr;
+        }
+
+        concurrent_line_sender& operator=(const concurrent_line_sender&) = delete;
+
+        concurrent_line_sender& operator=(concurrent_line_sender&& other) noexcept
+        {
+            if (this != &other)
+            {
+                close();
+                _impl = other._impl;
+                other._impl = nullptr;
+            }
+            return *this;
+        }
+
+        /**
+         * Hand the buffer's rows over to the flusher thread, leaving `buffer`
+         * empty and ready for the next batch.
+         *
+         * Returns as soon as the rows are queued. Safe to call from many
+         * threads at once, each with a buffer of its own.
+         */
+        flush_handle commit(line_sender_buffer& buffer) const
+        {
+            buffer.may_init();
+            ensure_impl();
+            return flush_handle{line_sender_error::wrapped_call(
+                ::line_sender_concurrent_commit,
+                _impl,
+                buffer._impl)};
+        }
+
+        /**
+         * Send all the buffers committed so far, then stop the flusher thread
+         * and close the connection. Idempotent, but no other thread may
+         * commit concurrently.
+         */
+        void close() noexcept
+        {
+            if (_impl)
+            {
+                ::line_sender_concurrent_close(_impl);
+                _impl = nullptr;
+            }
+        }
+
+        ~concurrent_line_sender() noexcept
+        {
+            close();
+        }
+
+    private:
+        void ensure_impl() const
+        {
+            if (!_impl)
+                throw line_sender_error{
+                    line_sender_error_code::invalid_api_call,
+                    "Sender closed."};
+        }
+
+        ::line_sender_concurrent* _impl;
+    };
+
+    /**
+     * A fixed-size set of connections that can be shared between threads.
+     *
+     * Unlike `line_sender`, the `flush` methods may be called from multiple
+     * threads at once. Each flush goes to the connection that has been idle the
+     * longest, which spreads the load evenly across the connections. When all
+     * the connections are busy, the flush blocks until one becomes idle.
+     *
+     * The number of connections is set by the `pool_size` config key or
+     * `opts::pool_size()`.
+     */
+    class line_sender_pool
+    {
+    public:
+        /**
+         * Create a new sender pool from the given configuration string.
+         * The format is the same as for `line_sender::from_conf()`, plus the
+         * `pool_size` key for the number of connections.
+         *
+         * In the case of TCP, all the connections are established before this
+         * function returns.
+         */
+        static inline line_sender_pool from_conf(utf8_view conf)
+        {
+            return {opts::from_conf(conf)};
+        }
+
+        /**
+         * Create a new sender pool from the configuration stored in the
+         * `QDB_CLIENT_CONF` environment variable.
+         */
+        static inline line_sender_pool from_env()
+        {
+            return {opts::from_env()};
+        }
+
+        line_sender_pool(const opts& opts)
+            : _impl{line_sender_error::wrapped_call(
+                ::line_sender_pool_build, opts._impl)}
+        {}
+
+        line_sender_pool(const line_sender_pool&) = delete;
+
+        line_sender_pool(line_sender_pool&& other) noexcept
+            : _impl{other._impl}
+        {
+            other._impl = nullptr;
+        }
+
+        line_sender_pool& operator=(const line_sender_pool&) = delete;
+
+        line_sender_pool& operator=(line_sender_pool&& other) noexcept
+        {
+            if (this != &other)
+            {
+                close();
+                _impl = other._impl;
+                other._impl = nullptr;
+            }
+            return *this;
+        }
+
+        /** The number of connections in the pool. */
+        size_t pool_size() const noexcept
+        {
+            return _impl ? ::line_sender_pool_size(_impl) : 0;
+        }
+
+        /**
+         * Share a buffer pool with the threads using this pool.
+         *
+         * Once set, `flush()` shrinks each buffer it sends back to the buffer
+         * pool's `max_capacity`. Call this before sharing the sender pool
+         * between threads.
+         */
+        void set_buffer_pool(const buffer_pool& buffers)
+        {
+            ensure_impl();
+            buffers.ensure_impl();
+            ::line_sender_pool_set_buffer_pool(_impl, buffers._impl);
+        }
+
+        /**
+         * Send the buffer over the least-loaded connection, clearing the
+         * buffer.
+         *
+         * See `line_sender::flush()` for the details on flushing.
+         */
+        void flush(line_sender_buffer& buffer) const
+        {
+            buffer.may_init();
+            ensure_impl();
+            line_sender_error::wrapped_call(
+                ::line_sender_pool_flush,
+                _impl,
+                buffer._impl);
+        }
+
+        /**
+         * Send the buffer over the least-loaded connection.
+         *
+         * All the data stays in the buffer. Clear the buffer before starting a
+         * new batch.
+         */
+        void flush_and_keep(const line_sender_buffer& buffer) const
+        {
+            ensure_impl();
+            if (buffer._impl)
+            {
+                line_sender_error::wrapped_call(
+                    ::line_sender_pool_flush_and_keep,
+                    _impl,
+                    buffer._impl);
+            }
+            else
+            {
+                line_sender_buffer buffer2{0};
+                buffer2.may_init();
+                line_sender_error::wrapped_call(
+                    ::line_sender_pool_flush_and_keep,
+                    _impl,
+                    buffer2._impl);
+            }
+        }
+
+        /**
+         * Close all the connections. Does not flush. Idempotent.
+         * No other thread may be using the pool during this call.
+         */
+        void close() noexcept
+        {
+            if (_impl)
+            {
+                ::line_sender_pool_close(_impl);
+                _impl = nullptr;
+            }
+        }
+
+        ~line_sender_pool() noexcept
+        {
+            close();
+        }
+
+    private:
+        void ensure_impl() const
+        {
+            if (!_impl)
+                throw line_sender_error{
+                    line_sender_error_code::invalid_api_call,
+                    "Sender pool closed."};
+        }
+
+        ::line_sender_pool* _impl;
+    };
+
+    /**
+     * Routes rows across several servers, each holding a shard of the data.
+     *
+     * Each shard has a sender and a buffer of its own. `table()` and
+     * `table_with_key()` pick the row's shard, by a stable hash of the table
+     * name or of a symbol value, and return that shard's buffer to continue
+     * the row with. `flush()` then flushes all the shards in parallel.
+     *
+     * The shard buffers are owned by the sharded sender and stay valid until
+     * it's closed. Don't move from or assign to them, and don't flush them
+     * other than with `flush()`.
+     */
+    class sharded_line_sender
+    {
+    public:
+        /**
+         * Create a new sharded sender from the given configuration string.
+         *
+         * The format is the same as for `line_sender::from_conf()`, except
+         * that `addr` is replaced by `shards`, a comma-separated list of the
+         * shards' addresses, each with optional `|`-separated failover
+         * addresses. `shard_by=table` (the default) routes rows by table
+         * name, and `shard_by=symbol` together with `shard_key=<column>` by
+         * the value of a symbol column.
+         *
+         * In the case of TCP, all the connections are established before this
+         * function returns.
+         */
+        static inline sharded_line_sender from_conf(utf8_view conf)
+        {
+            return sharded_line_sender{line_sender_error::wrapped_call(
+                ::line_sender_sharded_from_conf, conf._impl)};
+        }
+
+        sharded_line_sender(const sharded_line_sender&) = delete;
+
+        sharded_line_sender(sharded_line_sender&& other) noexcept
+            : _impl{other._impl}
+            , _views{std::move(other._views)}
+        {
+            other._impl = nullptr;
+        }
+
+        sharded_line_sender& operator=(const sharded_line_sender&) = delete;
+
+        sharded_line_sender& operator=(sharded_line_sender&& other) noexcept
+        {
+            if (this != &other)
+            {
+                close();
+                _impl = other._impl;
+                _views = std::move(other._views);
+                other._impl = nullptr;
+            }
+            return *this;
+        }
+
+        /** The number of shards. */
+        size_t shard_count() const noexcept
+        {
+            return _impl ? ::line_sender_sharded_shard_count(_impl) : 0;
+        }
+
+        /**
+         * Start recording a new row for the given table, in the table's
+         * shard, and return the shard's buffer to continue the row with.
+         * Only valid with `shard_by=table`.
+         */
+        line_sender_buffer& table(table_name_view name)
+        {
+            ensure_impl();
+            return view(line_sender_error::wrapped_call(
+                ::line_sender_sharded_table, _impl, name._impl));
+        }
+
+        /**
+         * Start recording a new row for the given table in the shard of
+         * `key`, record `key` as the row's `shard_key` symbol, and return the
+         * shard's buffer to continue the row with. Record any other symbols
+         * next. Only valid with `shard_by=symbol`.
+         */
+        line_sender_buffer& table_with_key(table_name_view name, utf8_view key)
+        {
+            ensure_impl();
+            return view(line_sender_error::wrapped_call(
+                ::line_sender_sharded_table_with_key,
+                _impl,
+                name._impl,
+                key._impl));
+        }
+
+        /** Discard the row under construction, if it's incomplete. */
+        void rewind_row()
+        {
+            ensure_impl();
+            ::line_sender_sharded_rewind_row(_impl);
+        }
+
+        /** The number of rows pending across all the shards. */
+        size_t row_count() const noexcept
+        {
+            return _impl ? ::line_sender_sharded_row_count(_impl) : 0;
+        }
+
+        /**
+         * Take a snapshot of the given shard's flush counters.
+         * See `line_sender::stats()`.
+         */
+        sender_stats shard_stats(size_t shard) const
+        {
+            ensure_impl();
+            if (shard >= shard_count())
+                throw line_sender_error{
+                    line_sender_error_code::invalid_api_call,
+                    "Shard index out of range."};
+            sender_stats stats{};
+            ::line_sender_sharded_shard_stats(_impl, shard, &stats);
+            return stats;
+        }
+
+        /**
+         * Send the pending rows of every shard, flushing the shards in
+         * parallel.
+         *
+         * Shards that flushed are cleared, whilst shards that failed keep
+         * their rows to retry with the next call. On error, throws the error
+         * of the lowest-numbered shard that failed.
+         */
+        void flush()
+        {
+            ensure_impl();
+            line_sender_error::wrapped_call(::line_sender_sharded_flush, _impl);
+        }
+
+        /**
+         * Close the connections of all the shards. Does not flush.
+         * Idempotent.
+         */
+        void close() noexcept
+        {
+            // The shard buffers belong to the sharded sender.
+            for (auto& buffer : _views)
+                buffer._impl = nullptr;
+            _views.clear();
+            if (_impl)
+            {
+                ::line_sender_sharded_close(_impl);
+                _impl = nullptr;
+            }
+        }
+
+        ~sharded_line_sender() noexcept
+        {
+            close();
+        }
+
+    private:
+        explicit sharded_line_sender(::line_sender_sharded* impl)
+            : _impl{impl}
+        {
+            _views.reserve(::line_sender_sharded_shard_count(impl));
+        }
+
+        line_sender_buffer& view(::line_sender_buffer* impl)
+        {
+            for (auto& buffer : _views)
+            {
+                if (buffer._impl == impl)
+                    return buffer;
+            }
+            _views.emplace_back(size_t{0});
+            _views.back()._impl = impl;
+            return _views.back();
+        }
+
+        void ensure_impl() const
+        {
+            if (!_impl)
+                throw line_sender_error{
+                    line_sender_error_code::invalid_api_call,
+                    "Sharded sender closed."};
+        }
+
+        ::line_sender_sharded* _impl;
+        std::vector<line_sender_buffer> _views;
     };
 
 }
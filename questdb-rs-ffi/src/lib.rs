@@ -24,7 +24,7 @@
 
 #![allow(non_camel_case_types, clippy::missing_safety_doc)]
 
-use libc::{c_char, size_t};
+use libc::{c_char, c_void, size_t};
 use std::ascii;
 use std::boxed::Box;
 use std::convert::{From, Into};
@@ -32,11 +32,15 @@ use std::path::PathBuf;
 use std::ptr;
 use std::slice;
 use std::str;
+use std::sync::Arc;
 
 use questdb::{
     ingress::{
-        Buffer, CertificateAuthority, ColumnName, Protocol, Sender, SenderBuilder, TableName,
-        TimestampMicros, TimestampNanos,
+        ArrowArray, ArrowSchema, BackgroundSender, Buffer, BufferPool, CertificateAuthority,
+        ClockSource, ColumnData, ColumnName, ColumnSlice, ColumnType, ColumnValue, Compression,
+        ConcurrentSender, FastClock, FlushHandle, FlushSpanKind, IoBackend, PreparedColumnName,
+        Protocol, ProtocolVersion, RetryBackoff, RowTemplate, Sender, SenderBuilder, SenderPool,
+        SenderStats, ShardedSender, TableName, TimestampMicros, TimestampNanos, TimestampPrecision,
     },
     Error, ErrorCode,
 };
@@ -135,6 +139,9 @@ pub enum line_sender_error_code {
 
     /// Bad configuration.
     line_sender_error_config_error,
+
+    /// The buffer has no room left within its fixed capacity.
+    line_sender_error_buffer_full,
 }
 
 impl From<ErrorCode> for line_sender_error_code {
@@ -159,6 +166,7 @@ impl From<ErrorCode> for line_sender_error_code {
                 line_sender_error_code::line_sender_error_server_flush_error
             }
             ErrorCode::ConfigError => line_sender_error_code::line_sender_error_config_error,
+            ErrorCode::BufferFull => line_sender_error_code::line_sender_error_buffer_full,
         }
     }
 }
@@ -245,6 +253,195 @@ impl From<line_sender_ca> for CertificateAuthority {
     }
 }
 
+/// Compression of the body of ILP-over-HTTP requests.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub enum line_sender_compression {
+    /// Send the ILP text uncompressed.
+    line_sender_compression_none,
+
+    /// Compress with gzip.
+    line_sender_compression_gzip,
+
+    /// Compress with Zstandard.
+    line_sender_compression_zstd,
+}
+
+impl From<line_sender_compression> for Compression {
+    fn from(compression: line_sender_compression) -> Self {
+        match compression {
+            line_sender_compression::line_sender_compression_none => Compression::None,
+            line_sender_compression::line_sender_compression_gzip => Compression::Gzip,
+            line_sender_compression::line_sender_compression_zstd => Compression::Zstd,
+        }
+    }
+}
+
+/// How an ILP/TCP sender writes to its socket.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub enum line_sender_io_backend {
+    /// Plain blocking `send` calls.
+    line_sender_io_backend_std,
+
+    /// Submit the writes through an io_uring. Linux only.
+    line_sender_io_backend_uring,
+}
+
+impl From<line_sender_io_backend> for IoBackend {
+    fn from(backend: line_sender_io_backend) -> Self {
+        match backend {
+            line_sender_io_backend::line_sender_io_backend_std => IoBackend::Std,
+            line_sender_io_backend::line_sender_io_backend_uring => IoBackend::Uring,
+        }
+    }
+}
+
+/// Where a `line_sender_clock` reads the time from.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub enum line_sender_clock_source {
+    /// The system's wall clock, as per `line_sender_now_nanos()`.
+    line_sender_clock_source_system,
+
+    /// `CLOCK_REALTIME_COARSE` on Linux, with a resolution of one scheduler
+    /// tick. Elsewhere, the same as `line_sender_clock_source_system`.
+    line_sender_clock_source_coarse,
+
+    /// The monotonic clock, periodically resynced with the wall clock.
+    line_sender_clock_source_calibrated,
+
+    /// A timestamp captured on creation and on each `line_sender_clock_tick()`.
+    line_sender_clock_source_batch,
+}
+
+impl From<line_sender_clock_source> for ClockSource {
+    fn from(source: line_sender_clock_source) -> Self {
+        match source {
+            line_sender_clock_source::line_sender_clock_source_system => ClockSource::System,
+            line_sender_clock_source::line_sender_clock_source_coarse => ClockSource::Coarse,
+            line_sender_clock_source::line_sender_clock_source_calibrated => {
+                ClockSource::Calibrated
+            }
+            line_sender_clock_source::line_sender_clock_source_batch => ClockSource::Batch,
+        }
+    }
+}
+
+/// How the interval between the retries of a failed ILP-over-HTTP request grows.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub enum line_sender_retry_backoff {
+    /// Double the interval after each attempt, with a small jitter.
+    line_sender_retry_backoff_exponential,
+
+    /// Wait a random interval, up to the doubling interval.
+    line_sender_retry_backoff_full_jitter,
+
+    /// Wait a random interval, up to three times the previous one.
+    line_sender_retry_backoff_decorrelated,
+}
+
+impl From<line_sender_retry_backoff> for RetryBackoff {
+    fn from(backoff: line_sender_retry_backoff) -> Self {
+        match backoff {
+            line_sender_retry_backoff::line_sender_retry_backoff_exponential => {
+                RetryBackoff::Exponential
+            }
+            line_sender_retry_backoff::line_sender_retry_backoff_full_jitter => {
+                RetryBackoff::FullJitter
+            }
+            line_sender_retry_backoff::line_sender_retry_backoff_decorrelated => {
+                RetryBackoff::Decorrelated
+            }
+        }
+    }
+}
+
+/// Version of the line protocol a buffer is encoded with.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub enum line_sender_protocol_version {
+    /// All values are written as text. Accepted by every QuestDB server.
+    line_sender_protocol_version_1 = 1,
+
+    /// `f64` column values are written in binary.
+    line_sender_protocol_version_2 = 2,
+}
+
+impl From<line_sender_protocol_version> for ProtocolVersion {
+    fn from(version: line_sender_protocol_version) -> Self {
+        match version {
+            line_sender_protocol_version::line_sender_protocol_version_1 => ProtocolVersion::V1,
+            line_sender_protocol_version::line_sender_protocol_version_2 => ProtocolVersion::V2,
+        }
+    }
+}
+
+/// The unit the designated timestamp of each row is written in.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub enum line_sender_timestamp_precision {
+    /// Nanoseconds.
+    line_sender_timestamp_precision_nanos,
+
+    /// Microseconds.
+    line_sender_timestamp_precision_micros,
+
+    /// Milliseconds.
+    line_sender_timestamp_precision_millis,
+
+    /// Seconds.
+    line_sender_timestamp_precision_seconds,
+}
+
+impl From<line_sender_timestamp_precision> for TimestampPrecision {
+    fn from(precision: line_sender_timestamp_precision) -> Self {
+        match precision {
+            line_sender_timestamp_precision::line_sender_timestamp_precision_nanos => {
+                TimestampPrecision::Nanos
+            }
+            line_sender_timestamp_precision::line_sender_timestamp_precision_micros => {
+                TimestampPrecision::Micros
+            }
+            line_sender_timestamp_precision::line_sender_timestamp_precision_millis => {
+                TimestampPrecision::Millis
+            }
+            line_sender_timestamp_precision::line_sender_timestamp_precision_seconds => {
+                TimestampPrecision::Seconds
+            }
+        }
+    }
+}
+
+impl From<TimestampPrecision> for line_sender_timestamp_precision {
+    fn from(precision: TimestampPrecision) -> Self {
+        match precision {
+            TimestampPrecision::Nanos => {
+                line_sender_timestamp_precision::line_sender_timestamp_precision_nanos
+            }
+            TimestampPrecision::Micros => {
+                line_sender_timestamp_precision::line_sender_timestamp_precision_micros
+            }
+            TimestampPrecision::Millis => {
+                line_sender_timestamp_precision::line_sender_timestamp_precision_millis
+            }
+            TimestampPrecision::Seconds => {
+                line_sender_timestamp_precision::line_sender_timestamp_precision_seconds
+            }
+        }
+    }
+}
+
+impl From<ProtocolVersion> for line_sender_protocol_version {
+    fn from(version: ProtocolVersion) -> Self {
+        match version {
+            ProtocolVersion::V1 => line_sender_protocol_version::line_sender_protocol_version_1,
+            ProtocolVersion::V2 => line_sender_protocol_version::line_sender_protocol_version_2,
+        }
+    }
+}
+
 /** Error code categorizing the error. */
 #[no_mangle]
 pub unsafe extern "C" fn line_sender_error_get_code(
@@ -266,6 +463,23 @@ pub unsafe extern "C" fn line_sender_error_msg(
     msg.as_ptr() as *mut c_char
 }
 
+/// The index of the row the server rejected, counting from 0 at the start of
+/// the flushed buffer, if the server reported it. Returns false otherwise.
+/// Drop it with `line_sender_buffer_drop_rows` and flush the rest again.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_error_failed_row(
+    error: *const line_sender_error,
+    row_out: *mut size_t,
+) -> bool {
+    match (*error).0.failed_row() {
+        Some(row) => {
+            *row_out = row;
+            true
+        }
+        None => false,
+    }
+}
+
 /// Clean up the error.
 #[no_mangle]
 pub unsafe extern "C" fn line_sender_error_free(error: *mut line_sender_error) {
@@ -437,10 +651,12 @@ pub struct line_sender_column_name {
 }
 
 impl line_sender_column_name {
+    unsafe fn as_str<'a>(&self) -> &'a str {
+        str::from_utf8_unchecked(slice::from_raw_parts(self.buf as *const u8, self.len))
+    }
+
     unsafe fn as_name<'a>(&self) -> ColumnName<'a> {
-        let str_name =
-            str::from_utf8_unchecked(slice::from_raw_parts(self.buf as *const u8, self.len));
-        ColumnName::new_unchecked(str_name)
+        ColumnName::new_unchecked(self.as_str())
     }
 }
 
@@ -536,8 +752,60 @@ pub unsafe extern "C" fn line_sender_column_name_assert(
     }
 }
 
+/// A column name, validated and escaped once ahead of time.
+/// Use it with the `line_sender_buffer_*_prepared()` functions to avoid
+/// re-escaping the same name on every row.
+pub struct line_sender_prepared_column_name(PreparedColumnName);
+
+/// Prepare a column name for repeated use.
+/// The returned object must be released with
+/// `line_sender_prepared_column_name_free()`.
+/// @param[in] name Validated column name. The object does not borrow it.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_prepared_column_name_new(
+    name: line_sender_column_name,
+) -> *mut line_sender_prepared_column_name {
+    let prepared = PreparedColumnName::from(name.as_name());
+    Box::into_raw(Box::new(line_sender_prepared_column_name(prepared)))
+}
+
+/// Release the prepared column name object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_prepared_column_name_free(
+    name: *mut line_sender_prepared_column_name,
+) {
+    if !name.is_null() {
+        drop(Box::from_raw(name));
+    }
+}
+
+/// Format the floating-point values recorded for this name rounded to a fixed
+/// number of decimals, at most 15, as `line_sender_buffer_column_f64_fixed()`
+/// does.
+/// @param[in] name Prepared column name.
+/// @param[in] decimals Number of decimals.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_prepared_column_name_set_decimals(
+    name: *mut line_sender_prepared_column_name,
+    decimals: u8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let prepared = &mut (*name).0;
+    *prepared = bubble_err_to_c!(err_out, prepared.clone().with_decimals(decimals));
+    true
+}
+
+unsafe fn unwrap_prepared_name<'a>(
+    name: *const line_sender_prepared_column_name,
+) -> ColumnName<'a> {
+    ColumnName::from(&(*name).0)
+}
+
 /// Accumulates a batch of rows to be sent via `line_sender_flush()` or its
 /// variants. A buffer object can be reused after flushing and clearing.
+#[repr(transparent)]
 pub struct line_sender_buffer(Buffer);
 
 /// Construct a `line_sender_buffer` with a `max_name_len` of `127`, which is the
@@ -561,6 +829,52 @@ pub unsafe extern "C" fn line_sender_buffer_with_max_name_len(
     Box::into_raw(Box::new(line_sender_buffer(buffer)))
 }
 
+/// Construct a `line_sender_buffer` that allocates `capacity` bytes up front
+/// and then never reallocates.
+///
+/// Any call that could take the buffer past `capacity` bytes fails with
+/// `line_sender_error_buffer_full` instead, leaving the buffer unchanged.
+/// Since `line_sender_buffer_clear()` retains the capacity, a buffer reused
+/// across flushes never touches the allocator after construction.
+/// @param[in] max_name_len As per `line_sender_buffer_with_max_name_len()`.
+/// @param[in] capacity The capacity of the buffer, in bytes.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_with_fixed_capacity(
+    max_name_len: size_t,
+    capacity: size_t,
+) -> *mut line_sender_buffer {
+    let buffer = Buffer::with_fixed_capacity(max_name_len, capacity);
+    Box::into_raw(Box::new(line_sender_buffer(buffer)))
+}
+
+/// Construct a trusted `line_sender_buffer` with a `max_name_len` of `127`.
+/// See `line_sender_buffer_set_trusted()`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_new_trusted() -> *mut line_sender_buffer {
+    let buffer = Buffer::new_trusted();
+    Box::into_raw(Box::new(line_sender_buffer(buffer)))
+}
+
+/// Trust the caller to follow the API's contract. In release builds, a
+/// trusted buffer no longer checks that calls come in order (table, symbols,
+/// columns, then `at`) or that names are within `max_name_len`: Breaking
+/// either rule results in rows the server rejects, but never in undefined
+/// behaviour. Debug builds of the library still assert both rules and abort
+/// if broken.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_set_trusted(
+    buffer: *mut line_sender_buffer,
+    trusted: bool,
+) {
+    unwrap_buffer_mut(buffer).set_trusted(trusted);
+}
+
+/// Whether the buffer is trusted, as per `line_sender_buffer_set_trusted()`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_is_trusted(buffer: *const line_sender_buffer) -> bool {
+    unwrap_buffer(buffer).is_trusted()
+}
+
 /// Release the `line_sender_buffer` object.
 #[no_mangle]
 pub unsafe extern "C" fn line_sender_buffer_free(buffer: *mut line_sender_buffer) {
@@ -632,6 +946,101 @@ pub unsafe extern "C" fn line_sender_buffer_rewind_to_marker(
     true
 }
 
+/// The offset at which row number `row` starts, counting from 0. For `row`
+/// equal to the row count, the offset just past the last complete row.
+/// Returns false past that.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_row_offset(
+    buffer: *const line_sender_buffer,
+    row: size_t,
+    offset_out: *mut size_t,
+) -> bool {
+    match unwrap_buffer(buffer).row_offset(row) {
+        Some(offset) => {
+            *offset_out = offset;
+            true
+        }
+        None => false,
+    }
+}
+
+/// Remove the complete rows from `start` (inclusive) to `end` (exclusive),
+/// moving the rows after them down, e.g. to drop the row a flush failed on
+/// and flush the rest again. The marker, if any, is cleared.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_drop_rows(
+    buffer: *mut line_sender_buffer,
+    start: size_t,
+    end: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    bubble_err_to_c!(err_out, buffer.drop_rows(start..end));
+    true
+}
+
+/// Split the buffer at row number `row`, keeping the rows before it and
+/// returning a new buffer, with the same settings, holding it and the rows
+/// after it. Returns NULL on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_split_at_row(
+    buffer: *mut line_sender_buffer,
+    row: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> *mut line_sender_buffer {
+    let buffer = unwrap_buffer_mut(buffer);
+    let tail = bubble_err_to_c!(err_out, buffer.split_at_row(row), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender_buffer(tail)))
+}
+
+/// Append the complete rows of `other` to the end of `buffer`, leaving `other`
+/// untouched. The merged buffer is only transactional if both were and they
+/// target the same table.
+///
+/// Both buffers must be at a row boundary and use the same protocol version,
+/// and `other` must not be partially sent.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_append_buffer(
+    buffer: *mut line_sender_buffer,
+    other: *const line_sender_buffer,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let other = unwrap_buffer(other);
+    bubble_err_to_c!(err_out, buffer.append_buffer(other));
+    true
+}
+
+/// Append rows already serialized as ILP, without parsing them back into
+/// tables and columns. `buf` must hold whole rows, each terminated by a
+/// newline, in the buffer's protocol version.
+///
+/// The row count and the transactional flag are kept accurate. With
+/// `validate`, each row must also start with a table name and be valid UTF-8.
+/// The buffer must be at a row boundary. On error, nothing is appended.
+/// @param[in] buffer Line buffer object.
+/// @param[in] buf Pointer to the ILP bytes.
+/// @param[in] len Number of bytes.
+/// @param[in] validate Check each row's table name and UTF-8.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_append_raw_ilp(
+    buffer: *mut line_sender_buffer,
+    buf: *const u8,
+    len: size_t,
+    validate: bool,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let bytes = match len {
+        0 => &[][..],
+        _ => slice::from_raw_parts(buf, len),
+    };
+    bubble_err_to_c!(err_out, buffer.append_raw_ilp(bytes, validate));
+    true
+}
+
 /// Discard the marker.
 #[no_mangle]
 pub unsafe extern "C" fn line_sender_buffer_clear_marker(buffer: *mut line_sender_buffer) {
@@ -661,6 +1070,17 @@ pub unsafe extern "C" fn line_sender_buffer_row_count(buffer: *const line_sender
     buffer.row_count()
 }
 
+/// The number of leading bytes already sent by a `line_sender_try_flush` or
+/// `line_sender_flush_chunked` call that hasn't completed yet. Zero if no flush
+/// is in progress.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_send_offset(
+    buffer: *const line_sender_buffer,
+) -> size_t {
+    let buffer = unwrap_buffer(buffer);
+    buffer.send_offset()
+}
+
 /// Tell whether the buffer is transactional. It is transactional iff it contains
 /// data for at most one table. Additionally, you must send the buffer over HTTP to
 /// get transactional behavior.
@@ -672,18 +1092,65 @@ pub unsafe extern "C" fn line_sender_buffer_transactional(
     buffer.transactional()
 }
 
+/// The line protocol version the buffer is encoded with.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_protocol_version(
+    buffer: *const line_sender_buffer,
+) -> line_sender_protocol_version {
+    unwrap_buffer(buffer).protocol_version().into()
+}
+
+/// Set the line protocol version to encode the buffer with.
+/// The default is `line_sender_protocol_version_1`.
+/// `line_sender_new_buffer()` creates a buffer with the sender's version
+/// already set. The buffer must be empty.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_set_protocol_version(
+    buffer: *mut line_sender_buffer,
+    version: line_sender_protocol_version,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    bubble_err_to_c!(err_out, buffer.set_protocol_version(version.into()));
+    true
+}
+
+/// The unit the buffer writes designated timestamps in.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_timestamp_precision(
+    buffer: *const line_sender_buffer,
+) -> line_sender_timestamp_precision {
+    unwrap_buffer(buffer).timestamp_precision().into()
+}
+
+/// Set the unit to write designated timestamps in.
+/// The default is `line_sender_timestamp_precision_nanos`.
+/// `line_sender_new_buffer()` creates a buffer with the sender's precision
+/// already set. Finer timestamps are rounded down. The buffer must be empty.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_set_timestamp_precision(
+    buffer: *mut line_sender_buffer,
+    precision: line_sender_timestamp_precision,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    bubble_err_to_c!(err_out, buffer.set_timestamp_precision(precision.into()));
+    true
+}
+
 /// Get a string representation of the contents of the buffer.
 ///
 /// @param[in] buffer Line buffer object.
 /// @param[out] len_out The length in bytes of the accumulated buffer.
-/// @return UTF-8 encoded buffer. The buffer is not nul-terminated.
+/// @return UTF-8 encoded buffer, unless it holds binary values written with
+/// `line_sender_protocol_version_2`. The buffer is not nul-terminated.
 #[no_mangle]
 pub unsafe extern "C" fn line_sender_buffer_peek(
     buffer: *const line_sender_buffer,
     len_out: *mut size_t,
 ) -> *const c_char {
     let buffer = unwrap_buffer(buffer);
-    let buf: &[u8] = buffer.as_str().as_bytes();
+    let buf: &[u8] = buffer.as_bytes();
     *len_out = buf.len();
     buf.as_ptr() as *const c_char
 }
@@ -775,6 +1242,35 @@ pub unsafe extern "C" fn line_sender_buffer_column_f64(
     true
 }
 
+/// Record a floating-point value for the given column, rounded to a fixed
+/// number of decimals, at most 15.
+///
+/// Faster than `line_sender_buffer_column_f64()` for values of a known
+/// precision, such as prices, and drops the noise digits. Falls back to
+/// `line_sender_buffer_column_f64()` for values too large to round exactly
+/// and with protocol version 2, whose binary format is exact.
+/// @param[in] buffer Line buffer object.
+/// @param[in] name Column name.
+/// @param[in] value Column value.
+/// @param[in] decimals Number of decimals.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_column_f64_fixed(
+    buffer: *mut line_sender_buffer,
+    name: line_sender_column_name,
+    value: f64,
+    decimals: u8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    bubble_err_to_c!(
+        err_out,
+        buffer.column_f64_fixed(name.as_name(), value, decimals)
+    );
+    true
+}
+
 /// Record a string value for the given column.
 /// @param[in] buffer Line buffer object.
 /// @param[in] name Column name.
@@ -833,56 +1329,237 @@ pub unsafe extern "C" fn line_sender_buffer_column_ts_micros(
     true
 }
 
-/// Complete the current row with the designated timestamp in nanoseconds.
-///
-/// After this call, you can start recording the next row by calling
-/// `line_sender_buffer_table()` again, or you can send the accumulated batch
-/// by calling `line_sender_flush()` or one of its variants.
-///
-/// If you want to pass the current system timestamp, see
-/// `line_sender_now_nanos()`.
-///
+/// Record a long256 value for the given column.
 /// @param[in] buffer Line buffer object.
-/// @param[in] epoch_nanos Number of nanoseconds since 1st Jan 1970 UTC.
+/// @param[in] name Column name.
+/// @param[in] value Pointer to the 32 bytes of the value, most significant
+///            byte first.
 /// @param[out] err_out Set on error.
 /// @return true on success, false on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_buffer_at_nanos(
+pub unsafe extern "C" fn line_sender_buffer_column_long256(
     buffer: *mut line_sender_buffer,
-    epoch_nanos: i64,
+    name: line_sender_column_name,
+    value: *const u8,
     err_out: *mut *mut line_sender_error,
 ) -> bool {
     let buffer = unwrap_buffer_mut(buffer);
-    let timestamp = TimestampNanos::new(epoch_nanos);
-    bubble_err_to_c!(err_out, buffer.at(timestamp));
+    let value: [u8; 32] = *(value as *const [u8; 32]);
+    bubble_err_to_c!(err_out, buffer.column_long256(name.as_name(), value));
     true
 }
 
-/// Complete the current row with the designated timestamp in microseconds.
-///
-/// After this call, you can start recording the next row by calling
-/// `line_sender_buffer_table()` again, or you can send the accumulated batch
-/// by calling `line_sender_flush()` or one of its variants.
-///
-/// If you want to pass the current system timestamp, see
-/// `line_sender_now_micros()`.
-///
+/// Record a symbol for the given prepared column name.
+/// See `line_sender_buffer_symbol()`.
 /// @param[in] buffer Line buffer object.
-/// @param[in] epoch_micros Number of microseconds since 1st Jan 1970 UTC.
+/// @param[in] name Prepared column name.
+/// @param[in] value Column value.
 /// @param[out] err_out Set on error.
 /// @return true on success, false on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_buffer_at_micros(
+pub unsafe extern "C" fn line_sender_buffer_symbol_prepared(
     buffer: *mut line_sender_buffer,
-    epoch_micros: i64,
+    name: *const line_sender_prepared_column_name,
+    value: line_sender_utf8,
     err_out: *mut *mut line_sender_error,
 ) -> bool {
     let buffer = unwrap_buffer_mut(buffer);
-    let timestamp = TimestampMicros::new(epoch_micros);
+    let name = unwrap_prepared_name(name);
+    bubble_err_to_c!(err_out, buffer.symbol(name, value.as_str()));
+    true
+}
+
+/// Record a boolean value for the given prepared column name.
+/// @param[in] buffer Line buffer object.
+/// @param[in] name Prepared column name.
+/// @param[in] value Column value.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_column_bool_prepared(
+    buffer: *mut line_sender_buffer,
+    name: *const line_sender_prepared_column_name,
+    value: bool,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let name = unwrap_prepared_name(name);
+    bubble_err_to_c!(err_out, buffer.column_bool(name, value));
+    true
+}
+
+/// Record an integer value for the given prepared column name.
+/// @param[in] buffer Line buffer object.
+/// @param[in] name Prepared column name.
+/// @param[in] value Column value.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_column_i64_prepared(
+    buffer: *mut line_sender_buffer,
+    name: *const line_sender_prepared_column_name,
+    value: i64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let name = unwrap_prepared_name(name);
+    bubble_err_to_c!(err_out, buffer.column_i64(name, value));
+    true
+}
+
+/// Record a floating-point value for the given prepared column name.
+/// @param[in] buffer Line buffer object.
+/// @param[in] name Prepared column name.
+/// @param[in] value Column value.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_column_f64_prepared(
+    buffer: *mut line_sender_buffer,
+    name: *const line_sender_prepared_column_name,
+    value: f64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let name = unwrap_prepared_name(name);
+    bubble_err_to_c!(err_out, buffer.column_f64(name, value));
+    true
+}
+
+/// Record a string value for the given prepared column name.
+/// @param[in] buffer Line buffer object.
+/// @param[in] name Prepared column name.
+/// @param[in] value Column value.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_column_str_prepared(
+    buffer: *mut line_sender_buffer,
+    name: *const line_sender_prepared_column_name,
+    value: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let name = unwrap_prepared_name(name);
+    bubble_err_to_c!(err_out, buffer.column_str(name, value.as_str()));
+    true
+}
+
+/// Record a nanosecond timestamp value for the given prepared column name.
+/// @param[in] buffer Line buffer object.
+/// @param[in] name Prepared column name.
+/// @param[in] nanos The timestamp in nanoseconds before or since the unix epoch.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_column_ts_nanos_prepared(
+    buffer: *mut line_sender_buffer,
+    name: *const line_sender_prepared_column_name,
+    nanos: i64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let name = unwrap_prepared_name(name);
+    let timestamp = TimestampNanos::new(nanos);
+    bubble_err_to_c!(err_out, buffer.column_ts(name, timestamp));
+    true
+}
+
+/// Record a microsecond timestamp value for the given prepared column name.
+/// @param[in] buffer Line buffer object.
+/// @param[in] name Prepared column name.
+/// @param[in] micros The timestamp in microseconds before or since the unix epoch.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_column_ts_micros_prepared(
+    buffer: *mut line_sender_buffer,
+    name: *const line_sender_prepared_column_name,
+    micros: i64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let name = unwrap_prepared_name(name);
+    let timestamp = TimestampMicros::new(micros);
+    bubble_err_to_c!(err_out, buffer.column_ts(name, timestamp));
+    true
+}
+
+/// Complete the current row with the designated timestamp in nanoseconds.
+///
+/// After this call, you can start recording the next row by calling
+/// `line_sender_buffer_table()` again, or you can send the accumulated batch
+/// by calling `line_sender_flush()` or one of its variants.
+///
+/// If you want to pass the current system timestamp, see
+/// `line_sender_now_nanos()`.
+///
+/// @param[in] buffer Line buffer object.
+/// @param[in] epoch_nanos Number of nanoseconds since 1st Jan 1970 UTC.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_at_nanos(
+    buffer: *mut line_sender_buffer,
+    epoch_nanos: i64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let timestamp = TimestampNanos::new(epoch_nanos);
+    bubble_err_to_c!(err_out, buffer.at(timestamp));
+    true
+}
+
+/// Complete the current row with the designated timestamp in microseconds.
+///
+/// After this call, you can start recording the next row by calling
+/// `line_sender_buffer_table()` again, or you can send the accumulated batch
+/// by calling `line_sender_flush()` or one of its variants.
+///
+/// If you want to pass the current system timestamp, see
+/// `line_sender_now_micros()`.
+///
+/// @param[in] buffer Line buffer object.
+/// @param[in] epoch_micros Number of microseconds since 1st Jan 1970 UTC.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_at_micros(
+    buffer: *mut line_sender_buffer,
+    epoch_micros: i64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let timestamp = TimestampMicros::new(epoch_micros);
     bubble_err_to_c!(err_out, buffer.at(timestamp));
     true
 }
 
+/// Complete the current row with the designated timestamp, like
+/// `line_sender_buffer_at_nanos()`, but format it faster when consecutive rows
+/// have close timestamps.
+///
+/// The buffer remembers the leading digits of the last timestamp passed to this
+/// function. When the next timestamp only differs in its last 8 digits, only
+/// those are formatted. The rows are identical to the ones
+/// `line_sender_buffer_at_nanos()` writes.
+///
+/// @param[in] buffer Line buffer object.
+/// @param[in] epoch_nanos Number of nanoseconds since 1st Jan 1970 UTC.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_at_delta_nanos(
+    buffer: *mut line_sender_buffer,
+    epoch_nanos: i64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let timestamp = TimestampNanos::new(epoch_nanos);
+    bubble_err_to_c!(err_out, buffer.at_delta(timestamp));
+    true
+}
+
 /// Complete the current row without providing a timestamp. The QuestDB instance
 /// will insert its own timestamp.
 ///
@@ -910,490 +1587,2391 @@ pub unsafe extern "C" fn line_sender_buffer_at_now(
     buffer: *mut line_sender_buffer,
     err_out: *mut *mut line_sender_error,
 ) -> bool {
-    let buffer = unwrap_buffer_mut(buffer);
-    bubble_err_to_c!(err_out, buffer.at_now());
+    let buffer = unwrap_buffer_mut(buffer);
+    bubble_err_to_c!(err_out, buffer.at_now());
+    true
+}
+
+/// Complete the current row with the current time of `clock` as the
+/// designated timestamp. Cheaper than passing `line_sender_now_nanos()` to
+/// `line_sender_buffer_at_nanos()`. See `line_sender_clock_new`.
+///
+/// @param[in] buffer Line buffer object.
+/// @param[in] clock Clock object.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_at_clock(
+    buffer: *mut line_sender_buffer,
+    clock: *const line_sender_clock,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    bubble_err_to_c!(err_out, buffer.at_clock(&(*clock).0));
+    true
+}
+
+/// Type of the values of a `line_sender_column_slice`.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub enum line_sender_column_type {
+    /// `line_sender_utf8` values, serialized as symbols.
+    line_sender_column_type_symbol,
+
+    /// `bool` values.
+    line_sender_column_type_bool,
+
+    /// `int64_t` values.
+    line_sender_column_type_i64,
+
+    /// `double` values.
+    line_sender_column_type_f64,
+
+    /// `line_sender_utf8` values, serialized as strings.
+    line_sender_column_type_str,
+
+    /// `int64_t` timestamps in microseconds since the Unix epoch.
+    line_sender_column_type_ts_micros,
+}
+
+/// The values of one column across a batch of rows.
+/// See `line_sender_buffer_append_columns`.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct line_sender_column_slice {
+    /// Column name.
+    name: line_sender_column_name,
+
+    /// Type of the elements pointed to by `data`.
+    column_type: line_sender_column_type,
+
+    /// Pointer to the first of `row_count` contiguous values.
+    data: *const c_void,
+}
+
+/// Append a batch of rows for the given table, supplied column by column.
+///
+/// Each of the `column_count` columns points to `row_count` contiguous values.
+/// Symbol columns are written before the other columns, regardless of their
+/// position in `columns`. The `line_sender_utf8` values of symbol and string
+/// columns are validated here, so they need not be initialized via
+/// `line_sender_utf8_init`.
+///
+/// The names, values and timestamps are validated for the whole batch before
+/// any row is written: If validation fails, the buffer is left unchanged.
+///
+/// @param[in] buffer Line buffer object.
+/// @param[in] name Table name.
+/// @param[in] row_count Number of rows in the batch.
+/// @param[in] columns Array of `column_count` columns.
+/// @param[in] column_count Number of columns. Must be at least one.
+/// @param[in] timestamps_nanos Array of `row_count` designated timestamps in
+///            nanoseconds since the Unix epoch, or NULL to let the server assign
+///            them.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_append_columns(
+    buffer: *mut line_sender_buffer,
+    name: line_sender_table_name,
+    row_count: size_t,
+    columns: *const line_sender_column_slice,
+    column_count: size_t,
+    timestamps_nanos: *const i64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let columns: &[line_sender_column_slice] = if column_count == 0 {
+        &[]
+    } else {
+        slice::from_raw_parts(columns, column_count)
+    };
+
+    // Symbol and string values need converting to `&str` slices.
+    let mut str_columns: Vec<Vec<&str>> = Vec::new();
+    for column in columns.iter() {
+        match column.column_type {
+            line_sender_column_type::line_sender_column_type_symbol
+            | line_sender_column_type::line_sender_column_type_str => {
+                let values = col_values::<line_sender_utf8>(column.data, row_count);
+                let mut strs = Vec::with_capacity(row_count);
+                for value in values.iter() {
+                    let bytes = col_values::<u8>(value.buf as *const c_void, value.len);
+                    let Some(str_ref) = unwrap_utf8(bytes, err_out) else {
+                        return false;
+                    };
+                    strs.push(str_ref);
+                }
+                str_columns.push(strs);
+            }
+            _ => {}
+        }
+    }
+
+    let mut str_columns = str_columns.iter();
+    let slices: Vec<ColumnSlice> = columns
+        .iter()
+        .map(|column| {
+            let data = match column.column_type {
+                line_sender_column_type::line_sender_column_type_symbol => {
+                    ColumnData::Symbol(str_columns.next().unwrap())
+                }
+                line_sender_column_type::line_sender_column_type_bool => {
+                    ColumnData::Bool(col_values(column.data, row_count))
+                }
+                line_sender_column_type::line_sender_column_type_i64 => {
+                    ColumnData::I64(col_values(column.data, row_count))
+                }
+                line_sender_column_type::line_sender_column_type_f64 => {
+                    ColumnData::F64(col_values(column.data, row_count))
+                }
+                line_sender_column_type::line_sender_column_type_str => {
+                    ColumnData::Str(str_columns.next().unwrap())
+                }
+                line_sender_column_type::line_sender_column_type_ts_micros => {
+                    ColumnData::TimestampMicros(col_values(column.data, row_count))
+                }
+            };
+            ColumnSlice::new(column.name.as_name(), data).unwrap()
+        })
+        .collect();
+
+    let timestamps = if timestamps_nanos.is_null() {
+        None
+    } else {
+        Some(col_values(timestamps_nanos as *const c_void, row_count))
+    };
+    bubble_err_to_c!(
+        err_out,
+        buffer.append_columns(name.as_name(), &slices, timestamps)
+    );
+    true
+}
+
+/// View `len` contiguous values of type `T` supplied from C.
+unsafe fn col_values<'a, T>(data: *const c_void, len: size_t) -> &'a [T] {
+    if len == 0 {
+        &[]
+    } else {
+        slice::from_raw_parts(data as *const T, len)
+    }
+}
+
+/// Append the rows of an Arrow record batch for the given table, reading the
+/// column buffers in place.
+///
+/// `schema` and `array` describe a struct array in the Arrow C data interface,
+/// as exported for a record batch by the Arrow libraries. Each field is written
+/// as a column of the same name:
+///
+/// * `bool` as a boolean column.
+/// * Signed integers and unsigned integers up to 32 bits as `i64` columns.
+/// * `float` and `double` as `f64` columns.
+/// * `utf8` and `large_utf8` as string columns, or as symbols if named in
+///   `symbol_columns`.
+/// * Dictionary-encoded strings as symbols.
+/// * Timestamps of any unit as timestamp columns.
+///
+/// Null cells are left out of their row, which QuestDB stores as NULL.
+///
+/// The structs are only read: Releasing them remains up to the caller.
+/// If any field or row fails validation, the buffer is left unchanged.
+///
+/// @param[in] buffer Line buffer object.
+/// @param[in] name Table name.
+/// @param[in] schema Schema of the record batch.
+/// @param[in] array Record batch.
+/// @param[in] timestamp_column Timestamp field holding the designated
+///            timestamps, or NULL to let the server assign them.
+/// @param[in] symbol_columns Array of `symbol_column_count` string fields to
+///            write as symbols.
+/// @param[in] symbol_column_count Number of symbol columns.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_append_arrow(
+    buffer: *mut line_sender_buffer,
+    name: line_sender_table_name,
+    schema: *const ArrowSchema,
+    array: *const ArrowArray,
+    timestamp_column: *const line_sender_column_name,
+    symbol_columns: *const line_sender_column_name,
+    symbol_column_count: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let timestamp_column = timestamp_column.as_ref().map(|column| column.as_str());
+    let symbol_columns: Vec<&str> =
+        col_values::<line_sender_column_name>(symbol_columns as *const c_void, symbol_column_count)
+            .iter()
+            .map(|column| column.as_str())
+            .collect();
+    bubble_err_to_c!(
+        err_out,
+        buffer.append_record_batch(
+            name.as_name(),
+            &*schema,
+            &*array,
+            timestamp_column,
+            &symbol_columns
+        )
+    );
+    true
+}
+
+impl From<line_sender_column_type> for ColumnType {
+    fn from(column_type: line_sender_column_type) -> Self {
+        match column_type {
+            line_sender_column_type::line_sender_column_type_symbol => ColumnType::Symbol,
+            line_sender_column_type::line_sender_column_type_bool => ColumnType::Bool,
+            line_sender_column_type::line_sender_column_type_i64 => ColumnType::I64,
+            line_sender_column_type::line_sender_column_type_f64 => ColumnType::F64,
+            line_sender_column_type::line_sender_column_type_str => ColumnType::Str,
+            line_sender_column_type::line_sender_column_type_ts_micros => {
+                ColumnType::TimestampMicros
+            }
+        }
+    }
+}
+
+/// A fixed table name and column layout, validated and escaped once.
+/// See `line_sender_buffer_append_row_at_nanos`.
+pub struct line_sender_row_template(RowTemplate);
+
+/// Create a row template.
+///
+/// Symbol columns must precede all other column types.
+///
+/// @param[in] table Table name.
+/// @param[in] column_count Number of columns. Must be at least one.
+/// @param[in] names Array of `column_count` column names.
+/// @param[in] types Array of `column_count` column types.
+/// @param[out] err_out Set on error.
+/// @return The new template, or NULL on error.
+///         Release it with `line_sender_row_template_free`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_row_template_new(
+    table: line_sender_table_name,
+    column_count: size_t,
+    names: *const line_sender_column_name,
+    types: *const line_sender_column_type,
+    err_out: *mut *mut line_sender_error,
+) -> *mut line_sender_row_template {
+    let names: &[line_sender_column_name] = col_values(names as *const c_void, column_count);
+    let types: &[line_sender_column_type] = col_values(types as *const c_void, column_count);
+    let mut template =
+        bubble_err_to_c!(err_out, RowTemplate::new(table.as_name()), ptr::null_mut());
+    for (name, column_type) in names.iter().zip(types.iter()) {
+        template = bubble_err_to_c!(
+            err_out,
+            template.column(name.as_name(), (*column_type).into()),
+            ptr::null_mut()
+        );
+    }
+    Box::into_raw(Box::new(line_sender_row_template(template)))
+}
+
+/// Release the row template object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_row_template_free(template: *mut line_sender_row_template) {
+    if !template.is_null() {
+        drop(Box::from_raw(template));
+    }
+}
+
+/// A single field value of a row appended via a `line_sender_row_template`.
+/// The member to set is determined by the template's column type.
+#[repr(C)]
+#[derive(Copy, Clone)]
+pub union line_sender_row_value {
+    /// For `line_sender_column_type_symbol` and `line_sender_column_type_str`.
+    /// Must be initialized via `line_sender_utf8_init`.
+    pub utf8: line_sender_utf8,
+
+    /// For `line_sender_column_type_bool`.
+    pub boolean: bool,
+
+    /// For `line_sender_column_type_i64` and `line_sender_column_type_ts_micros`.
+    pub i64: i64,
+
+    /// For `line_sender_column_type_f64`.
+    pub f64: f64,
+}
+
+unsafe fn append_row(
+    buffer: *mut line_sender_buffer,
+    template: *const line_sender_row_template,
+    values: *const line_sender_row_value,
+    value_count: size_t,
+    timestamp: Option<TimestampNanos>,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let buffer = unwrap_buffer_mut(buffer);
+    let template = &(*template).0;
+    let values: &[line_sender_row_value] = col_values(values as *const c_void, value_count);
+    if values.len() != template.column_types().len() {
+        set_err_out(
+            err_out,
+            ErrorCode::InvalidApiCall,
+            format!(
+                "Bad call to `append_row`: {} values supplied, expected {}.",
+                values.len(),
+                template.column_types().len()
+            ),
+        );
+        return false;
+    }
+    let row = template
+        .column_types()
+        .zip(values.iter())
+        .map(|(column_type, value)| match column_type {
+            ColumnType::Symbol => ColumnValue::Symbol(value.utf8.as_str()),
+            ColumnType::Bool => ColumnValue::Bool(value.boolean),
+            ColumnType::I64 => ColumnValue::I64(value.i64),
+            ColumnType::F64 => ColumnValue::F64(value.f64),
+            ColumnType::Str => ColumnValue::Str(value.utf8.as_str()),
+            ColumnType::TimestampMicros => ColumnValue::TimestampMicros(value.i64),
+        });
+    bubble_err_to_c!(err_out, buffer.append_row(template, row, timestamp));
+    true
+}
+
+/// Append a complete row laid out as per the `template`, with the designated
+/// timestamp in nanoseconds.
+///
+/// Unlike the `line_sender_buffer_symbol` and `line_sender_buffer_column_*`
+/// functions, this skips the per-field validation of names and call order.
+/// If it fails, the buffer is left unchanged.
+///
+/// @param[in] buffer Line buffer object.
+/// @param[in] template Row template.
+/// @param[in] values Array of `value_count` field values, one per template
+///            column.
+/// @param[in] value_count Number of values.
+/// @param[in] epoch_nanos Number of nanoseconds since 1st Jan 1970 UTC.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_append_row_at_nanos(
+    buffer: *mut line_sender_buffer,
+    template: *const line_sender_row_template,
+    values: *const line_sender_row_value,
+    value_count: size_t,
+    epoch_nanos: i64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let timestamp = Some(TimestampNanos::new(epoch_nanos));
+    append_row(buffer, template, values, value_count, timestamp, err_out)
+}
+
+/// Append a complete row laid out as per the `template`, letting the server
+/// assign the timestamp.
+/// See `line_sender_buffer_append_row_at_nanos`.
+///
+/// @param[in] buffer Line buffer object.
+/// @param[in] template Row template.
+/// @param[in] values Array of `value_count` field values, one per template
+///            column.
+/// @param[in] value_count Number of values.
+/// @param[out] err_out Set on error.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_append_row_at_now(
+    buffer: *mut line_sender_buffer,
+    template: *const line_sender_row_template,
+    values: *const line_sender_row_value,
+    value_count: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    append_row(buffer, template, values, value_count, None, err_out)
+}
+
+/// Accumulates parameters for a new `line_sender` object.
+pub struct line_sender_opts(SenderBuilder);
+
+/// Create a new `line_sender_opts` instance from the given configuration string.
+/// The format of the string is: "tcp::addr=host:port;key=value;...;"
+/// Instead of "tcp" you can also specify "tcps", "http", and "https".
+///
+/// The accepted keys match one-for-one with the functions on `line_sender_opts`.
+/// For example, this is a valid configuration string:
+///
+/// "https::addr=host:port;username=alice;password=secret;"
+///
+/// and there are matching functions `line_sender_opts_username()` and
+/// `line_sender_opts_password()`. The value for `addr=` is supplied directly to
+/// `line_sender_opts_new`, so there's no function with a matching name.
+///
+/// For the full list of keys, search this module for `fn line_sender_opts_`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_from_conf(
+    config: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> *mut line_sender_opts {
+    let config = config.as_str();
+    let builder = bubble_err_to_c!(err_out, SenderBuilder::from_conf(config), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender_opts(builder)))
+}
+
+/// Create a new `line_sender_opts` instance from the configuration stored in the
+/// `QDB_CLIENT_CONF` environment variable.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_from_env(
+    err_out: *mut *mut line_sender_error,
+) -> *mut line_sender_opts {
+    let builder = bubble_err_to_c!(err_out, SenderBuilder::from_env(), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender_opts(builder)))
+}
+
+/// Create a new `line_sender_opts` instance with the given protocol, hostname and
+/// port.
+/// @param[in] protocol The protocol to use.
+/// @param[in] host The QuestDB database host.
+/// @param[in] port The QuestDB ILP TCP port.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_new(
+    protocol: line_sender_protocol,
+    host: line_sender_utf8,
+    port: u16,
+) -> *mut line_sender_opts {
+    let builder = SenderBuilder::new(protocol.into(), host.as_str(), port);
+    let builder = builder
+        .user_agent(concat!("questdb/c/", env!("CARGO_PKG_VERSION")))
+        .expect("user_agent set");
+    Box::into_raw(Box::new(line_sender_opts(builder)))
+}
+
+/// Create a new `line_sender_opts` instance with the given protocol, hostname and
+/// service name.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_new_service(
+    protocol: line_sender_protocol,
+    host: line_sender_utf8,
+    port: line_sender_utf8,
+) -> *mut line_sender_opts {
+    let builder = SenderBuilder::new(protocol.into(), host.as_str(), port.as_str());
+    let builder = builder
+        .user_agent(concat!("questdb/c/", env!("CARGO_PKG_VERSION")))
+        .expect("user_agent set");
+    Box::into_raw(Box::new(line_sender_opts(builder)))
+}
+
+/// Add a host to fail over to when the ones before it can't be reached.
+/// Hosts are tried in the order they were added, after the one passed to
+/// `line_sender_opts_new()`.
+/// @param[in] host The QuestDB database host.
+/// @param[in] port The QuestDB port.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_failover_addr(
+    opts: *mut line_sender_opts,
+    host: line_sender_utf8,
+    port: u16,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, failover_addr, host.as_str(), port)
+}
+
+/// Select local outbound network "bind" interface.
+///
+/// This may be relevant if your machine has multiple network interfaces.
+///
+/// The default is `0.0.0.0`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_bind_interface(
+    opts: *mut line_sender_opts,
+    bind_interface: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, bind_interface, bind_interface.as_str())
+}
+
+/// Set the username for authentication.
+///
+/// For TCP, this is the `kid` part of the ECDSA key set.
+/// The other fields are `token` `token_x` and `token_y`.
+///
+/// For HTTP, this is part of basic authentication.
+/// See also: `line_sender_opts_password()`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_username(
+    opts: *mut line_sender_opts,
+    username: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, username, username.as_str())
+}
+
+/// Set the password for basic HTTP authentication.
+/// See also: `line_sender_opts_username()`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_password(
+    opts: *mut line_sender_opts,
+    password: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, password, password.as_str())
+}
+
+/// Set the Token (Bearer) Authentication parameter for HTTP,
+/// or the ECDSA private key for TCP authentication.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_token(
+    opts: *mut line_sender_opts,
+    token: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, token, token.as_str())
+}
+
+/// Set the ECDSA public key X for TCP authentication.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_token_x(
+    opts: *mut line_sender_opts,
+    token_x: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, token_x, token_x.as_str())
+}
+
+/// Set the ECDSA public key Y for TCP authentication.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_token_y(
+    opts: *mut line_sender_opts,
+    token_y: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, token_y, token_y.as_str())
+}
+
+/// Configure how long to wait for messages from the QuestDB server during
+/// the TLS handshake and authentication process.
+/// The value is in milliseconds, and the default is 15 seconds.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_auth_timeout(
+    opts: *mut line_sender_opts,
+    timeout_millis: u64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let timeout = std::time::Duration::from_millis(timeout_millis);
+    upd_opts!(opts, err_out, auth_timeout, timeout)
+}
+
+/// Reconnect automatically in the background after an ILP/TCP write error.
+/// A flush waits for the new connection for at most this many milliseconds,
+/// then replays the last `line_sender_opts_replay_buffers()` buffers and
+/// resends its own. A value of 0 disables reconnecting, which is the default.
+/// TCP only.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_reconnect_timeout(
+    opts: *mut line_sender_opts,
+    timeout_millis: u64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let timeout = if timeout_millis == 0 {
+        None
+    } else {
+        Some(std::time::Duration::from_millis(timeout_millis))
+    };
+    upd_opts!(opts, err_out, reconnect_timeout, timeout)
+}
+
+/// The number of most recently flushed buffers to keep a copy of and replay
+/// after reconnecting, for at-least-once delivery. The default is 0.
+/// TCP only.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_replay_buffers(
+    opts: *mut line_sender_opts,
+    count: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, replay_buffers, count)
+}
+
+/// How the sender writes to its socket. The default is
+/// `line_sender_io_backend_std`. The io_uring backend requires Linux and
+/// doesn't support non-blocking mode. TCP only.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_io_backend(
+    opts: *mut line_sender_opts,
+    backend: line_sender_io_backend,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let backend: IoBackend = backend.into();
+    upd_opts!(opts, err_out, io_backend, backend)
+}
+
+/// Have a kernel thread poll the io_uring for submissions and busy-poll for
+/// completions, trading a CPU core for latency. The default is `false`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_uring_sqpoll(
+    opts: *mut line_sender_opts,
+    sqpoll: bool,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, uring_sqpoll, sqpoll)
+}
+
+/// Pin the io_uring's SQPOLL kernel thread to a CPU.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_uring_sqpoll_cpu(
+    opts: *mut line_sender_opts,
+    cpu: u32,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, uring_sqpoll_cpu, cpu)
+}
+
+/// Send writes of at least this many bytes without copying them into the
+/// kernel. A value of 0 always copies. The default is 64 KiB.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_uring_zc_threshold(
+    opts: *mut line_sender_opts,
+    threshold: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let threshold = if threshold == 0 {
+        None
+    } else {
+        Some(threshold)
+    };
+    upd_opts!(opts, err_out, uring_zc_threshold, threshold)
+}
+
+/// Set to `false` to disable TLS certificate verification.
+/// This should only be used for debugging purposes as it reduces security.
+///
+/// For testing consider specifying a path to a `.pem` file instead via
+/// the `tls_roots` setting.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_tls_verify(
+    opts: *mut line_sender_opts,
+    verify: bool,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, tls_verify, verify)
+}
+
+/// Specify where to find the certificate authority used to validate
+/// the validate the server's TLS certificate.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_tls_ca(
+    opts: *mut line_sender_opts,
+    ca: line_sender_ca,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let ca: CertificateAuthority = ca.into();
+    upd_opts!(opts, err_out, tls_ca, ca)
+}
+
+/// Set the path to a custom root certificate `.pem` file.
+/// This is used to validate the server's certificate during the TLS handshake.
+///
+/// See notes on how to test with [self-signed
+/// certificates](https://github.com/questdb/c-questdb-client/tree/main/tls_certs).
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_tls_roots(
+    opts: *mut line_sender_opts,
+    path: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let path = PathBuf::from(path.as_str());
+    upd_opts!(opts, err_out, tls_roots, path)
+}
+
+/// Set the maximum buffer size in bytes that the client will flush to the server.
+/// The default is 100 MiB.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_max_buf_size(
+    opts: *mut line_sender_opts,
+    max_buf_size: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, max_buf_size, max_buf_size)
+}
+
+/// Enable or disable the auto-flush thresholds checked by
+/// `line_sender_should_flush()`. The default is enabled.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_auto_flush(
+    opts: *mut line_sender_opts,
+    enabled: bool,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, auto_flush, enabled)
+}
+
+/// Set the number of rows after which a buffer is due to be flushed.
+/// A value of 0 disables the row threshold.
+/// The default is 75000 rows for HTTP and 600 rows for TCP.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_auto_flush_rows(
+    opts: *mut line_sender_opts,
+    rows: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let rows = if rows == 0 { None } else { Some(rows) };
+    upd_opts!(opts, err_out, auto_flush_rows, rows)
+}
+
+/// Set the number of bytes after which a buffer is due to be flushed.
+/// A value of 0 disables the byte threshold, which is the default.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_auto_flush_bytes(
+    opts: *mut line_sender_opts,
+    bytes: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let bytes = if bytes == 0 { None } else { Some(bytes) };
+    upd_opts!(opts, err_out, auto_flush_bytes, bytes)
+}
+
+/// Set the time since the previous flush after which a buffer is due to be
+/// flushed. The value is in milliseconds, and the default is 1 second.
+/// A value of 0 disables the time threshold.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_auto_flush_interval(
+    opts: *mut line_sender_opts,
+    millis: u64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let interval = if millis == 0 {
+        None
+    } else {
+        Some(std::time::Duration::from_millis(millis))
+    };
+    upd_opts!(opts, err_out, auto_flush_interval, interval)
+}
+
+/// Compress the body of each HTTP request.
+/// The default is `line_sender_compression_none`.
+/// The compression context is reused across flushes, and the
+/// `request_min_throughput` timeout is calculated from the compressed size.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_compression(
+    opts: *mut line_sender_opts,
+    compression: line_sender_compression,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let compression: Compression = compression.into();
+    upd_opts!(opts, err_out, compression, compression)
+}
+
+/// Cap the rate data is sent at, in bytes per second.
+/// A value of 0 disables the limit, which is the default.
+/// The senders of a `line_sender_pool` share the limit.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_max_send_rate(
+    opts: *mut line_sender_opts,
+    bytes_per_sec: u64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let rate = if bytes_per_sec == 0 {
+        None
+    } else {
+        Some(bytes_per_sec)
+    };
+    upd_opts!(opts, err_out, max_send_rate, rate)
+}
+
+/// Cap the rate rows are sent at, in rows per second.
+/// A value of 0 disables the limit, which is the default.
+/// The senders of a `line_sender_pool` share the limit.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_max_rows_rate(
+    opts: *mut line_sender_opts,
+    rows_per_sec: u64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let rate = if rows_per_sec == 0 {
+        None
+    } else {
+        Some(rows_per_sec)
+    };
+    upd_opts!(opts, err_out, max_rows_rate, rate)
+}
+
+/// Set the number of connections opened by `line_sender_pool_build()`.
+/// The default is 1.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_pool_size(
+    opts: *mut line_sender_opts,
+    pool_size: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, pool_size, pool_size)
+}
+
+/// Set the version of the line protocol to send.
+/// The default is `line_sender_protocol_version_1`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_protocol_version(
+    opts: *mut line_sender_opts,
+    version: line_sender_protocol_version,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let version: ProtocolVersion = version.into();
+    upd_opts!(opts, err_out, protocol_version, Some(version))
+}
+
+/// Ask the server which version of the line protocol to send when the
+/// sender is built, falling back to `line_sender_protocol_version_1`.
+/// Only ILP/HTTP servers are asked: ILP/TCP senders use version 1.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_protocol_version_auto(
+    opts: *mut line_sender_opts,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, protocol_version, None)
+}
+
+/// Set the unit to write designated timestamps in. Over HTTP, it's sent as the
+/// `precision` of each request. Over TCP, it must match the server's
+/// `line.tcp.timestamp` setting.
+/// The default is `line_sender_timestamp_precision_nanos`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_timestamp_precision(
+    opts: *mut line_sender_opts,
+    precision: line_sender_timestamp_precision,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let precision: TimestampPrecision = precision.into();
+    upd_opts!(opts, err_out, timestamp_precision, precision)
+}
+
+/// Set the cumulative duration spent in retries.
+/// The value is in milliseconds, and the default is 10 seconds.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_retry_timeout(
+    opts: *mut line_sender_opts,
+    millis: u64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let retry_timeout = std::time::Duration::from_millis(millis);
+    upd_opts!(opts, err_out, retry_timeout, retry_timeout)
+}
+
+/// Set the minimum acceptable throughput while sending a buffer to the server.
+/// The sender will divide the payload size by this number to determine for how
+/// long to keep sending the payload before timing out.
+/// The value is in bytes per second, and the default is 100 KiB/s.
+/// The timeout calculated from minimum throughput is adedd to the value of
+/// `request_timeout`.
+///
+/// See also: `line_sender_opts_request_timeout()`
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_request_min_throughput(
+    opts: *mut line_sender_opts,
+    bytes_per_sec: u64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, request_min_throughput, bytes_per_sec)
+}
+
+/// Set the additional time to wait on top of that calculated from the minimum
+/// throughput. This accounts for the fixed latency of the HTTP request-response
+/// roundtrip. The value is in milliseconds, and the default is 10 seconds.
+///
+/// See also: `line_sender_opts_request_min_throughput()`
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_request_timeout(
+    opts: *mut line_sender_opts,
+    millis: u64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let request_timeout = std::time::Duration::from_millis(millis);
+    upd_opts!(opts, err_out, request_timeout, request_timeout)
+}
+
+/// Set how the interval between retries grows.
+/// The default is `line_sender_retry_backoff_exponential`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_retry_backoff(
+    opts: *mut line_sender_opts,
+    backoff: line_sender_retry_backoff,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let backoff: RetryBackoff = backoff.into();
+    upd_opts!(opts, err_out, retry_backoff, backoff)
+}
+
+/// Wait at least as long as the `Retry-After` header of a 503 or 529 response
+/// asks for before retrying. The default is `true`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_retry_after(
+    opts: *mut line_sender_opts,
+    enabled: bool,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, retry_after, enabled)
+}
+
+/// Limit the retries of all the senders in the process configured with the
+/// same value to this many per second. The default is 0, meaning no limit.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_retry_budget(
+    opts: *mut line_sender_opts,
+    retries_per_sec: u32,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, retry_budget, retries_per_sec)
+}
+
+/// Fail flushes fast, without contacting the server, after this many
+/// consecutive requests failed with a 5xx error or a network error.
+/// The default is 0, which disables the circuit breaker.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_circuit_breaker_threshold(
+    opts: *mut line_sender_opts,
+    failures: u32,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, circuit_breaker_threshold, failures)
+}
+
+/// How long an open circuit breaker fails flushes fast before letting a
+/// request through again. The value is in milliseconds, and the default is
+/// 5 seconds.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_circuit_breaker_cooldown(
+    opts: *mut line_sender_opts,
+    millis: u64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let cooldown = std::time::Duration::from_millis(millis);
+    upd_opts!(opts, err_out, circuit_breaker_cooldown, cooldown)
+}
+
+/// Open the connection when the sender is built, rather than on the first
+/// flush, and keep it open whilst the sender is idle by pinging the server
+/// every `ping_interval`. Building the sender fails if no host answers.
+/// The default is off.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_prewarm(
+    opts: *mut line_sender_opts,
+    enabled: bool,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, prewarm, enabled)
+}
+
+/// How long the connection may sit idle before a pre-warmed sender pings the
+/// server. The value is in milliseconds, and the default is 10 seconds.
+/// Pass 0 to only warm up the connection when the sender is built.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_ping_interval(
+    opts: *mut line_sender_opts,
+    millis: u64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let interval = match millis {
+        0 => None,
+        millis => Some(std::time::Duration::from_millis(millis)),
+    };
+    upd_opts!(opts, err_out, ping_interval, interval)
+}
+
+/// The most bytes of a `line_sender_flush_stream` request kept in memory to
+/// resend it if an attempt fails. A longer stream isn't retried.
+/// The default is 16 MiB.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_stream_replay_window(
+    opts: *mut line_sender_opts,
+    bytes: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, stream_replay_window, bytes)
+}
+
+/// Spool the flushes that still fail with a network error, or a retriable
+/// server error, once the `retry_timeout` is exhausted to segment files in the
+/// given directory, instead of returning the error. A background thread replays
+/// them in order once the server accepts them again. Until the spool is
+/// drained, new flushes are appended to it.
+/// The directory must not be shared with another sender.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_spool_dir(
+    opts: *mut line_sender_opts,
+    path: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let path = PathBuf::from(path.as_str());
+    upd_opts!(opts, err_out, spool_dir, path)
+}
+
+/// Set the maximum size of the files in the spool directory.
+/// Once the spool is full, flushes that can't be sent return an error again.
+/// The default is 1 GiB.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_spool_max_bytes(
+    opts: *mut line_sender_opts,
+    max_bytes: u64,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, spool_max_bytes, max_bytes)
+}
+
+/// Set the HTTP user agent. Internal API. Do not use.
+#[doc(hidden)]
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_user_agent(
+    opts: *mut line_sender_opts,
+    user_agent: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    upd_opts!(opts, err_out, user_agent, user_agent.as_str())
+}
+
+/// Duplicate the `line_sender_opts` object.
+/// Both old and new objects will have to be freed.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_clone(
+    opts: *const line_sender_opts,
+) -> *mut line_sender_opts {
+    let builder = &(*opts).0;
+    let new_builder = builder.clone();
+    Box::into_raw(Box::new(line_sender_opts(new_builder)))
+}
+
+/// Release the `line_sender_opts` object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_opts_free(opts: *mut line_sender_opts) {
+    if !opts.is_null() {
+        drop(Box::from_raw(opts));
+    }
+}
+
+/// Inserts data into QuestDB via the InfluxDB Line Protocol.
+///
+/// Batch up rows in a `line_sender_buffer`, then call `line_sender_flush()` or
+/// one of its variants with this object to send them.
+pub struct line_sender(Sender);
+
+/// Create a new line sender instance from the given options object.
+///
+/// In the case of TCP, this synchronously establishes the TCP connection, and
+/// returns once the connection is fully established. If the connection
+/// requires authentication or TLS, these will also be completed before
+/// returning.
+///
+/// The sender should be accessed by only a single thread a time.
+///
+/// @param[in] opts Options for the connection.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_build(
+    opts: *const line_sender_opts,
+    err_out: *mut *mut line_sender_error,
+) -> *mut line_sender {
+    let builder = &(*opts).0;
+    let sender = bubble_err_to_c!(err_out, builder.build(), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender(sender)))
+}
+
+/// Create a new line sender instance from the given configuration string.
+/// The format of the string is: "tcp::addr=host:port;key=value;...;"
+/// Instead of "tcp" you can also specify "tcps", "http", and "https".
+///
+/// The accepted keys match one-for-one with the functions on `line_sender_opts`.
+/// For example, this is a valid configuration string:
+///
+/// "https::addr=host:port;username=alice;password=secret;"
+///
+/// and there are matching functions `line_sender_opts_username()` and
+/// `line_sender_opts_password()`. The value for `addr=` is supplied directly to
+/// `line_sender_opts_new`, so there's no function with a matching name.
+///
+/// For the full list of keys, search this header for `bool line_sender_opts_`.
+///
+/// In the case of TCP, this synchronously establishes the TCP connection, and
+/// returns once the connection is fully established. If the connection
+/// requires authentication or TLS, these will also be completed before
+/// returning.
+///
+/// The sender should be accessed by only a single thread a time.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_from_conf(
+    config: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> *mut line_sender {
+    let config = config.as_str();
+    let builder = bubble_err_to_c!(err_out, SenderBuilder::from_conf(config), ptr::null_mut());
+    let builder = builder
+        .user_agent(concat!("questdb/c/", env!("CARGO_PKG_VERSION")))
+        .expect("user_agent set");
+    let sender = bubble_err_to_c!(err_out, builder.build(), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender(sender)))
+}
+
+/// Create a new `line_sender` instance from the configuration stored in the
+/// `QDB_CLIENT_CONF` environment variable.
+///
+/// In the case of TCP, this synchronously establishes the TCP connection, and
+/// returns once the connection is fully established. If the connection
+/// requires authentication or TLS, these will also be completed before
+/// returning.
+///
+/// The sender should be accessed by only a single thread a time.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_from_env(
+    err_out: *mut *mut line_sender_error,
+) -> *mut line_sender {
+    let builder = bubble_err_to_c!(err_out, SenderBuilder::from_env(), ptr::null_mut());
+    let builder = builder
+        .user_agent(concat!("questdb/c/", env!("CARGO_PKG_VERSION")))
+        .expect("user_agent set");
+    let sender = bubble_err_to_c!(err_out, builder.build(), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender(sender)))
+}
+
+unsafe fn unwrap_sender<'a>(sender: *const line_sender) -> &'a Sender {
+    &(*sender).0
+}
+
+unsafe fn unwrap_sender_mut<'a>(sender: *mut line_sender) -> &'a mut Sender {
+    &mut (*sender).0
+}
+
+/// Tell whether the sender is no longer usable and must be closed.
+/// This happens when there was an earlier failure.
+/// This fuction is specific to TCP and is not relevant for HTTP.
+/// @param[in] sender Line sender object.
+/// @return true if an error occurred with a sender and it must be closed.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_must_close(sender: *const line_sender) -> bool {
+    unwrap_sender(sender).must_close()
+}
+
+/// The version of the line protocol the sender was built with, or
+/// negotiated with the server.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_get_protocol_version(
+    sender: *const line_sender,
+) -> line_sender_protocol_version {
+    unwrap_sender(sender).protocol_version().into()
+}
+
+/// The unit the sender expects designated timestamps in.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_get_timestamp_precision(
+    sender: *const line_sender,
+) -> line_sender_timestamp_precision {
+    unwrap_sender(sender).timestamp_precision().into()
+}
+
+/// Construct a `line_sender_buffer` encoded with the sender's protocol
+/// version and timestamp precision, and a `max_name_len` of `127`.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_new_buffer(
+    sender: *const line_sender,
+) -> *mut line_sender_buffer {
+    let buffer = unwrap_sender(sender).new_buffer();
+    Box::into_raw(Box::new(line_sender_buffer(buffer)))
+}
+
+/// Open a connection to the server ahead of the next flush by sending a
+/// `GET /ping` request, replacing the pooled connection if it was dropped
+/// whilst idle. Fails over between the hosts listed in `addr`.
+/// This is a no-op for ILP/TCP.
+/// @param[in] sender Line sender object.
+/// @return true on success, false if no host could be reached.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_warm_up(
+    sender: *mut line_sender,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let sender = unwrap_sender_mut(sender);
+    bubble_err_to_c!(err_out, sender.warm_up());
+    true
+}
+
+/// Close the connection. Does not flush. Non-idempotent.
+/// @param[in] sender Line sender object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_close(sender: *mut line_sender) {
+    if !sender.is_null() {
+        drop(Box::from_raw(sender));
+    }
+}
+
+/// Tell whether the buffer has reached any of the sender's auto-flush
+/// thresholds (`auto_flush_rows`, `auto_flush_bytes` and
+/// `auto_flush_interval`) and should now be flushed.
+///
+/// A buffer is only ever due after a call to `line_sender_buffer_at_nanos()`,
+/// `line_sender_buffer_at_micros()` or `line_sender_buffer_at_now()`.
+/// Always returns false if the sender was configured with `auto_flush=off`.
+/// @param[in] sender Line sender object.
+/// @param[in] buffer Line buffer object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_should_flush(
+    sender: *const line_sender,
+    buffer: *const line_sender_buffer,
+) -> bool {
+    unwrap_sender(sender).should_flush(unwrap_buffer(buffer))
+}
+
+/// Send the given buffer of rows to the QuestDB server, clearing the buffer.
+///
+/// After this function returns, the buffer is empty and ready for the next batch.
+/// If you want to preserve the buffer contents, call `line_sender_flush_and_keep`.
+/// If you want to ensure the flush is transactional, call
+/// `line_sender_flush_and_keep_with_flags`.
+///
+/// With ILP-over-HTTP, this function sends an HTTP request and waits for the
+/// response. If the server responds with an error, it returns a descriptive error.
+/// In the case of a network error, it retries until it has exhausted the retry time
+/// budget.
+///
+/// With ILP-over-TCP, the function blocks only until the buffer is flushed to the
+/// underlying OS-level network socket, without waiting to actually send it to the
+/// server. In the case of an error, the server will quietly disconnect: consult the
+/// server logs for error messages.
+///
+/// HTTP should be the first choice, but use TCP if you need to continuously send
+/// data to the server at a high rate.
+///
+/// To improve the HTTP performance, send larger buffers (with more rows), and
+/// consider parallelizing writes using multiple senders from multiple threads.
+///
+/// @param[in] sender Line sender object.
+/// @param[in] buffer Line buffer object.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_flush(
+    sender: *mut line_sender,
+    buffer: *mut line_sender_buffer,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let sender = unwrap_sender_mut(sender);
+    let buffer = unwrap_buffer_mut(buffer);
+    bubble_err_to_c!(err_out, sender.flush(buffer));
+    true
+}
+
+/// Send the given buffer of rows to the QuestDB server, clearing the buffer,
+/// like `line_sender_flush`, but split it into as many back-to-back requests
+/// of at most `max_buf_size` bytes as needed, cut at row boundaries.
+///
+/// The flush is never transactional. If a request fails, the rows already
+/// sent stay in the buffer, their size reported by
+/// `line_sender_buffer_send_offset`. Call this function again with the same
+/// buffer to resume from the first unsent row, or clear the buffer.
+/// @param[in] sender Line sender object.
+/// @param[in] buffer Line buffer object.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_flush_chunked(
+    sender: *mut line_sender,
+    buffer: *mut line_sender_buffer,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let sender = unwrap_sender_mut(sender);
+    let buffer = unwrap_buffer_mut(buffer);
+    bubble_err_to_c!(err_out, sender.flush_chunked(buffer));
+    true
+}
+
+/// Send a file of pre-serialized ILP rows, such as one written out from
+/// `line_sender_buffer_peek` while the server was unreachable.
+///
+/// The file is memory-mapped and checked for complete rows, none longer than
+/// `max_buf_size`, before anything is sent. The rows are then sent in runs of
+/// up to `max_buf_size` bytes, each as a write or request of its own. Plain
+/// TCP connections on Linux use `sendfile(2)`. If a run fails, the runs
+/// before it have already been sent.
+/// @param[in] sender Line sender object.
+/// @param[in] path Path to the file.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_send_file(
+    sender: *mut line_sender,
+    path: line_sender_utf8,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let sender = unwrap_sender_mut(sender);
+    bubble_err_to_c!(err_out, sender.send_file(path.as_str()));
+    true
+}
+
+/// Send the given buffer of rows to the QuestDB server.
+///
+/// All the data stays in the buffer. Clear the buffer before starting a new batch.
+///
+/// To send and clear in one step, call `line_sender_flush` instead. Also, see the docs
+/// on that function for more important details on flushing.
+/// @param[in] sender Line sender object.
+/// @param[in] buffer Line buffer object.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_flush_and_keep(
+    sender: *mut line_sender,
+    buffer: *const line_sender_buffer,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let sender = unwrap_sender_mut(sender);
+    let buffer = unwrap_buffer(buffer);
+    bubble_err_to_c!(err_out, sender.flush_and_keep(buffer));
+    true
+}
+
+/// Send several buffers of rows to the QuestDB server, clearing them.
+///
+/// With ILP-over-TCP, all the buffers are written to the socket in a single
+/// scatter-gather call where possible, without first being concatenated.
+/// If the write fails, none of the buffers are cleared.
+///
+/// With ILP-over-HTTP, each buffer is sent as a separate request, in order.
+/// If a request fails, the buffers sent before it are cleared.
+///
+/// @param[in] sender Line sender object.
+/// @param[in] buffers Array of `count` line buffer objects.
+/// @param[in] count Number of buffers.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_flush_many(
+    sender: *mut line_sender,
+    buffers: *const *mut line_sender_buffer,
+    count: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let sender = unwrap_sender_mut(sender);
+    let mut buffers: Vec<&mut Buffer> =
+        col_values::<*mut line_sender_buffer>(buffers as *const c_void, count)
+            .iter()
+            .map(|&buffer| unwrap_buffer_mut(buffer))
+            .collect();
+    bubble_err_to_c!(err_out, sender.flush_many(&mut buffers));
+    true
+}
+
+/// Switch an ILP-over-TCP sender in or out of non-blocking mode.
+///
+/// In non-blocking mode, send buffers with `line_sender_try_flush`, and
+/// register the socket from `line_sender_raw_socket` with your event loop.
+/// The blocking flush functions return an error in this mode.
+/// @param[in] sender Line sender object.
+/// @param[in] nonblocking Whether to enable non-blocking mode.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_set_nonblocking(
+    sender: *mut line_sender,
+    nonblocking: bool,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let sender = unwrap_sender_mut(sender);
+    bubble_err_to_c!(err_out, sender.set_nonblocking(nonblocking));
+    true
+}
+
+/// Send as much of the buffer as the socket accepts without blocking.
+///
+/// Sets `*done_out` to true once the whole buffer is sent, at which point the
+/// buffer is cleared. Otherwise, sets it to false and records the progress in
+/// the buffer: Call this function with the same buffer again once the socket
+/// is writable. Don't clear the buffer in the meantime.
+///
+/// This function is specific to ILP-over-TCP.
+/// @param[in] sender Line sender object.
+/// @param[in] buffer Line buffer object.
+/// @param[out] done_out Whether the buffer was sent in full.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_try_flush(
+    sender: *mut line_sender,
+    buffer: *mut line_sender_buffer,
+    done_out: *mut bool,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let sender = unwrap_sender_mut(sender);
+    let buffer = unwrap_buffer_mut(buffer);
+    *done_out = bubble_err_to_c!(err_out, sender.try_flush(buffer));
+    true
+}
+
+/// How long, in microseconds rounded up, until `line_sender_try_flush` may
+/// send again under the `max_send_rate` and `max_rows_rate` limits.
+/// Zero without limits, or if it can send right away.
+/// @param[in] sender Line sender object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_try_flush_delay_micros(sender: *const line_sender) -> u64 {
+    let delay = unwrap_sender(sender).try_flush_delay();
+    delay.as_nanos().div_ceil(1000) as u64
+}
+
+/// A raw socket: A file descriptor on POSIX systems, a `SOCKET` on Windows.
+#[cfg(unix)]
+pub type line_sender_socket = libc::c_int;
+
+/// A raw socket: A file descriptor on POSIX systems, a `SOCKET` on Windows.
+#[cfg(windows)]
+pub type line_sender_socket = usize;
+
+/// Get the raw socket of an ILP-over-TCP sender, for registering with
+/// `epoll`, `kqueue`, IOCP and the like.
+///
+/// The sender retains ownership of the socket: Don't close it.
+/// @param[in] sender Line sender object.
+/// @param[out] socket_out The socket.
+/// @return true on success, false for ILP-over-HTTP senders, which have no
+///         single socket.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_raw_socket(
+    sender: *const line_sender,
+    socket_out: *mut line_sender_socket,
+) -> bool {
+    let sender = unwrap_sender(sender);
+
+    #[cfg(unix)]
+    let socket = sender.raw_fd();
+
+    #[cfg(windows)]
+    let socket = sender.raw_socket().map(|socket| socket as usize);
+
+    match socket {
+        Some(socket) => {
+            *socket_out = socket;
+            true
+        }
+        None => false,
+    }
+}
+
+/// A snapshot of a sender's flush counters. See `line_sender_get_stats`.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct line_sender_stats {
+    /// Number of successful flushes.
+    flushes: u64,
+
+    /// Number of flushes that returned an error.
+    failed_flushes: u64,
+
+    /// Uncompressed ILP bytes flushed successfully.
+    bytes_sent: u64,
+
+    /// Rows flushed successfully.
+    rows_sent: u64,
+
+    /// ILP/HTTP requests retried after a network error.
+    network_retries: u64,
+
+    /// ILP/HTTP requests retried after a retriable status code.
+    server_retries: u64,
+
+    /// Total time spent sleeping between ILP/HTTP retries.
+    retry_sleep_micros: u64,
+
+    /// Time taken to connect, including TLS and authentication. TCP only.
+    connect_micros: u64,
+
+    /// Number of timed flushes.
+    flush_latency_count: u64,
+
+    /// Mean flush latency.
+    flush_latency_mean_micros: u64,
+
+    /// Median flush latency.
+    flush_latency_p50_micros: u64,
+
+    /// 90th percentile flush latency.
+    flush_latency_p90_micros: u64,
+
+    /// 99th percentile flush latency.
+    flush_latency_p99_micros: u64,
+
+    /// 99.9th percentile flush latency.
+    flush_latency_p999_micros: u64,
+
+    /// Slowest flush.
+    flush_latency_max_micros: u64,
+
+    /// ILP/TCP connections re-established after a write error.
+    reconnects: u64,
+
+    /// Spooled ILP/HTTP buffers the server rejected on replay.
+    spool_rejected: u64,
+}
+
+fn duration_micros(duration: std::time::Duration) -> u64 {
+    u64::try_from(duration.as_micros()).unwrap_or(u64::MAX)
+}
+
+/// Take a snapshot of the sender's flush counters.
+///
+/// The counters are updated without locking, so this is cheap enough to call
+/// from a periodic metrics exporter.
+/// @param[in] sender Line sender object.
+/// @param[out] stats_out The snapshot.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_get_stats(
+    sender: *const line_sender,
+    stats_out: *mut line_sender_stats,
+) {
+    *stats_out = c_stats(unwrap_sender(sender).stats());
+}
+
+fn c_stats(stats: SenderStats) -> line_sender_stats {
+    let latency = &stats.flush_latency;
+    line_sender_stats {
+        flushes: stats.flushes,
+        failed_flushes: stats.failed_flushes,
+        bytes_sent: stats.bytes_sent,
+        rows_sent: stats.rows_sent,
+        network_retries: stats.network_retries,
+        server_retries: stats.server_retries,
+        retry_sleep_micros: duration_micros(stats.retry_sleep),
+        connect_micros: duration_micros(stats.connect_time),
+        flush_latency_count: latency.count(),
+        flush_latency_mean_micros: duration_micros(latency.mean()),
+        flush_latency_p50_micros: duration_micros(latency.quantile(0.5)),
+        flush_latency_p90_micros: duration_micros(latency.quantile(0.9)),
+        flush_latency_p99_micros: duration_micros(latency.quantile(0.99)),
+        flush_latency_p999_micros: duration_micros(latency.quantile(0.999)),
+        flush_latency_max_micros: duration_micros(latency.max()),
+        reconnects: stats.reconnects,
+        spool_rejected: stats.spool_rejected,
+    }
+}
+
+/// The stage of a flush timed by a `line_sender_span`.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub enum line_sender_span_kind {
+    /// The whole flush call, emitted last. `bytes` is the size of the buffer.
+    line_sender_span_kind_flush,
+
+    /// Writing the buffer to the ILP/TCP socket.
+    line_sender_span_kind_tcp_write,
+
+    /// Encoding, and if configured compressing, the ILP/HTTP request body.
+    line_sender_span_kind_encode,
+
+    /// A single ILP/HTTP request attempt.
+    line_sender_span_kind_http_attempt,
+
+    /// The ILP/HTTP request, from the first attempt to the last.
+    line_sender_span_kind_http_request,
+
+    /// Reading and parsing an ILP/HTTP error response.
+    line_sender_span_kind_parse_response,
+}
+
+impl From<FlushSpanKind> for line_sender_span_kind {
+    fn from(kind: FlushSpanKind) -> Self {
+        match kind {
+            FlushSpanKind::Flush => line_sender_span_kind::line_sender_span_kind_flush,
+            FlushSpanKind::TcpWrite => line_sender_span_kind::line_sender_span_kind_tcp_write,
+            FlushSpanKind::Encode => line_sender_span_kind::line_sender_span_kind_encode,
+            FlushSpanKind::HttpAttempt => line_sender_span_kind::line_sender_span_kind_http_attempt,
+            FlushSpanKind::HttpRequest => line_sender_span_kind::line_sender_span_kind_http_request,
+            FlushSpanKind::ParseResponse => {
+                line_sender_span_kind::line_sender_span_kind_parse_response
+            }
+        }
+    }
+}
+
+/// A timed stage of a flush. See `line_sender_set_trace_callback`.
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct line_sender_span {
+    /// Which stage of the flush this span times.
+    kind: line_sender_span_kind,
+
+    /// How long the stage took.
+    duration_nanos: u64,
+
+    /// Number of bytes the stage handled.
+    bytes: size_t,
+
+    /// The ILP/HTTP request attempt, counting from 1, or 0 outside a request.
+    attempt: u32,
+
+    /// The ILP/HTTP status code, or 0 if no response was received.
+    status_code: u16,
+
+    /// The `errorId` of an ILP/HTTP error response. Empty if there's none.
+    error_id: line_sender_utf8,
+}
+
+/// Called on the flushing thread as each stage of a flush completes.
+/// The span is only valid for the duration of the call.
+pub type line_sender_trace_callback =
+    Option<unsafe extern "C" fn(ctx: *mut c_void, span: *const line_sender_span)>;
+
+/// Register a callback that receives a timed span for each stage of every
+/// flush, ending with the flush as a whole. Replaces any previous callback.
+///
+/// The callback runs synchronously on the flushing thread: Keep it short.
+/// @param[in] sender Line sender object.
+/// @param[in] callback Trace callback, or NULL to stop tracing.
+/// @param[in] ctx Opaque pointer passed back to the callback.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_set_trace_callback(
+    sender: *mut line_sender,
+    callback: line_sender_trace_callback,
+    ctx: *mut c_void,
+) {
+    let sender = unwrap_sender_mut(sender);
+    let Some(callback) = callback else {
+        sender.clear_trace_hook();
+        return;
+    };
+    let ctx = SendPtr(ctx);
+    sender.set_trace_hook(move |span| {
+        let ctx = &ctx;
+        let error_id = span.error_id.unwrap_or("");
+        let span = line_sender_span {
+            kind: span.kind.into(),
+            duration_nanos: u64::try_from(span.duration.as_nanos()).unwrap_or(u64::MAX),
+            bytes: span.bytes,
+            attempt: span.attempt,
+            status_code: span.status_code.unwrap_or(0),
+            error_id: line_sender_utf8 {
+                len: error_id.len(),
+                buf: error_id.as_ptr() as *const c_char,
+            },
+        };
+        callback(ctx.0, &span);
+    });
+}
+
+/// Send the batch of rows in the buffer to the QuestDB server, and, if the parameter
+/// `transactional` is true, ensure the flush will be transactional.
+///
+/// A flush is transactional iff all the rows belong to the same table. This allows
+/// QuestDB to treat the flush as a single database transaction, because it doesn't
+/// support transactions spanning multiple tables. Additionally, only ILP-over-HTTP
+/// supports transactional flushes.
+///
+/// If the flush wouldn't be transactional, this function returns an error and
+/// doesn't flush any data.
+///
+/// The function sends an HTTP request and waits for the response. If the server
+/// responds with an error, it returns a descriptive error. In the case of a network
+/// error, it retries until it has exhausted the retry time budget.
+///
+/// All the data stays in the buffer. Clear the buffer before starting a new batch.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_flush_and_keep_with_flags(
+    sender: *mut line_sender,
+    buffer: *const line_sender_buffer,
+    transactional: bool,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let sender = unwrap_sender_mut(sender);
+    let buffer = unwrap_buffer(buffer);
+    bubble_err_to_c!(
+        err_out,
+        sender.flush_and_keep_with_flags(buffer, transactional)
+    );
+    true
+}
+
+/// Called by `line_sender_flush_stream` to write the next chunk of rows into
+/// the empty `buffer`. Sets `*more` to whether further chunks follow.
+/// Returns false to abort the request, setting `*err_out` if an error is to
+/// be reported.
+pub type line_sender_stream_callback = unsafe extern "C" fn(
+    ctx: *mut c_void,
+    buffer: *mut line_sender_buffer,
+    more: *mut bool,
+    err_out: *mut *mut line_sender_error,
+) -> bool;
+
+/// Send a batch of rows too large to buffer whole as a single ILP/HTTP
+/// request, serializing them chunk by chunk as the request body is sent.
+///
+/// The callback is called with an empty buffer until it reports the last
+/// chunk. With `transactional`, all the rows must belong to the same table.
+/// A failed attempt is retried by resending the rows from a replay window of
+/// up to `stream_replay_window` bytes. Only supported for ILP over HTTP.
+///
+/// @param[in] sender Line sender object.
+/// @param[in] transactional Whether the rows must be sent as one transaction.
+/// @param[in] callback Writes the next chunk of rows.
+/// @param[in] ctx Opaque pointer passed back to the callback.
+/// @return true on success, false on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_flush_stream(
+    sender: *mut line_sender,
+    transactional: bool,
+    callback: line_sender_stream_callback,
+    ctx: *mut c_void,
+    err_out: *mut *mut line_sender_error,
+) -> bool {
+    let sender = unwrap_sender_mut(sender);
+    let fill = |buffer: &mut Buffer| {
+        let mut more = false;
+        let mut err: *mut line_sender_error = ptr::null_mut();
+        let buffer = buffer as *mut Buffer as *mut line_sender_buffer;
+        if callback(ctx, buffer, &mut more, &mut err) {
+            Ok(more)
+        } else if err.is_null() {
+            Err(Error::new(
+                ErrorCode::InvalidApiCall,
+                "The stream callback aborted the request.",
+            ))
+        } else {
+            Err(Box::from_raw(err).0)
+        }
+    };
+    bubble_err_to_c!(err_out, sender.flush_stream(transactional, fill));
     true
 }
 
-/// Accumulates parameters for a new `line_sender` object.
-pub struct line_sender_opts(SenderBuilder);
+/// Flushes buffers from a dedicated I/O thread.
+/// See `line_sender_into_background`.
+pub struct line_sender_background(BackgroundSender);
 
-/// Create a new `line_sender_opts` instance from the given configuration string.
-/// The format of the string is: "tcp::addr=host:port;key=value;...;"
-/// Instead of "tcp" you can also specify "tcps", "http", and "https".
+/// Tracks the completion of a flush submitted via `line_sender_background_flush`.
+pub struct line_sender_flush_handle(FlushHandle);
+
+/// Called on the I/O thread once a background flush has completed.
+/// `err` is NULL on success. Otherwise it is only valid for the duration of the
+/// call and must not be freed by the callback.
+pub type line_sender_flush_callback =
+    Option<unsafe extern "C" fn(ctx: *mut c_void, err: *const line_sender_error)>;
+
+struct SendPtr(*mut c_void);
+
+// The callback context is owned by the caller, who guarantees it is safe to
+// access from the I/O thread.
+unsafe impl Send for SendPtr {}
+
+/// Move the sender to a dedicated I/O thread, so that flushing no longer blocks
+/// the calling thread.
 ///
-/// The accepted keys match one-for-one with the functions on `line_sender_opts`.
-/// For example, this is a valid configuration string:
+/// This function takes ownership of the sender in all cases: Don't use or close
+/// the `sender` after this call, even on error.
 ///
-/// "https::addr=host:port;username=alice;password=secret;"
+/// @param[in] sender Line sender object.
+/// @param[in] ring_size Number of buffers that may be in flight at any one time.
+/// @return The background sender, or NULL on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_into_background(
+    sender: *mut line_sender,
+    ring_size: size_t,
+    err_out: *mut *mut line_sender_error,
+) -> *mut line_sender_background {
+    let sender = Box::from_raw(sender).0;
+    let background = bubble_err_to_c!(err_out, sender.into_background(ring_size), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender_background(background)))
+}
+
+unsafe fn unwrap_background_mut<'a>(
+    background: *mut line_sender_background,
+) -> &'a mut BackgroundSender {
+    &mut (*background).0
+}
+
+/// Hand the buffer over to the I/O thread to be sent, and replace its contents
+/// with an empty buffer from the ring.
 ///
-/// and there are matching functions `line_sender_opts_username()` and
-/// `line_sender_opts_password()`. The value for `addr=` is supplied directly to
-/// `line_sender_opts_new`, so there's no function with a matching name.
+/// Returns as soon as the buffer is queued. If all the buffers of the ring are
+/// in flight, this blocks until the I/O thread returns one.
 ///
-/// For the full list of keys, search this module for `fn line_sender_opts_`.
+/// @param[in] background Background sender object.
+/// @param[in] buffer Line buffer object. Empty on return.
+/// @return A flush handle to be passed to `line_sender_flush_handle_wait`, or
+///         NULL on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_from_conf(
-    config: line_sender_utf8,
+pub unsafe extern "C" fn line_sender_background_flush(
+    background: *mut line_sender_background,
+    buffer: *mut line_sender_buffer,
     err_out: *mut *mut line_sender_error,
-) -> *mut line_sender_opts {
-    let config = config.as_str();
-    let builder = bubble_err_to_c!(err_out, SenderBuilder::from_conf(config), ptr::null_mut());
-    Box::into_raw(Box::new(line_sender_opts(builder)))
+) -> *mut line_sender_flush_handle {
+    let background = unwrap_background_mut(background);
+    let buffer = unwrap_buffer_mut(buffer);
+    let handle = bubble_err_to_c!(err_out, background.flush(buffer), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender_flush_handle(handle)))
 }
 
-/// Create a new `line_sender_opts` instance from the configuration stored in the
-/// `QDB_CLIENT_CONF` environment variable.
+/// Like `line_sender_background_flush`, but reports the outcome by invoking
+/// `callback` on the I/O thread instead of returning a handle.
+///
+/// @param[in] background Background sender object.
+/// @param[in] buffer Line buffer object. Empty on return.
+/// @param[in] callback Completion callback.
+/// @param[in] ctx Opaque pointer passed back to the callback.
+/// @return true on success, false on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_from_env(
+pub unsafe extern "C" fn line_sender_background_flush_with_callback(
+    background: *mut line_sender_background,
+    buffer: *mut line_sender_buffer,
+    callback: line_sender_flush_callback,
+    ctx: *mut c_void,
     err_out: *mut *mut line_sender_error,
-) -> *mut line_sender_opts {
-    let builder = bubble_err_to_c!(err_out, SenderBuilder::from_env(), ptr::null_mut());
-    Box::into_raw(Box::new(line_sender_opts(builder)))
+) -> bool {
+    let background = unwrap_background_mut(background);
+    let buffer = unwrap_buffer_mut(buffer);
+    let ctx = SendPtr(ctx);
+    bubble_err_to_c!(
+        err_out,
+        background.flush_with_callback(buffer, move |res| {
+            let ctx = ctx;
+            if let Some(callback) = callback {
+                match res {
+                    Ok(()) => callback(ctx.0, ptr::null()),
+                    Err(err) => {
+                        let err = line_sender_error(err);
+                        callback(ctx.0, &err);
+                    }
+                }
+            }
+        })
+    );
+    true
 }
 
-/// Create a new `line_sender_opts` instance with the given protocol, hostname and
-/// port.
-/// @param[in] protocol The protocol to use.
-/// @param[in] host The QuestDB database host.
-/// @param[in] port The QuestDB ILP TCP port.
+/// Wait for all queued flushes to complete, then stop the I/O thread and close
+/// the connection.
+/// @param[in] background Background sender object.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_new(
-    protocol: line_sender_protocol,
-    host: line_sender_utf8,
-    port: u16,
-) -> *mut line_sender_opts {
-    let builder = SenderBuilder::new(protocol.into(), host.as_str(), port);
-    let builder = builder
-        .user_agent(concat!("questdb/c/", env!("CARGO_PKG_VERSION")))
-        .expect("user_agent set");
-    Box::into_raw(Box::new(line_sender_opts(builder)))
+pub unsafe extern "C" fn line_sender_background_close(background: *mut line_sender_background) {
+    if !background.is_null() {
+        drop(Box::from_raw(background));
+    }
 }
 
-/// Create a new `line_sender_opts` instance with the given protocol, hostname and
-/// service name.
+/// Tell whether the flush has completed, without blocking.
+/// Once this returns true, `line_sender_flush_handle_wait` returns immediately.
+/// @param[in] handle Flush handle.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_new_service(
-    protocol: line_sender_protocol,
-    host: line_sender_utf8,
-    port: line_sender_utf8,
-) -> *mut line_sender_opts {
-    let builder = SenderBuilder::new(protocol.into(), host.as_str(), port.as_str());
-    let builder = builder
-        .user_agent(concat!("questdb/c/", env!("CARGO_PKG_VERSION")))
-        .expect("user_agent set");
-    Box::into_raw(Box::new(line_sender_opts(builder)))
+pub unsafe extern "C" fn line_sender_flush_handle_is_done(
+    handle: *mut line_sender_flush_handle,
+) -> bool {
+    (*handle).0.is_done()
 }
 
-/// Select local outbound network "bind" interface.
-///
-/// This may be relevant if your machine has multiple network interfaces.
-///
-/// The default is `0.0.0.0`.
+/// Block until the flush has completed and report its outcome.
+/// This releases the handle: Don't use it after this call.
+/// @param[in] handle Flush handle.
+/// @return true if the flush succeeded, false on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_bind_interface(
-    opts: *mut line_sender_opts,
-    bind_interface: line_sender_utf8,
+pub unsafe extern "C" fn line_sender_flush_handle_wait(
+    handle: *mut line_sender_flush_handle,
     err_out: *mut *mut line_sender_error,
 ) -> bool {
-    upd_opts!(opts, err_out, bind_interface, bind_interface.as_str())
+    let handle = Box::from_raw(handle).0;
+    bubble_err_to_c!(err_out, handle.wait());
+    true
 }
 
-/// Set the username for authentication.
+/// Release the flush handle without waiting. This does not cancel the flush.
+/// @param[in] handle Flush handle.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_flush_handle_free(handle: *mut line_sender_flush_handle) {
+    if !handle.is_null() {
+        drop(Box::from_raw(handle));
+    }
+}
+
+/// A fixed-size set of connections that can be shared between threads.
+/// See `line_sender_pool_build`.
+pub struct line_sender_pool(SenderPool);
+
+/// Create a new sender pool from the given options object, opening
+/// `pool_size` connections.
 ///
-/// For TCP, this is the `kid` part of the ECDSA key set.
-/// The other fields are `token` `token_x` and `token_y`.
+/// In the case of TCP, all the connections are established before this
+/// function returns.
 ///
-/// For HTTP, this is part of basic authentication.
-/// See also: `line_sender_opts_password()`.
+/// Unlike `line_sender`, the pool may be used from multiple threads at once.
+///
+/// @param[in] opts Options for the connections.
+/// @return The sender pool, or NULL on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_username(
-    opts: *mut line_sender_opts,
-    username: line_sender_utf8,
+pub unsafe extern "C" fn line_sender_pool_build(
+    opts: *const line_sender_opts,
     err_out: *mut *mut line_sender_error,
-) -> bool {
-    upd_opts!(opts, err_out, username, username.as_str())
+) -> *mut line_sender_pool {
+    let builder = &(*opts).0;
+    let pool = bubble_err_to_c!(err_out, builder.build_pool(), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender_pool(pool)))
 }
 
-/// Set the password for basic HTTP authentication.
-/// See also: `line_sender_opts_username()`.
+/// Create a new sender pool from the given configuration string.
+/// The format is the same as for `line_sender_from_conf`, plus the `pool_size`
+/// key for the number of connections.
+///
+/// Unlike `line_sender`, the pool may be used from multiple threads at once.
+///
+/// @return The sender pool, or NULL on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_password(
-    opts: *mut line_sender_opts,
-    password: line_sender_utf8,
+pub unsafe extern "C" fn line_sender_pool_from_conf(
+    config: line_sender_utf8,
     err_out: *mut *mut line_sender_error,
-) -> bool {
-    upd_opts!(opts, err_out, password, password.as_str())
+) -> *mut line_sender_pool {
+    let config = config.as_str();
+    let builder = bubble_err_to_c!(err_out, SenderBuilder::from_conf(config), ptr::null_mut());
+    let builder = builder
+        .user_agent(concat!("questdb/c/", env!("CARGO_PKG_VERSION")))
+        .expect("user_agent set");
+    let pool = bubble_err_to_c!(err_out, builder.build_pool(), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender_pool(pool)))
 }
 
-/// Set the Token (Bearer) Authentication parameter for HTTP,
-/// or the ECDSA private key for TCP authentication.
+/// Create a new sender pool from the configuration stored in the
+/// `QDB_CLIENT_CONF` environment variable.
+///
+/// Unlike `line_sender`, the pool may be used from multiple threads at once.
+///
+/// @return The sender pool, or NULL on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_token(
-    opts: *mut line_sender_opts,
-    token: line_sender_utf8,
+pub unsafe extern "C" fn line_sender_pool_from_env(
     err_out: *mut *mut line_sender_error,
-) -> bool {
-    upd_opts!(opts, err_out, token, token.as_str())
+) -> *mut line_sender_pool {
+    let builder = bubble_err_to_c!(err_out, SenderBuilder::from_env(), ptr::null_mut());
+    let builder = builder
+        .user_agent(concat!("questdb/c/", env!("CARGO_PKG_VERSION")))
+        .expect("user_agent set");
+    let pool = bubble_err_to_c!(err_out, builder.build_pool(), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender_pool(pool)))
 }
 
-/// Set the ECDSA public key X for TCP authentication.
+unsafe fn unwrap_pool<'a>(pool: *const line_sender_pool) -> &'a SenderPool {
+    &(*pool).0
+}
+
+/// The number of connections in the pool.
+/// @param[in] pool Sender pool object.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_token_x(
-    opts: *mut line_sender_opts,
-    token_x: line_sender_utf8,
-    err_out: *mut *mut line_sender_error,
-) -> bool {
-    upd_opts!(opts, err_out, token_x, token_x.as_str())
+pub unsafe extern "C" fn line_sender_pool_size(pool: *const line_sender_pool) -> size_t {
+    unwrap_pool(pool).pool_size()
 }
 
-/// Set the ECDSA public key Y for TCP authentication.
+/// Send the buffer over the pool's least-loaded connection, clearing the
+/// buffer.
+///
+/// Blocks until a connection is idle. See `line_sender_flush` for the details
+/// on flushing.
+///
+/// @param[in] pool Sender pool object.
+/// @param[in] buffer Line buffer object.
+/// @return true on success, false on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_token_y(
-    opts: *mut line_sender_opts,
-    token_y: line_sender_utf8,
+pub unsafe extern "C" fn line_sender_pool_flush(
+    pool: *const line_sender_pool,
+    buffer: *mut line_sender_buffer,
     err_out: *mut *mut line_sender_error,
 ) -> bool {
-    upd_opts!(opts, err_out, token_y, token_y.as_str())
+    let pool = unwrap_pool(pool);
+    let buffer = unwrap_buffer_mut(buffer);
+    bubble_err_to_c!(err_out, pool.flush(buffer));
+    true
 }
 
-/// Configure how long to wait for messages from the QuestDB server during
-/// the TLS handshake and authentication process.
-/// The value is in milliseconds, and the default is 15 seconds.
+/// Send the buffer over the pool's least-loaded connection.
+///
+/// All the data stays in the buffer. Clear the buffer before starting a new batch.
+///
+/// @param[in] pool Sender pool object.
+/// @param[in] buffer Line buffer object.
+/// @return true on success, false on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_auth_timeout(
-    opts: *mut line_sender_opts,
-    timeout_millis: u64,
+pub unsafe extern "C" fn line_sender_pool_flush_and_keep(
+    pool: *const line_sender_pool,
+    buffer: *const line_sender_buffer,
     err_out: *mut *mut line_sender_error,
 ) -> bool {
-    let timeout = std::time::Duration::from_millis(timeout_millis);
-    upd_opts!(opts, err_out, auth_timeout, timeout)
+    let pool = unwrap_pool(pool);
+    let buffer = unwrap_buffer(buffer);
+    bubble_err_to_c!(err_out, pool.flush_and_keep(buffer));
+    true
 }
 
-/// Set to `false` to disable TLS certificate verification.
-/// This should only be used for debugging purposes as it reduces security.
+/// Transactional variant of `line_sender_pool_flush_and_keep`.
+/// See `line_sender_flush_and_keep_with_flags`.
 ///
-/// For testing consider specifying a path to a `.pem` file instead via
-/// the `tls_roots` setting.
+/// @param[in] pool Sender pool object.
+/// @param[in] buffer Line buffer object.
+/// @return true on success, false on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_tls_verify(
-    opts: *mut line_sender_opts,
-    verify: bool,
+pub unsafe extern "C" fn line_sender_pool_flush_and_keep_with_flags(
+    pool: *const line_sender_pool,
+    buffer: *const line_sender_buffer,
+    transactional: bool,
     err_out: *mut *mut line_sender_error,
 ) -> bool {
-    upd_opts!(opts, err_out, tls_verify, verify)
+    let pool = unwrap_pool(pool);
+    let buffer = unwrap_buffer(buffer);
+    bubble_err_to_c!(
+        err_out,
+        pool.flush_and_keep_with_flags(buffer, transactional)
+    );
+    true
 }
 
-/// Specify where to find the certificate authority used to validate
-/// the validate the server's TLS certificate.
+/// Close all the connections of the pool. Does not flush.
+/// No other thread may be using the pool during this call.
+/// @param[in] pool Sender pool object.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_tls_ca(
-    opts: *mut line_sender_opts,
-    ca: line_sender_ca,
-    err_out: *mut *mut line_sender_error,
-) -> bool {
-    let ca: CertificateAuthority = ca.into();
-    upd_opts!(opts, err_out, tls_ca, ca)
+pub unsafe extern "C" fn line_sender_pool_close(pool: *mut line_sender_pool) {
+    if !pool.is_null() {
+        drop(Box::from_raw(pool));
+    }
 }
 
-/// Set the path to a custom root certificate `.pem` file.
-/// This is used to validate the server's certificate during the TLS handshake.
+/// Routes rows across several servers, each holding a shard of the data.
+/// See `line_sender_sharded_from_conf`.
+pub struct line_sender_sharded(ShardedSender);
+
+/// Create a new sharded sender from the given configuration string.
 ///
-/// See notes on how to test with [self-signed
-/// certificates](https://github.com/questdb/c-questdb-client/tree/main/tls_certs).
+/// The format is the same as for `line_sender_from_conf`, except that `addr`
+/// is replaced by `shards`, a comma-separated list of the shards' addresses,
+/// each with optional `|`-separated failover addresses. `shard_by=table` (the
+/// default) routes rows by table name, and `shard_by=symbol` together with
+/// `shard_key=<column>` by the value of a symbol column.
+///
+/// In the case of TCP, all the connections are established before this
+/// function returns.
+///
+/// @return The sharded sender, or NULL on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_tls_roots(
-    opts: *mut line_sender_opts,
-    path: line_sender_utf8,
+pub unsafe extern "C" fn line_sender_sharded_from_conf(
+    config: line_sender_utf8,
     err_out: *mut *mut line_sender_error,
-) -> bool {
-    let path = PathBuf::from(path.as_str());
-    upd_opts!(opts, err_out, tls_roots, path)
+) -> *mut line_sender_sharded {
+    let config = config.as_str();
+    let (builders, by) = bubble_err_to_c!(
+        err_out,
+        ShardedSender::builders_from_conf(config),
+        ptr::null_mut()
+    );
+    let builders = builders
+        .into_iter()
+        .map(|builder| {
+            builder
+                .user_agent(concat!("questdb/c/", env!("CARGO_PKG_VERSION")))
+                .expect("user_agent set")
+        })
+        .collect();
+    let sharded = bubble_err_to_c!(err_out, ShardedSender::new(builders, by), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender_sharded(sharded)))
 }
 
-/// Set the maximum buffer size in bytes that the client will flush to the server.
-/// The default is 100 MiB.
-#[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_max_buf_size(
-    opts: *mut line_sender_opts,
-    max_buf_size: size_t,
-    err_out: *mut *mut line_sender_error,
-) -> bool {
-    upd_opts!(opts, err_out, max_buf_size, max_buf_size)
+unsafe fn unwrap_sharded<'a>(sharded: *const line_sender_sharded) -> &'a ShardedSender {
+    &(*sharded).0
 }
 
-/// Set the cumulative duration spent in retries.
-/// The value is in milliseconds, and the default is 10 seconds.
-#[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_retry_timeout(
-    opts: *mut line_sender_opts,
-    millis: u64,
-    err_out: *mut *mut line_sender_error,
-) -> bool {
-    let retry_timeout = std::time::Duration::from_millis(millis);
-    upd_opts!(opts, err_out, retry_timeout, retry_timeout)
+unsafe fn unwrap_sharded_mut<'a>(sharded: *mut line_sender_sharded) -> &'a mut ShardedSender {
+    &mut (*sharded).0
 }
 
-/// Set the minimum acceptable throughput while sending a buffer to the server.
-/// The sender will divide the payload size by this number to determine for how
-/// long to keep sending the payload before timing out.
-/// The value is in bytes per second, and the default is 100 KiB/s.
-/// The timeout calculated from minimum throughput is adedd to the value of
-/// `request_timeout`.
-///
-/// See also: `line_sender_opts_request_timeout()`
+/// The number of shards.
+/// @param[in] sharded Sharded sender object.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_request_min_throughput(
-    opts: *mut line_sender_opts,
-    bytes_per_sec: u64,
-    err_out: *mut *mut line_sender_error,
-) -> bool {
-    upd_opts!(opts, err_out, request_min_throughput, bytes_per_sec)
+pub unsafe extern "C" fn line_sender_sharded_shard_count(
+    sharded: *const line_sender_sharded,
+) -> size_t {
+    unwrap_sharded(sharded).shard_count()
 }
 
-/// Set the additional time to wait on top of that calculated from the minimum
-/// throughput. This accounts for the fixed latency of the HTTP request-response
-/// roundtrip. The value is in milliseconds, and the default is 10 seconds.
+/// Start recording a new row for the given table, in the table's shard.
+/// Only valid with `shard_by=table`.
 ///
-/// See also: `line_sender_opts_request_min_throughput()`
+/// Returns the shard's buffer, to continue the row with the
+/// `line_sender_buffer_*` functions. The buffer is owned by the sharded
+/// sender: Don't free it, and don't flush it other than with
+/// `line_sender_sharded_flush`.
+///
+/// @param[in] sharded Sharded sender object.
+/// @param[in] name Table name.
+/// @return The shard's buffer, or NULL on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_request_timeout(
-    opts: *mut line_sender_opts,
-    millis: u64,
+pub unsafe extern "C" fn line_sender_sharded_table(
+    sharded: *mut line_sender_sharded,
+    name: line_sender_table_name,
     err_out: *mut *mut line_sender_error,
-) -> bool {
-    let request_timeout = std::time::Duration::from_millis(millis);
-    upd_opts!(opts, err_out, request_timeout, request_timeout)
+) -> *mut line_sender_buffer {
+    let sharded = unwrap_sharded_mut(sharded);
+    let buffer = bubble_err_to_c!(err_out, sharded.table(name.as_name()), ptr::null_mut());
+    buffer as *mut Buffer as *mut line_sender_buffer
 }
 
-/// Set the HTTP user agent. Internal API. Do not use.
-#[doc(hidden)]
+/// Start recording a new row for the given table in the shard of `key`, and
+/// record `key` as the row's `shard_key` symbol. Record any other symbols
+/// next. Only valid with `shard_by=symbol`.
+///
+/// Returns the shard's buffer, as per `line_sender_sharded_table`.
+///
+/// @param[in] sharded Sharded sender object.
+/// @param[in] name Table name.
+/// @param[in] key Shard key value.
+/// @return The shard's buffer, or NULL on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_user_agent(
-    opts: *mut line_sender_opts,
-    user_agent: line_sender_utf8,
+pub unsafe extern "C" fn line_sender_sharded_table_with_key(
+    sharded: *mut line_sender_sharded,
+    name: line_sender_table_name,
+    key: line_sender_utf8,
     err_out: *mut *mut line_sender_error,
-) -> bool {
-    upd_opts!(opts, err_out, user_agent, user_agent.as_str())
+) -> *mut line_sender_buffer {
+    let sharded = unwrap_sharded_mut(sharded);
+    let buffer = bubble_err_to_c!(
+        err_out,
+        sharded.table_with_key(name.as_name(), key.as_str()),
+        ptr::null_mut()
+    );
+    buffer as *mut Buffer as *mut line_sender_buffer
 }
 
-/// Duplicate the `line_sender_opts` object.
-/// Both old and new objects will have to be freed.
+/// Discard the row under construction, if it's incomplete.
+/// @param[in] sharded Sharded sender object.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_clone(
-    opts: *const line_sender_opts,
-) -> *mut line_sender_opts {
-    let builder = &(*opts).0;
-    let new_builder = builder.clone();
-    Box::into_raw(Box::new(line_sender_opts(new_builder)))
+pub unsafe extern "C" fn line_sender_sharded_rewind_row(sharded: *mut line_sender_sharded) {
+    unwrap_sharded_mut(sharded).rewind_row();
 }
 
-/// Release the `line_sender_opts` object.
+/// The number of rows pending across all the shards.
+/// @param[in] sharded Sharded sender object.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_opts_free(opts: *mut line_sender_opts) {
-    if !opts.is_null() {
-        drop(Box::from_raw(opts));
-    }
+pub unsafe extern "C" fn line_sender_sharded_row_count(
+    sharded: *const line_sender_sharded,
+) -> size_t {
+    unwrap_sharded(sharded).row_count()
 }
 
-/// Inserts data into QuestDB via the InfluxDB Line Protocol.
-///
-/// Batch up rows in a `line_sender_buffer`, then call `line_sender_flush()` or
-/// one of its variants with this object to send them.
-pub struct line_sender(Sender);
+/// Take a snapshot of the given shard's flush counters.
+/// See `line_sender_get_stats`. `shard` must be less than the shard count.
+/// @param[in] sharded Sharded sender object.
+/// @param[in] shard Index of the shard.
+/// @param[out] stats_out The snapshot.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_sharded_shard_stats(
+    sharded: *const line_sender_sharded,
+    shard: size_t,
+    stats_out: *mut line_sender_stats,
+) {
+    *stats_out = c_stats(unwrap_sharded(sharded).stats(shard));
+}
 
-/// Create a new line sender instance from the given options object.
-///
-/// In the case of TCP, this synchronously establishes the TCP connection, and
-/// returns once the connection is fully established. If the connection
-/// requires authentication or TLS, these will also be completed before
-/// returning.
+/// Send the pending rows of every shard, flushing the shards in parallel.
 ///
-/// The sender should be accessed by only a single thread a time.
+/// Shards that flushed are cleared, whilst shards that failed keep their rows
+/// to retry with the next call. On error, reports the error of the
+/// lowest-numbered shard that failed.
 ///
-/// @param[in] opts Options for the connection.
+/// @param[in] sharded Sharded sender object.
+/// @return true on success, false on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_build(
-    opts: *const line_sender_opts,
+pub unsafe extern "C" fn line_sender_sharded_flush(
+    sharded: *mut line_sender_sharded,
     err_out: *mut *mut line_sender_error,
-) -> *mut line_sender {
-    let builder = &(*opts).0;
-    let sender = bubble_err_to_c!(err_out, builder.build(), ptr::null_mut());
-    Box::into_raw(Box::new(line_sender(sender)))
+) -> bool {
+    bubble_err_to_c!(err_out, unwrap_sharded_mut(sharded).flush());
+    true
 }
 
-/// Create a new line sender instance from the given configuration string.
-/// The format of the string is: "tcp::addr=host:port;key=value;...;"
-/// Instead of "tcp" you can also specify "tcps", "http", and "https".
-///
-/// The accepted keys match one-for-one with the functions on `line_sender_opts`.
-/// For example, this is a valid configuration string:
-///
-/// "https::addr=host:port;username=alice;password=secret;"
-///
-/// and there are matching functions `line_sender_opts_username()` and
-/// `line_sender_opts_password()`. The value for `addr=` is supplied directly to
-/// `line_sender_opts_new`, so there's no function with a matching name.
-///
-/// For the full list of keys, search this header for `bool line_sender_opts_`.
-///
-/// In the case of TCP, this synchronously establishes the TCP connection, and
-/// returns once the connection is fully established. If the connection
-/// requires authentication or TLS, these will also be completed before
-/// returning.
-///
-/// The sender should be accessed by only a single thread a time.
+/// Close the connections of all the shards. Does not flush.
+/// @param[in] sharded Sharded sender object.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_from_conf(
-    config: line_sender_utf8,
-    err_out: *mut *mut line_sender_error,
-) -> *mut line_sender {
-    let config = config.as_str();
-    let builder = bubble_err_to_c!(err_out, SenderBuilder::from_conf(config), ptr::null_mut());
-    let builder = builder
-        .user_agent(concat!("questdb/c/", env!("CARGO_PKG_VERSION")))
-        .expect("user_agent set");
-    let sender = bubble_err_to_c!(err_out, builder.build(), ptr::null_mut());
-    Box::into_raw(Box::new(line_sender(sender)))
+pub unsafe extern "C" fn line_sender_sharded_close(sharded: *mut line_sender_sharded) {
+    if !sharded.is_null() {
+        drop(Box::from_raw(sharded));
+    }
 }
 
-/// Create a new `line_sender` instance from the configuration stored in the
-/// `QDB_CLIENT_CONF` environment variable.
-///
-/// In the case of TCP, this synchronously establishes the TCP connection, and
-/// returns once the connection is fully established. If the connection
-/// requires authentication or TLS, these will also be completed before
-/// returning.
-///
-/// The sender should be accessed by only a single thread a time.
+/// A shared free list of buffers.
+/// See `line_sender_buffer_pool_new`.
+pub struct line_sender_buffer_pool(Arc<BufferPool>);
+
+/// Create an empty pool that keeps up to `max_idle` buffers of at most
+/// `max_capacity` bytes each.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_from_env(
-    err_out: *mut *mut line_sender_error,
-) -> *mut line_sender {
-    let builder = bubble_err_to_c!(err_out, SenderBuilder::from_env(), ptr::null_mut());
-    let builder = builder
-        .user_agent(concat!("questdb/c/", env!("CARGO_PKG_VERSION")))
-        .expect("user_agent set");
-    let sender = bubble_err_to_c!(err_out, builder.build(), ptr::null_mut());
-    Box::into_raw(Box::new(line_sender(sender)))
+pub unsafe extern "C" fn line_sender_buffer_pool_new(
+    max_capacity: size_t,
+    max_idle: size_t,
+) -> *mut line_sender_buffer_pool {
+    let pool = BufferPool::new(max_capacity, max_idle);
+    Box::into_raw(Box::new(line_sender_buffer_pool(Arc::new(pool))))
 }
 
-unsafe fn unwrap_sender<'a>(sender: *const line_sender) -> &'a Sender {
-    &(*sender).0
+/// Create an empty pool as per `line_sender_buffer_pool_new`, whose buffers
+/// are encoded with the given protocol version and timestamp precision.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_pool_new_with_encoding(
+    max_capacity: size_t,
+    max_idle: size_t,
+    protocol_version: line_sender_protocol_version,
+    precision: line_sender_timestamp_precision,
+) -> *mut line_sender_buffer_pool {
+    let pool = BufferPool::new(max_capacity, max_idle)
+        .with_protocol_version(protocol_version.into())
+        .with_timestamp_precision(precision.into());
+    Box::into_raw(Box::new(line_sender_buffer_pool(Arc::new(pool))))
 }
 
-unsafe fn unwrap_sender_mut<'a>(sender: *mut line_sender) -> &'a mut Sender {
-    &mut (*sender).0
+/// Take an empty buffer from the pool, or create one if the pool is empty.
+/// @param[in] pool Buffer pool object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_pool_acquire(
+    pool: *const line_sender_buffer_pool,
+) -> *mut line_sender_buffer {
+    let buffer = (*pool).0.acquire();
+    Box::into_raw(Box::new(line_sender_buffer(buffer)))
 }
 
-/// Tell whether the sender is no longer usable and must be closed.
-/// This happens when there was an earlier failure.
-/// This fuction is specific to TCP and is not relevant for HTTP.
-/// @param[in] sender Line sender object.
-/// @return true if an error occurred with a sender and it must be closed.
+/// Return a buffer to the pool, discarding its contents.
+/// This takes ownership of the buffer. Passing NULL is a no-op.
+/// @param[in] pool Buffer pool object.
+/// @param[in] buffer Line buffer object.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_must_close(sender: *const line_sender) -> bool {
-    unwrap_sender(sender).must_close()
+pub unsafe extern "C" fn line_sender_buffer_pool_release(
+    pool: *const line_sender_buffer_pool,
+    buffer: *mut line_sender_buffer,
+) {
+    if !buffer.is_null() {
+        let buffer = Box::from_raw(buffer).0;
+        (*pool).0.release(buffer);
+    }
 }
 
-/// Close the connection. Does not flush. Non-idempotent.
-/// @param[in] sender Line sender object.
+/// The number of buffers currently waiting in the pool.
+/// @param[in] pool Buffer pool object.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_close(sender: *mut line_sender) {
-    if !sender.is_null() {
-        drop(Box::from_raw(sender));
+pub unsafe extern "C" fn line_sender_buffer_pool_idle(
+    pool: *const line_sender_buffer_pool,
+) -> size_t {
+    (*pool).0.idle()
+}
+
+/// Release the caller's reference to the pool.
+/// @param[in] pool Buffer pool object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_buffer_pool_free(pool: *mut line_sender_buffer_pool) {
+    if !pool.is_null() {
+        drop(Box::from_raw(pool));
     }
 }
 
-/// Send the given buffer of rows to the QuestDB server, clearing the buffer.
-///
-/// After this function returns, the buffer is empty and ready for the next batch.
-/// If you want to preserve the buffer contents, call `line_sender_flush_and_keep`.
-/// If you want to ensure the flush is transactional, call
-/// `line_sender_flush_and_keep_with_flags`.
-///
-/// With ILP-over-HTTP, this function sends an HTTP request and waits for the
-/// response. If the server responds with an error, it returns a descriptive error.
-/// In the case of a network error, it retries until it has exhausted the retry time
-/// budget.
-///
-/// With ILP-over-TCP, the function blocks only until the buffer is flushed to the
-/// underlying OS-level network socket, without waiting to actually send it to the
-/// server. In the case of an error, the server will quietly disconnect: consult the
-/// server logs for error messages.
-///
-/// HTTP should be the first choice, but use TCP if you need to continuously send
-/// data to the server at a high rate.
+/// Like `line_sender_into_background`, but the ring's buffers are drawn from
+/// `pool`, shrunk back to its `max_capacity` after each flush, and returned to
+/// it once the background sender is closed.
 ///
-/// To improve the HTTP performance, send larger buffers (with more rows), and
-/// consider parallelizing writes using multiple senders from multiple threads.
+/// This function takes ownership of the sender in all cases.
 ///
 /// @param[in] sender Line sender object.
-/// @param[in] buffer Line buffer object.
-/// @return true on success, false on error.
+/// @param[in] ring_size Number of buffers that may be in flight at any one time.
+/// @param[in] pool Buffer pool object.
+/// @return The background sender, or NULL on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_flush(
+pub unsafe extern "C" fn line_sender_into_background_with_pool(
     sender: *mut line_sender,
-    buffer: *mut line_sender_buffer,
+    ring_size: size_t,
+    pool: *const line_sender_buffer_pool,
     err_out: *mut *mut line_sender_error,
-) -> bool {
-    let sender = unwrap_sender_mut(sender);
-    let buffer = unwrap_buffer_mut(buffer);
-    bubble_err_to_c!(err_out, sender.flush(buffer));
-    true
+) -> *mut line_sender_background {
+    let sender = Box::from_raw(sender).0;
+    let buffers = Arc::clone(&(*pool).0);
+    let background = bubble_err_to_c!(
+        err_out,
+        sender.into_background_with_pool(ring_size, buffers),
+        ptr::null_mut()
+    );
+    Box::into_raw(Box::new(line_sender_background(background)))
 }
 
-/// Send the given buffer of rows to the QuestDB server.
+/// Share a buffer pool with the threads using a sender pool.
+/// Call this before sharing the sender pool between threads.
+/// @param[in] pool Sender pool object.
+/// @param[in] buffers Buffer pool object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_pool_set_buffer_pool(
+    pool: *mut line_sender_pool,
+    buffers: *const line_sender_buffer_pool,
+) {
+    (*pool).0.set_buffer_pool(Arc::clone(&(*buffers).0));
+}
+
+/// Gathers the rows committed by many threads into large requests over a
+/// single connection.
+/// See `line_sender_into_concurrent`.
+pub struct line_sender_concurrent(ConcurrentSender);
+
+/// Move the sender to a flusher thread that many threads can commit buffers
+/// to at once. The flusher gathers the buffers committed whilst the previous
+/// request was in flight into the next one.
 ///
-/// All the data stays in the buffer. Clear the buffer before starting a new batch.
+/// This function takes ownership of the sender in all cases: Don't use or close
+/// the `sender` after this call, even on error.
 ///
-/// To send and clear in one step, call `line_sender_flush` instead. Also, see the docs
-/// on that function for more important details on flushing.
 /// @param[in] sender Line sender object.
-/// @param[in] buffer Line buffer object.
-/// @return true on success, false on error.
+/// @param[in] queue_depth Number of committed buffers that may wait for the
+///                        flusher before `line_sender_concurrent_commit`
+///                        blocks.
+/// @return The concurrent sender, or NULL on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_flush_and_keep(
+pub unsafe extern "C" fn line_sender_into_concurrent(
     sender: *mut line_sender,
-    buffer: *const line_sender_buffer,
+    queue_depth: size_t,
     err_out: *mut *mut line_sender_error,
-) -> bool {
-    let sender = unwrap_sender_mut(sender);
-    let buffer = unwrap_buffer(buffer);
-    bubble_err_to_c!(err_out, sender.flush_and_keep(buffer));
-    true
+) -> *mut line_sender_concurrent {
+    let sender = Box::from_raw(sender).0;
+    let concurrent = bubble_err_to_c!(
+        err_out,
+        sender.into_concurrent(queue_depth),
+        ptr::null_mut()
+    );
+    Box::into_raw(Box::new(line_sender_concurrent(concurrent)))
 }
 
-/// Send the batch of rows in the buffer to the QuestDB server, and, if the parameter
-/// `transactional` is true, ensure the flush will be transactional.
-///
-/// A flush is transactional iff all the rows belong to the same table. This allows
-/// QuestDB to treat the flush as a single database transaction, because it doesn't
-/// support transactions spanning multiple tables. Additionally, only ILP-over-HTTP
-/// supports transactional flushes.
-///
-/// If the flush wouldn't be transactional, this function returns an error and
-/// doesn't flush any data.
+/// Like `line_sender_into_concurrent`, but the replacement buffers are drawn
+/// from `pool`, and committed buffers are returned to it once sent.
 ///
-/// The function sends an HTTP request and waits for the response. If the server
-/// responds with an error, it returns a descriptive error. In the case of a network
-/// error, it retries until it has exhausted the retry time budget.
+/// This function takes ownership of the sender in all cases.
 ///
-/// All the data stays in the buffer. Clear the buffer before starting a new batch.
+/// @param[in] sender Line sender object.
+/// @param[in] queue_depth Number of committed buffers that may wait for the
+///                        flusher.
+/// @param[in] pool Buffer pool object.
+/// @return The concurrent sender, or NULL on error.
 #[no_mangle]
-pub unsafe extern "C" fn line_sender_flush_and_keep_with_flags(
+pub unsafe extern "C" fn line_sender_into_concurrent_with_pool(
     sender: *mut line_sender,
-    buffer: *const line_sender_buffer,
-    transactional: bool,
+    queue_depth: size_t,
+    pool: *const line_sender_buffer_pool,
     err_out: *mut *mut line_sender_error,
-) -> bool {
-    let sender = unwrap_sender_mut(sender);
-    let buffer = unwrap_buffer(buffer);
-    bubble_err_to_c!(
+) -> *mut line_sender_concurrent {
+    let sender = Box::from_raw(sender).0;
+    let buffers = Arc::clone(&(*pool).0);
+    let concurrent = bubble_err_to_c!(
         err_out,
-        sender.flush_and_keep_with_flags(buffer, transactional)
+        sender.into_concurrent_with_pool(queue_depth, buffers),
+        ptr::null_mut()
     );
-    true
+    Box::into_raw(Box::new(line_sender_concurrent(concurrent)))
+}
+
+/// Hand the buffer's rows over to the flusher thread, to be sent with the
+/// rows committed by other threads, and replace them with an empty buffer.
+///
+/// May be called from many threads at once, each with a buffer of its own.
+///
+/// @param[in] concurrent Concurrent sender object.
+/// @param[in] buffer Line buffer object. Empty on return.
+/// @return A flush handle to be passed to `line_sender_flush_handle_wait`, or
+///         NULL on error.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_concurrent_commit(
+    concurrent: *const line_sender_concurrent,
+    buffer: *mut line_sender_buffer,
+    err_out: *mut *mut line_sender_error,
+) -> *mut line_sender_flush_handle {
+    let concurrent = &(*concurrent).0;
+    let buffer = unwrap_buffer_mut(buffer);
+    let handle = bubble_err_to_c!(err_out, concurrent.commit(buffer), ptr::null_mut());
+    Box::into_raw(Box::new(line_sender_flush_handle(handle)))
+}
+
+/// Send all the buffers committed so far, then stop the flusher thread and
+/// close the connection.
+/// @param[in] concurrent Concurrent sender object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_concurrent_close(concurrent: *mut line_sender_concurrent) {
+    if !concurrent.is_null() {
+        drop(Box::from_raw(concurrent));
+    }
 }
 
 /// Get the current time in nanoseconds since the Unix epoch (UTC).
@@ -1408,6 +3986,69 @@ pub unsafe extern "C" fn line_sender_now_micros() -> i64 {
     TimestampMicros::now().as_i64()
 }
 
+/// A source of designated timestamps cheaper to read than
+/// `line_sender_now_nanos()`. May be shared between threads.
+pub struct line_sender_clock(FastClock);
+
+/// Create a clock reading from the given source. It isn't strictly
+/// increasing, and resyncs every second if calibrated.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_clock_new(
+    source: line_sender_clock_source,
+) -> *mut line_sender_clock {
+    Box::into_raw(Box::new(line_sender_clock(FastClock::new(source.into()))))
+}
+
+/// Make each timestamp at least one nanosecond later than the previous one.
+/// Not thread-safe: Call before sharing the clock.
+/// @param[in] clock Clock object.
+/// @param[in] enabled Whether the timestamps are strictly increasing.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_clock_set_strictly_increasing(
+    clock: *mut line_sender_clock,
+    enabled: bool,
+) {
+    (*clock).0.set_strictly_increasing(enabled);
+}
+
+/// How often a `line_sender_clock_source_calibrated` clock resyncs with the
+/// wall clock. Not thread-safe: Call before sharing the clock.
+/// @param[in] clock Clock object.
+/// @param[in] interval_millis The interval, in milliseconds.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_clock_set_resync_interval(
+    clock: *mut line_sender_clock,
+    interval_millis: u64,
+) {
+    (*clock)
+        .0
+        .set_resync_interval(std::time::Duration::from_millis(interval_millis));
+}
+
+/// Capture a new timestamp for a `line_sender_clock_source_batch` clock, or
+/// resync a `line_sender_clock_source_calibrated` one right away.
+/// @param[in] clock Clock object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_clock_tick(clock: *const line_sender_clock) {
+    (*clock).0.tick();
+}
+
+/// Get the clock's current time in nanoseconds since the Unix epoch (UTC).
+/// @param[in] clock Clock object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_clock_now_nanos(clock: *const line_sender_clock) -> i64 {
+    (*clock).0.now().as_i64()
+}
+
+/// Release the clock object.
+/// @param[in] clock Clock object.
+#[no_mangle]
+pub unsafe extern "C" fn line_sender_clock_free(clock: *mut line_sender_clock) {
+    if !clock.is_null() {
+        drop(Box::from_raw(clock));
+    }
+}
+
 #[cfg(feature = "confstr-ffi")]
 use questdb_confstr_ffi::questdb_conf_str_parse_err;
 
@@ -0,0 +1,217 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+//! Serialization cost of typical row shapes into a `Buffer`.
+//!
+//! Run with `cargo bench --bench buffer`. Criterion reports the throughput in
+//! rows per second.
+
+use criterion::{black_box, criterion_group, criterion_main, Criterion, Throughput};
+use questdb::ingress::{Buffer, ColumnName, TableName, TimestampMicros, TimestampNanos};
+
+const ROWS: usize = 1000;
+
+fn narrow_numeric(buffer: &mut Buffer, row: usize) {
+    let value = row as f64;
+    buffer
+        .table("cpu")
+        .unwrap()
+        .symbol("host", "host-01")
+        .unwrap()
+        .column_f64("usage_user", value * 0.25)
+        .unwrap()
+        .column_f64("usage_system", value * 0.5)
+        .unwrap()
+        .column_i64("cores", row as i64)
+        .unwrap()
+        .at(TimestampNanos::new(1_700_000_000_000_000_000 + row as i64))
+        .unwrap();
+}
+
+fn wide_mixed(buffer: &mut Buffer, row: usize) {
+    let value = row as f64;
+    buffer
+        .table("trades")
+        .unwrap()
+        .symbol("exchange", "NYSE")
+        .unwrap()
+        .symbol("symbol", "ETH-USD")
+        .unwrap()
+        .symbol("side", if row % 2 == 0 { "buy" } else { "sell" })
+        .unwrap()
+        .symbol("venue", "primary")
+        .unwrap()
+        .column_f64("price", 2615.54 + value)
+        .unwrap()
+        .column_f64("amount", 0.00044 * value)
+        .unwrap()
+        .column_i64("trade_id", row as i64)
+        .unwrap()
+        .column_i64("order_id", -(row as i64))
+        .unwrap()
+        .column_bool("is_maker", row % 3 == 0)
+        .unwrap()
+        .column_str("client", "client-42")
+        .unwrap()
+        .column_ts("exchange_ts", TimestampMicros::new(1_700_000_000_000_000))
+        .unwrap()
+        .column_f64("fee", 0.001)
+        .unwrap()
+        .at(TimestampNanos::new(1_700_000_000_000_000_000 + row as i64))
+        .unwrap();
+}
+
+fn string_heavy(buffer: &mut Buffer, row: usize, message: &str) {
+    buffer
+        .table("logs")
+        .unwrap()
+        .symbol("level", "INFO")
+        .unwrap()
+        .column_str("message", message)
+        .unwrap()
+        .column_str("logger", "com.example.service.RequestHandler")
+        .unwrap()
+        .column_str("thread", "worker-7")
+        .unwrap()
+        .at(TimestampNanos::new(1_700_000_000_000_000_000 + row as i64))
+        .unwrap();
+}
+
+fn bench_row_shapes(c: &mut Criterion) {
+    let message = "GET /api/v1/orders?id=42 completed in 12ms, \"status\": 200\n".repeat(4);
+    let mut group = c.benchmark_group("row_shapes");
+    group.throughput(Throughput::Elements(ROWS as u64));
+    let mut buffer = Buffer::new();
+    group.bench_function("narrow_numeric", |b| {
+        b.iter(|| {
+            buffer.clear();
+            for row in 0..ROWS {
+                narrow_numeric(&mut buffer, black_box(row));
+            }
+        })
+    });
+    group.bench_function("wide_mixed", |b| {
+        b.iter(|| {
+            buffer.clear();
+            for row in 0..ROWS {
+                wide_mixed(&mut buffer, black_box(row));
+            }
+        })
+    });
+    group.bench_function("string_heavy", |b| {
+        b.iter(|| {
+            buffer.clear();
+            for row in 0..ROWS {
+                string_heavy(&mut buffer, black_box(row), &message);
+            }
+        })
+    });
+    group.finish();
+}
+
+fn bench_columns(c: &mut Criterion) {
+    let table = TableName::new("t").unwrap();
+    let col = ColumnName::new("c").unwrap();
+    let mut group = c.benchmark_group("columns");
+    group.throughput(Throughput::Elements(ROWS as u64));
+    let mut buffer = Buffer::new();
+    group.bench_function("column_f64", |b| {
+        b.iter(|| {
+            buffer.clear();
+            for row in 0..ROWS {
+                let value = black_box(row as f64 * 1.0001);
+                buffer.table(table).unwrap();
+                buffer.column_f64(col, value).unwrap();
+                buffer.at_now().unwrap();
+            }
+        })
+    });
+    group.bench_function("column_i64", |b| {
+        b.iter(|| {
+            buffer.clear();
+            for row in 0..ROWS {
+                let value = black_box(row as i64 * 1_000_003);
+                buffer.table(table).unwrap();
+                buffer.column_i64(col, value).unwrap();
+                buffer.at_now().unwrap();
+            }
+        })
+    });
+    group.bench_function("column_long256", |b| {
+        let mut value = [0u8; 32];
+        b.iter(|| {
+            buffer.clear();
+            for row in 0..ROWS {
+                value[31] = row as u8;
+                buffer.table(table).unwrap();
+                buffer.column_long256(col, black_box(value)).unwrap();
+                buffer.at_now().unwrap();
+            }
+        })
+    });
+    group.finish();
+}
+
+/// The `wide_mixed` shape with pre-validated names, in a checked and in a
+/// trusted buffer, to measure what skipping the per-call checks saves.
+fn bench_trusted(c: &mut Criterion) {
+    let table = TableName::new("trades").unwrap();
+    let names: Vec<ColumnName> = ["exchange", "symbol", "price", "amount", "trade_id", "fee"]
+        .into_iter()
+        .map(|name| ColumnName::new(name).unwrap())
+        .collect();
+    let fill = |buffer: &mut Buffer| {
+        buffer.clear();
+        for row in 0..ROWS {
+            let value = black_box(row as f64);
+            buffer
+                .table(table)
+                .unwrap()
+                .symbol(names[0], "NYSE")
+                .unwrap()
+                .symbol(names[1], "ETH-USD")
+                .unwrap()
+                .column_f64(names[2], 2615.54 + value)
+                .unwrap()
+                .column_f64(names[3], 0.00044 * value)
+                .unwrap()
+                .column_i64(names[4], row as i64)
+                .unwrap()
+                .column_f64(names[5], 0.001)
+                .unwrap()
+                .at(TimestampNanos::new(1_700_000_000_000_000_000 + row as i64))
+                .unwrap();
+        }
+    };
+    let mut group = c.benchmark_group("trusted");
+    group.throughput(Throughput::Elements(ROWS as u64));
+    let mut checked = Buffer::new();
+    group.bench_function("checked", |b| b.iter(|| fill(&mut checked)));
+    let mut trusted = Buffer::new_trusted();
+    group.bench_function("trusted", |b| b.iter(|| fill(&mut trusted)));
+    group.finish();
+}
+
+criterion_group!(benches, bench_row_shapes, bench_columns, bench_trusted);
+criterion_main!(benches);
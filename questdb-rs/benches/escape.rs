@@ -0,0 +1,94 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+//! Throughput of escaping string and symbol values.
+//!
+//! Run with `cargo bench --bench escape`. Criterion reports the throughput in
+//! bytes of input per second.
+
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use questdb::ingress::{Buffer, ColumnName, TableName};
+
+const SIZES: [usize; 3] = [64, 1024, 8192];
+
+/// A log-like line with no bytes to escape.
+fn clean(len: usize) -> String {
+    "GET /api/v1/query?id=42 HTTP/1.1 200 "
+        .chars()
+        .filter(|c| !matches!(c, ' ' | '=' | ','))
+        .cycle()
+        .take(len)
+        .collect()
+}
+
+/// A log-like line with an escapable byte roughly every 8 bytes.
+fn dirty(len: usize) -> String {
+    "GET /api?a=1,b=\"x\" 200\\n"
+        .chars()
+        .cycle()
+        .take(len)
+        .collect()
+}
+
+fn bench_escape(c: &mut Criterion) {
+    let table = TableName::new("logs").unwrap();
+    let col = ColumnName::new("line").unwrap();
+    for (shape, make) in [("clean", clean as fn(usize) -> String), ("dirty", dirty)] {
+        let mut group = c.benchmark_group(format!("escape_{shape}"));
+        for size in SIZES {
+            let value = make(size);
+            group.throughput(Throughput::Bytes(size as u64));
+            group.bench_with_input(BenchmarkId::new("column_str", size), &value, |b, value| {
+                let mut buffer = Buffer::new();
+                b.iter(|| {
+                    buffer.clear();
+                    buffer
+                        .table(table)
+                        .unwrap()
+                        .column_str(col, black_box(value))
+                        .unwrap()
+                        .at_now()
+                        .unwrap();
+                })
+            });
+            group.bench_with_input(BenchmarkId::new("symbol", size), &value, |b, value| {
+                let mut buffer = Buffer::new();
+                b.iter(|| {
+                    buffer.clear();
+                    buffer
+                        .table(table)
+                        .unwrap()
+                        .symbol(col, black_box(value))
+                        .unwrap()
+                        .at_now()
+                        .unwrap();
+                })
+            });
+        }
+        group.finish();
+    }
+}
+
+criterion_group!(benches, bench_escape);
+criterion_main!(benches);
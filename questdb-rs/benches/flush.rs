@@ -0,0 +1,87 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+//! Cost of flushing a batch of rows over TCP to a loopback mock server.
+//!
+//! Run with `cargo bench --bench flush`. Each iteration also includes the
+//! mock server reading the batch back, so the figures are an upper bound for
+//! the client side.
+
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use questdb::ingress::{Buffer, TimestampNanos};
+
+// Make `crate::ingress` resolve for the mock server shared with the tests.
+mod ingress {
+    pub use questdb::ingress::*;
+}
+
+#[allow(dead_code)]
+#[path = "../src/tests/mock.rs"]
+mod mock;
+
+use mock::MockServer;
+
+fn fill(buffer: &mut Buffer, rows: usize) {
+    buffer.clear();
+    for row in 0..rows {
+        buffer
+            .table("trades")
+            .unwrap()
+            .symbol("symbol", "ETH-USD")
+            .unwrap()
+            .column_f64("price", 2615.54 + row as f64)
+            .unwrap()
+            .column_i64("amount", row as i64)
+            .unwrap()
+            .at(TimestampNanos::new(1_700_000_000_000_000_000 + row as i64))
+            .unwrap();
+    }
+}
+
+fn bench_flush_tcp(c: &mut Criterion) {
+    let mut server = MockServer::new().unwrap();
+    let mut sender = server.lsb_tcp().build().unwrap();
+    server.accept().unwrap();
+
+    let mut group = c.benchmark_group("flush_tcp");
+    for rows in [100, 1000] {
+        let mut buffer = Buffer::new();
+        fill(&mut buffer, rows);
+        group.throughput(Throughput::Bytes(buffer.len() as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(rows), &rows, |b, &rows| {
+            b.iter(|| {
+                sender.flush_and_keep(&buffer).unwrap();
+                let mut received = 0;
+                while received < rows {
+                    received += server.recv(5.0).unwrap();
+                }
+                server.msgs.clear();
+            })
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_flush_tcp);
+criterion_main!(benches);
@@ -0,0 +1,465 @@
+//! A synthetic ILP load generator.
+//!
+//! Sends rows of a configurable schema from one or more threads, each with
+//! its own `Sender`, and reports the combined throughput and flush latencies
+//! every second. Run `cargo run --release --example ilp_bench -- --help` for
+//! the options.
+//!
+//! With `--sink tcp` or `--sink http`, the rows go to a server built into the
+//! benchmark that discards them. This measures the client-side cost alone.
+
+use std::error::Error;
+use std::io::{self, BufRead, BufReader, Read, Write};
+use std::net::{TcpListener, TcpStream};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use questdb::ingress::{
+    Buffer, LatencyHistogram, PreparedColumnName, Sender, SenderStats, TimestampMicros,
+    TimestampNanos,
+};
+
+const USAGE: &str = "\
+Usage: ilp_bench [OPTIONS]
+
+Connection (one of):
+  --conf CONF               Sender configuration string.
+  --sink tcp|http           Send to a built-in server that discards the data.
+
+Schema:
+  --table NAME              Table name [default: ilp_bench]
+  --symbols N               Symbol columns [default: 2]
+  --symbol-cardinality N    Distinct values per symbol column [default: 100]
+  --i64 N                   Integer columns [default: 2]
+  --f64 N                   Float columns [default: 2]
+  --bools N                 Boolean columns [default: 0]
+  --strings N               String columns [default: 0]
+  --string-len N            Length of string values [default: 16]
+  --timestamps N            Timestamp columns [default: 0]
+
+Load:
+  --threads N               Senders, one per thread [default: 1]
+  --rate ROWS               Target rows/s across all threads, 0 for no limit
+                            [default: 0]
+  --batch ROWS              Rows per flush [default: 1000]
+  --duration SECS           How long to run for [default: 10]
+  --report-interval SECS    Seconds between reports [default: 1]
+";
+
+struct Options {
+    conf: Option<String>,
+    sink: Option<String>,
+    table: String,
+    symbols: usize,
+    symbol_cardinality: usize,
+    i64s: usize,
+    f64s: usize,
+    bools: usize,
+    strings: usize,
+    string_len: usize,
+    timestamps: usize,
+    threads: usize,
+    rate: f64,
+    batch: usize,
+    duration: Duration,
+    report_interval: Duration,
+}
+
+impl Options {
+    fn parse() -> Result<Self, Box<dyn Error>> {
+        let mut options = Self {
+            conf: None,
+            sink: None,
+            table: "ilp_bench".to_string(),
+            symbols: 2,
+            symbol_cardinality: 100,
+            i64s: 2,
+            f64s: 2,
+            bools: 0,
+            strings: 0,
+            string_len: 16,
+            timestamps: 0,
+            threads: 1,
+            rate: 0.0,
+            batch: 1000,
+            duration: Duration::from_secs(10),
+            report_interval: Duration::from_secs(1),
+        };
+        let mut args = std::env::args().skip(1);
+        while let Some(arg) = args.next() {
+            if arg == "--help" || arg == "-h" {
+                print!("{}", USAGE);
+                std::process::exit(0);
+            }
+            let value = args
+                .next()
+                .ok_or_else(|| format!("Missing value for {}", arg))?;
+            let secs = |value: &str| -> Result<Duration, Box<dyn Error>> {
+                Ok(Duration::from_secs_f64(value.parse()?))
+            };
+            match arg.as_str() {
+                "--conf" => options.conf = Some(value),
+                "--sink" => options.sink = Some(value),
+                "--table" => options.table = value,
+                "--symbols" => options.symbols = value.parse()?,
+                "--symbol-cardinality" => options.symbol_cardinality = value.parse()?,
+                "--i64" => options.i64s = value.parse()?,
+                "--f64" => options.f64s = value.parse()?,
+                "--bools" => options.bools = value.parse()?,
+                "--strings" => options.strings = value.parse()?,
+                "--string-len" => options.string_len = value.parse()?,
+                "--timestamps" => options.timestamps = value.parse()?,
+                "--threads" => options.threads = value.parse()?,
+                "--rate" => options.rate = value.parse()?,
+                "--batch" => options.batch = value.parse()?,
+                "--duration" => options.duration = secs(&value)?,
+                "--report-interval" => options.report_interval = secs(&value)?,
+                _ => return Err(format!("Unknown option {}\n\n{}", arg, USAGE).into()),
+            }
+        }
+        if options.conf.is_some() == options.sink.is_some() {
+            return Err(format!("Pass exactly one of --conf or --sink.\n\n{}", USAGE).into());
+        }
+        if options.threads == 0 || options.batch == 0 || options.symbol_cardinality == 0 {
+            return Err("--threads, --batch and --symbol-cardinality must be > 0.".into());
+        }
+        let columns = options.symbols
+            + options.i64s
+            + options.f64s
+            + options.bools
+            + options.strings
+            + options.timestamps;
+        if columns == 0 {
+            return Err("The schema must have at least one column.".into());
+        }
+        Ok(options)
+    }
+}
+
+/// A small xorshift generator: Good enough to vary the values, and cheap
+/// enough not to show up in the measurements.
+struct Rng(u64);
+
+impl Rng {
+    fn next(&mut self) -> u64 {
+        self.0 ^= self.0 << 13;
+        self.0 ^= self.0 >> 7;
+        self.0 ^= self.0 << 17;
+        self.0
+    }
+
+    fn below(&mut self, bound: usize) -> usize {
+        (self.next() % bound as u64) as usize
+    }
+}
+
+/// The column names and value pools of the generated rows.
+struct Schema {
+    symbols: Vec<PreparedColumnName>,
+    symbol_values: Vec<String>,
+    i64s: Vec<PreparedColumnName>,
+    f64s: Vec<PreparedColumnName>,
+    bools: Vec<PreparedColumnName>,
+    strings: Vec<PreparedColumnName>,
+    string_values: Vec<String>,
+    timestamps: Vec<PreparedColumnName>,
+}
+
+impl Schema {
+    fn new(options: &Options) -> questdb::Result<Self> {
+        let names = |prefix: &str, count: usize| {
+            (0..count)
+                .map(|index| PreparedColumnName::new(format!("{}{}", prefix, index).as_str()))
+                .collect::<questdb::Result<Vec<_>>>()
+        };
+        let mut rng = Rng(0x9e37_79b9_7f4a_7c15);
+        let string_values: Vec<String> = (0..64)
+            .map(|_| {
+                (0..options.string_len)
+                    .map(|_| (b'a' + rng.below(26) as u8) as char)
+                    .collect()
+            })
+            .collect();
+        Ok(Self {
+            symbols: names("sym", options.symbols)?,
+            symbol_values: (0..options.symbol_cardinality)
+                .map(|index| format!("value{}", index))
+                .collect(),
+            i64s: names("i", options.i64s)?,
+            f64s: names("f", options.f64s)?,
+            bools: names("b", options.bools)?,
+            strings: names("str", options.strings)?,
+            string_values,
+            timestamps: names("ts", options.timestamps)?,
+        })
+    }
+
+    fn append_row(&self, buffer: &mut Buffer, table: &str, rng: &mut Rng) -> questdb::Result<()> {
+        buffer.table(table)?;
+        for name in &self.symbols {
+            let value = &self.symbol_values[rng.below(self.symbol_values.len())];
+            buffer.symbol(name, value)?;
+        }
+        for name in &self.i64s {
+            buffer.column_i64(name, rng.next() as i64 >> 16)?;
+        }
+        for name in &self.f64s {
+            buffer.column_f64(name, (rng.next() >> 11) as f64 / (1u64 << 40) as f64)?;
+        }
+        for name in &self.bools {
+            buffer.column_bool(name, rng.next() & 1 == 1)?;
+        }
+        for name in &self.strings {
+            let value = &self.string_values[rng.below(self.string_values.len())];
+            buffer.column_str(name, value)?;
+        }
+        let now = TimestampNanos::now();
+        for name in &self.timestamps {
+            buffer.column_ts(name, TimestampMicros::new(now.as_i64() / 1000))?;
+        }
+        buffer.at(now)
+    }
+}
+
+/// The latest stats of each sender, published after every flush.
+type StatsSlots = Arc<Vec<Mutex<Option<SenderStats>>>>;
+
+fn run_sender(
+    conf: &str,
+    options: &Options,
+    schema: &Schema,
+    index: usize,
+    stats: &StatsSlots,
+    stop: &AtomicBool,
+) -> questdb::Result<()> {
+    let mut sender = Sender::from_conf(conf)?;
+    let mut buffer = sender.new_buffer();
+    let mut rng = Rng(0x2545_f491_4f6c_dd1d ^ (index as u64 + 1));
+    let thread_rate = options.rate / options.threads as f64;
+    let start = Instant::now();
+    let mut rows_sent: u64 = 0;
+    while !stop.load(Ordering::Relaxed) {
+        for _ in 0..options.batch {
+            schema.append_row(&mut buffer, &options.table, &mut rng)?;
+        }
+        sender.flush(&mut buffer)?;
+        rows_sent += options.batch as u64;
+        *stats[index].lock().unwrap() = Some(sender.stats());
+
+        if thread_rate > 0.0 {
+            let due = Duration::from_secs_f64(rows_sent as f64 / thread_rate);
+            if let Some(ahead) = due.checked_sub(start.elapsed()) {
+                thread::sleep(ahead);
+            }
+        }
+    }
+    Ok(())
+}
+
+/// The combined counters of all senders.
+fn combined(stats: &StatsSlots) -> (u64, u64, u64, Option<LatencyHistogram>) {
+    let (mut rows, mut bytes, mut failed) = (0, 0, 0);
+    let mut latency: Option<LatencyHistogram> = None;
+    for slot in stats.iter() {
+        if let Some(stats) = slot.lock().unwrap().as_ref() {
+            rows += stats.rows_sent;
+            bytes += stats.bytes_sent;
+            failed += stats.failed_flushes;
+            match latency.as_mut() {
+                Some(latency) => latency.merge(&stats.flush_latency),
+                None => latency = Some(stats.flush_latency.clone()),
+            }
+        }
+    }
+    (rows, bytes, failed, latency)
+}
+
+fn format_latency(latency: Option<&LatencyHistogram>) -> String {
+    match latency {
+        Some(latency) => format!(
+            "p50 {:>8?}  p99 {:>8?}  p99.9 {:>8?}  max {:>8?}",
+            latency.quantile(0.5),
+            latency.quantile(0.99),
+            latency.quantile(0.999),
+            latency.max()
+        ),
+        None => "no flushes yet".to_string(),
+    }
+}
+
+fn print_histogram(latency: &LatencyHistogram) {
+    println!("Flush latency histogram:");
+    let peak = latency.buckets().map(|(_, count)| count).max().unwrap_or(1);
+    for (upper_bound, count) in latency.buckets() {
+        let bar = "#".repeat(((count * 50).div_ceil(peak)) as usize);
+        println!("  <= {:>10?} {:>10} {}", upper_bound, count, bar);
+    }
+}
+
+/// Serve ILP/TCP, discarding everything received.
+fn discard_tcp(mut stream: TcpStream) -> io::Result<()> {
+    let mut buf = vec![0u8; 1 << 20];
+    while stream.read(&mut buf)? > 0 {}
+    Ok(())
+}
+
+/// Serve ILP/HTTP, discarding the request bodies and replying with
+/// `204 No Content` to every request.
+fn discard_http(stream: TcpStream) -> io::Result<()> {
+    let mut writer = stream.try_clone()?;
+    let mut reader = BufReader::with_capacity(1 << 20, stream);
+    let mut line = String::new();
+    loop {
+        let mut content_length = 0u64;
+        let mut chunked = false;
+        let mut first_line = true;
+        loop {
+            line.clear();
+            if reader.read_line(&mut line)? == 0 {
+                return Ok(());
+            }
+            let header = line.trim_end();
+            if header.is_empty() && !first_line {
+                break;
+            }
+            first_line = false;
+            if let Some((name, value)) = header.split_once(':') {
+                let value = value.trim();
+                if name.eq_ignore_ascii_case("content-length") {
+                    content_length = value.parse().unwrap_or(0);
+                } else if name.eq_ignore_ascii_case("transfer-encoding") {
+                    chunked = value.eq_ignore_ascii_case("chunked");
+                }
+            }
+        }
+        if chunked {
+            loop {
+                line.clear();
+                reader.read_line(&mut line)?;
+                let size_str = line.trim_end().split(';').next().unwrap_or("");
+                let size = u64::from_str_radix(size_str, 16).unwrap_or(0);
+                if size == 0 {
+                    // Skip the trailers up to the blank line.
+                    while reader.read_line(&mut line)? > 2 {
+                        line.clear();
+                    }
+                    break;
+                }
+                io::copy(&mut (&mut reader).take(size + 2), &mut io::sink())?;
+            }
+        } else {
+            io::copy(&mut (&mut reader).take(content_length), &mut io::sink())?;
+        }
+        writer.write_all(b"HTTP/1.1 204 No Content\r\n\r\n")?;
+    }
+}
+
+/// Start a discarding server on a local port, returning its conf string.
+fn start_sink(kind: &str) -> Result<String, Box<dyn Error>> {
+    let handler: fn(TcpStream) -> io::Result<()> = match kind {
+        "tcp" => discard_tcp,
+        "http" => discard_http,
+        _ => return Err(format!("Unknown sink {:?}: Expected tcp or http.", kind).into()),
+    };
+    let listener = TcpListener::bind("127.0.0.1:0")?;
+    let port = listener.local_addr()?.port();
+    thread::Builder::new()
+        .name("questdb-bench-sink".to_string())
+        .spawn(move || {
+            for stream in listener.incoming().flatten() {
+                let _ = stream.set_nodelay(true);
+                thread::spawn(move || handler(stream));
+            }
+        })?;
+    Ok(format!("{}::addr=127.0.0.1:{};", kind, port))
+}
+
+fn main() -> Result<(), Box<dyn Error>> {
+    let options = Arc::new(Options::parse()?);
+    let conf = match (&options.conf, &options.sink) {
+        (Some(conf), _) => conf.clone(),
+        (None, Some(sink)) => {
+            let conf = start_sink(sink)?;
+            eprintln!("Discarding everything sent to {}", conf);
+            conf
+        }
+        (None, None) => unreachable!(),
+    };
+    let schema = Arc::new(Schema::new(&options)?);
+    let stats: StatsSlots = Arc::new((0..options.threads).map(|_| Mutex::new(None)).collect());
+    let stop = Arc::new(AtomicBool::new(false));
+
+    let workers = (0..options.threads)
+        .map(|index| {
+            let (conf, options, schema, stats, stop) = (
+                conf.clone(),
+                options.clone(),
+                schema.clone(),
+                stats.clone(),
+                stop.clone(),
+            );
+            thread::Builder::new()
+                .name(format!("questdb-bench-{}", index))
+                .spawn(move || {
+                    let result = run_sender(&conf, &options, &schema, index, &stats, &stop);
+                    if result.is_err() {
+                        // Don't keep the other senders going on their own.
+                        stop.store(true, Ordering::Relaxed);
+                    }
+                    result
+                })
+        })
+        .collect::<io::Result<Vec<_>>>()?;
+
+    let start = Instant::now();
+    let (mut last_rows, mut last_bytes, mut last_report) = (0, 0, start);
+    while !stop.load(Ordering::Relaxed) && start.elapsed() < options.duration {
+        thread::sleep(
+            options
+                .report_interval
+                .min(options.duration.saturating_sub(start.elapsed())),
+        );
+        let (rows, bytes, failed, latency) = combined(&stats);
+        let secs = last_report.elapsed().as_secs_f64();
+        println!(
+            "[{:>6.1}s] {:>11.0} rows/s {:>8.1} MB/s  {}  failed {}",
+            start.elapsed().as_secs_f64(),
+            (rows - last_rows) as f64 / secs,
+            (bytes - last_bytes) as f64 / secs / 1e6,
+            format_latency(latency.as_ref()),
+            failed
+        );
+        (last_rows, last_bytes, last_report) = (rows, bytes, Instant::now());
+    }
+    stop.store(true, Ordering::Relaxed);
+
+    let mut first_error = None;
+    for worker in workers {
+        if let Err(err) = worker.join().expect("sender thread panicked") {
+            eprintln!("Sender failed: {}", err);
+            first_error.get_or_insert(err);
+        }
+    }
+
+    let elapsed = start.elapsed().as_secs_f64();
+    let (rows, bytes, failed, latency) = combined(&stats);
+    println!(
+        "Sent {} rows ({:.1} MB) in {:.1}s: {:.0} rows/s, {:.1} MB/s, {} failed flushes.",
+        rows,
+        bytes as f64 / 1e6,
+        elapsed,
+        rows as f64 / elapsed,
+        bytes as f64 / elapsed / 1e6,
+        failed
+    );
+    if let Some(latency) = &latency {
+        println!("Flush latency: {}", format_latency(Some(latency)));
+        print_histogram(latency);
+    }
+    match first_error {
+        Some(err) => Err(err.into()),
+        None => Ok(()),
+    }
+}
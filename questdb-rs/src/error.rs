@@ -48,6 +48,10 @@ pub enum ErrorCode {
 
     /// Bad configuration.
     ConfigError,
+
+    /// The buffer has no room left within its fixed capacity.
+    /// Flush or clear it, then retry.
+    BufferFull,
 }
 
 /// An error that occurred when using QuestDB client library.
@@ -55,6 +59,7 @@ pub enum ErrorCode {
 pub struct Error {
     code: ErrorCode,
     msg: String,
+    failed_row: Option<usize>,
 }
 
 impl Error {
@@ -63,9 +68,15 @@ impl Error {
         Error {
             code,
             msg: msg.into(),
+            failed_row: None,
         }
     }
 
+    pub(crate) fn with_failed_row(mut self, failed_row: Option<usize>) -> Error {
+        self.failed_row = failed_row;
+        self
+    }
+
     /// Get the error code (category) of this error.
     pub fn code(&self) -> ErrorCode {
         self.code
@@ -75,6 +86,18 @@ impl Error {
     pub fn msg(&self) -> &str {
         &self.msg
     }
+
+    /// The index of the row the server rejected, counting from `0` at the
+    /// start of the flushed [`Buffer`](crate::ingress::Buffer), if the server
+    /// reported it along with a [`ServerFlushError`](ErrorCode::ServerFlushError).
+    ///
+    /// The rows before it were valid, but QuestDB only commits the rows of
+    /// an ILP/HTTP request if all of them are: Use
+    /// [`Buffer::drop_rows`](crate::ingress::Buffer::drop_rows) to remove the
+    /// bad row and flush the rest again.
+    pub fn failed_row(&self) -> Option<usize> {
+        self.failed_row
+    }
 }
 
 impl Display for Error {
@@ -23,8 +23,11 @@
  ******************************************************************************/
 
 use crate::error;
-use dns_lookup::{AddrInfo, AddrInfoHints, AddrInfoIter, LookupError};
+use dns_lookup::{AddrInfoHints, AddrInfoIter, LookupError};
 use socket2::SockAddr;
+use std::net::SocketAddr;
+use std::sync::Mutex;
+use std::time::{Duration, Instant};
 
 #[cfg(unix)]
 use libc::{AF_INET, SOCK_STREAM};
@@ -32,32 +35,71 @@ use libc::{AF_INET, SOCK_STREAM};
 #[cfg(windows)]
 use winapi::shared::ws2def::{AF_INET, SOCK_STREAM};
 
-fn map_getaddrinfo_result(
+/// How long resolved addresses are reused for. `getaddrinfo` doesn't report
+/// the TTL of the DNS records, so this is kept short.
+const CACHE_TTL: Duration = Duration::from_secs(30);
+
+struct CacheEntry {
+    host: String,
+    port: String,
+    resolved_at: Instant,
+    addrs: Vec<SocketAddr>,
+}
+
+/// Recently resolved addresses, shared by all senders. There are only ever a
+/// handful of hosts, so a linear scan will do.
+static CACHE: Mutex<Vec<CacheEntry>> = Mutex::new(Vec::new());
+
+fn map_lookup_err(dest: &str, io_err: std::io::Error) -> crate::Error {
+    error::fmt!(
+        CouldNotResolveAddr,
+        "Could not resolve {:?}: {}",
+        dest,
+        io_err
+    )
+}
+
+fn collect_addrs(
     dest: &str,
     result: Result<AddrInfoIter, LookupError>,
-) -> crate::Result<SockAddr> {
-    match result {
-        Ok(mut addrs) => {
-            let addr: AddrInfo = addrs.next().unwrap().map_err(|io_err| {
-                error::fmt!(
-                    CouldNotResolveAddr,
-                    "Could not resolve {:?}: {}",
-                    dest,
-                    io_err
-                )
-            })?;
-            Ok(addr.sockaddr.into())
+) -> crate::Result<Vec<SocketAddr>> {
+    let addrs = result.map_err(|lookup_err| map_lookup_err(dest, lookup_err.into()))?;
+    let mut resolved = Vec::new();
+    for addr in addrs {
+        let addr = addr.map_err(|io_err| map_lookup_err(dest, io_err))?;
+        if !resolved.contains(&addr.sockaddr) {
+            resolved.push(addr.sockaddr);
         }
-        Err(lookup_err) => {
-            let io_err: std::io::Error = lookup_err.into();
-            Err(error::fmt!(
-                CouldNotResolveAddr,
-                "Could not resolve {:?}: {}",
-                dest,
-                io_err
-            ))
+    }
+    if resolved.is_empty() {
+        return Err(error::fmt!(
+            CouldNotResolveAddr,
+            "Could not resolve {:?}: No addresses found",
+            dest
+        ));
+    }
+    Ok(resolved)
+}
+
+/// Alternate between address families, keeping the order `getaddrinfo`
+/// sorted each family in, and leading with the family of its first pick.
+/// See RFC 8305, section 4.
+pub(super) fn interleave_families(addrs: Vec<SocketAddr>) -> Vec<SocketAddr> {
+    let Some(first) = addrs.first() else {
+        return addrs;
+    };
+    let lead_v6 = first.is_ipv6();
+    let (lead, other): (Vec<_>, Vec<_>) = addrs.into_iter().partition(|a| a.is_ipv6() == lead_v6);
+    let mut interleaved = Vec::with_capacity(lead.len() + other.len());
+    let mut lead = lead.into_iter();
+    let mut other = other.into_iter();
+    loop {
+        match (lead.next(), other.next()) {
+            (None, None) => break,
+            (a, b) => interleaved.extend(a.into_iter().chain(b)),
         }
     }
+    interleaved
 }
 
 pub(super) fn resolve_host(host: &str) -> super::Result<SockAddr> {
@@ -66,18 +108,45 @@ pub(super) fn resolve_host(host: &str) -> super::Result<SockAddr> {
         address: AF_INET,
         ..AddrInfoHints::default()
     };
-    map_getaddrinfo_result(host, dns_lookup::getaddrinfo(Some(host), None, Some(hints)))
+    let addrs = collect_addrs(host, dns_lookup::getaddrinfo(Some(host), None, Some(hints)))?;
+    Ok(addrs[0].into())
 }
 
-pub(super) fn resolve_host_port(host: &str, port: &str) -> super::Result<SockAddr> {
+/// Resolve all the IPv4 and IPv6 addresses of `host`, in the order they
+/// should be tried: See [`interleave_families`].
+///
+/// Results are cached for [`CACHE_TTL`].
+pub(super) fn resolve_host_port(host: &str, port: &str) -> super::Result<Vec<SocketAddr>> {
+    let now = Instant::now();
+    {
+        let mut cache = CACHE
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner());
+        cache.retain(|entry| now.duration_since(entry.resolved_at) < CACHE_TTL);
+        if let Some(entry) = cache.iter().find(|e| e.host == host && e.port == port) {
+            return Ok(entry.addrs.clone());
+        }
+    }
+
     let hints = AddrInfoHints {
         socktype: SOCK_STREAM,
-        address: AF_INET,
         ..AddrInfoHints::default()
     };
     let host_port = format!("{}:{}", host, port);
-    map_getaddrinfo_result(
+    let addrs = interleave_families(collect_addrs(
         &host_port,
         dns_lookup::getaddrinfo(Some(host), Some(port), Some(hints)),
-    )
+    )?);
+
+    let mut cache = CACHE
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner());
+    cache.retain(|e| e.host != host || e.port != port);
+    cache.push(CacheEntry {
+        host: host.to_owned(),
+        port: port.to_owned(),
+        resolved_at: now,
+        addrs: addrs.clone(),
+    });
+    Ok(addrs)
 }
@@ -0,0 +1,765 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::ffi::{c_char, c_void, CStr};
+use std::mem::align_of;
+use std::slice;
+
+use crate::error::{self, Error, Result};
+
+use super::columns::column_key;
+use super::{
+    escaped_unquoted, write_escaped_quoted, write_escaped_unquoted, write_f64, write_timestamp,
+    Buffer, ColumnName, Op, OpCase, TableName, MAX_F64_LEN, MAX_I64_LEN,
+};
+
+/// The `ArrowSchema` struct of the
+/// [Arrow C data interface](https://arrow.apache.org/docs/format/CDataInterface.html),
+/// describing the type of an [`ArrowArray`].
+///
+/// It is layout-compatible with the structs exported by the Arrow libraries,
+/// such as `arrow::ffi::FFI_ArrowSchema` or pyarrow's `_export_to_c`.
+#[repr(C)]
+#[derive(Debug)]
+pub struct ArrowSchema {
+    /// Null-terminated type description, e.g. `"l"` for `int64`.
+    pub format: *const c_char,
+
+    /// Null-terminated field name, or NULL.
+    pub name: *const c_char,
+
+    /// Binary field metadata, or NULL. Ignored.
+    pub metadata: *const c_char,
+
+    /// Bitwise combination of the `ARROW_FLAG_*` flags. Ignored.
+    pub flags: i64,
+
+    /// Number of children in `children`.
+    pub n_children: i64,
+
+    /// The child types, one per struct field.
+    pub children: *mut *mut ArrowSchema,
+
+    /// The type of the dictionary values, if dictionary-encoded.
+    pub dictionary: *mut ArrowSchema,
+
+    /// Releases the schema. Never called here: The caller keeps ownership.
+    pub release: Option<unsafe extern "C" fn(*mut ArrowSchema)>,
+
+    /// Opaque producer-specific data.
+    pub private_data: *mut c_void,
+}
+
+/// The `ArrowArray` struct of the
+/// [Arrow C data interface](https://arrow.apache.org/docs/format/CDataInterface.html),
+/// holding the data of an array typed by an [`ArrowSchema`].
+///
+/// It is layout-compatible with the structs exported by the Arrow libraries,
+/// such as `arrow::ffi::FFI_ArrowArray` or pyarrow's `_export_to_c`.
+#[repr(C)]
+#[derive(Debug)]
+pub struct ArrowArray {
+    /// Number of logical values.
+    pub length: i64,
+
+    /// Number of null values, or `-1` if not computed.
+    pub null_count: i64,
+
+    /// Logical offset of the first value into the buffers.
+    pub offset: i64,
+
+    /// Number of buffers in `buffers`.
+    pub n_buffers: i64,
+
+    /// Number of children in `children`.
+    pub n_children: i64,
+
+    /// The buffers. The first one is the validity bitmap, or NULL if no value
+    /// is null.
+    pub buffers: *mut *const c_void,
+
+    /// The child arrays, one per struct field.
+    pub children: *mut *mut ArrowArray,
+
+    /// The dictionary values, if dictionary-encoded.
+    pub dictionary: *mut ArrowArray,
+
+    /// Releases the array. Never called here: The caller keeps ownership.
+    pub release: Option<unsafe extern "C" fn(*mut ArrowArray)>,
+
+    /// Opaque producer-specific data.
+    pub private_data: *mut c_void,
+}
+
+macro_rules! arrow_err {
+    ($($arg:tt)*) => {
+        error::fmt!(
+            InvalidApiCall,
+            "Bad call to `append_record_batch`: {}",
+            format!($($arg)*)
+        )
+    };
+}
+
+/// A validity or boolean bitmap, starting at bit `offset`.
+#[derive(Clone, Copy)]
+struct Bitmap<'a> {
+    bytes: &'a [u8],
+    offset: usize,
+}
+
+impl Bitmap<'_> {
+    #[inline(always)]
+    fn get(&self, index: usize) -> bool {
+        let bit = self.offset + index;
+        self.bytes[bit >> 3] & (1 << (bit & 7)) != 0
+    }
+}
+
+/// Integer values, widened to `i64` as they are read.
+#[derive(Clone, Copy)]
+enum Ints<'a> {
+    I8(&'a [i8]),
+    I16(&'a [i16]),
+    I32(&'a [i32]),
+    I64(&'a [i64]),
+    U8(&'a [u8]),
+    U16(&'a [u16]),
+    U32(&'a [u32]),
+}
+
+impl Ints<'_> {
+    #[inline(always)]
+    fn get(&self, index: usize) -> i64 {
+        match self {
+            Ints::I8(values) => values[index] as i64,
+            Ints::I16(values) => values[index] as i64,
+            Ints::I32(values) => values[index] as i64,
+            Ints::I64(values) => values[index],
+            Ints::U8(values) => values[index] as i64,
+            Ints::U16(values) => values[index] as i64,
+            Ints::U32(values) => values[index] as i64,
+        }
+    }
+}
+
+/// `utf8` or `large_utf8` values.
+#[derive(Clone, Copy)]
+enum Strs<'a> {
+    Utf8 { offsets: &'a [i32], data: &'a [u8] },
+    LargeUtf8 { offsets: &'a [i64], data: &'a [u8] },
+}
+
+impl<'a> Strs<'a> {
+    #[inline(always)]
+    fn bytes(&self, index: usize) -> Result<&'a [u8]> {
+        let (start, end, data) = match *self {
+            Strs::Utf8 { offsets, data } => {
+                (offsets[index] as i64, offsets[index + 1] as i64, data)
+            }
+            Strs::LargeUtf8 { offsets, data } => (offsets[index], offsets[index + 1], data),
+        };
+        if start < 0 || start > end || end as usize > data.len() {
+            return Err(arrow_err!(
+                "String offsets {}..{} are out of bounds.",
+                start,
+                end
+            ));
+        }
+        Ok(&data[start as usize..end as usize])
+    }
+
+    #[inline(always)]
+    fn get(&self, index: usize) -> Result<&'a str> {
+        std::str::from_utf8(self.bytes(index)?).map_err(|utf8_error| {
+            error::fmt!(
+                InvalidUtf8,
+                "Bad string value in Arrow array: {}",
+                utf8_error
+            )
+        })
+    }
+}
+
+#[derive(Clone, Copy)]
+enum TimeUnit {
+    Second,
+    Milli,
+    Micro,
+    Nano,
+}
+
+impl TimeUnit {
+    /// Parse the unit of a `ts?:` timestamp format. The time zone is ignored:
+    /// Arrow timestamps are always relative to the Unix epoch in UTC.
+    fn parse(format: &str) -> Option<Self> {
+        match format.get(..4)? {
+            "tss:" => Some(TimeUnit::Second),
+            "tsm:" => Some(TimeUnit::Milli),
+            "tsu:" => Some(TimeUnit::Micro),
+            "tsn:" => Some(TimeUnit::Nano),
+            _ => None,
+        }
+    }
+
+    fn to_micros(self, value: i64) -> Option<i64> {
+        match self {
+            TimeUnit::Second => value.checked_mul(1_000_000),
+            TimeUnit::Milli => value.checked_mul(1_000),
+            TimeUnit::Micro => Some(value),
+            TimeUnit::Nano => Some(value / 1_000),
+        }
+    }
+
+    fn to_nanos(self, value: i64) -> Option<i64> {
+        match self {
+            TimeUnit::Second => value.checked_mul(1_000_000_000),
+            TimeUnit::Milli => value.checked_mul(1_000_000),
+            TimeUnit::Micro => value.checked_mul(1_000),
+            TimeUnit::Nano => Some(value),
+        }
+    }
+}
+
+/// The values of a column, resolved once per batch to their Arrow type.
+#[derive(Clone, Copy)]
+enum Values<'a> {
+    Bool(Bitmap<'a>),
+    Int(Ints<'a>),
+    F32(&'a [f32]),
+    F64(&'a [f64]),
+    Str(Strs<'a>),
+    Timestamp(&'a [i64], TimeUnit),
+    Dictionary {
+        keys: Ints<'a>,
+        values: Strs<'a>,
+        values_validity: Option<Bitmap<'a>>,
+        len: usize,
+    },
+}
+
+/// A single non-null value of a row.
+enum Cell<'a> {
+    Bool(bool),
+    I64(i64),
+    F64(f64),
+    Str(&'a str),
+    TimestampMicros(i64),
+}
+
+struct Column<'a> {
+    name: &'a str,
+    /// The escaped `,name=` key.
+    key: String,
+    symbol: bool,
+    validity: Option<Bitmap<'a>>,
+    values: Values<'a>,
+}
+
+impl<'a> Column<'a> {
+    /// The value of the column at `row`, or `None` if it is null.
+    #[inline(always)]
+    fn get(&self, row: usize) -> Result<Option<Cell<'a>>> {
+        if let Some(validity) = self.validity {
+            if !validity.get(row) {
+                return Ok(None);
+            }
+        }
+        let cell = match self.values {
+            Values::Bool(bits) => Cell::Bool(bits.get(row)),
+            Values::Int(ints) => Cell::I64(ints.get(row)),
+            Values::F32(values) => Cell::F64(values[row] as f64),
+            Values::F64(values) => Cell::F64(values[row]),
+            Values::Str(strs) => Cell::Str(strs.get(row)?),
+            Values::Timestamp(values, unit) => {
+                let Some(micros) = unit.to_micros(values[row]) else {
+                    return Err(error::fmt!(
+                        InvalidTimestamp,
+                        "Timestamp {} in column {:?} overflows when converted to microseconds.",
+                        values[row],
+                        self.name
+                    ));
+                };
+                Cell::TimestampMicros(micros)
+            }
+            Values::Dictionary {
+                keys,
+                values,
+                values_validity,
+                len,
+            } => {
+                let key = keys.get(row);
+                if key < 0 || key as usize >= len {
+                    return Err(arrow_err!(
+                        "Dictionary key {} of column {:?} is out of bounds.",
+                        key,
+                        self.name
+                    ));
+                }
+                if let Some(validity) = values_validity {
+                    if !validity.get(key as usize) {
+                        return Ok(None);
+                    }
+                }
+                Cell::Str(values.get(key as usize)?)
+            }
+        };
+        Ok(Some(cell))
+    }
+
+    /// An upper bound on the length of the `,name=value` entry at `row`.
+    fn len_bound(&self, row: usize) -> Result<usize> {
+        let value_bound = match self.values {
+            Values::Bool(_) => 1,
+            Values::Int(_) | Values::Timestamp(..) => MAX_I64_LEN + 1,
+            Values::F32(_) | Values::F64(_) => MAX_F64_LEN,
+            Values::Str(strs) => 2 * strs.bytes(row)?.len() + 2,
+            Values::Dictionary { keys, values, .. } => match usize::try_from(keys.get(row)) {
+                Ok(key) if key < values_len(values) => 2 * values.bytes(key)?.len() + 2,
+                _ => 0,
+            },
+        };
+        Ok(self.key.len() + value_bound)
+    }
+}
+
+fn values_len(strs: Strs<'_>) -> usize {
+    match strs {
+        Strs::Utf8 { offsets, .. } => offsets.len() - 1,
+        Strs::LargeUtf8 { offsets, .. } => offsets.len() - 1,
+    }
+}
+
+/// The designated timestamps of a batch.
+struct Timestamps<'a> {
+    validity: Option<Bitmap<'a>>,
+    values: &'a [i64],
+    unit: TimeUnit,
+}
+
+impl Timestamps<'_> {
+    /// The timestamp at `row` in nanoseconds, or `None` if it is null.
+    #[inline(always)]
+    fn get(&self, row: usize) -> Result<Option<i64>> {
+        if let Some(validity) = self.validity {
+            if !validity.get(row) {
+                return Ok(None);
+            }
+        }
+        let value = self.values[row];
+        match self.unit.to_nanos(value) {
+            Some(nanos) if nanos >= 0 => Ok(Some(nanos)),
+            Some(nanos) => Err(error::fmt!(
+                InvalidTimestamp,
+                "Timestamp {} is negative. It must be >= 0.",
+                nanos
+            )),
+            None => Err(error::fmt!(
+                InvalidTimestamp,
+                "Timestamp {} overflows when converted to nanoseconds.",
+                value
+            )),
+        }
+    }
+}
+
+unsafe fn c_str<'a>(ptr: *const c_char, what: &str) -> Result<&'a str> {
+    if ptr.is_null() {
+        return Err(arrow_err!("Missing {}.", what));
+    }
+    CStr::from_ptr(ptr).to_str().map_err(|utf8_error| {
+        error::fmt!(InvalidUtf8, "Bad {} in Arrow schema: {}", what, utf8_error)
+    })
+}
+
+fn to_usize(value: i64, what: &str) -> Result<usize> {
+    usize::try_from(value).map_err(|_| arrow_err!("Bad {} {}.", what, value))
+}
+
+/// View buffer `index` of `array` as `len` values of type `T`.
+unsafe fn buffer<'a, T>(array: &'a ArrowArray, index: usize, len: usize) -> Result<&'a [T]> {
+    if (array.n_buffers as usize) <= index || array.buffers.is_null() {
+        return Err(arrow_err!(
+            "Expected at least {} buffers, got {}.",
+            index + 1,
+            array.n_buffers
+        ));
+    }
+    if len == 0 {
+        return Ok(&[]);
+    }
+    let ptr = *array.buffers.add(index) as *const T;
+    if ptr.is_null() {
+        return Err(arrow_err!("Buffer {} is NULL.", index));
+    }
+    if (ptr as usize) % align_of::<T>() != 0 {
+        return Err(arrow_err!("Buffer {} is not aligned.", index));
+    }
+    Ok(slice::from_raw_parts(ptr, len))
+}
+
+/// The validity bitmap of `len` values from `start`, if any value is null.
+unsafe fn validity<'a>(
+    array: &'a ArrowArray,
+    start: usize,
+    len: usize,
+) -> Result<Option<Bitmap<'a>>> {
+    if array.null_count == 0 || array.n_buffers < 1 || (*array.buffers).is_null() {
+        return Ok(None);
+    }
+    Ok(Some(Bitmap {
+        bytes: buffer(array, 0, (start + len).div_ceil(8))?,
+        offset: start,
+    }))
+}
+
+unsafe fn fixed<'a, T>(array: &'a ArrowArray, start: usize, len: usize) -> Result<&'a [T]> {
+    Ok(&buffer(array, 1, start + len)?[start..])
+}
+
+unsafe fn ints<'a>(
+    format: &str,
+    array: &'a ArrowArray,
+    start: usize,
+    len: usize,
+) -> Result<Option<Ints<'a>>> {
+    Ok(Some(match format {
+        "c" => Ints::I8(fixed(array, start, len)?),
+        "s" => Ints::I16(fixed(array, start, len)?),
+        "i" => Ints::I32(fixed(array, start, len)?),
+        "l" => Ints::I64(fixed(array, start, len)?),
+        "C" => Ints::U8(fixed(array, start, len)?),
+        "S" => Ints::U16(fixed(array, start, len)?),
+        "I" => Ints::U32(fixed(array, start, len)?),
+        _ => return Ok(None),
+    }))
+}
+
+unsafe fn strs<'a>(
+    format: &str,
+    array: &'a ArrowArray,
+    start: usize,
+    len: usize,
+) -> Result<Option<Strs<'a>>> {
+    Ok(Some(match format {
+        "u" => {
+            let offsets: &[i32] = fixed(array, start, len + 1)?;
+            let data_len = to_usize(offsets[len] as i64, "string offset")?;
+            Strs::Utf8 {
+                offsets,
+                data: buffer(array, 2, data_len)?,
+            }
+        }
+        "U" => {
+            let offsets: &[i64] = fixed(array, start, len + 1)?;
+            let data_len = to_usize(offsets[len], "string offset")?;
+            Strs::LargeUtf8 {
+                offsets,
+                data: buffer(array, 2, data_len)?,
+            }
+        }
+        _ => return Ok(None),
+    }))
+}
+
+/// Resolve the values of `len` rows of a child of a record batch whose own
+/// offset is `parent_offset`.
+unsafe fn values<'a>(
+    name: &str,
+    schema: &'a ArrowSchema,
+    array: &'a ArrowArray,
+    parent_offset: usize,
+    len: usize,
+) -> Result<(Option<Bitmap<'a>>, Values<'a>)> {
+    if to_usize(array.length, "array length")? < parent_offset + len {
+        return Err(arrow_err!(
+            "Column {:?} has {} values, expected at least {}.",
+            name,
+            array.length,
+            parent_offset + len
+        ));
+    }
+    let start = to_usize(array.offset, "array offset")? + parent_offset;
+    let format = c_str(schema.format, "format")?;
+    let unsupported = || {
+        arrow_err!(
+            "Column {:?} has the unsupported Arrow format {:?}.",
+            name,
+            format
+        )
+    };
+    let values = if !schema.dictionary.is_null() {
+        if array.dictionary.is_null() {
+            return Err(arrow_err!("Column {:?} has no dictionary.", name));
+        }
+        let (dict_schema, dict) = (&*schema.dictionary, &*array.dictionary);
+        let dict_format = c_str(dict_schema.format, "format")?;
+        let dict_len = to_usize(dict.length, "array length")?;
+        let dict_start = to_usize(dict.offset, "array offset")?;
+        let (Some(keys), Some(values)) = (
+            ints(format, array, start, len)?,
+            strs(dict_format, dict, dict_start, dict_len)?,
+        ) else {
+            return Err(unsupported());
+        };
+        Values::Dictionary {
+            keys,
+            values,
+            values_validity: validity(dict, dict_start, dict_len)?,
+            len: dict_len,
+        }
+    } else if let Some(ints) = ints(format, array, start, len)? {
+        Values::Int(ints)
+    } else if let Some(strs) = strs(format, array, start, len)? {
+        Values::Str(strs)
+    } else if let Some(unit) = TimeUnit::parse(format) {
+        Values::Timestamp(fixed(array, start, len)?, unit)
+    } else {
+        match format {
+            "b" => Values::Bool(Bitmap {
+                bytes: buffer(array, 1, (start + len).div_ceil(8))?,
+                offset: start,
+            }),
+            "f" => Values::F32(fixed(array, start, len)?),
+            "g" => Values::F64(fixed(array, start, len)?),
+            _ => return Err(unsupported()),
+        }
+    };
+    Ok((validity(array, start, len)?, values))
+}
+
+impl Buffer {
+    /// Append the rows of an Arrow record batch for the given table, reading
+    /// the column buffers in place.
+    ///
+    /// `schema` and `array` are a struct-typed array in the
+    /// [Arrow C data interface](https://arrow.apache.org/docs/format/CDataInterface.html),
+    /// as exported for a record batch by the Arrow libraries. Each field is
+    /// written as a column of the same name:
+    ///
+    /// * `bool` as [`column_bool`](Buffer::column_bool).
+    /// * Signed integers and unsigned integers up to 32 bits as
+    ///   [`column_i64`](Buffer::column_i64).
+    /// * `float` and `double` as [`column_f64`](Buffer::column_f64).
+    /// * `utf8` and `large_utf8` as [`column_str`](Buffer::column_str), or as
+    ///   [`symbol`](Buffer::symbol) if named in `symbol_columns`.
+    /// * Dictionary-encoded strings as [`symbol`](Buffer::symbol).
+    /// * Timestamps of any unit as [`column_ts`](Buffer::column_ts).
+    ///
+    /// Null cells are left out of their row, which QuestDB stores as NULL. A
+    /// row must have at least one non-null column.
+    ///
+    /// `timestamp_column` names the timestamp field holding the designated
+    /// timestamp of each row. It is not written as a column. Rows without one,
+    /// whether because the field is null or because `timestamp_column` is
+    /// `None`, are timestamped by the server, as with [`at_now`](Buffer::at_now).
+    ///
+    /// The types and names of the fields are checked once for the whole batch.
+    /// If any check or row fails, the buffer is left unchanged.
+    ///
+    /// # Safety
+    ///
+    /// `schema` and `array` must be valid, unreleased Arrow C data interface
+    /// structs describing the same array. They are only read: Releasing them
+    /// remains up to the caller.
+    pub unsafe fn append_record_batch<'a, N>(
+        &mut self,
+        table: N,
+        schema: &ArrowSchema,
+        array: &ArrowArray,
+        timestamp_column: Option<&str>,
+        symbol_columns: &[&str],
+    ) -> Result<&mut Self>
+    where
+        N: TryInto<TableName<'a>>,
+        Error: From<N::Error>,
+    {
+        let table: TableName<'a> = table.try_into()?;
+        self.validate_max_name_len(table.name)?;
+        self.check_op(Op::Table)?;
+
+        if schema.release.is_none() || array.release.is_none() {
+            return Err(arrow_err!("The schema or array was already released."));
+        }
+        if c_str(schema.format, "format")? != "+s" {
+            return Err(arrow_err!("Expected a struct array for the record batch."));
+        }
+        if array.null_count != 0 && array.n_buffers > 0 && !(*array.buffers).is_null() {
+            return Err(arrow_err!("The record batch has null rows."));
+        }
+        let row_count = to_usize(array.length, "array length")?;
+        let parent_offset = to_usize(array.offset, "array offset")?;
+        let field_count = to_usize(schema.n_children, "field count")?;
+        if array.n_children != schema.n_children {
+            return Err(arrow_err!(
+                "The schema has {} fields, but the array has {} children.",
+                schema.n_children,
+                array.n_children
+            ));
+        }
+
+        let mut symbols = Vec::new();
+        let mut fields = Vec::new();
+        let mut timestamps = None;
+        for index in 0..field_count {
+            let (field_schema, field) =
+                (&**schema.children.add(index), &**array.children.add(index));
+            let name = c_str(field_schema.name, "field name")?;
+            let (validity, values) = values(name, field_schema, field, parent_offset, row_count)?;
+            if Some(name) == timestamp_column {
+                let Values::Timestamp(values, unit) = values else {
+                    return Err(arrow_err!(
+                        "Designated timestamp column {:?} is not an Arrow timestamp.",
+                        name
+                    ));
+                };
+                timestamps = Some(Timestamps {
+                    validity,
+                    values,
+                    unit,
+                });
+                continue;
+            }
+            let column_name = ColumnName::new(name)?;
+            self.validate_max_name_len(name)?;
+            let symbol = match values {
+                Values::Dictionary { .. } => true,
+                Values::Str(_) => symbol_columns.contains(&name),
+                _ if symbol_columns.contains(&name) => {
+                    return Err(arrow_err!(
+                        "Symbol column {:?} is not an Arrow string column.",
+                        name
+                    ));
+                }
+                _ => false,
+            };
+            let column = Column {
+                name,
+                key: column_key(',', column_name),
+                symbol,
+                validity,
+                values,
+            };
+            if symbol {
+                symbols.push(column);
+            } else {
+                fields.push(column);
+            }
+        }
+        if let Some(name) = timestamp_column {
+            if timestamps.is_none() {
+                return Err(arrow_err!("No timestamp column named {:?}.", name));
+            }
+        }
+        for name in symbol_columns {
+            if !symbols.iter().any(|column| column.name == *name) {
+                return Err(arrow_err!("No symbol column named {:?}.", name));
+            }
+        }
+        if row_count == 0 {
+            return Ok(self);
+        }
+
+        let table_prefix = escaped_unquoted(table.name);
+        symbols.append(&mut fields);
+        let batch_start = self.output.len();
+        if let Err(err) =
+            self.write_record_batch(&table_prefix, &symbols, timestamps.as_ref(), row_count)
+        {
+            self.output.truncate(batch_start);
+            self.row_ends.truncate(self.state.row_count);
+            return Err(err);
+        }
+
+        // A buffer stops being transactional if it targets multiple tables.
+        self.track_table(batch_start, table_prefix.len());
+        self.state.op_case = OpCase::MayFlushOrTable;
+        self.state.row_count += row_count;
+        Ok(self)
+    }
+
+    /// Write the rows of [`append_record_batch`](Buffer::append_record_batch).
+    /// The symbol columns come first in `columns`.
+    fn write_record_batch(
+        &mut self,
+        table_prefix: &str,
+        columns: &[Column<'_>],
+        timestamps: Option<&Timestamps<'_>>,
+        row_count: usize,
+    ) -> Result<()> {
+        let mut int_buf = itoa::Buffer::new();
+        for row in 0..row_count {
+            if self.fixed_capacity.is_some() {
+                let mut len_bound = table_prefix.len() + MAX_I64_LEN + 2;
+                for column in columns {
+                    len_bound += column.len_bound(row)?;
+                }
+                self.check_capacity(len_bound)?;
+            }
+            let row_start = self.output.len();
+            self.output.extend_from_slice(table_prefix.as_bytes());
+            let mut field_sep = b' ';
+            for column in columns {
+                let Some(cell) = column.get(row)? else {
+                    continue;
+                };
+                if column.symbol {
+                    self.output.extend_from_slice(column.key.as_bytes());
+                } else {
+                    self.output.push(field_sep);
+                    self.output.extend_from_slice(&column.key.as_bytes()[1..]);
+                    field_sep = b',';
+                }
+                match cell {
+                    Cell::Str(value) if column.symbol => {
+                        write_escaped_unquoted(&mut self.output, value)
+                    }
+                    Cell::Str(value) => write_escaped_quoted(&mut self.output, value),
+                    Cell::Bool(value) => self.output.push(if value { b't' } else { b'f' }),
+                    Cell::I64(value) => {
+                        self.output
+                            .extend_from_slice(int_buf.format(value).as_bytes());
+                        self.output.push(b'i');
+                    }
+                    Cell::F64(value) => write_f64(&mut self.output, self.protocol_version, value),
+                    Cell::TimestampMicros(value) => {
+                        write_timestamp(&mut self.output, value);
+                        self.output.push(b't');
+                    }
+                }
+            }
+            if self.output.len() == row_start + table_prefix.len() {
+                return Err(arrow_err!("Row {} has no non-null values.", row));
+            }
+            if let Some(epoch_nanos) = timestamps.map(|ts| ts.get(row)).transpose()?.flatten() {
+                self.output.push(b' ');
+                let epoch = self.ts_precision.from_nanos(epoch_nanos);
+                self.ts_cache.write(&mut self.output, epoch);
+            }
+            self.output.push(b'\n');
+            self.row_ends.push(self.output.len());
+        }
+        Ok(())
+    }
+}
@@ -0,0 +1,648 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::fmt::{Debug, Formatter};
+use std::io;
+use std::ops::Deref;
+#[cfg(feature = "ilp-over-http2")]
+use std::sync::{Arc, Mutex, MutexGuard};
+use std::time::Duration;
+
+use bytes::Bytes;
+use http_body_util::{BodyExt, Full};
+use hyper::body::Incoming;
+use hyper::client::conn::http1::SendRequest;
+use hyper::header::{AUTHORIZATION, CONTENT_ENCODING, CONTENT_TYPE, HOST, RETRY_AFTER, USER_AGENT};
+#[cfg(feature = "ilp-over-http2")]
+use hyper_util::rt::TokioExecutor;
+use hyper_util::rt::TokioIo;
+use rustls_pki_types::ServerName;
+use tokio::io::{AsyncRead, AsyncWrite};
+use tokio::net::TcpStream;
+use tokio_rustls::TlsConnector;
+
+use crate::error::{self, Error, Result};
+
+use super::http::{
+    http_status_error, is_retriable_status, parse_retry_after, BodyEncoder, CircuitBreaker,
+    HttpConfig, RetrySchedule,
+};
+use super::{
+    configure_tls, http_auth_header, map_io_to_socket_err, Buffer, Op, ProtocolVersion,
+    SenderBuilder, TimestampPrecision,
+};
+
+/// The HTTP/2 flow-control windows and per-stream send buffer. Large enough
+/// for a multi-MB body to be in flight without waiting for window updates,
+/// as far as the server's own windows allow.
+#[cfg(feature = "ilp-over-http2")]
+const H2_WINDOW_SIZE: u32 = 8 * 1024 * 1024;
+
+/// A TCP or TLS stream.
+trait Stream: AsyncRead + AsyncWrite + Unpin + Send {}
+
+impl<T: AsyncRead + AsyncWrite + Unpin + Send> Stream for T {}
+
+/// The multiplexed HTTP/2 connection, shared by an `AsyncSender` and its
+/// clones. `None` until the first flush, and after the connection is lost.
+#[cfg(feature = "ilp-over-http2")]
+type Http2Conn = Arc<Mutex<Option<hyper::client::conn::http2::SendRequest<Full<Bytes>>>>>;
+
+/// Sends buffers to QuestDB over ILP/HTTP from async code running on a Tokio
+/// runtime.
+///
+/// The `AsyncSender` is configured with the same [`SenderBuilder`] settings
+/// and config string keys as a [`Sender`](super::Sender), but only supports
+/// the `http` and `https` protocols. It holds a single keep-alive connection,
+/// which is opened on the first flush and re-opened after a network error.
+///
+/// Flushes are retried on network errors and on retriable server errors until
+/// the `retry_timeout` is exhausted, waiting on the runtime's timer instead of
+/// blocking the thread.
+///
+/// With [`http2`](SenderBuilder::http2) on, the sender and its
+/// [clones](AsyncSender::try_clone) share a single HTTP/2 connection instead,
+/// over which the flushes of all of them are multiplexed.
+///
+/// ```no_run
+/// # use questdb::Result;
+/// use questdb::ingress::{AsyncSender, Buffer, TimestampNanos};
+///
+/// # #[tokio::main(flavor = "current_thread")]
+/// # async fn main() -> Result<()> {
+/// let mut sender = AsyncSender::from_conf("http::addr=localhost:9000;")?;
+/// let mut buffer = Buffer::new();
+/// buffer
+///     .table("trades")?
+///     .symbol("symbol", "ETH-USD")?
+///     .column_f64("price", 2615.54)?
+///     .at(TimestampNanos::now())?;
+/// sender.flush(&mut buffer).await?;
+/// # Ok(())
+/// # }
+/// ```
+pub struct AsyncSender {
+    descr: String,
+    host: String,
+    port: u16,
+
+    /// The content of the `Host` HTTP header.
+    host_header: String,
+
+    /// Set for `https`.
+    tls: Option<TlsConnector>,
+
+    /// The content of the `Authorization` HTTP header.
+    auth: Option<String>,
+
+    config: HttpConfig,
+    encoder: BodyEncoder,
+    breaker: CircuitBreaker,
+    max_buf_size: usize,
+    protocol_version: ProtocolVersion,
+    ts_precision: TimestampPrecision,
+
+    /// The keep-alive connection, once established.
+    conn: Option<SendRequest<Full<Bytes>>>,
+
+    /// Set with `http2=on`, in which case `conn` is unused.
+    #[cfg(feature = "ilp-over-http2")]
+    h2: Option<Http2Conn>,
+}
+
+impl Debug for AsyncSender {
+    fn fmt(&self, f: &mut Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
+        f.write_str(self.descr.as_str())
+    }
+}
+
+/// A failed attempt at sending a request.
+struct SendFailure {
+    retriable: bool,
+
+    /// A 5xx response or a network error, as counted by the circuit breaker.
+    server_failed: bool,
+
+    /// The delay requested by the server's `Retry-After` header.
+    retry_after: Option<Duration>,
+
+    err: Error,
+}
+
+impl SendFailure {
+    fn transport(err: Error) -> Self {
+        Self {
+            retriable: true,
+            server_failed: true,
+            retry_after: None,
+            err,
+        }
+    }
+}
+
+impl AsyncSender {
+    pub(super) fn new(builder: &SenderBuilder) -> Result<Self> {
+        if !builder.protocol.is_httpx() {
+            return Err(error::fmt!(
+                ConfigError,
+                "The async sender supports only ILP over HTTP."
+            ));
+        }
+        if builder.net_interface.is_some() {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "net_interface is not supported for ILP over HTTP."
+            ));
+        }
+
+        let config = builder.http.as_ref().unwrap().clone();
+        if config.spool_dir.is_some() {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"spool_dir\" is not supported by the async sender."
+            ));
+        }
+        if !builder.failover.is_empty() {
+            return Err(error::fmt!(
+                ConfigError,
+                "Multiple hosts in \"addr\" are not supported by the async sender."
+            ));
+        }
+
+        let host = builder.host.deref().clone();
+        let port: u16 = builder.port.parse().map_err(|_| {
+            error::fmt!(
+                ConfigError,
+                "Invalid port {:?}: Must be a number between 0 and 65535.",
+                builder.port.deref()
+            )
+        })?;
+
+        #[cfg(feature = "insecure-skip-verify")]
+        let tls_verify = *builder.tls_verify;
+
+        #[cfg(not(feature = "insecure-skip-verify"))]
+        let tls_verify = true;
+
+        let tls = configure_tls(
+            builder.protocol.tls_enabled(),
+            tls_verify,
+            *builder.tls_ca,
+            builder.tls_roots.deref(),
+        )?;
+
+        // Negotiate HTTP/2 with ALPN. The copy still shares the session cache.
+        #[cfg(feature = "ilp-over-http2")]
+        let h2 = (*config.http2).then(Http2Conn::default);
+        #[cfg(feature = "ilp-over-http2")]
+        let tls = tls.map(|tls_config| {
+            if h2.is_some() {
+                let mut tls_config = (*tls_config).clone();
+                tls_config.alpn_protocols = vec![b"h2".to_vec()];
+                Arc::new(tls_config)
+            } else {
+                tls_config
+            }
+        });
+        let tls = tls.map(TlsConnector::from);
+
+        let auth = http_auth_header(&builder.build_auth()?)?;
+        let descr = format!(
+            "AsyncSender[host={:?},port={:?},tls={},auth={}]",
+            host,
+            port,
+            if tls.is_some() { "enabled" } else { "disabled" },
+            if auth.is_some() { "on" } else { "off" }
+        );
+        Ok(Self {
+            descr,
+            host_header: format!("{}:{}", host, port),
+            host,
+            port,
+            tls,
+            auth,
+            encoder: BodyEncoder::new(*config.compression)?,
+            breaker: CircuitBreaker::new(&config),
+            config,
+            max_buf_size: *builder.max_buf_size,
+            // Building doesn't connect, so there's no server to ask.
+            protocol_version: builder.protocol_version.unwrap_or(ProtocolVersion::V1),
+            ts_precision: *builder.timestamp_precision,
+            conn: None,
+            #[cfg(feature = "ilp-over-http2")]
+            h2,
+        })
+    }
+
+    /// Create another sender with the same settings.
+    ///
+    /// With [`http2`](SenderBuilder::http2) on, the clone multiplexes its
+    /// flushes over the same connection as this sender: Give each task a
+    /// clone to have all their flushes in flight at once. Otherwise, the clone
+    /// opens a connection of its own on its first flush.
+    ///
+    /// Either way, the clone has a circuit breaker of its own.
+    pub fn try_clone(&self) -> Result<Self> {
+        Ok(Self {
+            descr: self.descr.clone(),
+            host: self.host.clone(),
+            port: self.port,
+            host_header: self.host_header.clone(),
+            tls: self.tls.clone(),
+            auth: self.auth.clone(),
+            config: self.config.clone(),
+            encoder: BodyEncoder::new(*self.config.compression)?,
+            breaker: CircuitBreaker::new(&self.config),
+            max_buf_size: self.max_buf_size,
+            protocol_version: self.protocol_version,
+            ts_precision: self.ts_precision,
+            conn: None,
+            #[cfg(feature = "ilp-over-http2")]
+            h2: self.h2.clone(),
+        })
+    }
+
+    /// Create a new `AsyncSender` from the given configuration string.
+    ///
+    /// The format is the same as that accepted by
+    /// [`Sender::from_conf`](super::Sender::from_conf), restricted to the
+    /// `http` and `https` protocols.
+    pub fn from_conf<T: AsRef<str>>(conf: T) -> Result<Self> {
+        SenderBuilder::from_conf(conf)?.build_async()
+    }
+
+    /// Create a new `AsyncSender` from the configuration stored in the
+    /// `QDB_CLIENT_CONF` environment variable.
+    pub fn from_env() -> Result<Self> {
+        SenderBuilder::from_env()?.build_async()
+    }
+
+    /// The version of the line protocol the sender was built with.
+    ///
+    /// The async sender doesn't ask the server: A `protocol_version` of
+    /// `auto` selects [`ProtocolVersion::V1`].
+    pub fn protocol_version(&self) -> ProtocolVersion {
+        self.protocol_version
+    }
+
+    /// The unit the sender expects designated timestamps in. See
+    /// [`SenderBuilder::timestamp_precision`](super::SenderBuilder::timestamp_precision).
+    pub fn timestamp_precision(&self) -> TimestampPrecision {
+        self.ts_precision
+    }
+
+    /// A new, empty buffer encoded with the sender's
+    /// [`protocol_version`](AsyncSender::protocol_version) and
+    /// [`timestamp_precision`](AsyncSender::timestamp_precision).
+    pub fn new_buffer(&self) -> Buffer {
+        let mut buffer = Buffer::new();
+        buffer.protocol_version = self.protocol_version;
+        buffer.ts_precision = self.ts_precision;
+        buffer
+    }
+
+    async fn connect(&self) -> Result<TokioIo<Box<dyn Stream>>> {
+        let tcp = TcpStream::connect((self.host.as_str(), self.port))
+            .await
+            .map_err(|io_err| {
+                let prefix = format!("Could not connect to {:?}: ", self.host_header);
+                map_io_to_socket_err(&prefix, io_err)
+            })?;
+        tcp.set_nodelay(true)
+            .map_err(|io_err| map_io_to_socket_err("Could not set TCP_NODELAY: ", io_err))?;
+
+        match self.tls {
+            Some(ref connector) => {
+                let server_name: ServerName = ServerName::try_from(self.host.as_str())
+                    .map_err(|inv_dns_err| error::fmt!(TlsError, "Bad host: {}", inv_dns_err))?
+                    .to_owned();
+                let tls = connector
+                    .connect(server_name, tcp)
+                    .await
+                    .map_err(|io_err| {
+                        error::fmt!(TlsError, "Failed to complete TLS handshake: {}", io_err)
+                    })?;
+                Ok(TokioIo::new(Box::new(tls) as Box<dyn Stream>))
+            }
+            None => Ok(TokioIo::new(Box::new(tcp) as Box<dyn Stream>)),
+        }
+    }
+
+    async fn send_request(
+        &mut self,
+        request: hyper::Request<Full<Bytes>>,
+    ) -> std::result::Result<hyper::Response<Incoming>, SendFailure> {
+        #[cfg(feature = "ilp-over-http2")]
+        if let Some(shared) = self.h2.clone() {
+            return self.send_request_h2(&shared, request).await;
+        }
+
+        if self.conn.as_ref().map_or(true, |conn| conn.is_closed()) {
+            self.conn = None;
+            let io = self.connect().await.map_err(SendFailure::transport)?;
+            self.conn = Some(handshake(io).await.map_err(SendFailure::transport)?);
+        }
+        let conn = self.conn.as_mut().unwrap();
+        if let Err(err) = conn.ready().await {
+            self.conn = None;
+            return Err(SendFailure::transport(flush_err(&err)));
+        }
+        match conn.send_request(request).await {
+            Ok(response) => Ok(response),
+            Err(err) => {
+                self.conn = None;
+                Err(SendFailure::transport(flush_err(&err)))
+            }
+        }
+    }
+
+    #[cfg(feature = "ilp-over-http2")]
+    async fn send_request_h2(
+        &self,
+        shared: &Http2Conn,
+        request: hyper::Request<Full<Bytes>>,
+    ) -> std::result::Result<hyper::Response<Incoming>, SendFailure> {
+        let conn = lock_h2(shared)
+            .as_ref()
+            .filter(|conn| !conn.is_closed())
+            .cloned();
+        let mut conn = match conn {
+            Some(conn) => conn,
+            None => {
+                let io = self.connect().await.map_err(SendFailure::transport)?;
+                let conn = handshake_h2(io).await.map_err(SendFailure::transport)?;
+
+                // Should another clone have connected meanwhile, either
+                // connection will do.
+                *lock_h2(shared) = Some(conn.clone());
+                conn
+            }
+        };
+        let result = match conn.ready().await {
+            Ok(()) => conn.send_request(request).await,
+            Err(err) => Err(err),
+        };
+        result.map_err(|err| {
+            // A reset stream leaves the connection usable for the others.
+            let mut slot = lock_h2(shared);
+            if slot.as_ref().map_or(false, |conn| conn.is_closed()) {
+                *slot = None;
+            }
+            SendFailure::transport(flush_err(&err))
+        })
+    }
+
+    async fn send(
+        &mut self,
+        content_encoding: Option<&'static str>,
+        body: Bytes,
+    ) -> std::result::Result<(), SendFailure> {
+        let path = format!("/write?precision={}", self.ts_precision.query_param());
+
+        // HTTP/2 takes the scheme and authority from the URI instead of a
+        // `Host` header, so it must be absolute.
+        #[cfg(feature = "ilp-over-http2")]
+        let request = if self.h2.is_some() {
+            let scheme = if self.tls.is_some() { "https" } else { "http" };
+            hyper::Request::post(format!("{}://{}{}", scheme, self.host_header, path))
+        } else {
+            hyper::Request::post(path).header(HOST, self.host_header.as_str())
+        };
+        #[cfg(not(feature = "ilp-over-http2"))]
+        let request = hyper::Request::post(path).header(HOST, self.host_header.as_str());
+
+        let request = request
+            .header(USER_AGENT, self.config.user_agent.as_str())
+            .header(CONTENT_TYPE, "text/plain; charset=utf-8");
+        let request = match content_encoding {
+            Some(encoding) => request.header(CONTENT_ENCODING, encoding),
+            None => request,
+        };
+        let request = match self.auth.as_ref() {
+            Some(auth) => request.header(AUTHORIZATION, auth.as_str()),
+            None => request,
+        };
+        let request = request.body(Full::new(body)).map_err(|err| SendFailure {
+            retriable: false,
+            server_failed: false,
+            retry_after: None,
+            err: error::fmt!(InvalidApiCall, "Could not flush buffer: {}", err),
+        })?;
+
+        let response = self.send_request(request).await?;
+
+        let http_status_code = response.status().as_u16();
+        let retry_after = parse_retry_after(
+            http_status_code,
+            response
+                .headers()
+                .get(RETRY_AFTER)
+                .and_then(|value| value.to_str().ok()),
+        );
+        let content_type = response
+            .headers()
+            .get(CONTENT_TYPE)
+            .and_then(|value| value.to_str().ok())
+            .and_then(|value| value.split(';').next())
+            .unwrap_or("")
+            .trim()
+            .to_string();
+
+        // Always read the response to the end, so the connection can be reused.
+        let body = match response.into_body().collect().await {
+            Ok(collected) => Ok(String::from_utf8_lossy(&collected.to_bytes()).into_owned()),
+            Err(err) => {
+                self.conn = None;
+                Err(io::Error::new(io::ErrorKind::Other, err))
+            }
+        };
+
+        if (200..300).contains(&http_status_code) {
+            // On success, there's no information in the response.
+            return Ok(());
+        }
+        Err(SendFailure {
+            retriable: is_retriable_status(http_status_code),
+            server_failed: http_status_code >= 500,
+            retry_after,
+            err: http_status_error(http_status_code, &content_type, body),
+        })
+    }
+
+    /// Send the batch of rows in the buffer to the QuestDB server, and, if the
+    /// `transactional` parameter is true, ensure the flush will be transactional.
+    ///
+    /// This behaves as [`Sender::flush_and_keep_with_flags`](super::Sender::flush_and_keep_with_flags),
+    /// but waits for the response, and for the interval between retries,
+    /// without blocking the thread.
+    ///
+    /// All the data stays in the buffer. Clear the buffer before starting a new batch.
+    pub async fn flush_and_keep_with_flags(
+        &mut self,
+        buf: &Buffer,
+        transactional: bool,
+    ) -> Result<()> {
+        buf.check_op(Op::Flush)?;
+        if buf.protocol_version() > self.protocol_version {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Could not flush buffer: Buffer uses line protocol version {}, but the sender uses version {}.",
+                buf.protocol_version(),
+                self.protocol_version
+            ));
+        }
+        if buf.timestamp_precision() != self.ts_precision {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Could not flush buffer: Buffer uses timestamp precision {:?}, but the sender uses {:?}. Create buffers with `AsyncSender::new_buffer`.",
+                buf.timestamp_precision(),
+                self.ts_precision
+            ));
+        }
+        if buf.len() > self.max_buf_size {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Could not flush buffer: Buffer size of {} exceeds maximum configured allowed size of {} bytes.",
+                buf.len(),
+                self.max_buf_size
+            ));
+        }
+        if transactional && !buf.transactional() {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Buffer contains lines for multiple tables. \
+                Transactional flushes are only supported for buffers containing lines for a single table."
+            ));
+        }
+
+        let bytes = buf.as_bytes();
+        if bytes.is_empty() {
+            return Ok(());
+        }
+        let content_encoding = self.encoder.content_encoding();
+        let body = Bytes::copy_from_slice(self.encoder.encode(bytes)?);
+        let timeout = self.config.request_timeout_for(body.len());
+        self.breaker.check()?;
+
+        let mut schedule: Option<RetrySchedule> = None;
+        loop {
+            let failure = match tokio::time::timeout(
+                timeout,
+                self.send(content_encoding, body.clone()),
+            )
+            .await
+            {
+                Ok(Ok(())) => {
+                    self.breaker.record(false);
+                    return Ok(());
+                }
+                Ok(Err(failure)) => failure,
+                Err(_elapsed) => {
+                    self.conn = None;
+                    SendFailure::transport(error::fmt!(
+                        SocketError,
+                        "Could not flush buffer: Timed out after {:?}.",
+                        timeout
+                    ))
+                }
+            };
+            self.breaker.record(failure.server_failed);
+            if !failure.retriable || self.breaker.is_open() {
+                return Err(failure.err);
+            }
+            let schedule = schedule.get_or_insert_with(|| RetrySchedule::new(&self.config));
+            match schedule.next_delay(failure.retry_after) {
+                Some(to_sleep) => tokio::time::sleep(to_sleep).await,
+                None => return Err(failure.err),
+            }
+        }
+    }
+
+    /// Send the given buffer of rows to the QuestDB server.
+    ///
+    /// All the data stays in the buffer. Clear the buffer before starting a new batch.
+    pub async fn flush_and_keep(&mut self, buf: &Buffer) -> Result<()> {
+        self.flush_and_keep_with_flags(buf, false).await
+    }
+
+    /// Send the given buffer of rows to the QuestDB server, clearing the buffer.
+    ///
+    /// After this function returns, the buffer is empty and ready for the next batch.
+    /// If you want to preserve the buffer contents, call [`flush_and_keep`](AsyncSender::flush_and_keep).
+    pub async fn flush(&mut self, buf: &mut Buffer) -> Result<()> {
+        self.flush_and_keep(buf).await?;
+        buf.clear();
+        Ok(())
+    }
+}
+
+fn flush_err(err: &hyper::Error) -> Error {
+    error::fmt!(SocketError, "Could not flush buffer: {}", err)
+}
+
+async fn handshake<T>(io: T) -> Result<SendRequest<Full<Bytes>>>
+where
+    T: hyper::rt::Read + hyper::rt::Write + Unpin + Send + 'static,
+{
+    let (send_request, conn) = hyper::client::conn::http1::handshake(io)
+        .await
+        .map_err(|err| error::fmt!(SocketError, "Could not connect: {}", err))?;
+
+    // Drives the connection until it's closed, or the `SendRequest` is dropped.
+    tokio::spawn(async move {
+        let _ = conn.await;
+    });
+    Ok(send_request)
+}
+
+#[cfg(feature = "ilp-over-http2")]
+async fn handshake_h2<T>(io: T) -> Result<hyper::client::conn::http2::SendRequest<Full<Bytes>>>
+where
+    T: hyper::rt::Read + hyper::rt::Write + Unpin + Send + 'static,
+{
+    let (send_request, conn) = hyper::client::conn::http2::Builder::new(TokioExecutor::new())
+        .initial_stream_window_size(H2_WINDOW_SIZE)
+        .initial_connection_window_size(H2_WINDOW_SIZE * 4)
+        .max_send_buf_size(H2_WINDOW_SIZE as usize)
+        .handshake(io)
+        .await
+        .map_err(|err| error::fmt!(SocketError, "Could not connect: {}", err))?;
+
+    // Drives the connection until it's closed, or every `SendRequest` clone
+    // is dropped.
+    tokio::spawn(async move {
+        let _ = conn.await;
+    });
+    Ok(send_request)
+}
+
+#[cfg(feature = "ilp-over-http2")]
+fn lock_h2(
+    shared: &Http2Conn,
+) -> MutexGuard<'_, Option<hyper::client::conn::http2::SendRequest<Full<Bytes>>>> {
+    // A panic whilst holding the lock can't leave the slot inconsistent.
+    shared
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner())
+}
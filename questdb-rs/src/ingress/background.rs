@@ -0,0 +1,312 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::sync::mpsc::{self, Receiver, SyncSender, TryRecvError};
+use std::sync::Arc;
+use std::thread::JoinHandle;
+
+use crate::error::{self, Result};
+
+use super::{map_io_to_socket_err, Buffer, BufferPool, Op, Sender};
+
+type FlushCallback = Box<dyn FnOnce(Result<()>) + Send + 'static>;
+
+pub(super) enum Completion {
+    Handle(SyncSender<Result<()>>),
+    Callback(FlushCallback),
+}
+
+impl Completion {
+    /// A completion reported through the returned [`FlushHandle`].
+    pub(super) fn handle() -> (Self, FlushHandle) {
+        let (tx, rx) = mpsc::sync_channel(1);
+        (Completion::Handle(tx), FlushHandle { rx, result: None })
+    }
+
+    pub(super) fn complete(self, result: Result<()>) {
+        match self {
+            Completion::Handle(tx) => {
+                // The caller may have dropped the handle without waiting.
+                let _ = tx.send(result);
+            }
+            Completion::Callback(callback) => callback(result),
+        }
+    }
+}
+
+struct FlushJob {
+    buf: Buffer,
+    transactional: bool,
+    completion: Completion,
+}
+
+pub(super) fn io_thread_exited() -> error::Error {
+    error::fmt!(
+        SocketError,
+        "Could not flush buffer: The background I/O thread has exited."
+    )
+}
+
+/// Tracks the completion of a flush submitted to a [`BackgroundSender`], or of
+/// the rows committed by a [`Lane`](super::Lane).
+///
+/// Dropping the handle without waiting does not cancel the flush.
+pub struct FlushHandle {
+    rx: Receiver<Result<()>>,
+    result: Option<Result<()>>,
+}
+
+impl FlushHandle {
+    /// Tell whether the flush has completed, without blocking.
+    ///
+    /// Once this returns `true`, [`wait`](FlushHandle::wait) returns immediately.
+    pub fn is_done(&mut self) -> bool {
+        if self.result.is_none() {
+            self.result = match self.rx.try_recv() {
+                Ok(result) => Some(result),
+                Err(TryRecvError::Empty) => None,
+                Err(TryRecvError::Disconnected) => Some(Err(io_thread_exited())),
+            };
+        }
+        self.result.is_some()
+    }
+
+    /// Block until the flush has completed and return its outcome.
+    pub fn wait(self) -> Result<()> {
+        match self.result {
+            Some(result) => result,
+            None => self.rx.recv().unwrap_or_else(|_| Err(io_thread_exited())),
+        }
+    }
+}
+
+/// Flushes buffers from a dedicated I/O thread.
+///
+/// The I/O thread owns the [`Sender`] and its connection. Calling
+/// [`flush`](BackgroundSender::flush) hands the filled buffer over to the I/O
+/// thread and swaps in an empty buffer from a small ring, so the caller can
+/// keep appending rows whilst the previous batch is in flight.
+///
+/// When all the buffers of the ring are in flight, `flush` blocks until the
+/// I/O thread returns one. This bounds both memory usage and the number of
+/// outstanding flushes.
+///
+/// Flushes are sent in the order they were submitted. If a flush fails, its
+/// rows are discarded and the error is reported through the
+/// [`FlushHandle`] or the callback.
+///
+/// A ring buffer that grew to hold an outlier batch keeps its capacity. To
+/// bound that, draw the ring from a [`BufferPool`] with
+/// [`Sender::into_background_with_pool`]: The I/O thread then shrinks each
+/// sent buffer back to the pool's `max_capacity`, and the ring is returned to
+/// the pool on close.
+///
+/// ```no_run
+/// # use questdb::Result;
+/// use questdb::ingress::{Buffer, Sender, TimestampNanos};
+///
+/// # fn main() -> Result<()> {
+/// let sender = Sender::from_conf("http::addr=localhost:9000;")?;
+/// let mut sender = sender.into_background(2)?;
+/// let mut buffer = Buffer::new();
+/// buffer
+///     .table("trades")?
+///     .symbol("symbol", "ETH-USD")?
+///     .column_f64("price", 2615.54)?
+///     .at(TimestampNanos::now())?;
+/// let handle = sender.flush(&mut buffer)?;
+///
+/// // `buffer` is now empty and can be filled again straight away.
+///
+/// handle.wait()?;
+/// # Ok(())
+/// # }
+/// ```
+pub struct BackgroundSender {
+    jobs: Option<SyncSender<FlushJob>>,
+    free: Receiver<Buffer>,
+    io_thread: Option<JoinHandle<()>>,
+    buffers: Option<Arc<BufferPool>>,
+}
+
+impl BackgroundSender {
+    pub(crate) fn new(
+        sender: Sender,
+        ring_size: usize,
+        buffers: Option<Arc<BufferPool>>,
+    ) -> Result<Self> {
+        if ring_size == 0 {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "The buffer ring size of a background sender must be at least 1."
+            ));
+        }
+        let (jobs_tx, jobs_rx) = mpsc::sync_channel::<FlushJob>(ring_size);
+        let (free_tx, free_rx) = mpsc::sync_channel::<Buffer>(ring_size);
+        for _ in 0..ring_size {
+            let buf = buffers
+                .as_ref()
+                .map_or_else(Buffer::new, |pool| pool.acquire());
+            free_tx.send(buf).expect("free ring has capacity");
+        }
+        let io_buffers = buffers.clone();
+        let io_thread = std::thread::Builder::new()
+            .name("questdb-flush".to_owned())
+            .spawn(move || run_io_loop(sender, jobs_rx, free_tx, io_buffers))
+            .map_err(|io_err| {
+                map_io_to_socket_err("Could not start background I/O thread: ", io_err)
+            })?;
+        Ok(Self {
+            jobs: Some(jobs_tx),
+            free: free_rx,
+            io_thread: Some(io_thread),
+            buffers,
+        })
+    }
+
+    fn submit(
+        &mut self,
+        buf: &mut Buffer,
+        transactional: bool,
+        completion: Completion,
+    ) -> Result<()> {
+        buf.check_op(Op::Flush)?;
+        let jobs = self.jobs.as_ref().expect("jobs channel is open");
+        let mut ready = self.free.recv().map_err(|_| io_thread_exited())?;
+        ready.max_name_len = buf.max_name_len;
+        ready.protocol_version = buf.protocol_version;
+        ready.ts_precision = buf.ts_precision;
+        ready.trusted = buf.trusted;
+        std::mem::swap(buf, &mut ready);
+        let job = FlushJob {
+            buf: ready,
+            transactional,
+            completion,
+        };
+        if let Err(mpsc::SendError(job)) = jobs.send(job) {
+            // Give the rows back to the caller rather than losing them.
+            *buf = job.buf;
+            return Err(io_thread_exited());
+        }
+        Ok(())
+    }
+
+    /// Hand the buffer over to the I/O thread to be sent, and replace it with an
+    /// empty buffer from the ring.
+    ///
+    /// Returns as soon as the buffer is queued. Use the returned [`FlushHandle`]
+    /// to find out when the flush has completed and whether it succeeded.
+    ///
+    /// The buffer's state is validated straight away: A buffer with an
+    /// incomplete row is rejected without being queued.
+    pub fn flush(&mut self, buf: &mut Buffer) -> Result<FlushHandle> {
+        let (completion, handle) = Completion::handle();
+        self.submit(buf, false, completion)?;
+        Ok(handle)
+    }
+
+    /// Transactional variant of [`flush`](BackgroundSender::flush).
+    ///
+    /// See [`Sender::flush_and_keep_with_flags`] for the rules on transactional
+    /// flushes.
+    #[cfg(feature = "ilp-over-http")]
+    pub fn flush_with_flags(
+        &mut self,
+        buf: &mut Buffer,
+        transactional: bool,
+    ) -> Result<FlushHandle> {
+        let (completion, handle) = Completion::handle();
+        self.submit(buf, transactional, completion)?;
+        Ok(handle)
+    }
+
+    /// Like [`flush`](BackgroundSender::flush), but reports the outcome by
+    /// invoking `callback` instead of returning a handle.
+    ///
+    /// The callback runs on the I/O thread: Keep it short, as no further
+    /// flushes are sent until it returns.
+    pub fn flush_with_callback<F>(&mut self, buf: &mut Buffer, callback: F) -> Result<()>
+    where
+        F: FnOnce(Result<()>) + Send + 'static,
+    {
+        self.submit(buf, false, Completion::Callback(Box::new(callback)))
+    }
+
+    /// Wait for all the queued flushes to complete, then stop the I/O thread
+    /// and close the connection.
+    ///
+    /// This is also done implicitly when the `BackgroundSender` is dropped.
+    pub fn close(mut self) {
+        self.shutdown();
+    }
+
+    fn shutdown(&mut self) {
+        // Closing the jobs channel ends the I/O loop once the queue is drained.
+        drop(self.jobs.take());
+        if let Some(io_thread) = self.io_thread.take() {
+            let _ = io_thread.join();
+        }
+        if let Some(pool) = self.buffers.take() {
+            for buf in self.free.try_iter() {
+                pool.release(buf);
+            }
+        }
+    }
+}
+
+impl Drop for BackgroundSender {
+    fn drop(&mut self) {
+        self.shutdown();
+    }
+}
+
+impl std::fmt::Debug for BackgroundSender {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
+        f.write_str("BackgroundSender")
+    }
+}
+
+fn run_io_loop(
+    mut sender: Sender,
+    jobs: Receiver<FlushJob>,
+    free: SyncSender<Buffer>,
+    buffers: Option<Arc<BufferPool>>,
+) {
+    for job in jobs.iter() {
+        let FlushJob {
+            mut buf,
+            transactional,
+            completion,
+        } = job;
+        let result = sender.flush_impl(&buf, transactional);
+        match &buffers {
+            Some(pool) => pool.recycle(&mut buf),
+            None => buf.clear(),
+        }
+
+        // The caller may have already dropped the `BackgroundSender`.
+        let _ = free.send(buf);
+        completion.complete(result);
+    }
+}
@@ -0,0 +1,212 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::sync::{Mutex, MutexGuard};
+
+use super::{Buffer, ProtocolVersion, Sender, TimestampCache, TimestampPrecision};
+
+/// A shared free list of [`Buffer`]s, so that batches can be prepared without
+/// allocating a fresh buffer for each of them.
+///
+/// [`acquire`](BufferPool::acquire) hands out an empty buffer, reusing a
+/// returned one when there is one. [`release`](BufferPool::release) clears the
+/// buffer and keeps it for the next caller.
+///
+/// Memory use is bounded by two limits:
+///   * `max_capacity`: A returned buffer that grew past this many bytes, say
+///     to hold one outlier batch, is shrunk back down to it.
+///   * `max_idle`: Buffers returned whilst this many are already idle are
+///     dropped.
+///
+/// Once the pool has warmed up, a steady stream of batches no larger than
+/// `max_capacity` no longer touches the allocator.
+///
+/// The pool can also be shared with a [`BackgroundSender`](super::BackgroundSender)
+/// via [`Sender::into_background_with_pool`](super::Sender::into_background_with_pool)
+/// and with a [`SenderPool`](super::SenderPool) via
+/// [`SenderPool::set_buffer_pool`](super::SenderPool::set_buffer_pool), which
+/// then apply the same `max_capacity` to the buffers they recycle.
+///
+/// Buffers are encoded with [`ProtocolVersion::V1`] and write designated
+/// timestamps in nanoseconds unless the pool is told otherwise via
+/// [`with_protocol_version`](BufferPool::with_protocol_version) and
+/// [`with_timestamp_precision`](BufferPool::with_timestamp_precision), or via
+/// [`for_sender`](BufferPool::for_sender) to match a sender.
+///
+/// ```no_run
+/// # use questdb::Result;
+/// use std::sync::Arc;
+/// use questdb::ingress::{BufferPool, SenderPool, TimestampNanos};
+///
+/// # fn main() -> Result<()> {
+/// let pool = Arc::new(SenderPool::from_conf("http::addr=localhost:9000;pool_size=4;")?);
+/// let buffers = Arc::new(BufferPool::new(1024 * 1024, 8).for_sender(&pool.get()?));
+/// let mut buffer = buffers.acquire();
+/// buffer
+///     .table("trades")?
+///     .symbol("symbol", "ETH-USD")?
+///     .column_f64("price", 2615.54)?
+///     .at(TimestampNanos::now())?;
+/// pool.flush(&mut buffer)?;
+/// buffers.release(buffer);
+/// # Ok(())
+/// # }
+/// ```
+pub struct BufferPool {
+    free: Mutex<Vec<Buffer>>,
+    max_capacity: usize,
+    max_idle: usize,
+    max_name_len: usize,
+    protocol_version: ProtocolVersion,
+    ts_precision: TimestampPrecision,
+}
+
+impl BufferPool {
+    /// Create an empty pool that keeps up to `max_idle` buffers of at most
+    /// `max_capacity` bytes each.
+    pub fn new(max_capacity: usize, max_idle: usize) -> Self {
+        Self {
+            free: Mutex::new(Vec::with_capacity(max_idle)),
+            max_capacity,
+            max_idle,
+            max_name_len: 127,
+            protocol_version: ProtocolVersion::V1,
+            ts_precision: TimestampPrecision::Nanos,
+        }
+    }
+
+    /// Set the `max_name_len` of the buffers the pool creates.
+    /// See [`Buffer::with_max_name_len`].
+    pub fn with_max_name_len(mut self, max_name_len: usize) -> Self {
+        self.max_name_len = max_name_len;
+        self
+    }
+
+    /// Set the line protocol version of the buffers the pool hands out.
+    /// See [`Buffer::set_protocol_version`].
+    pub fn with_protocol_version(mut self, protocol_version: ProtocolVersion) -> Self {
+        self.protocol_version = protocol_version;
+        self
+    }
+
+    /// Set the designated timestamp unit of the buffers the pool hands out.
+    /// See [`Buffer::set_timestamp_precision`].
+    pub fn with_timestamp_precision(mut self, precision: TimestampPrecision) -> Self {
+        self.ts_precision = precision;
+        self
+    }
+
+    /// Hand out buffers encoded like those of [`Sender::new_buffer`]: with
+    /// the sender's [`protocol_version`](Sender::protocol_version) and
+    /// [`timestamp_precision`](Sender::timestamp_precision).
+    pub fn for_sender(self, sender: &Sender) -> Self {
+        self.with_protocol_version(sender.protocol_version())
+            .with_timestamp_precision(sender.timestamp_precision())
+    }
+
+    /// The line protocol version of the buffers the pool hands out.
+    pub fn protocol_version(&self) -> ProtocolVersion {
+        self.protocol_version
+    }
+
+    /// The designated timestamp unit of the buffers the pool hands out.
+    pub fn timestamp_precision(&self) -> TimestampPrecision {
+        self.ts_precision
+    }
+
+    /// The capacity returned buffers are shrunk down to.
+    pub fn max_capacity(&self) -> usize {
+        self.max_capacity
+    }
+
+    /// The number of buffers currently waiting in the pool.
+    pub fn idle(&self) -> usize {
+        self.lock_free().len()
+    }
+
+    fn lock_free(&self) -> MutexGuard<'_, Vec<Buffer>> {
+        // A panic whilst holding the lock can't leave the free list inconsistent.
+        self.free
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    /// Take an empty buffer from the pool, or create one if the pool is empty.
+    pub fn acquire(&self) -> Buffer {
+        self.lock_free().pop().unwrap_or_else(|| {
+            let mut buf = Buffer::with_max_name_len(self.max_name_len);
+            buf.protocol_version = self.protocol_version;
+            buf.ts_precision = self.ts_precision;
+            buf
+        })
+    }
+
+    /// Return a buffer to the pool, discarding its contents.
+    ///
+    /// The buffer needn't have come from this pool: Its settings are reset to
+    /// those of a buffer the pool creates, so that, say, a
+    /// [trusted](Buffer::set_trusted) buffer isn't handed out to a caller who
+    /// never opted in. A [fixed-capacity](Buffer::with_fixed_capacity) buffer
+    /// loses its fixed capacity too, and is shrunk like any other.
+    pub fn release(&self, mut buf: Buffer) {
+        self.reset(&mut buf);
+        self.recycle(&mut buf);
+        let mut free = self.lock_free();
+        if free.len() < self.max_idle {
+            free.push(buf);
+        }
+    }
+
+    /// Restore the settings of a buffer from [`acquire`](BufferPool::acquire).
+    fn reset(&self, buf: &mut Buffer) {
+        buf.max_name_len = self.max_name_len;
+        buf.fixed_capacity = None;
+        buf.ts_cache = TimestampCache::new();
+        buf.protocol_version = self.protocol_version;
+        buf.ts_precision = self.ts_precision;
+        buf.trusted = false;
+    }
+
+    /// Clear the buffer and bring its capacity back down to `max_capacity`.
+    ///
+    /// Buffers with a [fixed capacity](Buffer::with_fixed_capacity) that stay
+    /// with their owner are never shrunk, as they must not reallocate.
+    pub(super) fn recycle(&self, buf: &mut Buffer) {
+        buf.clear();
+        if buf.fixed_capacity.is_none() && buf.capacity() > self.max_capacity {
+            buf.output.shrink_to(self.max_capacity);
+        }
+    }
+}
+
+impl std::fmt::Debug for BufferPool {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
+        write!(
+            f,
+            "BufferPool[idle={}, max_capacity={}]",
+            self.idle(),
+            self.max_capacity
+        )
+    }
+}
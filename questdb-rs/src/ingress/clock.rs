@@ -0,0 +1,228 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::sync::atomic::{AtomicI64, AtomicU64, Ordering};
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+
+use super::TimestampNanos;
+
+/// Where a [`FastClock`] reads the time from.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ClockSource {
+    /// The system's wall clock, as per [`TimestampNanos::now`].
+    System,
+
+    /// On Linux, the kernel's `CLOCK_REALTIME_COARSE`: Read without a system
+    /// call or a hardware timer access, but with a resolution of one
+    /// scheduler tick, typically 1 to 4 milliseconds. Elsewhere, the same as
+    /// [`ClockSource::System`].
+    Coarse,
+
+    /// The monotonic clock, offset to the wall clock when the `FastClock` is
+    /// created and again every [resync
+    /// interval](FastClock::set_resync_interval). Full resolution, but it
+    /// only follows changes to the wall clock, say by NTP, at each resync.
+    Calibrated,
+
+    /// A timestamp captured once per batch: The clock only reads the wall
+    /// clock when created and on each [`tick`](FastClock::tick), and returns
+    /// that same timestamp in between. Pair it with
+    /// [`set_strictly_increasing`](FastClock::set_strictly_increasing) to
+    /// tell each row apart.
+    Batch,
+}
+
+/// A source of designated timestamps for rows stamped client-side, cheaper to
+/// read than [`TimestampNanos::now`]. Pass it to
+/// [`Buffer::at_clock`](super::Buffer::at_clock).
+///
+/// The clock can be shared between threads.
+///
+/// ```
+/// # use questdb::Result;
+/// use questdb::ingress::{Buffer, ClockSource, FastClock};
+///
+/// # fn main() -> Result<()> {
+/// let mut clock = FastClock::new(ClockSource::Batch);
+/// clock.set_strictly_increasing(true);
+/// let mut buffer = Buffer::new();
+/// for price in [2615.54, 2615.55] {
+///     buffer
+///         .table("trades")?
+///         .column_f64("price", price)?
+///         .at_clock(&clock)?;
+/// }
+/// clock.tick();
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug)]
+pub struct FastClock {
+    source: ClockSource,
+    strictly_increasing: bool,
+    resync_interval: Duration,
+
+    /// The instant the elapsed times of the calibrated clock are measured from.
+    base: Instant,
+
+    /// With [`ClockSource::Calibrated`], the wall clock minus the elapsed
+    /// time at the last resync. With [`ClockSource::Batch`], the captured
+    /// timestamp.
+    offset: AtomicI64,
+
+    /// The elapsed time, in nanoseconds, after which the calibrated clock
+    /// resyncs next.
+    next_resync: AtomicU64,
+
+    /// The last timestamp returned, when strictly increasing.
+    last: AtomicI64,
+}
+
+impl FastClock {
+    /// Create a clock reading from the given source. It isn't strictly
+    /// increasing, and resyncs every second if calibrated.
+    pub fn new(source: ClockSource) -> Self {
+        let clock = Self {
+            source,
+            strictly_increasing: false,
+            resync_interval: Duration::from_secs(1),
+            base: Instant::now(),
+            offset: AtomicI64::new(0),
+            next_resync: AtomicU64::new(0),
+            last: AtomicI64::new(i64::MIN),
+        };
+        clock.tick();
+        clock
+    }
+
+    /// The source the clock reads from.
+    pub fn source(&self) -> ClockSource {
+        self.source
+    }
+
+    /// Make each timestamp at least one nanosecond later than the previous
+    /// one, so that rows read from a coarse or batch clock, or read across a
+    /// resync that set the clock back, still sort in the order they were
+    /// stamped. Off by default.
+    pub fn set_strictly_increasing(&mut self, enabled: bool) {
+        self.strictly_increasing = enabled;
+    }
+
+    /// How often a [`ClockSource::Calibrated`] clock resyncs with the wall
+    /// clock. The default is one second.
+    pub fn set_resync_interval(&mut self, interval: Duration) {
+        self.resync_interval = interval;
+        self.schedule_resync(self.elapsed_nanos());
+    }
+
+    /// Capture a new timestamp for a [`ClockSource::Batch`] clock, or resync a
+    /// [`ClockSource::Calibrated`] one right away. Does nothing for the other
+    /// sources.
+    pub fn tick(&self) {
+        match self.source {
+            ClockSource::Calibrated => self.resync(self.elapsed_nanos()),
+            ClockSource::Batch => self.offset.store(system_nanos(), Ordering::Relaxed),
+            ClockSource::System | ClockSource::Coarse => {}
+        }
+    }
+
+    /// The current timestamp.
+    #[inline]
+    pub fn now(&self) -> TimestampNanos {
+        let nanos = match self.source {
+            ClockSource::System => system_nanos(),
+            ClockSource::Coarse => coarse_nanos(),
+            ClockSource::Calibrated => {
+                let elapsed = self.elapsed_nanos();
+                if elapsed >= self.next_resync.load(Ordering::Relaxed) {
+                    self.resync(elapsed);
+                }
+                self.offset.load(Ordering::Relaxed) + elapsed as i64
+            }
+            ClockSource::Batch => self.offset.load(Ordering::Relaxed),
+        };
+        if !self.strictly_increasing {
+            return TimestampNanos::new(nanos);
+        }
+        let step = |last: i64| nanos.max(last.saturating_add(1));
+        let last = self
+            .last
+            .fetch_update(Ordering::Relaxed, Ordering::Relaxed, |last| {
+                Some(step(last))
+            })
+            .expect("the update always succeeds");
+        TimestampNanos::new(step(last))
+    }
+
+    fn elapsed_nanos(&self) -> u64 {
+        duration_nanos(self.base.elapsed()) as u64
+    }
+
+    fn resync(&self, elapsed: u64) {
+        self.offset
+            .store(system_nanos() - elapsed as i64, Ordering::Relaxed);
+        self.schedule_resync(elapsed);
+    }
+
+    fn schedule_resync(&self, elapsed: u64) {
+        let interval = duration_nanos(self.resync_interval) as u64;
+        self.next_resync
+            .store(elapsed.saturating_add(interval), Ordering::Relaxed);
+    }
+}
+
+/// The nanoseconds in `duration`, without going through `u128`.
+#[inline]
+fn duration_nanos(duration: Duration) -> i64 {
+    (duration.as_secs() as i64)
+        .saturating_mul(1_000_000_000)
+        .saturating_add(duration.subsec_nanos() as i64)
+}
+
+/// The wall clock, in nanoseconds since the UNIX epoch.
+#[inline]
+pub(super) fn system_nanos() -> i64 {
+    match SystemTime::now().duration_since(UNIX_EPOCH) {
+        Ok(since_epoch) => duration_nanos(since_epoch),
+        Err(before_epoch) => -duration_nanos(before_epoch.duration()),
+    }
+}
+
+#[cfg(target_os = "linux")]
+#[inline]
+fn coarse_nanos() -> i64 {
+    let mut ts = libc::timespec {
+        tv_sec: 0,
+        tv_nsec: 0,
+    };
+    // Can't fail: The clock ID is valid and `ts` is writable.
+    unsafe { libc::clock_gettime(libc::CLOCK_REALTIME_COARSE, &mut ts) };
+    (ts.tv_sec as i64) * 1_000_000_000 + ts.tv_nsec as i64
+}
+
+#[cfg(not(target_os = "linux"))]
+#[inline]
+fn coarse_nanos() -> i64 {
+    system_nanos()
+}
@@ -0,0 +1,288 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use crate::error::{self, Error, Result};
+
+use super::{
+    escaped_len_bound, escaped_unquoted, write_escaped_quoted, write_escaped_unquoted,
+    write_f64_decimals, write_timestamp, Buffer, ColumnName, Op, OpCase, TableName, MAX_F64_LEN,
+    MAX_I64_LEN,
+};
+
+/// The values of one column across a batch of rows.
+/// See [`Buffer::append_columns`].
+#[derive(Clone, Copy)]
+pub enum ColumnData<'a> {
+    /// Serialized as [`symbol`](Buffer::symbol) values.
+    Symbol(&'a [&'a str]),
+
+    /// Serialized as [`column_bool`](Buffer::column_bool) values.
+    Bool(&'a [bool]),
+
+    /// Serialized as [`column_i64`](Buffer::column_i64) values.
+    I64(&'a [i64]),
+
+    /// Serialized as [`column_f64`](Buffer::column_f64) values.
+    F64(&'a [f64]),
+
+    /// Serialized as [`column_str`](Buffer::column_str) values.
+    Str(&'a [&'a str]),
+
+    /// Serialized as [`column_ts`](Buffer::column_ts) values, in microseconds
+    /// since the Unix epoch.
+    TimestampMicros(&'a [i64]),
+}
+
+impl<'a> ColumnData<'a> {
+    fn len(&self) -> usize {
+        match self {
+            ColumnData::Symbol(values) => values.len(),
+            ColumnData::Bool(values) => values.len(),
+            ColumnData::I64(values) => values.len(),
+            ColumnData::F64(values) => values.len(),
+            ColumnData::Str(values) => values.len(),
+            ColumnData::TimestampMicros(values) => values.len(),
+        }
+    }
+
+    fn is_symbol(&self) -> bool {
+        matches!(self, ColumnData::Symbol(_))
+    }
+}
+
+/// A named column of values for [`Buffer::append_columns`].
+#[derive(Clone, Copy)]
+pub struct ColumnSlice<'a> {
+    name: ColumnName<'a>,
+    data: ColumnData<'a>,
+}
+
+impl<'a> ColumnSlice<'a> {
+    /// Pair a column name with its values.
+    pub fn new<N>(name: N, data: ColumnData<'a>) -> Result<Self>
+    where
+        N: TryInto<ColumnName<'a>>,
+        Error: From<N::Error>,
+    {
+        Ok(Self {
+            name: name.try_into()?,
+            data,
+        })
+    }
+}
+
+pub(super) fn column_key(sep: char, name: ColumnName<'_>) -> String {
+    let mut key = String::with_capacity(name.name.len() + 2);
+    key.push(sep);
+    match name.key {
+        Some(prepared) => key.push_str(&prepared[1..]),
+        None => {
+            key.push_str(&escaped_unquoted(name.name));
+            key.push('=');
+        }
+    }
+    key
+}
+
+/// A column's escaped key, values and fixed number of decimals, if any.
+type KeyedColumn<'a> = (String, ColumnData<'a>, Option<u8>);
+
+/// An upper bound on the length of a row of `append_columns`.
+fn row_len_bound(table_prefix: &str, keyed: &[KeyedColumn<'_>], row: usize) -> usize {
+    let values_len_bound: usize = keyed
+        .iter()
+        .map(|(key, data, _)| {
+            key.len()
+                + match data {
+                    ColumnData::Symbol(values) => escaped_len_bound(values[row]),
+                    ColumnData::Bool(_) => 1,
+                    ColumnData::I64(_) | ColumnData::TimestampMicros(_) => MAX_I64_LEN + 1,
+                    ColumnData::F64(_) => MAX_F64_LEN,
+                    ColumnData::Str(values) => escaped_len_bound(values[row]) + 2,
+                }
+        })
+        .sum();
+    table_prefix.len() + values_len_bound + MAX_I64_LEN + 2
+}
+
+impl Buffer {
+    /// Append a batch of rows for the given table, supplied column by column.
+    ///
+    /// Each entry of `columns` holds the values of one column for all rows, and
+    /// all of them must have the same length. Symbol columns are written before
+    /// the other columns, regardless of their position in `columns`.
+    ///
+    /// `timestamps` holds the designated timestamp of each row, in nanoseconds
+    /// since the Unix epoch, written in the buffer's
+    /// [precision](Buffer::timestamp_precision). Pass `None` to let the server
+    /// assign them, as with [`at_now`](Buffer::at_now).
+    ///
+    /// The table name, the column names and the timestamps are validated once
+    /// for the whole batch. If validation fails, the buffer is left unchanged.
+    ///
+    /// ```
+    /// # use questdb::Result;
+    /// use questdb::ingress::{Buffer, ColumnData, ColumnSlice};
+    ///
+    /// # fn main() -> Result<()> {
+    /// let mut buffer = Buffer::new();
+    /// let symbols = ["ETH-USD", "BTC-USD"];
+    /// let prices = [2615.54, 39269.98];
+    /// let timestamps = [1659548315647406592, 1659548315647406593];
+    /// buffer.append_columns(
+    ///     "trades",
+    ///     &[
+    ///         ColumnSlice::new("symbol", ColumnData::Symbol(&symbols))?,
+    ///         ColumnSlice::new("price", ColumnData::F64(&prices))?,
+    ///     ],
+    ///     Some(&timestamps),
+    /// )?;
+    /// assert_eq!(buffer.row_count(), 2);
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn append_columns<'a, N>(
+        &mut self,
+        table: N,
+        columns: &[ColumnSlice<'_>],
+        timestamps: Option<&[i64]>,
+    ) -> Result<&mut Self>
+    where
+        N: TryInto<TableName<'a>>,
+        Error: From<N::Error>,
+    {
+        let table: TableName<'a> = table.try_into()?;
+        self.validate_max_name_len(table.name)?;
+        self.check_op(Op::Table)?;
+
+        let Some(first) = columns.first() else {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `append_columns`: At least one column is required."
+            ));
+        };
+        let row_count = first.data.len();
+        for column in columns {
+            self.validate_max_name_len(column.name.name)?;
+            if column.data.len() != row_count {
+                return Err(error::fmt!(
+                    InvalidApiCall,
+                    "Bad call to `append_columns`: Column {:?} has {} values, expected {}.",
+                    column.name.name,
+                    column.data.len(),
+                    row_count
+                ));
+            }
+        }
+        if let Some(timestamps) = timestamps {
+            if timestamps.len() != row_count {
+                return Err(error::fmt!(
+                    InvalidApiCall,
+                    "Bad call to `append_columns`: {} timestamps supplied, expected {}.",
+                    timestamps.len(),
+                    row_count
+                ));
+            }
+            if let Some(&epoch_nanos) = timestamps.iter().find(|&&ts| ts < 0) {
+                return Err(error::fmt!(
+                    InvalidTimestamp,
+                    "Timestamp {} is negative. It must be >= 0.",
+                    epoch_nanos
+                ));
+            }
+        }
+        if row_count == 0 {
+            return Ok(self);
+        }
+
+        // Escape the table name and the column keys once for the whole batch.
+        let table_prefix = escaped_unquoted(table.name);
+        let mut keyed: Vec<KeyedColumn<'_>> = Vec::with_capacity(columns.len());
+        for column in columns.iter().filter(|c| c.data.is_symbol()) {
+            keyed.push((column_key(',', column.name), column.data, None));
+        }
+        for (index, column) in columns.iter().filter(|c| !c.data.is_symbol()).enumerate() {
+            let sep = if index == 0 { ' ' } else { ',' };
+            keyed.push((
+                column_key(sep, column.name),
+                column.data,
+                column.name.decimals,
+            ));
+        }
+
+        let batch_start = self.output.len();
+        let mut int_buf = itoa::Buffer::new();
+        for row in 0..row_count {
+            if self.fixed_capacity.is_some() {
+                let len_bound = row_len_bound(&table_prefix, &keyed, row);
+                if let Err(err) = self.check_capacity(len_bound) {
+                    self.output.truncate(batch_start);
+                    self.row_ends.truncate(self.state.row_count);
+                    return Err(err);
+                }
+            }
+            self.output.extend_from_slice(table_prefix.as_bytes());
+            for (key, data, decimals) in keyed.iter() {
+                self.output.extend_from_slice(key.as_bytes());
+                match data {
+                    ColumnData::Symbol(values) => {
+                        write_escaped_unquoted(&mut self.output, values[row])
+                    }
+                    ColumnData::Bool(values) => {
+                        self.output.push(if values[row] { b't' } else { b'f' })
+                    }
+                    ColumnData::I64(values) => {
+                        self.output
+                            .extend_from_slice(int_buf.format(values[row]).as_bytes());
+                        self.output.push(b'i');
+                    }
+                    ColumnData::F64(values) => write_f64_decimals(
+                        &mut self.output,
+                        self.protocol_version,
+                        values[row],
+                        *decimals,
+                    ),
+                    ColumnData::Str(values) => write_escaped_quoted(&mut self.output, values[row]),
+                    ColumnData::TimestampMicros(values) => {
+                        write_timestamp(&mut self.output, values[row]);
+                        self.output.push(b't');
+                    }
+                }
+            }
+            if let Some(timestamps) = timestamps {
+                self.output.push(b' ');
+                let epoch = self.ts_precision.from_nanos(timestamps[row]);
+                self.ts_cache.write(&mut self.output, epoch);
+            }
+            self.output.push(b'\n');
+            self.row_ends.push(self.output.len());
+        }
+
+        // A buffer stops being transactional if it targets multiple tables.
+        self.track_table(batch_start, table_prefix.len());
+        self.state.op_case = OpCase::MayFlushOrTable;
+        self.state.row_count += row_count;
+        Ok(self)
+    }
+}
@@ -0,0 +1,345 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::ops::{Deref, DerefMut};
+use std::sync::mpsc::{self, Receiver, SyncSender};
+use std::sync::Arc;
+use std::thread::JoinHandle;
+
+use crate::error::{self, Error, Result};
+
+use super::background::{io_thread_exited, Completion};
+use super::{
+    map_io_to_socket_err, Buffer, BufferPool, FlushHandle, Op, ProtocolVersion, Sender,
+    TimestampPrecision,
+};
+
+/// The capacity lane buffers are shrunk back to by the pool that
+/// [`Sender::into_concurrent`] creates.
+const LANE_BUFFER_CAPACITY: usize = 1024 * 1024;
+
+struct Commit {
+    buf: Buffer,
+    completion: Completion,
+}
+
+enum Message {
+    Commit(Commit),
+    Close,
+}
+
+/// Lets many threads ingest through a single connection.
+///
+/// Each producer thread takes a [`Lane`] of its own with
+/// [`lane`](ConcurrentSender::lane) and appends rows to it as to any other
+/// [`Buffer`]: No lock is taken and nothing is shared whilst filling it.
+/// Calling [`Lane::commit`] hands the lane's rows over to the flusher thread,
+/// which owns the [`Sender`].
+///
+/// The flusher gathers all the lanes committed whilst the previous request was
+/// in flight into the next one, up to the sender's `max_buf_size`. Under load,
+/// requests therefore grow large rather than numerous: A group commit for ILP.
+/// All the lanes gathered into a request share its outcome.
+///
+/// Rows of different lanes are sent in the order the lanes were committed, but
+/// may target different tables: Group requests are never transactional.
+///
+/// ```no_run
+/// # use questdb::Result;
+/// use questdb::ingress::{Sender, TimestampNanos};
+///
+/// # fn main() -> Result<()> {
+/// let sender = Sender::from_conf("http::addr=localhost:9000;")?;
+/// let sender = sender.into_concurrent(16)?;
+/// std::thread::scope(|scope| {
+///     for thread in 0..8 {
+///         let mut lane = sender.lane();
+///         scope.spawn(move || -> Result<()> {
+///             for _ in 0..1000 {
+///                 lane.table("trades")?
+///                     .symbol("symbol", "ETH-USD")?
+///                     .column_i64("thread", thread)?
+///                     .at(TimestampNanos::now())?;
+///             }
+///             lane.commit()?.wait()
+///         });
+///     }
+/// });
+/// sender.close();
+/// # Ok(())
+/// # }
+/// ```
+///
+/// Threads that already manage buffers of their own can hand them over with
+/// [`commit`](ConcurrentSender::commit) instead: The `ConcurrentSender` is
+/// `Sync`, so it can be shared by reference.
+pub struct ConcurrentSender {
+    committer: Committer,
+    flusher: Option<JoinHandle<()>>,
+}
+
+/// Queues committed rows for the flusher. Shared by the sender and its lanes.
+#[derive(Clone)]
+struct Committer {
+    messages: SyncSender<Message>,
+    buffers: Arc<BufferPool>,
+    protocol_version: ProtocolVersion,
+    ts_precision: TimestampPrecision,
+}
+
+impl Committer {
+    fn new_buffer(&self) -> Buffer {
+        let mut buf = self.buffers.acquire();
+        buf.protocol_version = self.protocol_version;
+        buf.ts_precision = self.ts_precision;
+        buf
+    }
+
+    fn commit(&self, buf: &mut Buffer) -> Result<FlushHandle> {
+        buf.check_op(Op::Flush)?;
+        let rows = std::mem::replace(buf, self.new_buffer());
+        let (completion, handle) = Completion::handle();
+        let commit = Commit {
+            buf: rows,
+            completion,
+        };
+        if let Err(mpsc::SendError(Message::Commit(commit))) =
+            self.messages.send(Message::Commit(commit))
+        {
+            // Give the rows back to the caller rather than losing them.
+            self.buffers.release(std::mem::replace(buf, commit.buf));
+            return Err(io_thread_exited());
+        }
+        Ok(handle)
+    }
+}
+
+impl ConcurrentSender {
+    pub(crate) fn new(
+        sender: Sender,
+        queue_depth: usize,
+        buffers: Option<Arc<BufferPool>>,
+    ) -> Result<Self> {
+        if queue_depth == 0 {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "The commit queue depth of a concurrent sender must be at least 1."
+            ));
+        }
+        let buffers =
+            buffers.unwrap_or_else(|| Arc::new(BufferPool::new(LANE_BUFFER_CAPACITY, queue_depth)));
+        let protocol_version = sender.protocol_version;
+        let ts_precision = sender.ts_precision;
+        let (messages_tx, messages_rx) = mpsc::sync_channel::<Message>(queue_depth);
+        let flusher_buffers = buffers.clone();
+        let flusher = std::thread::Builder::new()
+            .name("questdb-group-commit".to_owned())
+            .spawn(move || run_flusher(sender, messages_rx, flusher_buffers))
+            .map_err(|io_err| map_io_to_socket_err("Could not start flusher thread: ", io_err))?;
+        Ok(Self {
+            committer: Committer {
+                messages: messages_tx,
+                buffers,
+                protocol_version,
+                ts_precision,
+            },
+            flusher: Some(flusher),
+        })
+    }
+
+    /// Create a lane for a producer thread to append rows to.
+    ///
+    /// Lanes are cheap: Take one per thread and keep it for as long as the
+    /// thread produces rows.
+    pub fn lane(&self) -> Lane {
+        Lane {
+            buf: self.committer.new_buffer(),
+            committer: self.committer.clone(),
+        }
+    }
+
+    /// Hand the buffer's rows over to the flusher thread, like
+    /// [`Lane::commit`], and replace them with an empty buffer.
+    ///
+    /// The replacement has the sender's protocol version and timestamp
+    /// precision, and is drawn from
+    /// its buffer pool, which the committed buffer is released to once sent.
+    pub fn commit(&self, buf: &mut Buffer) -> Result<FlushHandle> {
+        self.committer.commit(buf)
+    }
+
+    /// Send all the lanes committed so far, then stop the flusher thread and
+    /// close the connection. Lanes committed after this fail.
+    ///
+    /// This is also done implicitly when the `ConcurrentSender` is dropped.
+    pub fn close(mut self) {
+        self.shutdown();
+    }
+
+    fn shutdown(&mut self) {
+        if let Some(flusher) = self.flusher.take() {
+            // The flusher may already have exited if it panicked.
+            let _ = self.committer.messages.send(Message::Close);
+            let _ = flusher.join();
+        }
+    }
+}
+
+impl Drop for ConcurrentSender {
+    fn drop(&mut self) {
+        self.shutdown();
+    }
+}
+
+impl std::fmt::Debug for ConcurrentSender {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
+        f.write_str("ConcurrentSender")
+    }
+}
+
+/// A producer's private buffer, obtained from [`ConcurrentSender::lane`].
+///
+/// Dereferences to a [`Buffer`]: Append rows to it directly, then call
+/// [`commit`](Lane::commit) to have them sent. A lane dropped with rows that
+/// weren't committed discards them.
+pub struct Lane {
+    buf: Buffer,
+    committer: Committer,
+}
+
+impl Lane {
+    /// Hand the lane's rows over to the flusher thread, to be sent with those of
+    /// the other lanes in the next request, and start afresh with an empty
+    /// buffer.
+    ///
+    /// Returns as soon as the rows are queued. If the flusher has fallen behind
+    /// by the full queue depth, this blocks until it catches up. Use the
+    /// returned [`FlushHandle`] to find out once the rows are sent and whether
+    /// that succeeded.
+    ///
+    /// A lane with an incomplete row is rejected without being queued.
+    pub fn commit(&mut self) -> Result<FlushHandle> {
+        self.committer.commit(&mut self.buf)
+    }
+}
+
+impl Deref for Lane {
+    type Target = Buffer;
+
+    fn deref(&self) -> &Buffer {
+        &self.buf
+    }
+}
+
+impl DerefMut for Lane {
+    fn deref_mut(&mut self) -> &mut Buffer {
+        &mut self.buf
+    }
+}
+
+impl Drop for Lane {
+    fn drop(&mut self) {
+        self.committer
+            .buffers
+            .release(std::mem::take(&mut self.buf));
+    }
+}
+
+impl std::fmt::Debug for Lane {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
+        write!(f, "Lane[rows={}]", self.buf.row_count())
+    }
+}
+
+/// A lane gathered into the request being built, by its rows within it.
+struct Grouped {
+    first_row: usize,
+    rows: usize,
+    completion: Completion,
+}
+
+/// The error of a request, as reported to one of the lanes in it: The failed
+/// row, if any, is only reported to its own lane and relative to it.
+fn lane_error(err: &Error, lane: &Grouped) -> Error {
+    let failed_row = err
+        .failed_row()
+        .filter(|row| (lane.first_row..lane.first_row + lane.rows).contains(row))
+        .map(|row| row - lane.first_row);
+    Error::new(err.code(), err.msg()).with_failed_row(failed_row)
+}
+
+fn run_flusher(mut sender: Sender, messages: Receiver<Message>, buffers: Arc<BufferPool>) {
+    let mut batch = sender.new_buffer();
+    let mut group: Vec<Grouped> = Vec::new();
+    let mut held: Option<Commit> = None;
+    let mut closing = false;
+    while !closing {
+        // Block for the first commit, then take whatever else is queued.
+        let mut next = match held.take() {
+            Some(commit) => Some(commit),
+            None => match messages.recv() {
+                Ok(Message::Commit(commit)) => Some(commit),
+                Ok(Message::Close) | Err(_) => break,
+            },
+        };
+        while let Some(commit) = next.take() {
+            if !batch.is_empty() && batch.len() + commit.buf.len() > sender.max_buf_size {
+                held = Some(commit);
+                break;
+            }
+            let Commit { buf, completion } = commit;
+            let first_row = batch.row_count();
+            match batch.append_buffer(&buf) {
+                Ok(()) => group.push(Grouped {
+                    first_row,
+                    rows: buf.row_count(),
+                    completion,
+                }),
+                Err(err) => completion.complete(Err(err)),
+            }
+            buffers.release(buf);
+            next = match messages.try_recv() {
+                Ok(Message::Commit(commit)) => Some(commit),
+                Ok(Message::Close) => {
+                    closing = true;
+                    None
+                }
+                Err(_) => None,
+            };
+        }
+
+        if group.is_empty() {
+            continue;
+        }
+        let result = sender.flush_impl(&batch, false);
+        batch.clear();
+        for lane in group.drain(..) {
+            let lane_result = match &result {
+                Ok(()) => Ok(()),
+                Err(err) => Err(lane_error(err, &lane)),
+            };
+            lane.completion.complete(lane_result);
+        }
+    }
+}
@@ -0,0 +1,186 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+const fn digit_pairs() -> [u8; 200] {
+    let mut pairs = [0u8; 200];
+    let mut n = 0;
+    while n < 100 {
+        pairs[n * 2] = b'0' + (n / 10) as u8;
+        pairs[n * 2 + 1] = b'0' + (n % 10) as u8;
+        n += 1;
+    }
+    pairs
+}
+
+/// The two ASCII digits of each number in `0..100`.
+static DIGIT_PAIRS: [u8; 200] = digit_pairs();
+
+#[inline(always)]
+fn write_pair(buf: &mut [u8], n: u32) {
+    let index = n as usize * 2;
+    buf[..2].copy_from_slice(&DIGIT_PAIRS[index..index + 2]);
+}
+
+/// Write `n < 10^8` as exactly 8 zero-padded digits.
+#[inline(always)]
+fn write_8_digits(buf: &mut [u8], n: u32) {
+    let high = n / 10000;
+    let low = n % 10000;
+    write_pair(&mut buf[0..2], high / 100);
+    write_pair(&mut buf[2..4], high % 100);
+    write_pair(&mut buf[4..6], low / 100);
+    write_pair(&mut buf[6..8], low % 100);
+}
+
+const E8: u64 = 100_000_000;
+const E15: i64 = 1_000_000_000_000_000;
+const E16: u64 = 10_000_000_000_000_000;
+const E17: u64 = 100_000_000_000_000_000;
+const E18: u64 = 1_000_000_000_000_000_000;
+
+/// Append the decimal representation of `value`.
+///
+/// Epoch timestamps in micros or nanos almost always have 16 to 19 digits.
+/// These are split into fixed-size groups of digits and formatted without
+/// branching on their length. Other values go through `itoa`.
+#[inline]
+pub(super) fn write_timestamp(output: &mut Vec<u8>, value: i64) {
+    if value < E15 {
+        let mut buf = itoa::Buffer::new();
+        output.extend_from_slice(buf.format(value).as_bytes());
+        return;
+    }
+    let value = value as u64;
+    let len = 16 + (value >= E16) as usize + (value >= E17) as usize + (value >= E18) as usize;
+    let top = (value / E16) as u32;
+    let rest = value % E16;
+    let mut buf = [0u8; 20];
+    write_pair(&mut buf[0..2], top / 100);
+    write_pair(&mut buf[2..4], top % 100);
+    write_8_digits(&mut buf[4..12], (rest / E8) as u32);
+    write_8_digits(&mut buf[12..20], (rest % E8) as u32);
+    output.extend_from_slice(&buf[20 - len..]);
+}
+
+/// Remembers the leading digits of the last timestamp written, so that a
+/// following timestamp sharing them only needs its last 8 digits formatted.
+///
+/// For nanosecond timestamps, that's any two timestamps less than 100ms apart
+/// that don't straddle a multiple of 100ms.
+#[derive(Debug, Clone)]
+pub(super) struct TimestampCache {
+    /// `value / 10^8` of the cached timestamp, or `u64::MAX` if none is.
+    high: u64,
+    prefix: [u8; 11],
+    prefix_len: usize,
+}
+
+impl TimestampCache {
+    pub(super) fn new() -> Self {
+        Self {
+            high: u64::MAX,
+            prefix: [0u8; 11],
+            prefix_len: 0,
+        }
+    }
+
+    /// Append the decimal representation of `value`, updating the cache.
+    #[inline]
+    pub(super) fn write(&mut self, output: &mut Vec<u8>, value: i64) {
+        if value < E8 as i64 {
+            write_timestamp(output, value);
+            return;
+        }
+        let value = value as u64;
+        let high = value / E8;
+        if high != self.high {
+            // Below 2^63, `high` has at most 11 digits.
+            let mut buf = itoa::Buffer::new();
+            let printed = buf.format(high).as_bytes();
+            self.prefix[..printed.len()].copy_from_slice(printed);
+            self.prefix_len = printed.len();
+            self.high = high;
+        }
+        let mut digits = [0u8; 19];
+        let prefix_len = self.prefix_len;
+        digits[..prefix_len].copy_from_slice(&self.prefix[..prefix_len]);
+        write_8_digits(&mut digits[prefix_len..prefix_len + 8], (value % E8) as u32);
+        output.extend_from_slice(&digits[..prefix_len + 8]);
+    }
+}
+
+/// The most decimals [`write_fixed`] accepts.
+pub(super) const MAX_DECIMALS: u8 = 15;
+
+const fn pow10s() -> [u64; MAX_DECIMALS as usize + 1] {
+    let mut pows = [1u64; MAX_DECIMALS as usize + 1];
+    let mut n = 1;
+    while n < pows.len() {
+        pows[n] = pows[n - 1] * 10;
+        n += 1;
+    }
+    pows
+}
+
+static POW10: [u64; MAX_DECIMALS as usize + 1] = pow10s();
+
+/// Every integer up to this magnitude is exactly representable as an `f64`.
+const MAX_EXACT: f64 = (1u64 << 53) as f64;
+
+/// Append `value` rounded to `decimals` places, without trailing zeros, e.g.
+/// `101.25` for `101.25000000000001` at 8 decimals.
+///
+/// The value is scaled to an integer and formatted with `itoa`, which is
+/// faster than finding the shortest round-trip representation. Returns
+/// `false`, without writing anything, if the scaled value isn't finite or no
+/// longer exact, i.e. above 2^53: Format those with `ryu` instead.
+#[inline]
+pub(super) fn write_fixed(output: &mut Vec<u8>, value: f64, decimals: u8) -> bool {
+    debug_assert!(decimals <= MAX_DECIMALS);
+    let pow = POW10[decimals as usize];
+    let scaled = (value * pow as f64).round();
+    if !(scaled.abs() <= MAX_EXACT) {
+        return false;
+    }
+    let scaled = scaled as i64;
+    if scaled < 0 {
+        output.push(b'-');
+    }
+    let magnitude = scaled.unsigned_abs();
+    let mut buf = itoa::Buffer::new();
+    output.extend_from_slice(buf.format(magnitude / pow).as_bytes());
+    let mut fraction = magnitude % pow;
+    if fraction != 0 {
+        let mut digits = decimals as usize;
+        while fraction % 10 == 0 {
+            fraction /= 10;
+            digits -= 1;
+        }
+        let printed = buf.format(fraction).as_bytes();
+        output.push(b'.');
+        output.resize(output.len() + digits - printed.len(), b'0');
+        output.extend_from_slice(printed);
+    }
+    true
+}
@@ -0,0 +1,160 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/// Bytes escaped in table names, column names and symbol values.
+pub(crate) const UNQUOTED: &[u8] = b" ,=\n\r\\";
+
+/// Bytes escaped in string column values.
+pub(crate) const QUOTED: &[u8] = b"\n\r\"\\";
+
+/// Find the index of the first byte in `bytes` that is one of `needles`.
+///
+/// The vectorized paths compare 16 (SSE2, NEON) or 32 (AVX2) bytes at a time
+/// against each needle. AVX2 is detected at runtime. Other targets, and inputs
+/// shorter than a vector, use the scalar path.
+#[inline]
+pub(crate) fn find_escape(needles: &'static [u8], bytes: &[u8]) -> Option<usize> {
+    #[cfg(target_arch = "x86_64")]
+    {
+        if bytes.len() >= 32 && std::arch::is_x86_feature_detected!("avx2") {
+            return unsafe { x86::find_avx2(needles, bytes) };
+        }
+        if bytes.len() >= 16 {
+            return unsafe { x86::find_sse2(needles, bytes) };
+        }
+    }
+
+    #[cfg(target_arch = "aarch64")]
+    {
+        if bytes.len() >= 16 {
+            return unsafe { neon::find_neon(needles, bytes) };
+        }
+    }
+
+    find_scalar(needles, bytes)
+}
+
+#[inline]
+pub(crate) fn find_scalar(needles: &[u8], bytes: &[u8]) -> Option<usize> {
+    bytes.iter().position(|b| needles.contains(b))
+}
+
+#[cfg(target_arch = "x86_64")]
+mod x86 {
+    use std::arch::x86_64::*;
+
+    use super::find_scalar;
+
+    const MAX_NEEDLES: usize = 8;
+
+    #[target_feature(enable = "sse2")]
+    pub(super) unsafe fn find_sse2(needles: &[u8], bytes: &[u8]) -> Option<usize> {
+        debug_assert!(needles.len() <= MAX_NEEDLES);
+        let mut splats = [_mm_setzero_si128(); MAX_NEEDLES];
+        for (splat, &needle) in splats.iter_mut().zip(needles) {
+            *splat = _mm_set1_epi8(needle as i8);
+        }
+        let splats = &splats[..needles.len()];
+
+        let mut index = 0;
+        while index + 16 <= bytes.len() {
+            let chunk = _mm_loadu_si128(bytes.as_ptr().add(index) as *const __m128i);
+            let mut hits = _mm_setzero_si128();
+            for splat in splats {
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, *splat));
+            }
+            let mask = _mm_movemask_epi8(hits) as u32;
+            if mask != 0 {
+                return Some(index + mask.trailing_zeros() as usize);
+            }
+            index += 16;
+        }
+        find_scalar(needles, &bytes[index..]).map(|found| index + found)
+    }
+
+    #[target_feature(enable = "avx2")]
+    pub(super) unsafe fn find_avx2(needles: &[u8], bytes: &[u8]) -> Option<usize> {
+        debug_assert!(needles.len() <= MAX_NEEDLES);
+        let mut splats = [_mm256_setzero_si256(); MAX_NEEDLES];
+        for (splat, &needle) in splats.iter_mut().zip(needles) {
+            *splat = _mm256_set1_epi8(needle as i8);
+        }
+        let splats = &splats[..needles.len()];
+
+        let mut index = 0;
+        while index + 32 <= bytes.len() {
+            let chunk = _mm256_loadu_si256(bytes.as_ptr().add(index) as *const __m256i);
+            let mut hits = _mm256_setzero_si256();
+            for splat in splats {
+                hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, *splat));
+            }
+            let mask = _mm256_movemask_epi8(hits) as u32;
+            if mask != 0 {
+                return Some(index + mask.trailing_zeros() as usize);
+            }
+            index += 32;
+        }
+        if index == bytes.len() {
+            None
+        } else if bytes.len() - index >= 16 {
+            find_sse2(needles, &bytes[index..]).map(|found| index + found)
+        } else {
+            find_scalar(needles, &bytes[index..]).map(|found| index + found)
+        }
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+mod neon {
+    use std::arch::aarch64::*;
+
+    use super::find_scalar;
+
+    const MAX_NEEDLES: usize = 8;
+
+    #[target_feature(enable = "neon")]
+    pub(super) unsafe fn find_neon(needles: &[u8], bytes: &[u8]) -> Option<usize> {
+        debug_assert!(needles.len() <= MAX_NEEDLES);
+        let mut splats = [vdupq_n_u8(0); MAX_NEEDLES];
+        for (splat, &needle) in splats.iter_mut().zip(needles) {
+            *splat = vdupq_n_u8(needle);
+        }
+        let splats = &splats[..needles.len()];
+
+        let mut index = 0;
+        while index + 16 <= bytes.len() {
+            let chunk = vld1q_u8(bytes.as_ptr().add(index));
+            let mut hits = vdupq_n_u8(0);
+            for splat in splats {
+                hits = vorrq_u8(hits, vceqq_u8(chunk, *splat));
+            }
+            if vmaxvq_u8(hits) != 0 {
+                // The chunk holds a match: Locate it within the 16 bytes.
+                return find_scalar(needles, &bytes[index..index + 16]).map(|found| index + found);
+            }
+            index += 16;
+        }
+        find_scalar(needles, &bytes[index..]).map(|found| index + found)
+    }
+}
@@ -0,0 +1,111 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::sync::mpsc::{self, RecvTimeoutError};
+use std::time::Duration;
+
+use socket2::{SockAddr, Socket};
+
+use super::map_io_to_socket_err;
+use crate::error::{self, Result};
+
+/// The delay before racing the next address, as recommended by RFC 8305.
+const CONNECTION_ATTEMPT_DELAY: Duration = Duration::from_millis(250);
+
+/// Connect to whichever of `addrs` accepts first, opening each socket with
+/// `open`.
+///
+/// Each attempt starts [`CONNECTION_ATTEMPT_DELAY`] after the previous one,
+/// or as soon as the previous one fails, and runs on a thread of its own.
+/// Attempts still in flight when one succeeds are abandoned.
+pub(super) fn connect_first<F>(host_port: &str, addrs: &[SockAddr], open: F) -> Result<Socket>
+where
+    F: Fn(&SockAddr) -> Result<Socket>,
+{
+    let connect_err = |io_err| {
+        let prefix = format!("Could not connect to {:?}: ", host_port);
+        map_io_to_socket_err(&prefix, io_err)
+    };
+
+    if let [addr] = addrs {
+        let sock = open(addr)?;
+        sock.connect(addr).map_err(connect_err)?;
+        return Ok(sock);
+    }
+
+    let (tx, rx) = mpsc::channel::<std::io::Result<Socket>>();
+    let mut next = 0;
+    let mut pending = 0;
+    let mut last_err = None;
+    loop {
+        if let Some(addr) = addrs.get(next) {
+            next += 1;
+            let sock = match open(addr) {
+                Ok(sock) => sock,
+                Err(err) => {
+                    last_err = Some(err);
+                    continue;
+                }
+            };
+            let tx = tx.clone();
+            let addr = addr.clone();
+            let spawned = std::thread::Builder::new()
+                .name("questdb-connect".to_owned())
+                .spawn(move || {
+                    let res = sock.connect(&addr).map(|()| sock);
+                    // The receiver is gone if another attempt won the race.
+                    let _ = tx.send(res);
+                });
+            match spawned {
+                Ok(_) => pending += 1,
+                Err(io_err) => last_err = Some(connect_err(io_err)),
+            }
+        } else if pending == 0 {
+            return Err(last_err.unwrap_or_else(|| {
+                error::fmt!(
+                    CouldNotResolveAddr,
+                    "Could not connect to {:?}: No usable addresses",
+                    host_port
+                )
+            }));
+        }
+
+        let res = if pending == 0 {
+            continue;
+        } else if next < addrs.len() {
+            match rx.recv_timeout(CONNECTION_ATTEMPT_DELAY) {
+                Ok(res) => res,
+                Err(RecvTimeoutError::Timeout) => continue,
+                Err(RecvTimeoutError::Disconnected) => unreachable!("sender held locally"),
+            }
+        } else {
+            rx.recv().expect("sender held locally")
+        };
+        pending -= 1;
+        match res {
+            Ok(sock) => return Ok(sock),
+            Err(io_err) => last_err = Some(connect_err(io_err)),
+        }
+    }
+}
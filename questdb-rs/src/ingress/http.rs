@@ -3,10 +3,17 @@ use base64ct::Base64;
 use base64ct::Encoding;
 use rand::Rng;
 use std::fmt::Write;
+use std::path::PathBuf;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
 use std::thread::sleep;
-use std::time::Duration;
+use std::time::{Duration, Instant};
 
 use super::conf::ConfigSetting;
+use super::spool::Spool;
+use super::stats::StatsRecorder;
+use super::trace::{FlushSpan, FlushSpanKind, Tracer};
+use super::{ProtocolVersion, TimestampPrecision};
 
 #[derive(PartialEq, Debug, Clone)]
 pub(super) struct BasicAuthParams {
@@ -39,12 +46,74 @@ impl TokenAuthParams {
     }
 }
 
+/// How the interval between the retries of a failed ILP-over-HTTP request
+/// grows. The intervals start at 10 milliseconds and are capped at 1 second.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum RetryBackoff {
+    /// Double the interval after each attempt, with a jitter of ±5
+    /// milliseconds.
+    Exponential,
+
+    /// Wait a random interval, between zero and the doubling interval of
+    /// `Exponential`. This spreads out the retries of many clients that
+    /// failed at the same time.
+    FullJitter,
+
+    /// Wait a random interval between the initial interval and three times
+    /// the previous one.
+    Decorrelated,
+}
+
+/// Compression of the body of ILP-over-HTTP requests.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Compression {
+    /// Send the ILP text uncompressed.
+    None,
+
+    /// Compress with gzip, sent as `Content-Encoding: gzip`.
+    #[cfg(feature = "compression-gzip")]
+    Gzip,
+
+    /// Compress with Zstandard, sent as `Content-Encoding: zstd`.
+    #[cfg(feature = "compression-zstd")]
+    Zstd,
+}
+
 #[derive(Debug, Clone)]
 pub(super) struct HttpConfig {
     pub(super) request_min_throughput: ConfigSetting<u64>,
     pub(super) user_agent: String,
     pub(super) retry_timeout: ConfigSetting<Duration>,
     pub(super) request_timeout: ConfigSetting<Duration>,
+    pub(super) compression: ConfigSetting<Compression>,
+    pub(super) spool_dir: ConfigSetting<Option<PathBuf>>,
+    pub(super) spool_max_bytes: ConfigSetting<u64>,
+    pub(super) retry_backoff: ConfigSetting<RetryBackoff>,
+    pub(super) retry_after: ConfigSetting<bool>,
+    pub(super) retry_budget: ConfigSetting<u32>,
+    pub(super) circuit_breaker_threshold: ConfigSetting<u32>,
+    pub(super) circuit_breaker_cooldown: ConfigSetting<Duration>,
+    pub(super) prewarm: ConfigSetting<bool>,
+    pub(super) ping_interval: ConfigSetting<Option<Duration>>,
+    pub(super) stream_replay_window: ConfigSetting<usize>,
+
+    #[cfg(feature = "ilp-over-http2")]
+    pub(super) http2: ConfigSetting<bool>,
+}
+
+impl HttpConfig {
+    /// The timeout for a request with a body of `body_len` bytes: The
+    /// `request_timeout`, plus the time to send the body at the
+    /// `request_min_throughput`.
+    pub(super) fn request_timeout_for(&self, body_len: usize) -> Duration {
+        let request_min_throughput = *self.request_min_throughput;
+        let extra_time = if request_min_throughput > 0 {
+            (body_len as f64) / (request_min_throughput as f64)
+        } else {
+            0.0f64
+        };
+        *self.request_timeout + Duration::from_secs_f64(extra_time)
+    }
 }
 
 impl Default for HttpConfig {
@@ -54,6 +123,125 @@ impl Default for HttpConfig {
             user_agent: concat!("questdb/rust/", env!("CARGO_PKG_VERSION")).to_string(),
             retry_timeout: ConfigSetting::new_default(Duration::from_secs(10)),
             request_timeout: ConfigSetting::new_default(Duration::from_secs(10)),
+            compression: ConfigSetting::new_default(Compression::None),
+            spool_dir: ConfigSetting::new_default(None),
+            spool_max_bytes: ConfigSetting::new_default(1024 * 1024 * 1024), // 1 GiB
+            retry_backoff: ConfigSetting::new_default(RetryBackoff::Exponential),
+            retry_after: ConfigSetting::new_default(true),
+            retry_budget: ConfigSetting::new_default(0),
+            circuit_breaker_threshold: ConfigSetting::new_default(0),
+            circuit_breaker_cooldown: ConfigSetting::new_default(Duration::from_secs(5)),
+            prewarm: ConfigSetting::new_default(false),
+            ping_interval: ConfigSetting::new_default(Some(Duration::from_secs(10))),
+            stream_replay_window: ConfigSetting::new_default(16 * 1024 * 1024), // 16 MiB
+
+            #[cfg(feature = "ilp-over-http2")]
+            http2: ConfigSetting::new_default(false),
+        }
+    }
+}
+
+/// Compresses request bodies, reusing the compression context and the output
+/// buffer across flushes.
+pub(super) enum BodyEncoder {
+    Identity,
+
+    #[cfg(feature = "compression-gzip")]
+    Gzip {
+        deflate: flate2::Compress,
+        output: Vec<u8>,
+    },
+
+    #[cfg(feature = "compression-zstd")]
+    Zstd {
+        cctx: zstd::bulk::Compressor<'static>,
+        output: Vec<u8>,
+    },
+}
+
+/// Fixed gzip member header: No flags, no modification time, unknown OS.
+#[cfg(feature = "compression-gzip")]
+const GZIP_HEADER: [u8; 10] = [0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff];
+
+fn compress_err(msg: &dyn std::fmt::Display) -> Error {
+    error::fmt!(
+        SocketError,
+        "Could not flush buffer: Failed to compress the request body: {}",
+        msg
+    )
+}
+
+impl BodyEncoder {
+    pub(super) fn new(compression: Compression) -> crate::Result<Self> {
+        Ok(match compression {
+            Compression::None => BodyEncoder::Identity,
+
+            #[cfg(feature = "compression-gzip")]
+            Compression::Gzip => BodyEncoder::Gzip {
+                // Raw deflate: The gzip framing is written by `encode`.
+                deflate: flate2::Compress::new(flate2::Compression::default(), false),
+                output: Vec::new(),
+            },
+
+            #[cfg(feature = "compression-zstd")]
+            Compression::Zstd => BodyEncoder::Zstd {
+                cctx: zstd::bulk::Compressor::new(zstd::DEFAULT_COMPRESSION_LEVEL)
+                    .map_err(|io_err| compress_err(&io_err))?,
+                output: Vec::new(),
+            },
+        })
+    }
+
+    /// The value of the `Content-Encoding` header, if any.
+    pub(super) fn content_encoding(&self) -> Option<&'static str> {
+        match self {
+            BodyEncoder::Identity => None,
+
+            #[cfg(feature = "compression-gzip")]
+            BodyEncoder::Gzip { .. } => Some("gzip"),
+
+            #[cfg(feature = "compression-zstd")]
+            BodyEncoder::Zstd { .. } => Some("zstd"),
+        }
+    }
+
+    /// Encode the request body. Without compression, this returns `bytes`.
+    pub(super) fn encode<'a>(&'a mut self, bytes: &'a [u8]) -> crate::Result<&'a [u8]> {
+        match self {
+            BodyEncoder::Identity => Ok(bytes),
+
+            #[cfg(feature = "compression-gzip")]
+            BodyEncoder::Gzip { deflate, output } => {
+                output.clear();
+                output.reserve(GZIP_HEADER.len() + bytes.len() / 4 + 64);
+                output.extend_from_slice(&GZIP_HEADER);
+                deflate.reset();
+                loop {
+                    let consumed = deflate.total_in() as usize;
+                    let status = deflate
+                        .compress_vec(&bytes[consumed..], output, flate2::FlushCompress::Finish)
+                        .map_err(|err| compress_err(&err))?;
+                    if status == flate2::Status::StreamEnd {
+                        break;
+                    }
+                    // `compress_vec` only writes into the spare capacity.
+                    output.reserve(output.capacity().max(4096));
+                }
+                let mut crc = flate2::Crc::new();
+                crc.update(bytes);
+                output.extend_from_slice(&crc.sum().to_le_bytes());
+                output.extend_from_slice(&(bytes.len() as u32).to_le_bytes());
+                Ok(output.as_slice())
+            }
+
+            #[cfg(feature = "compression-zstd")]
+            BodyEncoder::Zstd { cctx, output } => {
+                output.clear();
+                output.reserve(zstd::zstd_safe::compress_bound(bytes.len()));
+                cctx.compress_to_buffer(bytes, output)
+                    .map_err(|io_err| compress_err(&io_err))?;
+                Ok(output.as_slice())
+            }
         }
     }
 }
@@ -62,14 +250,173 @@ pub(super) struct HttpHandlerState {
     /// Maintains a pool of open HTTP connections to the endpoint.
     pub(super) agent: ureq::Agent,
 
-    /// The URL of the HTTP endpoint.
-    pub(super) url: String,
+    /// The URLs of the HTTP endpoints.
+    pub(super) endpoints: Endpoints,
 
     /// The content of the `Authorization` HTTP header.
     pub(super) auth: Option<String>,
 
     /// HTTP params configured via the `SenderBuilder`.
     pub(super) config: HttpConfig,
+
+    /// Compresses the request bodies as per `config.compression`.
+    pub(super) encoder: BodyEncoder,
+
+    /// Fails flushes fast whilst the server keeps failing.
+    pub(super) breaker: CircuitBreaker,
+
+    /// Holds the flushes that exhausted the `retry_timeout`, if `spool_dir` is set.
+    pub(super) spool: Option<Spool>,
+
+    /// Pings the server whilst the connection is idle, if `prewarm` is on.
+    pub(super) keep_alive: Option<KeepAlive>,
+}
+
+/// The ILP `/write` URLs of the hosts listed in `addr`, in order of
+/// preference, and their `/ping` URLs for warming up connections.
+///
+/// Requests go to the current URL until it fails with a network error or a
+/// 5xx status, then move on to the next one, wrapping around. Clones share
+/// the current position, so the spool's replays follow the sender's.
+#[derive(Debug, Clone)]
+pub(super) struct Endpoints {
+    urls: Arc<[String]>,
+    ping_urls: Arc<[String]>,
+    current: Arc<AtomicUsize>,
+}
+
+impl Endpoints {
+    pub(super) fn new(base_urls: &[String]) -> Self {
+        assert!(!base_urls.is_empty());
+        let urls = base_urls.iter().map(|base| format!("{}/write", base));
+        let ping_urls = base_urls.iter().map(|base| format!("{}/ping", base));
+        Self {
+            urls: urls.collect(),
+            ping_urls: ping_urls.collect(),
+            current: Arc::new(AtomicUsize::new(0)),
+        }
+    }
+
+    pub(super) fn len(&self) -> usize {
+        self.urls.len()
+    }
+
+    /// The position and URL to send the next request to.
+    pub(super) fn current(&self) -> (usize, &str) {
+        let index = self.current.load(Ordering::Relaxed);
+        (index, &self.urls[index])
+    }
+
+    /// The position and `/ping` URL of the current endpoint.
+    pub(super) fn current_ping(&self) -> (usize, &str) {
+        let index = self.current.load(Ordering::Relaxed);
+        (index, &self.ping_urls[index])
+    }
+
+    /// Move on from the URL at `index`, unless another request already has.
+    pub(super) fn fail_over(&self, index: usize) {
+        let next = (index + 1) % self.urls.len();
+        let _ = self
+            .current
+            .compare_exchange(index, next, Ordering::Relaxed, Ordering::Relaxed);
+    }
+}
+
+/// A new ILP request, ready to send a body of `body_len` bytes.
+pub(super) fn new_ilp_request(
+    agent: &ureq::Agent,
+    url: &str,
+    auth: Option<&str>,
+    config: &HttpConfig,
+    precision: TimestampPrecision,
+    body_len: usize,
+    content_encoding: Option<&str>,
+) -> ureq::Request {
+    let request = agent
+        .post(url)
+        .query_pairs([("precision", precision.query_param())])
+        .timeout(config.request_timeout_for(body_len))
+        .set("Content-Type", "text/plain; charset=utf-8");
+    let request = match content_encoding {
+        Some(encoding) => request.set("Content-Encoding", encoding),
+        None => request,
+    };
+    match auth {
+        Some(auth) => request.set("Authorization", auth),
+        None => request,
+    }
+}
+
+/// Ask the server at `settings_url` for the highest line protocol version
+/// both sides support, or `None` if it can't be reached. Falls back to
+/// [`ProtocolVersion::V1`] if the server doesn't list its versions, as is the
+/// case for servers that predate version 2.
+pub(super) fn probe_protocol_version(
+    agent: &ureq::Agent,
+    settings_url: &str,
+    auth: Option<&str>,
+    config: &HttpConfig,
+) -> Option<ProtocolVersion> {
+    let request = agent.get(settings_url).timeout(*config.request_timeout);
+    let request = match auth {
+        Some(auth) => request.set("Authorization", auth),
+        None => request,
+    };
+    let response = match request.call() {
+        Ok(response) => response,
+        Err(ureq::Error::Status(_, response)) => response,
+        Err(ureq::Error::Transport(_)) => return None,
+    };
+    match response.into_json::<serde_json::Value>() {
+        Ok(json) => Some(parse_protocol_versions(&json)),
+        Err(_) => Some(ProtocolVersion::V1),
+    }
+}
+
+/// Resolve a `host:port` for `ureq` with [`gai::resolve_host_port`], which
+/// caches the results and orders the addresses for failing over between IPv6
+/// and IPv4.
+pub(super) fn resolve_netloc(netloc: &str) -> std::io::Result<Vec<std::net::SocketAddr>> {
+    let (host, port) = netloc.rsplit_once(':').ok_or_else(|| {
+        std::io::Error::new(
+            std::io::ErrorKind::InvalidInput,
+            format!("Missing port in {:?}", netloc),
+        )
+    })?;
+    let host = host.trim_start_matches('[').trim_end_matches(']');
+    crate::gai::resolve_host_port(host, port)
+        .map_err(|err| std::io::Error::new(std::io::ErrorKind::Other, err.msg()))
+}
+
+/// Pick the protocol version from a `/settings` response, which lists the
+/// supported versions under `config` on newer servers and at the top level
+/// on older ones.
+pub(super) fn parse_protocol_versions(json: &serde_json::Value) -> ProtocolVersion {
+    const KEY: &str = "line.proto.support.versions";
+    let versions = json
+        .get("config")
+        .and_then(|config| config.get(KEY))
+        .or_else(|| json.get(KEY))
+        .and_then(|versions| versions.as_array());
+    let supports_v2 = versions
+        .map(|versions| versions.iter().any(|v| v.as_u64() == Some(2)))
+        .unwrap_or(false);
+    if supports_v2 {
+        ProtocolVersion::V2
+    } else {
+        ProtocolVersion::V1
+    }
+}
+
+pub(super) fn map_http_send_err(err: ureq::Error) -> Error {
+    match err {
+        ureq::Error::Status(http_status_code, response) => {
+            parse_http_error(http_status_code, response)
+        }
+        ureq::Error::Transport(transport) => {
+            error::fmt!(SocketError, "Could not flush buffer: {}", transport)
+        }
+    }
 }
 
 pub(super) fn parse_json_error(json: &serde_json::Value, msg: &str) -> Error {
@@ -110,34 +457,86 @@ pub(super) fn parse_json_error(json: &serde_json::Value, msg: &str) -> Error {
         description.push(']');
     }
 
+    // The server counts lines from 1.
+    let failed_row = line
+        .and_then(|line| usize::try_from(line).ok())
+        .and_then(|line| line.checked_sub(1));
     error::fmt!(ServerFlushError, "Could not flush buffer: {}", description)
+        .with_failed_row(failed_row)
 }
 
 pub(super) fn parse_http_error(http_status_code: u16, response: ureq::Response) -> Error {
+    let content_type = response.content_type().to_string();
+    http_status_error(http_status_code, &content_type, response.into_string())
+}
+
+/// Like [`parse_http_error`], emitting a [`FlushSpanKind::ParseResponse`]
+/// span tagged with the server's `errorId`.
+pub(super) fn parse_http_error_traced(
+    http_status_code: u16,
+    response: ureq::Response,
+    tracer: &mut Tracer,
+) -> Error {
+    let start = tracer.start();
+    let content_type = response.content_type().to_string();
+    let body = response.into_string();
+    let bytes = body.as_ref().map_or(0, String::len);
+    let (err, error_id) = http_status_error_and_id(http_status_code, &content_type, body);
+    tracer.emit(
+        start,
+        FlushSpan {
+            status_code: Some(http_status_code),
+            error_id: error_id.as_deref(),
+            ..FlushSpan::new(FlushSpanKind::ParseResponse, bytes)
+        },
+    );
+    err
+}
+
+/// Convert an HTTP error response into an [`Error`].
+///
+/// `content_type` is the MIME type of the response, without parameters.
+pub(super) fn http_status_error(
+    http_status_code: u16,
+    content_type: &str,
+    body: std::io::Result<String>,
+) -> Error {
+    http_status_error_and_id(http_status_code, content_type, body).0
+}
+
+/// Like [`http_status_error`], also returning the `errorId` of a JSON error.
+fn http_status_error_and_id(
+    http_status_code: u16,
+    content_type: &str,
+    body: std::io::Result<String>,
+) -> (Error, Option<String>) {
     if http_status_code == 404 {
-        return error::fmt!(
+        let err = error::fmt!(
             HttpNotSupported,
             "Could not flush buffer: HTTP endpoint does not support ILP."
         );
+        return (err, None);
     } else if [401, 403].contains(&http_status_code) {
-        let description = match response.into_string() {
+        let description = match body {
             Ok(msg) if !msg.is_empty() => format!(": {}", msg),
             _ => "".to_string(),
         };
-        return error::fmt!(
+        let err = error::fmt!(
             AuthError,
             "Could not flush buffer: HTTP endpoint authentication error{} [code: {}]",
             description,
             http_status_code
         );
+        return (err, None);
     }
 
-    let is_json = response
-        .content_type()
-        .eq_ignore_ascii_case("application/json");
-    match response.into_string() {
+    let is_json = content_type.eq_ignore_ascii_case("application/json");
+    match body {
         Ok(msg) => {
-            let string_err = || error::fmt!(ServerFlushError, "Could not flush buffer: {}", msg);
+            let string_err = || {
+                let err = error::fmt!(ServerFlushError, "Could not flush buffer: {}", msg);
+                (err, None)
+            };
 
             if !is_json {
                 return string_err();
@@ -151,85 +550,333 @@ pub(super) fn parse_http_error(http_status_code: u16, response: ureq::Response)
             };
 
             return if let Some(serde_json::Value::String(ref msg)) = json.get("message") {
-                parse_json_error(&json, msg)
+                let error_id = json.get("errorId").and_then(|v| v.as_str());
+                (parse_json_error(&json, msg), error_id.map(str::to_string))
             } else {
                 string_err()
             };
         }
         Err(err) => {
-            error::fmt!(SocketError, "Could not flush buffer: {}", err)
+            let err = error::fmt!(SocketError, "Could not flush buffer: {}", err);
+            (err, None)
         }
     }
 }
 
 pub(super) fn is_retriable_error(err: &ureq::Error) -> bool {
-    use ureq::Error::*;
     match err {
-        Transport(_) => true,
+        ureq::Error::Transport(_) => true,
+        ureq::Error::Status(http_status_code, _) => is_retriable_status(*http_status_code),
+    }
+}
 
+pub(super) fn is_retriable_status(http_status_code: u16) -> bool {
+    matches!(
+        http_status_code,
         // Official HTTP codes
-        Status(500, _) |  // Internal Server Error
-        Status(503, _) |  // Service Unavailable
-        Status(504, _) |  // Gateway Timeout
+        500 | // Internal Server Error
+        503 | // Service Unavailable
+        504 | // Gateway Timeout
 
         // Unofficial extensions
-        Status(507, _) | // Insufficient Storage
-        Status(509, _) | // Bandwidth Limit Exceeded
-        Status(523, _) | // Origin is Unreachable
-        Status(524, _) | // A Timeout Occurred
-        Status(529, _) | // Site is overloaded
-        Status(599, _) => { // Network Connect Timeout Error
-            true
-        }
-        _ => false
+        507 | // Insufficient Storage
+        509 | // Bandwidth Limit Exceeded
+        523 | // Origin is Unreachable
+        524 | // A Timeout Occurred
+        529 | // Site is overloaded
+        599 // Network Connect Timeout Error
+    )
+}
+
+/// The shortest, and first, interval between retries.
+const RETRY_BASE_INTERVAL_MS: u64 = 10;
+
+/// The longest interval between retries, unless the server asks for longer
+/// with `Retry-After`.
+const RETRY_MAX_INTERVAL_MS: u64 = 1000;
+
+/// The delay the server asks for with a `Retry-After` header, if it's
+/// overloaded. Only the delay-seconds form of the header is supported.
+pub(super) fn parse_retry_after(http_status_code: u16, value: Option<&str>) -> Option<Duration> {
+    match http_status_code {
+        503 | 529 => value
+            .and_then(|value| value.trim().parse::<u64>().ok())
+            .map(Duration::from_secs),
+        _ => None,
     }
 }
 
-#[allow(clippy::result_large_err)] // `ureq::Error` is large enough to cause this warning.
-fn retry_http_send(
-    request: ureq::Request,
-    buf: &[u8],
-    retry_timeout: Duration,
-    mut last_err: ureq::Error,
-) -> Result<ureq::Response, ureq::Error> {
-    let mut rng = rand::thread_rng();
-    let retry_end = std::time::Instant::now() + retry_timeout;
-    let mut retry_interval_ms = 10;
-    loop {
-        let jitter_ms = rng.gen_range(-5i32..5);
-        let to_sleep_ms = retry_interval_ms + jitter_ms;
-        let to_sleep = Duration::from_millis(to_sleep_ms as u64);
-        if (std::time::Instant::now() + to_sleep) > retry_end {
-            return Err(last_err);
-        }
-        sleep(to_sleep);
-        last_err = match request.clone().send_bytes(buf) {
-            Ok(res) => return Ok(res),
-            Err(err) => {
-                if !is_retriable_error(&err) {
-                    return Err(err);
-                }
-                err
+/// The intervals between the attempts of a failed request, as per the
+/// `retry_*` settings.
+pub(super) struct RetrySchedule {
+    retry_end: Instant,
+    backoff: RetryBackoff,
+    retry_after: bool,
+    retry_budget: u32,
+    attempt: u32,
+    last_interval_ms: u64,
+}
+
+impl RetrySchedule {
+    pub(super) fn new(config: &HttpConfig) -> Self {
+        Self {
+            retry_end: Instant::now() + *config.retry_timeout,
+            backoff: *config.retry_backoff,
+            retry_after: *config.retry_after,
+            retry_budget: *config.retry_budget,
+            attempt: 0,
+            last_interval_ms: RETRY_BASE_INTERVAL_MS,
+        }
+    }
+
+    /// How long to wait before the next attempt, or `None` if the request
+    /// should not be retried: Because waiting would exceed the retry time
+    /// budget, or because the process-wide retry budget is used up.
+    ///
+    /// `retry_after` is the delay requested by the server, if any.
+    pub(super) fn next_delay(&mut self, retry_after: Option<Duration>) -> Option<Duration> {
+        let mut rng = rand::thread_rng();
+        let ceiling_ms = RETRY_BASE_INTERVAL_MS
+            .saturating_mul(1 << self.attempt.min(16))
+            .min(RETRY_MAX_INTERVAL_MS);
+        let interval_ms = match self.backoff {
+            RetryBackoff::Exponential => {
+                let jitter_ms = rng.gen_range(-5i64..5);
+                (ceiling_ms as i64 + jitter_ms) as u64
             }
+            RetryBackoff::FullJitter => rng.gen_range(1..=ceiling_ms),
+            RetryBackoff::Decorrelated => rng
+                .gen_range(RETRY_BASE_INTERVAL_MS..=self.last_interval_ms * 3)
+                .min(RETRY_MAX_INTERVAL_MS),
         };
-        retry_interval_ms = (retry_interval_ms * 2).min(1000);
+        self.attempt += 1;
+        self.last_interval_ms = interval_ms;
+
+        let mut to_sleep = Duration::from_millis(interval_ms);
+        if let Some(retry_after) = retry_after.filter(|_| self.retry_after) {
+            to_sleep = to_sleep.max(retry_after);
+        }
+        if (Instant::now() + to_sleep) > self.retry_end {
+            return None;
+        }
+        if self.retry_budget > 0 && !take_retry_token(self.retry_budget) {
+            return None;
+        }
+        Some(to_sleep)
     }
 }
 
-#[allow(clippy::result_large_err)] // `ureq::Error` is large enough to cause this warning.
-pub(super) fn http_send_with_retries(
-    request: ureq::Request,
-    buf: &[u8],
-    retry_timeout: Duration,
-) -> Result<ureq::Response, ureq::Error> {
-    let last_err = match request.clone().send_bytes(buf) {
-        Ok(res) => return Ok(res),
-        Err(err) => err,
+/// Tokens that refill at `rate` per second, up to `rate`.
+struct TokenBucket {
+    rate: u32,
+    tokens: f64,
+    refilled: Instant,
+}
+
+/// The retry budgets of the process, one per distinct `retry_budget` value.
+static RETRY_BUDGETS: Mutex<Vec<TokenBucket>> = Mutex::new(Vec::new());
+
+/// Take one token from the retry budget shared by all the senders in the
+/// process configured with the same `retry_budget`.
+fn take_retry_token(rate: u32) -> bool {
+    let mut buckets = RETRY_BUDGETS
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner());
+    let now = Instant::now();
+    let bucket = match buckets.iter().position(|bucket| bucket.rate == rate) {
+        Some(index) => &mut buckets[index],
+        None => {
+            buckets.push(TokenBucket {
+                rate,
+                tokens: rate as f64,
+                refilled: now,
+            });
+            buckets.last_mut().unwrap()
+        }
     };
+    let elapsed = now.duration_since(bucket.refilled).as_secs_f64();
+    bucket.tokens = (bucket.tokens + elapsed * rate as f64).min(rate as f64);
+    bucket.refilled = now;
+    if bucket.tokens >= 1.0 {
+        bucket.tokens -= 1.0;
+        true
+    } else {
+        false
+    }
+}
+
+/// Fails requests fast once the server has returned too many consecutive
+/// 5xx errors, or has been unreachable, as per the `circuit_breaker_*`
+/// settings.
+///
+/// Once open, the breaker rejects requests for the cooldown period. The next
+/// request is then let through: If it fails too, the breaker opens again.
+pub(super) struct CircuitBreaker {
+    threshold: u32,
+    cooldown: Duration,
+    failures: u32,
+    open_until: Option<Instant>,
+}
+
+impl CircuitBreaker {
+    pub(super) fn new(config: &HttpConfig) -> Self {
+        Self {
+            threshold: *config.circuit_breaker_threshold,
+            cooldown: *config.circuit_breaker_cooldown,
+            failures: 0,
+            open_until: None,
+        }
+    }
+
+    /// Return an error if the breaker is open.
+    pub(super) fn check(&self) -> crate::Result<()> {
+        match self.open_until {
+            Some(open_until) if Instant::now() < open_until => Err(error::fmt!(
+                SocketError,
+                "Could not flush buffer: Not sent, as the server failed {} times in a row. \
+                Retrying after {:?}.",
+                self.failures,
+                open_until - Instant::now()
+            )),
+            _ => Ok(()),
+        }
+    }
+
+    pub(super) fn is_open(&self) -> bool {
+        self.check().is_err()
+    }
+
+    /// Record the outcome of an attempt: `server_failed` is true for 5xx
+    /// responses and network errors.
+    pub(super) fn record(&mut self, server_failed: bool) {
+        if !server_failed {
+            self.failures = 0;
+            self.open_until = None;
+            return;
+        }
+        self.failures = self.failures.saturating_add(1);
+        if self.threshold > 0 && self.failures >= self.threshold {
+            self.open_until = Some(Instant::now() + self.cooldown);
+        }
+    }
+}
+
+/// The body of an ILP request, sent afresh by each attempt.
+pub(super) trait RequestBody {
+    /// The number of bytes of the body, or produced so far if it's streamed.
+    fn len(&self) -> usize;
+
+    #[allow(clippy::result_large_err)]
+    fn send(&mut self, request: ureq::Request) -> Result<ureq::Response, ureq::Error>;
+
+    /// Whether a failed attempt can be retried with the same body.
+    fn can_resend(&self) -> bool {
+        true
+    }
+}
 
-    if retry_timeout.is_zero() || !is_retriable_error(&last_err) {
-        return Err(last_err);
+impl RequestBody for &[u8] {
+    fn len(&self) -> usize {
+        <[u8]>::len(self)
     }
 
-    retry_http_send(request, buf, retry_timeout, last_err)
+    fn send(&mut self, request: ureq::Request) -> Result<ureq::Response, ureq::Error> {
+        request.send_bytes(self)
+    }
+}
+
+#[allow(clippy::result_large_err)] // `ureq::Error` is large enough to cause this warning.
+pub(super) fn http_send_with_retries<R, B>(
+    endpoints: &Endpoints,
+    new_request: R,
+    mut body: B,
+    config: &HttpConfig,
+    breaker: &mut CircuitBreaker,
+    stats: &StatsRecorder,
+    tracer: &mut Tracer,
+) -> Result<ureq::Response, ureq::Error>
+where
+    R: Fn(&str) -> ureq::Request,
+    B: RequestBody,
+{
+    let request_start = tracer.start();
+    let mut attempt = 0;
+    let trace = |tracer: &mut Tracer, kind, start, attempt, status_code, bytes| {
+        let span = FlushSpan {
+            attempt,
+            status_code,
+            ..FlushSpan::new(kind, bytes)
+        };
+        tracer.emit(start, span);
+    };
+    let mut schedule: Option<RetrySchedule> = None;
+    loop {
+        attempt += 1;
+        let attempt_start = tracer.start();
+        let (endpoint, url) = endpoints.current();
+        let res = body.send(new_request(url));
+        let status_code = match res {
+            Ok(ref res) => Some(res.status()),
+            Err(ureq::Error::Status(http_status_code, _)) => Some(http_status_code),
+            Err(ureq::Error::Transport(_)) => None,
+        };
+        trace(
+            tracer,
+            FlushSpanKind::HttpAttempt,
+            attempt_start,
+            attempt,
+            status_code,
+            body.len(),
+        );
+        let err = match res {
+            Ok(res) => {
+                breaker.record(false);
+                trace(
+                    tracer,
+                    FlushSpanKind::HttpRequest,
+                    request_start,
+                    attempt,
+                    status_code,
+                    body.len(),
+                );
+                return Ok(res);
+            }
+            Err(err) => err,
+        };
+        let (server_failed, retry_after) = match err {
+            ureq::Error::Status(http_status_code, ref response) => (
+                http_status_code >= 500,
+                parse_retry_after(http_status_code, response.header("Retry-After")),
+            ),
+            ureq::Error::Transport(_) => (true, None),
+        };
+        breaker.record(server_failed);
+        if server_failed {
+            endpoints.fail_over(endpoint);
+        }
+        let to_sleep = if is_retriable_error(&err) && body.can_resend() && !breaker.is_open() {
+            schedule
+                .get_or_insert_with(|| RetrySchedule::new(config))
+                .next_delay(retry_after)
+        } else {
+            None
+        };
+        match to_sleep {
+            Some(to_sleep) => {
+                stats.record_retry(matches!(err, ureq::Error::Transport(_)), to_sleep);
+                sleep(to_sleep)
+            }
+            None => {
+                trace(
+                    tracer,
+                    FlushSpanKind::HttpRequest,
+                    request_start,
+                    attempt,
+                    status_code,
+                    body.len(),
+                );
+                return Err(err);
+            }
+        }
+    }
 }
@@ -0,0 +1,173 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+//! Connection pre-warming for ILP-over-HTTP senders.
+//!
+//! With `prewarm=on`, the sender opens its connection with a `GET /ping`
+//! request when it's built, and a keep-alive thread pings the server again
+//! whenever the connection has been idle for the `ping_interval`.
+
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Condvar, Mutex};
+use std::thread::JoinHandle;
+use std::time::{Duration, Instant};
+
+use super::http::{Endpoints, HttpConfig};
+use super::map_io_to_socket_err;
+use crate::error::{self, Result};
+
+/// Send a `GET /ping` through the agent's connection pool, failing over
+/// between the endpoints until one answers. The connection stays open for
+/// the next request.
+pub(super) fn ping(
+    agent: &ureq::Agent,
+    endpoints: &Endpoints,
+    auth: Option<&str>,
+    config: &HttpConfig,
+) -> Result<()> {
+    let mut last_err = None;
+    for _ in 0..endpoints.len() {
+        let (index, url) = endpoints.current_ping();
+        let request = agent.get(url).timeout(*config.request_timeout);
+        let request = match auth {
+            Some(auth) => request.set("Authorization", auth),
+            None => request,
+        };
+        match request.call() {
+            // Any response means the connection is up. Read it to the end to
+            // hand the connection back to the pool.
+            Ok(response) | Err(ureq::Error::Status(_, response)) => {
+                let _ = std::io::copy(&mut response.into_reader(), &mut std::io::sink());
+                return Ok(());
+            }
+            Err(ureq::Error::Transport(transport)) => {
+                endpoints.fail_over(index);
+                last_err = Some(transport);
+            }
+        }
+    }
+    let transport = last_err.expect("there is at least one endpoint");
+    Err(error::fmt!(
+        SocketError,
+        "Could not warm up connection: {}",
+        transport
+    ))
+}
+
+struct Shared {
+    stop: Mutex<bool>,
+    cond: Condvar,
+
+    /// When the sender last used the connection, in milliseconds since `epoch`.
+    last_used_millis: AtomicU64,
+    epoch: Instant,
+}
+
+impl Shared {
+    fn touch(&self) {
+        let millis = u64::try_from(self.epoch.elapsed().as_millis()).unwrap_or(u64::MAX);
+        self.last_used_millis.store(millis, Ordering::Relaxed);
+    }
+
+    fn idle_for(&self) -> Duration {
+        let last_used = Duration::from_millis(self.last_used_millis.load(Ordering::Relaxed));
+        self.epoch.elapsed().saturating_sub(last_used)
+    }
+}
+
+/// Keeps the sender's idle keep-alive connection open by pinging the server
+/// from a background thread once the connection has been idle for
+/// `interval`.
+///
+/// A ping over a connection the server or a proxy has dropped fails and is
+/// retried over a fresh connection, so the next flush doesn't find a dead
+/// socket.
+pub(super) struct KeepAlive {
+    shared: Arc<Shared>,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl KeepAlive {
+    pub(super) fn start(
+        agent: ureq::Agent,
+        endpoints: Endpoints,
+        auth: Option<String>,
+        config: HttpConfig,
+        interval: Duration,
+    ) -> Result<Self> {
+        let shared = Arc::new(Shared {
+            stop: Mutex::new(false),
+            cond: Condvar::new(),
+            last_used_millis: AtomicU64::new(0),
+            epoch: Instant::now(),
+        });
+        let thread_shared = shared.clone();
+        let thread = std::thread::Builder::new()
+            .name("questdb-keep-alive".to_owned())
+            .spawn(move || {
+                let mut stop = thread_shared.stop.lock().unwrap();
+                loop {
+                    let idle_for = thread_shared.idle_for();
+                    if idle_for >= interval {
+                        drop(stop);
+                        // A failure leaves no pooled connection behind: Try
+                        // again on the next round.
+                        let _ = ping(&agent, &endpoints, auth.as_deref(), &config);
+                        thread_shared.touch();
+                        stop = thread_shared.stop.lock().unwrap();
+                    }
+                    if *stop {
+                        return;
+                    }
+                    let wait = interval.saturating_sub(thread_shared.idle_for());
+                    stop = thread_shared.cond.wait_timeout(stop, wait).unwrap().0;
+                    if *stop {
+                        return;
+                    }
+                }
+            })
+            .map_err(|io_err| {
+                map_io_to_socket_err("Could not start keep-alive thread: ", io_err)
+            })?;
+        Ok(Self {
+            shared,
+            thread: Some(thread),
+        })
+    }
+
+    /// Record that the sender just used the connection.
+    pub(super) fn touch(&self) {
+        self.shared.touch();
+    }
+}
+
+impl Drop for KeepAlive {
+    fn drop(&mut self) {
+        *self.shared.stop.lock().unwrap() = true;
+        self.shared.cond.notify_one();
+        if let Some(thread) = self.thread.take() {
+            let _ = thread.join();
+        }
+    }
+}
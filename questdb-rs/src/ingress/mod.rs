@@ -24,27 +24,45 @@
 
 #![doc = include_str!("mod.md")]
 
+pub use self::arrow::*;
+pub use self::background::*;
+pub use self::buffer_pool::*;
+pub use self::clock::{ClockSource, FastClock};
+pub use self::columns::*;
+pub use self::concurrent::*;
+pub use self::multi_table::*;
+pub use self::pool::*;
+pub use self::row_template::*;
+pub use self::sharded::*;
+pub use self::stats::{LatencyHistogram, SenderStats};
 pub use self::timestamp::*;
+pub use self::trace::{FlushSpan, FlushSpanKind};
+
+#[cfg(feature = "ilp-over-http")]
+pub use self::http::{Compression, RetryBackoff};
+
+#[cfg(feature = "async-tokio")]
+pub use self::async_sender::*;
 
 use crate::error::{self, Error, Result};
 use crate::gai;
 use crate::ingress::conf::ConfigSetting;
 use core::time::Duration;
-use std::collections::HashMap;
 use std::convert::Infallible;
 use std::fmt::{Debug, Display, Formatter, Write};
-use std::io::{self, BufRead, BufReader, ErrorKind, Write as IoWrite};
-use std::ops::Deref;
-use std::path::PathBuf;
+use std::io::{self, BufRead, BufReader, ErrorKind, IoSlice, Write as IoWrite};
+use std::ops::{Deref, Range};
+use std::path::{Path, PathBuf};
 use std::str::FromStr;
-use std::sync::Arc;
+use std::sync::{Arc, Mutex};
+use std::time::{Instant, SystemTime};
 
 use base64ct::{Base64, Base64UrlUnpadded, Encoding};
 use ring::rand::SystemRandom;
 use ring::signature::{EcdsaKeyPair, ECDSA_P256_SHA256_FIXED_SIGNING};
 use rustls::{ClientConnection, RootCertStore, StreamOwned};
 use rustls_pki_types::ServerName;
-use socket2::{Domain, Protocol as SockProtocol, SockAddr, Socket, Type};
+use socket2::{Protocol as SockProtocol, SockAddr, Socket, Type};
 
 #[derive(Debug, Copy, Clone)]
 enum Op {
@@ -165,6 +183,12 @@ impl<'a> TableName<'a> {
 #[derive(Clone, Copy)]
 pub struct ColumnName<'a> {
     name: &'a str,
+
+    /// The pre-escaped `,name=` key, if borrowed from a [`PreparedColumnName`].
+    key: Option<&'a str>,
+
+    /// The fixed number of decimals of a [`PreparedColumnName`], if set.
+    decimals: Option<u8>,
 }
 
 impl<'a> ColumnName<'a> {
@@ -215,7 +239,11 @@ impl<'a> ColumnName<'a> {
             }
         }
 
-        Ok(Self { name })
+        Ok(Self {
+            name,
+            key: None,
+            decimals: None,
+        })
     }
 
     /// Construct a column name without validating it.
@@ -225,7 +253,113 @@ impl<'a> ColumnName<'a> {
     ///
     /// The QuestDB server will reject an invalid column name.
     pub fn new_unchecked(name: &'a str) -> Self {
-        Self { name }
+        Self {
+            name,
+            key: None,
+            decimals: None,
+        }
+    }
+}
+
+/// A validated column name, escaped once ahead of time.
+///
+/// Where a [`ColumnName`] only saves re-validating the name, a
+/// `PreparedColumnName` also holds its escaped `,name=` key, so that the
+/// [`Buffer`] can append it with a single copy.
+///
+/// Pass `&PreparedColumnName` to any [`Buffer`] method that accepts a column
+/// name.
+///
+/// ```
+/// # use questdb::Result;
+/// use questdb::ingress::{Buffer, PreparedColumnName, TimestampNanos};
+///
+/// # fn main() -> Result<()> {
+/// let price = PreparedColumnName::new("price")?;
+/// let mut buffer = Buffer::new();
+/// buffer
+///     .table("trades")?
+///     .column_f64(&price, 2615.54)?
+///     .at(TimestampNanos::now())?;
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+pub struct PreparedColumnName {
+    name: Box<str>,
+    key: Box<str>,
+    decimals: Option<u8>,
+}
+
+impl PreparedColumnName {
+    /// Validate and escape a column name.
+    pub fn new<'a, N>(name: N) -> Result<Self>
+    where
+        N: TryInto<ColumnName<'a>>,
+        Error: From<N::Error>,
+    {
+        let name: ColumnName<'a> = name.try_into()?;
+        Ok(Self::from(name))
+    }
+
+    /// The column name, as originally supplied.
+    pub fn as_str(&self) -> &str {
+        &self.name
+    }
+
+    /// Format the `f64` values of this column rounded to a fixed number of
+    /// decimals, as [`Buffer::column_f64_fixed`] does.
+    ///
+    /// This applies wherever the name is passed in place of a plain string:
+    /// to [`Buffer::column_f64`], [`ColumnSlice`] and [`RowTemplate`]
+    /// columns.
+    pub fn with_decimals(mut self, decimals: u8) -> Result<Self> {
+        check_decimals("PreparedColumnName::with_decimals", decimals)?;
+        self.decimals = Some(decimals);
+        Ok(self)
+    }
+
+    /// The fixed number of decimals set by
+    /// [`with_decimals`](PreparedColumnName::with_decimals), if any.
+    pub fn decimals(&self) -> Option<u8> {
+        self.decimals
+    }
+}
+
+fn check_decimals(method: &str, decimals: u8) -> Result<()> {
+    if decimals > MAX_DECIMALS {
+        return Err(error::fmt!(
+            InvalidApiCall,
+            "Bad call to `{}`: {} decimals exceeds the maximum of {}.",
+            method,
+            decimals,
+            MAX_DECIMALS
+        ));
+    }
+    Ok(())
+}
+
+impl From<ColumnName<'_>> for PreparedColumnName {
+    fn from(name: ColumnName<'_>) -> Self {
+        let mut key = String::with_capacity(name.name.len() + 2);
+        key.push(',');
+        key.push_str(&escaped_unquoted(name.name));
+        key.push('=');
+        Self {
+            name: name.name.into(),
+            key: key.into_boxed_str(),
+            decimals: name.decimals,
+        }
+    }
+}
+
+impl<'a> From<&'a PreparedColumnName> for ColumnName<'a> {
+    fn from(prepared: &'a PreparedColumnName) -> Self {
+        Self {
+            name: &prepared.name,
+            key: Some(&prepared.key),
+            decimals: prepared.decimals,
+        }
     }
 }
 
@@ -251,69 +385,80 @@ impl From<Infallible> for Error {
     }
 }
 
-fn write_escaped_impl<Q, C>(check_escape_fn: C, quoting_fn: Q, output: &mut String, s: &str)
+fn write_escaped_impl<Q>(needles: &'static [u8], quoting_fn: Q, output: &mut Vec<u8>, s: &str)
 where
-    C: Fn(u8) -> bool,
     Q: Fn(&mut Vec<u8>),
 {
-    let output_vec = unsafe { output.as_mut_vec() };
-    let mut to_escape = 0usize;
-    for b in s.bytes() {
-        if check_escape_fn(b) {
-            to_escape += 1;
-        }
-    }
-
-    quoting_fn(output_vec);
-
-    if to_escape == 0 {
-        // output.push_str(s);
-        output_vec.extend_from_slice(s.as_bytes());
-    } else {
-        let additional = s.len() + to_escape;
-        output_vec.reserve(additional);
-        let mut index = output_vec.len();
-        unsafe { output_vec.set_len(index + additional) };
-        for b in s.bytes() {
-            if check_escape_fn(b) {
-                unsafe {
-                    *output_vec.get_unchecked_mut(index) = b'\\';
-                }
-                index += 1;
-            }
-
-            unsafe {
-                *output_vec.get_unchecked_mut(index) = b;
-            }
-            index += 1;
-        }
+    output.reserve(s.len() + 2);
+    quoting_fn(output);
+
+    // Clean runs are copied in bulk.
+    let mut rest = s.as_bytes();
+    while let Some(index) = escape::find_escape(needles, rest) {
+        output.extend_from_slice(&rest[..index]);
+        output.push(b'\\');
+        output.push(rest[index]);
+        rest = &rest[index + 1..];
     }
+    output.extend_from_slice(rest);
 
-    quoting_fn(output_vec);
+    quoting_fn(output);
 }
 
-fn must_escape_unquoted(c: u8) -> bool {
-    matches!(c, b' ' | b',' | b'=' | b'\n' | b'\r' | b'\\')
+fn write_escaped_unquoted(output: &mut Vec<u8>, s: &str) {
+    write_escaped_impl(escape::UNQUOTED, |_output| (), output, s);
 }
 
-fn must_escape_quoted(c: u8) -> bool {
-    matches!(c, b'\n' | b'\r' | b'"' | b'\\')
+fn write_escaped_quoted(output: &mut Vec<u8>, s: &str) {
+    write_escaped_impl(escape::QUOTED, |output| output.push(b'"'), output, s)
 }
 
-fn write_escaped_unquoted(output: &mut String, s: &str) {
-    write_escaped_impl(must_escape_unquoted, |_output| (), output, s);
-}
+/// Escape a name ahead of time, for keys that are copied into many rows.
+fn escaped_unquoted(s: &str) -> String {
+    let mut output = Vec::with_capacity(s.len());
+    write_escaped_unquoted(&mut output, s);
 
-fn write_escaped_quoted(output: &mut String, s: &str) {
-    write_escaped_impl(must_escape_quoted, |output| output.push(b'"'), output, s)
+    // The escapable bytes are all ASCII, so escaping keeps to char boundaries.
+    String::from_utf8(output).expect("escaped UTF-8 is valid UTF-8")
 }
 
 enum Connection {
     Direct(Socket),
     Tls(Box<StreamOwned<ClientConnection, Socket>>),
+
+    #[cfg(all(feature = "io-uring", target_os = "linux"))]
+    Uring(Box<UringConnection>),
 }
 
 impl Connection {
+    fn socket(&self) -> &Socket {
+        match self {
+            Self::Direct(sock) => sock,
+            Self::Tls(stream) => &stream.sock,
+
+            #[cfg(all(feature = "io-uring", target_os = "linux"))]
+            Self::Uring(conn) => conn.inner().socket(),
+        }
+    }
+
+    /// Write out any TLS records still buffered by an earlier write.
+    /// Returns `false` if the socket can't accept them all without blocking.
+    fn try_write_pending(&mut self) -> io::Result<bool> {
+        let Self::Tls(stream) = self else {
+            return Ok(true);
+        };
+        let stream = &mut **stream;
+        while stream.conn.wants_write() {
+            match stream.conn.write_tls(&mut stream.sock) {
+                Ok(_) => {}
+                Err(io_err) if io_err.kind() == ErrorKind::Interrupted => {}
+                Err(io_err) if io_err.kind() == ErrorKind::WouldBlock => return Ok(false),
+                Err(io_err) => return Err(io_err),
+            }
+        }
+        Ok(true)
+    }
+
     fn send_key_id(&mut self, key_id: &str) -> Result<()> {
         writeln!(self, "{}", key_id)
             .map_err(|io_err| map_io_to_socket_err("Failed to send key_id: ", io_err))?;
@@ -389,6 +534,9 @@ impl io::Read for Connection {
         match self {
             Self::Direct(sock) => sock.read(buf),
             Self::Tls(stream) => stream.read(buf),
+
+            #[cfg(all(feature = "io-uring", target_os = "linux"))]
+            Self::Uring(conn) => conn.read(buf),
         }
     }
 }
@@ -398,6 +546,23 @@ impl io::Write for Connection {
         match self {
             Self::Direct(sock) => sock.write(buf),
             Self::Tls(stream) => stream.write(buf),
+
+            #[cfg(all(feature = "io-uring", target_os = "linux"))]
+            Self::Uring(conn) => conn.write(buf),
+        }
+    }
+
+    fn write_vectored(&mut self, bufs: &[IoSlice<'_>]) -> io::Result<usize> {
+        match self {
+            Self::Direct(sock) => sock.send_vectored(bufs),
+            Self::Tls(stream) => {
+                // Encrypt all the slices into TLS records in one go.
+                let stream = &mut **stream;
+                rustls::Stream::new(&mut stream.conn, &mut stream.sock).write_vectored(bufs)
+            }
+
+            #[cfg(all(feature = "io-uring", target_os = "linux"))]
+            Self::Uring(conn) => conn.write_vectored(bufs),
         }
     }
 
@@ -405,6 +570,104 @@ impl io::Write for Connection {
         match self {
             Self::Direct(sock) => sock.flush(),
             Self::Tls(stream) => stream.flush(),
+
+            #[cfg(all(feature = "io-uring", target_os = "linux"))]
+            Self::Uring(conn) => conn.flush(),
+        }
+    }
+}
+
+/// Write as much of `bytes` as the connection accepts without blocking.
+/// Returns the number of bytes written and whether they were fully handed off
+/// to the socket.
+fn try_write_all(conn: &mut Connection, bytes: &[u8]) -> io::Result<(usize, bool)> {
+    let mut written = 0;
+    while written < bytes.len() {
+        match conn.write(&bytes[written..]) {
+            Ok(0) => {
+                return Err(io::Error::new(
+                    ErrorKind::WriteZero,
+                    "failed to write whole buffer",
+                ))
+            }
+            Ok(n) => written += n,
+            Err(io_err) if io_err.kind() == ErrorKind::Interrupted => {}
+            Err(io_err) if io_err.kind() == ErrorKind::WouldBlock => return Ok((written, false)),
+            Err(io_err) => return Err(io_err),
+        }
+    }
+    Ok((written, conn.try_write_pending()?))
+}
+
+/// Write all of `bytes`, holding back each slice of it until `rate_limiter`
+/// lets it through.
+fn write_all_paced(
+    conn: &mut Connection,
+    bytes: &[u8],
+    rows: usize,
+    rate_limiter: Option<&RateLimiter>,
+) -> io::Result<()> {
+    let Some(rate_limiter) = rate_limiter else {
+        return conn.write_all(bytes);
+    };
+    rate_limiter.acquire(0, rows);
+    for slice in bytes.chunks(rate_limiter.pace_bytes()) {
+        rate_limiter.acquire(slice.len(), 0);
+        conn.write_all(slice)?;
+    }
+    Ok(())
+}
+
+/// Maximum number of buffers passed to a single vectored write.
+const MAX_IO_SLICES: usize = 64;
+
+/// Write the contents of all the buffers with as few vectored writes as the
+/// connection allows, skipping empty buffers.
+fn write_all_vectored(conn: &mut Connection, bufs: &[&mut Buffer]) -> io::Result<()> {
+    let mut index = 0;
+    let mut offset = 0;
+    loop {
+        while index < bufs.len() && offset == bufs[index].len() {
+            index += 1;
+            offset = 0;
+        }
+        if index == bufs.len() {
+            return Ok(());
+        }
+
+        let mut slices = [IoSlice::new(&[]); MAX_IO_SLICES];
+        let mut count = 0;
+        for buf in bufs[index..].iter().filter(|buf| !buf.is_empty()) {
+            if count == MAX_IO_SLICES {
+                break;
+            }
+            let bytes = buf.as_bytes();
+            slices[count] = IoSlice::new(if count == 0 { &bytes[offset..] } else { bytes });
+            count += 1;
+        }
+
+        let mut written = match conn.write_vectored(&slices[..count]) {
+            Ok(0) => {
+                return Err(io::Error::new(
+                    ErrorKind::WriteZero,
+                    "failed to write whole buffer",
+                ))
+            }
+            Ok(written) => written,
+            Err(io_err) if io_err.kind() == ErrorKind::Interrupted => continue,
+            Err(io_err) => return Err(io_err),
+        };
+
+        // Advance past the bytes written, which may end mid-buffer.
+        while written > 0 {
+            let remaining = bufs[index].len() - offset;
+            if written < remaining {
+                offset += written;
+                break;
+            }
+            written -= remaining;
+            index += 1;
+            offset = 0;
         }
     }
 }
@@ -434,7 +697,11 @@ impl OpCase {
 struct BufferState {
     op_case: OpCase,
     row_count: usize,
-    first_table: Option<String>,
+
+    /// The length of the escaped table name the buffer's first row starts
+    /// with. Other tables are compared against it in place, which keeps
+    /// appending rows free of allocations.
+    first_table_len: Option<usize>,
     transactional: bool,
 }
 
@@ -443,7 +710,7 @@ impl BufferState {
         Self {
             op_case: OpCase::Init,
             row_count: 0,
-            first_table: None,
+            first_table_len: None,
             transactional: true,
         }
     }
@@ -451,11 +718,103 @@ impl BufferState {
     fn clear(&mut self) {
         self.op_case = OpCase::Init;
         self.row_count = 0;
-        self.first_table = None;
+        self.first_table_len = None;
         self.transactional = true;
     }
 }
 
+/// The length of the escaped table name at the start of a row.
+fn escaped_table_len(row: &[u8]) -> usize {
+    let mut index = 0;
+    while index < row.len() {
+        match row[index] {
+            b'\\' => index += 2,
+            b',' | b' ' => return index,
+            _ => index += 1,
+        }
+    }
+    row.len()
+}
+
+/// Check that appending up to `len_bound` more bytes to `output` stays within
+/// `fixed_capacity`, if set.
+#[inline(always)]
+fn check_capacity(output: &[u8], fixed_capacity: Option<usize>, len_bound: usize) -> Result<()> {
+    match fixed_capacity {
+        Some(capacity) if output.len() + len_bound > capacity => Err(error::fmt!(
+            BufferFull,
+            "Buffer full: Appending up to {} more bytes would exceed the fixed capacity of {} bytes.",
+            len_bound,
+            capacity
+        )),
+        _ => Ok(()),
+    }
+}
+
+/// The type tag of a binary `f64` value in [`ProtocolVersion::V2`].
+const DOUBLE_BINARY_FORMAT_TYPE: u8 = 16;
+
+/// Write an `f64` column value, following its key.
+#[inline(always)]
+fn write_f64(output: &mut Vec<u8>, protocol_version: ProtocolVersion, value: f64) {
+    match protocol_version {
+        ProtocolVersion::V1 => {
+            let mut ser = F64Serializer::new(value);
+            output.extend_from_slice(ser.as_str().as_bytes());
+        }
+        ProtocolVersion::V2 => {
+            output.push(b'=');
+            output.push(DOUBLE_BINARY_FORMAT_TYPE);
+            output.extend_from_slice(&value.to_le_bytes());
+        }
+    }
+}
+
+/// Write an `f64` column value, following its key, rounded to `decimals`
+/// places if set.
+///
+/// The binary values of [`ProtocolVersion::V2`] are exact and as short
+/// regardless, so `decimals` only applies to [`ProtocolVersion::V1`]. Values
+/// too large to scale exactly fall back to the shortest round-trip format.
+#[inline(always)]
+fn write_f64_decimals(
+    output: &mut Vec<u8>,
+    protocol_version: ProtocolVersion,
+    value: f64,
+    decimals: Option<u8>,
+) {
+    if let (ProtocolVersion::V1, Some(decimals)) = (protocol_version, decimals) {
+        if write_fixed(output, value, decimals) {
+            return;
+        }
+    }
+    write_f64(output, protocol_version, value);
+}
+
+/// An upper bound on the length of `s` once escaped.
+#[inline(always)]
+fn escaped_len_bound(s: &str) -> usize {
+    2 * s.len()
+}
+
+/// An upper bound on the length of `{sep}name=` once escaped.
+#[inline(always)]
+fn key_len_bound(name: &ColumnName<'_>) -> usize {
+    match name.key {
+        Some(key) => key.len(),
+        None => escaped_len_bound(name.name) + 2,
+    }
+}
+
+/// The longest an `i64` formats to, sign included.
+const MAX_I64_LEN: usize = 20;
+
+/// The longest an `f64` formats to.
+const MAX_F64_LEN: usize = 24;
+
+/// The length of a formatted long256 value.
+const LONG256_LEN: usize = 67;
+
 /// A reusable buffer to prepare a batch of ILP messages.
 ///
 /// # Example
@@ -502,6 +861,8 @@ impl BufferState {
 ///   * Symbols must appear before columns.
 ///   * A row must be terminated with either [`at`](Buffer::at) or
 ///     [`at_now`](Buffer::at_now).
+///   * Alternatively, [`append_columns`](Buffer::append_columns) appends a whole
+///     batch of complete rows in one call.
 ///
 /// This diagram visualizes the sequence:
 ///
@@ -541,12 +902,55 @@ impl BufferState {
 /// [`buffer.rewind_to_marker()`](Buffer::rewind_to_marker) to go back to the
 /// marked last known good state.
 ///
-#[derive(Debug, Clone)]
+#[derive(Debug)]
 pub struct Buffer {
-    output: String,
+    output: Vec<u8>,
     state: BufferState,
     marker: Option<(usize, BufferState)>,
     max_name_len: usize,
+
+    /// Number of leading bytes already sent by [`Sender::try_flush`] or
+    /// [`Sender::flush_chunked`].
+    send_offset: usize,
+
+    /// The offset just past the end of each complete row, in order. Lets
+    /// [`Sender::flush_chunked`] cut the buffer at row boundaries.
+    row_ends: Vec<usize>,
+
+    /// Set by [`Buffer::with_fixed_capacity`]. `output` never grows past it.
+    fixed_capacity: Option<usize>,
+
+    /// The leading digits of the last timestamp passed to [`Buffer::at_delta`].
+    ts_cache: TimestampCache,
+
+    protocol_version: ProtocolVersion,
+    ts_precision: TimestampPrecision,
+
+    /// Set by [`Buffer::set_trusted`]. The call order and name length checks
+    /// are debug-only assertions.
+    trusted: bool,
+}
+
+impl Clone for Buffer {
+    fn clone(&self) -> Self {
+        // A plain `Vec::clone` would shrink the capacity to the length,
+        // leaving a fixed-capacity clone to reallocate on the next append.
+        let mut output = Vec::with_capacity(self.fixed_capacity.unwrap_or(self.output.len()));
+        output.extend_from_slice(&self.output);
+        Self {
+            output,
+            state: self.state.clone(),
+            marker: self.marker.clone(),
+            max_name_len: self.max_name_len,
+            send_offset: self.send_offset,
+            row_ends: self.row_ends.clone(),
+            fixed_capacity: self.fixed_capacity,
+            ts_cache: self.ts_cache.clone(),
+            protocol_version: self.protocol_version,
+            ts_precision: self.ts_precision,
+            trusted: self.trusted,
+        }
+    }
 }
 
 impl Buffer {
@@ -554,13 +958,28 @@ impl Buffer {
     /// QuestDB server default.
     pub fn new() -> Self {
         Self {
-            output: String::new(),
+            output: Vec::new(),
             state: BufferState::new(),
             marker: None,
             max_name_len: 127,
+            send_offset: 0,
+            row_ends: Vec::new(),
+            fixed_capacity: None,
+            ts_cache: TimestampCache::new(),
+            protocol_version: ProtocolVersion::V1,
+            ts_precision: TimestampPrecision::Nanos,
+            trusted: false,
         }
     }
 
+    /// Construct a [trusted](Buffer::set_trusted) `Buffer` with a
+    /// `max_name_len` of `127`.
+    pub fn new_trusted() -> Self {
+        let mut buf = Self::new();
+        buf.trusted = true;
+        buf
+    }
+
     /// Construct a `Buffer` with a custom maximum length for table and column names.
     ///
     /// This should match the `cairo.max.file.name.length` setting of the
@@ -574,12 +993,48 @@ impl Buffer {
         buf
     }
 
+    /// Construct a `Buffer` that allocates `capacity` bytes up front and then
+    /// never reallocates.
+    ///
+    /// Any call that could take the buffer past `capacity` bytes returns an
+    /// [`ErrorCode::BufferFull`](crate::ErrorCode::BufferFull) error instead,
+    /// leaving the buffer unchanged. The check is against an upper bound of
+    /// the encoded size that assumes every character of a name or string
+    /// needs escaping, so a buffer may report being full a little early.
+    ///
+    /// Since [`clear`](Buffer::clear) retains the capacity and none of the
+    /// calls that append to the buffer allocate otherwise, a buffer reused
+    /// across flushes never touches the allocator after construction.
+    /// The exceptions are [`append_columns`](Buffer::append_columns), which
+    /// allocates scratch space per call, and the index of row boundaries
+    /// kept for [`Sender::flush_chunked`], which grows with the row count
+    /// until the buffer has held its largest batch.
+    ///
+    /// `max_name_len` is as per [`with_max_name_len`](Buffer::with_max_name_len):
+    /// Pass `127` unless the server is configured otherwise.
+    pub fn with_fixed_capacity(max_name_len: usize, capacity: usize) -> Self {
+        let mut buf = Self::with_max_name_len(max_name_len);
+        buf.output.reserve_exact(capacity);
+        buf.fixed_capacity = Some(capacity);
+        buf
+    }
+
+    /// The capacity the buffer was constructed with by
+    /// [`with_fixed_capacity`](Buffer::with_fixed_capacity), if any.
+    pub fn fixed_capacity(&self) -> Option<usize> {
+        self.fixed_capacity
+    }
+
     /// Pre-allocate to ensure the buffer has enough capacity for at least the
     /// specified additional byte count. This may be rounded up.
     /// This does not allocate if such additional capacity is already satisfied.
     /// See: `capacity`.
+    ///
+    /// A no-op for a buffer with a [fixed capacity](Buffer::with_fixed_capacity).
     pub fn reserve(&mut self, additional: usize) {
-        self.output.reserve(additional);
+        if self.fixed_capacity.is_none() {
+            self.output.reserve(additional);
+        }
     }
 
     /// The number of bytes accumulated in the buffer.
@@ -603,16 +1058,108 @@ impl Buffer {
         self.output.is_empty()
     }
 
+    /// The number of leading bytes already sent by a
+    /// [`try_flush`](Sender::try_flush) or
+    /// [`flush_chunked`](Sender::flush_chunked) that hasn't completed yet.
+    /// Zero if no flush is in progress.
+    pub fn send_offset(&self) -> usize {
+        self.send_offset
+    }
+
     /// The total number of bytes the buffer can hold before it needs to resize.
     pub fn capacity(&self) -> usize {
         self.output.capacity()
     }
 
     /// A string representation of the buffer's contents. Useful for debugging.
+    ///
+    /// # Panics
+    ///
+    /// If the buffer holds binary `f64` values, as written with
+    /// [`ProtocolVersion::V2`]. Use [`as_bytes`](Buffer::as_bytes) instead.
     pub fn as_str(&self) -> &str {
+        std::str::from_utf8(&self.output)
+            .expect("binary values in a protocol version 2 buffer: use `as_bytes` instead")
+    }
+
+    /// The buffer's contents, as sent to the server.
+    pub fn as_bytes(&self) -> &[u8] {
         &self.output
     }
 
+    /// The line protocol version the buffer is encoded with.
+    pub fn protocol_version(&self) -> ProtocolVersion {
+        self.protocol_version
+    }
+
+    /// Set the line protocol version to encode the buffer with. The default is
+    /// [`ProtocolVersion::V1`]. [`Sender::new_buffer`] creates a buffer with
+    /// the sender's version already set.
+    ///
+    /// The buffer must be empty.
+    pub fn set_protocol_version(&mut self, protocol_version: ProtocolVersion) -> Result<()> {
+        if !self.is_empty() {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `set_protocol_version`: The buffer must be empty."
+            ));
+        }
+        self.protocol_version = protocol_version;
+        Ok(())
+    }
+
+    /// The unit the buffer writes designated timestamps in.
+    pub fn timestamp_precision(&self) -> TimestampPrecision {
+        self.ts_precision
+    }
+
+    /// Set the unit to write designated timestamps in. The default is
+    /// [`TimestampPrecision::Nanos`]. [`Sender::new_buffer`] creates a buffer
+    /// with the sender's precision already set.
+    ///
+    /// A timestamp given in the same unit, such as a [`TimestampMicros`] for
+    /// [`TimestampPrecision::Micros`], is written as is. Finer timestamps are
+    /// rounded down. The buffer must be empty.
+    pub fn set_timestamp_precision(&mut self, precision: TimestampPrecision) -> Result<()> {
+        if !self.is_empty() {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `set_timestamp_precision`: The buffer must be empty."
+            ));
+        }
+        self.ts_precision = precision;
+        Ok(())
+    }
+
+    /// Whether the buffer trusts its caller, as per
+    /// [`set_trusted`](Buffer::set_trusted).
+    pub fn is_trusted(&self) -> bool {
+        self.trusted
+    }
+
+    /// Trust the caller to follow the API's contract, turning the per-call
+    /// checks of the fluent API into debug-only assertions. This is meant for
+    /// code-generated producers with fixed schemas, whose calls are known to
+    /// be correct ahead of time.
+    ///
+    /// A trusted buffer no longer checks, in release builds, that:
+    /// * the calls come in order: [`table`](Buffer::table), then symbols, then
+    ///   columns, then [`at`](Buffer::at) or [`at_now`](Buffer::at_now);
+    /// * table and column names are no longer than `max_name_len`.
+    ///
+    /// Breaking either rule results in rows the server rejects or misparses,
+    /// but never in undefined behaviour. In debug builds, both rules are
+    /// still asserted and panic if broken.
+    ///
+    /// Everything else is still checked, including that the buffer ends at a
+    /// row boundary when it's flushed, the fixed capacity and the characters
+    /// of names converted from strings. To also skip the latter,
+    /// pass [`TableName::new_unchecked`] and [`ColumnName::new_unchecked`]
+    /// names.
+    pub fn set_trusted(&mut self, trusted: bool) {
+        self.trusted = trusted;
+    }
+
     /// Mark a rewind point.
     /// This allows undoing accumulated changes to the buffer for one or more
     /// rows by calling [`rewind_to_marker`](Buffer::rewind_to_marker).
@@ -639,8 +1186,17 @@ impl Buffer {
     ///
     /// As a side-effect, this also clears the marker.
     pub fn rewind_to_marker(&mut self) -> Result<()> {
+        if let Some((position, _)) = self.marker {
+            if position < self.send_offset {
+                return Err(error::fmt!(
+                    InvalidApiCall,
+                    "Can't rewind to the marker: The rows after it are already partially sent."
+                ));
+            }
+        }
         if let Some((position, state)) = self.marker.take() {
             self.output.truncate(position);
+            self.row_ends.truncate(state.row_count);
             self.state = state;
             Ok(())
         } else {
@@ -663,52 +1219,394 @@ impl Buffer {
     /// [`capacity`](Buffer::capacity).
     pub fn clear(&mut self) {
         self.output.clear();
+        self.row_ends.clear();
         self.state.clear();
         self.marker = None;
+        self.send_offset = 0;
     }
 
-    /// Check if the next API operation is allowed as per the OP case state machine.
-    #[inline(always)]
-    fn check_op(&self, op: Op) -> Result<()> {
-        if (self.state.op_case as isize & op as isize) > 0 {
-            Ok(())
-        } else {
-            Err(error::fmt!(
+    /// The offset in [`as_bytes`](Buffer::as_bytes) at which row number `row`
+    /// starts, counting from `0`. For `row` equal to the
+    /// [`row_count`](Buffer::row_count), the offset just past the last
+    /// complete row. `None` past that.
+    ///
+    /// The index is kept up to date as rows are appended, so this is a
+    /// lookup.
+    pub fn row_offset(&self, row: usize) -> Option<usize> {
+        match row {
+            0 => Some(0),
+            _ => self.row_ends.get(row - 1).copied(),
+        }
+    }
+
+    fn check_row_boundary(&self, method: &str) -> Result<()> {
+        if (self.state.op_case as isize & Op::Table as isize) == 0 {
+            return Err(error::fmt!(
                 InvalidApiCall,
-                "State error: Bad call to `{}`, {}.",
-                op.descr(),
-                self.state.op_case.next_op_descr()
-            ))
+                concat!(
+                    "Bad call to `{}`: A line is still being constructed. ",
+                    "Call `at` or `at_now` first."
+                ),
+                method
+            ));
         }
+        Ok(())
     }
 
-    #[inline(always)]
-    fn validate_max_name_len(&self, name: &str) -> Result<()> {
-        if name.len() > self.max_name_len {
+    fn check_row_range(&self, method: &str, rows: &Range<usize>) -> Result<()> {
+        if rows.start > rows.end || rows.end > self.row_count() {
             return Err(error::fmt!(
-                InvalidName,
-                "Bad name: {:?}: Too long (max {} characters)",
-                name,
-                self.max_name_len
+                InvalidApiCall,
+                "Bad call to `{}`: Rows {}..{} are out of range for a buffer of {} rows.",
+                method,
+                rows.start,
+                rows.end,
+                self.row_count()
+            ));
+        }
+        let start = self.row_offset(rows.start).unwrap();
+        let end = self.row_offset(rows.end).unwrap();
+        if start < self.send_offset && self.send_offset < end {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `{}`: Rows {}..{} are already partially sent.",
+                method,
+                rows.start,
+                rows.end
             ));
         }
         Ok(())
     }
 
-    /// Begin recording a new row for the given table.
+    /// Remove a range of complete rows, moving the rows after them down.
     ///
-    /// ```
+    /// Use it to drop the row a flush failed on, as reported by
+    /// [`Error::failed_row`](crate::Error::failed_row), or the rows the
+    /// server already accepted, then flush the rest again without
+    /// re-serializing it. Rows already sent by an unfinished
+    /// [`Sender::flush_chunked`] can be dropped as a whole, but not in
+    /// part. The marker, if any, is cleared.
+    ///
+    /// # Example
+    ///
+    /// ```no_run
     /// # use questdb::Result;
-    /// # use questdb::ingress::Buffer;
+    /// # use questdb::ingress::{Buffer, Sender};
     /// # fn main() -> Result<()> {
+    /// # let mut sender = Sender::from_conf("http::addr=localhost:9000;")?;
     /// # let mut buffer = Buffer::new();
-    /// buffer.table("table_name")?;
+    /// if let Err(err) = sender.flush_and_keep(&buffer) {
+    ///     match err.failed_row() {
+    ///         Some(row) => buffer.drop_rows(row..row + 1)?,
+    ///         None => return Err(err),
+    ///     }
+    ///     sender.flush(&mut buffer)?;
+    /// }
     /// # Ok(())
     /// # }
     /// ```
+    pub fn drop_rows(&mut self, rows: Range<usize>) -> Result<()> {
+        self.check_row_boundary("drop_rows")?;
+        self.check_row_range("drop_rows", &rows)?;
+        if rows.is_empty() {
+            return Ok(());
+        }
+        let start = self.row_offset(rows.start).unwrap();
+        let end = self.row_ends[rows.end - 1];
+        self.output.drain(start..end);
+        self.row_ends.drain(rows.clone());
+        for row_end in &mut self.row_ends[rows.start..] {
+            *row_end -= end - start;
+        }
+        if self.send_offset >= end {
+            self.send_offset -= end - start;
+        }
+        self.state.row_count -= rows.len();
+        self.marker = None;
+        self.retrack_tables();
+        Ok(())
+    }
+
+    /// Split the buffer at row number `row`, keeping the rows before it and
+    /// returning a new buffer holding it and the rows after it.
+    ///
+    /// The new buffer has the same settings as this one, including any
+    /// [fixed capacity](Buffer::with_fixed_capacity). Use it to send the tail
+    /// of a batch separately, e.g. from the row a flush failed on. The marker,
+    /// if any, is cleared.
+    pub fn split_at_row(&mut self, row: usize) -> Result<Buffer> {
+        self.check_row_boundary("split_at_row")?;
+        let rows = row..self.row_count();
+        self.check_row_range("split_at_row", &rows)?;
+        let start = self.row_offset(row).unwrap();
+        if start < self.send_offset {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `split_at_row`: Row {} is already sent.",
+                row
+            ));
+        }
+
+        let mut tail = match self.fixed_capacity {
+            Some(capacity) => Buffer::with_fixed_capacity(self.max_name_len, capacity),
+            None => Buffer::with_max_name_len(self.max_name_len),
+        };
+        tail.protocol_version = self.protocol_version;
+        tail.ts_precision = self.ts_precision;
+        tail.trusted = self.trusted;
+        tail.output.extend_from_slice(&self.output[start..]);
+        tail.row_ends
+            .extend(self.row_ends[row..].iter().map(|&row_end| row_end - start));
+        tail.state.row_count = rows.len();
+        tail.retrack_tables();
+
+        self.drop_rows(rows)?;
+        Ok(tail)
+    }
+
+    /// Append the complete rows of `other` to the end of this buffer,
+    /// leaving `other` untouched.
+    ///
+    /// The row count adds up, and the merged buffer is only
+    /// [transactional](Buffer::transactional) if both buffers were and they
+    /// target the same table. Use it to gather the rows of several buffers,
+    /// e.g. filled by different threads, into a single flush. See
+    /// [`ConcurrentSender`] for a front-end that does this for you.
+    ///
+    /// Both buffers must be at a row boundary and use the same
+    /// [protocol version](Buffer::protocol_version) and
+    /// [timestamp precision](Buffer::timestamp_precision), and `other` must
+    /// not be partially sent. The marker, if any, is kept.
+    pub fn append_buffer(&mut self, other: &Buffer) -> Result<()> {
+        self.check_row_boundary("append_buffer")?;
+        if (other.state.op_case as isize & Op::Table as isize) == 0 {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `append_buffer`: The appended buffer has an incomplete row."
+            ));
+        }
+        if other.is_empty() {
+            return Ok(());
+        }
+        if other.protocol_version != self.protocol_version {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `append_buffer`: Can't append a buffer of protocol version {} to one of version {}.",
+                other.protocol_version,
+                self.protocol_version
+            ));
+        }
+        if other.ts_precision != self.ts_precision {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `append_buffer`: Can't append a buffer of timestamp precision {:?} to one of precision {:?}.",
+                other.ts_precision,
+                self.ts_precision
+            ));
+        }
+        if other.send_offset != 0 {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `append_buffer`: The appended buffer is already partially sent."
+            ));
+        }
+        self.check_capacity(other.len())?;
+
+        let row_start = self.output.len();
+        self.output.extend_from_slice(&other.output);
+        self.row_ends
+            .extend(other.row_ends.iter().map(|&row_end| row_end + row_start));
+        if self.state.row_count == 0 {
+            self.state.first_table_len = other.state.first_table_len;
+            self.state.transactional = other.state.transactional;
+        } else {
+            if let Some(table_len) = other.state.first_table_len {
+                self.track_table(row_start, table_len);
+            }
+            self.state.transactional &= other.state.transactional;
+        }
+        self.state.row_count += other.state.row_count;
+        self.state.op_case = OpCase::MayFlushOrTable;
+        Ok(())
+    }
+
+    /// Append rows already serialized as ILP, such as received by a proxy,
+    /// without parsing them back into tables and columns.
+    ///
+    /// `bytes` must hold whole rows, each terminated by a newline, in the
+    /// buffer's [protocol version](Buffer::protocol_version). Row boundaries
+    /// are found with a vectorized scan that skips escaped newlines, quoted
+    /// strings and binary `f64` values: The row count and the
+    /// [transactional](Buffer::transactional) flag then stay accurate. With
+    /// `validate`, each row must also start with a table name and be valid
+    /// UTF-8. The rows are otherwise copied as they are.
+    ///
+    /// The buffer must be at a row boundary. On error, nothing is appended.
+    pub fn append_raw_ilp(&mut self, bytes: &[u8], validate: bool) -> Result<()> {
+        self.check_row_boundary("append_raw_ilp")?;
+        self.check_capacity(bytes.len())?;
+
+        let row_start = self.output.len();
+        let rows_before = self.row_ends.len();
+        let mut pos = 0;
+        while pos < bytes.len() {
+            let err = match find_row_end(bytes, pos, validate) {
+                RowEnd::Found(row_end)
+                    if validate && escaped_table_len(&bytes[pos..(row_end - 1)]) == 0 =>
+                {
+                    "has no table name"
+                }
+                RowEnd::Found(row_end) => {
+                    self.row_ends.push(row_start + row_end);
+                    pos = row_end;
+                    continue;
+                }
+                RowEnd::Unterminated => "is not terminated by a newline",
+                RowEnd::InvalidUtf8 => "is not valid UTF-8",
+            };
+            self.row_ends.truncate(rows_before);
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `append_raw_ilp`: The row at byte offset {} {}.",
+                pos,
+                err
+            ));
+        }
+        if self.row_ends.len() == rows_before {
+            return Ok(());
+        }
+
+        self.output.extend_from_slice(bytes);
+        let mut row_start = row_start;
+        for row in rows_before..self.row_ends.len() {
+            let table_len = escaped_table_len(&self.output[row_start..]);
+            self.track_table(row_start, table_len);
+            row_start = self.row_ends[row];
+        }
+        self.state.row_count += self.row_ends.len() - rows_before;
+        self.state.op_case = OpCase::MayFlushOrTable;
+        Ok(())
+    }
+
+    /// Work out again which tables the rows target, after rows were removed.
+    fn retrack_tables(&mut self) {
+        self.state.first_table_len = None;
+        self.state.transactional = true;
+        self.state.op_case = if self.state.row_count == 0 {
+            OpCase::Init
+        } else {
+            OpCase::MayFlushOrTable
+        };
+        for row in 0..self.state.row_count {
+            let row_start = self.row_offset(row).unwrap();
+            let table_len = escaped_table_len(&self.output[row_start..]);
+            self.track_table(row_start, table_len);
+        }
+    }
+
+    /// The end of the longest run of complete rows that starts at `offset`,
+    /// itself a row boundary, and spans at most `max_len` bytes.
+    fn chunk_end(&self, offset: usize, max_len: usize) -> Result<usize> {
+        let first = self.row_ends.partition_point(|&end| end <= offset);
+        // Only the rows from `offset` on: The ones before it end below it.
+        let last = first + self.row_ends[first..].partition_point(|&end| end - offset <= max_len);
+        if last > first {
+            Ok(self.row_ends[last - 1])
+        } else {
+            let row_len = self.row_ends[first] - offset;
+            Err(error::fmt!(
+                InvalidApiCall,
+                "Could not flush buffer: Row size of {} exceeds maximum configured allowed size of {} bytes.",
+                row_len,
+                max_len
+            ))
+        }
+    }
+
+    /// Check that appending up to `len_bound` more bytes stays within the
+    /// buffer's fixed capacity, if it has one.
+    #[inline(always)]
+    fn check_capacity(&self, len_bound: usize) -> Result<()> {
+        check_capacity(&self.output, self.fixed_capacity, len_bound)
+    }
+
+    /// Keep track of whether the buffer targets a single table, given the
+    /// escaped table name of the row that starts at `row_start`.
+    fn track_table(&mut self, row_start: usize, table_len: usize) {
+        match self.state.first_table_len {
+            Some(first_len) => {
+                let output = &self.output;
+                if output[..first_len] != output[row_start..(row_start + table_len)] {
+                    self.state.transactional = false;
+                }
+            }
+            None => self.state.first_table_len = Some(table_len),
+        }
+    }
+
+    /// Check if the next API operation is allowed as per the OP case state machine.
+    #[inline(always)]
+    fn check_op(&self, op: Op) -> Result<()> {
+        let allowed = (self.state.op_case as isize & op as isize) > 0;
+        // Trust relaxes the per-call checks only: A row boundary at flush
+        // time is always checked, lest an incomplete row reach the server.
+        if self.trusted && !matches!(op, Op::Flush) {
+            debug_assert!(
+                allowed,
+                "State error in trusted buffer: Bad call to `{}`, {}.",
+                op.descr(),
+                self.state.op_case.next_op_descr()
+            );
+            return Ok(());
+        }
+        if allowed {
+            Ok(())
+        } else {
+            Err(error::fmt!(
+                InvalidApiCall,
+                "State error: Bad call to `{}`, {}.",
+                op.descr(),
+                self.state.op_case.next_op_descr()
+            ))
+        }
+    }
+
+    #[inline(always)]
+    fn validate_max_name_len(&self, name: &str) -> Result<()> {
+        if self.trusted {
+            debug_assert!(
+                name.len() <= self.max_name_len,
+                "Bad name in trusted buffer: {:?}: Too long (max {} characters)",
+                name,
+                self.max_name_len
+            );
+            return Ok(());
+        }
+        if name.len() > self.max_name_len {
+            return Err(error::fmt!(
+                InvalidName,
+                "Bad name: {:?}: Too long (max {} characters)",
+                name,
+                self.max_name_len
+            ));
+        }
+        Ok(())
+    }
+
+    /// Begin recording a new row for the given table.
+    ///
+    /// ```
+    /// # use questdb::Result;
+    /// # use questdb::ingress::Buffer;
+    /// # fn main() -> Result<()> {
+    /// # let mut buffer = Buffer::new();
+    /// buffer.table("table_name")?;
+    /// # Ok(())
+    /// # }
+    /// ```
+    ///
+    /// or
     ///
-    /// or
-    ///
     /// ```
     /// # use questdb::Result;
     /// # use questdb::ingress::Buffer;
@@ -729,17 +1627,13 @@ impl Buffer {
         let name: TableName<'a> = name.try_into()?;
         self.validate_max_name_len(name.name)?;
         self.check_op(Op::Table)?;
+        self.check_capacity(escaped_len_bound(name.name))?;
+        let row_start = self.output.len();
         write_escaped_unquoted(&mut self.output, name.name);
         self.state.op_case = OpCase::TableWritten;
 
         // A buffer stops being transactional if it targets multiple tables.
-        if let Some(first_table) = &self.state.first_table {
-            if first_table != name.name {
-                self.state.transactional = false;
-            }
-        } else {
-            self.state.first_table = Some(name.name.to_owned());
-        }
+        self.track_table(row_start, self.output.len() - row_start);
         Ok(self)
     }
 
@@ -794,17 +1688,19 @@ impl Buffer {
         Error: From<N::Error>,
     {
         let name: ColumnName<'a> = name.try_into()?;
+        let value = value.as_ref();
         self.validate_max_name_len(name.name)?;
         self.check_op(Op::Symbol)?;
-        self.output.push(',');
-        write_escaped_unquoted(&mut self.output, name.name);
-        self.output.push('=');
-        write_escaped_unquoted(&mut self.output, value.as_ref());
+        self.check_capacity(key_len_bound(&name) + escaped_len_bound(value))?;
+        self.write_key(b',', name);
+        write_escaped_unquoted(&mut self.output, value);
         self.state.op_case = OpCase::SymbolWritten;
         Ok(self)
     }
 
-    fn write_column_key<'a, N>(&mut self, name: N) -> Result<&mut Self>
+    /// Write the key of a column whose value takes up to `value_len_bound`
+    /// bytes.
+    fn write_column_key<'a, N>(&mut self, name: N, value_len_bound: usize) -> Result<&mut Self>
     where
         N: TryInto<ColumnName<'a>>,
         Error: From<N::Error>,
@@ -812,18 +1708,33 @@ impl Buffer {
         let name: ColumnName<'a> = name.try_into()?;
         self.validate_max_name_len(name.name)?;
         self.check_op(Op::Column)?;
-        self.output
-            .push(if (self.state.op_case as isize & Op::Symbol as isize) > 0 {
-                ' '
-            } else {
-                ','
-            });
-        write_escaped_unquoted(&mut self.output, name.name);
-        self.output.push('=');
+        self.check_capacity(key_len_bound(&name) + value_len_bound)?;
+        let sep = if (self.state.op_case as isize & Op::Symbol as isize) > 0 {
+            b' '
+        } else {
+            b','
+        };
+        self.write_key(sep, name);
         self.state.op_case = OpCase::ColumnWritten;
         Ok(self)
     }
 
+    /// Write `{sep}name=`, copying the pre-escaped key if there is one.
+    fn write_key(&mut self, sep: u8, name: ColumnName<'_>) {
+        match name.key {
+            Some(key) if sep == b',' => self.output.extend_from_slice(key.as_bytes()),
+            Some(key) => {
+                self.output.push(sep);
+                self.output.extend_from_slice(&key.as_bytes()[1..]);
+            }
+            None => {
+                self.output.push(sep);
+                write_escaped_unquoted(&mut self.output, name.name);
+                self.output.push(b'=');
+            }
+        }
+    }
+
     /// Record a boolean value for the given column.
     ///
     /// ```
@@ -857,8 +1768,8 @@ impl Buffer {
         N: TryInto<ColumnName<'a>>,
         Error: From<N::Error>,
     {
-        self.write_column_key(name)?;
-        self.output.push(if value { 't' } else { 'f' });
+        self.write_column_key(name, 1)?;
+        self.output.push(if value { b't' } else { b'f' });
         Ok(self)
     }
 
@@ -895,11 +1806,11 @@ impl Buffer {
         N: TryInto<ColumnName<'a>>,
         Error: From<N::Error>,
     {
-        self.write_column_key(name)?;
+        self.write_column_key(name, MAX_I64_LEN + 1)?;
         let mut buf = itoa::Buffer::new();
         let printed = buf.format(value);
-        self.output.push_str(printed);
-        self.output.push('i');
+        self.output.extend_from_slice(printed.as_bytes());
+        self.output.push(b'i');
         Ok(self)
     }
 
@@ -931,14 +1842,63 @@ impl Buffer {
     /// # Ok(())
     /// # }
     /// ```
+    ///
+    /// If the name is a [`PreparedColumnName`] with
+    /// [fixed decimals](PreparedColumnName::with_decimals), the value is
+    /// formatted as by [`column_f64_fixed`](Buffer::column_f64_fixed).
     pub fn column_f64<'a, N>(&mut self, name: N, value: f64) -> Result<&mut Self>
     where
         N: TryInto<ColumnName<'a>>,
         Error: From<N::Error>,
     {
-        self.write_column_key(name)?;
-        let mut ser = F64Serializer::new(value);
-        self.output.push_str(ser.as_str());
+        let name: ColumnName<'a> = name.try_into()?;
+        let decimals = name.decimals;
+        self.write_column_key(name, MAX_F64_LEN)?;
+        write_f64_decimals(&mut self.output, self.protocol_version, value, decimals);
+        Ok(self)
+    }
+
+    /// Record a floating point value for the given column, rounded to
+    /// `decimals` places, at most 15.
+    ///
+    /// For values of a known precision, such as prices, this formats the
+    /// value as a scaled integer rather than searching for its shortest
+    /// round-trip representation, which is faster and drops the noise digits:
+    /// `101.25000000000001` at 8 decimals is sent as `101.25`. Trailing zeros
+    /// are dropped too.
+    ///
+    /// Values whose scaled magnitude exceeds 2^53, and so can't be rounded
+    /// exactly, are sent as by [`column_f64`](Buffer::column_f64), as are all
+    /// values with [`ProtocolVersion::V2`], whose binary format is exact.
+    ///
+    /// ```
+    /// # use questdb::Result;
+    /// # use questdb::ingress::Buffer;
+    /// # fn main() -> Result<()> {
+    /// # let mut buffer = Buffer::new();
+    /// # buffer.table("x")?;
+    /// buffer.column_f64_fixed("price", 101.25000000000001, 8)?;
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn column_f64_fixed<'a, N>(
+        &mut self,
+        name: N,
+        value: f64,
+        decimals: u8,
+    ) -> Result<&mut Self>
+    where
+        N: TryInto<ColumnName<'a>>,
+        Error: From<N::Error>,
+    {
+        check_decimals("column_f64_fixed", decimals)?;
+        self.write_column_key(name, MAX_F64_LEN)?;
+        write_f64_decimals(
+            &mut self.output,
+            self.protocol_version,
+            value,
+            Some(decimals),
+        );
         Ok(self)
     }
 
@@ -990,8 +1950,9 @@ impl Buffer {
         S: AsRef<str>,
         Error: From<N::Error>,
     {
-        self.write_column_key(name)?;
-        write_escaped_quoted(&mut self.output, value.as_ref());
+        let value = value.as_ref();
+        self.write_column_key(name, escaped_len_bound(value) + 2)?;
+        write_escaped_quoted(&mut self.output, value);
         Ok(self)
     }
 
@@ -1054,24 +2015,38 @@ impl Buffer {
         Error: From<N::Error>,
         Error: From<T::Error>,
     {
-        self.write_column_key(name)?;
+        self.write_column_key(name, MAX_I64_LEN + 1)?;
         let timestamp: Timestamp = value.try_into()?;
         let timestamp: TimestampMicros = timestamp.try_into()?;
-        let mut buf = itoa::Buffer::new();
-        let printed = buf.format(timestamp.as_i64());
-        self.output.push_str(printed);
-        self.output.push('t');
+        write_timestamp(&mut self.output, timestamp.as_i64());
+        self.output.push(b't');
         Ok(self)
     }
 
+    /// Record a 256-bit unsigned integer value for the given column.
+    ///
+    /// The value is given as 32 big-endian bytes.
+    ///
+    /// ```
+    /// # use questdb::Result;
+    /// # use questdb::ingress::Buffer;
+    /// # fn main() -> Result<()> {
+    /// # let mut buffer = Buffer::new();
+    /// # buffer.table("x")?;
+    /// let mut value = [0u8; 32];
+    /// value[31] = 0xff;
+    /// buffer.column_long256("col_name", value)?;
+    /// # Ok(())
+    /// # }
+    /// ```
     pub fn column_long256<'a, N>(&mut self, name: N, value: [u8; 32]) -> Result<&mut Self>
     where
         N: TryInto<ColumnName<'a>>,
         Error: From<N::Error>,
     {
-        self.write_column_key(name)?;
-        let ser = format!("0x{}i", hex::encode(value));
-        self.output.push_str(ser.as_str());
+        self.write_column_key(name, LONG256_LEN)?;
+        self.output
+            .extend_from_slice(Long256Serializer::new(&value).as_str().as_bytes());
         Ok(self)
     }
 
@@ -1106,7 +2081,8 @@ impl Buffer {
     /// # }
     /// ```
     ///
-    /// You can also pass in a `TimestampMicros`.
+    /// You can also pass in a `TimestampMicros`. The timestamp is written in
+    /// the buffer's [precision](Buffer::timestamp_precision).
     ///
     /// Note that both `TimestampMicros` and `TimestampNanos` can be constructed
     /// easily from either `chrono::DateTime` and `std::time::SystemTime`.
@@ -1116,29 +2092,76 @@ impl Buffer {
         T: TryInto<Timestamp>,
         Error: From<T::Error>,
     {
-        self.check_op(Op::At)?;
-        let timestamp: Timestamp = timestamp.try_into()?;
+        let epoch = self.check_at(timestamp)?;
+        self.output.push(b' ');
+        write_timestamp(&mut self.output, epoch);
+        self.output.push(b'\n');
+        self.row_ends.push(self.output.len());
+        self.state.op_case = OpCase::MayFlushOrTable;
+        self.state.row_count += 1;
+        Ok(())
+    }
 
-        // https://github.com/rust-lang/rust/issues/115880
-        let timestamp: Result<TimestampNanos> = timestamp.try_into();
-        let timestamp: TimestampNanos = timestamp?;
+    /// Complete the current row with the designated timestamp, like
+    /// [`at`](Buffer::at), but format it faster when consecutive rows have
+    /// close timestamps.
+    ///
+    /// The buffer remembers the leading digits of the last timestamp passed to
+    /// `at_delta`. When the next timestamp only differs in its last 8 digits,
+    /// as is the case for most nanosecond timestamps less than 100ms apart,
+    /// only those 8 digits are formatted. The rows are identical to the ones
+    /// [`at`](Buffer::at) writes.
+    ///
+    /// ```
+    /// # use questdb::Result;
+    /// # use questdb::ingress::Buffer;
+    /// # use questdb::ingress::TimestampNanos;
+    /// # fn main() -> Result<()> {
+    /// # let mut buffer = Buffer::new();
+    /// for (index, price) in [2615.54, 2615.55].iter().enumerate() {
+    ///     buffer
+    ///         .table("trades")?
+    ///         .column_f64("price", *price)?
+    ///         .at_delta(TimestampNanos::new(1659548315647406592 + index as i64))?;
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn at_delta<T>(&mut self, timestamp: T) -> Result<()>
+    where
+        T: TryInto<Timestamp>,
+        Error: From<T::Error>,
+    {
+        let epoch = self.check_at(timestamp)?;
+        self.output.push(b' ');
+        self.ts_cache.write(&mut self.output, epoch);
+        self.output.push(b'\n');
+        self.row_ends.push(self.output.len());
+        self.state.op_case = OpCase::MayFlushOrTable;
+        self.state.row_count += 1;
+        Ok(())
+    }
 
-        let epoch_nanos = timestamp.as_i64();
-        if epoch_nanos < 0 {
+    /// Validate a call to [`at`](Buffer::at), returning the timestamp in the
+    /// buffer's [precision](Buffer::timestamp_precision).
+    #[inline(always)]
+    fn check_at<T>(&self, timestamp: T) -> Result<i64>
+    where
+        T: TryInto<Timestamp>,
+        Error: From<T::Error>,
+    {
+        self.check_op(Op::At)?;
+        let timestamp: Timestamp = timestamp.try_into()?;
+        let epoch = self.ts_precision.convert(timestamp)?;
+        if epoch < 0 {
             return Err(error::fmt!(
                 InvalidTimestamp,
                 "Timestamp {} is negative. It must be >= 0.",
-                epoch_nanos
+                epoch
             ));
         }
-        let mut buf = itoa::Buffer::new();
-        let printed = buf.format(epoch_nanos);
-        self.output.push(' ');
-        self.output.push_str(printed);
-        self.output.push('\n');
-        self.state.op_case = OpCase::MayFlushOrTable;
-        self.state.row_count += 1;
-        Ok(())
+        self.check_capacity(MAX_I64_LEN + 2)?;
+        Ok(epoch)
     }
 
     /// Complete the current row without providing a timestamp. The QuestDB instance
@@ -1171,11 +2194,23 @@ impl Buffer {
     /// ```
     pub fn at_now(&mut self) -> Result<()> {
         self.check_op(Op::At)?;
-        self.output.push('\n');
+        self.check_capacity(1)?;
+        self.output.push(b'\n');
+        self.row_ends.push(self.output.len());
         self.state.op_case = OpCase::MayFlushOrTable;
         self.state.row_count += 1;
         Ok(())
     }
+
+    /// Complete the current row with the current time of `clock` as the
+    /// designated timestamp. Cheaper than passing [`TimestampNanos::now`] to
+    /// [`at`](Buffer::at): See [`FastClock`].
+    ///
+    /// Since consecutive readings are close, the timestamp is formatted as
+    /// per [`at_delta`](Buffer::at_delta).
+    pub fn at_clock(&mut self, clock: &FastClock) -> Result<()> {
+        self.at_delta(clock.now())
+    }
 }
 
 impl Default for Buffer {
@@ -1193,7 +2228,27 @@ pub struct Sender {
     descr: String,
     handler: ProtocolHandler,
     connected: bool,
+
+    /// Set by [`SenderBuilder::reconnect_timeout`].
+    reconnect: Option<Reconnector>,
     max_buf_size: usize,
+    auto_flush: Option<AutoFlush>,
+    last_flush: Instant,
+    nonblocking: bool,
+    protocol_version: ProtocolVersion,
+    ts_precision: TimestampPrecision,
+    stats: StatsRecorder,
+    tracer: Tracer,
+    rate_limiter: Option<Arc<RateLimiter>>,
+}
+
+/// Thresholds that make [`Sender::should_flush`] report a buffer as due.
+/// Any threshold that is reached triggers the flush.
+#[derive(Debug, Clone, Copy)]
+struct AutoFlush {
+    rows: Option<usize>,
+    bytes: Option<usize>,
+    interval: Option<Duration>,
 }
 
 impl std::fmt::Debug for Sender {
@@ -1242,6 +2297,18 @@ pub enum CertificateAuthority {
     PemFile,
 }
 
+/// How an ILP/TCP sender writes to its socket.
+/// See [`SenderBuilder::io_backend`].
+#[derive(PartialEq, Eq, Debug, Clone, Copy)]
+pub enum IoBackend {
+    /// Plain blocking `send` calls.
+    Std,
+
+    /// Submit the writes through an io_uring. This requires Linux and the
+    /// `io-uring` feature.
+    Uring,
+}
+
 /// A `u16` port number or `String` port service name as is registered with
 /// `/etc/services` or equivalent.
 ///
@@ -1356,6 +2423,28 @@ fn add_os_roots(root_store: &mut RootCertStore) -> Result<()> {
     Ok(())
 }
 
+/// Number of TLS sessions remembered for resumption, across all the senders
+/// sharing a client config.
+const TLS_SESSION_CACHE_SIZE: usize = 256;
+
+struct TlsConfigEntry {
+    tls_verify: bool,
+    tls_ca: CertificateAuthority,
+    tls_roots: Option<PathBuf>,
+
+    /// The modification time of the `tls_roots` file when it was loaded, so
+    /// that a replaced file is reloaded.
+    roots_modified: Option<SystemTime>,
+    config: Arc<rustls::ClientConfig>,
+}
+
+/// The client configs built so far, shared by all senders. Sharing a config
+/// shares its root store and its session cache, so that new senders and
+/// reconnects resume earlier TLS sessions rather than perform a full
+/// handshake. There are only ever a handful of configs, so a linear scan
+/// will do.
+static TLS_CONFIGS: Mutex<Vec<TlsConfigEntry>> = Mutex::new(Vec::new());
+
 fn configure_tls(
     tls_enabled: bool,
     tls_verify: bool,
@@ -1366,6 +2455,43 @@ fn configure_tls(
         return Ok(None);
     }
 
+    let roots_modified = tls_roots
+        .as_ref()
+        .and_then(|path| std::fs::metadata(path).ok())
+        .and_then(|metadata| metadata.modified().ok());
+    let mut configs = TLS_CONFIGS
+        .lock()
+        .unwrap_or_else(|poisoned| poisoned.into_inner());
+    let entry = configs.iter().find(|entry| {
+        entry.tls_verify == tls_verify
+            && entry.tls_ca == tls_ca
+            && &entry.tls_roots == tls_roots
+            && entry.roots_modified == roots_modified
+    });
+    if let Some(entry) = entry {
+        return Ok(Some(entry.config.clone()));
+    }
+
+    // Entries for an older version of the same `tls_roots` file are stale.
+    configs.retain(|entry| {
+        !(entry.tls_verify == tls_verify && entry.tls_ca == tls_ca && &entry.tls_roots == tls_roots)
+    });
+    let config = new_tls_config(tls_verify, tls_ca, tls_roots)?;
+    configs.push(TlsConfigEntry {
+        tls_verify,
+        tls_ca,
+        tls_roots: tls_roots.clone(),
+        roots_modified,
+        config: config.clone(),
+    });
+    Ok(Some(config))
+}
+
+fn new_tls_config(
+    tls_verify: bool,
+    tls_ca: CertificateAuthority,
+    tls_roots: &Option<PathBuf>,
+) -> Result<Arc<rustls::ClientConfig>> {
     let mut root_store = RootCertStore::empty();
     if tls_verify {
         match (tls_ca, tls_roots) {
@@ -1443,6 +2569,9 @@ fn configure_tls(
     // Set the SSLKEYLOGFILE env variable to a writable location.
     config.key_log = Arc::new(rustls::KeyLogFile::new());
 
+    // Resume with TLS 1.3 session tickets, or TLS 1.2 session IDs and tickets.
+    config.resumption = rustls::client::Resumption::in_memory_sessions(TLS_SESSION_CACHE_SIZE);
+
     #[cfg(feature = "insecure-skip-verify")]
     if !tls_verify {
         config
@@ -1450,30 +2579,7 @@ fn configure_tls(
             .set_certificate_verifier(Arc::new(danger::NoCertificateVerification {}));
     }
 
-    Ok(Some(Arc::new(config)))
-}
-
-fn validate_auto_flush_params(params: &HashMap<String, String>) -> Result<()> {
-    if let Some(auto_flush) = params.get("auto_flush") {
-        if auto_flush.as_str() != "off" {
-            return Err(error::fmt!(
-                ConfigError,
-                "Invalid auto_flush value '{auto_flush}'. This client does not \
-                support auto-flush, so the only accepted value is 'off'"
-            ));
-        }
-    }
-
-    for &param in ["auto_flush_rows", "auto_flush_bytes"].iter() {
-        if params.contains_key(param) {
-            return Err(error::fmt!(
-                ConfigError,
-                "Invalid configuration parameter {:?}. This client does not support auto-flush",
-                param
-            ));
-        }
-    }
-    Ok(())
+    Ok(Arc::new(config))
 }
 
 /// Protocol used to communicate with the QuestDB server.
@@ -1565,6 +2671,30 @@ impl Protocol {
     }
 }
 
+/// Version of the line protocol a [`Buffer`] is encoded with.
+///
+/// Set it on the sender with the `protocol_version` config key, or
+/// [`SenderBuilder::protocol_version`], and create buffers to match with
+/// [`Sender::new_buffer`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
+pub enum ProtocolVersion {
+    /// All values are written as text. Accepted by every QuestDB server.
+    V1 = 1,
+
+    /// `f64` column values are written in binary, as a second `=`, a type
+    /// tag and 8 little-endian bytes. This spares formatting the value as
+    /// decimal text on the client and parsing it back on the server, and caps
+    /// each value at 10 bytes. Only newer servers accept it: Check with
+    /// `protocol_version=auto`.
+    V2 = 2,
+}
+
+impl Display for ProtocolVersion {
+    fn fmt(&self, f: &mut Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
+        write!(f, "{}", *self as u8)
+    }
+}
+
 /// Accumulates parameters for a new `Sender` instance.
 ///
 /// You can also create the builder from a config string or the `QDB_CLIENT_CONF`
@@ -1620,6 +2750,10 @@ pub struct SenderBuilder {
     protocol: Protocol,
     host: ConfigSetting<String>,
     port: ConfigSetting<String>,
+
+    /// Hosts to try in turn, after `host`, if it can't be reached.
+    failover: Vec<(String, String)>,
+
     net_interface: ConfigSetting<Option<String>>,
     max_buf_size: ConfigSetting<usize>,
     auth_timeout: ConfigSetting<Duration>,
@@ -1635,11 +2769,36 @@ pub struct SenderBuilder {
     tls_ca: ConfigSetting<CertificateAuthority>,
     tls_roots: ConfigSetting<Option<PathBuf>>,
 
-    #[cfg(feature = "ilp-over-http")]
-    http: Option<HttpConfig>,
-}
+    auto_flush: ConfigSetting<bool>,
+    auto_flush_rows: ConfigSetting<Option<usize>>,
+    auto_flush_bytes: ConfigSetting<Option<usize>>,
+    auto_flush_interval: ConfigSetting<Option<Duration>>,
 
-impl SenderBuilder {
+    pool_size: ConfigSetting<usize>,
+
+    max_send_rate: ConfigSetting<Option<u64>>,
+    max_rows_rate: ConfigSetting<Option<u64>>,
+
+    reconnect_timeout: ConfigSetting<Option<Duration>>,
+    replay_buffers: ConfigSetting<usize>,
+
+    io_backend: ConfigSetting<IoBackend>,
+    uring_sqpoll: ConfigSetting<bool>,
+    uring_sqpoll_cpu: ConfigSetting<Option<u32>>,
+    uring_zc_threshold: ConfigSetting<Option<usize>>,
+
+    /// Set by [`SenderPool`] so that its senders share their rate limits.
+    rate_limiter: Option<Arc<RateLimiter>>,
+
+    /// `None` asks the server which version to use.
+    protocol_version: ConfigSetting<Option<ProtocolVersion>>,
+    timestamp_precision: ConfigSetting<TimestampPrecision>,
+
+    #[cfg(feature = "ilp-over-http")]
+    http: Option<HttpConfig>,
+}
+
+impl SenderBuilder {
     /// Create a new `SenderBuilder` instance from the configuration string.
     ///
     /// The format of the string is: `"http::addr=host:port;key=value;...;"`.
@@ -1681,13 +2840,15 @@ impl SenderBuilder {
                 "Missing \"addr\" parameter in config string"
             ));
         };
-        let (host, port) = match addr.split_once(':') {
-            Some((h, p)) => (h, p),
-            None => (addr.as_str(), protocol.default_port()),
-        };
+        let mut addrs = addr
+            .split(',')
+            .map(|addr| parse_addr(addr.trim(), protocol.default_port()));
+        let (host, port) = addrs.next().expect("split yields at least one item")?;
         let mut builder = SenderBuilder::new(protocol, host, port);
-
-        validate_auto_flush_params(params)?;
+        for addr in addrs {
+            let (host, port) = addr?;
+            builder = builder.failover_addr(host, port)?;
+        }
 
         for (key, val) in params.iter().map(|(k, v)| (k.as_str(), v.as_str())) {
             builder = match key {
@@ -1711,6 +2872,36 @@ impl SenderBuilder {
                     builder.auth_timeout(Duration::from_millis(parse_conf_value(key, val)?))?
                 }
 
+                "reconnect_timeout" => builder.reconnect_timeout(
+                    parse_conf_value_or_off(key, val)?.map(Duration::from_millis),
+                )?,
+
+                "replay_buffers" => builder.replay_buffers(parse_conf_value(key, val)?)?,
+
+                "io_backend" => {
+                    let backend = match val {
+                        "std" => IoBackend::Std,
+                        "uring" => IoBackend::Uring,
+                        _ => return Err(error::fmt!(ConfigError, "Invalid value {val:?} for \"io_backend\"")),
+                    };
+                    builder.io_backend(backend)?
+                }
+
+                "uring_sqpoll" => {
+                    let sqpoll = match val {
+                        "on" => true,
+                        "off" => false,
+                        _ => return Err(error::fmt!(ConfigError, "Invalid value {val:?} for \"uring_sqpoll\"")),
+                    };
+                    builder.uring_sqpoll(sqpoll)?
+                }
+
+                "uring_sqpoll_cpu" => builder.uring_sqpoll_cpu(parse_conf_value(key, val)?)?,
+
+                "uring_zc_threshold" => {
+                    builder.uring_zc_threshold(parse_conf_value_or_off(key, val)?)?
+                }
+
                 "tls_verify" => {
                     let verify = match val {
                         "on" => true,
@@ -1782,6 +2973,61 @@ impl SenderBuilder {
                     ))
                 }
 
+                "auto_flush" => {
+                    let enabled = match val {
+                        "on" => true,
+                        "off" => false,
+                        _ => {
+                            return Err(error::fmt!(
+                                ConfigError,
+                                r##"Config parameter "auto_flush" must be either "on" or "off"."##,
+                            ))
+                        }
+                    };
+                    builder.auto_flush(enabled)?
+                }
+
+                "auto_flush_rows" => builder.auto_flush_rows(parse_conf_value_or_off(key, val)?)?,
+
+                "auto_flush_bytes" => {
+                    builder.auto_flush_bytes(parse_conf_value_or_off(key, val)?)?
+                }
+
+                "auto_flush_interval" => builder.auto_flush_interval(
+                    parse_conf_value_or_off(key, val)?.map(Duration::from_millis),
+                )?,
+
+                "pool_size" => builder.pool_size(parse_conf_value(key, val)?)?,
+
+                "max_send_rate" => builder.max_send_rate(parse_conf_value_or_off(key, val)?)?,
+
+                "max_rows_rate" => builder.max_rows_rate(parse_conf_value_or_off(key, val)?)?,
+
+                "timestamp_precision" => builder.timestamp_precision(match val {
+                    "n" => TimestampPrecision::Nanos,
+                    "us" => TimestampPrecision::Micros,
+                    "ms" => TimestampPrecision::Millis,
+                    "s" => TimestampPrecision::Seconds,
+                    _ => {
+                        return Err(error::fmt!(
+                            ConfigError,
+                            r##"Config parameter "timestamp_precision" must be one of "n", "us", "ms" or "s"."##,
+                        ))
+                    }
+                })?,
+
+                "protocol_version" => builder.protocol_version(match val {
+                    "1" => Some(ProtocolVersion::V1),
+                    "2" => Some(ProtocolVersion::V2),
+                    "auto" => None,
+                    _ => {
+                        return Err(error::fmt!(
+                            ConfigError,
+                            r##"Config parameter "protocol_version" must be either "1", "2" or "auto"."##,
+                        ))
+                    }
+                })?,
+
                 #[cfg(feature = "ilp-over-http")]
                 "request_min_throughput" => {
                     builder.request_min_throughput(parse_conf_value(key, val)?)?
@@ -1792,10 +3038,143 @@ impl SenderBuilder {
                     builder.request_timeout(Duration::from_millis(parse_conf_value(key, val)?))?
                 }
 
+                #[cfg(feature = "ilp-over-http")]
+                "compression" => {
+                    let compression = match val {
+                        "none" => Compression::None,
+
+                        #[cfg(feature = "compression-gzip")]
+                        "gzip" => Compression::Gzip,
+
+                        #[cfg(not(feature = "compression-gzip"))]
+                        "gzip" => return Err(error::fmt!(ConfigError, "Config parameter \"compression=gzip\" requires the \"compression-gzip\" feature")),
+
+                        #[cfg(feature = "compression-zstd")]
+                        "zstd" => Compression::Zstd,
+
+                        #[cfg(not(feature = "compression-zstd"))]
+                        "zstd" => return Err(error::fmt!(ConfigError, "Config parameter \"compression=zstd\" requires the \"compression-zstd\" feature")),
+
+                        _ => return Err(error::fmt!(ConfigError, "Invalid value {val:?} for \"compression\"")),
+                    };
+                    builder.compression(compression)?
+                }
+
+                #[cfg(feature = "ilp-over-http")]
+                "spool_dir" => {
+                    let path = PathBuf::from_str(val).map_err(|e| {
+                        error::fmt!(
+                            ConfigError,
+                            "Invalid path {:?} for \"spool_dir\": {}",
+                            val,
+                            e
+                        )
+                    })?;
+                    builder.spool_dir(path)?
+                }
+
+                #[cfg(feature = "ilp-over-http")]
+                "spool_max_bytes" => builder.spool_max_bytes(parse_conf_value(key, val)?)?,
+
                 #[cfg(feature = "ilp-over-http")]
                 "retry_timeout" => {
                     builder.retry_timeout(Duration::from_millis(parse_conf_value(key, val)?))?
                 }
+
+                #[cfg(feature = "ilp-over-http")]
+                "retry_backoff" => {
+                    let backoff = match val {
+                        "exponential" => RetryBackoff::Exponential,
+                        "full_jitter" => RetryBackoff::FullJitter,
+                        "decorrelated" => RetryBackoff::Decorrelated,
+                        _ => {
+                            return Err(error::fmt!(
+                                ConfigError,
+                                r##"Config parameter "retry_backoff" must be one of "exponential", "full_jitter" or "decorrelated"."##,
+                            ))
+                        }
+                    };
+                    builder.retry_backoff(backoff)?
+                }
+
+                #[cfg(feature = "ilp-over-http")]
+                "retry_after" => {
+                    let enabled = match val {
+                        "on" => true,
+                        "off" => false,
+                        _ => {
+                            return Err(error::fmt!(
+                                ConfigError,
+                                r##"Config parameter "retry_after" must be either "on" or "off"."##,
+                            ))
+                        }
+                    };
+                    builder.retry_after(enabled)?
+                }
+
+                #[cfg(feature = "ilp-over-http")]
+                "retry_budget" => builder.retry_budget(parse_conf_value(key, val)?)?,
+
+                #[cfg(feature = "ilp-over-http")]
+                "circuit_breaker_threshold" => {
+                    builder.circuit_breaker_threshold(parse_conf_value(key, val)?)?
+                }
+
+                #[cfg(feature = "ilp-over-http")]
+                "circuit_breaker_cooldown" => builder
+                    .circuit_breaker_cooldown(Duration::from_millis(parse_conf_value(key, val)?))?,
+
+                #[cfg(feature = "ilp-over-http")]
+                "prewarm" => {
+                    let enabled = match val {
+                        "on" => true,
+                        "off" => false,
+                        _ => {
+                            return Err(error::fmt!(
+                                ConfigError,
+                                r##"Config parameter "prewarm" must be either "on" or "off"."##,
+                            ))
+                        }
+                    };
+                    builder.prewarm(enabled)?
+                }
+
+                #[cfg(feature = "ilp-over-http")]
+                "ping_interval" => builder.ping_interval(
+                    parse_conf_value_or_off(key, val)?.map(Duration::from_millis),
+                )?,
+
+                #[cfg(feature = "ilp-over-http")]
+                "stream_replay_window" => {
+                    builder.stream_replay_window(parse_conf_value(key, val)?)?
+                }
+
+                #[cfg(feature = "ilp-over-http")]
+                "http2" => {
+                    let enabled = match val {
+                        "on" => true,
+                        "off" => false,
+                        _ => {
+                            return Err(error::fmt!(
+                                ConfigError,
+                                r##"Config parameter "http2" must be either "on" or "off"."##,
+                            ))
+                        }
+                    };
+
+                    #[cfg(feature = "ilp-over-http2")]
+                    let builder = builder.http2(enabled)?;
+
+                    #[cfg(not(feature = "ilp-over-http2"))]
+                    if enabled {
+                        return Err(error::fmt!(
+                            ConfigError,
+                            "Config parameter \"http2=on\" requires the \"ilp-over-http2\" feature"
+                        ));
+                    }
+
+                    builder
+                }
                 // Ignore other parameters.
                 // We don't want to fail on unknown keys as this would require releasing different
                 // library implementations in lock step as soon as a new parameter is added to any of them,
@@ -1804,6 +3183,17 @@ impl SenderBuilder {
             };
         }
 
+        if !*builder.auto_flush {
+            for param in ["auto_flush_rows", "auto_flush_bytes", "auto_flush_interval"] {
+                if params.contains_key(param) {
+                    return Err(error::fmt!(
+                        ConfigError,
+                        "Config parameter {param:?} can't be set when \"auto_flush=off\"."
+                    ));
+                }
+            }
+        }
+
         Ok(builder)
     }
 
@@ -1849,6 +3239,7 @@ impl SenderBuilder {
             protocol,
             host: ConfigSetting::new_specified(host),
             port: ConfigSetting::new_specified(port),
+            failover: Vec::new(),
             net_interface: ConfigSetting::new_default(None),
             max_buf_size: ConfigSetting::new_default(100 * 1024 * 1024),
             auth_timeout: ConfigSetting::new_default(Duration::from_secs(15)),
@@ -1864,6 +3255,28 @@ impl SenderBuilder {
             tls_ca: ConfigSetting::new_default(tls_ca),
             tls_roots: ConfigSetting::new_default(None),
 
+            auto_flush: ConfigSetting::new_default(true),
+            auto_flush_rows: ConfigSetting::new_default(Some(if protocol.is_httpx() {
+                75000
+            } else {
+                600
+            })),
+            auto_flush_bytes: ConfigSetting::new_default(None),
+            auto_flush_interval: ConfigSetting::new_default(Some(Duration::from_secs(1))),
+
+            pool_size: ConfigSetting::new_default(1),
+            max_send_rate: ConfigSetting::new_default(None),
+            max_rows_rate: ConfigSetting::new_default(None),
+            reconnect_timeout: ConfigSetting::new_default(None),
+            replay_buffers: ConfigSetting::new_default(0),
+            io_backend: ConfigSetting::new_default(IoBackend::Std),
+            uring_sqpoll: ConfigSetting::new_default(false),
+            uring_sqpoll_cpu: ConfigSetting::new_default(None),
+            uring_zc_threshold: ConfigSetting::new_default(Some(64 * 1024)),
+            rate_limiter: None,
+            protocol_version: ConfigSetting::new_default(Some(ProtocolVersion::V1)),
+            timestamp_precision: ConfigSetting::new_default(TimestampPrecision::Nanos),
+
             #[cfg(feature = "ilp-over-http")]
             http: if protocol.is_httpx() {
                 Some(HttpConfig::default())
@@ -1873,6 +3286,36 @@ impl SenderBuilder {
         }
     }
 
+    /// Add a host to fail over to when the ones before it can't be reached.
+    ///
+    /// Hosts are tried in the order they were added, after the one passed to
+    /// [`new`](SenderBuilder::new). Over ILP/TCP, the sender connects to the
+    /// first host that accepts. Over ILP/HTTP, each request goes to the last
+    /// host that responded, moving on to the next one after a network error
+    /// or a 5xx status.
+    ///
+    /// In the config string, list the hosts in `addr`, separated by commas:
+    /// `addr=db1:9000,db2:9000;`.
+    pub fn failover_addr<H: Into<String>, P: Into<Port>>(
+        mut self,
+        host: H,
+        port: P,
+    ) -> Result<Self> {
+        let host = validate_value(host.into())?;
+        let port = validate_value(port.into().0)?;
+        self.failover.push((host, port));
+        Ok(self)
+    }
+
+    /// The hosts to connect to, in order of preference.
+    fn hosts(&self) -> impl Iterator<Item = (&str, &str)> {
+        std::iter::once((self.host.as_str(), self.port.as_str())).chain(
+            self.failover
+                .iter()
+                .map(|(host, port)| (host.as_str(), port.as_str())),
+        )
+    }
+
     /// Select local outbound interface.
     ///
     /// This may be relevant if your machine has multiple network interfaces.
@@ -1937,6 +3380,102 @@ impl SenderBuilder {
         Ok(self)
     }
 
+    /// Reconnect automatically after an ILP/TCP write error, or `None` to
+    /// leave the sender [closed](Sender::must_close). This only applies to TCP.
+    ///
+    /// Once the connection is lost, a background thread reconnects with an
+    /// exponential backoff from 10 milliseconds up to 1 second, including the
+    /// TLS handshake and authentication. A flush waits for the new connection
+    /// for at most `value`, then replays the
+    /// [last flushed buffers](SenderBuilder::replay_buffers) and resends its
+    /// own. If the wait times out, the flush fails but the sender stays usable:
+    /// The background thread keeps trying and the next flush waits again.
+    ///
+    /// The default is `None`.
+    pub fn reconnect_timeout(mut self, value: Option<Duration>) -> Result<Self> {
+        self.ensure_is_tcpx("reconnect_timeout")?;
+        self.reconnect_timeout
+            .set_specified("reconnect_timeout", value)?;
+        Ok(self)
+    }
+
+    /// The number of most recently flushed buffers to keep a copy of and
+    /// replay after [reconnecting](SenderBuilder::reconnect_timeout).
+    ///
+    /// ILP/TCP has no acknowledgements, so the rows of a buffer written just
+    /// before the connection dropped may or may not have reached the server.
+    /// Replaying them gives at-least-once delivery: Rows may be duplicated
+    /// but not lost, provided the lost rows fit in `value` buffers. Each flush
+    /// then costs a copy of the buffer into a ring whose slots are reused.
+    ///
+    /// The default is `0`: Only the buffer of the failed flush is resent.
+    pub fn replay_buffers(mut self, value: usize) -> Result<Self> {
+        self.ensure_is_tcpx("replay_buffers")?;
+        self.replay_buffers.set_specified("replay_buffers", value)?;
+        Ok(self)
+    }
+
+    /// How the sender writes to its socket. This only applies to TCP.
+    ///
+    /// [`IoBackend::Uring`] submits each write through a per-sender io_uring
+    /// instead of calling `send` directly. Together with
+    /// [`uring_sqpoll`](SenderBuilder::uring_sqpoll), this takes the syscalls
+    /// off the flush path, and with
+    /// [`uring_zc_threshold`](SenderBuilder::uring_zc_threshold), large
+    /// buffers are sent without copying them into the kernel. It requires
+    /// Linux 6.0 or later for zero-copy sends, and the `io-uring` feature.
+    /// Non-blocking mode isn't supported with it.
+    ///
+    /// The default is [`IoBackend::Std`].
+    pub fn io_backend(mut self, value: IoBackend) -> Result<Self> {
+        self.ensure_is_tcpx("io_backend")?;
+        if value == IoBackend::Uring && !cfg!(all(feature = "io-uring", target_os = "linux")) {
+            return Err(error::fmt!(
+                ConfigError,
+                "The io_uring backend requires Linux and the \"io-uring\" feature."
+            ));
+        }
+        self.io_backend.set_specified("io_backend", value)?;
+        Ok(self)
+    }
+
+    /// Have a kernel thread poll the io_uring for submissions, so that writes
+    /// don't need a syscall, and briefly busy-poll for their completions
+    /// before waiting for them in the kernel. This trades a CPU core for
+    /// latency. It only applies to the
+    /// [io_uring backend](SenderBuilder::io_backend).
+    ///
+    /// The default is `false`.
+    pub fn uring_sqpoll(mut self, value: bool) -> Result<Self> {
+        self.ensure_is_tcpx("uring_sqpoll")?;
+        self.uring_sqpoll.set_specified("uring_sqpoll", value)?;
+        Ok(self)
+    }
+
+    /// Pin the [SQPOLL](SenderBuilder::uring_sqpoll) kernel thread to a CPU.
+    ///
+    /// By default, the thread may run on any CPU.
+    pub fn uring_sqpoll_cpu(mut self, value: u32) -> Result<Self> {
+        self.ensure_is_tcpx("uring_sqpoll_cpu")?;
+        self.uring_sqpoll_cpu
+            .set_specified("uring_sqpoll_cpu", Some(value))?;
+        Ok(self)
+    }
+
+    /// Send writes of at least `value` bytes with `SEND_ZC`, which lets the
+    /// network card read the buffer directly, or `None` to always copy. Below
+    /// a few tens of kilobytes, the page pinning costs more than the copy.
+    /// Kernels without zero-copy sends fall back to copying. It only applies
+    /// to the [io_uring backend](SenderBuilder::io_backend).
+    ///
+    /// The default is 64 KiB.
+    pub fn uring_zc_threshold(mut self, value: Option<usize>) -> Result<Self> {
+        self.ensure_is_tcpx("uring_zc_threshold")?;
+        self.uring_zc_threshold
+            .set_specified("uring_zc_threshold", value)?;
+        Ok(self)
+    }
+
     /// Ensure that TLS is enabled for the protocol.
     pub fn ensure_tls_enabled(&self, property: &str) -> Result<()> {
         if !self.protocol.tls_enabled() {
@@ -2004,111 +3543,545 @@ impl SenderBuilder {
         Ok(self)
     }
 
-    #[cfg(feature = "ilp-over-http")]
-    /// Set the cumulative duration spent in retries.
-    /// The value is in milliseconds, and the default is 10 seconds.
-    pub fn retry_timeout(mut self, value: Duration) -> Result<Self> {
-        if let Some(http) = &mut self.http {
-            http.retry_timeout.set_specified("retry_timeout", value)?;
-        } else {
+    /// Enable or disable the auto-flush thresholds checked by
+    /// [`Sender::should_flush`] and [`Sender::flush_if_due`].
+    /// The default is `true`.
+    pub fn auto_flush(mut self, enabled: bool) -> Result<Self> {
+        self.auto_flush.set_specified("auto_flush", enabled)?;
+        Ok(self)
+    }
+
+    /// Flush once the buffer holds at least this many rows, or `None` to disable
+    /// the row threshold.
+    /// The default is 75000 rows for HTTP and 600 rows for TCP.
+    pub fn auto_flush_rows(mut self, value: Option<usize>) -> Result<Self> {
+        if value == Some(0) {
             return Err(error::fmt!(
                 ConfigError,
-                "retry_timeout is supported only in ILP over HTTP."
+                "\"auto_flush_rows\" must be greater than 0."
             ));
         }
+        self.auto_flush_rows
+            .set_specified("auto_flush_rows", value)?;
         Ok(self)
     }
 
-    #[cfg(feature = "ilp-over-http")]
-    /// Set the minimum acceptable throughput while sending a buffer to the server.
-    /// The sender will divide the payload size by this number to determine for how
-    /// long to keep sending the payload before timing out.
-    /// The value is in bytes per second, and the default is 100 KiB/s.
-    /// The timeout calculated from minimum throughput is adedd to the value of
-    /// [`request_timeout`](SenderBuilder::request_timeout) to get the total timeout
-    /// value.
-    /// A value of 0 disables this feature, so it's similar to setting "infinite"
-    /// minimum throughput. The total timeout will then be equal to `request_timeout`.
-    pub fn request_min_throughput(mut self, value: u64) -> Result<Self> {
-        if let Some(http) = &mut self.http {
-            http.request_min_throughput
-                .set_specified("request_min_throughput", value)?;
-        } else {
+    /// Flush once the buffer holds at least this many bytes, or `None` to disable
+    /// the byte threshold.
+    /// Regardless of this setting, a buffer is always due once it reaches
+    /// [`max_buf_size`](SenderBuilder::max_buf_size).
+    /// The default is `None`.
+    pub fn auto_flush_bytes(mut self, value: Option<usize>) -> Result<Self> {
+        if value == Some(0) {
             return Err(error::fmt!(
                 ConfigError,
-                "\"request_min_throughput\" is supported only in ILP over HTTP."
+                "\"auto_flush_bytes\" must be greater than 0."
             ));
         }
+        self.auto_flush_bytes
+            .set_specified("auto_flush_bytes", value)?;
         Ok(self)
     }
 
-    #[cfg(feature = "ilp-over-http")]
-    /// Additional time to wait on top of that calculated from the minimum throughput.
-    /// This accounts for the fixed latency of the HTTP request-response roundtrip.
-    /// The default is 10 seconds.
-    /// See also: [`request_min_throughput`](SenderBuilder::request_min_throughput).
-    pub fn request_timeout(mut self, value: Duration) -> Result<Self> {
-        if let Some(http) = &mut self.http {
-            if value.is_zero() {
-                return Err(error::fmt!(
-                    ConfigError,
-                    "\"request_timeout\" must be greater than 0."
-                ));
-            }
-            http.request_timeout
-                .set_specified("request_timeout", value)?;
-        } else {
+    /// Flush once this much time has passed since the previous flush, or `None`
+    /// to disable the time threshold.
+    /// The value is in milliseconds in the config string, and the default is 1 second.
+    pub fn auto_flush_interval(mut self, value: Option<Duration>) -> Result<Self> {
+        if value.map_or(false, |interval| interval.is_zero()) {
             return Err(error::fmt!(
                 ConfigError,
-                "\"request_timeout\" is supported only in ILP over HTTP."
+                "\"auto_flush_interval\" must be greater than 0."
             ));
         }
+        self.auto_flush_interval
+            .set_specified("auto_flush_interval", value)?;
         Ok(self)
     }
 
-    #[cfg(feature = "ilp-over-http")]
-    /// Internal API, do not use.
-    /// This is exposed exclusively for the Python client.
-    /// We (QuestDB) use this to help us debug which client is being used if we encounter issues.
-    #[doc(hidden)]
-    pub fn user_agent(mut self, value: &str) -> Result<Self> {
-        let value = validate_value(value)?;
-        if let Some(http) = &mut self.http {
-            http.user_agent = value.to_string();
+    /// The number of connections opened by [`build_pool`](SenderBuilder::build_pool).
+    /// Not used by [`build`](SenderBuilder::build).
+    /// The default is 1.
+    pub fn pool_size(mut self, value: usize) -> Result<Self> {
+        if value == 0 {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"pool_size\" must be greater than 0."
+            ));
         }
+        self.pool_size.set_specified("pool_size", value)?;
         Ok(self)
     }
 
-    fn connect_tcp(&self, auth: &Option<AuthParams>) -> Result<ProtocolHandler> {
-        let addr: SockAddr = gai::resolve_host_port(self.host.as_str(), self.port.as_str())?;
-        let mut sock = Socket::new(Domain::IPV4, Type::STREAM, Some(SockProtocol::TCP))
-            .map_err(|io_err| map_io_to_socket_err("Could not open TCP socket: ", io_err))?;
+    /// Cap the rate data is sent at, in bytes per second, or `None` for no
+    /// limit.
+    ///
+    /// The limit is enforced by a token bucket holding up to one second's
+    /// worth of bytes. Over ILP/TCP, each write is paced in slices of about
+    /// 10 milliseconds' worth of bytes, so that a large flush doesn't go out
+    /// in one burst. Over ILP/HTTP, requests are held back until the bucket
+    /// has room for their whole body: Keep `max_buf_size` small relative to
+    /// the rate to smooth out the traffic.
+    ///
+    /// The senders of a [`SenderPool`] share a single bucket. The limit applies
+    /// to the uncompressed ILP bytes, and retries aren't counted again.
+    /// The default is `None`.
+    pub fn max_send_rate(mut self, value: Option<u64>) -> Result<Self> {
+        if value == Some(0) {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"max_send_rate\" must be greater than 0."
+            ));
+        }
+        self.max_send_rate.set_specified("max_send_rate", value)?;
+        Ok(self)
+    }
 
-        // See: https://idea.popcount.org/2014-04-03-bind-before-connect/
-        // We set `SO_REUSEADDR` on the outbound socket to avoid issues where a client may exhaust
-        // their interface's ports. See: https://github.com/questdb/py-questdb-client/issues/21
-        sock.set_reuse_address(true)
-            .map_err(|io_err| map_io_to_socket_err("Could not set SO_REUSEADDR: ", io_err))?;
+    /// Cap the rate rows are sent at, in rows per second, or `None` for no
+    /// limit.
+    ///
+    /// Like [`max_send_rate`](SenderBuilder::max_send_rate), this is enforced
+    /// by a token bucket shared by the senders of a [`SenderPool`]. A flush
+    /// waits until the bucket has room for all its rows before sending any of
+    /// them. The default is `None`.
+    pub fn max_rows_rate(mut self, value: Option<u64>) -> Result<Self> {
+        if value == Some(0) {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"max_rows_rate\" must be greater than 0."
+            ));
+        }
+        self.max_rows_rate.set_specified("max_rows_rate", value)?;
+        Ok(self)
+    }
 
-        sock.set_linger(Some(Duration::from_secs(120)))
-            .map_err(|io_err| map_io_to_socket_err("Could not set socket linger: ", io_err))?;
+    /// A copy of the builder whose senders will share a single
+    /// [`RateLimiter`], if any rate is limited.
+    pub(crate) fn with_shared_rate_limiter(&self) -> Self {
+        let mut builder = self.clone();
+        if builder.rate_limiter.is_none() {
+            builder.rate_limiter =
+                RateLimiter::new(*self.max_send_rate, *self.max_rows_rate).map(Arc::new);
+        }
+        builder
+    }
+
+    /// The version of the line protocol to send, or `None` to ask the server.
+    ///
+    /// Asking the server is only supported for ILP/HTTP: The sender requests
+    /// the server's `/settings` when built and falls back to
+    /// [`ProtocolVersion::V1`] if they don't list version 2. Over ILP/TCP,
+    /// `None` selects version 1.
+    ///
+    /// The default is [`ProtocolVersion::V1`].
+    pub fn protocol_version(mut self, value: Option<ProtocolVersion>) -> Result<Self> {
+        self.protocol_version
+            .set_specified("protocol_version", value)?;
+        Ok(self)
+    }
+
+    /// The unit to write designated timestamps in. Buffers created with
+    /// [`Sender::new_buffer`] use it, and the sender only flushes buffers
+    /// of this [precision](Buffer::timestamp_precision).
+    ///
+    /// Over ILP/HTTP, each request tells the server the precision with its
+    /// `precision` query parameter. ILP/TCP has no such parameter: The
+    /// precision must match the server's `line.tcp.timestamp` setting.
+    ///
+    /// The default is [`TimestampPrecision::Nanos`].
+    pub fn timestamp_precision(mut self, value: TimestampPrecision) -> Result<Self> {
+        self.timestamp_precision
+            .set_specified("timestamp_precision", value)?;
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// Set the cumulative duration spent in retries.
+    /// The value is in milliseconds, and the default is 10 seconds.
+    pub fn retry_timeout(mut self, value: Duration) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.retry_timeout.set_specified("retry_timeout", value)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "retry_timeout is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// Set how the interval between retries grows.
+    /// The accepted values in the config string are `exponential`,
+    /// `full_jitter` and `decorrelated`, and the default is `exponential`.
+    ///
+    /// When many clients fail at the same time, the randomized `full_jitter`
+    /// and `decorrelated` schedules spread their retries out, instead of
+    /// hitting a recovering server in lock step.
+    pub fn retry_backoff(mut self, value: RetryBackoff) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.retry_backoff.set_specified("retry_backoff", value)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"retry_backoff\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// Wait at least as long as the `Retry-After` header of a 503 or 529
+    /// response asks for before retrying. If that's longer than what's left
+    /// of the [`retry_timeout`](SenderBuilder::retry_timeout), the flush
+    /// fails straight away. The default is on.
+    pub fn retry_after(mut self, enabled: bool) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.retry_after.set_specified("retry_after", enabled)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"retry_after\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// Limit the retries of all the senders in the process configured with the
+    /// same value to this many per second, with bursts of up to as many.
+    /// A failed request that finds the budget used up is not retried.
+    /// The default is 0, meaning no limit.
+    pub fn retry_budget(mut self, retries_per_sec: u32) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.retry_budget
+                .set_specified("retry_budget", retries_per_sec)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"retry_budget\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// Fail flushes fast, without contacting the server, after this many
+    /// consecutive requests failed with a 5xx error or a network error.
+    /// The sender tries again after the
+    /// [`circuit_breaker_cooldown`](SenderBuilder::circuit_breaker_cooldown).
+    /// The default is 0, which disables the circuit breaker.
+    pub fn circuit_breaker_threshold(mut self, failures: u32) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.circuit_breaker_threshold
+                .set_specified("circuit_breaker_threshold", failures)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"circuit_breaker_threshold\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// How long an open circuit breaker fails flushes fast before letting a
+    /// request through again.
+    /// The value is in milliseconds, and the default is 5 seconds.
+    pub fn circuit_breaker_cooldown(mut self, value: Duration) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.circuit_breaker_cooldown
+                .set_specified("circuit_breaker_cooldown", value)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"circuit_breaker_cooldown\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// Open the connection when the sender is built, rather than on the first
+    /// flush, and keep it open whilst the sender is idle by pinging the server
+    /// every [`ping_interval`](SenderBuilder::ping_interval).
+    ///
+    /// This takes the TCP and TLS handshakes off the first flush, and replaces
+    /// a connection the server or a proxy dropped for being idle before a
+    /// flush lands on it. Building the sender fails if no host answers.
+    /// The default is off. See also [`Sender::warm_up`].
+    pub fn prewarm(mut self, enabled: bool) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.prewarm.set_specified("prewarm", enabled)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"prewarm\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http2")]
+    /// Multiplex the flushes of an [`AsyncSender`] and its
+    /// [clones](AsyncSender::try_clone) over a single HTTP/2 connection,
+    /// instead of opening an HTTP/1.1 connection per sender.
+    ///
+    /// The server, or a proxy in front of it, must speak HTTP/2: Over `https`
+    /// it's negotiated with ALPN, and over `http` it's used with prior
+    /// knowledge. Only the async sender supports it. The default is off.
+    pub fn http2(mut self, enabled: bool) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.http2.set_specified("http2", enabled)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"http2\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// How long the connection may sit idle before a
+    /// [`prewarm`](SenderBuilder::prewarm)ed sender pings the server, or `None`
+    /// to only warm up the connection when the sender is built.
+    /// The value is in milliseconds, and the default is 10 seconds: Keep it
+    /// below the idle timeout of the server and of any proxy in between.
+    pub fn ping_interval(mut self, value: Option<Duration>) -> Result<Self> {
+        if value == Some(Duration::ZERO) {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"ping_interval\" must be greater than 0."
+            ));
+        }
+        if let Some(http) = &mut self.http {
+            http.ping_interval.set_specified("ping_interval", value)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"ping_interval\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// The most bytes of a [`Sender::flush_stream`] request kept in memory
+    /// to resend it if an attempt fails. A longer stream isn't retried.
+    /// The default is 16 MiB.
+    pub fn stream_replay_window(mut self, value: usize) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.stream_replay_window
+                .set_specified("stream_replay_window", value)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"stream_replay_window\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// Set the minimum acceptable throughput while sending a buffer to the server.
+    /// The sender will divide the payload size by this number to determine for how
+    /// long to keep sending the payload before timing out.
+    /// The value is in bytes per second, and the default is 100 KiB/s.
+    /// The timeout calculated from minimum throughput is adedd to the value of
+    /// [`request_timeout`](SenderBuilder::request_timeout) to get the total timeout
+    /// value.
+    /// A value of 0 disables this feature, so it's similar to setting "infinite"
+    /// minimum throughput. The total timeout will then be equal to `request_timeout`.
+    pub fn request_min_throughput(mut self, value: u64) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.request_min_throughput
+                .set_specified("request_min_throughput", value)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"request_min_throughput\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// Additional time to wait on top of that calculated from the minimum throughput.
+    /// This accounts for the fixed latency of the HTTP request-response roundtrip.
+    /// The default is 10 seconds.
+    /// See also: [`request_min_throughput`](SenderBuilder::request_min_throughput).
+    pub fn request_timeout(mut self, value: Duration) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            if value.is_zero() {
+                return Err(error::fmt!(
+                    ConfigError,
+                    "\"request_timeout\" must be greater than 0."
+                ));
+            }
+            http.request_timeout
+                .set_specified("request_timeout", value)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"request_timeout\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// Compress the body of each HTTP request.
+    /// The accepted values in the config string are `none`, `gzip` and `zstd`,
+    /// and the default is `none`.
+    ///
+    /// The compression context is reused across flushes, and the
+    /// [`request_min_throughput`](SenderBuilder::request_min_throughput)
+    /// timeout is calculated from the compressed size.
+    pub fn compression(mut self, value: Compression) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.compression.set_specified("compression", value)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"compression\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// Spool the flushes that fail with a network error, or with a retriable
+    /// server error, once the [`retry_timeout`](SenderBuilder::retry_timeout)
+    /// is exhausted, instead of returning the error.
+    ///
+    /// The ILP text of each such buffer is appended to a segment file in the
+    /// directory, and the flush returns successfully. A background thread
+    /// replays the spooled buffers in order, one request per buffer, as soon
+    /// as the server accepts them again. Until the spool is drained, new
+    /// flushes are appended to it without contacting the server, so that rows
+    /// are sent in order.
+    ///
+    /// Buffers are replayed uncompressed. Buffers the server rejects on replay
+    /// with a non-retriable error are dropped, so they don't hold up the rest:
+    /// They're counted in [`SenderStats::spool_rejected`], and the next flush
+    /// returns the error of the first one not yet reported, without sending
+    /// its own buffer. Buffers left in the directory
+    /// when the sender is dropped are replayed by the next sender that opens
+    /// it. A buffer may be sent twice if the process exits during its replay.
+    ///
+    /// The directory must not be shared with another sender.
+    pub fn spool_dir<P: Into<PathBuf>>(mut self, path: P) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.spool_dir
+                .set_specified("spool_dir", Some(path.into()))?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"spool_dir\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// The maximum size of the files in the [`spool_dir`](SenderBuilder::spool_dir).
+    /// Once the spool is full, flushes that can't be sent return an error again.
+    /// The default is 1 GiB.
+    pub fn spool_max_bytes(mut self, value: u64) -> Result<Self> {
+        if let Some(http) = &mut self.http {
+            http.spool_max_bytes
+                .set_specified("spool_max_bytes", value)?;
+        } else {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"spool_max_bytes\" is supported only in ILP over HTTP."
+            ));
+        }
+        Ok(self)
+    }
+
+    #[cfg(feature = "ilp-over-http")]
+    /// Internal API, do not use.
+    /// This is exposed exclusively for the Python client.
+    /// We (QuestDB) use this to help us debug which client is being used if we encounter issues.
+    #[doc(hidden)]
+    pub fn user_agent(mut self, value: &str) -> Result<Self> {
+        let value = validate_value(value)?;
+        if let Some(http) = &mut self.http {
+            http.user_agent = value.to_string();
+        }
+        Ok(self)
+    }
+
+    fn connect_tcp(&self, auth: &Option<AuthParams>) -> Result<Connection> {
+        let mut last_err = None;
+        for (host, port) in self.hosts() {
+            match self.connect_tcp_host(host, port, auth) {
+                Ok(conn) => return Ok(conn),
+                // Only fail over if the host couldn't be reached: A failed
+                // handshake or bad credentials would fail the same way on the
+                // next one.
+                Err(err)
+                    if matches!(
+                        err.code(),
+                        crate::ErrorCode::SocketError | crate::ErrorCode::CouldNotResolveAddr
+                    ) =>
+                {
+                    last_err = Some(err)
+                }
+                Err(err) => return Err(err),
+            }
+        }
+        Err(last_err.expect("there is at least one host"))
+    }
+
+    fn open_tcp_socket(&self, addr: &SockAddr, bind_addr: Option<&SockAddr>) -> Result<Socket> {
+        let sock = Socket::new(addr.domain(), Type::STREAM, Some(SockProtocol::TCP))
+            .map_err(|io_err| map_io_to_socket_err("Could not open TCP socket: ", io_err))?;
+
+        // See: https://idea.popcount.org/2014-04-03-bind-before-connect/
+        // We set `SO_REUSEADDR` on the outbound socket to avoid issues where a client may exhaust
+        // their interface's ports. See: https://github.com/questdb/py-questdb-client/issues/21
+        sock.set_reuse_address(true)
+            .map_err(|io_err| map_io_to_socket_err("Could not set SO_REUSEADDR: ", io_err))?;
+
+        sock.set_linger(Some(Duration::from_secs(120)))
+            .map_err(|io_err| map_io_to_socket_err("Could not set socket linger: ", io_err))?;
         sock.set_keepalive(true)
             .map_err(|io_err| map_io_to_socket_err("Could not set SO_KEEPALIVE: ", io_err))?;
         sock.set_nodelay(true)
             .map_err(|io_err| map_io_to_socket_err("Could not set TCP_NODELAY: ", io_err))?;
-        if let Some(ref host) = self.net_interface.deref() {
-            let bind_addr = gai::resolve_host(host.as_str())?;
-            sock.bind(&bind_addr).map_err(|io_err| {
+        if let Some(bind_addr) = bind_addr {
+            sock.bind(bind_addr).map_err(|io_err| {
+                let iface = self.net_interface.deref().as_deref().unwrap_or_default();
                 map_io_to_socket_err(
-                    &format!("Could not bind to interface address {:?}: ", host),
+                    &format!("Could not bind to interface address {:?}: ", iface),
                     io_err,
                 )
             })?;
         }
-        sock.connect(&addr).map_err(|io_err| {
-            let host_port = format!("{}:{}", self.host.deref(), *self.port);
-            let prefix = format!("Could not connect to {:?}: ", host_port);
-            map_io_to_socket_err(&prefix, io_err)
+        Ok(sock)
+    }
+
+    fn connect_tcp_host(
+        &self,
+        host: &str,
+        port: &str,
+        auth: &Option<AuthParams>,
+    ) -> Result<Connection> {
+        let bind_addr = match self.net_interface.deref() {
+            Some(iface) => Some(gai::resolve_host(iface.as_str())?),
+            None => None,
+        };
+        let addrs: Vec<SockAddr> = gai::resolve_host_port(host, port)?
+            .into_iter()
+            // A socket bound to an IPv4 interface can only reach IPv4 addresses.
+            .filter(|addr| bind_addr.is_none() || addr.is_ipv4())
+            .map(SockAddr::from)
+            .collect();
+        let host_port = format!("{}:{}", host, port);
+        let mut sock = happy_eyeballs::connect_first(&host_port, &addrs, |addr| {
+            self.open_tcp_socket(addr, bind_addr.as_ref())
         })?;
 
         // We read during both TLS handshake and authentication.
@@ -2133,7 +4106,7 @@ impl SenderBuilder {
             self.tls_roots.deref(),
         )? {
             Some(tls_config) => {
-                let server_name: ServerName = ServerName::try_from(self.host.as_str())
+                let server_name: ServerName = ServerName::try_from(host)
                     .map_err(|inv_dns_err| error::fmt!(TlsError, "Bad host: {}", inv_dns_err))?
                     .to_owned();
                 let mut tls_conn =
@@ -2168,7 +4141,20 @@ impl SenderBuilder {
             conn.authenticate(auth)?;
         }
 
-        Ok(ProtocolHandler::Socket(conn))
+        #[cfg(all(feature = "io-uring", target_os = "linux"))]
+        if *self.io_backend == IoBackend::Uring {
+            let options = UringOptions {
+                sqpoll: *self.uring_sqpoll,
+                sqpoll_cpu: *self.uring_sqpoll_cpu,
+                zc_threshold: *self.uring_zc_threshold,
+            };
+            let uring = UringConnection::new(conn, &options).map_err(|io_err| {
+                map_io_to_socket_err("Could not set up the io_uring: ", io_err)
+            })?;
+            conn = Connection::Uring(Box::new(uring));
+        }
+
+        Ok(conn)
     }
 
     fn build_auth(&self) -> Result<Option<AuthParams>> {
@@ -2282,8 +4268,16 @@ impl SenderBuilder {
 
         let auth = self.build_auth()?;
 
+        #[cfg_attr(not(feature = "ilp-over-http"), allow(unused_mut))]
+        let mut protocol_version = self.protocol_version.unwrap_or(ProtocolVersion::V1);
+        let stats = StatsRecorder::new();
         let handler = match self.protocol {
-            Protocol::Tcp | Protocol::Tcps => self.connect_tcp(&auth)?,
+            Protocol::Tcp | Protocol::Tcps => {
+                let connect_start = Instant::now();
+                let conn = self.connect_tcp(&auth)?;
+                stats.record_connect(connect_start.elapsed());
+                ProtocolHandler::Socket(conn)
+            }
             #[cfg(feature = "ilp-over-http")]
             Protocol::Http | Protocol::Https => {
                 if self.net_interface.is_some() {
@@ -2295,6 +4289,15 @@ impl SenderBuilder {
                 }
 
                 let http_config = self.http.as_ref().unwrap();
+
+                #[cfg(feature = "ilp-over-http2")]
+                if *http_config.http2 {
+                    return Err(error::fmt!(
+                        ConfigError,
+                        "\"http2\" is supported only by the async sender: Call `build_async` instead."
+                    ));
+                }
+
                 let user_agent = http_config.user_agent.as_str();
                 let agent_builder = ureq::AgentBuilder::new()
                     .user_agent(user_agent)
@@ -2315,34 +4318,75 @@ impl SenderBuilder {
                     Some(tls_config) => agent_builder.tls_config(tls_config),
                     None => agent_builder,
                 };
-                let auth = match auth {
-                    Some(AuthParams::Basic(ref auth)) => Some(auth.to_header_string()),
-                    Some(AuthParams::Token(ref auth)) => Some(auth.to_header_string()?),
-                    Some(AuthParams::Ecdsa(_)) => {
-                        return Err(error::fmt!(
-                            AuthError,
-                            "ECDSA authentication is not supported for ILP over HTTP. \
-                            Please use basic or token authentication instead."
-                        ));
-                    }
-                    None => None,
-                };
-                let agent_builder =
-                    agent_builder.timeout_connect(*http_config.request_timeout.deref());
+                let auth = http_auth_header(&auth)?;
+                let agent_builder = agent_builder
+                    .timeout_connect(*http_config.request_timeout.deref())
+                    .resolver(resolve_netloc);
                 let agent = agent_builder.build();
                 let proto = self.protocol.schema();
-                let url = format!(
-                    "{}://{}:{}/write",
-                    proto,
-                    self.host.deref(),
-                    self.port.deref()
-                );
-                ProtocolHandler::Http(HttpHandlerState {
-                    agent,
-                    url,
-                    auth,
+                let base_urls: Vec<String> = self
+                    .hosts()
+                    .map(|(host, port)| {
+                        if host.contains(':') {
+                            format!("{}://[{}]:{}", proto, host, port)
+                        } else {
+                            format!("{}://{}:{}", proto, host, port)
+                        }
+                    })
+                    .collect();
+                if self.protocol_version.is_none() {
+                    protocol_version = base_urls
+                        .iter()
+                        .find_map(|base_url| {
+                            probe_protocol_version(
+                                &agent,
+                                &format!("{}/settings", base_url),
+                                auth.as_deref(),
+                                http_config,
+                            )
+                        })
+                        .unwrap_or(ProtocolVersion::V1);
+                }
+                let endpoints = Endpoints::new(&base_urls);
+                let spool = match http_config.spool_dir.deref() {
+                    Some(dir) => Some(Spool::open(
+                        dir.clone(),
+                        *http_config.spool_max_bytes,
+                        SpoolTarget {
+                            agent: agent.clone(),
+                            endpoints: endpoints.clone(),
+                            auth: auth.clone(),
+                            config: http_config.clone(),
+                            precision: *self.timestamp_precision,
+                        },
+                    )?),
+                    None => None,
+                };
+                let keep_alive = if *http_config.prewarm {
+                    keep_alive::ping(&agent, &endpoints, auth.as_deref(), http_config)?;
+                    match *http_config.ping_interval {
+                        Some(interval) => Some(KeepAlive::start(
+                            agent.clone(),
+                            endpoints.clone(),
+                            auth.clone(),
+                            http_config.clone(),
+                            interval,
+                        )?),
+                        None => None,
+                    }
+                } else {
+                    None
+                };
+                ProtocolHandler::Http(HttpHandlerState {
+                    agent,
+                    endpoints,
+                    auth,
 
-                    config: self.http.as_ref().unwrap().clone(),
+                    config: http_config.clone(),
+                    encoder: BodyEncoder::new(*http_config.compression)?,
+                    breaker: CircuitBreaker::new(http_config),
+                    spool,
+                    keep_alive,
                 })
             }
         };
@@ -2353,16 +4397,69 @@ impl SenderBuilder {
             descr.push_str("auth=off]");
         }
 
+        let auto_flush = if *self.auto_flush {
+            Some(AutoFlush {
+                rows: *self.auto_flush_rows,
+                bytes: *self.auto_flush_bytes,
+                interval: *self.auto_flush_interval,
+            })
+        } else {
+            None
+        };
+
+        let reconnect = match *self.reconnect_timeout {
+            Some(timeout) if self.protocol.is_tcpx() => {
+                let builder = self.clone();
+                let auth = auth.clone();
+                Some(Reconnector::new(
+                    Box::new(move || builder.connect_tcp(&auth)),
+                    timeout,
+                    *self.replay_buffers,
+                ))
+            }
+            _ => None,
+        };
+
         let sender = Sender {
             descr,
             handler,
             connected: true,
+            reconnect,
             max_buf_size: *self.max_buf_size,
+            auto_flush,
+            last_flush: Instant::now(),
+            nonblocking: false,
+            protocol_version,
+            ts_precision: *self.timestamp_precision,
+            stats,
+            tracer: Tracer::default(),
+            rate_limiter: match self.rate_limiter {
+                Some(ref rate_limiter) => Some(Arc::clone(rate_limiter)),
+                None => RateLimiter::new(*self.max_send_rate, *self.max_rows_rate).map(Arc::new),
+            },
         };
 
         Ok(sender)
     }
 
+    /// Build an [`AsyncSender`] that flushes over ILP/HTTP from async code
+    /// running on a Tokio runtime.
+    ///
+    /// No connection is opened until the first flush.
+    #[cfg(feature = "async-tokio")]
+    pub fn build_async(&self) -> Result<AsyncSender> {
+        AsyncSender::new(self)
+    }
+
+    /// Build a [`SenderPool`] of [`pool_size`](SenderBuilder::pool_size)
+    /// senders that can be shared between threads.
+    ///
+    /// In the case of TCP, all the connections are established before this
+    /// function returns.
+    pub fn build_pool(&self) -> Result<SenderPool> {
+        SenderPool::new(self)
+    }
+
     fn ensure_is_tcpx(&mut self, param_name: &str) -> Result<()> {
         if self.protocol.is_tcpx() {
             Ok(())
@@ -2375,6 +4472,21 @@ impl SenderBuilder {
     }
 }
 
+/// The value of the `Authorization` header for ILP over HTTP.
+#[cfg(feature = "ilp-over-http")]
+fn http_auth_header(auth: &Option<AuthParams>) -> Result<Option<String>> {
+    match auth {
+        Some(AuthParams::Basic(ref auth)) => Ok(Some(auth.to_header_string())),
+        Some(AuthParams::Token(ref auth)) => Ok(Some(auth.to_header_string()?)),
+        Some(AuthParams::Ecdsa(_)) => Err(error::fmt!(
+            AuthError,
+            "ECDSA authentication is not supported for ILP over HTTP. \
+            Please use basic or token authentication instead."
+        )),
+        None => Ok(None),
+    }
+}
+
 /// When parsing from config, we exclude certain characters.
 /// Here we repeat the same validation logic for consistency.
 fn validate_value<T: AsRef<str>>(value: T) -> Result<T> {
@@ -2390,6 +4502,31 @@ fn validate_value<T: AsRef<str>>(value: T) -> Result<T> {
     Ok(value)
 }
 
+/// Split an `addr` entry into its host and port, as in `host:port`,
+/// `[ipv6]:port`, or either without the port.
+fn parse_addr<'a>(addr: &'a str, default_port: &'a str) -> Result<(&'a str, &'a str)> {
+    let (host, port) = match addr.strip_prefix('[') {
+        Some(rest) => match rest.split_once(']') {
+            Some((host, "")) => (host, default_port),
+            Some((host, port)) => match port.strip_prefix(':') {
+                Some(port) => (host, port),
+                None => (host, ""),
+            },
+            None => ("", ""),
+        },
+        // An IPv6 address without brackets can't have a port.
+        None if addr.matches(':').count() > 1 => (addr, default_port),
+        None => addr.split_once(':').unwrap_or((addr, default_port)),
+    };
+    if host.is_empty() || port.is_empty() {
+        return Err(error::fmt!(
+            ConfigError,
+            "Invalid address {addr:?}: Expected \"host:port\" or \"[ipv6]:port\"."
+        ));
+    }
+    Ok((host, port))
+}
+
 fn parse_conf_value<T>(param_name: &str, str_value: &str) -> Result<T>
 where
     T: FromStr,
@@ -2403,6 +4540,19 @@ where
     })
 }
 
+/// Like [`parse_conf_value`], but maps the `off` value to `None`.
+fn parse_conf_value_or_off<T>(param_name: &str, str_value: &str) -> Result<Option<T>>
+where
+    T: FromStr,
+    T::Err: std::fmt::Debug,
+{
+    if str_value == "off" {
+        Ok(None)
+    } else {
+        parse_conf_value(param_name, str_value).map(Some)
+    }
+}
+
 fn b64_decode(descr: &'static str, buf: &str) -> Result<Vec<u8>> {
     Base64UrlUnpadded::decode_vec(buf).map_err(|b64_err| {
         error::fmt!(
@@ -2502,6 +4652,33 @@ impl F64Serializer {
     }
 }
 
+const HEX_DIGITS: &[u8; 16] = b"0123456789abcdef";
+
+/// Formats a long256 as `0x` followed by 64 hex digits and the `i` suffix,
+/// on the stack.
+pub(crate) struct Long256Serializer {
+    buf: [u8; 67],
+}
+
+impl Long256Serializer {
+    pub(crate) fn new(value: &[u8; 32]) -> Self {
+        let mut buf = [0u8; 67];
+        buf[0] = b'0';
+        buf[1] = b'x';
+        for (digits, byte) in buf[2..66].chunks_exact_mut(2).zip(value) {
+            digits[0] = HEX_DIGITS[(byte >> 4) as usize];
+            digits[1] = HEX_DIGITS[(byte & 0x0f) as usize];
+        }
+        buf[66] = b'i';
+        Self { buf }
+    }
+
+    pub(crate) fn as_str(&self) -> &str {
+        // Only ASCII bytes are ever written to `buf`.
+        unsafe { std::str::from_utf8_unchecked(&self.buf) }
+    }
+}
+
 impl Sender {
     /// Create a new `Sender` instance from the given configuration string.
     ///
@@ -2541,8 +4718,69 @@ impl Sender {
         SenderBuilder::from_env()?.build()
     }
 
-    #[allow(unused_variables)]
-    fn flush_impl(&mut self, buf: &Buffer, transactional: bool) -> Result<()> {
+    fn check_flushable(&self, buf: &Buffer) -> Result<()> {
+        self.check_sendable(buf)?;
+        if buf.len() > self.max_buf_size {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Could not flush buffer: Buffer size of {} exceeds maximum configured allowed size of {} bytes.",
+                buf.len(),
+                self.max_buf_size
+            ));
+        }
+        Ok(())
+    }
+
+    /// If the ILP/TCP connection was lost and a
+    /// [reconnect timeout](SenderBuilder::reconnect_timeout) is set, switch
+    /// to the connection opened in the background and replay the recent
+    /// buffers over it. Blocking flushes wait up to the timeout for the
+    /// connection, non-blocking ones don't wait.
+    ///
+    /// Returns whether a new connection was put in place.
+    fn ensure_connected(&mut self) -> Result<bool> {
+        if self.connected {
+            return Ok(false);
+        }
+        let Some(ref reconnect) = self.reconnect else {
+            return Ok(false);
+        };
+        let mut conn = reconnect.take(!self.nonblocking)?;
+
+        // Replay over the still blocking socket, even in non-blocking mode:
+        // The buffers must go first and whole.
+        for (bytes, rows) in reconnect.replay() {
+            write_all_paced(&mut conn, bytes, rows, self.rate_limiter.as_deref()).map_err(
+                |io_err| {
+                    reconnect.start();
+                    map_io_to_socket_err("Could not replay buffers after reconnecting: ", io_err)
+                },
+            )?;
+        }
+        if self.nonblocking {
+            conn.socket().set_nonblocking(true).map_err(|io_err| {
+                reconnect.start();
+                map_io_to_socket_err("Could not set the socket's non-blocking mode: ", io_err)
+            })?;
+        }
+        self.handler = ProtocolHandler::Socket(conn);
+        self.connected = true;
+        self.stats.record_reconnect();
+        Ok(true)
+    }
+
+    /// Mark the ILP/TCP connection as lost, reconnecting in the background if
+    /// so configured.
+    fn lose_connection(&mut self) {
+        self.connected = false;
+        if let Some(ref reconnect) = self.reconnect {
+            reconnect.start();
+        }
+    }
+
+    /// The checks of [`check_flushable`](Sender::check_flushable), bar the
+    /// buffer size.
+    fn check_sendable(&self, buf: &Buffer) -> Result<()> {
         if !self.connected {
             return Err(error::fmt!(
                 SocketError,
@@ -2551,77 +4789,201 @@ impl Sender {
         }
         buf.check_op(Op::Flush)?;
 
-        if buf.len() > self.max_buf_size {
+        if buf.protocol_version() > self.protocol_version {
             return Err(error::fmt!(
                 InvalidApiCall,
-                "Could not flush buffer: Buffer size of {} exceeds maximum configured allowed size of {} bytes.",
-                buf.len(),
-                self.max_buf_size
+                "Could not flush buffer: Buffer uses line protocol version {}, but the sender uses version {}.",
+                buf.protocol_version(),
+                self.protocol_version
+            ));
+        }
+        if buf.ts_precision != self.ts_precision {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Could not flush buffer: Buffer uses timestamp precision {:?}, but the sender uses {:?}. Create buffers with `Sender::new_buffer`.",
+                buf.ts_precision,
+                self.ts_precision
+            ));
+        }
+        Ok(())
+    }
+
+    fn check_blocking_mode(&self, method: &str) -> Result<()> {
+        if self.nonblocking {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `{}`: The sender is in non-blocking mode. Call `try_flush` instead.",
+                method
+            ));
+        }
+        Ok(())
+    }
+
+    fn check_blocking(&self, buf: &Buffer, method: &str) -> Result<()> {
+        self.check_blocking_mode(method)?;
+        if buf.send_offset > 0 {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `{}`: The buffer is partially sent. Call `try_flush` until it completes.",
+                method
             ));
         }
+        Ok(())
+    }
+
+    #[allow(unused_variables)]
+    fn flush_impl(&mut self, buf: &Buffer, transactional: bool) -> Result<()> {
+        let start = Instant::now();
+        let trace_start = self.tracer.start();
+        let result = self.send_impl(buf, transactional);
+        match result {
+            Ok(()) => self
+                .stats
+                .record_flush(buf.len(), buf.row_count(), Some(start.elapsed())),
+            Err(_) => self.stats.record_failed_flush(),
+        }
+        self.tracer
+            .emit(trace_start, FlushSpan::new(FlushSpanKind::Flush, buf.len()));
+        result
+    }
 
-        let bytes = buf.as_str().as_bytes();
+    fn send_impl(&mut self, buf: &Buffer, transactional: bool) -> Result<()> {
+        self.ensure_connected()?;
+        self.check_flushable(buf)?;
+        self.check_blocking(buf, "flush")?;
+
+        let bytes = buf.as_bytes();
         if bytes.is_empty() {
             return Ok(());
         }
-        match self.handler {
-            ProtocolHandler::Socket(ref mut conn) => {
-                if transactional {
+        if transactional {
+            match self.handler {
+                ProtocolHandler::Socket(_) => {
                     return Err(error::fmt!(
                         InvalidApiCall,
                         "Transactional flushes are not supported for ILP over TCP."
                     ));
                 }
-                conn.write_all(bytes).map_err(|io_err| {
-                    self.connected = false;
-                    map_io_to_socket_err("Could not flush buffer: ", io_err)
-                })?;
+                #[cfg(feature = "ilp-over-http")]
+                ProtocolHandler::Http(_) => {
+                    if !buf.transactional() {
+                        return Err(error::fmt!(
+                            InvalidApiCall,
+                            "Buffer contains lines for multiple tables. \
+                            Transactional flushes are only supported for buffers containing lines for a single table."
+                        ));
+                    }
+                }
+            }
+        }
+        self.send_bytes(bytes, buf.row_count())
+    }
+
+    /// Send `rows` complete rows in a single write or request.
+    fn send_bytes(&mut self, bytes: &[u8], rows: usize) -> Result<()> {
+        match self.handler {
+            ProtocolHandler::Socket(ref mut conn) => {
+                let write_start = self.tracer.start();
+                let mut result = write_all_paced(conn, bytes, rows, self.rate_limiter.as_deref());
+                if let Err(io_err) = result {
+                    self.lose_connection();
+                    if self.reconnect.is_none() {
+                        return Err(map_io_to_socket_err("Could not flush buffer: ", io_err));
+                    }
+                    // Resend the whole of `bytes` over the new connection, as
+                    // it's unknown how much of it got through.
+                    self.ensure_connected()?;
+                    let ProtocolHandler::Socket(ref mut conn) = self.handler else {
+                        unreachable!("reconnected over ILP/TCP");
+                    };
+                    result = write_all_paced(conn, bytes, rows, self.rate_limiter.as_deref());
+                    if result.is_err() {
+                        self.lose_connection();
+                    }
+                }
+                result
+                    .map_err(|io_err| map_io_to_socket_err("Could not flush buffer: ", io_err))?;
+                if let Some(ref mut reconnect) = self.reconnect {
+                    reconnect.record(bytes, rows);
+                }
+                self.tracer.emit(
+                    write_start,
+                    FlushSpan::new(FlushSpanKind::TcpWrite, bytes.len()),
+                );
             }
             #[cfg(feature = "ilp-over-http")]
-            ProtocolHandler::Http(ref state) => {
-                if transactional && !buf.transactional() {
-                    return Err(error::fmt!(
-                        InvalidApiCall,
-                        "Buffer contains lines for multiple tables. \
-                        Transactional flushes are only supported for buffers containing lines for a single table."
-                    ));
+            ProtocolHandler::Http(ref mut state) => {
+                if let Some(err) = state.spool.as_ref().and_then(Spool::take_rejection) {
+                    return Err(err);
                 }
-                let request_min_throughput = *state.config.request_min_throughput;
-                let extra_time = if request_min_throughput > 0 {
-                    (bytes.len() as f64) / (request_min_throughput as f64)
-                } else {
-                    0.0f64
-                };
-                let timeout = *state.config.request_timeout + Duration::from_secs_f64(extra_time);
-                let request = state
-                    .agent
-                    .post(&state.url)
-                    .query_pairs([("precision", "n")])
-                    .timeout(timeout)
-                    .set("Content-Type", "text/plain; charset=utf-8");
-                let request = match state.auth.as_ref() {
-                    Some(auth) => request.set("Authorization", auth),
-                    None => request,
-                };
-                let response_or_err =
-                    http_send_with_retries(request, bytes, *state.config.retry_timeout);
-                match response_or_err {
-                    Ok(_response) => {
-                        // on success, there's no information in the response.
+                let spooled = match state.spool {
+                    Some(ref spool) if spool.is_pending() || state.breaker.is_open() => {
+                        // Earlier flushes are still waiting to be replayed, or
+                        // the server keeps failing: Queue up behind them to
+                        // preserve the order.
+                        spool.append(bytes)?;
+                        true
                     }
-                    Err(ureq::Error::Status(http_status_code, response)) => {
-                        return Err(parse_http_error(http_status_code, response));
+                    _ => false,
+                };
+                if let Some(ref keep_alive) = state.keep_alive {
+                    keep_alive.touch();
+                }
+                if !spooled {
+                    state.breaker.check()?;
+                    if let Some(ref rate_limiter) = self.rate_limiter {
+                        rate_limiter.acquire(bytes.len(), rows);
                     }
-                    Err(ureq::Error::Transport(transport)) => {
-                        return Err(error::fmt!(
-                            SocketError,
-                            "Could not flush buffer: {}",
-                            transport
-                        ));
+                    let content_encoding = state.encoder.content_encoding();
+                    let encode_start = self.tracer.start();
+                    let body = state.encoder.encode(bytes)?;
+                    self.tracer.emit(
+                        encode_start,
+                        FlushSpan::new(FlushSpanKind::Encode, body.len()),
+                    );
+                    let precision = self.ts_precision;
+                    let new_request = |url: &str| {
+                        new_ilp_request(
+                            &state.agent,
+                            url,
+                            state.auth.as_deref(),
+                            &state.config,
+                            precision,
+                            body.len(),
+                            content_encoding,
+                        )
+                    };
+                    let response_or_err = http_send_with_retries(
+                        &state.endpoints,
+                        new_request,
+                        body,
+                        &state.config,
+                        &mut state.breaker,
+                        &self.stats,
+                        &mut self.tracer,
+                    );
+                    match (response_or_err, state.spool.as_ref()) {
+                        (Ok(_response), _) => {
+                            // on success, there's no information in the response.
+                        }
+                        (Err(err), Some(spool)) if is_retriable_error(&err) => {
+                            spool.append(bytes)?;
+                        }
+                        (Err(ureq::Error::Status(http_status_code, response)), _) => {
+                            return Err(parse_http_error_traced(
+                                http_status_code,
+                                response,
+                                &mut self.tracer,
+                            ));
+                        }
+                        (Err(err), _) => {
+                            return Err(map_http_send_err(err));
+                        }
                     }
                 }
             }
         }
+        self.last_flush = Instant::now();
         Ok(())
     }
 
@@ -2646,6 +5008,241 @@ impl Sender {
         self.flush_impl(buf, transactional)
     }
 
+    /// Send a batch of rows too large to buffer whole as a single ILP/HTTP
+    /// request, serializing them as the request body is sent.
+    ///
+    /// `fill` is called with an empty buffer to write the next few rows into,
+    /// and returns whether more rows follow. Each chunk goes out with chunked
+    /// transfer encoding as soon as it's written, so the rows of the next
+    /// chunk are serialized whilst the kernel sends the last, and memory use
+    /// is bounded by the chunk size rather than by the size of the batch.
+    ///
+    /// With `transactional`, all rows must belong to the same table, as per
+    /// [`flush_and_keep_with_flags`](Sender::flush_and_keep_with_flags): The
+    /// server commits the whole stream or none of it. An error returned by
+    /// `fill` aborts the request.
+    ///
+    /// A failed attempt is retried by resending the rows sent so far from a
+    /// replay window, then resuming the stream. If the stream has outgrown the
+    /// [`stream_replay_window`](SenderBuilder::stream_replay_window), the
+    /// error is returned instead. The request is never compressed nor spooled.
+    #[cfg(feature = "ilp-over-http")]
+    pub fn flush_stream<F>(&mut self, transactional: bool, fill: F) -> Result<()>
+    where
+        F: FnMut(&mut Buffer) -> Result<bool>,
+    {
+        let start = Instant::now();
+        let trace_start = self.tracer.start();
+        let mut bytes = 0;
+        let result = self.send_stream(transactional, fill, &mut bytes);
+        match result {
+            Ok(0) => {}
+            Ok(rows) => self.stats.record_flush(bytes, rows, Some(start.elapsed())),
+            Err(_) => self.stats.record_failed_flush(),
+        }
+        self.tracer
+            .emit(trace_start, FlushSpan::new(FlushSpanKind::Flush, bytes));
+        result.map(|_| ())
+    }
+
+    /// Send the stream of [`flush_stream`](Sender::flush_stream), returning
+    /// the number of rows sent and storing the number of bytes in `bytes`.
+    #[cfg(feature = "ilp-over-http")]
+    fn send_stream<F>(&mut self, transactional: bool, fill: F, bytes: &mut usize) -> Result<usize>
+    where
+        F: FnMut(&mut Buffer) -> Result<bool>,
+    {
+        self.check_blocking_mode("flush_stream")?;
+        let chunk = self.new_buffer();
+        let ProtocolHandler::Http(ref mut state) = self.handler else {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Streaming flushes are only supported for ILP over HTTP."
+            ));
+        };
+        if let Some(ref spool) = state.spool {
+            if let Some(err) = spool.take_rejection() {
+                return Err(err);
+            }
+            if spool.is_pending() {
+                return Err(error::fmt!(
+                    InvalidApiCall,
+                    "Could not flush stream: Earlier flushes are still waiting in the spool."
+                ));
+            }
+        }
+        state.breaker.check()?;
+        if let Some(ref keep_alive) = state.keep_alive {
+            keep_alive.touch();
+        }
+
+        let mut body = StreamBody::new(
+            fill,
+            chunk,
+            *state.config.stream_replay_window,
+            transactional,
+            self.rate_limiter.as_deref(),
+        );
+        if body.is_empty()? {
+            return Ok(0);
+        }
+
+        // The length of the stream isn't known up front: Allow for the time
+        // to send the largest buffer at the `request_min_throughput`.
+        let precision = self.ts_precision;
+        let max_buf_size = self.max_buf_size;
+        let new_request = |url: &str| {
+            new_ilp_request(
+                &state.agent,
+                url,
+                state.auth.as_deref(),
+                &state.config,
+                precision,
+                max_buf_size,
+                None,
+            )
+        };
+        let response_or_err = http_send_with_retries(
+            &state.endpoints,
+            new_request,
+            &mut body,
+            &state.config,
+            &mut state.breaker,
+            &self.stats,
+            &mut self.tracer,
+        );
+        *bytes = body.bytes;
+        if let Some(err) = body.take_error() {
+            return Err(err);
+        }
+        let err = match response_or_err {
+            Ok(_response) => {
+                self.last_flush = Instant::now();
+                return Ok(body.rows);
+            }
+            Err(err) => err,
+        };
+        let retriable = is_retriable_error(&err);
+        let err = match err {
+            ureq::Error::Status(http_status_code, response) => {
+                parse_http_error_traced(http_status_code, response, &mut self.tracer)
+            }
+            err => map_http_send_err(err),
+        };
+        if retriable && body.overflowed() {
+            return Err(Error::new(
+                err.code(),
+                format!(
+                    "{} The stream outgrew the \"stream_replay_window\" of {} bytes, so it wasn't retried.",
+                    err.msg(),
+                    *state.config.stream_replay_window
+                ),
+            ));
+        }
+        Err(err)
+    }
+
+    /// Send the rows of each table in the buffer as a transactional request
+    /// of its own, clearing each table's segment once it's sent.
+    ///
+    /// The segments are sent one after the other, in the order their tables
+    /// first appeared. If one fails, the error is returned straight away: The
+    /// tables sent before it stay committed, whilst it and the tables after it
+    /// keep their rows, so calling this again resumes with the failed table.
+    ///
+    /// A buffer with an incomplete row is rejected before anything is sent.
+    /// To send the segments concurrently, use
+    /// [`SenderPool::flush_multi_table`].
+    #[cfg(feature = "ilp-over-http")]
+    pub fn flush_multi_table(&mut self, buf: &mut MultiTableBuffer) -> Result<()> {
+        buf.check_complete()?;
+        for segment in buf.pending_mut() {
+            self.flush_impl(segment, true)?;
+            segment.clear();
+        }
+        Ok(())
+    }
+
+    /// Send a file of pre-serialized ILP rows, such as one written out from
+    /// [`Buffer::as_bytes`] while the server was unreachable.
+    ///
+    /// The file is memory-mapped and scanned for row boundaries up front:
+    /// If its last row isn't terminated by a newline, or any row exceeds the
+    /// configured `max_buf_size`, nothing is sent. The rows are then sent in
+    /// runs of up to `max_buf_size` bytes, each as a write of its own over
+    /// ILP/TCP or a request of its own over ILP/HTTP. Plain TCP connections on
+    /// Linux use `sendfile(2)`, so the bytes go straight from the page cache
+    /// to the socket.
+    ///
+    /// The rows aren't parsed or checked against the sender's protocol
+    /// version: The file must have been written for a compatible one.
+    ///
+    /// If sending a run fails, the runs before it have already been sent.
+    /// Over ILP/HTTP each run is a request of its own, so rows for a single
+    /// table are committed a run at a time.
+    pub fn send_file<P: AsRef<Path>>(&mut self, path: P) -> Result<()> {
+        self.check_blocking_mode("send_file")?;
+        self.ensure_connected()?;
+        if !self.connected {
+            return Err(error::fmt!(
+                SocketError,
+                "Could not send file: not connected to database."
+            ));
+        }
+        let data = FileData::open(path.as_ref())?;
+        for chunk in split_rows(&data, self.max_buf_size)? {
+            let start = Instant::now();
+            let trace_start = self.tracer.start();
+            let result = self.send_file_chunk(&data, chunk.range.clone(), chunk.rows);
+            match result {
+                Ok(()) => {
+                    self.stats
+                        .record_flush(chunk.range.len(), chunk.rows, Some(start.elapsed()))
+                }
+                Err(_) => self.stats.record_failed_flush(),
+            }
+            self.tracer.emit(
+                trace_start,
+                FlushSpan::new(FlushSpanKind::Flush, chunk.range.len()),
+            );
+            result?;
+        }
+        Ok(())
+    }
+
+    fn send_file_chunk(&mut self, data: &FileData, range: Range<usize>, rows: usize) -> Result<()> {
+        #[cfg(any(target_os = "linux", target_os = "android"))]
+        if let ProtocolHandler::Socket(Connection::Direct(ref sock)) = self.handler {
+            let write_start = self.tracer.start();
+            let pace_bytes = match self.rate_limiter {
+                Some(ref rate_limiter) => {
+                    rate_limiter.acquire(0, rows);
+                    rate_limiter.pace_bytes()
+                }
+                None => range.len(),
+            };
+            let mut offset = range.start;
+            while offset < range.end {
+                let end = range.end.min(offset + pace_bytes);
+                if let Some(ref rate_limiter) = self.rate_limiter {
+                    rate_limiter.acquire(end - offset, 0);
+                }
+                if let Err(io_err) = sendfile_all(sock, data.file(), offset..end) {
+                    self.lose_connection();
+                    return Err(map_io_to_socket_err("Could not send file: ", io_err));
+                }
+                offset = end;
+            }
+            self.tracer.emit(
+                write_start,
+                FlushSpan::new(FlushSpanKind::TcpWrite, range.len()),
+            );
+            self.last_flush = Instant::now();
+            return Ok(());
+        }
+        self.send_bytes(&data[range], rows)
+    }
+
     /// Send the given buffer of rows to the QuestDB server.
     ///
     /// All the data stays in the buffer. Clear the buffer before starting a new batch.
@@ -2676,29 +5273,558 @@ impl Sender {
     /// data to the server at a high rate.
     ///
     /// To improve the HTTP performance, send larger buffers (with more rows), and
-    /// consider parallelizing writes using multiple senders from multiple threads.
+    /// consider parallelizing writes from multiple threads using a [`SenderPool`].
     pub fn flush(&mut self, buf: &mut Buffer) -> Result<()> {
         self.flush_impl(buf, false)?;
         buf.clear();
         Ok(())
     }
 
+    /// Send the given buffer of rows to the QuestDB server, clearing the buffer,
+    /// like [`flush`](Sender::flush), but split it into as many back-to-back
+    /// requests (or socket writes) of at most
+    /// [`max_buf_size`](SenderBuilder::max_buf_size) bytes as needed, cut at
+    /// row boundaries.
+    ///
+    /// This lets you batch by time without having to bound the size of a
+    /// batch. Each request is counted as a flush of its own in
+    /// [`stats`](Sender::stats). As the rows are spread over several
+    /// requests, the flush is never transactional.
+    ///
+    /// If a request fails, the rows sent before it stay in the buffer, their
+    /// bytes counted by [`send_offset`](Buffer::send_offset), and the error is
+    /// returned. Its [`failed_row`](crate::Error::failed_row) counts from the
+    /// start of the buffer. Call `flush_chunked` again with the same buffer to resume
+    /// from the first unsent row, or clear the buffer to drop the batch.
+    /// A single row larger than `max_buf_size` can't be sent and fails the
+    /// flush.
+    pub fn flush_chunked(&mut self, buf: &mut Buffer) -> Result<()> {
+        self.ensure_connected()?;
+        self.check_sendable(buf)?;
+        self.check_blocking_mode("flush_chunked")?;
+        while buf.send_offset < buf.len() {
+            let offset = buf.send_offset;
+            let end = buf.chunk_end(offset, self.max_buf_size)?;
+            let rows_before = buf.row_ends.partition_point(|&row_end| row_end <= offset);
+            let rows = buf.row_ends.partition_point(|&row_end| row_end <= end) - rows_before;
+            let start = Instant::now();
+            let trace_start = self.tracer.start();
+            // The server numbers the rows of the chunk, not of the buffer.
+            let result = self
+                .send_bytes(&buf.as_bytes()[offset..end], rows)
+                .map_err(|err| {
+                    let failed_row = err.failed_row().map(|row| rows_before + row);
+                    err.with_failed_row(failed_row)
+                });
+            match result {
+                Ok(()) => self
+                    .stats
+                    .record_flush(end - offset, rows, Some(start.elapsed())),
+                Err(_) => self.stats.record_failed_flush(),
+            }
+            self.tracer.emit(
+                trace_start,
+                FlushSpan::new(FlushSpanKind::Flush, end - offset),
+            );
+            result?;
+            buf.send_offset = end;
+        }
+        buf.clear();
+        Ok(())
+    }
+
+    /// Send several buffers of rows to the QuestDB server, clearing them.
+    ///
+    /// With ILP-over-TCP, all the buffers are written to the socket with
+    /// scatter-gather I/O (`writev` or `WSASend`), without first being
+    /// concatenated. Over TLS, the buffers are encrypted straight into TLS
+    /// records. If the write fails, none of the buffers are cleared, but
+    /// some of their contents may already have been sent.
+    ///
+    /// With ILP-over-HTTP, each buffer is sent as a separate request, in order.
+    /// If a request fails, the buffers sent before it are cleared and the
+    /// remaining ones are left untouched.
+    ///
+    /// Empty buffers are skipped. The others are subject to the same checks as
+    /// in [`flush`](Sender::flush): All buffers are validated before anything
+    /// is sent.
+    pub fn flush_many(&mut self, bufs: &mut [&mut Buffer]) -> Result<()> {
+        self.ensure_connected()?;
+        for buf in bufs.iter().filter(|buf| !buf.is_empty()) {
+            self.check_flushable(buf)?;
+            self.check_blocking(buf, "flush_many")?;
+        }
+        match self.handler {
+            ProtocolHandler::Socket(ref mut conn) => {
+                let start = Instant::now();
+                let trace_start = self.tracer.start();
+                if let Some(ref rate_limiter) = self.rate_limiter {
+                    let bytes = bufs.iter().map(|buf| buf.len()).sum();
+                    let rows = bufs.iter().map(|buf| buf.row_count()).sum();
+                    rate_limiter.acquire(bytes, rows);
+                }
+                if let Err(io_err) = write_all_vectored(conn, bufs) {
+                    self.lose_connection();
+                    self.stats.record_failed_flush();
+                    return Err(map_io_to_socket_err("Could not flush buffers: ", io_err));
+                }
+                let elapsed = start.elapsed();
+                let bytes = bufs.iter().map(|buf| buf.len()).sum();
+                self.tracer
+                    .emit(trace_start, FlushSpan::new(FlushSpanKind::TcpWrite, bytes));
+                for buf in bufs.iter_mut().filter(|buf| !buf.is_empty()) {
+                    self.stats
+                        .record_flush(buf.len(), buf.row_count(), Some(elapsed));
+                    if let Some(ref mut reconnect) = self.reconnect {
+                        reconnect.record(buf.as_bytes(), buf.row_count());
+                    }
+                    buf.clear();
+                }
+                self.last_flush = Instant::now();
+            }
+            #[cfg(feature = "ilp-over-http")]
+            ProtocolHandler::Http(_) => {
+                for buf in bufs.iter_mut().filter(|buf| !buf.is_empty()) {
+                    self.flush(buf)?;
+                }
+            }
+        }
+        Ok(())
+    }
+
+    /// Tell whether the buffer has reached any of the auto-flush thresholds
+    /// configured via `auto_flush_rows`, `auto_flush_bytes` and
+    /// `auto_flush_interval`. The interval is measured from the sender's last
+    /// successful flush.
+    ///
+    /// A buffer is only ever due at a row boundary, i.e. after a call to
+    /// [`at`](Buffer::at) or [`at_now`](Buffer::at_now), and once it reaches
+    /// [`max_buf_size`](SenderBuilder::max_buf_size) it is always due.
+    ///
+    /// Always returns `false` if the sender was configured with `auto_flush=off`.
+    pub fn should_flush(&self, buf: &Buffer) -> bool {
+        let Some(auto_flush) = self.auto_flush.as_ref() else {
+            return false;
+        };
+        if buf.state.op_case != OpCase::MayFlushOrTable || buf.is_empty() {
+            return false;
+        }
+        let max_bytes = auto_flush
+            .bytes
+            .map_or(self.max_buf_size, |bytes| bytes.min(self.max_buf_size));
+        buf.len() >= max_bytes
+            || auto_flush
+                .rows
+                .map_or(false, |rows| buf.row_count() >= rows)
+            || auto_flush
+                .interval
+                .map_or(false, |interval| self.last_flush.elapsed() >= interval)
+    }
+
+    /// Flush and clear the buffer if [`should_flush`](Sender::should_flush)
+    /// reports it as due. Call this after completing each row.
+    ///
+    /// A buffer that the last row took past
+    /// [`max_buf_size`](SenderBuilder::max_buf_size) is sent with
+    /// [`flush_chunked`](Sender::flush_chunked) rather than rejected, so no
+    /// request is ever larger than `max_buf_size`.
+    ///
+    /// Returns `true` if the buffer was flushed.
+    ///
+    /// ```no_run
+    /// # use questdb::Result;
+    /// use questdb::ingress::{Buffer, Sender, TimestampNanos};
+    ///
+    /// # fn main() -> Result<()> {
+    /// let mut sender = Sender::from_conf(
+    ///     "http::addr=localhost:9000;auto_flush_rows=10000;auto_flush_interval=500;")?;
+    /// let mut buffer = Buffer::new();
+    /// for price in [2615.54, 2615.61, 2615.49] {
+    ///     buffer
+    ///         .table("trades")?
+    ///         .symbol("symbol", "ETH-USD")?
+    ///         .column_f64("price", price)?
+    ///         .at(TimestampNanos::now())?;
+    ///     sender.flush_if_due(&mut buffer)?;
+    /// }
+    /// sender.flush(&mut buffer)?;
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn flush_if_due(&mut self, buf: &mut Buffer) -> Result<bool> {
+        if self.should_flush(buf) {
+            if buf.len() > self.max_buf_size {
+                self.flush_chunked(buf)?;
+            } else {
+                self.flush(buf)?;
+            }
+            Ok(true)
+        } else {
+            Ok(false)
+        }
+    }
+
+    /// The version of the line protocol the sender was built with, or
+    /// negotiated with the server.
+    pub fn protocol_version(&self) -> ProtocolVersion {
+        self.protocol_version
+    }
+
+    /// The unit the sender expects designated timestamps in. See
+    /// [`SenderBuilder::timestamp_precision`].
+    pub fn timestamp_precision(&self) -> TimestampPrecision {
+        self.ts_precision
+    }
+
+    /// A new, empty buffer encoded with the sender's
+    /// [`protocol_version`](Sender::protocol_version) and
+    /// [`timestamp_precision`](Sender::timestamp_precision).
+    pub fn new_buffer(&self) -> Buffer {
+        let mut buffer = Buffer::new();
+        buffer.protocol_version = self.protocol_version;
+        buffer.ts_precision = self.ts_precision;
+        buffer
+    }
+
+    /// Open a connection to the server ahead of the next flush, taking the TCP
+    /// and TLS handshakes off its latency, by sending a `GET /ping` request.
+    /// If the pooled connection was dropped whilst idle, this replaces it.
+    ///
+    /// Fails over to the next host listed in `addr` if the current one can't
+    /// be reached. Returns an error only if none can.
+    ///
+    /// This is a no-op for ILP/TCP, which connects when the sender is built.
+    /// See also [`SenderBuilder::prewarm`].
+    pub fn warm_up(&mut self) -> Result<()> {
+        match self.handler {
+            ProtocolHandler::Socket(_) => Ok(()),
+            #[cfg(feature = "ilp-over-http")]
+            ProtocolHandler::Http(ref state) => {
+                keep_alive::ping(
+                    &state.agent,
+                    &state.endpoints,
+                    state.auth.as_deref(),
+                    &state.config,
+                )?;
+                if let Some(ref keep_alive) = state.keep_alive {
+                    keep_alive.touch();
+                }
+                Ok(())
+            }
+        }
+    }
+
+    /// A snapshot of the sender's flush counters and latency histogram.
+    ///
+    /// The counters are updated without locking as part of each flush, so
+    /// taking a snapshot is cheap enough to do from a periodic metrics
+    /// exporter. See [`SenderStats`] for what's measured.
+    pub fn stats(&self) -> SenderStats {
+        let stats = self.stats.snapshot();
+        #[cfg(feature = "ilp-over-http")]
+        if let ProtocolHandler::Http(ref state) = self.handler {
+            if let Some(ref spool) = state.spool {
+                return SenderStats {
+                    spool_rejected: spool.rejected(),
+                    ..stats
+                };
+            }
+        }
+        stats
+    }
+
+    /// Register a hook that receives a timed [`FlushSpan`] for each stage of
+    /// every flush: The TCP write, or the ILP/HTTP body encoding, each
+    /// request attempt, the whole request and the parsing of any error
+    /// response, followed by the flush as a whole.
+    ///
+    /// Use it to forward spans to `tracing`, OpenTelemetry or a log, and to
+    /// correlate slow or failed flushes with the server logs through
+    /// [`FlushSpan::error_id`]. The hook runs synchronously on the flushing
+    /// thread: Keep it short. Replaces any previously registered hook.
+    ///
+    /// Without a hook, flushes aren't timed beyond what [`Sender::stats`]
+    /// records.
+    pub fn set_trace_hook<F>(&mut self, hook: F)
+    where
+        F: FnMut(&FlushSpan) + Send + 'static,
+    {
+        self.tracer.set_hook(Some(Box::new(hook)));
+    }
+
+    /// Remove the hook registered with [`Sender::set_trace_hook`].
+    pub fn clear_trace_hook(&mut self) {
+        self.tracer.set_hook(None);
+    }
+
+    /// Switch an ILP-over-TCP sender in or out of non-blocking mode.
+    ///
+    /// In non-blocking mode, send buffers with [`try_flush`](Sender::try_flush),
+    /// which never waits for the server to accept more data. Register the
+    /// socket returned by [`raw_fd`](Sender::raw_fd) (or
+    /// [`raw_socket`](Sender::raw_socket) on Windows) with your event loop
+    /// and call `try_flush` again when it's writable. The blocking flush
+    /// methods return an error in this mode.
+    ///
+    /// The connection is always established, authenticated and, if
+    /// applicable, TLS-handshaked in blocking mode when the sender is built.
+    pub fn set_nonblocking(&mut self, nonblocking: bool) -> Result<()> {
+        let conn = match self.handler {
+            ProtocolHandler::Socket(ref conn) => conn,
+            #[cfg(feature = "ilp-over-http")]
+            ProtocolHandler::Http(_) => {
+                return Err(error::fmt!(
+                    InvalidApiCall,
+                    "Non-blocking mode is supported only in ILP over TCP."
+                ));
+            }
+        };
+        #[cfg(all(feature = "io-uring", target_os = "linux"))]
+        if matches!(conn, Connection::Uring(_)) {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Non-blocking mode is not supported with the io_uring backend."
+            ));
+        }
+        conn.socket()
+            .set_nonblocking(nonblocking)
+            .map_err(|io_err| {
+                map_io_to_socket_err("Could not set the socket's non-blocking mode: ", io_err)
+            })?;
+        self.nonblocking = nonblocking;
+        Ok(())
+    }
+
+    /// Send as much of the buffer as the socket accepts without blocking.
+    ///
+    /// Returns `true` once the whole buffer is sent, at which point the buffer
+    /// is cleared. Otherwise, returns `false` and records the progress in the
+    /// buffer: See [`send_offset`](Buffer::send_offset). Call `try_flush`
+    /// with the same buffer again once the socket is writable.
+    ///
+    /// Rows may be appended to the buffer between calls, and are then sent as
+    /// part of the same flush. Don't clear the buffer or rewind it past the
+    /// rows already sent, as that would corrupt the data on the wire.
+    ///
+    /// With `max_send_rate` or `max_rows_rate` set, a call may send less than
+    /// the socket would accept, or nothing at all. Rather than polling, wait
+    /// for [`try_flush_delay`](Sender::try_flush_delay) before calling again.
+    ///
+    /// This method is specific to ILP-over-TCP. It also works in blocking mode,
+    /// where it's equivalent to [`flush`](Sender::flush).
+    pub fn try_flush(&mut self, buf: &mut Buffer) -> Result<bool> {
+        if self.ensure_connected()? {
+            // The rows sent over the lost connection may not have arrived.
+            buf.send_offset = 0;
+        }
+        self.check_flushable(buf)?;
+        let conn = match self.handler {
+            ProtocolHandler::Socket(ref mut conn) => conn,
+            #[cfg(feature = "ilp-over-http")]
+            ProtocolHandler::Http(_) => {
+                return Err(error::fmt!(
+                    InvalidApiCall,
+                    "Bad call to `try_flush`: Supported only in ILP over TCP."
+                ));
+            }
+        };
+        let mut bytes = &buf.as_bytes()[buf.send_offset..];
+        if let Some(ref rate_limiter) = self.rate_limiter {
+            bytes = &bytes[..rate_limiter.try_acquire_bytes(bytes.len())];
+        }
+        let result = try_write_all(conn, bytes);
+
+        // Only the bytes the socket accepted count against `max_send_rate`.
+        if let Some(ref rate_limiter) = self.rate_limiter {
+            let written = result.as_ref().map_or(0, |&(written, _)| written);
+            rate_limiter.refund_bytes(bytes.len() - written);
+        }
+        let (written, done) = match result {
+            Ok(progress) => progress,
+            Err(io_err) => {
+                self.lose_connection();
+                self.stats.record_failed_flush();
+                return Err(map_io_to_socket_err("Could not flush buffer: ", io_err));
+            }
+        };
+        buf.send_offset += written;
+        if done && buf.send_offset == buf.len() {
+            if let Some(ref rate_limiter) = self.rate_limiter {
+                rate_limiter.charge_rows(buf.row_count());
+            }
+            if let Some(ref mut reconnect) = self.reconnect {
+                reconnect.record(buf.as_bytes(), buf.row_count());
+            }
+            self.stats.record_flush(buf.len(), buf.row_count(), None);
+            buf.clear();
+            self.last_flush = Instant::now();
+            Ok(true)
+        } else {
+            Ok(false)
+        }
+    }
+
+    /// How long until [`try_flush`](Sender::try_flush) may send again under
+    /// the `max_send_rate` and `max_rows_rate` limits.
+    ///
+    /// Zero without limits, or once enough tokens are available for a paced
+    /// write. An event loop can arm a timer for this long, rather than
+    /// waiting for the socket to become writable.
+    pub fn try_flush_delay(&self) -> Duration {
+        self.rate_limiter
+            .as_ref()
+            .map_or(Duration::ZERO, |rate_limiter| {
+                rate_limiter.try_acquire_delay()
+            })
+    }
+
+    /// The raw file descriptor of an ILP-over-TCP sender's socket, for
+    /// registering with `epoll`, `kqueue` and the like.
+    ///
+    /// Returns `None` for ILP-over-HTTP. The sender retains ownership of the
+    /// socket: Don't close it.
+    #[cfg(unix)]
+    pub fn raw_fd(&self) -> Option<std::os::unix::io::RawFd> {
+        use std::os::unix::io::AsRawFd;
+        match self.handler {
+            ProtocolHandler::Socket(ref conn) => Some(conn.socket().as_raw_fd()),
+            #[cfg(feature = "ilp-over-http")]
+            ProtocolHandler::Http(_) => None,
+        }
+    }
+
+    /// The raw `SOCKET` handle of an ILP-over-TCP sender, for registering
+    /// with IOCP or `WSAPoll`.
+    ///
+    /// Returns `None` for ILP-over-HTTP. The sender retains ownership of the
+    /// socket: Don't close it.
+    #[cfg(windows)]
+    pub fn raw_socket(&self) -> Option<std::os::windows::io::RawSocket> {
+        use std::os::windows::io::AsRawSocket;
+        match self.handler {
+            ProtocolHandler::Socket(ref conn) => Some(conn.socket().as_raw_socket()),
+            #[cfg(feature = "ilp-over-http")]
+            ProtocolHandler::Http(_) => None,
+        }
+    }
+
     /// Tell whether the sender is no longer usable and must be dropped.
     ///
-    /// This happens when there was an earlier failure.
+    /// This happens when there was an earlier failure, unless a
+    /// [reconnect timeout](SenderBuilder::reconnect_timeout) is set: The
+    /// sender then reconnects by itself and never needs closing.
     ///
     /// This method is specific to ILP-over-TCP and is not relevant for ILP-over-HTTP.
     pub fn must_close(&self) -> bool {
-        !self.connected
+        !self.connected && self.reconnect.is_none()
+    }
+
+    /// Move the sender to a dedicated I/O thread, so that flushing no longer
+    /// blocks the calling thread.
+    ///
+    /// `ring_size` is the number of buffers that may be in flight at any one
+    /// time. Two is sufficient to keep filling one buffer whilst the other is
+    /// being sent. See [`BackgroundSender`] for details.
+    pub fn into_background(self, ring_size: usize) -> Result<BackgroundSender> {
+        BackgroundSender::new(self, ring_size, None)
+    }
+
+    /// Like [`into_background`](Sender::into_background), but the ring's
+    /// buffers are drawn from `buffers`, shrunk back to its
+    /// [`max_capacity`](BufferPool::max_capacity) after each flush, and
+    /// returned to it once the background sender is closed.
+    pub fn into_background_with_pool(
+        self,
+        ring_size: usize,
+        buffers: Arc<BufferPool>,
+    ) -> Result<BackgroundSender> {
+        BackgroundSender::new(self, ring_size, Some(buffers))
+    }
+
+    /// Move the sender to a flusher thread that many producer threads can feed
+    /// through lanes of their own, gathering their rows into large requests.
+    ///
+    /// `queue_depth` is the number of committed lanes that may wait for the
+    /// flusher before [`Lane::commit`] blocks. See [`ConcurrentSender`] for
+    /// details.
+    pub fn into_concurrent(self, queue_depth: usize) -> Result<ConcurrentSender> {
+        ConcurrentSender::new(self, queue_depth, None)
+    }
+
+    /// Like [`into_concurrent`](Sender::into_concurrent), but the lanes'
+    /// buffers are drawn from, and returned to, `buffers`.
+    pub fn into_concurrent_with_pool(
+        self,
+        queue_depth: usize,
+        buffers: Arc<BufferPool>,
+    ) -> Result<ConcurrentSender> {
+        ConcurrentSender::new(self, queue_depth, Some(buffers))
     }
 }
 
+mod arrow;
+mod background;
+mod buffer_pool;
+mod clock;
+mod columns;
+mod concurrent;
 mod conf;
+mod decimal;
+mod escape;
+mod happy_eyeballs;
+mod multi_table;
+mod pool;
+mod rate_limit;
+mod reconnect;
+mod replay;
+mod row_template;
+mod scan;
+mod sharded;
+mod stats;
 mod timestamp;
+mod trace;
+
+#[cfg(all(feature = "io-uring", target_os = "linux"))]
+mod uring;
+
+use decimal::{write_fixed, write_timestamp, TimestampCache, MAX_DECIMALS};
+use rate_limit::RateLimiter;
+use reconnect::Reconnector;
+use replay::{split_rows, FileData};
+use scan::{find_row_end, RowEnd};
+
+#[cfg(any(target_os = "linux", target_os = "android"))]
+use replay::sendfile_all;
+use stats::StatsRecorder;
+use trace::Tracer;
+
+#[cfg(all(feature = "io-uring", target_os = "linux"))]
+use uring::{UringConnection, UringOptions};
 
 #[cfg(feature = "ilp-over-http")]
 mod http;
 
+#[cfg(feature = "ilp-over-http")]
+mod spool;
+
+#[cfg(feature = "ilp-over-http")]
+use spool::{Spool, SpoolTarget};
+
+#[cfg(feature = "ilp-over-http")]
+mod keep_alive;
+
+#[cfg(feature = "ilp-over-http")]
+use keep_alive::KeepAlive;
+
+#[cfg(feature = "ilp-over-http")]
+mod stream;
+
+#[cfg(feature = "ilp-over-http")]
+use stream::StreamBody;
+
+#[cfg(feature = "async-tokio")]
+mod async_sender;
+
 #[cfg(feature = "ilp-over-http")]
 use http::*;
 
@@ -0,0 +1,281 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::collections::HashMap;
+
+use crate::error::{self, Error, Result};
+
+use super::{Buffer, Op, ProtocolVersion, TableName, TimestampPrecision};
+
+/// The rows of one table, in the order they were appended.
+#[derive(Debug, Clone)]
+struct Segment {
+    table: String,
+    buf: Buffer,
+}
+
+/// Accumulates rows for many tables, keeping a separate contiguous segment
+/// per table so that each can be flushed as its own transactional request.
+///
+/// QuestDB transactions can't span tables, so a transactional
+/// [`Buffer`] must only hold rows for one table. A `MultiTableBuffer` sorts
+/// mixed-table rows into per-table [`Buffer`]s as they're appended:
+/// [`table`](MultiTableBuffer::table) starts a row in the segment of the named
+/// table and returns that segment to continue the row with.
+///
+/// Flush it with [`Sender::flush_multi_table`](super::Sender::flush_multi_table),
+/// or with [`SenderPool::flush_multi_table`](super::SenderPool::flush_multi_table)
+/// to send the segments concurrently. Either way, the rows of each table are
+/// committed all together or not at all. Grouping a table's rows together
+/// also means the server writes each table in one go.
+///
+/// ```no_run
+/// # use questdb::Result;
+/// use questdb::ingress::{MultiTableBuffer, Sender, TimestampNanos};
+///
+/// # fn main() -> Result<()> {
+/// let mut sender = Sender::from_conf("http::addr=localhost:9000;")?;
+/// let mut buffer = MultiTableBuffer::new();
+/// buffer
+///     .table("trades")?
+///     .symbol("symbol", "ETH-USD")?
+///     .column_f64("price", 2615.54)?
+///     .at(TimestampNanos::now())?;
+/// buffer
+///     .table("quotes")?
+///     .symbol("symbol", "ETH-USD")?
+///     .column_f64("bid", 2615.50)?
+///     .at(TimestampNanos::now())?;
+/// sender.flush_multi_table(&mut buffer)?;
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug, Clone)]
+pub struct MultiTableBuffer {
+    segments: Vec<Segment>,
+
+    /// The index in `segments` of each table's segment.
+    index: HashMap<String, usize>,
+
+    /// The segment of the row under construction, if any.
+    current: Option<usize>,
+
+    max_name_len: usize,
+    protocol_version: ProtocolVersion,
+    ts_precision: TimestampPrecision,
+}
+
+impl MultiTableBuffer {
+    /// Construct a `MultiTableBuffer` with a `max_name_len` of `127`, which is
+    /// the same as the QuestDB server default.
+    pub fn new() -> Self {
+        Self::with_max_name_len(127)
+    }
+
+    /// Construct a `MultiTableBuffer` with a custom maximum length for table
+    /// and column names. See [`Buffer::with_max_name_len`].
+    pub fn with_max_name_len(max_name_len: usize) -> Self {
+        Self {
+            segments: Vec::new(),
+            index: HashMap::new(),
+            current: None,
+            max_name_len,
+            protocol_version: ProtocolVersion::V1,
+            ts_precision: TimestampPrecision::Nanos,
+        }
+    }
+
+    /// The line protocol version the segments are encoded with.
+    pub fn protocol_version(&self) -> ProtocolVersion {
+        self.protocol_version
+    }
+
+    /// Set the line protocol version to encode the segments with. The buffer
+    /// must be empty. See [`Buffer::set_protocol_version`].
+    pub fn set_protocol_version(&mut self, protocol_version: ProtocolVersion) -> Result<()> {
+        if !self.is_empty() {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `set_protocol_version`: The buffer must be empty."
+            ));
+        }
+        self.protocol_version = protocol_version;
+        for segment in &mut self.segments {
+            segment.buf.protocol_version = protocol_version;
+        }
+        Ok(())
+    }
+
+    /// The unit the segments write designated timestamps in.
+    pub fn timestamp_precision(&self) -> TimestampPrecision {
+        self.ts_precision
+    }
+
+    /// Set the unit to write designated timestamps in. The buffer must be
+    /// empty. See [`Buffer::set_timestamp_precision`].
+    pub fn set_timestamp_precision(&mut self, precision: TimestampPrecision) -> Result<()> {
+        if !self.is_empty() {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `set_timestamp_precision`: The buffer must be empty."
+            ));
+        }
+        self.ts_precision = precision;
+        for segment in &mut self.segments {
+            segment.buf.ts_precision = precision;
+        }
+        Ok(())
+    }
+
+    /// Start recording a new row for the given table, in that table's
+    /// segment, and return the segment to continue the row with.
+    ///
+    /// As with a [`Buffer`], the previous row must be complete: Call
+    /// [`rewind_row`](MultiTableBuffer::rewind_row) to drop it if it can't be.
+    pub fn table<'a, N>(&mut self, name: N) -> Result<&mut Buffer>
+    where
+        N: TryInto<TableName<'a>>,
+        Error: From<N::Error>,
+    {
+        let name: TableName<'a> = name.try_into()?;
+        if let Some(current) = self.current {
+            self.segments[current].buf.check_op(Op::Table)?;
+        }
+        let index = match self.index.get(name.name) {
+            Some(&index) => index,
+            None => {
+                let mut buf = Buffer::with_max_name_len(self.max_name_len);
+                buf.protocol_version = self.protocol_version;
+                buf.ts_precision = self.ts_precision;
+                self.segments.push(Segment {
+                    table: name.name.to_owned(),
+                    buf,
+                });
+                self.index
+                    .insert(name.name.to_owned(), self.segments.len() - 1);
+                self.segments.len() - 1
+            }
+        };
+        let buf = &mut self.segments[index].buf;
+        buf.set_marker()?;
+        buf.table(name)?;
+        self.current = Some(index);
+        Ok(buf)
+    }
+
+    /// Discard the row under construction, if it's incomplete, e.g. after
+    /// one of its columns failed validation. Complete rows are kept.
+    pub fn rewind_row(&mut self) {
+        if let Some(current) = self.current {
+            let buf = &mut self.segments[current].buf;
+            if (buf.state.op_case as isize & Op::Table as isize) == 0 {
+                // The marker was set by `table` at the start of the row.
+                let _ = buf.rewind_to_marker();
+            }
+        }
+    }
+
+    /// The segment holding the rows of `table`, if any were appended since
+    /// the buffer was created.
+    pub fn get(&self, table: &str) -> Option<&Buffer> {
+        self.index
+            .get(table)
+            .map(|&index| &self.segments[index].buf)
+    }
+
+    /// The tables and their segments, in the order the tables first appeared.
+    /// Segments emptied by [`clear`](MultiTableBuffer::clear) or a flush are
+    /// included.
+    pub fn segments(&self) -> impl Iterator<Item = (&str, &Buffer)> {
+        self.segments
+            .iter()
+            .map(|segment| (segment.table.as_str(), &segment.buf))
+    }
+
+    /// The number of tables with at least one row in the buffer.
+    pub fn table_count(&self) -> usize {
+        self.segments
+            .iter()
+            .filter(|segment| !segment.buf.is_empty())
+            .count()
+    }
+
+    /// The number of rows accumulated across all the segments.
+    pub fn row_count(&self) -> usize {
+        self.segments
+            .iter()
+            .map(|segment| segment.buf.row_count())
+            .sum()
+    }
+
+    /// The number of bytes accumulated across all the segments.
+    pub fn len(&self) -> usize {
+        self.segments.iter().map(|segment| segment.buf.len()).sum()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.segments.iter().all(|segment| segment.buf.is_empty())
+    }
+
+    /// Clear all the segments whilst retaining their capacity.
+    ///
+    /// The segments themselves are kept, so a steady set of tables doesn't
+    /// reallocate between batches.
+    pub fn clear(&mut self) {
+        for segment in &mut self.segments {
+            segment.buf.clear();
+        }
+        self.current = None;
+    }
+
+    /// Check that no row is left incomplete, before flushing any segment.
+    pub(super) fn check_complete(&self) -> Result<()> {
+        match self.current {
+            Some(current) => self.segments[current].buf.check_op(Op::Flush),
+            None => Ok(()),
+        }
+    }
+
+    /// The segments to send, i.e. the non-empty ones.
+    pub(super) fn pending(&self) -> impl Iterator<Item = &Buffer> {
+        self.segments
+            .iter()
+            .map(|segment| &segment.buf)
+            .filter(|buf| !buf.is_empty())
+    }
+
+    /// Like [`pending`](MultiTableBuffer::pending), in the same order.
+    pub(super) fn pending_mut(&mut self) -> impl Iterator<Item = &mut Buffer> {
+        self.segments
+            .iter_mut()
+            .map(|segment| &mut segment.buf)
+            .filter(|buf| !buf.is_empty())
+    }
+}
+
+impl Default for MultiTableBuffer {
+    fn default() -> Self {
+        Self::new()
+    }
+}
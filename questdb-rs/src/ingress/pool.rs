@@ -0,0 +1,348 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::ops::{Deref, DerefMut};
+#[cfg(feature = "ilp-over-http")]
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::time::Instant;
+
+use crate::error::Result;
+
+#[cfg(feature = "ilp-over-http")]
+use super::MultiTableBuffer;
+use super::{Buffer, BufferPool, Sender, SenderBuilder};
+
+struct Slot {
+    /// `None` whilst the sender is checked out, or after it failed and was
+    /// dropped. A failed sender is replaced on the next checkout.
+    sender: Option<Sender>,
+    busy: bool,
+    idle_since: Instant,
+}
+
+/// A fixed-size set of senders that can be shared between threads.
+///
+/// The pool is configured from the same builder or config string as a
+/// [`Sender`], with the additional `pool_size` key setting the number of
+/// connections. Each thread can either [`get`](SenderPool::get) a sender for
+/// exclusive use, or hand a buffer to [`flush`](SenderPool::flush).
+///
+/// Each checkout picks the idle connection that has been idle the longest, so
+/// that the load is spread evenly across the connections and their HTTP
+/// keep-alive sessions stay warm. When all the connections are busy, the
+/// caller blocks until one is returned.
+///
+/// A sender that [must be closed](Sender::must_close) after an error is
+/// dropped when it's returned to the pool, and replaced with a new connection
+/// on its next checkout.
+///
+/// ```no_run
+/// # use questdb::Result;
+/// use std::sync::Arc;
+/// use questdb::ingress::{Buffer, SenderPool, TimestampNanos};
+///
+/// # fn main() -> Result<()> {
+/// let pool = Arc::new(SenderPool::from_conf("http::addr=localhost:9000;pool_size=4;")?);
+/// let workers: Vec<_> = (0..8)
+///     .map(|_| {
+///         let pool = Arc::clone(&pool);
+///         std::thread::spawn(move || -> Result<()> {
+///             let mut buffer = Buffer::new();
+///             buffer
+///                 .table("trades")?
+///                 .symbol("symbol", "ETH-USD")?
+///                 .column_f64("price", 2615.54)?
+///                 .at(TimestampNanos::now())?;
+///             pool.flush(&mut buffer)
+///         })
+///     })
+///     .collect();
+/// for worker in workers {
+///     worker.join().unwrap()?;
+/// }
+/// # Ok(())
+/// # }
+/// ```
+pub struct SenderPool {
+    builder: SenderBuilder,
+    slots: Mutex<Vec<Slot>>,
+    returned: Condvar,
+    buffers: Option<Arc<BufferPool>>,
+}
+
+impl SenderPool {
+    pub(crate) fn new(builder: &SenderBuilder) -> Result<Self> {
+        let builder = builder.with_shared_rate_limiter();
+        let pool_size = *builder.pool_size;
+
+        #[cfg(feature = "ilp-over-http")]
+        if pool_size > 1
+            && builder
+                .http
+                .as_ref()
+                .map_or(false, |http| http.spool_dir.is_some())
+        {
+            return Err(crate::error::fmt!(
+                ConfigError,
+                "\"spool_dir\" can't be shared by the senders of a pool: Set \"pool_size\" to 1."
+            ));
+        }
+
+        let now = Instant::now();
+        let mut slots = Vec::with_capacity(pool_size);
+        for _ in 0..pool_size {
+            slots.push(Slot {
+                sender: Some(builder.build()?),
+                busy: false,
+                idle_since: now,
+            });
+        }
+        Ok(Self {
+            builder,
+            slots: Mutex::new(slots),
+            returned: Condvar::new(),
+            buffers: None,
+        })
+    }
+
+    /// Create a new `SenderPool` from the given configuration string.
+    ///
+    /// The format is the same as for [`Sender::from_conf`], plus the
+    /// `pool_size` key for the number of connections, which defaults to 1.
+    ///
+    /// In the case of TCP, all the connections are established before this
+    /// function returns.
+    pub fn from_conf<T: AsRef<str>>(conf: T) -> Result<Self> {
+        SenderBuilder::from_conf(conf)?.build_pool()
+    }
+
+    /// Create a new `SenderPool` from the configuration stored in the
+    /// `QDB_CLIENT_CONF` environment variable. The format is the same as that
+    /// accepted by [`SenderPool::from_conf`].
+    pub fn from_env() -> Result<Self> {
+        SenderBuilder::from_env()?.build_pool()
+    }
+
+    /// The number of connections in the pool.
+    pub fn pool_size(&self) -> usize {
+        self.lock_slots().len()
+    }
+
+    /// Share a [`BufferPool`] with the threads using this pool.
+    ///
+    /// Once set, [`flush`](SenderPool::flush) shrinks each buffer it sends
+    /// back to the buffer pool's [`max_capacity`](BufferPool::max_capacity),
+    /// so that one outlier batch doesn't keep a thread's buffer inflated.
+    pub fn set_buffer_pool(&mut self, buffers: Arc<BufferPool>) {
+        self.buffers = Some(buffers);
+    }
+
+    /// The buffer pool set with [`set_buffer_pool`](SenderPool::set_buffer_pool).
+    pub fn buffer_pool(&self) -> Option<&Arc<BufferPool>> {
+        self.buffers.as_ref()
+    }
+
+    fn lock_slots(&self) -> MutexGuard<'_, Vec<Slot>> {
+        // A panic whilst holding the lock can't leave the slots inconsistent.
+        self.slots
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    /// Check out a sender for exclusive use, blocking until one is idle.
+    ///
+    /// The sender goes back to the pool when the returned guard is dropped.
+    pub fn get(&self) -> Result<PooledSender<'_>> {
+        let (index, sender) = {
+            let mut slots = self.lock_slots();
+            loop {
+                let idle = slots
+                    .iter()
+                    .enumerate()
+                    .filter(|(_, slot)| !slot.busy)
+                    .min_by_key(|(_, slot)| slot.idle_since)
+                    .map(|(index, _)| index);
+                if let Some(index) = idle {
+                    let slot = &mut slots[index];
+                    slot.busy = true;
+                    break (index, slot.sender.take());
+                }
+                slots = self
+                    .returned
+                    .wait(slots)
+                    .unwrap_or_else(|poisoned| poisoned.into_inner());
+            }
+        };
+
+        // Reconnect outside of the lock, so other threads aren't held up.
+        let sender = match sender {
+            Some(sender) => sender,
+            None => match self.builder.build() {
+                Ok(sender) => sender,
+                Err(err) => {
+                    self.release(index, None);
+                    return Err(err);
+                }
+            },
+        };
+        Ok(PooledSender {
+            pool: self,
+            index,
+            sender: Some(sender),
+        })
+    }
+
+    fn release(&self, index: usize, sender: Option<Sender>) {
+        let mut slots = self.lock_slots();
+        let slot = &mut slots[index];
+        slot.sender = sender.filter(|sender| !sender.must_close());
+        slot.busy = false;
+        slot.idle_since = Instant::now();
+        drop(slots);
+        self.returned.notify_one();
+    }
+
+    /// Send the buffer over the least-loaded connection, clearing the buffer.
+    ///
+    /// See [`Sender::flush`].
+    pub fn flush(&self, buf: &mut Buffer) -> Result<()> {
+        self.get()?.flush(buf)?;
+        if let Some(buffers) = &self.buffers {
+            buffers.recycle(buf);
+        }
+        Ok(())
+    }
+
+    /// Send the buffer over the least-loaded connection, keeping its contents.
+    ///
+    /// See [`Sender::flush_and_keep`].
+    pub fn flush_and_keep(&self, buf: &Buffer) -> Result<()> {
+        self.get()?.flush_and_keep(buf)
+    }
+
+    /// Transactional variant of [`flush_and_keep`](SenderPool::flush_and_keep).
+    ///
+    /// See [`Sender::flush_and_keep_with_flags`].
+    #[cfg(feature = "ilp-over-http")]
+    pub fn flush_and_keep_with_flags(&self, buf: &Buffer, transactional: bool) -> Result<()> {
+        self.get()?.flush_and_keep_with_flags(buf, transactional)
+    }
+
+    /// Send the rows of each table in the buffer as a transactional request
+    /// of its own, over up to [`pool_size`](SenderPool::pool_size)
+    /// connections at once, clearing each table's segment once it's sent.
+    ///
+    /// Returns once all the segments are sent or failed. The segments that
+    /// failed keep their rows, and the error of the first of them, in the
+    /// order the tables first appeared, is returned. See
+    /// [`Sender::flush_multi_table`].
+    #[cfg(feature = "ilp-over-http")]
+    pub fn flush_multi_table(&self, buf: &mut MultiTableBuffer) -> Result<()> {
+        buf.check_complete()?;
+        let segments: Vec<&Buffer> = buf.pending().collect();
+        let mut results: Vec<Option<Result<()>>> = segments.iter().map(|_| None).collect();
+
+        // Each worker takes the next unsent segment until none are left.
+        let next = AtomicUsize::new(0);
+        let work = || {
+            let mut sent = Vec::new();
+            loop {
+                let index = next.fetch_add(1, Ordering::Relaxed);
+                let Some(&segment) = segments.get(index) else {
+                    return sent;
+                };
+                let result = self
+                    .get()
+                    .and_then(|mut sender| sender.flush_and_keep_with_flags(segment, true));
+                sent.push((index, result));
+            }
+        };
+        let workers = self.pool_size().min(segments.len());
+        std::thread::scope(|scope| {
+            let helpers: Vec<_> = (1..workers).map(|_| scope.spawn(work)).collect();
+            let mut sent = work();
+            for helper in helpers {
+                sent.extend(helper.join().expect("flush worker panicked"));
+            }
+            for (index, result) in sent {
+                results[index] = Some(result);
+            }
+        });
+        drop(segments);
+
+        let mut first_err = None;
+        for (segment, result) in buf.pending_mut().zip(results) {
+            match result.expect("every segment was sent") {
+                Ok(()) => segment.clear(),
+                Err(err) => {
+                    first_err.get_or_insert(err);
+                }
+            }
+        }
+        first_err.map_or(Ok(()), Err)
+    }
+}
+
+impl std::fmt::Debug for SenderPool {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
+        write!(f, "SenderPool[size={}]", self.pool_size())
+    }
+}
+
+/// A [`Sender`] checked out of a [`SenderPool`].
+///
+/// Dereferences to the sender. Dropping the guard returns the sender to the
+/// pool.
+pub struct PooledSender<'a> {
+    pool: &'a SenderPool,
+    index: usize,
+    sender: Option<Sender>,
+}
+
+impl Deref for PooledSender<'_> {
+    type Target = Sender;
+
+    fn deref(&self) -> &Sender {
+        self.sender.as_ref().expect("sender is checked out")
+    }
+}
+
+impl DerefMut for PooledSender<'_> {
+    fn deref_mut(&mut self) -> &mut Sender {
+        self.sender.as_mut().expect("sender is checked out")
+    }
+}
+
+impl Drop for PooledSender<'_> {
+    fn drop(&mut self) {
+        self.pool.release(self.index, self.sender.take());
+    }
+}
+
+impl std::fmt::Debug for PooledSender<'_> {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
+        self.deref().fmt(f)
+    }
+}
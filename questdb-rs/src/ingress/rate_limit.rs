@@ -0,0 +1,211 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::sync::Mutex;
+use std::time::{Duration, Instant};
+
+/// How much sending time each paced TCP write covers.
+const PACE_INTERVAL: Duration = Duration::from_millis(10);
+
+/// The smallest paced TCP write, so that low rates don't degrade into a
+/// system call per byte.
+const MIN_PACE_BYTES: usize = 1024;
+
+/// A token bucket refilling at `rate` tokens per second, holding up to one
+/// second's worth.
+///
+/// Taking more tokens than are available leaves the bucket in debt, which
+/// the caller waits out. This keeps a shared bucket fair: Each caller waits
+/// behind the ones that reserved before it.
+#[derive(Debug)]
+struct TokenBucket {
+    rate: f64,
+    tokens: f64,
+    updated: Instant,
+}
+
+impl TokenBucket {
+    fn new(rate: u64, now: Instant) -> Self {
+        Self {
+            rate: rate as f64,
+            tokens: rate as f64,
+            updated: now,
+        }
+    }
+
+    fn refill(&mut self, now: Instant) {
+        let elapsed = now.saturating_duration_since(self.updated).as_secs_f64();
+        self.tokens = (self.tokens + elapsed * self.rate).min(self.rate);
+        self.updated = now;
+    }
+
+    /// Take `amount` tokens and return how long until the bucket is out of
+    /// debt again.
+    fn take(&mut self, amount: usize) -> Duration {
+        self.tokens -= amount as f64;
+        if self.tokens >= 0.0 {
+            Duration::ZERO
+        } else {
+            Duration::from_secs_f64(-self.tokens / self.rate)
+        }
+    }
+
+    /// Put back `amount` tokens that were taken but not used.
+    fn give(&mut self, amount: usize) {
+        self.tokens = (self.tokens + amount as f64).min(self.rate);
+    }
+
+    /// How long until the bucket holds `amount` tokens, or is full if it
+    /// can't hold that many.
+    fn time_until(&self, amount: usize) -> Duration {
+        let missing = (amount as f64).min(self.rate) - self.tokens;
+        if missing <= 0.0 {
+            Duration::ZERO
+        } else {
+            Duration::from_secs_f64(missing / self.rate)
+        }
+    }
+}
+
+#[derive(Debug)]
+struct Buckets {
+    bytes: Option<TokenBucket>,
+    rows: Option<TokenBucket>,
+}
+
+/// The `max_send_rate` and `max_rows_rate` limits of a [`Sender`](super::Sender),
+/// shared by all the senders of a [`SenderPool`](super::SenderPool).
+#[derive(Debug)]
+pub(super) struct RateLimiter {
+    pace_bytes: usize,
+    buckets: Mutex<Buckets>,
+}
+
+impl RateLimiter {
+    /// Returns `None` if neither rate is limited.
+    pub(super) fn new(max_send_rate: Option<u64>, max_rows_rate: Option<u64>) -> Option<Self> {
+        if max_send_rate.is_none() && max_rows_rate.is_none() {
+            return None;
+        }
+        let now = Instant::now();
+        let pace_bytes = max_send_rate.map_or(usize::MAX, |rate| {
+            let per_interval = rate as f64 * PACE_INTERVAL.as_secs_f64();
+            (per_interval as usize).max(MIN_PACE_BYTES)
+        });
+        Some(Self {
+            pace_bytes,
+            buckets: Mutex::new(Buckets {
+                bytes: max_send_rate.map(|rate| TokenBucket::new(rate, now)),
+                rows: max_rows_rate.map(|rate| TokenBucket::new(rate, now)),
+            }),
+        })
+    }
+
+    /// The size of the slices TCP writes are paced in.
+    pub(super) fn pace_bytes(&self) -> usize {
+        self.pace_bytes
+    }
+
+    /// Reserve `bytes` and `rows` and return how long to wait before sending
+    /// them.
+    fn reserve(&self, bytes: usize, rows: usize) -> Duration {
+        let now = Instant::now();
+        let mut buckets = self.buckets.lock().unwrap();
+        let mut wait = Duration::ZERO;
+        if let Some(bucket) = buckets.bytes.as_mut() {
+            bucket.refill(now);
+            wait = wait.max(bucket.take(bytes));
+        }
+        if let Some(bucket) = buckets.rows.as_mut() {
+            bucket.refill(now);
+            wait = wait.max(bucket.take(rows));
+        }
+        wait
+    }
+
+    /// Block until `bytes` and `rows` may be sent.
+    pub(super) fn acquire(&self, bytes: usize, rows: usize) {
+        let wait = self.reserve(bytes, rows);
+        if !wait.is_zero() {
+            std::thread::sleep(wait);
+        }
+    }
+
+    /// Take as many of `bytes` as may be sent right away, without blocking,
+    /// and return that number. None may be sent while the rows are in debt.
+    pub(super) fn try_acquire_bytes(&self, bytes: usize) -> usize {
+        let now = Instant::now();
+        let mut buckets = self.buckets.lock().unwrap();
+        if let Some(bucket) = buckets.rows.as_mut() {
+            bucket.refill(now);
+            if bucket.tokens < 0.0 {
+                return 0;
+            }
+        }
+        let Some(bucket) = buckets.bytes.as_mut() else {
+            return bytes;
+        };
+        bucket.refill(now);
+        let available = bytes.min(bucket.tokens.max(0.0) as usize);
+        bucket.take(available);
+        available
+    }
+
+    /// Give back bytes taken by [`try_acquire_bytes`](RateLimiter::try_acquire_bytes)
+    /// that the socket didn't accept.
+    pub(super) fn refund_bytes(&self, bytes: usize) {
+        let mut buckets = self.buckets.lock().unwrap();
+        if let Some(bucket) = buckets.bytes.as_mut() {
+            bucket.give(bytes);
+        }
+    }
+
+    /// How long until [`try_acquire_bytes`](RateLimiter::try_acquire_bytes)
+    /// grants a full paced slice again: The rows must be out of debt, and the
+    /// bytes refilled to [`pace_bytes`](RateLimiter::pace_bytes).
+    pub(super) fn try_acquire_delay(&self) -> Duration {
+        let now = Instant::now();
+        let mut buckets = self.buckets.lock().unwrap();
+        let mut wait = Duration::ZERO;
+        if let Some(bucket) = buckets.rows.as_mut() {
+            bucket.refill(now);
+            wait = wait.max(bucket.time_until(0));
+        }
+        if let Some(bucket) = buckets.bytes.as_mut() {
+            bucket.refill(now);
+            wait = wait.max(bucket.time_until(self.pace_bytes));
+        }
+        wait
+    }
+
+    /// Charge `rows` without blocking, for rows whose bytes were already
+    /// paced. Later sends wait out any debt.
+    pub(super) fn charge_rows(&self, rows: usize) {
+        let mut buckets = self.buckets.lock().unwrap();
+        if let Some(bucket) = buckets.rows.as_mut() {
+            bucket.refill(Instant::now());
+            bucket.take(rows);
+        }
+    }
+}
@@ -0,0 +1,220 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::collections::VecDeque;
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use crate::error::{self, Error, Result};
+
+use super::Connection;
+
+/// Opens a new ILP/TCP connection, TLS handshake and authentication included.
+pub(super) type Connect = Box<dyn Fn() -> Result<Connection> + Send + Sync>;
+
+/// The pause after the first failed attempt. It doubles after each
+/// subsequent one, up to [`MAX_BACKOFF`].
+const MIN_BACKOFF: Duration = Duration::from_millis(10);
+const MAX_BACKOFF: Duration = Duration::from_secs(1);
+
+#[derive(Default)]
+struct State {
+    /// A reconnection thread is running.
+    running: bool,
+
+    /// The connection established by the thread, until taken.
+    conn: Option<Connection>,
+
+    /// The error of the thread's latest failed attempt.
+    last_err: Option<Error>,
+
+    /// Set when the sender is dropped, to stop the thread.
+    stopped: bool,
+}
+
+struct Shared {
+    state: Mutex<State>,
+    cond: Condvar,
+    connect: Connect,
+}
+
+impl Shared {
+    fn lock(&self) -> MutexGuard<'_, State> {
+        self.state
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    /// Retry connecting with exponential backoff until it works or the
+    /// sender is dropped.
+    fn run(&self) {
+        let mut backoff = MIN_BACKOFF;
+        loop {
+            let result = (self.connect)();
+            let mut state = self.lock();
+            if state.stopped {
+                return;
+            }
+            match result {
+                Ok(conn) => {
+                    state.conn = Some(conn);
+                    state.last_err = None;
+                    state.running = false;
+                    self.cond.notify_all();
+                    return;
+                }
+                Err(err) => {
+                    state.last_err = Some(err);
+                    self.cond.notify_all();
+                }
+            }
+            let (state, _) = self
+                .cond
+                .wait_timeout_while(state, backoff, |state| !state.stopped)
+                .unwrap_or_else(|poisoned| poisoned.into_inner());
+            if state.stopped {
+                return;
+            }
+            backoff = (backoff * 2).min(MAX_BACKOFF);
+        }
+    }
+}
+
+/// Re-establishes a lost ILP/TCP connection on a background thread, and keeps
+/// the most recently flushed buffers to replay over the new connection.
+///
+/// Connecting, the TLS handshake and authentication all happen on the
+/// background thread: The flushing thread only waits for the result, for at
+/// most `timeout`.
+pub(super) struct Reconnector {
+    shared: Arc<Shared>,
+    timeout: Duration,
+
+    /// Copies of the last `replay_limit` buffers written, with their row
+    /// counts, oldest first.
+    replay: VecDeque<(Vec<u8>, usize)>,
+    replay_limit: usize,
+}
+
+impl Reconnector {
+    pub(super) fn new(connect: Connect, timeout: Duration, replay_limit: usize) -> Self {
+        Self {
+            shared: Arc::new(Shared {
+                state: Mutex::new(State::default()),
+                cond: Condvar::new(),
+                connect,
+            }),
+            timeout,
+            replay: VecDeque::with_capacity(replay_limit),
+            replay_limit,
+        }
+    }
+
+    /// Start reconnecting in the background, unless already doing so or done.
+    pub(super) fn start(&self) {
+        let mut state = self.shared.lock();
+        if state.running || state.conn.is_some() {
+            return;
+        }
+        state.running = true;
+        let shared = Arc::clone(&self.shared);
+        let spawned = thread::Builder::new()
+            .name("questdb-reconnect".to_string())
+            .spawn(move || shared.run());
+        if let Err(io_err) = spawned {
+            state.running = false;
+            state.last_err = Some(error::fmt!(
+                SocketError,
+                "Could not start the reconnection thread: {}",
+                io_err
+            ));
+        }
+    }
+
+    /// Take the new connection, waiting for it for at most the configured
+    /// timeout if `wait` is set.
+    pub(super) fn take(&self, wait: bool) -> Result<Connection> {
+        self.start();
+        let deadline = Instant::now() + if wait { self.timeout } else { Duration::ZERO };
+        let mut state = self.shared.lock();
+        loop {
+            if let Some(conn) = state.conn.take() {
+                return Ok(conn);
+            }
+            let now = Instant::now();
+            if now >= deadline || !state.running {
+                break;
+            }
+            state = self
+                .shared
+                .cond
+                .wait_timeout(state, deadline - now)
+                .unwrap_or_else(|poisoned| poisoned.into_inner())
+                .0;
+        }
+        let reason = match state.last_err {
+            Some(ref err) => err.msg().to_string(),
+            None => "Still connecting".to_string(),
+        };
+        Err(error::fmt!(
+            SocketError,
+            "Could not flush buffer: Connection to database lost, reconnecting in the background. {}",
+            reason
+        ))
+    }
+
+    /// Keep a copy of a buffer just written, evicting the oldest one if the
+    /// replay ring is full. The evicted copy's allocation is reused.
+    pub(super) fn record(&mut self, bytes: &[u8], rows: usize) {
+        if self.replay_limit == 0 {
+            return;
+        }
+        let mut slot = if self.replay.len() == self.replay_limit {
+            self.replay.pop_front().unwrap()
+        } else {
+            (Vec::new(), 0)
+        };
+        slot.0.clear();
+        slot.0.extend_from_slice(bytes);
+        slot.1 = rows;
+        self.replay.push_back(slot);
+    }
+
+    /// The buffers to replay over a new connection, oldest first.
+    pub(super) fn replay(&self) -> impl Iterator<Item = (&[u8], usize)> {
+        self.replay
+            .iter()
+            .map(|(bytes, rows)| (bytes.as_slice(), *rows))
+    }
+}
+
+impl Drop for Reconnector {
+    fn drop(&mut self) {
+        // The thread can't be interrupted whilst connecting: Leave it to exit
+        // once the attempt completes, dropping any connection it opens.
+        self.shared.lock().stopped = true;
+        self.shared.cond.notify_all();
+    }
+}
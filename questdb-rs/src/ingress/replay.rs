@@ -0,0 +1,235 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::fs::File;
+use std::ops::{Deref, Range};
+use std::path::Path;
+
+use super::scan::{find_row_end, RowEnd};
+use crate::error;
+use crate::Result;
+
+/// A read-only view of a whole file: Memory-mapped on Unix, read into memory
+/// elsewhere.
+pub(super) struct FileData {
+    #[cfg(unix)]
+    ptr: *mut libc::c_void,
+
+    #[cfg(unix)]
+    len: usize,
+
+    #[cfg(not(unix))]
+    bytes: Vec<u8>,
+
+    file: File,
+}
+
+fn map_file_err(path: &Path, action: &str, io_err: std::io::Error) -> crate::Error {
+    error::fmt!(
+        InvalidApiCall,
+        "Could not {} ILP file {:?}: {}",
+        action,
+        path,
+        io_err
+    )
+}
+
+impl FileData {
+    pub(super) fn open(path: &Path) -> Result<Self> {
+        let file = File::open(path).map_err(|io_err| map_file_err(path, "open", io_err))?;
+        Self::map(path, file)
+    }
+
+    #[cfg(unix)]
+    fn map(path: &Path, file: File) -> Result<Self> {
+        use std::os::unix::io::AsRawFd;
+
+        let len = file
+            .metadata()
+            .map_err(|io_err| map_file_err(path, "stat", io_err))?
+            .len();
+        let len = usize::try_from(len).map_err(|_| {
+            error::fmt!(
+                InvalidApiCall,
+                "ILP file {:?} of {} bytes is too large to map.",
+                path,
+                len
+            )
+        })?;
+        if len == 0 {
+            // `mmap` rejects empty mappings.
+            return Ok(Self {
+                ptr: std::ptr::null_mut(),
+                len,
+                file,
+            });
+        }
+        let ptr = unsafe {
+            libc::mmap(
+                std::ptr::null_mut(),
+                len,
+                libc::PROT_READ,
+                libc::MAP_PRIVATE,
+                file.as_raw_fd(),
+                0,
+            )
+        };
+        if ptr == libc::MAP_FAILED {
+            return Err(map_file_err(path, "map", std::io::Error::last_os_error()));
+        }
+        Ok(Self { ptr, len, file })
+    }
+
+    #[cfg(not(unix))]
+    fn map(path: &Path, mut file: File) -> Result<Self> {
+        use std::io::Read;
+
+        let mut bytes = Vec::new();
+        file.read_to_end(&mut bytes)
+            .map_err(|io_err| map_file_err(path, "read", io_err))?;
+        Ok(Self { bytes, file })
+    }
+
+    /// The open file, for sending straight from the page cache.
+    #[cfg_attr(not(any(target_os = "linux", target_os = "android")), allow(dead_code))]
+    pub(super) fn file(&self) -> &File {
+        &self.file
+    }
+}
+
+impl Deref for FileData {
+    type Target = [u8];
+
+    #[cfg(unix)]
+    fn deref(&self) -> &[u8] {
+        if self.len == 0 {
+            return &[];
+        }
+        unsafe { std::slice::from_raw_parts(self.ptr as *const u8, self.len) }
+    }
+
+    #[cfg(not(unix))]
+    fn deref(&self) -> &[u8] {
+        &self.bytes
+    }
+}
+
+#[cfg(unix)]
+impl Drop for FileData {
+    fn drop(&mut self) {
+        if self.len > 0 {
+            unsafe {
+                libc::munmap(self.ptr, self.len);
+            }
+        }
+    }
+}
+
+/// A run of complete rows to send in one write or request.
+#[derive(Debug, PartialEq)]
+pub(super) struct FileChunk {
+    pub(super) range: Range<usize>,
+    pub(super) rows: usize,
+}
+
+/// Split pre-serialized ILP into runs of whole rows of at most `max_len`
+/// bytes each.
+///
+/// Fails if a row is longer than `max_len` or the last row isn't terminated
+/// by a newline.
+pub(super) fn split_rows(bytes: &[u8], max_len: usize) -> Result<Vec<FileChunk>> {
+    let mut chunks = Vec::new();
+    let mut chunk = FileChunk {
+        range: 0..0,
+        rows: 0,
+    };
+    while chunk.range.end < bytes.len() {
+        let row_start = chunk.range.end;
+        let RowEnd::Found(row_end) = find_row_end(bytes, row_start, false) else {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad ILP file: The row at byte offset {} is not terminated by a newline.",
+                row_start
+            ));
+        };
+        if row_end - row_start > max_len {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad ILP file: The row at byte offset {} is {} bytes long, \
+                exceeding the maximum configured allowed size of {} bytes.",
+                row_start,
+                row_end - row_start,
+                max_len
+            ));
+        }
+        if row_end - chunk.range.start > max_len {
+            let next = FileChunk {
+                range: row_start..row_start,
+                rows: 0,
+            };
+            chunks.push(std::mem::replace(&mut chunk, next));
+        }
+        chunk.range.end = row_end;
+        chunk.rows += 1;
+    }
+    if chunk.rows > 0 {
+        chunks.push(chunk);
+    }
+    Ok(chunks)
+}
+
+/// Send `range` of `file` to `socket` with `sendfile(2)`, copying straight
+/// from the page cache without passing through user space.
+#[cfg(any(target_os = "linux", target_os = "android"))]
+pub(super) fn sendfile_all(
+    socket: &socket2::Socket,
+    file: &File,
+    range: Range<usize>,
+) -> std::io::Result<()> {
+    use std::os::unix::io::AsRawFd;
+
+    let mut offset = range.start as libc::off_t;
+    let end = range.end as libc::off_t;
+    while offset < end {
+        let count = (end - offset) as usize;
+        let sent =
+            unsafe { libc::sendfile(socket.as_raw_fd(), file.as_raw_fd(), &mut offset, count) };
+        match sent {
+            -1 => {
+                let io_err = std::io::Error::last_os_error();
+                if io_err.kind() != std::io::ErrorKind::Interrupted {
+                    return Err(io_err);
+                }
+            }
+            0 => {
+                return Err(std::io::Error::new(
+                    std::io::ErrorKind::WriteZero,
+                    "failed to write whole file",
+                ))
+            }
+            _ => {}
+        }
+    }
+    Ok(())
+}
@@ -0,0 +1,346 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use crate::error::{self, Error, Result};
+
+use super::{
+    check_capacity, escaped_len_bound, escaped_unquoted, write_escaped_quoted,
+    write_escaped_unquoted, write_f64_decimals, write_timestamp, Buffer, ColumnName, Op, OpCase,
+    ProtocolVersion, TableName, TimestampNanos, MAX_F64_LEN, MAX_I64_LEN,
+};
+
+/// The type of a column in a [`RowTemplate`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ColumnType {
+    /// Serialized as [`symbol`](Buffer::symbol) values.
+    Symbol,
+
+    /// Serialized as [`column_bool`](Buffer::column_bool) values.
+    Bool,
+
+    /// Serialized as [`column_i64`](Buffer::column_i64) values.
+    I64,
+
+    /// Serialized as [`column_f64`](Buffer::column_f64) values.
+    F64,
+
+    /// Serialized as [`column_str`](Buffer::column_str) values.
+    Str,
+
+    /// Serialized as [`column_ts`](Buffer::column_ts) values, in microseconds
+    /// since the Unix epoch.
+    TimestampMicros,
+}
+
+/// A single field value for [`Buffer::append_row`].
+#[derive(Debug, Clone, Copy)]
+pub enum ColumnValue<'a> {
+    Symbol(&'a str),
+    Bool(bool),
+    I64(i64),
+    F64(f64),
+    Str(&'a str),
+    TimestampMicros(i64),
+}
+
+impl<'a> ColumnValue<'a> {
+    /// The column type this value can be written to.
+    pub fn column_type(&self) -> ColumnType {
+        match self {
+            ColumnValue::Symbol(_) => ColumnType::Symbol,
+            ColumnValue::Bool(_) => ColumnType::Bool,
+            ColumnValue::I64(_) => ColumnType::I64,
+            ColumnValue::F64(_) => ColumnType::F64,
+            ColumnValue::Str(_) => ColumnType::Str,
+            ColumnValue::TimestampMicros(_) => ColumnType::TimestampMicros,
+        }
+    }
+}
+
+#[derive(Debug, Clone)]
+struct TemplateColumn {
+    /// Escaped key, including the leading separator and the trailing `=`.
+    key: Box<str>,
+    column_type: ColumnType,
+
+    /// Set for `F64` columns named by a [`PreparedColumnName`](super::PreparedColumnName)
+    /// with a fixed number of decimals.
+    decimals: Option<u8>,
+}
+
+/// A fixed table name and column layout, validated and escaped once, for
+/// appending rows with [`Buffer::append_row`].
+///
+/// Rows appended from a template skip the per-field name validation,
+/// escaping and call-order checks of the fluent [`Buffer`] API.
+///
+/// Symbol columns must be declared before any other column type.
+///
+/// ```
+/// # use questdb::Result;
+/// use questdb::ingress::{Buffer, ColumnType, ColumnValue, RowTemplate, TimestampNanos};
+///
+/// # fn main() -> Result<()> {
+/// let template = RowTemplate::new("trades")?
+///     .column("symbol", ColumnType::Symbol)?
+///     .column("price", ColumnType::F64)?
+///     .column("amount", ColumnType::I64)?;
+///
+/// let mut buffer = Buffer::new();
+/// buffer.append_row(
+///     &template,
+///     [
+///         ColumnValue::Symbol("ETH-USD"),
+///         ColumnValue::F64(2615.54),
+///         ColumnValue::I64(100),
+///     ],
+///     Some(TimestampNanos::now()),
+/// )?;
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug, Clone)]
+pub struct RowTemplate {
+    table: Box<str>,
+    prefix: Box<str>,
+    columns: Vec<TemplateColumn>,
+    longest_name: Box<str>,
+}
+
+impl RowTemplate {
+    /// Start a template for rows of the given table.
+    pub fn new<'a, N>(table: N) -> Result<Self>
+    where
+        N: TryInto<TableName<'a>>,
+        Error: From<N::Error>,
+    {
+        let table: TableName<'a> = table.try_into()?;
+        let prefix = escaped_unquoted(table.name);
+        Ok(Self {
+            table: table.name.into(),
+            prefix: prefix.into_boxed_str(),
+            columns: Vec::new(),
+            longest_name: table.name.into(),
+        })
+    }
+
+    /// Append a column to the template's layout.
+    pub fn column<'a, N>(mut self, name: N, column_type: ColumnType) -> Result<Self>
+    where
+        N: TryInto<ColumnName<'a>>,
+        Error: From<N::Error>,
+    {
+        let name: ColumnName<'a> = name.try_into()?;
+        let after_fields = self
+            .columns
+            .last()
+            .map(|column| column.column_type != ColumnType::Symbol)
+            .unwrap_or(false);
+        let sep = if column_type == ColumnType::Symbol {
+            if after_fields {
+                return Err(error::fmt!(
+                    InvalidApiCall,
+                    "Bad call to `RowTemplate::column`: Symbol column {:?} must be declared before the other columns.",
+                    name.name
+                ));
+            }
+            ','
+        } else if after_fields {
+            ','
+        } else {
+            ' '
+        };
+
+        let mut key = String::with_capacity(name.name.len() + 2);
+        key.push(sep);
+        match name.key {
+            Some(prepared) => key.push_str(&prepared[1..]),
+            None => {
+                key.push_str(&escaped_unquoted(name.name));
+                key.push('=');
+            }
+        }
+        self.columns.push(TemplateColumn {
+            key: key.into_boxed_str(),
+            column_type,
+            decimals: name.decimals,
+        });
+        if name.name.len() > self.longest_name.len() {
+            self.longest_name = name.name.into();
+        }
+        Ok(self)
+    }
+
+    /// The table name of the template.
+    pub fn table(&self) -> &str {
+        &self.table
+    }
+
+    /// The column types of the template, in order.
+    pub fn column_types(&self) -> impl ExactSizeIterator<Item = ColumnType> + '_ {
+        self.columns.iter().map(|column| column.column_type)
+    }
+
+    /// Write the row up to, but excluding, the designated timestamp, keeping
+    /// within `fixed_capacity` if set.
+    fn write_values<'v, I>(
+        &self,
+        output: &mut Vec<u8>,
+        protocol_version: ProtocolVersion,
+        fixed_capacity: Option<usize>,
+        values: I,
+    ) -> Result<()>
+    where
+        I: IntoIterator<Item = ColumnValue<'v>>,
+    {
+        let mut values = values.into_iter();
+        let mut int_buf = itoa::Buffer::new();
+        check_capacity(output, fixed_capacity, self.prefix.len())?;
+        output.extend_from_slice(self.prefix.as_bytes());
+        for (index, column) in self.columns.iter().enumerate() {
+            let Some(value) = values.next() else {
+                return Err(value_count_error(index, self.columns.len()));
+            };
+            if value.column_type() != column.column_type {
+                return Err(error::fmt!(
+                    InvalidApiCall,
+                    "Bad call to `append_row`: Value {} is {:?}, expected {:?}.",
+                    index,
+                    value.column_type(),
+                    column.column_type
+                ));
+            }
+            let value_len_bound = match value {
+                ColumnValue::Symbol(value) => escaped_len_bound(value),
+                ColumnValue::Bool(_) => 1,
+                ColumnValue::I64(_) | ColumnValue::TimestampMicros(_) => MAX_I64_LEN + 1,
+                ColumnValue::F64(_) => MAX_F64_LEN,
+                ColumnValue::Str(value) => escaped_len_bound(value) + 2,
+            };
+            check_capacity(output, fixed_capacity, column.key.len() + value_len_bound)?;
+            output.extend_from_slice(column.key.as_bytes());
+            match value {
+                ColumnValue::Symbol(value) => write_escaped_unquoted(output, value),
+                ColumnValue::Bool(value) => output.push(if value { b't' } else { b'f' }),
+                ColumnValue::I64(value) => {
+                    output.extend_from_slice(int_buf.format(value).as_bytes());
+                    output.push(b'i');
+                }
+                ColumnValue::F64(value) => {
+                    write_f64_decimals(output, protocol_version, value, column.decimals)
+                }
+                ColumnValue::Str(value) => write_escaped_quoted(output, value),
+                ColumnValue::TimestampMicros(value) => {
+                    write_timestamp(output, value);
+                    output.push(b't');
+                }
+            }
+        }
+        let extra = values.count();
+        if extra > 0 {
+            return Err(value_count_error(
+                self.columns.len() + extra,
+                self.columns.len(),
+            ));
+        }
+        Ok(())
+    }
+}
+
+fn value_count_error(supplied: usize, expected: usize) -> Error {
+    error::fmt!(
+        InvalidApiCall,
+        "Bad call to `append_row`: {} values supplied, expected {}.",
+        supplied,
+        expected
+    )
+}
+
+impl Buffer {
+    /// Append a complete row laid out as per the `template`.
+    ///
+    /// `values` must supply one value per template column, in order and of
+    /// the matching type. `timestamp` is the designated timestamp of the row:
+    /// Pass `None` to let the server assign it, as with
+    /// [`at_now`](Buffer::at_now).
+    ///
+    /// The row is written as a whole: If a value doesn't match the template,
+    /// the buffer is left unchanged.
+    ///
+    /// See [`RowTemplate`] for an example.
+    pub fn append_row<'v, I>(
+        &mut self,
+        template: &RowTemplate,
+        values: I,
+        timestamp: Option<TimestampNanos>,
+    ) -> Result<&mut Self>
+    where
+        I: IntoIterator<Item = ColumnValue<'v>>,
+    {
+        self.validate_max_name_len(&template.longest_name)?;
+        self.check_op(Op::Table)?;
+        if template.columns.is_empty() {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `append_row`: The template has no columns."
+            ));
+        }
+        if let Some(timestamp) = timestamp {
+            if timestamp.as_i64() < 0 {
+                return Err(error::fmt!(
+                    InvalidTimestamp,
+                    "Timestamp {} is negative. It must be >= 0.",
+                    timestamp.as_i64()
+                ));
+            }
+        }
+
+        let row_start = self.output.len();
+        let written = template
+            .write_values(
+                &mut self.output,
+                self.protocol_version,
+                self.fixed_capacity,
+                values,
+            )
+            .and_then(|()| self.check_capacity(MAX_I64_LEN + 2));
+        if let Err(err) = written {
+            self.output.truncate(row_start);
+            return Err(err);
+        }
+        if let Some(timestamp) = timestamp {
+            self.output.push(b' ');
+            let epoch = self.ts_precision.from_nanos(timestamp.as_i64());
+            write_timestamp(&mut self.output, epoch);
+        }
+        self.output.push(b'\n');
+        self.row_ends.push(self.output.len());
+
+        // A buffer stops being transactional if it targets multiple tables.
+        self.track_table(row_start, template.prefix.len());
+        self.state.op_case = OpCase::MayFlushOrTable;
+        self.state.row_count += 1;
+        Ok(self)
+    }
+}
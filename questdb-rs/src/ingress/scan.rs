@@ -0,0 +1,104 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use super::escape::find_escape;
+use super::DOUBLE_BINARY_FORMAT_TYPE;
+
+/// Bytes the row scanner stops at outside of quoted strings.
+const UNQUOTED_STOPS: &[u8] = b"\n\\ =";
+
+/// Bytes the row scanner stops at within a quoted string.
+const QUOTED_STOPS: &[u8] = b"\"\\";
+
+/// The outcome of scanning pre-serialized ILP for the end of a row.
+#[derive(Debug, PartialEq)]
+pub(super) enum RowEnd {
+    /// The position just past the row's newline.
+    Found(usize),
+
+    /// The input ends before the row's newline.
+    Unterminated,
+
+    /// The row's text isn't valid UTF-8.
+    InvalidUtf8,
+}
+
+/// Find the end of the row starting at `start`.
+///
+/// Escaped newlines don't end a row, and neither do the bytes of quoted
+/// string values and binary `f64` values. The search for each of these is
+/// vectorized, see [`find_escape`].
+///
+/// With `validate_utf8`, the row's text, which is everything bar the payloads
+/// of binary `f64` values, must also be valid UTF-8.
+pub(super) fn find_row_end(bytes: &[u8], start: usize, validate_utf8: bool) -> RowEnd {
+    let is_text = |text: &[u8]| !validate_utf8 || std::str::from_utf8(text).is_ok();
+    let mut pos = start;
+    let mut text_start = start;
+    let mut in_fields = false;
+    while pos < bytes.len() {
+        let Some(offset) = find_escape(UNQUOTED_STOPS, &bytes[pos..]) else {
+            break;
+        };
+        let index = pos + offset;
+        match bytes[index] {
+            b'\n' if is_text(&bytes[text_start..index]) => return RowEnd::Found(index + 1),
+            b'\n' => return RowEnd::InvalidUtf8,
+            b'\\' => pos = index + 2,
+            b' ' => {
+                in_fields = true;
+                pos = index + 1;
+            }
+            _ if !in_fields => pos = index + 1,
+            _ => match (bytes.get(index + 1), bytes.get(index + 2)) {
+                (Some(b'"'), _) => match skip_quoted(bytes, index + 2) {
+                    Some(end) => pos = end,
+                    None => break,
+                },
+                (Some(b'='), Some(&DOUBLE_BINARY_FORMAT_TYPE)) => {
+                    if !is_text(&bytes[text_start..index]) {
+                        return RowEnd::InvalidUtf8;
+                    }
+                    pos = index + 3 + 8;
+                    text_start = pos.min(bytes.len());
+                }
+                _ => pos = index + 1,
+            },
+        }
+    }
+    RowEnd::Unterminated
+}
+
+/// The position just past the closing quote of the string starting at `start`.
+fn skip_quoted(bytes: &[u8], start: usize) -> Option<usize> {
+    let mut pos = start;
+    while pos < bytes.len() {
+        let index = pos + find_escape(QUOTED_STOPS, &bytes[pos..])?;
+        if bytes[index] == b'"' {
+            return Some(index + 1);
+        }
+        pos = index + 2;
+    }
+    None
+}
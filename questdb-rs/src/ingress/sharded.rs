@@ -0,0 +1,413 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use crate::error::{self, Error, Result};
+
+use super::{Buffer, ColumnName, Op, Sender, SenderBuilder, SenderStats, TableName};
+
+/// How a [`ShardedSender`] picks the shard of each row.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum ShardBy {
+    /// By the row's table name, so that each table is written by one shard.
+    Table,
+
+    /// By the value of the named symbol column, e.g. a device ID, spreading a
+    /// table's rows across the shards.
+    Symbol(String),
+}
+
+struct Shard {
+    /// Kept to reconnect the sender after an ILP/TCP error.
+    builder: SenderBuilder,
+    sender: Sender,
+    buf: Buffer,
+}
+
+impl Shard {
+    fn flush(&mut self) -> Result<()> {
+        if self.sender.must_close() {
+            self.sender = self.builder.build()?;
+        }
+        self.sender.flush(&mut self.buf)
+    }
+}
+
+/// Routes rows across several QuestDB servers, each holding a shard of the
+/// data.
+///
+/// Each shard has a [`Sender`] and a [`Buffer`] of its own. Starting a row
+/// with [`table`](ShardedSender::table) or
+/// [`table_with_key`](ShardedSender::table_with_key) picks the row's shard,
+/// as set by the [`ShardBy`] rule, and returns that shard's buffer to continue
+/// the row with. [`flush`](ShardedSender::flush) then sends all the shards'
+/// buffers at once, one thread per shard.
+///
+/// The shard of a row is a stable hash of its table name or key, modulo the
+/// number of shards: The same key always maps to the same shard, for as long
+/// as the list of shards doesn't change.
+///
+/// ```no_run
+/// # use questdb::Result;
+/// use questdb::ingress::{ShardedSender, TimestampNanos};
+///
+/// # fn main() -> Result<()> {
+/// let mut sender = ShardedSender::from_conf(
+///     "http::shards=db1:9000|db1-replica:9000,db2:9000;shard_by=symbol;shard_key=device;",
+/// )?;
+/// sender
+///     .table_with_key("readings", "sensor-17")?
+///     .column_f64("temperature", 21.5)?
+///     .at(TimestampNanos::now())?;
+/// sender.flush()?;
+/// # Ok(())
+/// # }
+/// ```
+pub struct ShardedSender {
+    shards: Vec<Shard>,
+    by: ShardBy,
+
+    /// The shard of the row under construction, if any.
+    current: Option<usize>,
+}
+
+impl ShardedSender {
+    /// Build a sender for each shard, in order, and route rows to them by
+    /// `by`.
+    ///
+    /// In the case of TCP, all the connections are established before this
+    /// function returns.
+    pub fn new(builders: Vec<SenderBuilder>, by: ShardBy) -> Result<Self> {
+        if builders.is_empty() {
+            return Err(error::fmt!(
+                ConfigError,
+                "A sharded sender needs at least one shard."
+            ));
+        }
+        if let ShardBy::Symbol(key) = &by {
+            ColumnName::new(key)?;
+        }
+        let shards = builders
+            .into_iter()
+            .map(|builder| {
+                let sender = builder.build()?;
+                let buf = sender.new_buffer();
+                Ok(Shard {
+                    builder,
+                    sender,
+                    buf,
+                })
+            })
+            .collect::<Result<Vec<_>>>()?;
+        Ok(Self {
+            shards,
+            by,
+            current: None,
+        })
+    }
+
+    /// Create a new `ShardedSender` from the given configuration string.
+    ///
+    /// The format is the same as for [`Sender::from_conf`], except that
+    /// `addr` is replaced by `shards`, a comma-separated list of the shards'
+    /// addresses. Each shard may list failover addresses separated by `|`,
+    /// tried in turn as with `addr`. The other keys apply to every shard.
+    ///
+    /// * `shard_by=table|symbol` sets the [`ShardBy`] rule. The default is
+    ///   `table`.
+    /// * `shard_key=<column>` names the symbol column to shard by, and is
+    ///   required with `shard_by=symbol`.
+    ///
+    /// For example: `"http::shards=db1:9000|db1-replica:9000,db2:9000;shard_by=table;"`.
+    pub fn from_conf<T: AsRef<str>>(conf: T) -> Result<Self> {
+        let (builders, by) = Self::builders_from_conf(conf)?;
+        Self::new(builders, by)
+    }
+
+    /// Create a new `ShardedSender` from the configuration stored in the
+    /// `QDB_CLIENT_CONF` environment variable. The format is the same as that
+    /// accepted by [`ShardedSender::from_conf`].
+    pub fn from_env() -> Result<Self> {
+        let conf = std::env::var("QDB_CLIENT_CONF").map_err(|_| {
+            error::fmt!(ConfigError, "Environment variable QDB_CLIENT_CONF not set.")
+        })?;
+        Self::from_conf(conf)
+    }
+
+    /// Parse a configuration string in the format accepted by
+    /// [`ShardedSender::from_conf`] into a builder per shard and the routing
+    /// rule, to customize the builders before calling [`ShardedSender::new`].
+    pub fn builders_from_conf<T: AsRef<str>>(conf: T) -> Result<(Vec<SenderBuilder>, ShardBy)> {
+        let conf = questdb_confstr::parse_conf_str(conf.as_ref())
+            .map_err(|e| error::fmt!(ConfigError, "Config parse error: {}", e))?;
+        let params = conf.params();
+        if params.contains_key("addr") {
+            return Err(error::fmt!(
+                ConfigError,
+                "\"addr\" can't be used with a sharded sender: List the addresses in \"shards\" instead."
+            ));
+        }
+        let Some(shards) = params.get("shards") else {
+            return Err(error::fmt!(
+                ConfigError,
+                "Missing \"shards\" parameter in config string"
+            ));
+        };
+        let key = params.get("shard_key");
+        let by = match (params.get("shard_by").map(String::as_str), key) {
+            (None | Some("table"), None) => ShardBy::Table,
+            (Some("symbol"), Some(key)) => ShardBy::Symbol(key.clone()),
+            (None | Some("table"), Some(_)) => {
+                return Err(error::fmt!(
+                    ConfigError,
+                    "\"shard_key\" can only be used with \"shard_by=symbol\"."
+                ))
+            }
+            (Some("symbol"), None) => {
+                return Err(error::fmt!(
+                    ConfigError,
+                    "Missing \"shard_key\" parameter, required by \"shard_by=symbol\"."
+                ))
+            }
+            (Some(_), _) => {
+                return Err(error::fmt!(
+                    ConfigError,
+                    r##"Config parameter "shard_by" must be either "table" or "symbol"."##
+                ))
+            }
+        };
+
+        // Every shard shares the other keys, re-escaped for the shard's own
+        // config string.
+        let mut rest = String::new();
+        for (key, val) in params.iter() {
+            if !matches!(key.as_str(), "shards" | "shard_by" | "shard_key") {
+                rest.push_str(&format!("{}={};", key, val.replace(';', ";;")));
+            }
+        }
+        let builders = shards
+            .split(',')
+            .map(|addrs| {
+                SenderBuilder::from_conf(format!(
+                    "{}::addr={};{}",
+                    conf.service(),
+                    addrs.trim().replace('|', ","),
+                    rest
+                ))
+            })
+            .collect::<Result<Vec<_>>>()?;
+        Ok((builders, by))
+    }
+
+    /// The number of shards.
+    pub fn shard_count(&self) -> usize {
+        self.shards.len()
+    }
+
+    /// The rule rows are routed by.
+    pub fn shard_by(&self) -> &ShardBy {
+        &self.by
+    }
+
+    /// The index of the shard that rows with the given table name, or with
+    /// [`ShardBy::Symbol`] the given key, are routed to.
+    pub fn shard_for(&self, key: &str) -> usize {
+        shard_index(key, self.shards.len())
+    }
+
+    /// Start recording a new row for the given table and return the buffer of
+    /// the table's shard to continue the row with.
+    ///
+    /// Only valid with [`ShardBy::Table`]. As with a [`Buffer`], the previous
+    /// row must be complete.
+    pub fn table<'a, N>(&mut self, name: N) -> Result<&mut Buffer>
+    where
+        N: TryInto<TableName<'a>>,
+        Error: From<N::Error>,
+    {
+        if let ShardBy::Symbol(column) = &self.by {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `table`: Rows are sharded by the {column:?} symbol, call `table_with_key` instead."
+            ));
+        }
+        let name: TableName<'a> = name.try_into()?;
+        let index = shard_index(name.name, self.shards.len());
+        start_row(&mut self.shards, &mut self.current, index, name)
+    }
+
+    /// Start recording a new row for the given table in the shard of `key`,
+    /// write `key` as the row's shard key symbol, and return the shard's
+    /// buffer to continue the row with. Record any other symbols next.
+    ///
+    /// Only valid with [`ShardBy::Symbol`]. As with a [`Buffer`], the
+    /// previous row must be complete.
+    pub fn table_with_key<'a, N>(&mut self, name: N, key: &str) -> Result<&mut Buffer>
+    where
+        N: TryInto<TableName<'a>>,
+        Error: From<N::Error>,
+    {
+        let ShardBy::Symbol(column) = &self.by else {
+            return Err(error::fmt!(
+                InvalidApiCall,
+                "Bad call to `table_with_key`: Rows are sharded by table name, call `table` instead."
+            ));
+        };
+        let name: TableName<'a> = name.try_into()?;
+        let index = shard_index(key, self.shards.len());
+        let buf = start_row(&mut self.shards, &mut self.current, index, name)?;
+        buf.symbol(column.as_str(), key)?;
+        Ok(buf)
+    }
+
+    /// Discard the row under construction, if it's incomplete, e.g. after
+    /// one of its columns failed validation. Complete rows are kept.
+    pub fn rewind_row(&mut self) {
+        if let Some(current) = self.current {
+            let buf = &mut self.shards[current].buf;
+            if (buf.state.op_case as isize & Op::Table as isize) == 0 {
+                // The marker was set at the start of the row.
+                let _ = buf.rewind_to_marker();
+            }
+        }
+    }
+
+    /// The buffer of rows pending for the given shard.
+    ///
+    /// Panics if `shard` isn't less than [`shard_count`](ShardedSender::shard_count).
+    pub fn shard_buffer(&self, shard: usize) -> &Buffer {
+        &self.shards[shard].buf
+    }
+
+    /// Take a snapshot of the given shard's flush counters. See
+    /// [`Sender::stats`].
+    ///
+    /// The counters start over when the shard reconnects after an ILP/TCP
+    /// error. Panics if `shard` isn't less than
+    /// [`shard_count`](ShardedSender::shard_count).
+    pub fn stats(&self, shard: usize) -> SenderStats {
+        self.shards[shard].sender.stats()
+    }
+
+    /// The number of rows pending across all the shards.
+    pub fn row_count(&self) -> usize {
+        self.shards.iter().map(|shard| shard.buf.row_count()).sum()
+    }
+
+    /// The number of bytes pending across all the shards.
+    pub fn len(&self) -> usize {
+        self.shards.iter().map(|shard| shard.buf.len()).sum()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.shards.iter().all(|shard| shard.buf.is_empty())
+    }
+
+    /// Discard the rows pending in all the shards.
+    pub fn clear(&mut self) {
+        for shard in &mut self.shards {
+            shard.buf.clear();
+        }
+        self.current = None;
+    }
+
+    /// Send the pending rows of every shard, flushing the shards in parallel.
+    ///
+    /// The shards succeed or fail independently: A shard that flushed is
+    /// cleared, whilst one that failed keeps its rows to retry with the next
+    /// call. If any failed, this returns the error of the lowest-numbered one,
+    /// with its message prefixed by the shard's index.
+    ///
+    /// Over ILP/HTTP, each shard fails over to the next of its addresses as
+    /// usual. Over ILP/TCP, a shard that [must close](Sender::must_close)
+    /// reconnects at the start of its next flush, trying its addresses in
+    /// turn. Bear in mind that the rows of a failed ILP/TCP flush may have
+    /// been partly received, so retrying them may write duplicates.
+    pub fn flush(&mut self) -> Result<()> {
+        if let Some(current) = self.current {
+            self.shards[current].buf.check_op(Op::Flush)?;
+        }
+        let mut pending = self
+            .shards
+            .iter_mut()
+            .enumerate()
+            .filter(|(_, shard)| !shard.buf.is_empty());
+        let results: Vec<(usize, Result<()>)> = std::thread::scope(|scope| {
+            let first = pending.next();
+            let helpers: Vec<_> = pending
+                .map(|(index, shard)| scope.spawn(move || (index, shard.flush())))
+                .collect();
+            let mut results: Vec<_> = first
+                .map(|(index, shard)| (index, shard.flush()))
+                .into_iter()
+                .collect();
+            for helper in helpers {
+                results.push(helper.join().expect("shard flush panicked"));
+            }
+            results
+        });
+
+        let first_err = results.into_iter().find_map(|(index, result)| {
+            result.err().map(|err| {
+                Error::new(err.code(), format!("Shard {}: {}", index, err.msg()))
+                    .with_failed_row(err.failed_row())
+            })
+        });
+        first_err.map_or(Ok(()), Err)
+    }
+}
+
+impl std::fmt::Debug for ShardedSender {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::result::Result<(), std::fmt::Error> {
+        write!(f, "ShardedSender[shards={}]", self.shards.len())
+    }
+}
+
+/// Start a row for `name` in the shard at `index`, once the previous row is
+/// complete.
+fn start_row<'b>(
+    shards: &'b mut [Shard],
+    current: &mut Option<usize>,
+    index: usize,
+    name: TableName,
+) -> Result<&'b mut Buffer> {
+    if let Some(current) = *current {
+        shards[current].buf.check_op(Op::Table)?;
+    }
+    let buf = &mut shards[index].buf;
+    buf.set_marker()?;
+    buf.table(name)?;
+    *current = Some(index);
+    Ok(buf)
+}
+
+/// A 64-bit FNV-1a hash of `key`, modulo `count`. Stable across runs and
+/// platforms, unlike the standard library's hashers.
+fn shard_index(key: &str, count: usize) -> usize {
+    let mut hash: u64 = 0xcbf2_9ce4_8422_2325;
+    for &byte in key.as_bytes() {
+        hash ^= byte as u64;
+        hash = hash.wrapping_mul(0x0000_0100_0000_01b3);
+    }
+    (hash % count as u64) as usize
+}
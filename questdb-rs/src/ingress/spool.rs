@@ -0,0 +1,435 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+//! Store-and-forward spool for ILP-over-HTTP flushes.
+//!
+//! Buffers that could not be sent within the `retry_timeout` are appended to
+//! segment files in the `spool_dir`, and a replay thread sends them to the
+//! server in order once it's reachable again.
+//!
+//! Each segment is an append-only sequence of records: A little-endian `u32`
+//! length followed by the ILP text of one buffer. Segments are named after
+//! their sequence number and are deleted once fully replayed. A record cut
+//! short by a crash is discarded when the spool is re-opened.
+//!
+//! A record the server rejects with an error retrying wouldn't fix is dropped,
+//! as replaying it would block the ones behind it forever. The rejections are
+//! counted, and the first one not yet reported is returned by the sender's
+//! next flush.
+
+use std::collections::VecDeque;
+use std::fs::{self, File, OpenOptions};
+use std::io::{self, Read, Seek, SeekFrom, Write};
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::thread::JoinHandle;
+use std::time::Duration;
+
+use crate::error::{self, Error, Result};
+
+use super::http::{is_retriable_error, map_http_send_err, new_ilp_request, Endpoints, HttpConfig};
+use super::TimestampPrecision;
+
+/// A segment is rotated once it holds this many bytes.
+const SEGMENT_MAX_BYTES: u64 = 64 * 1024 * 1024;
+
+const SEGMENT_EXT: &str = "qdbspool";
+
+const RECORD_HEADER_LEN: u64 = 4;
+
+/// The longest wait between replay attempts whilst the server is unreachable.
+const MAX_REPLAY_INTERVAL: Duration = Duration::from_secs(1);
+
+/// Where and how the replay thread sends the spooled buffers.
+pub(super) struct SpoolTarget {
+    pub(super) agent: ureq::Agent,
+    pub(super) endpoints: Endpoints,
+    pub(super) auth: Option<String>,
+    pub(super) config: HttpConfig,
+
+    /// The sender's precision, which the spooled buffers are written in.
+    pub(super) precision: TimestampPrecision,
+}
+
+struct Segment {
+    seq: u64,
+
+    /// Bytes written to the segment file.
+    len: u64,
+
+    /// Bytes already replayed.
+    replayed: u64,
+}
+
+struct State {
+    /// Oldest first. Every segment holds records not yet replayed.
+    segments: VecDeque<Segment>,
+
+    /// Appends to the last segment, if it's still open for writing.
+    writer: Option<File>,
+
+    next_seq: u64,
+
+    /// Size of all the segment files.
+    total_bytes: u64,
+
+    /// Records the server rejected on replay.
+    rejected: u64,
+
+    /// The oldest rejection not yet reported by a flush.
+    rejection: Option<Error>,
+
+    shutdown: bool,
+}
+
+struct Shared {
+    dir: PathBuf,
+    max_bytes: u64,
+    state: Mutex<State>,
+    cond: Condvar,
+}
+
+pub(super) struct Spool {
+    shared: Arc<Shared>,
+    replayer: Option<JoinHandle<()>>,
+}
+
+fn spool_err(dir: &Path, action: &str, io_err: io::Error) -> Error {
+    error::fmt!(
+        SocketError,
+        "Could not {} spool directory {:?}: {}",
+        action,
+        dir,
+        io_err
+    )
+}
+
+fn segment_path(dir: &Path, seq: u64) -> PathBuf {
+    dir.join(format!("{:020}.{}", seq, SEGMENT_EXT))
+}
+
+/// The length of the complete records at the start of the segment file.
+fn scan_segment(file: &mut File) -> io::Result<u64> {
+    let file_len = file.metadata()?.len();
+    let mut pos = 0u64;
+    let mut header = [0u8; RECORD_HEADER_LEN as usize];
+    while pos + RECORD_HEADER_LEN <= file_len {
+        file.seek(SeekFrom::Start(pos))?;
+        file.read_exact(&mut header)?;
+        let record_len = RECORD_HEADER_LEN + u32::from_le_bytes(header) as u64;
+        if pos + record_len > file_len {
+            break;
+        }
+        pos += record_len;
+    }
+    Ok(pos)
+}
+
+impl Spool {
+    /// Open the spool in `dir`, creating the directory if needed, and start
+    /// replaying any buffers left over from a previous run.
+    pub(super) fn open(dir: PathBuf, max_bytes: u64, target: SpoolTarget) -> Result<Self> {
+        fs::create_dir_all(&dir).map_err(|io_err| spool_err(&dir, "create", io_err))?;
+
+        let mut seqs = Vec::new();
+        for entry in fs::read_dir(&dir).map_err(|io_err| spool_err(&dir, "read", io_err))? {
+            let entry = entry.map_err(|io_err| spool_err(&dir, "read", io_err))?;
+            let path = entry.path();
+            if path.extension().and_then(|ext| ext.to_str()) != Some(SEGMENT_EXT) {
+                continue;
+            }
+            if let Some(seq) = path
+                .file_stem()
+                .and_then(|stem| stem.to_str())
+                .and_then(|stem| stem.parse::<u64>().ok())
+            {
+                seqs.push(seq);
+            }
+        }
+        seqs.sort_unstable();
+
+        let mut segments = VecDeque::with_capacity(seqs.len());
+        let mut total_bytes = 0u64;
+        for &seq in seqs.iter() {
+            let path = segment_path(&dir, seq);
+            let mut file = OpenOptions::new()
+                .read(true)
+                .write(true)
+                .open(&path)
+                .map_err(|io_err| spool_err(&dir, "open", io_err))?;
+            let len = scan_segment(&mut file).map_err(|io_err| spool_err(&dir, "read", io_err))?;
+            if len == 0 {
+                drop(file);
+                let _ = fs::remove_file(&path);
+                continue;
+            }
+            file.set_len(len)
+                .map_err(|io_err| spool_err(&dir, "repair", io_err))?;
+            segments.push_back(Segment {
+                seq,
+                len,
+                replayed: 0,
+            });
+            total_bytes += len;
+        }
+
+        let shared = Arc::new(Shared {
+            dir,
+            max_bytes,
+            state: Mutex::new(State {
+                segments,
+                writer: None,
+                next_seq: seqs.last().map_or(0, |seq| seq + 1),
+                total_bytes,
+                rejected: 0,
+                rejection: None,
+                shutdown: false,
+            }),
+            cond: Condvar::new(),
+        });
+        let replayer = {
+            let shared = Arc::clone(&shared);
+            std::thread::Builder::new()
+                .name("questdb-spool".to_string())
+                .spawn(move || run_replay_loop(shared, target))
+                .map_err(|io_err| {
+                    error::fmt!(
+                        SocketError,
+                        "Could not start the spool replay thread: {}",
+                        io_err
+                    )
+                })?
+        };
+        Ok(Self {
+            shared,
+            replayer: Some(replayer),
+        })
+    }
+
+    /// Tell whether there are spooled buffers still waiting to be replayed.
+    pub(super) fn is_pending(&self) -> bool {
+        !self.shared.lock().segments.is_empty()
+    }
+
+    /// The number of records the server rejected on replay since the spool
+    /// was opened.
+    pub(super) fn rejected(&self) -> u64 {
+        self.shared.lock().rejected
+    }
+
+    /// Take the oldest rejection that hasn't been reported yet.
+    pub(super) fn take_rejection(&self) -> Option<Error> {
+        self.shared.lock().rejection.take()
+    }
+
+    /// Durably append the ILP text of a buffer to the spool.
+    pub(super) fn append(&self, bytes: &[u8]) -> Result<()> {
+        let shared = &self.shared;
+        let record_len = RECORD_HEADER_LEN + bytes.len() as u64;
+        let mut state = shared.lock();
+        if state.total_bytes + record_len > shared.max_bytes {
+            return Err(error::fmt!(
+                SocketError,
+                "Could not flush buffer: The server is unreachable and the spool is full: \
+                {} of \"spool_max_bytes\" {} bytes used, {} more needed.",
+                state.total_bytes,
+                shared.max_bytes,
+                record_len
+            ));
+        }
+
+        let rotate = match (state.writer.as_ref(), state.segments.back()) {
+            (Some(_), Some(last)) => last.len > 0 && last.len + record_len > SEGMENT_MAX_BYTES,
+            _ => true,
+        };
+        if rotate {
+            let seq = state.next_seq;
+            let file = OpenOptions::new()
+                .write(true)
+                .create_new(true)
+                .open(segment_path(&shared.dir, seq))
+                .map_err(|io_err| spool_err(&shared.dir, "write to", io_err))?;
+            state.next_seq += 1;
+            state.writer = Some(file);
+            state.segments.push_back(Segment {
+                seq,
+                len: 0,
+                replayed: 0,
+            });
+        }
+
+        let writer = state.writer.as_mut().unwrap();
+        let written = writer
+            .write_all(&(bytes.len() as u32).to_le_bytes())
+            .and_then(|_| writer.write_all(bytes))
+            .and_then(|_| writer.sync_data());
+        if let Err(io_err) = written {
+            // The tail of the segment is now unknown: Stop appending to it.
+            // The partial record is discarded on the next `open`.
+            state.writer = None;
+            return Err(spool_err(&shared.dir, "write to", io_err));
+        }
+        state.segments.back_mut().unwrap().len += record_len;
+        state.total_bytes += record_len;
+        shared.cond.notify_all();
+        Ok(())
+    }
+}
+
+impl Drop for Spool {
+    /// Stop the replay thread, leaving the remaining buffers on disk for the
+    /// next run. Waits for any replay request in flight to complete.
+    fn drop(&mut self) {
+        self.shared.lock().shutdown = true;
+        self.shared.cond.notify_all();
+        if let Some(replayer) = self.replayer.take() {
+            let _ = replayer.join();
+        }
+    }
+}
+
+impl Shared {
+    fn lock(&self) -> MutexGuard<'_, State> {
+        self.state
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+    }
+
+    /// Account for a replayed (or skipped) record, deleting the oldest segment
+    /// once it's been fully replayed. Segment I/O errors drop the segment.
+    fn advance(&self, seq: u64, record_len: Option<u64>) {
+        let mut state = self.lock();
+        let Some(front) = state.segments.front_mut() else {
+            return;
+        };
+        debug_assert_eq!(front.seq, seq);
+        let done = match record_len {
+            Some(record_len) => {
+                front.replayed += record_len;
+                front.replayed >= front.len
+            }
+            None => true,
+        };
+        if done {
+            let front = state.segments.pop_front().unwrap();
+            if state.segments.is_empty() {
+                // This was also the segment being appended to.
+                state.writer = None;
+            }
+            state.total_bytes -= front.len;
+            let _ = fs::remove_file(segment_path(&self.dir, front.seq));
+        }
+    }
+
+    /// Note a record the server rejected, ahead of dropping it.
+    fn reject(&self, err: Error) {
+        let mut state = self.lock();
+        state.rejected += 1;
+        if state.rejection.is_none() {
+            state.rejection = Some(Error::new(
+                err.code(),
+                format!(
+                    "A spooled buffer was rejected on replay and dropped: {}",
+                    err.msg()
+                ),
+            ));
+        }
+    }
+}
+
+/// Read the record at `pos` from the segment file.
+fn read_record(reader: &mut File, pos: u64) -> io::Result<Vec<u8>> {
+    reader.seek(SeekFrom::Start(pos))?;
+    let mut header = [0u8; RECORD_HEADER_LEN as usize];
+    reader.read_exact(&mut header)?;
+    let mut record = vec![0u8; u32::from_le_bytes(header) as usize];
+    reader.read_exact(&mut record)?;
+    Ok(record)
+}
+
+fn run_replay_loop(shared: Arc<Shared>, target: SpoolTarget) {
+    let mut reader: Option<(u64, File)> = None;
+    let mut retry_interval = Duration::from_millis(10);
+    loop {
+        let (seq, pos) = {
+            let mut state = shared.lock();
+            while state.segments.is_empty() && !state.shutdown {
+                state = shared.cond.wait(state).unwrap_or_else(|p| p.into_inner());
+            }
+            if state.shutdown {
+                return;
+            }
+            let front = state.segments.front().unwrap();
+            (front.seq, front.replayed)
+        };
+
+        if reader.as_ref().map(|(open_seq, _)| *open_seq) != Some(seq) {
+            reader = File::open(segment_path(&shared.dir, seq))
+                .ok()
+                .map(|file| (seq, file));
+        }
+        let record = match reader.as_mut().map(|(_, file)| read_record(file, pos)) {
+            Some(Ok(record)) => record,
+            _ => {
+                // The segment is unreadable: Nothing more can be replayed from it.
+                reader = None;
+                shared.advance(seq, None);
+                continue;
+            }
+        };
+
+        let (endpoint, url) = target.endpoints.current();
+        let request = new_ilp_request(
+            &target.agent,
+            url,
+            target.auth.as_deref(),
+            &target.config,
+            target.precision,
+            record.len(),
+            None,
+        );
+        match request.send_bytes(&record) {
+            Err(err) if is_retriable_error(&err) => {
+                // The server is still unreachable: Back off and try again,
+                // on the next host if there is one.
+                target.endpoints.fail_over(endpoint);
+                let state = shared.lock();
+                if !state.shutdown {
+                    let _ = shared.cond.wait_timeout(state, retry_interval);
+                }
+                retry_interval = (retry_interval * 2).min(MAX_REPLAY_INTERVAL);
+                continue;
+            }
+            result => {
+                // Replayed, or rejected by the server with an error that
+                // retrying wouldn't fix.
+                if let Err(err) = result {
+                    shared.reject(map_http_send_err(err));
+                }
+                retry_interval = Duration::from_millis(10);
+                shared.advance(seq, Some(RECORD_HEADER_LEN + record.len() as u64));
+            }
+        }
+    }
+}
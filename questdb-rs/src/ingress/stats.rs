@@ -0,0 +1,291 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::Duration;
+
+/// Values below this many microseconds each get a bucket of their own.
+const LINEAR_BUCKETS: usize = 16;
+
+/// Each power of two above [`LINEAR_BUCKETS`] is split into `1 << SUB_BITS`
+/// equal buckets, bounding the relative error of a reading to 12.5%.
+const SUB_BITS: u32 = 3;
+
+const BUCKET_COUNT: usize =
+    LINEAR_BUCKETS + (64 - LINEAR_BUCKETS.trailing_zeros() as usize) * (1 << SUB_BITS);
+
+fn bucket_index(micros: u64) -> usize {
+    if micros < LINEAR_BUCKETS as u64 {
+        return micros as usize;
+    }
+    let exp = 63 - micros.leading_zeros();
+    let sub = (micros >> (exp - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+    LINEAR_BUCKETS
+        + (exp - LINEAR_BUCKETS.trailing_zeros()) as usize * (1 << SUB_BITS)
+        + sub as usize
+}
+
+/// The largest value, in microseconds, that falls into the bucket.
+fn bucket_upper_bound(index: usize) -> u64 {
+    if index < LINEAR_BUCKETS {
+        return index as u64;
+    }
+    let offset = index - LINEAR_BUCKETS;
+    let exp = (offset >> SUB_BITS) as u32 + LINEAR_BUCKETS.trailing_zeros();
+    let sub = (offset & ((1 << SUB_BITS) - 1)) as u64;
+    let width = 1u64 << (exp - SUB_BITS);
+    (((1 << SUB_BITS) + sub) << (exp - SUB_BITS)).wrapping_add(width - 1)
+}
+
+fn as_micros(duration: Duration) -> u64 {
+    u64::try_from(duration.as_micros()).unwrap_or(u64::MAX)
+}
+
+/// The counters behind [`Sender::stats`](super::Sender::stats).
+///
+/// Updates are relaxed atomic increments: They never block and cost no more
+/// than a plain add on the flush path.
+pub(super) struct StatsRecorder {
+    flushes: AtomicU64,
+    failed_flushes: AtomicU64,
+    bytes_sent: AtomicU64,
+    rows_sent: AtomicU64,
+    network_retries: AtomicU64,
+    server_retries: AtomicU64,
+    retry_sleep_micros: AtomicU64,
+    connect_micros: AtomicU64,
+    reconnects: AtomicU64,
+    latency_sum_micros: AtomicU64,
+    latency_max_micros: AtomicU64,
+    latency_buckets: Box<[AtomicU64]>,
+}
+
+impl StatsRecorder {
+    pub(super) fn new() -> Self {
+        Self {
+            flushes: AtomicU64::new(0),
+            failed_flushes: AtomicU64::new(0),
+            bytes_sent: AtomicU64::new(0),
+            rows_sent: AtomicU64::new(0),
+            network_retries: AtomicU64::new(0),
+            server_retries: AtomicU64::new(0),
+            retry_sleep_micros: AtomicU64::new(0),
+            connect_micros: AtomicU64::new(0),
+            reconnects: AtomicU64::new(0),
+            latency_sum_micros: AtomicU64::new(0),
+            latency_max_micros: AtomicU64::new(0),
+            latency_buckets: (0..BUCKET_COUNT).map(|_| AtomicU64::new(0)).collect(),
+        }
+    }
+
+    pub(super) fn record_connect(&self, elapsed: Duration) {
+        self.connect_micros
+            .store(as_micros(elapsed), Ordering::Relaxed);
+    }
+
+    pub(super) fn record_reconnect(&self) {
+        self.reconnects.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Record a successful flush of `bytes` bytes containing `rows` rows.
+    /// Pass `None` for `elapsed` if the flush wasn't timed.
+    pub(super) fn record_flush(&self, bytes: usize, rows: usize, elapsed: Option<Duration>) {
+        self.flushes.fetch_add(1, Ordering::Relaxed);
+        self.bytes_sent.fetch_add(bytes as u64, Ordering::Relaxed);
+        self.rows_sent.fetch_add(rows as u64, Ordering::Relaxed);
+        if let Some(elapsed) = elapsed {
+            let micros = as_micros(elapsed);
+            self.latency_buckets[bucket_index(micros)].fetch_add(1, Ordering::Relaxed);
+            self.latency_sum_micros.fetch_add(micros, Ordering::Relaxed);
+            self.latency_max_micros.fetch_max(micros, Ordering::Relaxed);
+        }
+    }
+
+    pub(super) fn record_failed_flush(&self) {
+        self.failed_flushes.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// Record a retry after a network error, or otherwise after a retriable
+    /// status code, and the time spent sleeping before it.
+    pub(super) fn record_retry(&self, network_error: bool, slept: Duration) {
+        let counter = if network_error {
+            &self.network_retries
+        } else {
+            &self.server_retries
+        };
+        counter.fetch_add(1, Ordering::Relaxed);
+        self.retry_sleep_micros
+            .fetch_add(as_micros(slept), Ordering::Relaxed);
+    }
+
+    pub(super) fn snapshot(&self) -> SenderStats {
+        let load = |counter: &AtomicU64| counter.load(Ordering::Relaxed);
+        SenderStats {
+            flushes: load(&self.flushes),
+            failed_flushes: load(&self.failed_flushes),
+            bytes_sent: load(&self.bytes_sent),
+            rows_sent: load(&self.rows_sent),
+            network_retries: load(&self.network_retries),
+            server_retries: load(&self.server_retries),
+            retry_sleep: Duration::from_micros(load(&self.retry_sleep_micros)),
+            connect_time: Duration::from_micros(load(&self.connect_micros)),
+            reconnects: load(&self.reconnects),
+            spool_rejected: 0,
+            flush_latency: LatencyHistogram {
+                counts: self.latency_buckets.iter().map(load).collect(),
+                sum_micros: load(&self.latency_sum_micros),
+                max_micros: load(&self.latency_max_micros),
+            },
+        }
+    }
+}
+
+/// A point-in-time copy of a [`Sender`](super::Sender)'s counters, as
+/// returned by [`Sender::stats`](super::Sender::stats).
+///
+/// All counters are cumulative since the sender was built: Diff two
+/// snapshots to get rates.
+#[derive(Debug, Clone)]
+pub struct SenderStats {
+    /// Number of successful flushes.
+    pub flushes: u64,
+
+    /// Number of flushes that returned an error.
+    pub failed_flushes: u64,
+
+    /// Uncompressed ILP bytes flushed successfully. With a spool configured,
+    /// this includes the bytes handed to the spool.
+    pub bytes_sent: u64,
+
+    /// Rows flushed successfully.
+    pub rows_sent: u64,
+
+    /// ILP/HTTP requests retried after a network error.
+    pub network_retries: u64,
+
+    /// ILP/HTTP requests retried after a retriable status code from the server.
+    pub server_retries: u64,
+
+    /// Total time spent sleeping between ILP/HTTP retries.
+    pub retry_sleep: Duration,
+
+    /// Time taken to connect, including the TLS handshake and authentication.
+    /// Only measured for ILP/TCP: ILP/HTTP connects lazily and transparently.
+    pub connect_time: Duration,
+
+    /// ILP/TCP connections re-established after a write error. See
+    /// [`SenderBuilder::reconnect_timeout`](super::SenderBuilder::reconnect_timeout).
+    pub reconnects: u64,
+
+    /// Spooled ILP/HTTP buffers the server rejected on replay with an error
+    /// that retrying wouldn't fix. Their rows were dropped. See
+    /// [`SenderBuilder::spool_dir`](super::SenderBuilder::spool_dir).
+    pub spool_rejected: u64,
+
+    /// The latency distribution of successful blocking flushes, retries
+    /// included. [`Sender::try_flush`](super::Sender::try_flush) calls are
+    /// counted in `flushes`, `bytes_sent` and `rows_sent` but not timed.
+    pub flush_latency: LatencyHistogram,
+}
+
+/// A log-linear histogram of flush latencies with microsecond resolution.
+///
+/// Below 16µs every microsecond has its own bucket. Above, each power of two
+/// is split into 8 buckets, so quantiles are exact to within 12.5%.
+#[derive(Debug, Clone)]
+pub struct LatencyHistogram {
+    counts: Box<[u64]>,
+    sum_micros: u64,
+    max_micros: u64,
+}
+
+impl LatencyHistogram {
+    /// Number of recorded flushes.
+    pub fn count(&self) -> u64 {
+        self.counts.iter().sum()
+    }
+
+    /// The sum of all the recorded latencies.
+    pub fn sum(&self) -> Duration {
+        Duration::from_micros(self.sum_micros)
+    }
+
+    /// The slowest recorded flush.
+    pub fn max(&self) -> Duration {
+        Duration::from_micros(self.max_micros)
+    }
+
+    /// The mean latency, or zero if nothing was recorded.
+    pub fn mean(&self) -> Duration {
+        match self.count() {
+            0 => Duration::ZERO,
+            count => Duration::from_micros(self.sum_micros / count),
+        }
+    }
+
+    /// The latency at or below which the `q` fraction of flushes completed,
+    /// e.g. `0.99` for the 99th percentile. `q` is clamped to `0.0..=1.0`.
+    ///
+    /// Returns the upper bound of the bucket the quantile falls into, capped at
+    /// [`max`](LatencyHistogram::max), or zero if nothing was recorded.
+    pub fn quantile(&self, q: f64) -> Duration {
+        let count = self.count();
+        if count == 0 {
+            return Duration::ZERO;
+        }
+        let rank = ((q.clamp(0.0, 1.0) * count as f64).ceil() as u64).max(1);
+        let mut seen = 0;
+        for (index, &bucket_count) in self.counts.iter().enumerate() {
+            seen += bucket_count;
+            if seen >= rank {
+                let upper = bucket_upper_bound(index).min(self.max_micros);
+                return Duration::from_micros(upper);
+            }
+        }
+        self.max()
+    }
+
+    /// Add the flushes recorded by `other` to this histogram, e.g. to report
+    /// the combined latencies of several senders.
+    pub fn merge(&mut self, other: &LatencyHistogram) {
+        for (count, other_count) in self.counts.iter_mut().zip(other.counts.iter()) {
+            *count += other_count;
+        }
+        self.sum_micros = self.sum_micros.saturating_add(other.sum_micros);
+        self.max_micros = self.max_micros.max(other.max_micros);
+    }
+
+    /// The non-empty buckets in ascending order, each as the largest latency
+    /// falling into it and the number of flushes that did so.
+    ///
+    /// The counts are per bucket: Accumulate them for exporters that expect
+    /// cumulative buckets, such as Prometheus.
+    pub fn buckets(&self) -> impl Iterator<Item = (Duration, u64)> + '_ {
+        self.counts
+            .iter()
+            .enumerate()
+            .filter(|(_, &count)| count > 0)
+            .map(|(index, &count)| (Duration::from_micros(bucket_upper_bound(index)), count))
+    }
+}
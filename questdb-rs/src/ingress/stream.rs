@@ -0,0 +1,212 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::io::{self, Read};
+
+use crate::error::{self, Error, Result};
+
+use super::http::RequestBody;
+use super::rate_limit::RateLimiter;
+use super::{Buffer, Op};
+
+/// The body of a [`Sender::flush_stream`](super::Sender::flush_stream)
+/// request: Reads the rows out of a chunk buffer, asking for the next chunk
+/// once it's drained.
+///
+/// The bytes read are kept in a replay window, so that a failed attempt can
+/// be resent in full before the stream carries on. A stream that outgrows
+/// the window can't be resent.
+pub(super) struct StreamBody<'a, F> {
+    fill: F,
+    chunk: Buffer,
+
+    /// The bytes of `chunk` read so far.
+    pos: usize,
+
+    /// Set once `fill` reported the last chunk.
+    done: bool,
+
+    /// The bytes read so far, unless more than `window` bytes were.
+    replay: Vec<u8>,
+
+    /// The bytes of `replay` read by the current attempt. Short of
+    /// `replay.len()` whilst a retry is resending them.
+    replay_pos: usize,
+
+    window: usize,
+    overflowed: bool,
+
+    transactional: bool,
+
+    /// The escaped table name of the first row, when transactional.
+    table: Option<Vec<u8>>,
+
+    rate_limiter: Option<&'a RateLimiter>,
+
+    /// The error returned by `fill`, or by validating a chunk.
+    error: Option<Error>,
+
+    pub(super) rows: usize,
+    pub(super) bytes: usize,
+}
+
+impl<'a, F> StreamBody<'a, F>
+where
+    F: FnMut(&mut Buffer) -> Result<bool>,
+{
+    pub(super) fn new(
+        fill: F,
+        chunk: Buffer,
+        window: usize,
+        transactional: bool,
+        rate_limiter: Option<&'a RateLimiter>,
+    ) -> Self {
+        Self {
+            fill,
+            chunk,
+            pos: 0,
+            done: false,
+            replay: Vec::new(),
+            replay_pos: 0,
+            window,
+            overflowed: false,
+            transactional,
+            table: None,
+            rate_limiter,
+            error: None,
+            rows: 0,
+            bytes: 0,
+        }
+    }
+
+    /// Whether the stream turned out to be empty. Fetches the first chunk.
+    pub(super) fn is_empty(&mut self) -> Result<bool> {
+        while self.chunk.is_empty() && !self.done {
+            self.next_chunk()?;
+        }
+        Ok(self.chunk.is_empty())
+    }
+
+    /// Whether the stream was too long to keep in the replay window.
+    pub(super) fn overflowed(&self) -> bool {
+        self.overflowed
+    }
+
+    /// Take the error that ended the stream, if it wasn't a network error.
+    pub(super) fn take_error(&mut self) -> Option<Error> {
+        self.error.take()
+    }
+
+    fn next_chunk(&mut self) -> Result<()> {
+        self.chunk.clear();
+        self.pos = 0;
+        self.done = !(self.fill)(&mut self.chunk)?;
+        if self.chunk.is_empty() {
+            return Ok(());
+        }
+        self.chunk.check_op(Op::Flush)?;
+        if self.transactional {
+            let first_len = self.chunk.state.first_table_len.unwrap_or(0);
+            let table = &self.chunk.output[..first_len];
+            let same_table = match self.table {
+                Some(ref first) => first.as_slice() == table,
+                None => {
+                    self.table = Some(table.to_vec());
+                    true
+                }
+            };
+            if !same_table || !self.chunk.transactional() {
+                return Err(error::fmt!(
+                    InvalidApiCall,
+                    "Stream contains lines for multiple tables. \
+                    Transactional flushes are only supported for streams containing lines for a single table."
+                ));
+            }
+        }
+        if let Some(rate_limiter) = self.rate_limiter {
+            rate_limiter.acquire(self.chunk.len(), self.chunk.row_count());
+        }
+        self.rows += self.chunk.row_count();
+        self.bytes += self.chunk.len();
+        Ok(())
+    }
+}
+
+impl<F> Read for StreamBody<'_, F>
+where
+    F: FnMut(&mut Buffer) -> Result<bool>,
+{
+    fn read(&mut self, out: &mut [u8]) -> io::Result<usize> {
+        if self.replay_pos < self.replay.len() {
+            let count = out.len().min(self.replay.len() - self.replay_pos);
+            out[..count].copy_from_slice(&self.replay[self.replay_pos..][..count]);
+            self.replay_pos += count;
+            return Ok(count);
+        }
+        while self.pos == self.chunk.len() {
+            if self.done {
+                return Ok(0);
+            }
+            if let Err(err) = self.next_chunk() {
+                let io_err = io::Error::new(io::ErrorKind::Other, err.msg().to_string());
+                self.error = Some(err);
+                return Err(io_err);
+            }
+        }
+        let count = out.len().min(self.chunk.len() - self.pos);
+        let bytes = &self.chunk.output[self.pos..][..count];
+        out[..count].copy_from_slice(bytes);
+        self.pos += count;
+        if !self.overflowed {
+            if self.replay.len() + count <= self.window {
+                self.replay.extend_from_slice(bytes);
+                self.replay_pos = self.replay.len();
+            } else {
+                self.overflowed = true;
+                self.replay = Vec::new();
+                self.replay_pos = 0;
+            }
+        }
+        Ok(count)
+    }
+}
+
+impl<F> RequestBody for &mut StreamBody<'_, F>
+where
+    F: FnMut(&mut Buffer) -> Result<bool>,
+{
+    fn len(&self) -> usize {
+        self.bytes
+    }
+
+    fn send(&mut self, request: ureq::Request) -> std::result::Result<ureq::Response, ureq::Error> {
+        // Resend what earlier attempts already read, if anything.
+        self.replay_pos = 0;
+        request.send(&mut **self)
+    }
+
+    fn can_resend(&self) -> bool {
+        !self.overflowed && self.error.is_none()
+    }
+}
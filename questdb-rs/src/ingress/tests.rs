@@ -354,6 +354,39 @@ fn tcps_tls_roots_file() {
     assert_specified_eq(&builder.tls_roots, path);
 }
 
+#[test]
+fn tls_config_cache() {
+    let tmp_dir = TempDir::new().unwrap();
+    let path = Some(tmp_dir.path().join("cacerts.pem"));
+    let root_ca = crate::tests::mock::certs_dir().join("server_rootCA.pem");
+    std::fs::copy(root_ca, path.as_ref().unwrap()).unwrap();
+
+    let config = |tls_roots: &Option<PathBuf>| {
+        configure_tls(true, true, CertificateAuthority::PemFile, tls_roots)
+            .unwrap()
+            .unwrap()
+    };
+    let first = config(&path);
+    assert!(Arc::ptr_eq(&first, &config(&path)));
+
+    // A replaced roots file is reloaded.
+    let file = std::fs::File::options()
+        .write(true)
+        .open(path.as_ref().unwrap())
+        .unwrap();
+    file.set_modified(SystemTime::now() + Duration::from_secs(60))
+        .unwrap();
+    let reloaded = config(&path);
+    assert!(!Arc::ptr_eq(&first, &reloaded));
+    assert!(Arc::ptr_eq(&reloaded, &config(&path)));
+
+    assert!(
+        configure_tls(false, true, CertificateAuthority::PemFile, &path)
+            .unwrap()
+            .is_none()
+    );
+}
+
 #[test]
 fn tcps_tls_roots_file_missing() {
     let err =
@@ -415,6 +448,37 @@ fn http_retry_timeout() {
     assert_specified_eq(&http_config.retry_timeout, Duration::from_millis(100));
 }
 
+#[cfg(feature = "ilp-over-http")]
+#[test]
+fn http_compression() {
+    let builder = SenderBuilder::from_conf("http::addr=localhost;").unwrap();
+    assert_defaulted_eq(&builder.http.unwrap().compression, Compression::None);
+
+    let builder = SenderBuilder::from_conf("http::addr=localhost;compression=none;").unwrap();
+    assert_specified_eq(&builder.http.unwrap().compression, Compression::None);
+
+    #[cfg(feature = "compression-gzip")]
+    {
+        let builder = SenderBuilder::from_conf("http::addr=localhost;compression=gzip;").unwrap();
+        assert_specified_eq(&builder.http.unwrap().compression, Compression::Gzip);
+    }
+
+    #[cfg(feature = "compression-zstd")]
+    {
+        let builder = SenderBuilder::from_conf("http::addr=localhost;compression=zstd;").unwrap();
+        assert_specified_eq(&builder.http.unwrap().compression, Compression::Zstd);
+    }
+
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;compression=lz4;"),
+        "Invalid value \"lz4\" for \"compression\"",
+    );
+    assert_conf_err(
+        SenderBuilder::from_conf("tcp::addr=localhost;compression=none;"),
+        "\"compression\" is supported only in ILP over HTTP.",
+    );
+}
+
 #[cfg(feature = "ilp-over-http")]
 #[test]
 fn connect_timeout_uses_request_timeout() {
@@ -447,27 +511,1102 @@ fn auto_flush_off() {
 }
 
 #[test]
-fn auto_flush_unsupported() {
+fn auto_flush_defaults() {
+    let builder = SenderBuilder::from_conf("tcps::addr=localhost;").unwrap();
+    assert_defaulted_eq(&builder.auto_flush, true);
+    assert_defaulted_eq(&builder.auto_flush_rows, Some(600));
+    assert_defaulted_eq(&builder.auto_flush_bytes, None);
+    assert_defaulted_eq(
+        &builder.auto_flush_interval,
+        Some(Duration::from_millis(1000)),
+    );
+
+    #[cfg(feature = "ilp-over-http")]
+    {
+        let builder = SenderBuilder::from_conf("https::addr=localhost;").unwrap();
+        assert_defaulted_eq(&builder.auto_flush_rows, Some(75000));
+    }
+}
+
+#[test]
+fn auto_flush_thresholds() {
+    let builder = SenderBuilder::from_conf(
+        "tcps::addr=localhost;auto_flush=on;auto_flush_rows=100;\
+        auto_flush_bytes=4096;auto_flush_interval=250;",
+    )
+    .unwrap();
+    assert_specified_eq(&builder.auto_flush, true);
+    assert_specified_eq(&builder.auto_flush_rows, Some(100));
+    assert_specified_eq(&builder.auto_flush_bytes, Some(4096));
+    assert_specified_eq(
+        &builder.auto_flush_interval,
+        Some(Duration::from_millis(250)),
+    );
+
+    let builder = SenderBuilder::from_conf(
+        "tcps::addr=localhost;auto_flush_rows=off;auto_flush_interval=off;",
+    )
+    .unwrap();
+    assert_specified_eq(&builder.auto_flush_rows, None);
+    assert_specified_eq(&builder.auto_flush_interval, None);
+}
+
+#[test]
+fn auto_flush_invalid() {
+    assert_conf_err(
+        SenderBuilder::from_conf("tcps::addr=localhost;auto_flush=yes;"),
+        r#"Config parameter "auto_flush" must be either "on" or "off"."#,
+    );
+    assert_conf_err(
+        SenderBuilder::from_conf("tcps::addr=localhost;auto_flush_rows=0;"),
+        "\"auto_flush_rows\" must be greater than 0.",
+    );
+    assert_conf_err(
+        SenderBuilder::from_conf("tcps::addr=localhost;auto_flush_bytes=abc;"),
+        "Could not parse \"auto_flush_bytes\" to number: ParseIntError { kind: InvalidDigit }",
+    );
+    assert_conf_err(
+        SenderBuilder::from_conf("tcps::addr=localhost;auto_flush=off;auto_flush_rows=100;"),
+        "Config parameter \"auto_flush_rows\" can't be set when \"auto_flush=off\".",
+    );
+}
+
+#[cfg(feature = "ilp-over-http")]
+#[test]
+fn spool() {
+    let builder = SenderBuilder::from_conf("http::addr=localhost;").unwrap();
+    let http = builder.http.unwrap();
+    assert_defaulted_eq(&http.spool_dir, None);
+    assert_defaulted_eq(&http.spool_max_bytes, 1024 * 1024 * 1024);
+
+    let builder = SenderBuilder::from_conf(
+        "http::addr=localhost;spool_dir=/var/spool/qdb;spool_max_bytes=1048576;",
+    )
+    .unwrap();
+    let http = builder.http.unwrap();
+    assert_specified_eq(&http.spool_dir, Some(PathBuf::from("/var/spool/qdb")));
+    assert_specified_eq(&http.spool_max_bytes, 1048576);
+
+    assert_conf_err(
+        SenderBuilder::from_conf("tcp::addr=localhost;spool_dir=/var/spool/qdb;"),
+        "\"spool_dir\" is supported only in ILP over HTTP.",
+    );
+}
+
+#[cfg(feature = "ilp-over-http")]
+#[test]
+fn retry_policy() {
+    let builder = SenderBuilder::from_conf("http::addr=localhost;").unwrap();
+    let http = builder.http.unwrap();
+    assert_defaulted_eq(&http.retry_backoff, RetryBackoff::Exponential);
+    assert_defaulted_eq(&http.retry_after, true);
+    assert_defaulted_eq(&http.retry_budget, 0u32);
+    assert_defaulted_eq(&http.circuit_breaker_threshold, 0u32);
+    assert_defaulted_eq(&http.circuit_breaker_cooldown, Duration::from_secs(5));
+
+    let builder = SenderBuilder::from_conf(
+        "http::addr=localhost;retry_backoff=full_jitter;retry_after=off;retry_budget=50;\
+        circuit_breaker_threshold=3;circuit_breaker_cooldown=250;",
+    )
+    .unwrap();
+    let http = builder.http.unwrap();
+    assert_specified_eq(&http.retry_backoff, RetryBackoff::FullJitter);
+    assert_specified_eq(&http.retry_after, false);
+    assert_specified_eq(&http.retry_budget, 50u32);
+    assert_specified_eq(&http.circuit_breaker_threshold, 3u32);
+    assert_specified_eq(&http.circuit_breaker_cooldown, Duration::from_millis(250));
+
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;retry_backoff=linear;"),
+        r##"Config parameter "retry_backoff" must be one of "exponential", "full_jitter" or "decorrelated"."##,
+    );
+    assert_conf_err(
+        SenderBuilder::from_conf("tcp::addr=localhost;retry_budget=10;"),
+        "\"retry_budget\" is supported only in ILP over HTTP.",
+    );
+}
+
+#[cfg(feature = "ilp-over-http")]
+#[test]
+fn prewarm() {
+    let builder = SenderBuilder::from_conf("http::addr=localhost;").unwrap();
+    let http = builder.http.unwrap();
+    assert_defaulted_eq(&http.prewarm, false);
+    assert_defaulted_eq(&http.ping_interval, Some(Duration::from_secs(10)));
+
+    let builder =
+        SenderBuilder::from_conf("http::addr=localhost;prewarm=on;ping_interval=2500;").unwrap();
+    let http = builder.http.unwrap();
+    assert_specified_eq(&http.prewarm, true);
+    assert_specified_eq(&http.ping_interval, Some(Duration::from_millis(2500)));
+
+    let builder = SenderBuilder::from_conf("http::addr=localhost;ping_interval=off;").unwrap();
+    assert_specified_eq(&builder.http.unwrap().ping_interval, None);
+
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;prewarm=yes;"),
+        r##"Config parameter "prewarm" must be either "on" or "off"."##,
+    );
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;ping_interval=0;"),
+        "\"ping_interval\" must be greater than 0.",
+    );
+    assert_conf_err(
+        SenderBuilder::from_conf("tcp::addr=localhost;prewarm=on;"),
+        "\"prewarm\" is supported only in ILP over HTTP.",
+    );
+}
+
+#[cfg(feature = "ilp-over-http")]
+#[test]
+fn stream_replay_window() {
+    let builder = SenderBuilder::from_conf("http::addr=localhost;").unwrap();
+    assert_defaulted_eq(
+        &builder.http.unwrap().stream_replay_window,
+        16 * 1024 * 1024,
+    );
+
+    let builder =
+        SenderBuilder::from_conf("http::addr=localhost;stream_replay_window=4096;").unwrap();
+    assert_specified_eq(&builder.http.unwrap().stream_replay_window, 4096);
+
+    assert_conf_err(
+        SenderBuilder::from_conf("tcp::addr=localhost;stream_replay_window=4096;"),
+        "\"stream_replay_window\" is supported only in ILP over HTTP.",
+    );
+}
+
+#[cfg(feature = "ilp-over-http")]
+#[test]
+fn http2() {
+    #[cfg(feature = "ilp-over-http2")]
+    {
+        let builder = SenderBuilder::from_conf("http::addr=localhost;").unwrap();
+        assert_defaulted_eq(&builder.http.unwrap().http2, false);
+
+        let builder = SenderBuilder::from_conf("https::addr=localhost;http2=on;").unwrap();
+        assert_specified_eq(&builder.http.as_ref().unwrap().http2, true);
+        assert_conf_err(
+            builder.build(),
+            "\"http2\" is supported only by the async sender: Call `build_async` instead.",
+        );
+        let sender = builder.build_async().unwrap();
+        sender.try_clone().unwrap();
+
+        assert_conf_err(
+            SenderBuilder::from_conf("tcp::addr=localhost;http2=on;"),
+            "\"http2\" is supported only in ILP over HTTP.",
+        );
+    }
+
+    #[cfg(not(feature = "ilp-over-http2"))]
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;http2=on;"),
+        "Config parameter \"http2=on\" requires the \"ilp-over-http2\" feature",
+    );
+
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;http2=yes;"),
+        r##"Config parameter "http2" must be either "on" or "off"."##,
+    );
+}
+
+#[cfg(feature = "ilp-over-http")]
+#[test]
+fn retry_schedule() {
+    let builder = SenderBuilder::from_conf("http::addr=localhost;retry_backoff=full_jitter;")
+        .unwrap()
+        .retry_timeout(Duration::from_secs(10))
+        .unwrap();
+    let config = builder.http.unwrap();
+    let mut schedule = RetrySchedule::new(&config);
+    for ceiling_ms in [10, 20, 40, 80, 160, 320, 640, 1000, 1000] {
+        let delay = schedule.next_delay(None).unwrap();
+        assert!(delay <= Duration::from_millis(ceiling_ms));
+    }
+
+    // The server's `Retry-After` stretches the delay, within the retry timeout.
+    let retry_after = parse_retry_after(503, Some("2"));
+    assert_eq!(retry_after, Some(Duration::from_secs(2)));
+    assert!(schedule.next_delay(retry_after).unwrap() >= Duration::from_secs(2));
+    assert_eq!(schedule.next_delay(Some(Duration::from_secs(60))), None);
+    assert_eq!(parse_retry_after(500, Some("2")), None);
+}
+
+#[cfg(feature = "ilp-over-http")]
+#[test]
+fn circuit_breaker() {
+    let builder = SenderBuilder::from_conf(
+        "http::addr=localhost;circuit_breaker_threshold=2;circuit_breaker_cooldown=50;",
+    )
+    .unwrap();
+    let config = builder.http.unwrap();
+    let mut breaker = CircuitBreaker::new(&config);
+    breaker.record(true);
+    assert!(breaker.check().is_ok());
+    breaker.record(true);
+    let err = breaker.check().unwrap_err();
+    assert_eq!(err.code(), ErrorCode::SocketError);
+
+    // After the cooldown, one request is let through.
+    std::thread::sleep(Duration::from_millis(60));
+    assert!(breaker.check().is_ok());
+    breaker.record(false);
+    breaker.record(true);
+    assert!(!breaker.is_open());
+}
+
+#[test]
+fn stats_latency_histogram() {
+    let stats = StatsRecorder::new();
+    assert_eq!(stats.snapshot().flush_latency.quantile(0.5), Duration::ZERO);
+    for micros in 1..=1000 {
+        stats.record_flush(10, 1, Some(Duration::from_micros(micros)));
+    }
+    stats.record_retry(true, Duration::from_millis(10));
+    stats.record_retry(false, Duration::from_millis(20));
+
+    let snapshot = stats.snapshot();
+    assert_eq!(snapshot.flushes, 1000);
+    assert_eq!(snapshot.bytes_sent, 10000);
+    assert_eq!(snapshot.rows_sent, 1000);
+    assert_eq!(snapshot.network_retries, 1);
+    assert_eq!(snapshot.server_retries, 1);
+    assert_eq!(snapshot.retry_sleep, Duration::from_millis(30));
+
+    let latency = &snapshot.flush_latency;
+    assert_eq!(latency.count(), 1000);
+    assert_eq!(latency.max(), Duration::from_micros(1000));
+    assert_eq!(latency.mean(), Duration::from_micros(500));
+    assert_eq!(latency.quantile(0.0), Duration::from_micros(1));
+    assert_eq!(latency.quantile(1.0), Duration::from_micros(1000));
+    for q in [0.5, 0.9, 0.99] {
+        let exact = q * 1000.0;
+        let reported = latency.quantile(q).as_micros() as f64;
+        assert!(reported >= exact && reported <= exact * 1.125);
+    }
+    let mut last_bound = Duration::ZERO;
+    for (bound, count) in latency.buckets() {
+        assert!(bound >= last_bound && count > 0);
+        last_bound = bound;
+    }
+    assert_eq!(latency.buckets().map(|(_, count)| count).sum::<u64>(), 1000);
+
+    // Outliers land in the last buckets rather than overflowing.
+    stats.record_flush(0, 0, Some(Duration::MAX));
+    let latency = stats.snapshot().flush_latency;
+    assert_eq!(latency.quantile(1.0), Duration::from_micros(u64::MAX));
+}
+
+#[test]
+fn stats_merge_histograms() {
+    let fast = StatsRecorder::new();
+    let slow = StatsRecorder::new();
+    for micros in 1..=10 {
+        fast.record_flush(1, 1, Some(Duration::from_micros(micros)));
+        slow.record_flush(1, 1, Some(Duration::from_micros(micros * 100)));
+    }
+    let mut latency = fast.snapshot().flush_latency;
+    latency.merge(&slow.snapshot().flush_latency);
+    assert_eq!(latency.count(), 20);
+    assert_eq!(latency.max(), Duration::from_micros(1000));
+    assert_eq!(latency.sum(), Duration::from_micros(55 + 5500));
+    assert_eq!(latency.quantile(0.5), Duration::from_micros(10));
+    assert!(latency.quantile(0.55) >= Duration::from_micros(100));
+}
+
+#[test]
+fn decimal_timestamps() {
+    let mut values = vec![
+        0,
+        1,
+        99_999_999,
+        100_000_000,
+        999_999_999_999_999,
+        1_000_000_000_000_000,
+        9_999_999_999_999_999,
+        10_000_000_000_000_000,
+        999_999_999_999_999_999,
+        1_000_000_000_000_000_000,
+        1_659_548_315_647_406_592,
+        i64::MAX,
+        -1,
+        i64::MIN,
+    ];
+    let mut x: u64 = 0x9e37_79b9_7f4a_7c15;
+    for _ in 0..10_000 {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        values.push((x >> (x % 64)) as i64);
+    }
+    let mut cache = decimal::TimestampCache::new();
+    for value in values {
+        let mut output = Vec::new();
+        decimal::write_timestamp(&mut output, value);
+        assert_eq!(output, value.to_string().as_bytes());
+
+        output.clear();
+        cache.write(&mut output, value);
+        assert_eq!(output, value.to_string().as_bytes());
+    }
+}
+
+#[test]
+fn buffer_pool() {
+    let pool = BufferPool::new(4096, 2).with_max_name_len(16);
+    assert_eq!(pool.idle(), 0);
+
+    let mut buf = pool.acquire();
+    assert_eq!(buf.max_name_len, 16);
+    buf.table("test").unwrap().column_i64("x", 1).unwrap();
+    buf.reserve(1024 * 1024);
+    pool.release(buf);
+    assert_eq!(pool.idle(), 1);
+
+    // Released buffers come back cleared and shrunk.
+    let buf = pool.acquire();
+    assert!(buf.is_empty());
+    assert_eq!(buf.row_count(), 0);
+    assert!(buf.capacity() < 1024 * 1024);
+    assert_eq!(pool.idle(), 0);
+
+    // Beyond `max_idle`, released buffers are dropped.
+    pool.release(buf);
+    pool.release(Buffer::new());
+    pool.release(Buffer::new());
+    assert_eq!(pool.idle(), 2);
+
+    // Released fixed-capacity buffers become regular pool buffers again.
+    let pool = BufferPool::new(16, 1);
+    pool.release(Buffer::with_fixed_capacity(127, 1024));
+    let buf = pool.acquire();
+    assert!(buf.fixed_capacity.is_none());
+    assert!(buf.capacity() < 1024);
+
+    // Recycled in place, they keep their capacity.
+    let mut buf = Buffer::with_fixed_capacity(127, 1024);
+    buf.table("test").unwrap().column_i64("x", 1).unwrap();
+    pool.recycle(&mut buf);
+    assert!(buf.is_empty());
+    assert_eq!(buf.fixed_capacity, Some(1024));
+    assert!(buf.capacity() >= 1024);
+}
+
+#[test]
+fn buffer_pool_resets_foreign_buffers() -> Result<()> {
+    let pool = BufferPool::new(4096, 1).with_max_name_len(16);
+
+    let mut foreign = Buffer::with_max_name_len(64);
+    foreign.set_trusted(true);
+    foreign.set_timestamp_precision(TimestampPrecision::Micros)?;
+    foreign.table("test")?.column_i64("x", 1)?.at_now()?;
+    pool.release(foreign);
+
+    // The buffer comes back with the pool's settings, checks included.
+    let mut buf = pool.acquire();
+    assert!(buf.is_empty());
+    assert!(!buf.is_trusted());
+    assert_eq!(buf.max_name_len, 16);
+    assert_eq!(buf.timestamp_precision(), TimestampPrecision::Nanos);
+    assert_eq!(buf.protocol_version, ProtocolVersion::V1);
+    let err = buf.column_i64("x", 1).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    let err = buf.table("a_table_name_longer_than_16").unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidName);
+    Ok(())
+}
+
+#[test]
+fn buffer_pool_encoding() -> Result<()> {
+    let pool = BufferPool::new(4096, 1)
+        .with_protocol_version(ProtocolVersion::V2)
+        .with_timestamp_precision(TimestampPrecision::Millis);
+    assert_eq!(pool.protocol_version(), ProtocolVersion::V2);
+    assert_eq!(pool.timestamp_precision(), TimestampPrecision::Millis);
+
+    let buf = pool.acquire();
+    assert_eq!(buf.protocol_version(), ProtocolVersion::V2);
+    assert_eq!(buf.timestamp_precision(), TimestampPrecision::Millis);
+
+    // Foreign buffers are reset to the pool's settings, not the defaults.
+    pool.release(Buffer::new());
+    let buf = pool.acquire();
+    assert_eq!(buf.protocol_version(), ProtocolVersion::V2);
+    assert_eq!(buf.timestamp_precision(), TimestampPrecision::Millis);
+    Ok(())
+}
+
+#[test]
+fn pool_size() {
+    let builder = SenderBuilder::from_conf("http::addr=localhost;").unwrap();
+    assert_defaulted_eq(&builder.pool_size, 1);
+
+    let builder = SenderBuilder::from_conf("http::addr=localhost;pool_size=8;").unwrap();
+    assert_specified_eq(&builder.pool_size, 8);
+
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;pool_size=0;"),
+        "\"pool_size\" must be greater than 0.",
+    );
+}
+
+#[test]
+fn rate_limits() {
+    let builder = SenderBuilder::from_conf("tcp::addr=localhost;").unwrap();
+    assert_defaulted_eq(&builder.max_send_rate, None);
+    assert_defaulted_eq(&builder.max_rows_rate, None);
+    assert!(builder.with_shared_rate_limiter().rate_limiter.is_none());
+
+    let builder =
+        SenderBuilder::from_conf("tcp::addr=localhost;max_send_rate=1048576;max_rows_rate=off;")
+            .unwrap();
+    assert_specified_eq(&builder.max_send_rate, Some(1048576));
+    assert_specified_eq(&builder.max_rows_rate, None);
+    assert!(builder.with_shared_rate_limiter().rate_limiter.is_some());
+
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;max_send_rate=0;"),
+        "\"max_send_rate\" must be greater than 0.",
+    );
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;max_rows_rate=0;"),
+        "\"max_rows_rate\" must be greater than 0.",
+    );
+}
+
+#[test]
+fn rate_limiter_try_acquire() {
+    let limiter = RateLimiter::new(Some(4096), None).unwrap();
+    assert_eq!(limiter.try_acquire_delay(), Duration::ZERO);
+    assert_eq!(limiter.try_acquire_bytes(10_000), 4096);
+
+    // Emptied, the bucket needs to refill a paced slice.
+    let delay = limiter.try_acquire_delay();
+    assert!(delay > Duration::from_millis(200), "{:?}", delay);
+    assert!(delay <= Duration::from_millis(250), "{:?}", delay);
+
+    // Bytes the socket didn't accept can be taken again straight away.
+    limiter.refund_bytes(4096);
+    assert_eq!(limiter.try_acquire_delay(), Duration::ZERO);
+    assert_eq!(limiter.try_acquire_bytes(4096), 4096);
+}
+
+#[test]
+fn reconnect_policy() {
+    let builder = SenderBuilder::from_conf("tcp::addr=localhost;").unwrap();
+    assert_defaulted_eq(&builder.reconnect_timeout, None);
+    assert_defaulted_eq(&builder.replay_buffers, 0);
+
+    let builder =
+        SenderBuilder::from_conf("tcps::addr=localhost;reconnect_timeout=2500;replay_buffers=4;")
+            .unwrap();
+    assert_specified_eq(
+        &builder.reconnect_timeout,
+        Some(Duration::from_millis(2500)),
+    );
+    assert_specified_eq(&builder.replay_buffers, 4);
+
+    let builder = SenderBuilder::from_conf("tcp::addr=localhost;reconnect_timeout=off;").unwrap();
+    assert_specified_eq(&builder.reconnect_timeout, None);
+
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;reconnect_timeout=1000;"),
+        "The \"reconnect_timeout\" setting can only be used with the TCP protocol.",
+    );
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;replay_buffers=2;"),
+        "The \"replay_buffers\" setting can only be used with the TCP protocol.",
+    );
+}
+
+#[test]
+fn timestamp_precision() {
+    let builder = SenderBuilder::from_conf("http::addr=localhost;").unwrap();
+    assert_defaulted_eq(&builder.timestamp_precision, TimestampPrecision::Nanos);
+
+    for (val, precision) in [
+        ("n", TimestampPrecision::Nanos),
+        ("us", TimestampPrecision::Micros),
+        ("ms", TimestampPrecision::Millis),
+        ("s", TimestampPrecision::Seconds),
+    ] {
+        let conf = format!("tcp::addr=localhost;timestamp_precision={val};");
+        let builder = SenderBuilder::from_conf(conf).unwrap();
+        assert_specified_eq(&builder.timestamp_precision, precision);
+        assert_eq!(precision.to_string(), val);
+    }
+
+    assert_conf_err(
+        SenderBuilder::from_conf("http::addr=localhost;timestamp_precision=u;"),
+        r##"Config parameter "timestamp_precision" must be one of "n", "us", "ms" or "s"."##,
+    );
+}
+
+#[test]
+fn io_backend() {
+    let builder = SenderBuilder::from_conf("tcp::addr=localhost;").unwrap();
+    assert_defaulted_eq(&builder.io_backend, IoBackend::Std);
+    assert_defaulted_eq(&builder.uring_sqpoll, false);
+    assert_defaulted_eq(&builder.uring_sqpoll_cpu, None);
+    assert_defaulted_eq(&builder.uring_zc_threshold, Some(65536));
+
+    let builder = SenderBuilder::from_conf(
+        "tcp::addr=localhost;uring_sqpoll=on;uring_sqpoll_cpu=3;uring_zc_threshold=off;",
+    )
+    .unwrap();
+    assert_specified_eq(&builder.uring_sqpoll, true);
+    assert_specified_eq(&builder.uring_sqpoll_cpu, Some(3));
+    assert_specified_eq(&builder.uring_zc_threshold, None);
+
+    let uring = SenderBuilder::from_conf("tcp::addr=localhost;io_backend=uring;");
+    if cfg!(all(feature = "io-uring", target_os = "linux")) {
+        assert_specified_eq(&uring.unwrap().io_backend, IoBackend::Uring);
+    } else {
+        assert_conf_err(
+            uring,
+            "The io_uring backend requires Linux and the \"io-uring\" feature.",
+        );
+    }
+
+    assert_conf_err(
+        SenderBuilder::from_conf("tcp::addr=localhost;io_backend=epoll;"),
+        "Invalid value \"epoll\" for \"io_backend\"",
+    );
     assert_conf_err(
-        SenderBuilder::from_conf("tcps::addr=localhost;auto_flush=on;"),
-        "Invalid auto_flush value 'on'. This client does not support \
-            auto-flush, so the only accepted value is 'off'",
+        SenderBuilder::from_conf("http::addr=localhost;io_backend=std;"),
+        "The \"io_backend\" setting can only be used with the TCP protocol.",
     );
 }
 
 #[test]
-fn auto_flush_rows_unsupported() {
+fn failover_addrs() {
+    let builder = SenderBuilder::from_conf("http::addr=db1:9001, [::1]:9002,db3,fe80::1;").unwrap();
+    assert_specified_eq(&builder.host, "db1");
+    assert_specified_eq(&builder.port, "9001");
+    assert_eq!(
+        builder.hosts().collect::<Vec<_>>(),
+        vec![
+            ("db1", "9001"),
+            ("::1", "9002"),
+            ("db3", "9000"),
+            ("fe80::1", "9000")
+        ]
+    );
+
+    let builder = SenderBuilder::from_conf("tcp::addr=[::1];").unwrap();
+    assert_eq!(builder.hosts().collect::<Vec<_>>(), vec![("::1", "9009")]);
+
+    for addr in ["db1:9000,", "[::1", "[::1]9000", ":9000"] {
+        assert_conf_err(
+            SenderBuilder::from_conf(format!("http::addr={addr};")),
+            &format!(
+                "Invalid address {:?}: Expected \"host:port\" or \"[ipv6]:port\".",
+                addr.split(',').last().unwrap()
+            ),
+        );
+    }
+}
+
+#[test]
+fn sharded_conf() {
+    let (builders, by) = ShardedSender::builders_from_conf(
+        "http::shards=db1:9001|db1b:9001, db2;username=a;password=x;;y;",
+    )
+    .unwrap();
+    assert_eq!(by, ShardBy::Table);
+    assert_eq!(builders.len(), 2);
+    assert_eq!(
+        builders[0].hosts().collect::<Vec<_>>(),
+        vec![("db1", "9001"), ("db1b", "9001")]
+    );
+    assert_eq!(
+        builders[1].hosts().collect::<Vec<_>>(),
+        vec![("db2", "9000")]
+    );
+    for builder in &builders {
+        assert_specified_eq(&builder.username, Some("a".to_string()));
+        assert_specified_eq(&builder.password, Some("x;y".to_string()));
+    }
+
+    let (builders, by) = ShardedSender::builders_from_conf(
+        "tcp::shards=db1,db2,db3;shard_by=symbol;shard_key=device;",
+    )
+    .unwrap();
+    assert_eq!(by, ShardBy::Symbol("device".to_string()));
+    assert_eq!(builders.len(), 3);
+
+    assert_conf_err(
+        ShardedSender::builders_from_conf("http::addr=db1;"),
+        "\"addr\" can't be used with a sharded sender: List the addresses in \"shards\" instead.",
+    );
+    assert_conf_err(
+        ShardedSender::builders_from_conf("http::shard_by=table;"),
+        "Missing \"shards\" parameter in config string",
+    );
+    assert_conf_err(
+        ShardedSender::builders_from_conf("http::shards=db1;shard_by=symbol;"),
+        "Missing \"shard_key\" parameter, required by \"shard_by=symbol\".",
+    );
+    assert_conf_err(
+        ShardedSender::builders_from_conf("http::shards=db1;shard_key=device;"),
+        "\"shard_key\" can only be used with \"shard_by=symbol\".",
+    );
     assert_conf_err(
-        SenderBuilder::from_conf("tcps::addr=localhost;auto_flush_rows=100;"),
-        "Invalid configuration parameter \"auto_flush_rows\". This client does not support auto-flush",
+        ShardedSender::builders_from_conf("http::shards=db1;shard_by=hash;"),
+        r##"Config parameter "shard_by" must be either "table" or "symbol"."##,
     );
 }
 
 #[test]
-fn auto_flush_bytes_unsupported() {
+fn protocol_version() {
+    let builder = SenderBuilder::from_conf("http::addr=localhost;").unwrap();
+    assert_defaulted_eq(&builder.protocol_version, Some(ProtocolVersion::V1));
+
+    let builder = SenderBuilder::from_conf("http::addr=localhost;protocol_version=2;").unwrap();
+    assert_specified_eq(&builder.protocol_version, Some(ProtocolVersion::V2));
+
+    let builder = SenderBuilder::from_conf("http::addr=localhost;protocol_version=auto;").unwrap();
+    assert_specified_eq(&builder.protocol_version, None);
+
     assert_conf_err(
-        SenderBuilder::from_conf("tcps::addr=localhost;auto_flush_bytes=100;"),
-        "Invalid configuration parameter \"auto_flush_bytes\". This client does not support auto-flush",
+        SenderBuilder::from_conf("http::addr=localhost;protocol_version=3;"),
+        r##"Config parameter "protocol_version" must be either "1", "2" or "auto"."##,
+    );
+}
+
+#[cfg(feature = "ilp-over-http")]
+#[test]
+fn protocol_versions_from_settings() {
+    let parse = |json: &str| parse_protocol_versions(&serde_json::from_str(json).unwrap());
+    assert_eq!(
+        parse(r#"{"config":{"line.proto.support.versions":[1,2]}}"#),
+        ProtocolVersion::V2
+    );
+    assert_eq!(
+        parse(r#"{"line.proto.support.versions":[1,2]}"#),
+        ProtocolVersion::V2
+    );
+    assert_eq!(
+        parse(r#"{"config":{"line.proto.support.versions":[1]}}"#),
+        ProtocolVersion::V1
+    );
+    assert_eq!(parse(r#"{"release.version":"7.3.9"}"#), ProtocolVersion::V1);
+}
+
+#[test]
+fn buffer_protocol_version() -> Result<()> {
+    let mut buffer = Buffer::new();
+    assert_eq!(buffer.protocol_version(), ProtocolVersion::V1);
+    buffer.set_protocol_version(ProtocolVersion::V2)?;
+    buffer.table("t")?.column_f64("x", 1.5)?.at_now()?;
+    let mut expected = b"t x==".to_vec();
+    expected.push(16);
+    expected.extend_from_slice(&1.5f64.to_le_bytes());
+    expected.push(b'\n');
+    assert_eq!(buffer.as_bytes(), &expected[..]);
+
+    let err = buffer
+        .set_protocol_version(ProtocolVersion::V1)
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    Ok(())
+}
+
+#[test]
+fn buffer_chunk_ends() -> Result<()> {
+    let mut buffer = Buffer::new();
+    buffer.table("t")?.symbol("a", "1")?.at_now()?; // 8 bytes
+    buffer.table("t")?.symbol("a", "22")?.at_now()?; // 9 bytes
+    buffer.set_marker()?;
+    buffer.table("t")?.symbol("a", "333")?.at_now()?;
+    buffer.rewind_to_marker()?;
+    buffer.table("t")?.symbol("a", "4444")?.at_now()?; // 11 bytes
+    assert_eq!(buffer.row_ends, [8, 17, 28]);
+
+    assert_eq!(buffer.chunk_end(0, 17)?, 17);
+    assert_eq!(buffer.chunk_end(0, 16)?, 8);
+    assert_eq!(buffer.chunk_end(8, 100)?, 28);
+    assert_eq!(buffer.chunk_end(17, 11)?, 28);
+    let err = buffer.chunk_end(17, 10).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(
+        err.msg(),
+        "Could not flush buffer: Row size of 11 exceeds maximum configured allowed size of 10 bytes."
+    );
+
+    buffer.clear();
+    assert!(buffer.row_ends.is_empty());
+    Ok(())
+}
+
+#[test]
+fn buffer_chunk_ends_resume() -> Result<()> {
+    let mut buffer = Buffer::new();
+    for i in 0..100 {
+        buffer.table("test")?.column_i64("i", i)?.at_now()?;
+    }
+
+    // Walk the buffer as `flush_chunked` does, from the start and resuming
+    // from each row boundary, as after a failed request.
+    let max_len = 256;
+    let mut starts = vec![0];
+    starts.extend_from_slice(&buffer.row_ends[..buffer.row_ends.len() - 1]);
+    for start in starts {
+        let mut offset = start;
+        let mut chunks = 0;
+        while offset < buffer.len() {
+            let end = buffer.chunk_end(offset, max_len)?;
+            assert!(end > offset && end - offset <= max_len);
+            assert!(buffer.row_ends.contains(&end));
+            if end < buffer.len() {
+                // The chunk can't take the next row too.
+                let next = buffer.row_ends.partition_point(|&row_end| row_end <= end);
+                assert!(buffer.row_ends[next] - offset > max_len);
+            }
+            offset = end;
+            chunks += 1;
+        }
+        assert_eq!(offset, buffer.len());
+        let expected = (buffer.len() - start).div_ceil(max_len);
+        assert!(chunks >= expected);
+    }
+    assert!(buffer.len() > 3 * max_len);
+    Ok(())
+}
+
+#[test]
+fn buffer_drop_rows() -> Result<()> {
+    let mut buffer = Buffer::new();
+    buffer.table("a")?.symbol("s", "1")?.at_now()?;
+    buffer.table("b c")?.symbol("s", "2")?.at_now()?;
+    buffer.table("a")?.symbol("s", "3")?.at_now()?;
+    assert_eq!(buffer.row_offset(0), Some(0));
+    assert_eq!(buffer.row_offset(1), Some(6));
+    assert_eq!(buffer.row_offset(3), Some(buffer.len()));
+    assert_eq!(buffer.row_offset(4), None);
+    assert!(!buffer.transactional());
+
+    // Dropping the only row for table `b c` makes the buffer transactional.
+    buffer.drop_rows(1..2)?;
+    assert_eq!(buffer.as_str(), "a,s=1\na,s=3\n");
+    assert_eq!(buffer.row_count(), 2);
+    assert_eq!(buffer.row_offset(2), Some(buffer.len()));
+    assert!(buffer.transactional());
+
+    let err = buffer.drop_rows(1..3).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(
+        err.msg(),
+        "Bad call to `drop_rows`: Rows 1..3 are out of range for a buffer of 2 rows."
+    );
+
+    buffer.table("c")?;
+    let err = buffer.drop_rows(0..1).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    buffer.symbol("s", "4")?.at_now()?;
+    assert!(!buffer.transactional());
+
+    // The first row changes: The table names are tracked anew.
+    buffer.drop_rows(0..2)?;
+    assert_eq!(buffer.as_str(), "c,s=4\n");
+    assert!(buffer.transactional());
+    buffer.table("c")?.symbol("s", "5")?.at_now()?;
+    assert!(buffer.transactional());
+
+    buffer.drop_rows(0..2)?;
+    assert!(buffer.is_empty());
+    buffer.table("d")?.symbol("s", "6")?.at_now()?;
+    assert_eq!(buffer.as_str(), "d,s=6\n");
+    Ok(())
+}
+
+#[test]
+fn buffer_split_at_row() -> Result<()> {
+    let mut buffer = Buffer::with_fixed_capacity(127, 1024);
+    buffer.set_protocol_version(ProtocolVersion::V2)?;
+    buffer.table("a")?.symbol("s", "1")?.at_now()?;
+    buffer.table("b")?.symbol("s", "2")?.at_now()?;
+    buffer.table("b")?.symbol("s", "3")?.at_now()?;
+
+    let mut tail = buffer.split_at_row(1)?;
+    assert_eq!(buffer.as_str(), "a,s=1\n");
+    assert_eq!(tail.as_str(), "b,s=2\nb,s=3\n");
+    assert_eq!(tail.row_count(), 2);
+    assert_eq!(tail.row_offset(1), Some(6));
+    assert!(tail.transactional());
+    assert_eq!(tail.fixed_capacity(), Some(1024));
+    assert_eq!(tail.protocol_version(), ProtocolVersion::V2);
+    tail.table("a")?.symbol("s", "4")?.at_now()?;
+    assert!(!tail.transactional());
+
+    let empty = buffer.split_at_row(1)?;
+    assert!(empty.is_empty());
+    assert!(buffer.split_at_row(2).is_err());
+    Ok(())
+}
+
+#[test]
+fn buffer_trusted() -> Result<()> {
+    let mut trusted = Buffer::new_trusted();
+    assert!(trusted.is_trusted());
+    let mut checked = Buffer::new();
+    assert!(!checked.is_trusted());
+    for buffer in [&mut trusted, &mut checked] {
+        buffer
+            .table(TableName::new_unchecked("trades"))?
+            .symbol(ColumnName::new_unchecked("sym"), "ETH-USD")?
+            .column_f64(ColumnName::new_unchecked("price"), 2615.54)?
+            .column_i64("qty", 3)?
+            .at(TimestampNanos::new(10))?;
+    }
+    assert_eq!(trusted.as_bytes(), checked.as_bytes());
+    assert_eq!(trusted.row_count(), 1);
+
+    assert!(trusted.clone().is_trusted());
+    trusted.table("trades")?.column_bool("b", true)?.at_now()?;
+    assert!(trusted.split_at_row(1)?.is_trusted());
+
+    // Names are still checked for bad characters.
+    assert_eq!(
+        trusted.table("bad\nname").unwrap_err().code(),
+        ErrorCode::InvalidName
+    );
+
+    trusted.set_trusted(false);
+    assert!(!trusted.is_trusted());
+    let err = trusted.symbol("sym", "v").unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    Ok(())
+}
+
+#[test]
+#[cfg(debug_assertions)]
+#[should_panic(expected = "State error in trusted buffer")]
+fn buffer_trusted_asserts_call_order() {
+    let mut buffer = Buffer::new_trusted();
+    let _ = buffer.column_i64("qty", 3);
+}
+
+#[test]
+#[cfg(debug_assertions)]
+#[should_panic(expected = "Bad name in trusted buffer")]
+fn buffer_trusted_asserts_name_len() {
+    let mut buffer = Buffer::with_max_name_len(4);
+    buffer.set_trusted(true);
+    let _ = buffer.table("trades");
+}
+
+#[test]
+fn buffer_trusted_checks_row_boundary() -> Result<()> {
+    // Not only a debug assertion: Checked in release builds too.
+    let mut buffer = Buffer::new_trusted();
+    buffer.table("trades")?.column_i64("qty", 3)?;
+    let err = buffer.check_op(Op::Flush).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    buffer.at_now()?;
+    buffer.check_op(Op::Flush)?;
+
+    // Rewinding finds the incomplete row of a trusted segment.
+    let mut multi = MultiTableBuffer::new();
+    multi.table("a")?.symbol("s", "1")?.at_now()?;
+    let segment = multi.table("a")?;
+    segment.set_trusted(true);
+    segment.symbol("s", "2")?;
+    multi.rewind_row();
+    assert_eq!(multi.get("a").unwrap().as_str(), "a,s=1\n");
+    Ok(())
+}
+
+#[test]
+fn multi_table_buffer() -> Result<()> {
+    let mut buffer = MultiTableBuffer::new();
+    buffer.set_protocol_version(ProtocolVersion::V2)?;
+    buffer.table("a")?.symbol("s", "1")?.at_now()?;
+    buffer.table("b")?.symbol("s", "2")?.at_now()?;
+    buffer.table("a")?.symbol("s", "3")?.at_now()?;
+    assert_eq!(buffer.row_count(), 3);
+    assert_eq!(buffer.table_count(), 2);
+    let a = buffer.get("a").unwrap();
+    assert_eq!(a.as_str(), "a,s=1\na,s=3\n");
+    assert!(a.transactional());
+    assert_eq!(a.protocol_version(), ProtocolVersion::V2);
+    let tables: Vec<&str> = buffer.segments().map(|(table, _)| table).collect();
+    assert_eq!(tables, ["a", "b"]);
+    assert!(buffer.set_protocol_version(ProtocolVersion::V1).is_err());
+
+    // Only one row may be under construction, whichever its table.
+    buffer.table("b")?.symbol("s", "4")?;
+    let err = buffer.table("a").unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert!(buffer.check_complete().is_err());
+    buffer.rewind_row();
+    assert_eq!(buffer.get("b").unwrap().as_str(), "b,s=2\n");
+    buffer.rewind_row();
+    assert_eq!(buffer.row_count(), 3);
+    buffer.check_complete()?;
+
+    assert!(buffer.table("c.").is_err());
+    assert!(buffer.get("c.").is_none());
+
+    buffer.clear();
+    assert!(buffer.is_empty());
+    assert_eq!(buffer.table_count(), 0);
+    assert_eq!(buffer.segments().count(), 2);
+    Ok(())
+}
+
+#[test]
+fn buffer_append_buffer() -> Result<()> {
+    let mut buffer = Buffer::new();
+    let mut other = Buffer::new();
+    other.table("a")?.symbol("s", "1")?.at_now()?;
+    other.table("a")?.symbol("s", "2")?.at_now()?;
+    buffer.append_buffer(&other)?;
+    assert_eq!(buffer.as_str(), "a,s=1\na,s=2\n");
+    assert_eq!(buffer.row_count(), 2);
+    assert!(buffer.transactional());
+
+    buffer.append_buffer(&other)?;
+    assert_eq!(buffer.row_count(), 4);
+    assert_eq!(buffer.row_offset(3), Some(18));
+    assert!(buffer.transactional());
+    buffer.table("a")?.symbol("s", "3")?.at_now()?;
+
+    other.clear();
+    other.table("b")?.symbol("s", "4")?.at_now()?;
+    buffer.append_buffer(&other)?;
+    assert_eq!(buffer.row_count(), 6);
+    assert!(!buffer.transactional());
+    assert_eq!(other.row_count(), 1);
+
+    other.table("b")?;
+    let err = buffer.append_buffer(&other).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(
+        err.msg(),
+        "Bad call to `append_buffer`: The appended buffer has an incomplete row."
+    );
+    assert_eq!(buffer.row_count(), 6);
+
+    let mut v2 = Buffer::new();
+    v2.set_protocol_version(ProtocolVersion::V2)?;
+    v2.table("a")?.symbol("s", "5")?.at_now()?;
+    let err = buffer.append_buffer(&v2).unwrap_err();
+    assert_eq!(
+        err.msg(),
+        "Bad call to `append_buffer`: Can't append a buffer of protocol version 2 to one of version 1."
+    );
+
+    let mut fixed = Buffer::with_fixed_capacity(127, 8);
+    let err = fixed.append_buffer(&buffer).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::BufferFull);
+    assert!(fixed.is_empty());
+    Ok(())
+}
+
+#[test]
+fn buffer_append_raw_ilp() -> Result<()> {
+    let mut buffer = Buffer::new();
+    buffer.table("a")?.symbol("s", "1")?.at_now()?;
+    buffer.append_raw_ilp(b"a,s=2 x=\"y\\\nz\"\na s=\"3\"\n", true)?;
+    assert_eq!(buffer.row_count(), 3);
+    assert_eq!(buffer.row_offset(1), Some(6));
+    assert_eq!(buffer.row_offset(2), Some(21));
+    assert!(buffer.transactional());
+
+    buffer.append_raw_ilp(b"b x=1i 10\n", false)?;
+    assert_eq!(buffer.row_count(), 4);
+    assert!(!buffer.transactional());
+    buffer.table("c")?.symbol("s", "4")?.at_now()?;
+    assert_eq!(buffer.row_count(), 5);
+
+    let len = buffer.len();
+    for (bytes, msg) in [
+        (
+            &b"a x=1i\na x=2i"[..],
+            "Bad call to `append_raw_ilp`: The row at byte offset 7 is not terminated by a newline.",
+        ),
+        (
+            &b"a x=\"\n"[..],
+            "Bad call to `append_raw_ilp`: The row at byte offset 0 is not terminated by a newline.",
+        ),
+        (
+            &b"a x=1i\na x=\"\xff\"\n"[..],
+            "Bad call to `append_raw_ilp`: The row at byte offset 7 is not valid UTF-8.",
+        ),
+        (
+            &b" x=1i\n"[..],
+            "Bad call to `append_raw_ilp`: The row at byte offset 0 has no table name.",
+        ),
+    ] {
+        let err = buffer.append_raw_ilp(bytes, true).unwrap_err();
+        assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+        assert_eq!(err.msg(), msg);
+        assert_eq!(buffer.len(), len);
+        assert_eq!(buffer.row_count(), 5);
+    }
+
+    let mut v2 = Buffer::new();
+    v2.set_protocol_version(ProtocolVersion::V2)?;
+    v2.table("f")?
+        .column_f64("x", f64::from_bits(0x0a0a_0a0a_0a0a_0a0a))?
+        .at_now()?;
+    let mut raw = Buffer::new();
+    raw.set_protocol_version(ProtocolVersion::V2)?;
+    raw.append_raw_ilp(v2.as_bytes(), true)?;
+    assert_eq!(raw.row_count(), 1);
+    assert_eq!(raw.as_bytes(), v2.as_bytes());
+
+    buffer.table("d")?;
+    let err = buffer.append_raw_ilp(b"a x=1i\n", true).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+
+    let mut fixed = Buffer::with_fixed_capacity(127, 4);
+    let err = fixed.append_raw_ilp(b"a x=1i\n", true).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::BufferFull);
+    Ok(())
+}
+
+#[test]
+fn find_escape_matches_scalar() {
+    for needles in [escape::UNQUOTED, escape::QUOTED] {
+        for len in 0..100 {
+            let clean = vec![b'a'; len];
+            assert_eq!(escape::find_escape(needles, &clean), None);
+            for pos in 0..len {
+                for &needle in needles {
+                    let mut dirty = clean.clone();
+                    dirty[pos] = needle;
+                    if pos + 7 < len {
+                        dirty[pos + 7] = needle;
+                    }
+                    assert_eq!(
+                        escape::find_escape(needles, &dirty),
+                        escape::find_scalar(needles, &dirty)
+                    );
+                    assert_eq!(escape::find_escape(needles, &dirty), Some(pos));
+                }
+            }
+        }
+    }
+}
+
+#[test]
+fn write_escaped() {
+    let long = "a".repeat(40);
+    let mut output = Vec::new();
+    write_escaped_unquoted(&mut output, &format!("{long} b,c=d\\e\n{long}é"));
+    assert_eq!(
+        output,
+        format!("{long}\\ b\\,c\\=d\\\\e\\\n{long}é").as_bytes()
+    );
+
+    output.clear();
+    write_escaped_quoted(&mut output, &format!("{long}\"x, y\"\r{long}"));
+    assert_eq!(
+        output,
+        format!("\"{long}\\\"x, y\\\"\\\r{long}\"").as_bytes()
     );
 }
 
@@ -502,3 +1641,80 @@ fn assert_conf_err<T, M: AsRef<str>>(result: Result<T>, expect_msg: M) {
     assert_eq!(err.code(), ErrorCode::ConfigError);
     assert_eq!(err.msg(), expect_msg.as_ref());
 }
+
+#[test]
+fn interleave_address_families() {
+    let v4 = |n: u8| std::net::SocketAddr::from(([10, 0, 0, n], 9000));
+    let v6 = |n: u16| std::net::SocketAddr::from(([0xfd00, 0, 0, 0, 0, 0, 0, n], 9000));
+    assert_eq!(
+        gai::interleave_families(vec![v6(1), v6(2), v6(3), v4(1)]),
+        vec![v6(1), v4(1), v6(2), v6(3)]
+    );
+    assert_eq!(
+        gai::interleave_families(vec![v4(1), v4(2), v6(1), v6(2)]),
+        vec![v4(1), v6(1), v4(2), v6(2)]
+    );
+    assert_eq!(gai::interleave_families(vec![]), vec![]);
+}
+
+#[test]
+fn resolve_ip_literals() -> Result<()> {
+    let addrs = gai::resolve_host_port("127.0.0.1", "9009")?;
+    assert_eq!(
+        addrs,
+        vec![std::net::SocketAddr::from(([127, 0, 0, 1], 9009))]
+    );
+    let addrs = gai::resolve_host_port("::1", "9009")?;
+    assert_eq!(addrs, vec!["[::1]:9009".parse().unwrap()]);
+    Ok(())
+}
+
+#[test]
+fn fast_clock() {
+    let now = TimestampNanos::now().as_i64();
+    for source in [
+        ClockSource::System,
+        ClockSource::Coarse,
+        ClockSource::Calibrated,
+        ClockSource::Batch,
+    ] {
+        let clock = FastClock::new(source);
+        assert_eq!(clock.source(), source);
+        let delta = clock.now().as_i64() - now;
+        assert!(delta.abs() < 1_000_000_000, "{source:?} is {delta}ns off");
+    }
+
+    let mut clock = FastClock::new(ClockSource::Batch);
+    let first = clock.now().as_i64();
+    assert_eq!(clock.now().as_i64(), first);
+    clock.set_strictly_increasing(true);
+    assert_eq!(clock.now().as_i64(), first);
+    assert_eq!(clock.now().as_i64(), first + 1);
+    std::thread::sleep(Duration::from_millis(1));
+    clock.tick();
+    assert!(clock.now().as_i64() > first + 1);
+
+    let mut clock = FastClock::new(ClockSource::Calibrated);
+    clock.set_resync_interval(Duration::ZERO);
+    clock.set_strictly_increasing(true);
+    let mut last = clock.now().as_i64();
+    for _ in 0..100 {
+        let now = clock.now().as_i64();
+        assert!(now > last);
+        last = now;
+    }
+
+    let clock = FastClock::new(ClockSource::Batch);
+    let mut buffer = Buffer::new();
+    buffer
+        .table("test")
+        .unwrap()
+        .column_i64("v", 1)
+        .unwrap()
+        .at_clock(&clock)
+        .unwrap();
+    assert_eq!(
+        buffer.as_bytes(),
+        format!("test v=1i {}\n", clock.now().as_i64()).as_bytes()
+    );
+}
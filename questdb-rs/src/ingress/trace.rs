@@ -0,0 +1,121 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+use std::time::{Duration, Instant};
+
+/// The stage of a flush timed by a [`FlushSpan`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum FlushSpanKind {
+    /// The whole flush call, emitted last. `bytes` is the size of the buffer.
+    Flush,
+
+    /// Writing the buffer to the ILP/TCP socket.
+    TcpWrite,
+
+    /// Encoding, and if configured compressing, the ILP/HTTP request body.
+    /// `bytes` is the size of the encoded body.
+    Encode,
+
+    /// A single ILP/HTTP request attempt. `attempt` counts from 1 and
+    /// `status_code` is `None` if the request failed with a network error.
+    HttpAttempt,
+
+    /// The ILP/HTTP request, from the first attempt to the last, retry sleeps
+    /// included. `attempt` is the number of attempts made.
+    HttpRequest,
+
+    /// Reading and parsing an ILP/HTTP error response. `error_id` is the
+    /// server's `errorId`, if it sent one.
+    ParseResponse,
+}
+
+/// A timed stage of a flush, passed to the hook registered with
+/// [`Sender::set_trace_hook`](super::Sender::set_trace_hook).
+///
+/// The spans of one flush are emitted in the order they complete, ending
+/// with [`FlushSpanKind::Flush`].
+#[derive(Debug, Clone)]
+pub struct FlushSpan<'a> {
+    /// Which stage of the flush this span times.
+    pub kind: FlushSpanKind,
+
+    /// How long the stage took.
+    pub duration: Duration,
+
+    /// Number of bytes the stage handled.
+    pub bytes: usize,
+
+    /// The ILP/HTTP request attempt, or `0` for spans outside of a request.
+    pub attempt: u32,
+
+    /// The ILP/HTTP status code, if a response was received.
+    pub status_code: Option<u16>,
+
+    /// The `errorId` of an ILP/HTTP error response, for correlating the
+    /// flush with the server logs.
+    pub error_id: Option<&'a str>,
+}
+
+impl FlushSpan<'static> {
+    pub(super) fn new(kind: FlushSpanKind, bytes: usize) -> Self {
+        Self {
+            kind,
+            duration: Duration::ZERO,
+            bytes,
+            attempt: 0,
+            status_code: None,
+            error_id: None,
+        }
+    }
+}
+
+pub(super) type TraceHook = Box<dyn FnMut(&FlushSpan) + Send>;
+
+/// Times flush stages for the trace hook, if one is registered.
+/// Without a hook, this doesn't even read the clock.
+#[derive(Default)]
+pub(super) struct Tracer {
+    hook: Option<TraceHook>,
+}
+
+impl Tracer {
+    pub(super) fn set_hook(&mut self, hook: Option<TraceHook>) {
+        self.hook = hook;
+    }
+
+    /// Mark the start of a span. Pass the result to [`Tracer::emit`].
+    pub(super) fn start(&self) -> Option<Instant> {
+        self.hook.as_ref().map(|_| Instant::now())
+    }
+
+    /// Emit a span started by [`Tracer::start`].
+    pub(super) fn emit(&mut self, start: Option<Instant>, span: FlushSpan) {
+        if let (Some(hook), Some(start)) = (self.hook.as_mut(), start) {
+            hook(&FlushSpan {
+                duration: start.elapsed(),
+                ..span
+            });
+        }
+    }
+}
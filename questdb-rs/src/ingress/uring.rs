@@ -0,0 +1,310 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+//! The io_uring backend for ILP/TCP connections, see
+//! [`SenderBuilder::io_backend`](super::SenderBuilder::io_backend).
+
+use std::io::{self, ErrorKind, IoSlice, Read, Write};
+use std::os::unix::io::AsRawFd;
+
+use io_uring::{opcode, squeue, types, IoUring, Probe};
+
+use super::Connection;
+
+/// Every write waits for its own completion, so a handful of entries is plenty.
+const RING_ENTRIES: u32 = 8;
+
+/// How long the SQPOLL kernel thread spins without work before it sleeps.
+const SQPOLL_IDLE_MILLIS: u32 = 1000;
+
+/// With SQPOLL, how many times to check for a completion before waiting for
+/// it in the kernel instead.
+const SQPOLL_SPIN_LIMIT: u32 = 4096;
+
+/// Size of the staging buffer that TLS records are sealed into before they
+/// are sent. It's registered with the ring, so large sends of it can go out
+/// as zero-copy sends from a fixed buffer.
+const STAGING_LEN: usize = 256 * 1024;
+
+/// `IORING_CQE_F_MORE`: Another completion for the same request follows.
+const CQE_F_MORE: u32 = 1 << 1;
+
+/// `IORING_CQE_F_NOTIF`: The kernel no longer references a zero-copy send's memory.
+const CQE_F_NOTIF: u32 = 1 << 3;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub(super) struct UringOptions {
+    pub(super) sqpoll: bool,
+    pub(super) sqpoll_cpu: Option<u32>,
+    pub(super) zc_threshold: Option<usize>,
+}
+
+/// A connection whose writes are submitted through an io_uring.
+///
+/// The TLS handshake and authentication happen on the plain connection
+/// before it's wrapped. Reads are rare and stay on the plain socket.
+pub(super) struct UringConnection {
+    // Declared first: The ring and its buffer registration are dropped before `staging`.
+    ring: IoUring,
+    inner: Connection,
+    staging: Box<[u8]>,
+    staging_registered: bool,
+
+    /// The smallest write sent as `SEND_ZC`, or `None` if zero-copy sends are
+    /// disabled or the kernel doesn't support them.
+    zc_threshold: Option<usize>,
+    sqpoll: bool,
+}
+
+/// Call `op` again for as long as it's interrupted by a signal.
+fn retry_interrupted<T>(mut op: impl FnMut() -> io::Result<T>) -> io::Result<T> {
+    loop {
+        match op() {
+            Err(io_err) if io_err.kind() == ErrorKind::Interrupted => {}
+            res => return res,
+        }
+    }
+}
+
+impl UringConnection {
+    pub(super) fn new(inner: Connection, options: &UringOptions) -> io::Result<Self> {
+        let mut builder = IoUring::builder();
+        if options.sqpoll {
+            builder.setup_sqpoll(SQPOLL_IDLE_MILLIS);
+            if let Some(cpu) = options.sqpoll_cpu {
+                builder.setup_sqpoll_cpu(cpu);
+            }
+        }
+        let ring = builder.build(RING_ENTRIES)?;
+
+        let mut probe = Probe::new();
+        ring.submitter().register_probe(&mut probe)?;
+        let zc_threshold = options
+            .zc_threshold
+            .filter(|_| probe.is_supported(opcode::SendZc::CODE));
+
+        let mut staging = match inner {
+            Connection::Tls(_) => vec![0u8; STAGING_LEN].into_boxed_slice(),
+            _ => Box::default(),
+        };
+
+        // Registration pins memory and counts against `RLIMIT_MEMLOCK`:
+        // If it fails, the staging buffer is sent with plain sends instead.
+        let staging_registered = !staging.is_empty() && zc_threshold.is_some() && {
+            let iovec = libc::iovec {
+                iov_base: staging.as_mut_ptr().cast(),
+                iov_len: staging.len(),
+            };
+            // SAFETY: `staging` is never reallocated and outlives the ring.
+            unsafe { ring.submitter().register_buffers(&[iovec]) }.is_ok()
+        };
+
+        Ok(Self {
+            ring,
+            inner,
+            staging,
+            staging_registered,
+            zc_threshold,
+            sqpoll: options.sqpoll,
+        })
+    }
+
+    pub(super) fn inner(&self) -> &Connection {
+        &self.inner
+    }
+
+    fn fd(&self) -> types::Fd {
+        types::Fd(self.inner.socket().as_raw_fd())
+    }
+
+    /// Wait for at least one completion.
+    fn wait(&mut self) -> io::Result<()> {
+        if self.sqpoll {
+            // The kernel thread polls the submission queue by itself, this
+            // only enters the kernel to wake it up if it went idle. A quick
+            // completion is caught by spinning, but a slow one, say whilst
+            // the socket buffer is full, is waited for in the kernel below.
+            retry_interrupted(|| self.ring.submit())?;
+            for _ in 0..SQPOLL_SPIN_LIMIT {
+                if !self.ring.completion().is_empty() {
+                    return Ok(());
+                }
+                std::hint::spin_loop();
+            }
+        }
+        // With SQPOLL, this sets `IORING_ENTER_GETEVENTS` to wait.
+        retry_interrupted(|| self.ring.submit_and_wait(1)).map(drop)
+    }
+
+    /// Submit `entry` and wait for its result.
+    ///
+    /// For a zero-copy send, this also waits for the notification that the
+    /// kernel is done with the memory, so it may be reused on return.
+    ///
+    /// # Safety
+    ///
+    /// The memory `entry` points to must be valid until this returns.
+    unsafe fn complete(&mut self, entry: &squeue::Entry, zero_copy: bool) -> io::Result<usize> {
+        self.ring
+            .submission()
+            .push(entry)
+            .map_err(|_| io::Error::new(ErrorKind::Other, "io_uring submission queue is full"))?;
+        let mut result = None;
+        let mut notif_pending = zero_copy;
+        while result.is_none() || notif_pending {
+            self.wait()?;
+            for cqe in self.ring.completion() {
+                if cqe.flags() & CQE_F_NOTIF != 0 {
+                    notif_pending = false;
+                } else {
+                    result = Some(cqe.result());
+                    if cqe.flags() & CQE_F_MORE == 0 {
+                        notif_pending = false;
+                    }
+                }
+            }
+        }
+        match result.unwrap_or_default() {
+            res if res < 0 => Err(io::Error::from_raw_os_error(-res)),
+            res => Ok(res as usize),
+        }
+    }
+
+    /// Send once from `ptr`, zero-copy if the write is large enough.
+    ///
+    /// # Safety
+    ///
+    /// `ptr` must point to `len` readable bytes. If `fixed` is set, they must
+    /// lie within the registered staging buffer.
+    unsafe fn send(&mut self, ptr: *const u8, len: usize, fixed: bool) -> io::Result<usize> {
+        let len = len.min(u32::MAX as usize) as u32;
+        let fd = self.fd();
+        if let Some(threshold) = self.zc_threshold {
+            if len as usize >= threshold {
+                let mut send_zc = opcode::SendZc::new(fd, ptr, len).flags(libc::MSG_NOSIGNAL);
+                if fixed {
+                    send_zc = send_zc.buf_index(Some(0));
+                }
+                match self.complete(&send_zc.build(), true) {
+                    Err(io_err)
+                        if matches!(
+                            io_err.raw_os_error(),
+                            Some(libc::EINVAL | libc::EOPNOTSUPP)
+                        ) =>
+                    {
+                        // The socket doesn't support zero-copy sends after all.
+                        self.zc_threshold = None;
+                    }
+                    res => return res,
+                }
+            }
+        }
+        let send = opcode::Send::new(fd, ptr, len)
+            .flags(libc::MSG_NOSIGNAL)
+            .build();
+        self.complete(&send, false)
+    }
+
+    fn send_vectored(&mut self, bufs: &[IoSlice<'_>]) -> io::Result<usize> {
+        // SAFETY: All-zero is a valid `msghdr`.
+        let mut msg: libc::msghdr = unsafe { std::mem::zeroed() };
+
+        // `IoSlice` is ABI-compatible with `iovec` on Unix.
+        msg.msg_iov = bufs.as_ptr() as *mut libc::iovec;
+        msg.msg_iovlen = bufs.len() as _;
+        let send_msg = opcode::SendMsg::new(self.fd(), &msg)
+            .flags(libc::MSG_NOSIGNAL as u32)
+            .build();
+
+        // SAFETY: `msg` and the slices it points to outlive the call.
+        unsafe { self.complete(&send_msg, false) }
+    }
+
+    /// Seal the pending TLS records into the staging buffer and send them,
+    /// until rustls has nothing left to write.
+    fn write_pending_tls(&mut self) -> io::Result<()> {
+        loop {
+            let Connection::Tls(ref mut stream) = self.inner else {
+                return Ok(());
+            };
+            let mut filled = 0;
+            while filled < self.staging.len() && stream.conn.wants_write() {
+                match stream.conn.write_tls(&mut &mut self.staging[filled..])? {
+                    0 => break,
+                    n => filled += n,
+                }
+            }
+            if filled == 0 {
+                return Ok(());
+            }
+            let mut offset = 0;
+            while offset < filled {
+                let ptr = self.staging[offset..].as_ptr();
+
+                // SAFETY: The range is within `staging`, which isn't touched until the send completes.
+                let n = unsafe { self.send(ptr, filled - offset, self.staging_registered) }?;
+                if n == 0 {
+                    return Err(io::Error::from(ErrorKind::WriteZero));
+                }
+                offset += n;
+            }
+        }
+    }
+}
+
+impl Read for UringConnection {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        self.inner.read(buf)
+    }
+}
+
+impl Write for UringConnection {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        match self.inner {
+            Connection::Tls(ref mut stream) => {
+                let n = stream.conn.writer().write(buf)?;
+                self.write_pending_tls()?;
+                Ok(n)
+            }
+            // SAFETY: `buf` is borrowed for the whole call.
+            _ => unsafe { self.send(buf.as_ptr(), buf.len(), false) },
+        }
+    }
+
+    fn write_vectored(&mut self, bufs: &[IoSlice<'_>]) -> io::Result<usize> {
+        match self.inner {
+            Connection::Tls(ref mut stream) => {
+                // Encrypt all the slices into TLS records in one go.
+                let n = stream.conn.writer().write_vectored(bufs)?;
+                self.write_pending_tls()?;
+                Ok(n)
+            }
+            _ => self.send_vectored(bufs),
+        }
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        self.write_pending_tls()
+    }
+}
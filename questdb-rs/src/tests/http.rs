@@ -22,11 +22,15 @@
  *
  ******************************************************************************/
 
-use crate::ingress::{Buffer, Protocol, SenderBuilder, TimestampNanos};
+use crate::ingress::{
+    Buffer, FlushSpanKind, MultiTableBuffer, Protocol, ProtocolVersion, SenderBuilder,
+    TimestampNanos, TimestampPrecision,
+};
 use crate::tests::mock::{certs_dir, HttpResponse, MockServer};
 use crate::ErrorCode;
 use std::io;
 use std::io::ErrorKind;
+use std::sync::{Arc, Mutex};
 use std::time::Duration;
 
 use crate::tests::TestResult;
@@ -77,6 +81,562 @@ fn test_two_lines() -> TestResult {
     Ok(())
 }
 
+#[test]
+fn test_timestamp_precision() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_http()
+        .timestamp_precision(TimestampPrecision::Seconds)?
+        .build()?;
+    assert_eq!(sender.timestamp_precision(), TimestampPrecision::Seconds);
+
+    let mut buffer = sender.new_buffer();
+    buffer
+        .table("test")?
+        .symbol("t1", "v1")?
+        .at(TimestampNanos::new(1_700_000_000_999_999_999))?;
+    assert_eq!(buffer.as_str(), "test,t1=v1 1700000000\n");
+
+    let server_thread = std::thread::spawn(move || -> io::Result<()> {
+        server.accept()?;
+        let req = server.recv_http_q()?;
+        assert_eq!(req.path(), "/write?precision=s");
+        assert_eq!(req.body_str().unwrap(), "test,t1=v1 1700000000\n");
+        server.send_http_response_q(HttpResponse::empty())?;
+        Ok(())
+    });
+    let res = sender.flush(&mut buffer);
+    server_thread.join().unwrap()?;
+    res?;
+
+    // A buffer of another precision is refused before anything is sent.
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    let err = sender.flush(&mut buffer).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(buffer.row_count(), 1);
+    Ok(())
+}
+
+#[test]
+fn test_failover() -> TestResult {
+    // Nothing listens on the port of a closed listener.
+    let closed_port = std::net::TcpListener::bind("127.0.0.1:0")?
+        .local_addr()?
+        .port();
+    let mut server = MockServer::new()?;
+    let mut sender = SenderBuilder::new(Protocol::Http, "127.0.0.1", closed_port)
+        .failover_addr(server.host, server.port)?
+        .build()?;
+
+    let server_thread = std::thread::spawn(move || -> io::Result<()> {
+        server.accept()?;
+        for _ in 0..2 {
+            let req = server.recv_http_q()?;
+            assert_eq!(req.path(), "/write?precision=n");
+            server.send_http_response_q(HttpResponse::empty())?;
+        }
+        Ok(())
+    });
+
+    // The first flush fails over, and the second starts from the host that
+    // responded.
+    for _ in 0..2 {
+        let mut buffer = Buffer::new();
+        buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+        sender.flush(&mut buffer)?;
+    }
+    server_thread.join().unwrap()?;
+    assert_eq!(sender.stats().network_retries, 1);
+    Ok(())
+}
+
+#[test]
+fn test_protocol_version_auto() -> TestResult {
+    let mut server = MockServer::new()?;
+    let builder = server.lsb_http().protocol_version(None)?;
+
+    let server_thread = std::thread::spawn(move || -> io::Result<Vec<u8>> {
+        server.accept()?;
+
+        let req = server.recv_http_q()?;
+        assert_eq!(req.method(), "GET");
+        assert_eq!(req.path(), "/settings");
+        server.send_http_response_q(HttpResponse::empty().with_body_json(
+            &serde_json::json!({"config": {"line.proto.support.versions": [1, 2]}}),
+        ))?;
+
+        let req = server.recv_http_q()?;
+        assert_eq!(req.method(), "POST");
+        server.send_http_response_q(HttpResponse::empty())?;
+        Ok(req.body().to_vec())
+    });
+
+    let mut sender = builder.build()?;
+    assert_eq!(sender.protocol_version(), ProtocolVersion::V2);
+    let mut buffer = sender.new_buffer();
+    buffer.table("test")?.column_f64("x", 1.0)?.at_now()?;
+    let expected = buffer.as_bytes().to_vec();
+    let res = sender.flush(&mut buffer);
+
+    let body = server_thread.join().unwrap()?;
+    res?;
+    assert_eq!(body, expected);
+    assert_eq!(&body[..8], b"test x==");
+    Ok(())
+}
+
+#[test]
+fn test_drop_failed_row() -> TestResult {
+    let mut buffer = Buffer::new();
+    for i in 0..3 {
+        buffer.table("test")?.column_i64("i", i)?.at_now()?;
+    }
+
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_http().build()?;
+    let server_thread = std::thread::spawn(move || -> io::Result<String> {
+        server.accept()?;
+        server.recv_http_q()?;
+        server.send_http_response_q(
+            HttpResponse::empty()
+                .with_status(400, "Bad Request")
+                .with_body_json(&serde_json::json!({
+                    "code": "invalid",
+                    "message": "bad row",
+                    "line": 2,
+                })),
+        )?;
+        let req = server.recv_http_q()?;
+        server.send_http_response_q(HttpResponse::empty())?;
+        Ok(req.body_str().unwrap().to_owned())
+    });
+
+    let err = sender.flush_and_keep(&buffer).unwrap_err();
+    let row = err.failed_row().unwrap();
+    assert_eq!(row, 1);
+    buffer.drop_rows(row..row + 1)?;
+    sender.flush(&mut buffer)?;
+
+    let body = server_thread.join().unwrap()?;
+    assert_eq!(body, "test i=0i\ntest i=2i\n");
+    Ok(())
+}
+
+fn multi_table_buffer() -> crate::Result<MultiTableBuffer> {
+    let mut buffer = MultiTableBuffer::new();
+    for i in 0..2 {
+        buffer.table("a")?.column_i64("i", i)?.at_now()?;
+        buffer.table("b")?.column_i64("i", i)?.at_now()?;
+    }
+    buffer.table("c")?.column_i64("i", 0)?.at_now()?;
+    Ok(buffer)
+}
+
+#[test]
+fn test_flush_multi_table() -> TestResult {
+    let mut buffer = multi_table_buffer()?;
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_http().build()?;
+    let server_thread = std::thread::spawn(move || -> io::Result<Vec<String>> {
+        server.accept()?;
+        let mut bodies = Vec::new();
+        for status in [204, 400, 204, 204] {
+            let req = server.recv_http_q()?;
+            bodies.push(req.body_str().unwrap().to_owned());
+            let response = match status {
+                204 => HttpResponse::empty(),
+                _ => HttpResponse::empty()
+                    .with_status(400, "Bad Request")
+                    .with_body_str("bad request"),
+            };
+            server.send_http_response_q(response)?;
+        }
+        Ok(bodies)
+    });
+
+    // The failed table and those after it keep their rows.
+    let err = sender.flush_multi_table(&mut buffer).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::ServerFlushError);
+    assert!(buffer.get("a").unwrap().is_empty());
+    assert_eq!(buffer.get("b").unwrap().row_count(), 2);
+    assert_eq!(buffer.table_count(), 2);
+
+    sender.flush_multi_table(&mut buffer)?;
+    assert!(buffer.is_empty());
+
+    let bodies = server_thread.join().unwrap()?;
+    assert_eq!(
+        bodies,
+        [
+            "a i=0i\na i=1i\n",
+            "b i=0i\nb i=1i\n",
+            "b i=0i\nb i=1i\n",
+            "c i=0i\n"
+        ]
+    );
+    Ok(())
+}
+
+#[test]
+fn test_pool_flush_multi_table() -> TestResult {
+    let mut buffer = multi_table_buffer()?;
+    let mut server = MockServer::new()?;
+    let pool = server.lsb_http().pool_size(1)?.build_pool()?;
+    let server_thread = std::thread::spawn(move || -> io::Result<Vec<String>> {
+        server.accept()?;
+        let mut bodies = Vec::new();
+        for status in [204, 400, 204, 204] {
+            let req = server.recv_http_q()?;
+            bodies.push(req.body_str().unwrap().to_owned());
+            let response = match status {
+                204 => HttpResponse::empty(),
+                _ => HttpResponse::empty()
+                    .with_status(400, "Bad Request")
+                    .with_body_str("bad request"),
+            };
+            server.send_http_response_q(response)?;
+        }
+        Ok(bodies)
+    });
+
+    // Unlike `Sender::flush_multi_table`, the tables after the failed one
+    // are still sent.
+    let err = pool.flush_multi_table(&mut buffer).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::ServerFlushError);
+    assert_eq!(buffer.table_count(), 1);
+    assert_eq!(buffer.get("b").unwrap().row_count(), 2);
+
+    pool.flush_multi_table(&mut buffer)?;
+    assert!(buffer.is_empty());
+
+    let bodies = server_thread.join().unwrap()?;
+    assert_eq!(bodies[1], "b i=0i\nb i=1i\n");
+    assert_eq!(bodies[3], "b i=0i\nb i=1i\n");
+    Ok(())
+}
+
+#[test]
+fn test_flush_chunked() -> TestResult {
+    let max = 1024;
+    let mut buffer = Buffer::new();
+    for i in 0..220 {
+        buffer.table("test")?.column_f64("x", i as f64)?.at_now()?;
+    }
+    let expected = buffer.as_str().to_owned();
+
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_http().max_buf_size(max)?.build()?;
+    let server_thread = std::thread::spawn(move || -> io::Result<Vec<String>> {
+        server.accept()?;
+        let mut bodies = Vec::new();
+        for status in [204, 400, 204, 204] {
+            let req = server.recv_http_q()?;
+            assert!(req.body().len() <= max);
+            let response = match status {
+                204 => HttpResponse::empty(),
+                _ => HttpResponse::empty()
+                    .with_status(400, "Bad Request")
+                    .with_body_str("bad request"),
+            };
+            server.send_http_response_q(response)?;
+            if status == 204 {
+                bodies.push(req.body_str().unwrap().to_owned());
+            }
+        }
+        Ok(bodies)
+    });
+
+    // The second request fails: The rows sent before it are kept track of,
+    // and the next call resumes from the first unsent row.
+    let err = sender.flush_chunked(&mut buffer).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::ServerFlushError);
+    let sent = buffer.send_offset();
+    assert!(sent > 0 && sent <= max);
+    assert!(expected[..sent].ends_with('\n'));
+    sender.flush_chunked(&mut buffer)?;
+    assert!(buffer.is_empty());
+
+    let bodies = server_thread.join().unwrap()?;
+    assert_eq!(bodies.len(), 3);
+    assert_eq!(bodies.concat(), expected);
+    Ok(())
+}
+
+#[test]
+fn test_send_file() -> TestResult {
+    let max = 1024;
+    let mut buffer = Buffer::new();
+    for i in 0..220 {
+        buffer.table("test")?.column_i64("i", i)?.at_now()?;
+    }
+    let expected = buffer.as_str().to_owned();
+    let dir = tempfile::tempdir()?;
+    let path = dir.path().join("rows.ilp");
+    std::fs::write(&path, buffer.as_bytes())?;
+
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_http().max_buf_size(max)?.build()?;
+    let server_thread = std::thread::spawn(move || -> io::Result<Vec<String>> {
+        server.accept()?;
+        let mut bodies = Vec::new();
+        while bodies.concat().len() < expected.len() {
+            let req = server.recv_http_q()?;
+            assert!(req.body().len() <= max);
+            bodies.push(req.body_str().unwrap().to_owned());
+            server.send_http_response_q(HttpResponse::empty())?;
+        }
+        Ok(bodies)
+    });
+
+    sender.send_file(&path)?;
+    let bodies = server_thread.join().unwrap()?;
+    assert_eq!(bodies.len() as u64, sender.stats().flushes);
+    assert!(bodies.len() > 1);
+    assert!(bodies.iter().all(|body| body.ends_with('\n')));
+    assert_eq!(bodies.concat(), buffer.as_str());
+    Ok(())
+}
+
+#[test]
+fn test_prewarm() -> TestResult {
+    let mut server = MockServer::new()?;
+    let builder = server.lsb_http().prewarm(true)?.ping_interval(None)?;
+
+    let server_thread = std::thread::spawn(move || -> io::Result<()> {
+        // A single connection carries the pings and the flush.
+        server.accept()?;
+        for _ in 0..2 {
+            let req = server.recv_http_q()?;
+            assert_eq!(req.method(), "GET");
+            assert_eq!(req.path(), "/ping");
+            server.send_http_response_q(HttpResponse::empty())?;
+        }
+
+        let req = server.recv_http_q()?;
+        assert_eq!(req.method(), "POST");
+        assert_eq!(req.path(), "/write?precision=n");
+        server.send_http_response_q(HttpResponse::empty())?;
+        Ok(())
+    });
+
+    let mut sender = builder.build()?;
+    sender.warm_up()?;
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    let res = sender.flush(&mut buffer);
+    server_thread.join().unwrap()?;
+    res?;
+    Ok(())
+}
+
+#[test]
+fn test_prewarm_unreachable() -> TestResult {
+    let closed_port = std::net::TcpListener::bind("127.0.0.1:0")?
+        .local_addr()?
+        .port();
+    let res = SenderBuilder::new(Protocol::Http, "127.0.0.1", closed_port)
+        .prewarm(true)?
+        .build();
+    let err = res.unwrap_err();
+    assert_eq!(err.code(), ErrorCode::SocketError);
+    assert!(err.msg().starts_with("Could not warm up connection: "));
+    Ok(())
+}
+
+#[cfg(feature = "compression-gzip")]
+#[test]
+fn test_gzip_compression() -> TestResult {
+    use crate::ingress::Compression;
+    use std::io::Read;
+
+    let mut buffer = Buffer::new();
+    for x in 0..100 {
+        buffer
+            .table("test")?
+            .symbol("sym", "bol")?
+            .column_f64("x", x as f64)?
+            .at_now()?;
+    }
+    let buffer2 = buffer.clone();
+
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_http().compression(Compression::Gzip)?.build()?;
+
+    let server_thread = std::thread::spawn(move || -> io::Result<()> {
+        server.accept()?;
+
+        for _ in 0..2 {
+            let req = server.recv_http_q()?;
+            assert_eq!(req.header("content-encoding"), Some("gzip"));
+            assert!(req.body().len() < buffer2.len() / 4);
+            let mut body = String::new();
+            flate2::read::GzDecoder::new(req.body()).read_to_string(&mut body)?;
+            assert_eq!(body, buffer2.as_str());
+
+            server.send_http_response_q(HttpResponse::empty())?;
+        }
+
+        Ok(())
+    });
+
+    // The second flush reuses the compression context.
+    let res = sender
+        .flush_and_keep(&buffer)
+        .and_then(|_| sender.flush(&mut buffer));
+
+    server_thread.join().unwrap()?;
+
+    res?;
+
+    assert!(buffer.is_empty());
+
+    Ok(())
+}
+
+#[cfg(feature = "async-tokio")]
+#[test]
+fn test_async_sender() -> TestResult {
+    let mut buffer = Buffer::new();
+    buffer
+        .table("test")?
+        .symbol("sym", "bol")?
+        .column_f64("x", 1.0)?
+        .at_now()?;
+    let buffer2 = buffer.clone();
+
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_http()
+        .retry_timeout(Duration::from_secs(1))?
+        .build_async()?;
+
+    let server_thread = std::thread::spawn(move || -> io::Result<()> {
+        server.accept()?;
+
+        // A retriable error, then success over the same connection.
+        let req = server.recv_http_q()?;
+        assert_eq!(req.path(), "/write?precision=n");
+        assert_eq!(req.body_str().unwrap(), buffer2.as_str());
+        server.send_http_response_q(
+            HttpResponse::empty()
+                .with_status(503, "Service Unavailable")
+                .with_body_str("Busy"),
+        )?;
+
+        let req = server.recv_http_q()?;
+        assert_eq!(req.body_str().unwrap(), buffer2.as_str());
+        server.send_http_response_q(HttpResponse::empty())?;
+
+        Ok(())
+    });
+
+    let runtime = tokio::runtime::Builder::new_current_thread()
+        .enable_all()
+        .build()?;
+    let res = runtime.block_on(sender.flush(&mut buffer));
+
+    server_thread.join().unwrap()?;
+
+    res?;
+
+    assert!(buffer.is_empty());
+
+    Ok(())
+}
+
+#[cfg(feature = "ilp-over-http2")]
+#[test]
+fn test_async_sender_http2() -> TestResult {
+    use bytes::Bytes;
+    use http_body_util::{BodyExt, Full};
+    use hyper::body::Incoming;
+    use hyper_util::rt::{TokioExecutor, TokioIo};
+    use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+
+    let runtime = tokio::runtime::Builder::new_current_thread()
+        .enable_all()
+        .build()?;
+    runtime.block_on(async {
+        let listener = tokio::net::TcpListener::bind("127.0.0.1:0").await?;
+        let port = listener.local_addr()?.port();
+        let accepted = Arc::new(AtomicUsize::new(0));
+        let uris = Arc::new(Mutex::new(Vec::<String>::new()));
+        let reset_once = Arc::new(AtomicBool::new(true));
+
+        // Resets the stream of the first request to the `reset` table.
+        let server = {
+            let accepted = Arc::clone(&accepted);
+            let uris = Arc::clone(&uris);
+            async move {
+                while let Ok((stream, _)) = listener.accept().await {
+                    accepted.fetch_add(1, Ordering::SeqCst);
+                    let uris = Arc::clone(&uris);
+                    let reset_once = Arc::clone(&reset_once);
+                    let service =
+                        hyper::service::service_fn(move |req: hyper::Request<Incoming>| {
+                            let uris = Arc::clone(&uris);
+                            let reset_once = Arc::clone(&reset_once);
+                            async move {
+                                uris.lock().unwrap().push(req.uri().to_string());
+                                let body = BodyExt::collect(req.into_body())
+                                    .await
+                                    .map_err(|err| io::Error::new(ErrorKind::Other, err))?
+                                    .to_bytes();
+                                if body.starts_with(b"reset")
+                                    && reset_once.swap(false, Ordering::SeqCst)
+                                {
+                                    return Err(io::Error::new(ErrorKind::Other, "reset"));
+                                }
+                                Ok::<_, io::Error>(hyper::Response::new(Full::new(Bytes::new())))
+                            }
+                        });
+                    tokio::spawn(
+                        hyper::server::conn::http2::Builder::new(TokioExecutor::new())
+                            .serve_connection(TokioIo::new(stream), service),
+                    );
+                }
+            }
+        };
+        tokio::spawn(server);
+
+        let mut sender = SenderBuilder::new(Protocol::Http, "127.0.0.1", port)
+            .http2(true)?
+            .retry_timeout(Duration::from_secs(5))?
+            .build_async()?;
+        let mut buffer = Buffer::new();
+        buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+        sender.flush(&mut buffer).await?;
+
+        // The clones multiplex over the connection the first flush opened.
+        let mut clone1 = sender.try_clone()?;
+        let mut clone2 = sender.try_clone()?;
+        let mut buffer1 = Buffer::new();
+        buffer1.table("test")?.symbol("t1", "v2")?.at_now()?;
+        let mut buffer2 = Buffer::new();
+        buffer2.table("test")?.symbol("t1", "v3")?.at_now()?;
+        let (res1, res2) = tokio::join!(clone1.flush(&mut buffer1), clone2.flush(&mut buffer2));
+        res1?;
+        res2?;
+
+        // A reset stream is retried, and the connection stays usable for the
+        // other clones.
+        buffer.table("reset")?.symbol("t1", "v4")?.at_now()?;
+        sender.flush(&mut buffer).await?;
+        buffer1.table("test")?.symbol("t1", "v5")?.at_now()?;
+        clone1.flush(&mut buffer1).await?;
+
+        assert_eq!(accepted.load(Ordering::SeqCst), 1);
+        let uris = uris.lock().unwrap();
+        assert_eq!(uris.len(), 6);
+        let expected = format!("http://127.0.0.1:{}/write?precision=n", port);
+        for uri in uris.iter() {
+            assert_eq!(uri, &expected);
+        }
+        TestResult::Ok(())
+    })
+}
+
 #[test]
 fn test_text_plain_error() -> TestResult {
     let mut buffer = Buffer::new();
@@ -183,6 +743,15 @@ fn test_json_error() -> TestResult {
 
     let mut server = MockServer::new()?;
     let mut sender = server.lsb_http().build()?;
+    let spans = Arc::new(Mutex::new(Vec::new()));
+    let spans2 = spans.clone();
+    sender.set_trace_hook(move |span| {
+        let error_id = span.error_id.map(str::to_string);
+        spans2
+            .lock()
+            .unwrap()
+            .push((span.kind, span.attempt, span.status_code, error_id));
+    });
 
     let buffer2 = buffer.clone();
     let server_thread = std::thread::spawn(move || -> io::Result<()> {
@@ -218,6 +787,24 @@ fn test_json_error() -> TestResult {
         err.msg(),
         "Could not flush buffer: failed to parse line protocol: invalid field format [id: ABC-2, code: invalid, line: 2]"
     );
+    assert_eq!(err.failed_row(), Some(1));
+
+    let spans = spans.lock().unwrap();
+    assert_eq!(
+        *spans,
+        [
+            (FlushSpanKind::Encode, 0, None, None),
+            (FlushSpanKind::HttpAttempt, 1, Some(400), None),
+            (FlushSpanKind::HttpRequest, 1, Some(400), None),
+            (
+                FlushSpanKind::ParseResponse,
+                0,
+                Some(400),
+                Some("ABC-2".to_string())
+            ),
+            (FlushSpanKind::Flush, 0, None, None),
+        ]
+    );
 
     Ok(())
 }
@@ -586,6 +1173,158 @@ fn test_two_retries() -> TestResult {
     // Unpacking the error here allows server errors to bubble first.
     res?;
 
+    let stats = sender.stats();
+    assert_eq!(stats.flushes, 1);
+    assert_eq!(stats.rows_sent, 1);
+    assert_eq!(stats.bytes_sent, buffer.len() as u64);
+    assert_eq!(stats.server_retries, 2);
+    assert_eq!(stats.network_retries, 0);
+    assert!(stats.retry_sleep >= Duration::from_millis(20));
+    assert!(stats.flush_latency.max() >= stats.retry_sleep);
+
+    Ok(())
+}
+
+#[test]
+fn test_spool() -> TestResult {
+    let spool_dir = tempfile::tempdir()?;
+
+    let mut buffer1 = Buffer::new();
+    buffer1
+        .table("test")?
+        .symbol("t1", "v1")?
+        .at(TimestampNanos::new(10000000))?;
+    let mut buffer2 = Buffer::new();
+    buffer2
+        .table("test")?
+        .symbol("t1", "v2")?
+        .at(TimestampNanos::new(20000000))?;
+    let body1 = buffer1.as_str().to_string();
+    let body2 = buffer2.as_str().to_string();
+
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_http()
+        .retry_timeout(Duration::ZERO)?
+        .spool_dir(spool_dir.path())?
+        .build()?;
+
+    let server_thread = std::thread::spawn(move || -> io::Result<()> {
+        server.accept()?;
+
+        // The flush fails with a retriable error, so the buffer is spooled.
+        let req = server.recv_http_q()?;
+        assert_eq!(req.body_str().unwrap(), body1);
+        server.send_http_response_q(
+            HttpResponse::empty()
+                .with_status(503, "Service Unavailable")
+                .with_body_str("restarting"),
+        )?;
+
+        // The replay thread sends it again, ahead of the next flush.
+        let req = server.recv_http_q()?;
+        assert_eq!(req.body_str().unwrap(), body1);
+        server.send_http_response_q(HttpResponse::empty())?;
+
+        let req = server.recv_http_q()?;
+        assert_eq!(req.body_str().unwrap(), body2);
+        server.send_http_response_q(HttpResponse::empty())?;
+
+        Ok(())
+    });
+
+    let res = sender
+        .flush(&mut buffer1)
+        .and_then(|_| sender.flush(&mut buffer2));
+
+    server_thread.join().unwrap()?;
+
+    res?;
+    assert!(buffer1.is_empty());
+    assert!(buffer2.is_empty());
+
+    // Fully replayed segments are deleted.
+    drop(sender);
+    assert_eq!(std::fs::read_dir(spool_dir.path())?.count(), 0);
+
+    Ok(())
+}
+
+#[test]
+fn test_spool_rejected() -> TestResult {
+    let spool_dir = tempfile::tempdir()?;
+
+    let mut buffer1 = Buffer::new();
+    buffer1
+        .table("test")?
+        .symbol("t1", "v1")?
+        .at(TimestampNanos::new(10000000))?;
+    let mut buffer2 = Buffer::new();
+    buffer2
+        .table("test")?
+        .symbol("t1", "v2")?
+        .at(TimestampNanos::new(20000000))?;
+    let body1 = buffer1.as_str().to_string();
+    let body2 = buffer2.as_str().to_string();
+
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_http()
+        .retry_timeout(Duration::ZERO)?
+        .spool_dir(spool_dir.path())?
+        .build()?;
+
+    let server_thread = std::thread::spawn(move || -> io::Result<()> {
+        server.accept()?;
+
+        let req = server.recv_http_q()?;
+        assert_eq!(req.body_str().unwrap(), body1);
+        server.send_http_response_q(
+            HttpResponse::empty()
+                .with_status(503, "Service Unavailable")
+                .with_body_str("restarting"),
+        )?;
+
+        // The replayed buffer is rejected for good.
+        let req = server.recv_http_q()?;
+        assert_eq!(req.body_str().unwrap(), body1);
+        server.send_http_response_q(
+            HttpResponse::empty()
+                .with_status(400, "Bad Request")
+                .with_header("content-type", "text/plain")
+                .with_body_str("bad wombat"),
+        )?;
+
+        let req = server.recv_http_q()?;
+        assert_eq!(req.body_str().unwrap(), body2);
+        server.send_http_response_q(HttpResponse::empty())?;
+
+        Ok(())
+    });
+
+    sender.flush(&mut buffer1)?;
+    let start = std::time::Instant::now();
+    while sender.stats().spool_rejected == 0 {
+        assert!(start.elapsed() < Duration::from_secs(5));
+        std::thread::sleep(Duration::from_millis(10));
+    }
+
+    // The next flush reports the rejection once, leaving its own buffer be.
+    let err = sender.flush(&mut buffer2).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::ServerFlushError);
+    assert_eq!(
+        err.msg(),
+        "A spooled buffer was rejected on replay and dropped: \
+        Could not flush buffer: bad wombat"
+    );
+    assert!(!buffer2.is_empty());
+    let res = sender.flush(&mut buffer2);
+
+    server_thread.join().unwrap()?;
+
+    res?;
+    assert!(buffer2.is_empty());
+    assert_eq!(sender.stats().spool_rejected, 1);
     Ok(())
 }
 
@@ -712,3 +1451,139 @@ fn test_transactional() -> TestResult {
 
     Ok(())
 }
+
+#[test]
+fn test_flush_stream() -> TestResult {
+    let mut expected = String::new();
+    let mut chunks = Vec::new();
+    for chunk_index in 0..3 {
+        let mut chunk = Buffer::new();
+        for i in 0..50 {
+            chunk
+                .table("test")?
+                .column_i64("x", chunk_index * 50 + i)?
+                .at(TimestampNanos::new(1000 + i))?;
+        }
+        expected.push_str(chunk.as_str());
+        chunks.push(chunk);
+    }
+    let expected2 = expected.clone();
+
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_http()
+        .retry_timeout(Duration::from_secs(1))?
+        .build()?;
+
+    let server_thread = std::thread::spawn(move || -> io::Result<()> {
+        server.accept()?;
+
+        // A retriable error: The stream is resent from the replay window.
+        let req = server.recv_http_q()?;
+        assert_eq!(req.header("transfer-encoding"), Some("chunked"));
+        assert_eq!(req.body_str().unwrap(), expected2);
+        server.send_http_response_q(
+            HttpResponse::empty()
+                .with_status(503, "Service Unavailable")
+                .with_body_str("Busy"),
+        )?;
+
+        let req = server.recv_http_q()?;
+        assert_eq!(req.body_str().unwrap(), expected2);
+        server.send_http_response_q(HttpResponse::empty())?;
+
+        Ok(())
+    });
+
+    let mut next = chunks.iter();
+    let res = sender.flush_stream(true, |buf| {
+        if let Some(chunk) = next.next() {
+            buf.append_buffer(chunk)?;
+        }
+        Ok(next.len() > 0)
+    });
+
+    server_thread.join().unwrap()?;
+
+    res?;
+
+    let stats = sender.stats();
+    assert_eq!(stats.rows_sent, 150);
+    assert_eq!(stats.bytes_sent, expected.len() as u64);
+    assert_eq!(stats.server_retries, 1);
+
+    // An empty stream sends nothing.
+    sender.flush_stream(false, |_| Ok(false))?;
+
+    // A transactional stream must stick to one table.
+    let err = sender
+        .flush_stream(true, |buf| {
+            buf.table("other")?.column_i64("x", 1)?.at_now()?;
+            Ok(false)
+        })
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+
+    Ok(())
+}
+
+#[test]
+fn test_flush_stream_replay_window() -> TestResult {
+    let mut chunk = Buffer::new();
+    for i in 0..50 {
+        chunk.table("test")?.column_i64("x", i)?.at_now()?;
+    }
+    let chunk_len = chunk.len();
+
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_http()
+        .retry_timeout(Duration::from_secs(1))?
+        .stream_replay_window(chunk_len)?
+        .build()?;
+
+    let server_thread = std::thread::spawn(move || -> io::Result<()> {
+        server.accept()?;
+        let req = server.recv_http_q()?;
+        assert_eq!(req.body().len(), 2 * chunk_len);
+        server.send_http_response_q(
+            HttpResponse::empty()
+                .with_status(503, "Service Unavailable")
+                .with_body_str("Busy"),
+        )?;
+        Ok(())
+    });
+
+    // Two chunks outgrow the window: The error isn't retried.
+    let mut remaining = 2;
+    let res = sender.flush_stream(false, |buf| {
+        buf.append_buffer(&chunk)?;
+        remaining -= 1;
+        Ok(remaining > 0)
+    });
+
+    server_thread.join().unwrap()?;
+
+    let err = res.unwrap_err();
+    assert!(
+        err.msg().contains("stream_replay_window"),
+        "unexpected error: {}",
+        err.msg()
+    );
+    assert_eq!(sender.stats().server_retries, 0);
+
+    Ok(())
+}
+
+#[test]
+fn test_flush_stream_tcp() -> TestResult {
+    let server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().build()?;
+    let err = sender.flush_stream(false, |_| Ok(false)).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(
+        err.msg(),
+        "Streaming flushes are only supported for ILP over HTTP."
+    );
+    Ok(())
+}
@@ -227,6 +227,12 @@ impl MockServer {
         Ok(())
     }
 
+    /// Close the connection to the client, as a server restart would.
+    pub fn disconnect(&mut self) {
+        self.client = None;
+        self.tls_conn = None;
+    }
+
     pub fn accept_tls_sync(&mut self) -> io::Result<()> {
         self.accept()?;
         let client = self.client.as_mut().unwrap();
@@ -469,6 +475,15 @@ impl MockServer {
         let deadline = Instant::now() + Duration::from_secs_f64(wait_timeout_sec);
         let (pos, method, path) = self.recv_http_method(&mut accum, deadline)?;
         let (pos, headers) = self.recv_http_headers(pos, &mut accum, deadline)?;
+        if headers.get("transfer-encoding").map(String::as_str) == Some("chunked") {
+            let body = self.recv_http_chunked_body(pos, &mut accum, deadline)?;
+            return Ok(HttpRequest {
+                method,
+                path,
+                headers,
+                body,
+            });
+        }
         let content_length = headers
             .get("content-length")
             .ok_or_else(|| io::Error::new(io::ErrorKind::InvalidData, "Missing Content-Length"))?
@@ -488,6 +503,38 @@ impl MockServer {
         })
     }
 
+    /// Read a body sent with `Transfer-Encoding: chunked`, up to the final
+    /// zero-sized chunk.
+    #[cfg(feature = "ilp-over-http")]
+    fn recv_http_chunked_body(
+        &mut self,
+        mut pos: usize,
+        accum: &mut Vec<u8>,
+        deadline: Instant,
+    ) -> io::Result<Vec<u8>> {
+        let mut body = Vec::new();
+        loop {
+            while !contains(&accum[pos..], b"\r\n") {
+                self.read_more(accum, deadline, "Reading HTTP chunk size")?;
+            }
+            let end_of_line = pos + position(&accum[pos..], b"\r\n").unwrap();
+            let size_line = std::str::from_utf8(&accum[pos..end_of_line]).unwrap();
+            let size_hex = size_line.split(';').next().unwrap().trim();
+            let size = usize::from_str_radix(size_hex, 16).map_err(|_| {
+                io::Error::new(io::ErrorKind::InvalidData, "Invalid HTTP chunk size")
+            })?;
+            let data_start = end_of_line + 2;
+            while accum.len() < data_start + size + 2 {
+                self.read_more(accum, deadline, "Reading HTTP chunk")?;
+            }
+            if size == 0 {
+                return Ok(body);
+            }
+            body.extend_from_slice(&accum[data_start..(data_start + size)]);
+            pos = data_start + size + 2;
+        }
+    }
+
     #[cfg(feature = "ilp-over-http")]
     pub fn recv_http_q(&mut self) -> io::Result<HttpRequest> {
         self.recv_http(5.0)
@@ -24,7 +24,10 @@
 
 use crate::{
     ingress::{
-        Buffer, CertificateAuthority, Sender, TableName, Timestamp, TimestampMicros, TimestampNanos,
+        ArrowArray, ArrowSchema, Buffer, BufferPool, CertificateAuthority, ColumnData, ColumnSlice,
+        ColumnType, ColumnValue, FlushSpanKind, PreparedColumnName, Protocol, ProtocolVersion,
+        RowTemplate, Sender, SenderBuilder, TableName, Timestamp, TimestampMicros, TimestampNanos,
+        TimestampPrecision,
     },
     Error, ErrorCode,
 };
@@ -35,6 +38,9 @@ use crate::tests::{
 };
 
 use core::time::Duration;
+use std::ffi::c_void;
+use std::ptr;
+use std::sync::{Arc, Mutex};
 use std::{io, time::SystemTime};
 
 #[test]
@@ -81,6 +87,42 @@ fn test_basics() -> TestResult {
     Ok(())
 }
 
+#[test]
+fn test_tcp_failover() -> TestResult {
+    // Nothing listens on the port of a closed listener.
+    let closed_port = std::net::TcpListener::bind("127.0.0.1:0")?
+        .local_addr()?
+        .port();
+    let mut server = MockServer::new()?;
+    let mut sender = SenderBuilder::new(Protocol::Tcp, "127.0.0.1", closed_port)
+        .failover_addr(server.host, server.port)?
+        .build()?;
+    server.accept()?;
+
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    sender.flush(&mut buffer)?;
+    assert_eq!(server.recv_q()?, 1);
+    assert_eq!(server.msgs[0], "test,t1=v1\n");
+    Ok(())
+}
+
+#[test]
+fn test_tcp_no_host_reachable() -> TestResult {
+    let closed_port = std::net::TcpListener::bind("127.0.0.1:0")?
+        .local_addr()?
+        .port();
+    let err = SenderBuilder::new(Protocol::Tcp, "127.0.0.1", closed_port)
+        .failover_addr("127.0.0.1", closed_port)?
+        .build()
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::SocketError);
+    assert!(err.msg().starts_with(&format!(
+        "Could not connect to \"127.0.0.1:{closed_port}\": "
+    )));
+    Ok(())
+}
+
 #[test]
 fn test_max_buf_size() -> TestResult {
     let max = 1024;
@@ -108,6 +150,1487 @@ fn test_max_buf_size() -> TestResult {
     Ok(())
 }
 
+#[test]
+fn test_protocol_version_2() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_tcp()
+        .protocol_version(Some(ProtocolVersion::V2))?
+        .build()?;
+    assert_eq!(sender.protocol_version(), ProtocolVersion::V2);
+    server.accept()?;
+
+    let floats = [0.5, -1e300];
+    let mut buffer = sender.new_buffer();
+    for &f in &floats {
+        buffer
+            .table("test")?
+            .symbol("t1", "v1")?
+            .column_f64("f1", f)?
+            .column_i64("i1", 1)?
+            .at(TimestampNanos::new(10))?;
+    }
+
+    let mut exp = Vec::new();
+    for &f in &floats {
+        exp.extend_from_slice(b"test,t1=v1 f1==\x10");
+        exp.extend_from_slice(&f.to_le_bytes());
+        exp.extend_from_slice(b",i1=1i 10\n");
+    }
+    assert_eq!(buffer.as_bytes(), &exp[..]);
+
+    let template = RowTemplate::new("test")?
+        .column("t1", ColumnType::Symbol)?
+        .column("f1", ColumnType::F64)?
+        .column("i1", ColumnType::I64)?;
+    let mut rows = sender.new_buffer();
+    for &f in &floats {
+        rows.append_row(
+            &template,
+            [
+                ColumnValue::Symbol("v1"),
+                ColumnValue::F64(f),
+                ColumnValue::I64(1),
+            ],
+            Some(TimestampNanos::new(10)),
+        )?;
+    }
+    assert_eq!(rows.as_bytes(), &exp[..]);
+
+    let mut columns = sender.new_buffer();
+    columns.append_columns(
+        "test",
+        &[
+            ColumnSlice::new("t1", ColumnData::Symbol(&["v1", "v1"]))?,
+            ColumnSlice::new("f1", ColumnData::F64(&floats))?,
+            ColumnSlice::new("i1", ColumnData::I64(&[1, 1]))?,
+        ],
+        Some(&[10, 10]),
+    )?;
+    assert_eq!(columns.as_bytes(), &exp[..]);
+
+    sender.flush(&mut buffer)?;
+    assert!(buffer.is_empty());
+    Ok(())
+}
+
+#[test]
+fn test_protocol_version_mismatch() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().build()?;
+    assert_eq!(sender.protocol_version(), ProtocolVersion::V1);
+    server.accept()?;
+
+    let mut buffer = Buffer::new();
+    buffer.set_protocol_version(ProtocolVersion::V2)?;
+    buffer.table("test")?.column_f64("f1", 0.5)?.at_now()?;
+    let err = sender.flush(&mut buffer).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(
+        err.msg(),
+        "Could not flush buffer: Buffer uses line protocol version 2, but the sender uses version 1."
+    );
+    Ok(())
+}
+
+#[test]
+fn test_background_flush() -> TestResult {
+    let mut server = MockServer::new()?;
+    let sender = server.lsb_tcp().build()?;
+    server.accept()?;
+    let mut sender = sender.into_background(2)?;
+
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    let handle = sender.flush(&mut buffer)?;
+    assert!(buffer.is_empty());
+    assert_eq!(buffer.row_count(), 0);
+
+    buffer.table("test")?.symbol("t1", "v2")?.at_now()?;
+    let (tx, rx) = std::sync::mpsc::channel();
+    sender.flush_with_callback(&mut buffer, move |res| tx.send(res).unwrap())?;
+    assert!(buffer.is_empty());
+
+    handle.wait()?;
+    rx.recv()??;
+    sender.close();
+
+    assert_eq!(server.recv_q()?, 2);
+    assert_eq!(server.msgs[0].as_str(), "test,t1=v1\n");
+    assert_eq!(server.msgs[1].as_str(), "test,t1=v2\n");
+    Ok(())
+}
+
+#[test]
+fn test_at_delta() -> TestResult {
+    let mut expected = Buffer::new();
+    let mut buffer = Buffer::new();
+    let mut ts = 1_659_548_315_599_999_990i64;
+    for _ in 0..50 {
+        expected
+            .table("test")?
+            .column_i64("x", ts)?
+            .at(TimestampNanos::new(ts))?;
+        buffer
+            .table("test")?
+            .column_i64("x", ts)?
+            .at_delta(TimestampNanos::new(ts))?;
+        ts += 3;
+    }
+
+    // Cached digits don't leak across far apart or micros timestamps.
+    for ts in [
+        Timestamp::from(TimestampNanos::new(5)),
+        Timestamp::from(TimestampMicros::new(1_659_548_315_647_406)),
+        Timestamp::from(TimestampNanos::new(ts)),
+    ] {
+        expected.table("test")?.symbol("t1", "v1")?.at(ts)?;
+        buffer.table("test")?.symbol("t1", "v1")?.at_delta(ts)?;
+    }
+    assert_eq!(buffer.as_str(), expected.as_str());
+    assert_eq!(buffer.row_count(), expected.row_count());
+
+    let err = buffer.at_delta(TimestampNanos::new(1)).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    buffer.table("test")?.symbol("t1", "v1")?;
+    let err = buffer.at_delta(TimestampNanos::new(-1)).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidTimestamp);
+    assert_eq!(err.msg(), "Timestamp -1 is negative. It must be >= 0.");
+    Ok(())
+}
+
+#[test]
+fn test_background_flush_with_buffer_pool() -> TestResult {
+    let buffers = Arc::new(BufferPool::new(1024, 4));
+    let mut server = MockServer::new()?;
+    let sender = server.lsb_tcp().build()?;
+    server.accept()?;
+    let mut sender = sender.into_background_with_pool(2, Arc::clone(&buffers))?;
+    assert_eq!(buffers.idle(), 0);
+
+    let mut buffer = buffers.acquire();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    buffer.reserve(1024 * 1024);
+    sender.flush(&mut buffer)?.wait()?;
+    buffer.table("test")?.symbol("t1", "v2")?.at_now()?;
+    sender.flush(&mut buffer)?.wait()?;
+    sender.close();
+
+    // The ring went back to the pool, with the outlier shrunk.
+    assert_eq!(buffers.idle(), 2);
+    for _ in 0..2 {
+        assert!(buffers.acquire().capacity() < 1024 * 1024);
+    }
+
+    assert_eq!(server.recv_q()?, 2);
+    assert_eq!(server.msgs[0].as_str(), "test,t1=v1\n");
+    assert_eq!(server.msgs[1].as_str(), "test,t1=v2\n");
+    Ok(())
+}
+
+#[test]
+fn test_buffer_pool_for_sender() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_tcp()
+        .timestamp_precision(TimestampPrecision::Micros)?
+        .build()?;
+    server.accept()?;
+    let buffers = BufferPool::new(1024, 1).for_sender(&sender);
+
+    // Both fresh and released buffers match the sender.
+    for _ in 0..2 {
+        let mut buffer = buffers.acquire();
+        assert_eq!(buffer.timestamp_precision(), TimestampPrecision::Micros);
+        buffer
+            .table("test")?
+            .symbol("t1", "v1")?
+            .at(TimestampMicros::new(1_700_000_000_000_001))?;
+        sender.flush(&mut buffer)?;
+        buffers.release(buffer);
+    }
+
+    assert_eq!(server.recv_q()?, 2);
+    assert_eq!(server.msgs[0], "test,t1=v1 1700000000000001\n");
+    assert_eq!(server.msgs[1], "test,t1=v1 1700000000000001\n");
+    Ok(())
+}
+
+#[test]
+fn test_background_flush_incomplete_row() -> TestResult {
+    let mut server = MockServer::new()?;
+    let sender = server.lsb_tcp().build()?;
+    server.accept()?;
+    let mut sender = sender.into_background(1)?;
+
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t1", "v1")?;
+    let err = sender.flush(&mut buffer).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(buffer.as_str(), "test,t1=v1");
+
+    let err = server.lsb_tcp().build()?.into_background(0).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    Ok(())
+}
+
+#[test]
+fn test_concurrent_lanes() -> TestResult {
+    let mut server = MockServer::new()?;
+    let sender = server.lsb_tcp().build()?;
+    server.accept()?;
+    let sender = sender.into_concurrent(4)?;
+
+    std::thread::scope(|scope| -> TestResult {
+        let producers: Vec<_> = (0..4)
+            .map(|thread| {
+                let mut lane = sender.lane();
+                scope.spawn(move || -> crate::Result<()> {
+                    for batch in 0..5 {
+                        for i in 0..10 {
+                            lane.table("test")?
+                                .column_i64("t", thread)?
+                                .column_i64("i", batch * 10 + i)?
+                                .at_now()?;
+                        }
+                        lane.commit()?.wait()?;
+                        assert!(lane.is_empty());
+                    }
+                    Ok(())
+                })
+            })
+            .collect();
+        for producer in producers {
+            producer.join().unwrap()?;
+        }
+        Ok(())
+    })?;
+
+    // A lane with an incomplete row is rejected and keeps its rows.
+    let mut lane = sender.lane();
+    lane.table("test")?.column_i64("t", 4)?;
+    let err = lane.commit().unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(lane.as_str(), "test t=4i");
+    drop(lane);
+    sender.close();
+
+    while server.msgs.len() < 200 {
+        server.recv_q()?;
+    }
+    // Each lane's rows arrive in order, interleaved with those of others.
+    let mut next = [0; 4];
+    for msg in server.msgs.iter() {
+        let thread = (0..4)
+            .find(|&thread| msg.as_str().starts_with(&format!("test t={}i,", thread)))
+            .unwrap();
+        assert_eq!(
+            msg.as_str(),
+            format!("test t={}i,i={}i\n", thread, next[thread])
+        );
+        next[thread] += 1;
+    }
+    assert_eq!(next, [50; 4]);
+
+    let err = server.lsb_tcp().build()?.into_concurrent(0).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    Ok(())
+}
+
+#[test]
+fn test_concurrent_timestamp_precision() -> TestResult {
+    let mut server = MockServer::new()?;
+    let sender = server
+        .lsb_tcp()
+        .timestamp_precision(TimestampPrecision::Micros)?
+        .build()?;
+    server.accept()?;
+    let sender = sender.into_concurrent(2)?;
+
+    // Lanes and replacement buffers take on the sender's precision.
+    let mut lane = sender.lane();
+    assert_eq!(lane.timestamp_precision(), TimestampPrecision::Micros);
+    lane.table("test")?
+        .symbol("t1", "v1")?
+        .at(TimestampNanos::new(1_700_000_000_123_456_789))?;
+    lane.commit()?.wait()?;
+    assert_eq!(lane.timestamp_precision(), TimestampPrecision::Micros);
+
+    let mut buffer = Buffer::new();
+    buffer.set_timestamp_precision(TimestampPrecision::Micros)?;
+    buffer
+        .table("test")?
+        .symbol("t1", "v2")?
+        .at(TimestampMicros::new(1_700_000_000_123_457))?;
+    sender.commit(&mut buffer)?.wait()?;
+    assert_eq!(buffer.timestamp_precision(), TimestampPrecision::Micros);
+    drop(lane);
+    sender.close();
+
+    while server.msgs.len() < 2 {
+        server.recv_q()?;
+    }
+    assert_eq!(server.msgs[0], "test,t1=v1 1700000000123456\n");
+    assert_eq!(server.msgs[1], "test,t1=v2 1700000000123457\n");
+    Ok(())
+}
+
+#[test]
+fn test_flush_many() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().build()?;
+    server.accept()?;
+
+    let mut buffer1 = Buffer::new();
+    buffer1.table("test")?.symbol("t1", "v1")?.at_now()?;
+    let mut buffer2 = Buffer::new();
+    let mut buffer3 = Buffer::new();
+    buffer3.table("test")?.symbol("t1", "v2")?.at_now()?;
+    buffer3.table("test")?.symbol("t1", "v3")?.at_now()?;
+
+    // An incomplete row in any of the buffers fails the whole call.
+    let mut bad = Buffer::new();
+    bad.table("test")?;
+    let err = sender
+        .flush_many(&mut [&mut buffer1, &mut bad])
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(buffer1.row_count(), 1);
+
+    sender.flush_many(&mut [&mut buffer1, &mut buffer2, &mut buffer3])?;
+    assert!(buffer1.is_empty());
+    assert!(buffer3.is_empty());
+
+    assert_eq!(server.recv_q()?, 3);
+    assert_eq!(server.msgs[0].as_str(), "test,t1=v1\n");
+    assert_eq!(server.msgs[1].as_str(), "test,t1=v2\n");
+    assert_eq!(server.msgs[2].as_str(), "test,t1=v3\n");
+    Ok(())
+}
+
+#[test]
+fn test_flush_chunked() -> TestResult {
+    let max = 1024;
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().max_buf_size(max)?.build()?;
+    server.accept()?;
+
+    let mut buffer = Buffer::new();
+    for i in 0..100 {
+        buffer.table("test")?.column_i64("i", i)?.at_now()?;
+    }
+    assert!(buffer.len() > max);
+    sender.flush_chunked(&mut buffer)?;
+    assert!(buffer.is_empty());
+    assert_eq!(sender.stats().flushes, 2);
+    assert_eq!(sender.stats().rows_sent, 100);
+
+    while server.msgs.len() < 100 {
+        server.recv_q()?;
+    }
+    for (i, msg) in server.msgs.iter().enumerate() {
+        assert_eq!(msg.as_str(), format!("test i={}i\n", i));
+    }
+    Ok(())
+}
+
+#[test]
+fn test_flush_trusted_incomplete_row() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().build()?;
+    server.accept()?;
+
+    // Trust relaxes the per-call checks, not the one at flush time: The
+    // half-written row is never sent, in release builds too.
+    let mut buffer = Buffer::new_trusted();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    buffer.table("test")?.column_i64("x", 1)?;
+    let err = sender.flush(&mut buffer).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(buffer.row_count(), 1);
+
+    buffer.at_now()?;
+    sender.flush(&mut buffer)?;
+    assert_eq!(server.recv_q()?, 2);
+    assert_eq!(server.msgs[0], "test,t1=v1\n");
+    assert_eq!(server.msgs[1], "test x=1i\n");
+    Ok(())
+}
+
+#[test]
+fn test_flush_chunked_many() -> TestResult {
+    let max = 256;
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().max_buf_size(max)?.build()?;
+    server.accept()?;
+
+    let mut buffer = Buffer::new();
+    for i in 0..100 {
+        buffer.table("test")?.column_i64("i", i)?.at_now()?;
+    }
+    let len = buffer.len();
+    assert!(len > 3 * max);
+    sender.flush_chunked(&mut buffer)?;
+    assert!(buffer.is_empty());
+    let stats = sender.stats();
+    assert!(stats.flushes >= 4);
+    assert_eq!(stats.rows_sent, 100);
+    assert_eq!(stats.bytes_sent, len as u64);
+
+    while server.msgs.len() < 100 {
+        server.recv_q()?;
+    }
+    for (i, msg) in server.msgs.iter().enumerate() {
+        assert_eq!(msg.as_str(), format!("test i={}i\n", i));
+    }
+    Ok(())
+}
+
+#[test]
+fn test_send_file() -> TestResult {
+    let max = 1024;
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().max_buf_size(max)?.build()?;
+    server.accept()?;
+
+    let mut buffer = sender.new_buffer();
+    for i in 0..100 {
+        buffer
+            .table("test")?
+            .column_i64("i", i)?
+            .column_str("s", "a\nb")?
+            .at_now()?;
+    }
+    assert!(buffer.len() > max);
+    let dir = tempfile::tempdir()?;
+    let path = dir.path().join("rows.ilp");
+    std::fs::write(&path, buffer.as_bytes())?;
+
+    sender.send_file(&path)?;
+    assert_eq!(sender.stats().flushes, 2);
+    assert_eq!(sender.stats().rows_sent, 100);
+    assert_eq!(sender.stats().bytes_sent, buffer.len() as u64);
+    while server.msgs.len() < 100 {
+        server.recv_q()?;
+    }
+    for (i, msg) in server.msgs.iter().enumerate() {
+        assert_eq!(msg.as_str(), format!("test i={}i,s=\"a\\\nb\"\n", i));
+    }
+
+    // Nothing is sent from a file with an incomplete last row.
+    std::fs::write(&path, b"test i=1i\ntest i=2i")?;
+    let err = sender.send_file(&path).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(
+        err.msg(),
+        "Bad ILP file: The row at byte offset 10 is not terminated by a newline."
+    );
+    assert_eq!(server.recv_q()?, 0);
+
+    let err = sender
+        .send_file(dir.path().join("missing.ilp"))
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert!(err.msg().starts_with("Could not open ILP file"));
+    Ok(())
+}
+
+#[test]
+fn test_max_send_rate() -> TestResult {
+    let rate = 20_000;
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().max_send_rate(Some(rate as u64))?.build()?;
+    server.accept()?;
+
+    // The first second's worth goes out straight away, the rest is paced.
+    let mut buffer = Buffer::new();
+    while buffer.len() < rate * 3 / 2 {
+        buffer.table("test")?.column_i64("i", 1)?.at_now()?;
+    }
+    let rows = buffer.row_count();
+    let start = std::time::Instant::now();
+    sender.flush(&mut buffer)?;
+    let elapsed = start.elapsed();
+    assert!(elapsed >= Duration::from_millis(400), "{:?}", elapsed);
+    assert!(elapsed < Duration::from_secs(5), "{:?}", elapsed);
+
+    while server.msgs.len() < rows {
+        server.recv_q()?;
+    }
+    Ok(())
+}
+
+#[test]
+fn test_try_flush_max_send_rate() -> TestResult {
+    let rate = 20_000;
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().max_send_rate(Some(rate as u64))?.build()?;
+    server.accept()?;
+    sender.set_nonblocking(true)?;
+    assert_eq!(sender.try_flush_delay(), Duration::ZERO);
+
+    let mut buffer = Buffer::new();
+    while buffer.len() < rate * 3 / 2 {
+        buffer.table("test")?.column_i64("i", 1)?.at_now()?;
+    }
+    let rows = buffer.row_count();
+
+    // Waiting out the delay between calls, rather than polling, sends the
+    // rest in a few paced slices.
+    let start = std::time::Instant::now();
+    let mut calls = 0;
+    while !sender.try_flush(&mut buffer)? {
+        calls += 1;
+        let delay = sender.try_flush_delay();
+        assert!(delay < Duration::from_secs(1), "{:?}", delay);
+        std::thread::sleep(delay);
+    }
+    let elapsed = start.elapsed();
+    assert!(elapsed >= Duration::from_millis(400), "{:?}", elapsed);
+    assert!(calls < 100, "{}", calls);
+
+    while server.msgs.len() < rows {
+        server.recv_q()?;
+    }
+    Ok(())
+}
+
+#[test]
+fn test_reconnect() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_tcp()
+        .reconnect_timeout(Some(Duration::from_secs(5)))?
+        .replay_buffers(1)?
+        .build()?;
+    server.accept()?;
+
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t", "a")?.at_now()?;
+    sender.flush(&mut buffer)?;
+    assert_eq!(server.recv_q()?, 1);
+
+    // The first writes after the disconnect may still succeed, until the
+    // client sees the reset. The flush at that point reconnects, replays the
+    // previous buffer and resends its own.
+    server.disconnect();
+    let mut last = String::new();
+    for index in 0..100 {
+        std::thread::sleep(Duration::from_millis(20));
+        last = format!("test,t=b{}\n", index);
+        buffer
+            .table("test")?
+            .symbol("t", format!("b{}", index))?
+            .at_now()?;
+        sender.flush(&mut buffer)?;
+        if sender.stats().reconnects > 0 {
+            break;
+        }
+    }
+    assert_eq!(sender.stats().reconnects, 1);
+    assert!(!sender.must_close());
+
+    // The listener's backlog completed the handshake: Pick up the connection.
+    server.accept()?;
+    let expected = server.msgs.len() + 2;
+    while server.msgs.len() < expected {
+        assert!(server.recv(5.0)? > 0);
+    }
+    assert_eq!(server.msgs.len(), expected);
+    assert_eq!(server.msgs.last().unwrap(), &last);
+
+    buffer.table("test")?.symbol("t", "c")?.at_now()?;
+    sender.flush(&mut buffer)?;
+    assert_eq!(server.recv_q()?, 1);
+    assert_eq!(server.msgs.last().unwrap(), "test,t=c\n");
+    Ok(())
+}
+
+#[test]
+fn test_reconnect_timeout() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_tcp()
+        .reconnect_timeout(Some(Duration::from_millis(200)))?
+        .build()?;
+    server.accept()?;
+
+    // With the server gone, flushes wait out the timeout and fail, but the
+    // sender doesn't need closing.
+    drop(server);
+    let mut buffer = Buffer::new();
+    let err = loop {
+        buffer.table("test")?.symbol("t", "a")?.at_now()?;
+        let start = std::time::Instant::now();
+        match sender.flush(&mut buffer) {
+            Ok(()) => std::thread::sleep(Duration::from_millis(20)),
+            Err(err) => {
+                assert!(start.elapsed() < Duration::from_secs(5));
+                break err;
+            }
+        }
+    };
+    assert_eq!(err.code(), ErrorCode::SocketError);
+    assert!(!sender.must_close());
+    assert_eq!(sender.stats().reconnects, 0);
+    Ok(())
+}
+
+#[test]
+fn test_try_flush() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().build()?;
+    server.accept()?;
+    sender.set_nonblocking(true)?;
+    #[cfg(unix)]
+    assert!(sender.raw_fd().is_some());
+
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    buffer.table("test")?.symbol("t1", "v2")?.at_now()?;
+
+    // The blocking flush methods are rejected in non-blocking mode.
+    let err = sender.flush(&mut buffer).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+
+    while !sender.try_flush(&mut buffer)? {
+        server.recv(0.01)?;
+    }
+    assert!(buffer.is_empty());
+    assert_eq!(buffer.send_offset(), 0);
+
+    server.recv_q()?;
+    assert_eq!(server.msgs.len(), 2);
+    assert_eq!(server.msgs[0].as_str(), "test,t1=v1\n");
+    assert_eq!(server.msgs[1].as_str(), "test,t1=v2\n");
+    Ok(())
+}
+
+#[test]
+fn test_stats() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().build()?;
+    server.accept()?;
+    assert_eq!(sender.stats().flushes, 0);
+    assert_eq!(sender.stats().flush_latency.count(), 0);
+
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    buffer.table("test")?.symbol("t1", "v2")?.at_now()?;
+    let len = buffer.len() as u64;
+    sender.flush(&mut buffer)?;
+
+    // An incomplete row fails the flush.
+    buffer.table("test")?;
+    assert!(sender.flush(&mut buffer).is_err());
+
+    let stats = sender.stats();
+    assert_eq!(stats.flushes, 1);
+    assert_eq!(stats.failed_flushes, 1);
+    assert_eq!(stats.rows_sent, 2);
+    assert_eq!(stats.bytes_sent, len);
+    assert_eq!(stats.network_retries + stats.server_retries, 0);
+    let latency = &stats.flush_latency;
+    assert_eq!(latency.count(), 1);
+    assert!(latency.quantile(0.5) <= latency.max());
+    assert_eq!(latency.buckets().count(), 1);
+
+    assert_eq!(server.recv_q()?, 2);
+    Ok(())
+}
+
+#[test]
+fn test_trace_hook() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server.lsb_tcp().build()?;
+    server.accept()?;
+    let spans = Arc::new(Mutex::new(Vec::new()));
+    let spans2 = spans.clone();
+    sender.set_trace_hook(move |span| spans2.lock().unwrap().push((span.kind, span.bytes)));
+
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    let len = buffer.len();
+    sender.flush(&mut buffer)?;
+    assert_eq!(
+        *spans.lock().unwrap(),
+        [(FlushSpanKind::TcpWrite, len), (FlushSpanKind::Flush, len)]
+    );
+
+    sender.clear_trace_hook();
+    buffer.table("test")?.symbol("t1", "v2")?.at_now()?;
+    sender.flush(&mut buffer)?;
+    assert_eq!(spans.lock().unwrap().len(), 2);
+
+    assert_eq!(server.recv_q()?, 2);
+    Ok(())
+}
+
+#[test]
+fn test_sender_pool() -> TestResult {
+    let mut server = MockServer::new()?;
+    let pool = server.lsb_tcp().pool_size(1)?.build_pool()?;
+    server.accept()?;
+    assert_eq!(pool.pool_size(), 1);
+
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    pool.flush(&mut buffer)?;
+    assert!(buffer.is_empty());
+
+    buffer.table("test")?.symbol("t1", "v2")?.at_now()?;
+    {
+        let mut sender = pool.get()?;
+        assert!(!sender.must_close());
+        sender.flush(&mut buffer)?;
+    }
+    assert!(buffer.is_empty());
+    drop(pool);
+
+    assert_eq!(server.recv_q()?, 2);
+    assert_eq!(server.msgs[0].as_str(), "test,t1=v1\n");
+    assert_eq!(server.msgs[1].as_str(), "test,t1=v2\n");
+    Ok(())
+}
+
+#[test]
+fn test_flush_if_due() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_tcp()
+        .auto_flush_rows(Some(2))?
+        .auto_flush_interval(None)?
+        .build()?;
+    server.accept()?;
+
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    assert!(!sender.should_flush(&buffer));
+    assert!(!sender.flush_if_due(&mut buffer)?);
+
+    // Never due in the middle of a row.
+    buffer.table("test")?.symbol("t1", "v2")?;
+    assert!(!sender.should_flush(&buffer));
+    buffer.at_now()?;
+    assert!(sender.flush_if_due(&mut buffer)?);
+    assert!(buffer.is_empty());
+    assert_eq!(server.recv_q()?, 2);
+
+    let sender = server.lsb_tcp().auto_flush(false)?.build()?;
+    buffer.table("test")?.symbol("t1", "v3")?.at_now()?;
+    buffer.table("test")?.symbol("t1", "v4")?.at_now()?;
+    assert!(!sender.should_flush(&buffer));
+    Ok(())
+}
+
+#[test]
+fn test_flush_if_due_bytes() -> TestResult {
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_tcp()
+        .auto_flush_rows(None)?
+        .auto_flush_bytes(Some(16))?
+        .auto_flush_interval(None)?
+        .build()?;
+    server.accept()?;
+
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    assert!(!sender.flush_if_due(&mut buffer)?);
+    buffer.table("test")?.symbol("t1", "v2")?.at_now()?;
+    assert!(sender.flush_if_due(&mut buffer)?);
+    assert_eq!(server.recv_q()?, 2);
+    Ok(())
+}
+
+#[test]
+fn test_flush_if_due_past_max_buf_size() -> TestResult {
+    let max = 1024;
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_tcp()
+        .max_buf_size(max)?
+        .auto_flush_rows(None)?
+        .auto_flush_interval(None)?
+        .build()?;
+    server.accept()?;
+
+    // The last row crosses `max_buf_size`: Sent in chunks, not rejected.
+    let mut buffer = Buffer::new();
+    let mut rows = 0;
+    while buffer.len() <= max {
+        if buffer.len() < max {
+            assert!(!sender.flush_if_due(&mut buffer)?);
+        }
+        buffer.table("test")?.column_i64("i", rows)?.at_now()?;
+        rows += 1;
+    }
+    assert!(sender.should_flush(&buffer));
+    assert!(sender.flush_if_due(&mut buffer)?);
+    assert!(buffer.is_empty());
+    assert_eq!(sender.stats().flushes, 2);
+
+    while server.msgs.len() < rows as usize {
+        server.recv_q()?;
+    }
+    for (i, msg) in server.msgs.iter().enumerate() {
+        assert_eq!(msg.as_str(), format!("test i={}i\n", i));
+    }
+    Ok(())
+}
+
+#[test]
+fn test_append_columns() -> TestResult {
+    let syms = ["a b", "c"];
+    let bools = [true, false];
+    let ints = [1, -2];
+    let floats = [0.5, f64::NAN];
+    let strs = ["x\"y", ""];
+    let micros = [12345, 0];
+    let nanos = [10000000, 20000000];
+
+    let mut buffer = Buffer::new();
+    buffer.append_columns(
+        "test",
+        &[
+            ColumnSlice::new("b", ColumnData::Bool(&bools))?,
+            ColumnSlice::new("s", ColumnData::Symbol(&syms))?,
+            ColumnSlice::new("i", ColumnData::I64(&ints))?,
+            ColumnSlice::new("f", ColumnData::F64(&floats))?,
+            ColumnSlice::new("str", ColumnData::Str(&strs))?,
+            ColumnSlice::new("ts", ColumnData::TimestampMicros(&micros))?,
+        ],
+        Some(&nanos),
+    )?;
+
+    let mut expected = Buffer::new();
+    for row in 0..2 {
+        expected
+            .table("test")?
+            .symbol("s", syms[row])?
+            .column_bool("b", bools[row])?
+            .column_i64("i", ints[row])?
+            .column_f64("f", floats[row])?
+            .column_str("str", strs[row])?
+            .column_ts("ts", TimestampMicros::new(micros[row]))?
+            .at(TimestampNanos::new(nanos[row]))?;
+    }
+    assert_eq!(buffer.as_str(), expected.as_str());
+    assert_eq!(buffer.row_count(), 2);
+    assert!(buffer.transactional());
+
+    buffer.append_columns(
+        "test2",
+        &[ColumnSlice::new("i", ColumnData::I64(&ints))?],
+        None,
+    )?;
+    assert!(buffer.as_str().ends_with("test2 i=1i\ntest2 i=-2i\n"));
+    assert_eq!(buffer.row_count(), 4);
+    assert!(!buffer.transactional());
+    Ok(())
+}
+
+#[test]
+fn test_append_columns_errors() -> TestResult {
+    let ints = [1, 2];
+    let short = [1.0];
+    let mut buffer = Buffer::new();
+
+    let err = buffer
+        .append_columns(
+            "test",
+            &[
+                ColumnSlice::new("i", ColumnData::I64(&ints))?,
+                ColumnSlice::new("f", ColumnData::F64(&short))?,
+            ],
+            None,
+        )
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(
+        err.msg(),
+        "Bad call to `append_columns`: Column \"f\" has 1 values, expected 2."
+    );
+
+    let err = buffer
+        .append_columns(
+            "test",
+            &[ColumnSlice::new("i", ColumnData::I64(&ints))?],
+            Some(&[1, -1]),
+        )
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidTimestamp);
+
+    let err = buffer.append_columns("test", &[], None).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+
+    buffer.table("test")?;
+    let err = buffer
+        .append_columns(
+            "test",
+            &[ColumnSlice::new("i", ColumnData::I64(&ints))?],
+            None,
+        )
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(buffer.as_str(), "test");
+    Ok(())
+}
+
+unsafe extern "C" fn release_schema(_: *mut ArrowSchema) {}
+
+unsafe extern "C" fn release_array(_: *mut ArrowArray) {}
+
+/// An Arrow C data interface schema. `format` and `name` must be
+/// null-terminated.
+fn arrow_schema(format: &'static [u8], name: &'static [u8]) -> ArrowSchema {
+    ArrowSchema {
+        format: format.as_ptr().cast(),
+        name: name.as_ptr().cast(),
+        metadata: ptr::null(),
+        flags: 0,
+        n_children: 0,
+        children: ptr::null_mut(),
+        dictionary: ptr::null_mut(),
+        release: Some(release_schema),
+        private_data: ptr::null_mut(),
+    }
+}
+
+fn arrow_array(length: i64, null_count: i64, buffers: &mut [*const c_void]) -> ArrowArray {
+    ArrowArray {
+        length,
+        null_count,
+        offset: 0,
+        n_buffers: buffers.len() as i64,
+        n_children: 0,
+        buffers: buffers.as_mut_ptr(),
+        children: ptr::null_mut(),
+        dictionary: ptr::null_mut(),
+        release: Some(release_array),
+        private_data: ptr::null_mut(),
+    }
+}
+
+#[test]
+fn test_append_record_batch() -> TestResult {
+    let syms = b"a bcd";
+    let sym_offsets = [0i32, 3, 4, 5];
+    let prices = [0.5f64, 1.5, 2.5];
+    let price_validity = [0b101u8];
+    let qtys = [1i32, 2, 3];
+    let oks = [0b011u8];
+    let sector_keys = [1i8, 0, 1];
+    let sector_offsets = [0i32, 1, 2];
+    let sector_values = b"xy";
+    let seen_millis = [1000i64, 2000, 3000];
+    let nanos = [10i64, 20, 30];
+
+    let mut fields = [
+        arrow_schema(b"u\0", b"sym\0"),
+        arrow_schema(b"g\0", b"price\0"),
+        arrow_schema(b"i\0", b"qty\0"),
+        arrow_schema(b"b\0", b"ok\0"),
+        arrow_schema(b"c\0", b"sector\0"),
+        arrow_schema(b"tsm:\0", b"seen\0"),
+        arrow_schema(b"tsn:UTC\0", b"ts\0"),
+    ];
+    let mut sector_values_schema = arrow_schema(b"u\0", b"\0");
+    fields[4].dictionary = &mut sector_values_schema;
+    let mut field_ptrs: Vec<*mut ArrowSchema> = fields.iter_mut().map(|f| f as *mut _).collect();
+    let mut schema = arrow_schema(b"+s\0", b"\0");
+    schema.n_children = field_ptrs.len() as i64;
+    schema.children = field_ptrs.as_mut_ptr();
+
+    let mut buffers: [Vec<*const c_void>; 7] = [
+        vec![
+            ptr::null(),
+            sym_offsets.as_ptr().cast(),
+            syms.as_ptr().cast(),
+        ],
+        vec![price_validity.as_ptr().cast(), prices.as_ptr().cast()],
+        vec![ptr::null(), qtys.as_ptr().cast()],
+        vec![ptr::null(), oks.as_ptr().cast()],
+        vec![ptr::null(), sector_keys.as_ptr().cast()],
+        vec![ptr::null(), seen_millis.as_ptr().cast()],
+        vec![ptr::null(), nanos.as_ptr().cast()],
+    ];
+    let mut columns: Vec<ArrowArray> = buffers
+        .iter_mut()
+        .map(|buffers| arrow_array(3, 0, buffers))
+        .collect();
+    columns[1].null_count = 1;
+    let mut sector_buffers: Vec<*const c_void> = vec![
+        ptr::null(),
+        sector_offsets.as_ptr().cast(),
+        sector_values.as_ptr().cast(),
+    ];
+    let mut sector_values_array = arrow_array(2, 0, &mut sector_buffers);
+    columns[4].dictionary = &mut sector_values_array;
+    let mut column_ptrs: Vec<*mut ArrowArray> = columns.iter_mut().map(|c| c as *mut _).collect();
+    let mut struct_buffers: Vec<*const c_void> = vec![ptr::null()];
+    let mut array = arrow_array(3, 0, &mut struct_buffers);
+    array.n_children = column_ptrs.len() as i64;
+    array.children = column_ptrs.as_mut_ptr();
+
+    let mut buffer = Buffer::new();
+    unsafe { buffer.append_record_batch("test", &schema, &array, Some("ts"), &["sym"])? };
+
+    let mut expected = Buffer::new();
+    expected
+        .table("test")?
+        .symbol("sym", "a b")?
+        .symbol("sector", "y")?
+        .column_f64("price", 0.5)?
+        .column_i64("qty", 1)?
+        .column_bool("ok", true)?
+        .column_ts("seen", TimestampMicros::new(1000000))?
+        .at(TimestampNanos::new(10))?;
+    expected
+        .table("test")?
+        .symbol("sym", "c")?
+        .symbol("sector", "x")?
+        .column_i64("qty", 2)?
+        .column_bool("ok", true)?
+        .column_ts("seen", TimestampMicros::new(2000000))?
+        .at(TimestampNanos::new(20))?;
+    expected
+        .table("test")?
+        .symbol("sym", "d")?
+        .symbol("sector", "y")?
+        .column_f64("price", 2.5)?
+        .column_i64("qty", 3)?
+        .column_bool("ok", false)?
+        .column_ts("seen", TimestampMicros::new(3000000))?
+        .at(TimestampNanos::new(30))?;
+    assert_eq!(buffer.as_str(), expected.as_str());
+    assert_eq!(buffer.row_count(), 3);
+    assert!(buffer.transactional());
+
+    // The offset of the record batch applies to all of its columns.
+    array.offset = 1;
+    array.length = 2;
+    let mut sliced = Buffer::new();
+    unsafe { sliced.append_record_batch("test", &schema, &array, None, &[])? };
+    assert_eq!(
+        sliced.as_str(),
+        "test,sector=x sym=\"c\",qty=2i,ok=t,seen=2000000t,ts=0t\n\
+        test,sector=y sym=\"d\",price=2.5,qty=3i,ok=f,seen=3000000t,ts=0t\n"
+    );
+
+    let err = unsafe { buffer.append_record_batch("test", &schema, &array, Some("qty"), &[]) }
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(
+        err.msg(),
+        "Bad call to `append_record_batch`: \
+        Designated timestamp column \"qty\" is not an Arrow timestamp."
+    );
+    let err =
+        unsafe { buffer.append_record_batch("test", &schema, &array, None, &["qty"]) }.unwrap_err();
+    assert_eq!(
+        err.msg(),
+        "Bad call to `append_record_batch`: \
+        Symbol column \"qty\" is not an Arrow string column."
+    );
+    let err =
+        unsafe { buffer.append_record_batch("test", &schema, &array, Some("t"), &[]) }.unwrap_err();
+    assert_eq!(
+        err.msg(),
+        "Bad call to `append_record_batch`: No timestamp column named \"t\"."
+    );
+    assert_eq!(buffer.as_str(), expected.as_str());
+    Ok(())
+}
+
+#[test]
+fn test_fixed_capacity() -> TestResult {
+    let mut buffer = Buffer::with_fixed_capacity(127, 64);
+    assert_eq!(buffer.fixed_capacity(), Some(64));
+    assert!(buffer.capacity() >= 64);
+    let capacity = buffer.capacity();
+
+    buffer.table("test")?.symbol("t1", "v1")?.at_now()?;
+    buffer.table("test")?.column_i64("i", 1)?.at_now()?;
+    let before = buffer.as_str().to_owned();
+    let err = buffer
+        .table("test")?
+        .column_str("s", "a long string that doesn't fit")
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::BufferFull);
+    assert_eq!(buffer.as_str(), format!("{}test", before));
+
+    // Appends never grow the buffer, including via a row template and in bulk.
+    let template = RowTemplate::new("test")?.column("i", ColumnType::I64)?;
+    buffer.clear();
+    while buffer
+        .append_row(&template, [ColumnValue::I64(1)], None)
+        .is_ok()
+    {}
+    assert!(buffer.len() <= 64);
+    let len = buffer.len();
+    let ints = [1, 2, 3, 4, 5, 6, 7, 8];
+    let err = buffer
+        .append_columns(
+            "test",
+            &[ColumnSlice::new("i", ColumnData::I64(&ints))?],
+            None,
+        )
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::BufferFull);
+    assert_eq!(buffer.len(), len);
+    assert_eq!(buffer.capacity(), capacity);
+
+    let clone = buffer.clone();
+    assert!(clone.capacity() >= 64);
+    assert_eq!(clone.as_str(), buffer.as_str());
+    Ok(())
+}
+
+#[test]
+fn test_transactional_escaped_table_names() -> TestResult {
+    let mut buffer = Buffer::new();
+    buffer.table("a b")?.symbol("t", "v")?.at_now()?;
+    buffer.table("a b")?.symbol("t", "v")?.at_now()?;
+    assert!(buffer.transactional());
+    buffer.table("a")?.symbol("t", "v")?.at_now()?;
+    assert!(!buffer.transactional());
+
+    buffer.clear();
+    buffer.table("a")?.symbol("t", "v")?.at_now()?;
+    buffer.set_marker()?;
+    buffer.table("b")?.symbol("t", "v")?.at_now()?;
+    assert!(!buffer.transactional());
+    buffer.rewind_to_marker()?;
+    assert!(buffer.transactional());
+    Ok(())
+}
+
+#[test]
+fn test_prepared_column_name() -> TestResult {
+    let sym = PreparedColumnName::new("a sym")?;
+    let col1 = PreparedColumnName::new("col=1")?;
+    let col2 = PreparedColumnName::new("col2")?;
+    assert_eq!(col1.as_str(), "col=1");
+
+    let mut buffer = Buffer::new();
+    buffer
+        .table("test")?
+        .symbol(&sym, "v")?
+        .column_i64(&col1, 1)?
+        .column_f64(&col2, 2.5)?
+        .at_now()?;
+    buffer
+        .table("test")?
+        .column_str(&col1, "x")?
+        .column_bool(&col2, true)?
+        .at_now()?;
+    buffer.append_columns(
+        "test",
+        &[ColumnSlice::new(&col1, ColumnData::I64(&[3]))?],
+        None,
+    )?;
+    assert_eq!(
+        buffer.as_str(),
+        concat!(
+            "test,a\\ sym=v col\\=1=1i,col2=2.5\n",
+            "test col\\=1=\"x\",col2=t\n",
+            "test col\\=1=3i\n"
+        )
+    );
+
+    assert_eq!(
+        PreparedColumnName::new("bad.name").unwrap_err().code(),
+        ErrorCode::InvalidName
+    );
+
+    let mut buffer = Buffer::with_max_name_len(4);
+    buffer.table("test")?;
+    let err = buffer.column_bool(&col1, true).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidName);
+    Ok(())
+}
+
+#[cfg(all(feature = "io-uring", target_os = "linux"))]
+#[test]
+fn test_uring_backend() -> TestResult {
+    use crate::ingress::IoBackend;
+
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_tcp()
+        .io_backend(IoBackend::Uring)?
+        .uring_zc_threshold(Some(1024))?
+        .build()?;
+    server.accept()?;
+
+    // One write below the zero-copy threshold and one above it.
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.symbol("t", "a")?.at_now()?;
+    sender.flush(&mut buffer)?;
+    assert_eq!(server.recv_q()?, 1);
+
+    let value = "x".repeat(4096);
+    buffer.table("test")?.column_str("v", &value)?.at_now()?;
+    sender.flush(&mut buffer)?;
+    assert_eq!(server.recv_q()?, 1);
+    assert_eq!(server.msgs[1], format!("test v=\"{}\"\n", value));
+
+    let err = sender.set_nonblocking(true).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    Ok(())
+}
+
+#[test]
+fn test_sharded_sender() -> TestResult {
+    use crate::ingress::{ShardBy, ShardedSender};
+
+    let mut servers = [MockServer::new()?, MockServer::new()?];
+    let builders = servers.iter().map(|server| server.lsb_tcp()).collect();
+    let mut sender = ShardedSender::new(builders, ShardBy::Symbol("device".to_string()))?;
+    for server in servers.iter_mut() {
+        server.accept()?;
+    }
+    assert_eq!(sender.shard_count(), 2);
+
+    let err = sender.table("test").unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+
+    // Pick a key for each shard.
+    let keys: Vec<String> = (0..2)
+        .map(|shard| {
+            (0..)
+                .map(|n| format!("d{n}"))
+                .find(|key| sender.shard_for(key) == shard)
+                .unwrap()
+        })
+        .collect();
+    for key in &keys {
+        sender
+            .table_with_key("test", key)?
+            .column_i64("v", 1)?
+            .at_now()?;
+    }
+    sender.table_with_key("test", &keys[1])?;
+    assert_eq!(
+        sender.table_with_key("test", &keys[0]).unwrap_err().code(),
+        ErrorCode::InvalidApiCall
+    );
+    sender.rewind_row();
+    assert_eq!(sender.row_count(), 2);
+    assert_eq!(sender.shard_buffer(0).row_count(), 1);
+
+    sender.flush()?;
+    assert!(sender.is_empty());
+    for (shard, server) in servers.iter_mut().enumerate() {
+        assert_eq!(server.recv_q()?, 1);
+        assert_eq!(
+            server.msgs[0],
+            format!("test,device={} v=1i\n", keys[shard])
+        );
+        assert_eq!(sender.stats(shard).rows_sent, 1);
+    }
+    Ok(())
+}
+
+#[test]
+fn test_timestamp_precision() -> TestResult {
+    let mut buffer = Buffer::new();
+    assert_eq!(buffer.timestamp_precision(), TimestampPrecision::Nanos);
+    buffer.set_timestamp_precision(TimestampPrecision::Micros)?;
+    buffer
+        .table("test")?
+        .symbol("t1", "v1")?
+        .at(TimestampMicros::new(1_700_000_000_123_456))?;
+    buffer
+        .table("test")?
+        .symbol("t1", "v2")?
+        .at_delta(TimestampNanos::new(1_700_000_000_123_456_789))?;
+    buffer.append_columns(
+        "test",
+        &[ColumnSlice::new("x", ColumnData::I64(&[1]))?],
+        Some(&[1_700_000_000_123_457_999]),
+    )?;
+    assert_eq!(
+        buffer.as_str(),
+        concat!(
+            "test,t1=v1 1700000000123456\n",
+            "test,t1=v2 1700000000123456\n",
+            "test x=1i 1700000000123457\n"
+        )
+    );
+
+    let err = buffer
+        .set_timestamp_precision(TimestampPrecision::Seconds)
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+
+    let mut seconds = Buffer::new();
+    seconds.set_timestamp_precision(TimestampPrecision::Seconds)?;
+    seconds
+        .table("test")?
+        .symbol("t1", "v1")?
+        .at(TimestampMicros::new(1_700_000_000_999_999))?;
+    assert_eq!(seconds.as_str(), "test,t1=v1 1700000000\n");
+    let err = buffer.append_buffer(&seconds).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+
+    let mut server = MockServer::new()?;
+    let mut sender = server
+        .lsb_tcp()
+        .timestamp_precision(TimestampPrecision::Seconds)?
+        .build()?;
+    server.accept()?;
+    let err = sender.flush(&mut buffer).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(
+        sender.new_buffer().timestamp_precision(),
+        TimestampPrecision::Seconds
+    );
+    sender.flush(&mut seconds)?;
+    assert_eq!(server.recv_q()?, 1);
+    assert_eq!(server.msgs[0], "test,t1=v1 1700000000\n");
+    Ok(())
+}
+
+#[test]
+fn test_column_f64_fixed() -> TestResult {
+    let price = PreparedColumnName::new("price")?.with_decimals(2)?;
+    assert_eq!(price.decimals(), Some(2));
+
+    let mut buffer = Buffer::new();
+    buffer
+        .table("test")?
+        .column_f64_fixed("a", 101.25000000000001, 8)?
+        .column_f64_fixed("b", -0.005, 2)?
+        .column_f64_fixed("c", 3.0, 4)?
+        .column_f64_fixed("d", 0.1 + 0.2, 15)?
+        .column_f64_fixed("e", 1e300, 2)?
+        .column_f64(&price, 2615.5449)?
+        .at_now()?;
+    buffer.append_columns(
+        "test",
+        &[ColumnSlice::new(&price, ColumnData::F64(&[1.0 / 3.0]))?],
+        None,
+    )?;
+    assert_eq!(
+        buffer.as_str(),
+        concat!(
+            "test a=101.25,b=-0.01,c=3,d=0.3,e=1e300,price=2615.54\n",
+            "test price=0.33\n"
+        )
+    );
+
+    let err = buffer.column_f64_fixed("x", 1.0, 16).unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert!(PreparedColumnName::new("x")?.with_decimals(16).is_err());
+
+    let mut buffer = Buffer::new();
+    buffer.set_protocol_version(ProtocolVersion::V2)?;
+    buffer
+        .table("test")?
+        .column_f64_fixed("a", 1.5, 2)?
+        .at_now()?;
+    let mut expected = b"test a==".to_vec();
+    expected.push(16);
+    expected.extend_from_slice(&1.5f64.to_le_bytes());
+    expected.push(b'\n');
+    assert_eq!(buffer.as_bytes(), &expected[..]);
+    Ok(())
+}
+
+#[test]
+fn test_row_template() -> TestResult {
+    let template = RowTemplate::new("test")?
+        .column("s", ColumnType::Symbol)?
+        .column("b", ColumnType::Bool)?
+        .column("i", ColumnType::I64)?
+        .column("f", ColumnType::F64)?
+        .column("str", ColumnType::Str)?
+        .column("ts", ColumnType::TimestampMicros)?;
+
+    let mut buffer = Buffer::new();
+    buffer.append_row(
+        &template,
+        [
+            ColumnValue::Symbol("a b"),
+            ColumnValue::Bool(true),
+            ColumnValue::I64(-1),
+            ColumnValue::F64(0.5),
+            ColumnValue::Str("x\"y"),
+            ColumnValue::TimestampMicros(12345),
+        ],
+        Some(TimestampNanos::new(10000000)),
+    )?;
+
+    let mut expected = Buffer::new();
+    expected
+        .table("test")?
+        .symbol("s", "a b")?
+        .column_bool("b", true)?
+        .column_i64("i", -1)?
+        .column_f64("f", 0.5)?
+        .column_str("str", "x\"y")?
+        .column_ts("ts", TimestampMicros::new(12345))?
+        .at(TimestampNanos::new(10000000))?;
+    assert_eq!(buffer.as_str(), expected.as_str());
+    assert_eq!(buffer.row_count(), 1);
+
+    let err = buffer
+        .append_row(&template, [ColumnValue::Symbol("a")], None)
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    assert_eq!(
+        err.msg(),
+        "Bad call to `append_row`: 1 values supplied, expected 6."
+    );
+    let err = buffer
+        .append_row(
+            &template,
+            [ColumnValue::Symbol("a"), ColumnValue::I64(1)],
+            None,
+        )
+        .unwrap_err();
+    assert_eq!(
+        err.msg(),
+        "Bad call to `append_row`: Value 1 is I64, expected Bool."
+    );
+    assert_eq!(buffer.as_str(), expected.as_str());
+
+    let fields_only = RowTemplate::new("test")?.column("i", ColumnType::I64)?;
+    buffer.append_row(&fields_only, [ColumnValue::I64(7)], None)?;
+    assert!(buffer.as_str().ends_with("test i=7i\n"));
+    assert_eq!(buffer.row_count(), 2);
+
+    let err = RowTemplate::new("test")?
+        .column("i", ColumnType::I64)?
+        .column("s", ColumnType::Symbol)
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+
+    buffer.table("test")?;
+    let err = buffer
+        .append_row(&fields_only, [ColumnValue::I64(7)], None)
+        .unwrap_err();
+    assert_eq!(err.code(), ErrorCode::InvalidApiCall);
+    Ok(())
+}
+
+#[test]
+fn test_column_long256() -> TestResult {
+    let mut value = [0u8; 32];
+    value[0] = 0x12;
+    value[30] = 0x0f;
+    value[31] = 0xa0;
+    let mut buffer = Buffer::new();
+    buffer.table("test")?.column_long256("l", value)?.at_now()?;
+    assert_eq!(
+        buffer.as_str(),
+        format!("test l=0x12{}0fa0i\n", "0".repeat(58))
+    );
+    Ok(())
+}
+
 #[test]
 fn test_table_name_too_long() -> TestResult {
     let mut buffer = Buffer::with_max_name_len(4);
@@ -232,6 +232,29 @@ class QueryError(Exception):
     pass
 
 
+def http_sql_query(host, http_server_port, sql_query):
+    url = (
+        f'http://{host}:{http_server_port}/exec?' +
+        urllib.parse.urlencode({'query': sql_query}))
+    buf = None
+    try:
+        resp = urllib.request.urlopen(url, timeout=5)
+        buf = resp.read()
+    except urllib.error.HTTPError as http_error:
+        buf = http_error.read()
+    try:
+        data = json.loads(buf)
+    except json.JSONDecodeError as jde:
+        # Include buffer in error message for easier debugging.
+        raise json.JSONDecodeError(
+            f'Could not parse response: {buf!r}: {jde.msg}',
+            jde.doc,
+            jde.pos)
+    if 'error' in data:
+        raise QueryError(data['error'])
+    return data
+
+
 class QuestDbFixture:
     def __init__(self, root_dir: pathlib.Path, auth=False, wrap_tls=False, http=False):
         self._root_dir = root_dir
@@ -350,26 +373,7 @@ class QuestDbFixture:
             self.tls_line_tcp_port = self._tls_proxy.listen_port
 
     def http_sql_query(self, sql_query):
-        url = (
-            f'http://{self.host}:{self.http_server_port}/exec?' +
-            urllib.parse.urlencode({'query': sql_query}))
-        buf = None
-        try:
-            resp = urllib.request.urlopen(url, timeout=5)
-            buf = resp.read()
-        except urllib.error.HTTPError as http_error:
-            buf = http_error.read()
-        try:
-            data = json.loads(buf)
-        except json.JSONDecodeError as jde:
-            # Include buffer in error message for easier debugging.
-            raise json.JSONDecodeError(
-                f'Could not parse response: {buf!r}: {jde.msg}',
-                jde.doc,
-                jde.pos)
-        if 'error' in data:
-            raise QueryError(data['error'])
-        return data
+        return http_sql_query(self.host, self.http_server_port, sql_query)
     
     def query_version(self):
         try:
@@ -450,7 +454,8 @@ class TlsProxyFixture:
         proj = Project()
         self._code_dir = proj.root_dir / 'system_test' / 'tls_proxy'
         self._target_dir = proj.build_dir / 'tls_proxy'
-        self._log_path = self._target_dir / 'log.txt'
+        # One log per proxied port, so several proxies can run side by side.
+        self._log_path = self._target_dir / f'log_{qdb_ilp_port}.txt'
         self._log_file = None
         self._proc = None
 
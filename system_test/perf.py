@@ -0,0 +1,255 @@
+################################################################################
+##     ___                  _   ____  ____
+##    / _ \ _   _  ___  ___| |_|  _ \| __ )
+##   | | | | | | |/ _ \/ __| __| | | |  _ \
+##   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+##    \__\_\\__,_|\___||___/\__|____/|____/
+##
+##  Copyright (c) 2014-2019 Appsicle
+##  Copyright (c) 2019-2024 QuestDB
+##
+##  Licensed under the Apache License, Version 2.0 (the "License");
+##  you may not use this file except in compliance with the License.
+##  You may obtain a copy of the License at
+##
+##  http://www.apache.org/licenses/LICENSE-2.0
+##
+##  Unless required by applicable law or agreed to in writing, software
+##  distributed under the License is distributed on an "AS IS" BASIS,
+##  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+##  See the License for the specific language governing permissions and
+##  limitations under the License.
+##
+################################################################################
+
+import sys
+
+"""
+Throughput and latency suite, run via `test.py perf`.
+
+Drives the `line_sender_perf` load generator over each combination of
+protocol, row shape and sender count, checks that the server sees every row,
+and writes the results as JSON. The results can be compared against a
+baseline from an earlier run to catch regressions.
+"""
+
+import sys
+sys.dont_write_bytecode = True
+
+import json
+import platform
+import subprocess
+import time
+import uuid
+
+from fixture import CA_PATH, Project, QueryError, http_sql_query, retry
+
+
+PROTOCOLS = ('tcp', 'tcps', 'http', 'https')
+
+# Handled by the load generator:
+#   narrow: 1 symbol and 1 double.
+#   wide: 2 symbols, 5 doubles, 4 longs and 1 boolean.
+#   strings: 1 symbol and 2 strings.
+SHAPES = ('narrow', 'wide', 'strings')
+
+# Metrics compared against the baseline, and whether higher is better.
+COMPARED_METRICS = (
+    ('rows_per_sec', True),
+    ('mb_per_sec', True),
+    ('flush_latency_us.p50', False),
+    ('flush_latency_us.p99', False))
+
+
+class Target:
+    """The ports the load generator connects to, per protocol."""
+    def __init__(self, host, line_tcp_port, http_server_port,
+                 tls_line_tcp_port=None, tls_http_port=None, version=None):
+        self.host = host
+        self.line_tcp_port = line_tcp_port
+        self.http_server_port = http_server_port
+        self.tls_line_tcp_port = tls_line_tcp_port
+        self.tls_http_port = tls_http_port
+        self.version = version
+
+    def conf(self, protocol):
+        tls = f'tls_roots={CA_PATH};'
+        if protocol == 'tcp':
+            return f'tcp::addr={self.host}:{self.line_tcp_port};'
+        elif protocol == 'tcps':
+            # The TLS proxy always listens on localhost.
+            return f'tcps::addr=localhost:{self.tls_line_tcp_port};{tls}'
+        elif protocol == 'http':
+            return f'http::addr={self.host}:{self.http_server_port};'
+        elif protocol == 'https':
+            return f'https::addr=localhost:{self.tls_http_port};{tls}'
+        raise ValueError(f'Unknown protocol {protocol!r}')
+
+
+def find_load_generator():
+    proj = Project()
+    ext = '.exe' if sys.platform == 'win32' else ''
+    bin_name = f'line_sender_perf{ext}'
+    try:
+        return next(proj.build_dir.glob(f'**/{bin_name}'))
+    except StopIteration:
+        raise RuntimeError(
+            f'Could not find {bin_name} in {proj.build_dir}: ' +
+            'Build with `-DQUESTDB_TESTS_AND_EXAMPLES=ON`.')
+
+
+def count_rows(target, table_name, expected, timeout_sec):
+    """
+    Wait until the server sees `expected` rows in the table, or times out.
+    Returns the last row count seen and how long it took to see it.
+    """
+    start = time.monotonic()
+    last_count = [0]
+
+    def check_count():
+        try:
+            resp = http_sql_query(
+                target.host,
+                target.http_server_port,
+                f"select count() from '{table_name}'")
+            last_count[0] = resp['dataset'][0][0]
+        except QueryError:
+            # The table may not exist yet.
+            pass
+        return last_count[0] >= expected
+
+    try:
+        retry(check_count, timeout_sec=timeout_sec)
+    except TimeoutError:
+        pass
+    return last_count[0], time.monotonic() - start
+
+
+def drop_table(target, table_name):
+    try:
+        http_sql_query(
+            target.host,
+            target.http_server_port,
+            f"drop table '{table_name}'")
+    except QueryError:
+        pass
+
+
+def run_scenario(bin_path, target, protocol, shape, senders, args):
+    name = f'{protocol}/{shape}/{senders}'
+    table_name = f'perf_{protocol}_{shape}_{senders}_{uuid.uuid4().hex[:8]}'
+    sys.stderr.write(f'Running perf scenario {name}.\n')
+    proc = subprocess.run(
+        [str(bin_path),
+         target.conf(protocol),
+         table_name,
+         shape,
+         str(senders),
+         str(args.rows),
+         str(args.batch)],
+        stdout=subprocess.PIPE,
+        check=False)
+    try:
+        result = json.loads(proc.stdout)
+    except json.JSONDecodeError:
+        raise RuntimeError(
+            f'Bad output from load generator for {name}: {proc.stdout!r}')
+    expected = senders * args.rows
+    server_rows, visible_after_s = count_rows(
+        target, table_name, expected, args.visibility_timeout)
+    drop_table(target, table_name)
+    result.update(
+        name=name,
+        protocol=protocol,
+        shape=shape,
+        senders=senders,
+        expected_rows=expected,
+        server_rows=server_rows,
+        visible_after_s=visible_after_s)
+    return result
+
+
+def get_metric(result, metric):
+    value = result
+    for key in metric.split('.'):
+        value = value[key]
+    return value
+
+
+def compare(results, baseline, tolerance):
+    """
+    Compare results with a baseline, returning a list of regressions.
+    A metric regresses if it is worse than the baseline by more than the
+    `tolerance` fraction. Scenarios missing from the baseline are skipped.
+    """
+    baseline_by_name = {
+        scenario['name']: scenario
+        for scenario in baseline['scenarios']}
+    regressions = []
+    for result in results['scenarios']:
+        base = baseline_by_name.get(result['name'])
+        if base is None:
+            continue
+        for metric, higher_is_better in COMPARED_METRICS:
+            value = get_metric(result, metric)
+            base_value = get_metric(base, metric)
+            if higher_is_better:
+                regressed = value < base_value * (1.0 - tolerance)
+            else:
+                regressed = value > base_value * (1.0 + tolerance)
+            if regressed:
+                regressions.append(
+                    f'{result["name"]}: {metric} is {value}, ' +
+                    f'baseline is {base_value}')
+    return regressions
+
+
+def run(target, args):
+    """
+    Run every scenario against the target and write the results.
+    Returns the process exit code.
+    """
+    bin_path = find_load_generator()
+    scenarios = []
+    failures = []
+    for protocol in args.protocols:
+        for shape in args.shapes:
+            for senders in args.senders:
+                result = run_scenario(
+                    bin_path, target, protocol, shape, senders, args)
+                scenarios.append(result)
+                if result['error']:
+                    failures.append(f'{result["name"]}: {result["error"]}')
+                elif result['server_rows'] != result['expected_rows']:
+                    failures.append(
+                        f'{result["name"]}: server has ' +
+                        f'{result["server_rows"]} rows, ' +
+                        f'expected {result["expected_rows"]}')
+
+    results = {
+        'questdb_version': '.'.join(str(part) for part in target.version)
+            if target.version else None,
+        'platform': platform.platform(),
+        'rows_per_sender': args.rows,
+        'batch_rows': args.batch,
+        'scenarios': scenarios}
+    with open(args.output, 'w', encoding='utf-8') as output_file:
+        json.dump(results, output_file, indent=2)
+    sys.stderr.write(f'Wrote perf results to {args.output}.\n')
+
+    for result in scenarios:
+        latency = result['flush_latency_us']
+        sys.stderr.write(
+            f'    {result["name"]:<20} ' +
+            f'{result["rows_per_sec"]:>12.0f} rows/s ' +
+            f'{result["mb_per_sec"]:>8.1f} MB/s ' +
+            f'p50 {latency["p50"]}us p99 {latency["p99"]}us\n')
+
+    if args.baseline:
+        with open(args.baseline, 'r', encoding='utf-8') as baseline_file:
+            baseline = json.load(baseline_file)
+        failures.extend(compare(results, baseline, args.tolerance))
+
+    for failure in failures:
+        sys.stderr.write(f'FAILED: {failure}\n')
+    return 1 if failures else 0
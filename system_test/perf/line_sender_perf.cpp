@@ -0,0 +1,280 @@
+/*******************************************************************************
+ *     ___                  _   ____  ____
+ *    / _ \ _   _  ___  ___| |_|  _ \| __ )
+ *   | | | | | | |/ _ \/ __| __| | | |  _ \
+ *   | |_| | |_| |  __/\__ \ |_| |_| | |_) |
+ *    \__\_\\__,_|\___||___/\__|____/|____/
+ *
+ *  Copyright (c) 2014-2019 Appsicle
+ *  Copyright (c) 2019-2024 QuestDB
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+// Load generator for `system_test/test.py perf`.
+//
+// Usage:
+//     line_sender_perf CONF TABLE SHAPE SENDERS ROWS_PER_SENDER BATCH_ROWS
+//
+// Each of the SENDERS threads builds its own sender from CONF and appends
+// ROWS_PER_SENDER rows of the given SHAPE (`narrow`, `wide` or `strings`),
+// flushing every BATCH_ROWS rows. The results are printed to stdout as a
+// single JSON object.
+
+#include <questdb/ingress/line_sender.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace questdb::ingress::literals;
+using clock_type = std::chrono::steady_clock;
+
+namespace
+{
+    enum class shape
+    {
+        narrow,
+        wide,
+        strings
+    };
+
+    struct sender_result
+    {
+        uint64_t rows = 0;
+        uint64_t bytes = 0;
+        std::vector<uint64_t> flush_micros;
+        std::string error;
+    };
+
+    void append_row(
+        questdb::ingress::line_sender_buffer& buffer,
+        questdb::ingress::table_name_view table,
+        shape row_shape,
+        size_t sender_index,
+        uint64_t row,
+        int64_t ts_nanos)
+    {
+        static const questdb::ingress::utf8_view symbols[] = {
+            "ETH-USD"_utf8, "BTC-USD"_utf8, "SOL-USD"_utf8, "ADA-USD"_utf8};
+        const auto& symbol = symbols[row % 4];
+        const auto value = static_cast<double>(row) * 0.25;
+        buffer.table(table).symbol("sym"_cn, symbol);
+        switch (row_shape)
+        {
+        case shape::narrow:
+            buffer.column("price"_cn, value);
+            break;
+        case shape::wide:
+            buffer
+                .symbol("venue"_cn, (row & 1) ? "lse"_utf8 : "nyse"_utf8)
+                .column("sender"_cn, static_cast<int64_t>(sender_index))
+                .column("seq"_cn, static_cast<int64_t>(row))
+                .column("bid"_cn, value)
+                .column("ask"_cn, value + 0.5)
+                .column("bid_qty"_cn, static_cast<int64_t>(row % 1000))
+                .column("ask_qty"_cn, static_cast<int64_t>(row % 777))
+                .column("spread"_cn, 0.5)
+                .column("last"_cn, value + 0.25)
+                .column("active"_cn, (row & 1) == 0);
+            break;
+        case shape::strings:
+            buffer
+                .column(
+                    "note"_cn,
+                    "order accepted by the matching engine, awaiting fill"_utf8)
+                .column("client"_cn, symbol);
+            break;
+        }
+        buffer.at(questdb::ingress::timestamp_nanos{ts_nanos});
+    }
+
+    void run_sender(
+        const std::string& conf,
+        const std::string& table_name,
+        shape row_shape,
+        size_t sender_index,
+        uint64_t rows,
+        uint64_t batch_rows,
+        sender_result& result)
+    {
+        try
+        {
+            auto sender = questdb::ingress::line_sender::from_conf(conf);
+            auto buffer = sender.new_buffer();
+            const questdb::ingress::table_name_view table{table_name};
+            const int64_t base_ts =
+                questdb::ingress::timestamp_nanos::now().as_nanos();
+            result.flush_micros.reserve(
+                static_cast<size_t>(rows / batch_rows + 1));
+            for (uint64_t row = 0; row < rows; ++row)
+            {
+                append_row(
+                    buffer,
+                    table,
+                    row_shape,
+                    sender_index,
+                    row,
+                    base_ts + static_cast<int64_t>(row) * 1000);
+                if (((row + 1) % batch_rows == 0) || (row + 1 == rows))
+                {
+                    const auto batch_bytes = buffer.size();
+                    const auto batch_row_count = buffer.row_count();
+                    const auto start = clock_type::now();
+                    sender.flush(buffer);
+                    const auto elapsed = clock_type::now() - start;
+                    result.flush_micros.push_back(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                            elapsed)
+                            .count()));
+                    result.bytes += batch_bytes;
+                    result.rows += batch_row_count;
+                }
+            }
+            sender.close();
+        }
+        catch (const std::exception& err)
+        {
+            result.error = err.what();
+        }
+    }
+
+    uint64_t percentile(const std::vector<uint64_t>& sorted, double q)
+    {
+        if (sorted.empty())
+            return 0;
+        auto rank = static_cast<size_t>(
+            q * static_cast<double>(sorted.size()) + 0.999999);
+        rank = std::clamp<size_t>(rank, 1, sorted.size());
+        return sorted[rank - 1];
+    }
+
+    std::string json_escaped(const std::string& s)
+    {
+        std::string out;
+        for (const char c : s)
+        {
+            if (c == '"' || c == '\\')
+                out.push_back('\\');
+            if (static_cast<unsigned char>(c) < 0x20)
+                out.push_back(' ');
+            else
+                out.push_back(c);
+        }
+        return out;
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    if (argc != 7)
+    {
+        std::cerr
+            << "Usage: " << argv[0]
+            << " CONF TABLE SHAPE SENDERS ROWS_PER_SENDER BATCH_ROWS"
+            << std::endl;
+        return 2;
+    }
+    const std::string conf{argv[1]};
+    const std::string table{argv[2]};
+    const std::string shape_name{argv[3]};
+    const auto senders = std::strtoull(argv[4], nullptr, 10);
+    const auto rows = std::strtoull(argv[5], nullptr, 10);
+    const auto batch_rows = std::strtoull(argv[6], nullptr, 10);
+
+    shape row_shape;
+    if (shape_name == "narrow")
+        row_shape = shape::narrow;
+    else if (shape_name == "wide")
+        row_shape = shape::wide;
+    else if (shape_name == "strings")
+        row_shape = shape::strings;
+    else
+    {
+        std::cerr << "Unknown shape: " << shape_name << std::endl;
+        return 2;
+    }
+    if (senders == 0 || rows == 0 || batch_rows == 0)
+    {
+        std::cerr << "SENDERS, ROWS_PER_SENDER and BATCH_ROWS must be > 0."
+                  << std::endl;
+        return 2;
+    }
+
+    std::vector<sender_result> results(senders);
+    std::vector<std::thread> threads;
+    const auto start = clock_type::now();
+    for (size_t index = 0; index < senders; ++index)
+    {
+        threads.emplace_back(
+            run_sender,
+            std::cref(conf),
+            std::cref(table),
+            row_shape,
+            index,
+            rows,
+            batch_rows,
+            std::ref(results[index]));
+    }
+    for (auto& thread : threads)
+        thread.join();
+    const std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+    uint64_t total_rows = 0;
+    uint64_t total_bytes = 0;
+    std::vector<uint64_t> flush_micros;
+    std::string error;
+    for (const auto& result : results)
+    {
+        total_rows += result.rows;
+        total_bytes += result.bytes;
+        flush_micros.insert(
+            flush_micros.end(),
+            result.flush_micros.begin(),
+            result.flush_micros.end());
+        if (error.empty())
+            error = result.error;
+    }
+    std::sort(flush_micros.begin(), flush_micros.end());
+
+    const double secs = elapsed.count();
+    std::cout
+        << "{\"rows\": " << total_rows
+        << ", \"bytes\": " << total_bytes
+        << ", \"elapsed_s\": " << secs
+        << ", \"rows_per_sec\": " << (static_cast<double>(total_rows) / secs)
+        << ", \"mb_per_sec\": "
+        << (static_cast<double>(total_bytes) / secs / 1e6)
+        << ", \"flushes\": " << flush_micros.size()
+        << ", \"flush_latency_us\": {"
+        << "\"p50\": " << percentile(flush_micros, 0.5)
+        << ", \"p90\": " << percentile(flush_micros, 0.9)
+        << ", \"p99\": " << percentile(flush_micros, 0.99)
+        << ", \"p999\": " << percentile(flush_micros, 0.999)
+        << ", \"max\": " << (flush_micros.empty() ? 0 : flush_micros.back())
+        << "}, \"error\": ";
+    if (error.empty())
+        std::cout << "null";
+    else
+        std::cout << '"' << json_escaped(error) << '"';
+    std::cout << "}" << std::endl;
+    return error.empty() ? 0 : 1;
+}
@@ -35,6 +35,7 @@ import argparse
 import unittest
 import time
 import questdb_line_sender as qls
+import perf
 import uuid
 from fixture import (
     Project,
@@ -787,6 +788,70 @@ def parse_args():
         help=('Test against existing jar from a ' +
               '`mvn install -DskipTests -P build-web-console`' +
               '-ed questdb repo such as `~/questdb/repos/questdb/`'))
+    perf_p = sub_p.add_parser(
+        'perf',
+        help='Run the throughput and latency suite')
+    perf_version_g = perf_p.add_mutually_exclusive_group()
+    perf_version_g.add_argument(
+        '--versions',
+        type=str,
+        nargs=1,
+        help='Version to run against, e.g. `6.1.2`. Defaults to the latest.')
+    perf_version_g.add_argument(
+        '--existing',
+        type=str,
+        metavar='HOST:ILP_PORT:HTTP_PORT',
+        help='Run against an existing running instance.')
+    perf_version_g.add_argument(
+        '--repo',
+        type=str,
+        metavar='PATH',
+        help='Run against an existing jar from a questdb repo.')
+    perf_p.add_argument(
+        '--protocols',
+        nargs='+',
+        choices=perf.PROTOCOLS,
+        default=list(perf.PROTOCOLS))
+    perf_p.add_argument(
+        '--shapes',
+        nargs='+',
+        choices=perf.SHAPES,
+        default=list(perf.SHAPES))
+    perf_p.add_argument(
+        '--senders',
+        nargs='+',
+        type=int,
+        default=[1, 4],
+        help='Numbers of concurrent senders to run each scenario with.')
+    perf_p.add_argument(
+        '--rows',
+        type=int,
+        default=1000000,
+        help='Rows sent by each sender.')
+    perf_p.add_argument(
+        '--batch',
+        type=int,
+        default=10000,
+        help='Rows per flush.')
+    perf_p.add_argument(
+        '--visibility-timeout',
+        type=float,
+        default=120.0,
+        help='Seconds to wait for the server to see all rows.')
+    perf_p.add_argument(
+        '--output',
+        type=str,
+        default='perf_results.json',
+        help='Path of the JSON results.')
+    perf_p.add_argument(
+        '--baseline',
+        type=str,
+        help='JSON results of an earlier run to compare against.')
+    perf_p.add_argument(
+        '--tolerance',
+        type=float,
+        default=0.1,
+        help='Allowed regression against the baseline, as a fraction.')
     list_p = sub_p.add_parser('list', help='List latest -n releases.')
     list_p.set_defaults(command='list')
     list_p.add_argument('-n', type=int, default=30, help='number of releases')
@@ -886,6 +951,39 @@ def run_with_fixtures(args):
                         QDB_FIXTURE.stop()
 
 
+def run_perf(args):
+    needs_tls = any(protocol in ('tcps', 'https') for protocol in args.protocols)
+    qdb = None
+    proxies = []
+    try:
+        if args.existing:
+            host, line_tcp_port, http_server_port = args.existing.split(':')
+            target = perf.Target(host, int(line_tcp_port), int(http_server_port))
+        else:
+            questdb_dir = next(iter_versions(args))
+            qdb = QuestDbFixture(questdb_dir, http=True)
+            qdb.start()
+            target = perf.Target(
+                qdb.host,
+                qdb.line_tcp_port,
+                qdb.http_server_port,
+                version=qdb.version)
+        if needs_tls:
+            for port, attr in (
+                    (target.line_tcp_port, 'tls_line_tcp_port'),
+                    (target.http_server_port, 'tls_http_port')):
+                proxy = TlsProxyFixture(port)
+                proxy.start()
+                proxies.append(proxy)
+                setattr(target, attr, proxy.listen_port)
+        return perf.run(target, args)
+    finally:
+        for proxy in proxies:
+            proxy.stop()
+        if qdb:
+            qdb.stop()
+
+
 def run(args, show_help=False):
     if show_help:
         sys.argv.append('--help')
@@ -903,6 +1001,8 @@ def main():
     args, extra_args = parse_args()
     if args.command == 'list':
         list_releases(args)
+    elif args.command == 'perf':
+        sys.exit(run_perf(args))
     else:
         # Repackage args for unittest's own arg parser.
         sys.argv[:] = sys.argv[:1] + extra_args